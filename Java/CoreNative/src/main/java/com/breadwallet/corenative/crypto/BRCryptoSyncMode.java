@@ -35,12 +35,20 @@ public enum BRCryptoSyncMode {
         public int toCore() {
             return CRYPTO_SYNC_MODE_P2P_ONLY_VALUE;
         }
+    },
+
+    CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS {
+        @Override
+        public int toCore() {
+            return CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS_VALUE;
+        }
     };
 
     private static final int CRYPTO_SYNC_MODE_API_ONLY_VALUE = 0;
     private static final int CRYPTO_SYNC_MODE_API_WITH_P2P_SEND_VALUE = 1;
     private static final int CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC_VALUE = 2;
     private static final int CRYPTO_SYNC_MODE_P2P_ONLY_VALUE = 3;
+    private static final int CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS_VALUE = 4;
 
     public static BRCryptoSyncMode fromCore(int nativeValue) {
         switch (nativeValue) {
@@ -48,6 +56,7 @@ public enum BRCryptoSyncMode {
             case CRYPTO_SYNC_MODE_API_WITH_P2P_SEND_VALUE: return CRYPTO_SYNC_MODE_API_WITH_P2P_SEND;
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC_VALUE: return CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC;
             case CRYPTO_SYNC_MODE_P2P_ONLY_VALUE:          return CRYPTO_SYNC_MODE_P2P_ONLY;
+            case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS_VALUE: return CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS;
             default: throw new IllegalArgumentException("Invalid core value");
         }
     }
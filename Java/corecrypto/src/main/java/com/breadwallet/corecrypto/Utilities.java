@@ -59,6 +59,7 @@ final class Utilities {
             case API_WITH_P2P_SUBMIT: return BRCryptoSyncMode.CRYPTO_SYNC_MODE_API_WITH_P2P_SEND;
             case P2P_ONLY: return BRCryptoSyncMode.CRYPTO_SYNC_MODE_P2P_ONLY;
             case P2P_WITH_API_SYNC: return BRCryptoSyncMode.CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC;
+            case P2P_BLOCK_FILTERS: return BRCryptoSyncMode.CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS;
             default: throw new IllegalArgumentException("Unsupported mode");
         }
     }
@@ -70,6 +71,7 @@ final class Utilities {
             case CRYPTO_SYNC_MODE_API_WITH_P2P_SEND: return WalletManagerMode.API_WITH_P2P_SUBMIT;
             case CRYPTO_SYNC_MODE_P2P_ONLY: return WalletManagerMode.P2P_ONLY;
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC: return WalletManagerMode.P2P_WITH_API_SYNC;
+            case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS: return WalletManagerMode.P2P_BLOCK_FILTERS;
             default: throw new IllegalArgumentException("Unsupported mode");
         }
     }
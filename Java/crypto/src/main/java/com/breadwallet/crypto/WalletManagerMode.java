@@ -13,7 +13,8 @@ public enum WalletManagerMode {
     API_ONLY,
     API_WITH_P2P_SUBMIT,
     P2P_ONLY,
-    P2P_WITH_API_SYNC;
+    P2P_WITH_API_SYNC,
+    P2P_BLOCK_FILTERS;
 
     public int toSerialization () {
         switch (this) {
@@ -21,6 +22,7 @@ public enum WalletManagerMode {
             case API_WITH_P2P_SUBMIT: return 0xf1;
             case P2P_WITH_API_SYNC:   return 0xf2;
             case P2P_ONLY:            return 0xf3;
+            case P2P_BLOCK_FILTERS:   return 0xf4;
             default: return 0; // error
         }
     }
@@ -31,6 +33,7 @@ public enum WalletManagerMode {
             case 0xf1: return WalletManagerMode.API_WITH_P2P_SUBMIT;
             case 0xf2: return WalletManagerMode.P2P_WITH_API_SYNC;
             case 0xf3: return WalletManagerMode.P2P_ONLY;
+            case 0xf4: return WalletManagerMode.P2P_BLOCK_FILTERS;
             default: return null;
         }
     }
@@ -543,11 +543,16 @@ public enum WalletManagerState: Equatable {
 ///
 /// - p2p_only: Use the network's Peer-to-Peer protocol to synchronize the account's transfers.
 ///
+/// - p2p_block_filters: Use the network's Peer-to-Peer protocol to synchronize the account's
+///      transfers, matching compact block filters (BIP-157/158) locally rather than revealing
+///      the account's addresses to peers with a bloom filter.
+///
 public enum WalletManagerMode: Equatable {
     case api_only
     case api_with_p2p_submit
     case p2p_with_api_sync
     case p2p_only
+    case p2p_block_filters
 
     /// Allow WalletMangerMode to be saved
     public var serialization: UInt8 {
@@ -556,6 +561,7 @@ public enum WalletManagerMode: Equatable {
         case .api_with_p2p_submit: return 0xf1
         case .p2p_with_api_sync:   return 0xf2
         case .p2p_only:            return 0xf3
+        case .p2p_block_filters:   return 0xf4
         }
     }
 
@@ -566,6 +572,7 @@ public enum WalletManagerMode: Equatable {
         case 0xf1: self = .api_with_p2p_submit
         case 0xf2: self = .p2p_with_api_sync
         case 0xf3: self = .p2p_only
+        case 0xf4: self = .p2p_block_filters
         default: return nil
         }
     }
@@ -576,6 +583,7 @@ public enum WalletManagerMode: Equatable {
         case CRYPTO_SYNC_MODE_API_WITH_P2P_SEND: self = .api_with_p2p_submit
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC: self = .p2p_with_api_sync
         case CRYPTO_SYNC_MODE_P2P_ONLY: self = .p2p_only
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS: self = .p2p_block_filters
         default: self = .api_only; preconditionFailure()
         }
     }
@@ -586,6 +594,7 @@ public enum WalletManagerMode: Equatable {
         case .api_with_p2p_submit: return CRYPTO_SYNC_MODE_API_WITH_P2P_SEND
         case .p2p_with_api_sync: return CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC
         case .p2p_only: return CRYPTO_SYNC_MODE_P2P_ONLY
+        case .p2p_block_filters: return CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS
         }
     }
 
@@ -17,7 +17,8 @@ class WalletManagerViewController: UIViewController, WalletManagerListener {
     let modes = [WalletManagerMode.api_only,
                  WalletManagerMode.api_with_p2p_submit,
                  WalletManagerMode.p2p_with_api_sync,
-                 WalletManagerMode.p2p_only]
+                 WalletManagerMode.p2p_only,
+                 WalletManagerMode.p2p_block_filters]
 
     let addressSchemes = [AddressScheme.btcLegacy,
                           AddressScheme.btcSegwit,
@@ -181,6 +182,8 @@ extension WalletManagerMode: CustomStringConvertible {
             return "p2p_with_api_sync"
         case .p2p_only:
             return "p2p_only"
+        case .p2p_block_filters:
+            return "p2p_block_filters"
         }
     }
 }
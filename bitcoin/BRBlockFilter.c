@@ -0,0 +1,207 @@
+//
+//  BRBlockFilter.c
+//  BRCore
+//
+//  Copyright © 2026 Breadwallet AG. All rights reserved.
+//
+//  See the LICENSE file at the project root for license information.
+//  See the CONTRIBUTORS file at the project root for a list of contributors.
+//
+
+#include "BRBlockFilter.h"
+#include "BRCrypto.h"
+#include "BRAddress.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define FILTER_STACK_ELEMENTS 256 // elements hashed on the stack before falling back to the heap
+
+/// MARK: - Hashing
+
+// maps element uniformly into [0, f) by multiplying its siphash by f and keeping the upper 64 bits of the product,
+// done in 32 bit halves since 128 bit integers aren't available on every target
+static uint64_t _BRBlockFilterHashToRange(const uint8_t *key, const uint8_t *data, size_t dataLen, uint64_t f)
+{
+    uint64_t h = BRSip64(key, data, dataLen), hHi = h >> 32, hLo = h & 0xffffffff, fHi = f >> 32, fLo = f & 0xffffffff,
+             lo = hLo*fLo, mid1 = hHi*fLo, mid2 = hLo*fHi,
+             carry = ((lo >> 32) + (mid1 & 0xffffffff) + (mid2 & 0xffffffff)) >> 32;
+
+    return hHi*fHi + (mid1 >> 32) + (mid2 >> 32) + carry;
+}
+
+static int _BRUInt64Compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int _BRBlockFilterElementCompare(const void *a, const void *b)
+{
+    const BRBlockFilterElement *x = *(const BRBlockFilterElement * const *)a,
+                               *y = *(const BRBlockFilterElement * const *)b;
+    size_t len = (x->dataLen < y->dataLen) ? x->dataLen : y->dataLen;
+    int r = memcmp(x->data, y->data, len);
+
+    return (r != 0) ? r : (x->dataLen < y->dataLen) ? -1 : (x->dataLen > y->dataLen) ? 1 : 0;
+}
+
+/// MARK: - Golomb-Rice Coding
+
+// bits are written and read most significant first
+typedef struct {
+    uint8_t *buf; // NULL to only count bits
+    const uint8_t *rbuf;
+    size_t len, bit;
+} _BRBitStream;
+
+static void _BRBitWrite(_BRBitStream *s, uint64_t value, int bitCount)
+{
+    while (bitCount-- > 0) {
+        if (s->buf && s->bit/8 < s->len && ((value >> bitCount) & 1)) s->buf[s->bit/8] |= (0x80 >> (s->bit % 8));
+        s->bit++;
+    }
+}
+
+// reads bitCount bits into value, returns false if the stream ends first
+static int _BRBitRead(_BRBitStream *s, uint64_t *value, int bitCount)
+{
+    uint64_t v = 0;
+
+    if (s->bit + bitCount > s->len*8) return 0;
+
+    while (bitCount-- > 0) {
+        v = (v << 1) | ((s->rbuf[s->bit/8] >> (7 - s->bit % 8)) & 1);
+        s->bit++;
+    }
+
+    *value = v;
+    return 1;
+}
+
+static void _BRGolombEncode(_BRBitStream *s, uint64_t delta)
+{
+    uint64_t q = delta >> BLOCK_FILTER_BASIC_P;
+
+    while (q > 0) _BRBitWrite(s, 1, 1), q--;
+    _BRBitWrite(s, 0, 1);
+    _BRBitWrite(s, delta, BLOCK_FILTER_BASIC_P);
+}
+
+// returns false if the stream ends before a complete delta is read
+static int _BRGolombDecode(_BRBitStream *s, uint64_t *delta)
+{
+    uint64_t q = 0, b = 1, r;
+
+    while (_BRBitRead(s, &b, 1) && b == 1) q++;
+    if (b != 0 || ! _BRBitRead(s, &r, BLOCK_FILTER_BASIC_P)) return 0;
+    *delta = (q << BLOCK_FILTER_BASIC_P) | r;
+    return 1;
+}
+
+/// MARK: - Block Filter
+
+// writes a serialized basic filter for blockHash containing elements to filter, duplicate and empty elements are skipped
+// returns the number of bytes written, or the total filterLen needed if filter is NULL
+size_t BRBlockFilterBuild(uint8_t *filter, size_t filterLen, UInt256 blockHash, const BRBlockFilterElement elements[],
+                          size_t elemCount)
+{
+    const BRBlockFilterElement **set = (elemCount > 0) ? malloc(elemCount*sizeof(*set)) : NULL;
+    uint64_t *values = (elemCount > 0) ? malloc(elemCount*sizeof(*values)) : NULL, f, last = 0;
+    _BRBitStream s = { NULL, NULL, 0, 0 };
+    size_t i, n = 0, off;
+
+    assert(elements != NULL || elemCount == 0);
+    assert((set != NULL && values != NULL) || elemCount == 0);
+
+    for (i = 0; i < elemCount; i++) {
+        if (elements[i].dataLen > 0) set[n++] = &elements[i];
+    }
+
+    if (n > 1) qsort(set, n, sizeof(*set), _BRBlockFilterElementCompare);
+
+    for (i = 0, elemCount = n, n = 0; i < elemCount; i++) {
+        if (n == 0 || _BRBlockFilterElementCompare(&set[n - 1], &set[i]) != 0) set[n++] = set[i];
+    }
+
+    f = (uint64_t)n*BLOCK_FILTER_BASIC_M;
+    for (i = 0; i < n; i++) values[i] = _BRBlockFilterHashToRange(blockHash.u8, set[i]->data, set[i]->dataLen, f);
+    if (n > 1) qsort(values, n, sizeof(*values), _BRUInt64Compare);
+    off = BRVarIntSize(n);
+
+    if (filter && off <= filterLen) {
+        BRVarIntSet(filter, filterLen, n);
+        memset(&filter[off], 0, filterLen - off);
+        s.buf = &filter[off];
+        s.len = filterLen - off;
+    }
+
+    for (i = 0; i < n; i++) {
+        _BRGolombEncode(&s, values[i] - last);
+        last = values[i];
+    }
+
+    if (set) free(set);
+    if (values) free(values);
+    off += (s.bit + 7)/8;
+    return (! filter || off <= filterLen) ? off : 0;
+}
+
+// true if the serialized basic filter for blockHash matches any of elements, false positives occur with a probability
+// of 1/BLOCK_FILTER_BASIC_M per element
+int BRBlockFilterMatchAny(const uint8_t *filter, size_t filterLen, UInt256 blockHash,
+                          const BRBlockFilterElement elements[], size_t elemCount)
+{
+    uint64_t _queries[FILTER_STACK_ELEMENTS], *queries = _queries, n, f, value = 0, delta;
+    _BRBitStream s = { NULL, filter, 0, 0 };
+    size_t i, j, off = 0, count = 0;
+    int r = 0;
+
+    assert(filter != NULL || filterLen == 0);
+    assert(elements != NULL || elemCount == 0);
+    n = BRVarInt(filter, filterLen, &off);
+    if (n == 0 || off == 0 || elemCount == 0) return 0;
+    if (n > (filterLen - off)*8/(BLOCK_FILTER_BASIC_P + 1)) return 0; // each value takes at least P + 1 bits
+    if (elemCount > FILTER_STACK_ELEMENTS) queries = malloc(elemCount*sizeof(*queries));
+    assert(queries != NULL);
+    s.rbuf = &filter[off];
+    s.len = filterLen - off;
+    f = n*BLOCK_FILTER_BASIC_M;
+
+    for (i = 0; i < elemCount; i++) {
+        if (elements[i].dataLen == 0) continue;
+        queries[count++] = _BRBlockFilterHashToRange(blockHash.u8, elements[i].data, elements[i].dataLen, f);
+    }
+
+    if (count > 1) qsort(queries, count, sizeof(*queries), _BRUInt64Compare);
+
+    // walk the sorted filter values and queries together, stopping at the first value they have in common
+    for (i = 0, j = 0; ! r && i < n && j < count && _BRGolombDecode(&s, &delta); i++) {
+        value += delta;
+        while (j < count && queries[j] < value) j++;
+        if (j < count && queries[j] == value) r = 1;
+    }
+
+    if (queries != _queries) free(queries);
+    return r;
+}
+
+// hash of a serialized filter, as committed to by its filter header
+UInt256 BRBlockFilterHash(const uint8_t *filter, size_t filterLen)
+{
+    UInt256 md;
+
+    assert(filter != NULL || filterLen == 0);
+    BRSHA256_2(&md, filter, filterLen);
+    return md;
+}
+
+// filter header for filterHash, chained to the filter header of the previous block
+UInt256 BRBlockFilterHeader(UInt256 filterHash, UInt256 prevHeader)
+{
+    UInt256 md, buf[2] = { filterHash, prevHeader };
+
+    BRSHA256_2(&md, buf, sizeof(buf));
+    return md;
+}
@@ -0,0 +1,58 @@
+//
+//  BRBlockFilter.h
+//  BRCore
+//
+//  Copyright © 2026 Breadwallet AG. All rights reserved.
+//
+//  See the LICENSE file at the project root for license information.
+//  See the CONTRIBUTORS file at the project root for a list of contributors.
+//
+
+#ifndef BRBlockFilter_h
+#define BRBlockFilter_h
+
+#include "BRInt.h"
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// BIP158 compact block filters: https://github.com/bitcoin/bips/blob/master/bip-0158.mediawiki
+//
+// A basic block filter is a golomb-rice coded set of the output scripts created in a block, and the output scripts
+// spent by its inputs, each hashed to a range N*M with SipHash keyed by the first 16 bytes of the block hash. Filters
+// are committed to by a chain of filter headers, header = sha256d(sha256d(filter) || previous header) (BIP157).
+
+#define BLOCK_FILTER_TYPE_BASIC 0x00
+#define BLOCK_FILTER_BASIC_P    19     // golomb-rice coding parameter
+#define BLOCK_FILTER_BASIC_M    784931 // inverse of the false positive rate
+
+// an element of a block filter, such as an output script
+typedef struct {
+    const uint8_t *data;
+    size_t dataLen;
+} BRBlockFilterElement;
+
+// writes a serialized basic filter for blockHash containing elements to filter, duplicate and empty elements are skipped
+// returns the number of bytes written, or the total filterLen needed if filter is NULL
+size_t BRBlockFilterBuild(uint8_t *filter, size_t filterLen, UInt256 blockHash, const BRBlockFilterElement elements[],
+                          size_t elemCount);
+
+// true if the serialized basic filter for blockHash matches any of elements, false positives occur with a probability
+// of 1/BLOCK_FILTER_BASIC_M per element
+int BRBlockFilterMatchAny(const uint8_t *filter, size_t filterLen, UInt256 blockHash,
+                          const BRBlockFilterElement elements[], size_t elemCount);
+
+// hash of a serialized filter, as committed to by its filter header
+UInt256 BRBlockFilterHash(const uint8_t *filter, size_t filterLen);
+
+// filter header for filterHash, chained to the filter header of the previous block
+UInt256 BRBlockFilterHeader(UInt256 filterHash, UInt256 prevHeader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRBlockFilter_h
@@ -50,6 +50,7 @@ typedef struct {
     uint32_t magicNumber;
     uint64_t services;
     int (*verifyDifficulty)(const BRMerkleBlock *block, const BRSet *blockSet); // blockSet must have last 2016 blocks
+    uint32_t maxProofOfWork; // highest difficulty target a block header may have
     const BRCheckPoint *checkpoints;
     size_t checkpointsCount;
     BRAddressParams addrParams;
@@ -0,0 +1,412 @@
+//
+//  BRHeaderStore.c
+//  BRCore
+//
+//  Copyright © 2026 Breadwallet AG. All rights reserved.
+//
+//  See the LICENSE file at the project root for license information.
+//  See the CONTRIBUTORS file at the project root for a list of contributors.
+//
+
+#include "BRHeaderStore.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define HEADER_STORE_MAGIC        0x53485242 // "BRHS" as stored, little-endian
+#define HEADER_STORE_VERSION      1
+#define HEADER_STORE_FILE_HEADER  32  // magic, version, record size, first height, count, reserved
+#define HEADER_STORE_RECORD_SIZE  152 // header, block hash, height, reserved, chain work
+#define HEADER_STORE_GROW_COUNT   (8*BLOCK_DIFFICULTY_INTERVAL) // records added to the file each time it fills up
+
+// offsets into a record
+#define RECORD_HEADER    0
+#define RECORD_HASH      80
+#define RECORD_HEIGHT    112
+#define RECORD_WORK      120
+
+struct BRHeaderStoreStruct {
+    int fd;
+    uint8_t *map;
+    size_t mapLen, capacity, count;
+    uint32_t firstHeight;
+    uint32_t *index; // open addressed hash table of record number + 1, zero for an empty slot
+    size_t indexSize; // always a power of two
+};
+
+/// MARK: - 256 Bit Arithmetic
+
+// chain work is kept as four little-endian 64 bit limbs, least significant first
+
+inline static void _work256Add(uint64_t r[4], const uint64_t a[4])
+{
+    uint64_t carry = 0;
+
+    for (int i = 0; i < 4; i++) {
+        uint64_t s = r[i] + a[i], c = (s < r[i]);
+
+        r[i] = s + carry;
+        carry = c | (r[i] < s);
+    }
+}
+
+// work for a block with compact difficulty target, 2^256/(target + 1), computed as ~target/(target + 1) + 1
+static void _work256ForTarget(uint64_t work[4], uint32_t compact)
+{
+    const uint32_t size = compact >> 24, mantissa = compact & 0x007fffff;
+    uint64_t target[4] = { 0, 0, 0, 0 }, n[4], d[4], r[4] = { 0, 0, 0, 0 }, one[4] = { 1, 0, 0, 0 };
+    int i, bit;
+
+    memset(work, 0, 4*sizeof(*work));
+    if (mantissa == 0 || (compact & 0x00800000) || size > 32) return; // zero, negative or overflowing target
+
+    if (size <= 3) target[0] = mantissa >> 8*(3 - size);
+    else {
+        bit = 8*(size - 3);
+        target[bit/64] = (uint64_t)mantissa << (bit % 64);
+        if (bit % 64 > 40 && bit/64 < 3) target[bit/64 + 1] = (uint64_t)mantissa >> (64 - bit % 64);
+    }
+
+    for (i = 0; i < 4; i++) n[i] = ~target[i], d[i] = target[i];
+    _work256Add(d, one);
+
+    // binary long division of n by d
+    for (bit = 255; bit >= 0; bit--) {
+        uint64_t carry = r[3] >> 63;
+
+        for (i = 3; i > 0; i--) r[i] = (r[i] << 1) | (r[i - 1] >> 63);
+        r[0] = (r[0] << 1) | ((n[bit/64] >> (bit % 64)) & 1);
+
+        for (i = 3; i > 0 && r[i] == d[i]; i--);
+
+        if (carry || r[i] >= d[i]) {
+            uint64_t borrow = 0;
+
+            for (i = 0; i < 4; i++) {
+                uint64_t s = r[i] - d[i] - borrow;
+
+                borrow = (r[i] < d[i]) || (r[i] - d[i] < borrow);
+                r[i] = s;
+            }
+
+            work[bit/64] |= (uint64_t)1 << (bit % 64);
+        }
+    }
+
+    _work256Add(work, one);
+}
+
+/// MARK: - Records
+
+inline static uint8_t *_BRHeaderStoreRecord(const BRHeaderStore *store, size_t idx)
+{
+    return &store->map[HEADER_STORE_FILE_HEADER + idx*HEADER_STORE_RECORD_SIZE];
+}
+
+inline static UInt256 _BRHeaderStoreRecordHash(const BRHeaderStore *store, size_t idx)
+{
+    return UInt256Get(&_BRHeaderStoreRecord(store, idx)[RECORD_HASH]);
+}
+
+static void _BRHeaderStoreRecordWork(const BRHeaderStore *store, size_t idx, uint64_t work[4])
+{
+    const uint8_t *record = _BRHeaderStoreRecord(store, idx);
+
+    for (int i = 0; i < 4; i++) work[i] = UInt64GetLE(&record[RECORD_WORK + i*sizeof(uint64_t)]);
+}
+
+// writes the first height and count to the file header, after the records they cover have been written
+static void _BRHeaderStoreSync(BRHeaderStore *store)
+{
+    UInt32SetLE(&store->map[12], store->firstHeight);
+    UInt32SetLE(&store->map[16], (uint32_t)store->count);
+}
+
+// grows the file and remaps it so it can hold at least capacity records, returns true on success
+static int _BRHeaderStoreReserve(BRHeaderStore *store, size_t capacity)
+{
+    size_t len = HEADER_STORE_FILE_HEADER + capacity*HEADER_STORE_RECORD_SIZE;
+    uint8_t *map;
+
+    if (capacity <= store->capacity) return 1;
+    if (ftruncate(store->fd, (off_t)len) != 0) return 0;
+    map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+    if (map == MAP_FAILED) return 0;
+    if (store->map) munmap(store->map, store->mapLen);
+    store->map = map;
+    store->mapLen = len;
+    store->capacity = capacity;
+    return 1;
+}
+
+/// MARK: - Hash Index
+
+inline static size_t _BRHeaderStoreIndexSlot(const BRHeaderStore *store, UInt256 blockHash)
+{
+    return (size_t)blockHash.u32[0] & (store->indexSize - 1);
+}
+
+// returns the index slot holding the record with blockHash, or the empty slot where it would go
+static size_t _BRHeaderStoreIndexFind(const BRHeaderStore *store, UInt256 blockHash)
+{
+    size_t i = _BRHeaderStoreIndexSlot(store, blockHash);
+
+    while (store->index[i] != 0 && ! UInt256Eq(_BRHeaderStoreRecordHash(store, store->index[i] - 1), blockHash)) {
+        i = (i + 1) & (store->indexSize - 1);
+    }
+
+    return i;
+}
+
+static void _BRHeaderStoreIndexAdd(BRHeaderStore *store, size_t idx)
+{
+    store->index[_BRHeaderStoreIndexFind(store, _BRHeaderStoreRecordHash(store, idx))] = (uint32_t)(idx + 1);
+}
+
+// removes the record at idx, shifting back any later entries in its probe sequence to keep lookups correct
+static void _BRHeaderStoreIndexRemove(BRHeaderStore *store, size_t idx)
+{
+    size_t i = _BRHeaderStoreIndexFind(store, _BRHeaderStoreRecordHash(store, idx)), j = i, k,
+           mask = store->indexSize - 1;
+
+    if (store->index[i] != idx + 1) return;
+
+    while (store->index[j = (j + 1) & mask] != 0) {
+        k = _BRHeaderStoreIndexSlot(store, _BRHeaderStoreRecordHash(store, store->index[j] - 1));
+
+        // move the entry at j into the hole at i unless its home slot k lies cyclically in (i, j]
+        if ((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+            store->index[i] = store->index[j];
+            i = j;
+        }
+    }
+
+    store->index[i] = 0;
+}
+
+// resizes the index to keep it at most half full with count records
+static void _BRHeaderStoreIndexResize(BRHeaderStore *store, size_t count)
+{
+    size_t size = 1024;
+
+    while (size < count*2) size *= 2;
+    if (size == store->indexSize) return;
+
+    free(store->index);
+    store->index = calloc(size, sizeof(*store->index));
+    assert(store->index != NULL);
+    store->indexSize = size;
+    for (size_t i = 0; i < store->count; i++) _BRHeaderStoreIndexAdd(store, i);
+}
+
+/// MARK: - Store
+
+// opens (creating if needed) the header store at path, returns NULL if the file can't be opened or isn't a header store
+// the returned store must be closed by calling BRHeaderStoreClose()
+BRHeaderStore *BRHeaderStoreOpen(const char *path)
+{
+    BRHeaderStore *store = calloc(1, sizeof(*store));
+    struct stat st;
+    size_t count = 0;
+
+    assert(store != NULL);
+    assert(path != NULL);
+    store->fd = open(path, O_RDWR | O_CREAT, 0600);
+
+    if (store->fd < 0 || fstat(store->fd, &st) != 0) {
+        if (store->fd >= 0) close(store->fd);
+        free(store);
+        return NULL;
+    }
+
+    if (st.st_size == 0) { // new store
+        if (! _BRHeaderStoreReserve(store, HEADER_STORE_GROW_COUNT)) {
+            BRHeaderStoreClose(store);
+            return NULL;
+        }
+
+        UInt32SetLE(&store->map[0], HEADER_STORE_MAGIC);
+        UInt32SetLE(&store->map[4], HEADER_STORE_VERSION);
+        UInt32SetLE(&store->map[8], HEADER_STORE_RECORD_SIZE);
+        _BRHeaderStoreSync(store);
+    }
+    else if (st.st_size < HEADER_STORE_FILE_HEADER + HEADER_STORE_RECORD_SIZE ||
+             ! _BRHeaderStoreReserve(store, ((size_t)st.st_size - HEADER_STORE_FILE_HEADER)/HEADER_STORE_RECORD_SIZE) ||
+             UInt32GetLE(&store->map[0]) != HEADER_STORE_MAGIC ||
+             UInt32GetLE(&store->map[4]) != HEADER_STORE_VERSION ||
+             UInt32GetLE(&store->map[8]) != HEADER_STORE_RECORD_SIZE) {
+        BRHeaderStoreClose(store);
+        return NULL;
+    }
+    else {
+        store->firstHeight = UInt32GetLE(&store->map[12]);
+        count = UInt32GetLE(&store->map[16]);
+        store->count = (count < store->capacity) ? count : store->capacity; // truncated file, keep the whole records
+    }
+
+    _BRHeaderStoreIndexResize(store, store->count);
+    return store;
+}
+
+// number of headers in the store
+size_t BRHeaderStoreCount(const BRHeaderStore *store)
+{
+    assert(store != NULL);
+    return store->count;
+}
+
+// height of the first header in the store, or BLOCK_UNKNOWN_HEIGHT if the store is empty
+uint32_t BRHeaderStoreFirstHeight(const BRHeaderStore *store)
+{
+    assert(store != NULL);
+    return (store->count > 0) ? store->firstHeight : BLOCK_UNKNOWN_HEIGHT;
+}
+
+// height of the last header in the store, or BLOCK_UNKNOWN_HEIGHT if the store is empty
+uint32_t BRHeaderStoreLastHeight(const BRHeaderStore *store)
+{
+    assert(store != NULL);
+    return (store->count > 0) ? store->firstHeight + (uint32_t)store->count - 1 : BLOCK_UNKNOWN_HEIGHT;
+}
+
+// appends block's header at block->height, discarding any stored headers at or above that height that it replaces
+// the first header stored may be at any height, after that block->prevBlock must match the header at height - 1
+// returns true on success
+int BRHeaderStoreAdd(BRHeaderStore *store, const BRMerkleBlock *block)
+{
+    BRMerkleBlock header;
+    uint64_t work[4], prevWork[4] = { 0, 0, 0, 0 };
+    uint8_t *record;
+    size_t idx;
+
+    assert(store != NULL);
+    assert(block != NULL);
+    if (block->height == BLOCK_UNKNOWN_HEIGHT) return 0;
+
+    if (store->count > 0) {
+        if (block->height < store->firstHeight || block->height > store->firstHeight + store->count) return 0;
+        idx = block->height - store->firstHeight;
+        if (idx < store->count && UInt256Eq(_BRHeaderStoreRecordHash(store, idx), block->blockHash)) return 1;
+        if (idx > 0 && ! UInt256Eq(_BRHeaderStoreRecordHash(store, idx - 1), block->prevBlock)) return 0;
+        BRHeaderStoreTruncate(store, block->height);
+    }
+
+    if (store->count == 0) store->firstHeight = block->height;
+    idx = store->count;
+    if (! _BRHeaderStoreReserve(store, (idx < store->capacity) ? store->capacity : idx + HEADER_STORE_GROW_COUNT)) {
+        return 0;
+    }
+
+    if (idx > 0) _BRHeaderStoreRecordWork(store, idx - 1, prevWork);
+    _work256ForTarget(work, block->target);
+    _work256Add(work, prevWork);
+
+    header = *block;
+    header.totalTx = 0; // only the 80 byte header is stored
+    record = _BRHeaderStoreRecord(store, idx);
+    memset(record, 0, HEADER_STORE_RECORD_SIZE);
+    BRMerkleBlockSerialize(&header, &record[RECORD_HEADER], 80);
+    UInt256Set(&record[RECORD_HASH], block->blockHash);
+    UInt32SetLE(&record[RECORD_HEIGHT], block->height);
+    for (int i = 0; i < 4; i++) UInt64SetLE(&record[RECORD_WORK + i*sizeof(uint64_t)], work[i]);
+
+    store->count++;
+    if (store->count*2 > store->indexSize) _BRHeaderStoreIndexResize(store, store->count);
+    else _BRHeaderStoreIndexAdd(store, idx);
+    _BRHeaderStoreSync(store);
+    return 1;
+}
+
+// discards all headers at or above height
+void BRHeaderStoreTruncate(BRHeaderStore *store, uint32_t height)
+{
+    size_t count;
+
+    assert(store != NULL);
+    count = (height > store->firstHeight) ? height - store->firstHeight : 0;
+
+    while (store->count > count) {
+        _BRHeaderStoreIndexRemove(store, store->count - 1);
+        store->count--;
+    }
+
+    _BRHeaderStoreSync(store);
+}
+
+// hash of the header at height, or UINT256_ZERO if there isn't one
+UInt256 BRHeaderStoreHashAtHeight(const BRHeaderStore *store, uint32_t height)
+{
+    assert(store != NULL);
+    if (height < store->firstHeight || height - store->firstHeight >= store->count) return UINT256_ZERO;
+    return _BRHeaderStoreRecordHash(store, height - store->firstHeight);
+}
+
+// height of the header with blockHash, or BLOCK_UNKNOWN_HEIGHT if there isn't one
+uint32_t BRHeaderStoreHeightForHash(const BRHeaderStore *store, UInt256 blockHash)
+{
+    size_t i;
+
+    assert(store != NULL);
+    i = _BRHeaderStoreIndexFind(store, blockHash);
+    return (store->index[i] != 0) ? store->firstHeight + store->index[i] - 1 : BLOCK_UNKNOWN_HEIGHT;
+}
+
+// cumulative chain work, as a little-endian 256 bit number, of the header at height counted from the first stored
+// header, or UINT256_ZERO if there isn't one (the work for a header is 2^256/(target + 1), the expected number of
+// hashes needed to find it)
+UInt256 BRHeaderStoreChainWork(const BRHeaderStore *store, uint32_t height)
+{
+    UInt256 work = UINT256_ZERO;
+
+    assert(store != NULL);
+
+    if (height >= store->firstHeight && height - store->firstHeight < store->count) {
+        memcpy(work.u8, &_BRHeaderStoreRecord(store, height - store->firstHeight)[RECORD_WORK], sizeof(work));
+    }
+
+    return work;
+}
+
+// returns a newly allocated header-only merkle block for the header at height, or NULL if there isn't one
+// result must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRHeaderStoreBlockAtHeight(const BRHeaderStore *store, uint32_t height)
+{
+    BRMerkleBlock *block = NULL;
+
+    assert(store != NULL);
+
+    if (height >= store->firstHeight && height - store->firstHeight < store->count) {
+        block = BRMerkleBlockParse(&_BRHeaderStoreRecord(store, height - store->firstHeight)[RECORD_HEADER], 80);
+        if (block) block->height = height;
+    }
+
+    return block;
+}
+
+// returns a newly allocated header-only merkle block for the header with blockHash, or NULL if there isn't one
+// result must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRHeaderStoreBlockForHash(const BRHeaderStore *store, UInt256 blockHash)
+{
+    uint32_t height = BRHeaderStoreHeightForHash(store, blockHash);
+
+    return (height != BLOCK_UNKNOWN_HEIGHT) ? BRHeaderStoreBlockAtHeight(store, height) : NULL;
+}
+
+// flushes the store to disk and releases all resources
+void BRHeaderStoreClose(BRHeaderStore *store)
+{
+    assert(store != NULL);
+
+    if (store->map) {
+        msync(store->map, store->mapLen, MS_SYNC);
+        munmap(store->map, store->mapLen);
+    }
+
+    if (store->fd >= 0) close(store->fd);
+    if (store->index) free(store->index);
+    free(store);
+}
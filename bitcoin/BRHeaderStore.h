@@ -0,0 +1,77 @@
+//
+//  BRHeaderStore.h
+//  BRCore
+//
+//  Copyright © 2026 Breadwallet AG. All rights reserved.
+//
+//  See the LICENSE file at the project root for license information.
+//  See the CONTRIBUTORS file at the project root for a list of contributors.
+//
+
+#ifndef BRHeaderStore_h
+#define BRHeaderStore_h
+
+#include "BRMerkleBlock.h"
+#include "BRInt.h"
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// An append-only, memory-mapped file of fixed size block header records (80 byte header, block hash, height and
+// cumulative chain work), one per height for a single chain starting at the first height stored. Headers are indexed
+// by height directly and by hash through an in-memory table that is rebuilt when the store is opened.
+//
+// A header store is not thread-safe; callers must serialize access to it.
+typedef struct BRHeaderStoreStruct BRHeaderStore;
+
+// opens (creating if needed) the header store at path, returns NULL if the file can't be opened or isn't a header store
+// the returned store must be closed by calling BRHeaderStoreClose()
+BRHeaderStore *BRHeaderStoreOpen(const char *path);
+
+// number of headers in the store
+size_t BRHeaderStoreCount(const BRHeaderStore *store);
+
+// height of the first header in the store, or BLOCK_UNKNOWN_HEIGHT if the store is empty
+uint32_t BRHeaderStoreFirstHeight(const BRHeaderStore *store);
+
+// height of the last header in the store, or BLOCK_UNKNOWN_HEIGHT if the store is empty
+uint32_t BRHeaderStoreLastHeight(const BRHeaderStore *store);
+
+// appends block's header at block->height, discarding any stored headers at or above that height that it replaces
+// the first header stored may be at any height, after that block->prevBlock must match the header at height - 1
+// returns true on success
+int BRHeaderStoreAdd(BRHeaderStore *store, const BRMerkleBlock *block);
+
+// discards all headers at or above height
+void BRHeaderStoreTruncate(BRHeaderStore *store, uint32_t height);
+
+// hash of the header at height, or UINT256_ZERO if there isn't one
+UInt256 BRHeaderStoreHashAtHeight(const BRHeaderStore *store, uint32_t height);
+
+// height of the header with blockHash, or BLOCK_UNKNOWN_HEIGHT if there isn't one
+uint32_t BRHeaderStoreHeightForHash(const BRHeaderStore *store, UInt256 blockHash);
+
+// cumulative chain work, as a little-endian 256 bit number, of the header at height counted from the first stored
+// header, or UINT256_ZERO if there isn't one (the work for a header is 2^256/(target + 1), the expected number of
+// hashes needed to find it)
+UInt256 BRHeaderStoreChainWork(const BRHeaderStore *store, uint32_t height);
+
+// returns a newly allocated header-only merkle block for the header at height, or NULL if there isn't one
+// result must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRHeaderStoreBlockAtHeight(const BRHeaderStore *store, uint32_t height);
+
+// returns a newly allocated header-only merkle block for the header with blockHash, or NULL if there isn't one
+// result must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRHeaderStoreBlockForHash(const BRHeaderStore *store, UInt256 blockHash);
+
+// flushes the store to disk and releases all resources
+void BRHeaderStoreClose(BRHeaderStore *store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRHeaderStore_h
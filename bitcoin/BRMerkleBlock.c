@@ -32,17 +32,8 @@
 #include <string.h>
 #include <assert.h>
 
-#define MAX_PROOF_OF_WORK 0x1d00ffff    // highest value for difficulty target (higher values are less difficult)
 #define TARGET_TIMESPAN   (14*24*60*60) // the targeted timespan between difficulty target adjustments
 
-inline static int _ceil_log2(int x)
-{
-    int r = (x & (x - 1)) ? 1 : 0;
-    
-    while ((x >>= 1) != 0) r++;
-    return r;
-}
-
 // from https://en.bitcoin.it/wiki/Protocol_specification#Merkle_Trees
 // Merkle trees are binary trees of hashes. Merkle trees in bitcoin use a double SHA-256, the SHA-256 hash of the
 // SHA-256 hash of something. If, when forming a row in the tree (other than the root of the tree), it would have an odd
@@ -101,53 +92,120 @@ BRMerkleBlock *BRMerkleBlockCopy(const BRMerkleBlock *block)
 // returns a merkle block struct that must be freed by calling BRMerkleBlockFree()
 BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen)
 {
-    BRMerkleBlock *block = (buf && 80 <= bufLen) ? BRMerkleBlockNew() : NULL;
-    size_t off = 0, len = 0;
+    BRMerkleBlockView view;
     
     assert(buf != NULL || bufLen == 0);
+    return (BRMerkleBlockViewParse(&view, buf, bufLen) > 0) ? BRMerkleBlockViewCopy(&view) : NULL;
+}
+
+// parses everything but the block hash
+static size_t _BRMerkleBlockViewParse(BRMerkleBlockView *view, const uint8_t *buf, size_t bufLen)
+{
+    size_t off = 0, len = 0;
     
-    if (block) {
-        block->version = UInt32GetLE(&buf[off]);
-        off += sizeof(uint32_t);
-        block->prevBlock = UInt256Get(&buf[off]);
-        off += sizeof(UInt256);
-        block->merkleRoot = UInt256Get(&buf[off]);
-        off += sizeof(UInt256);
-        block->timestamp = UInt32GetLE(&buf[off]);
-        off += sizeof(uint32_t);
-        block->target = UInt32GetLE(&buf[off]);
-        off += sizeof(uint32_t);
-        block->nonce = UInt32GetLE(&buf[off]);
+    assert(view != NULL);
+    assert(buf != NULL || bufLen == 0);
+    if (! buf || bufLen < 80) return 0;
+    
+    memset(view, 0, sizeof(*view));
+    view->version = UInt32GetLE(&buf[off]);
+    off += sizeof(uint32_t);
+    view->prevBlock = UInt256Get(&buf[off]);
+    off += sizeof(UInt256);
+    view->merkleRoot = UInt256Get(&buf[off]);
+    off += sizeof(UInt256);
+    view->timestamp = UInt32GetLE(&buf[off]);
+    off += sizeof(uint32_t);
+    view->target = UInt32GetLE(&buf[off]);
+    off += sizeof(uint32_t);
+    view->nonce = UInt32GetLE(&buf[off]);
+    off += sizeof(uint32_t);
+    
+    if (off + sizeof(uint32_t) <= bufLen) {
+        view->totalTx = UInt32GetLE(&buf[off]);
         off += sizeof(uint32_t);
-        
-        if (off + sizeof(uint32_t) <= bufLen) {
-            block->totalTx = UInt32GetLE(&buf[off]);
-            off += sizeof(uint32_t);
-            block->hashesCount = (size_t)BRVarInt(&buf[off], (off <= bufLen ? bufLen - off : 0), &len);
-            off += len;
-            len = block->hashesCount*sizeof(UInt256);
-            block->hashes = (off + len <= bufLen) ? malloc(len) : NULL;
-            if (block->hashes) memcpy(block->hashes, &buf[off], len);
-            off += len;
-            block->flagsLen = (size_t)BRVarInt(&buf[off], (off <= bufLen ? bufLen - off : 0), &len);
-            off += len;
-            len = block->flagsLen;
-            block->flags = (off + len <= bufLen) ? malloc(len) : NULL;
-            if (block->flags) memcpy(block->flags, &buf[off], len);
-            off += len;
-        }
-        
-        BRSHA256_2(&block->blockHash, buf, 80);
+        view->hashesCount = (size_t)BRVarInt(&buf[off], (off <= bufLen ? bufLen - off : 0), &len);
+        off += len;
+        len = view->hashesCount*sizeof(UInt256);
+        if (len/sizeof(UInt256) != view->hashesCount || off + len > bufLen) return 0;
+        view->hashes = &buf[off];
+        off += len;
+        view->flagsLen = (size_t)BRVarInt(&buf[off], (off <= bufLen ? bufLen - off : 0), &len);
+        off += len;
+        len = view->flagsLen;
+        if (off + len > bufLen) return 0;
+        view->flags = &buf[off];
+        off += len;
+    }
+    
+    return off;
+}
 
-        if (off > bufLen) {
-            BRMerkleBlockFree(block);
-            block = NULL;
+// parses a serialized merkleblock or header in place, without allocating or copying the hashes and flags
+// returns number of bytes parsed, or zero if buf doesn't contain a valid serialization
+size_t BRMerkleBlockViewParse(BRMerkleBlockView *view, const uint8_t *buf, size_t bufLen)
+{
+    size_t off = _BRMerkleBlockViewParse(view, buf, bufLen);
+    
+    if (off > 0) BRSHA256_2(&view->blockHash, buf, 80);
+    return off;
+}
+
+// parses viewsCount consecutive 81 byte headers, as serialized in a headers message, hashing them as a batch
+// returns number of bytes parsed, or zero if buf doesn't contain viewsCount headers
+size_t BRMerkleBlockViewParseHeaders(BRMerkleBlockView views[], size_t viewsCount, const uint8_t *buf, size_t bufLen)
+{
+    UInt256 hashes[64];
+    size_t i, j, n;
+    
+    assert(views != NULL || viewsCount == 0);
+    assert(buf != NULL || bufLen == 0);
+    if (! buf || bufLen/81 < viewsCount) return 0;
+    
+    for (i = 0; i < viewsCount; i += n) {
+        n = (viewsCount - i < sizeof(hashes)/sizeof(*hashes)) ? viewsCount - i : sizeof(hashes)/sizeof(*hashes);
+        BRSHA256_2Batch(hashes, &buf[i*81], 80, 81, n);
+        
+        for (j = 0; j < n; j++) {
+            _BRMerkleBlockViewParse(&views[i + j], &buf[(i + j)*81], 81);
+            views[i + j].blockHash = hashes[j];
         }
     }
     
+    return viewsCount*81;
+}
+
+// returns a newly allocated merkle block with a copy of view's data that must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRMerkleBlockViewCopy(const BRMerkleBlockView *view)
+{
+    BRMerkleBlock *block = BRMerkleBlockNew();
+    
+    assert(view != NULL);
+    block->blockHash = view->blockHash;
+    block->version = view->version;
+    block->prevBlock = view->prevBlock;
+    block->merkleRoot = view->merkleRoot;
+    block->timestamp = view->timestamp;
+    block->target = view->target;
+    block->nonce = view->nonce;
+    block->totalTx = view->totalTx;
+    block->hashes = (view->hashesCount > 0) ? malloc(view->hashesCount*sizeof(UInt256)) : NULL;
+    if (block->hashes) memcpy(block->hashes, view->hashes, view->hashesCount*sizeof(UInt256));
+    block->hashesCount = view->hashesCount;
+    block->flags = (view->flagsLen > 0) ? malloc(view->flagsLen) : NULL;
+    if (block->flags) memcpy(block->flags, view->flags, view->flagsLen);
+    block->flagsLen = view->flagsLen;
     return block;
 }
 
+// a view over an owned block's hashes and flags, so both share the tree walking code below
+static BRMerkleBlockView _BRMerkleBlockView(const BRMerkleBlock *block)
+{
+    return (BRMerkleBlockView) { block->blockHash, block->version, block->prevBlock, block->merkleRoot,
+                                 block->timestamp, block->target, block->nonce, block->totalTx,
+                                 (const uint8_t *)block->hashes, block->hashesCount, block->flags, block->flagsLen };
+}
+
 // returns number of bytes written to buf, or total bufLen needed if buf is NULL (block->height is not serialized)
 size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t bufLen)
 {
@@ -189,41 +247,155 @@ size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t b
     return (! buf || len <= bufLen) ? len : 0;
 }
 
-static size_t _BRMerkleBlockTxHashesR(const BRMerkleBlock *block, UInt256 *txHashes, size_t hashesCount, size_t *idx,
-                                      size_t *hashIdx, size_t *flagIdx, int depth)
+// state of an iterative depth-first walk over a partial merkle tree
+typedef struct {
+    const BRMerkleBlockView *block;
+    size_t widths[33], hashIdx, flagIdx, sp;
+    struct { int depth; size_t pos; } stack[34];
+    int height;
+} _BRMerkleWalk;
+
+static void _BRMerkleWalkInit(_BRMerkleWalk *walk, const BRMerkleBlockView *block)
+{
+    walk->block = block;
+    walk->hashIdx = walk->flagIdx = 0;
+    for (walk->height = 0; ((uint64_t)1 << walk->height) < block->totalTx; walk->height++);
+    walk->widths[walk->height] = block->totalTx;
+    for (int i = walk->height; i > 0; i--) walk->widths[i - 1] = (walk->widths[i] + 1)/2;
+    walk->stack[0].depth = 0, walk->stack[0].pos = 0;
+    walk->sp = (block->totalTx > 0) ? 1 : 0;
+}
+
+// advances walk to the next node in depth-first order, setting depth, whether it's a parent of a matched tx, and if not,
+// hash to its hash in the block and matched to whether it's a matched tx
+// returns false at the end of the tree, or if the tree runs out of flags or hashes first (walk->sp is then non-zero)
+static int _BRMerkleWalkNext(_BRMerkleWalk *walk, int *depth, int *parent, const uint8_t **hash, int *matched)
+{
+    const BRMerkleBlockView *block = walk->block;
+    size_t pos;
+    int flag;
+    
+    if (walk->sp == 0 || walk->flagIdx/8 >= block->flagsLen) return 0;
+    walk->sp--;
+    *depth = walk->stack[walk->sp].depth, pos = walk->stack[walk->sp].pos;
+    flag = (block->flags[walk->flagIdx/8] & (1 << (walk->flagIdx % 8))) != 0;
+    *parent = (flag && *depth < walk->height);
+    *matched = (flag && ! *parent);
+    
+    if (*parent) { // push the right branch, if there is one, under the left so the left is walked first
+        if (pos*2 + 1 < walk->widths[*depth + 1]) {
+            walk->stack[walk->sp].depth = *depth + 1, walk->stack[walk->sp++].pos = pos*2 + 1;
+        }
+        
+        walk->stack[walk->sp].depth = *depth + 1, walk->stack[walk->sp++].pos = pos*2;
+    }
+    else if (walk->hashIdx < block->hashesCount) *hash = &block->hashes[walk->hashIdx++*sizeof(UInt256)];
+    else return walk->sp++, 0;
+    
+    walk->flagIdx++;
+    return 1;
+}
+
+// walks the partial merkle tree once, writing up to hashesCount matched tx hashes to txHashes and the number of them
+// to txCount, then hashes it bottom-up a row at a time, since the children of each row's parents are consecutive in
+// the row below, and can be hashed together as a batch
+// NOTE: this merkle tree design has a security vulnerability (CVE-2012-2459), which can be defended against by
+// considering the merkle root invalid if there are duplicate hashes in any rows with an even number of elements
+// returns the merkle root, or UINT256_ZERO if the tree is malformed
+static UInt256 _BRMerkleBlockRoot(const BRMerkleBlockView *block, UInt256 *txHashes, size_t hashesCount,
+                                  size_t *txCount)
 {
-    uint8_t flag;
+    _BRMerkleWalk walk;
+    UInt256 _rows[256], *rows = _rows, _mds[128], *mds = _mds, md = UINT256_ZERO;
+    uint8_t _parents[256], *parents = _parents;
+    const uint8_t *hash = NULL;
+    size_t counts[33] = { 0 }, ends[33], i, j, k, n = 0, idx = 0;
+    int d, depth, parent, matched, r = 1;
+    
+    // count the nodes in each row, then walk again to lay the rows out one after another in depth-first order
+    for (_BRMerkleWalkInit(&walk, block); _BRMerkleWalkNext(&walk, &depth, &parent, &hash, &matched);) counts[depth]++;
+    if (block->totalTx == 0 || walk.sp != 0 || walk.hashIdx != block->hashesCount) r = 0;
+    if ((walk.flagIdx + 7)/8 != block->flagsLen) r = 0; // only padding may follow the last flag
+    for (d = 0; r && d <= walk.height; d++) ends[d] = n, n += counts[d];
+    
+    if (r && n > sizeof(_rows)/sizeof(*_rows)) {
+        rows = malloc(n*sizeof(*rows));
+        parents = malloc(n);
+        mds = malloc((n + 1)/2*sizeof(*mds));
+        assert(rows != NULL && parents != NULL && mds != NULL);
+    }
     
-    if (*flagIdx/8 < block->flagsLen && *hashIdx < block->hashesCount) {
-        flag = (block->flags[*flagIdx/8] & (1 << (*flagIdx % 8)));
-        (*flagIdx)++;
+    for (_BRMerkleWalkInit(&walk, block); r && _BRMerkleWalkNext(&walk, &depth, &parent, &hash, &matched);) {
+        i = ends[depth]++;
+        parents[i] = (uint8_t)parent;
+        if (! parent) rows[i] = UInt256Get(hash);
+        if (matched && txHashes && idx < hashesCount) txHashes[idx] = rows[i];
+        if (matched) idx++;
+    }
     
-        if (! flag || depth == _ceil_log2(block->totalTx)) {
-            if (flag && *idx < hashesCount) {
-                if (txHashes) txHashes[*idx] = block->hashes[*hashIdx]; // leaf
-                (*idx)++;
-            }
+    for (d = walk.height - 1; r && d >= 0; d--) {
+        const UInt256 *children = &rows[ends[d + 1] - counts[d + 1]];
+        size_t childCount = counts[d + 1], pairs = childCount/2;
+        
+        // hash each complete pair of children, and the last child alone, duplicated, if the row below is odd
+        BRSHA256_2Batch(mds, children, 2*sizeof(UInt256), 2*sizeof(UInt256), pairs);
+        for (j = 0; j < pairs; j++) if (UInt256Eq(children[j*2], children[j*2 + 1])) r = 0; // CVE-2012-2459
         
-            (*hashIdx)++;
+        if (childCount % 2) {
+            UInt256 pair[2] = { children[childCount - 1], children[childCount - 1] };
+            
+            BRSHA256_2(&mds[pairs], pair, sizeof(pair));
         }
-        else {
-            _BRMerkleBlockTxHashesR(block, txHashes, hashesCount, idx, hashIdx, flagIdx, depth + 1); // left branch
-            _BRMerkleBlockTxHashesR(block, txHashes, hashesCount, idx, hashIdx, flagIdx, depth + 1); // right branch
+        
+        for (i = ends[d] - counts[d], k = 0; i < ends[d]; i++) {
+            if (parents[i]) rows[i] = mds[k++];
         }
+        
+        if (k != (childCount + 1)/2) r = 0; // each parent has two children, except possibly the last
     }
-
-    return *idx;
+    
+    if (r) md = rows[0];
+    if (txCount) *txCount = idx;
+    
+    if (rows != _rows) {
+        free(rows);
+        free(parents);
+        free(mds);
+    }
+    
+    return md;
 }
 
 // populates txHashes with the matched tx hashes in the block
 // returns number of hashes written, or the total hashesCount needed if txHashes is NULL
 size_t BRMerkleBlockTxHashes(const BRMerkleBlock *block, UInt256 *txHashes, size_t hashesCount)
 {
-    size_t idx = 0, hashIdx = 0, flagIdx = 0;
-
     assert(block != NULL);
     
-    return _BRMerkleBlockTxHashesR(block, txHashes, (txHashes) ? hashesCount : SIZE_MAX, &idx, &hashIdx, &flagIdx, 0);
+    BRMerkleBlockView view = _BRMerkleBlockView(block);
+    
+    return BRMerkleBlockViewTxHashes(&view, txHashes, hashesCount);
+}
+
+// populates txHashes with the matched tx hashes in the block view
+// returns number of hashes written, or the total hashesCount needed if txHashes is NULL
+size_t BRMerkleBlockViewTxHashes(const BRMerkleBlockView *view, UInt256 *txHashes, size_t hashesCount)
+{
+    _BRMerkleWalk walk;
+    const uint8_t *hash = NULL;
+    size_t idx = 0;
+    int depth, parent, matched;
+
+    assert(view != NULL);
+    
+    for (_BRMerkleWalkInit(&walk, view); _BRMerkleWalkNext(&walk, &depth, &parent, &hash, &matched);) {
+        if (! matched) continue;
+        if (txHashes && idx >= hashesCount) break;
+        if (txHashes) txHashes[idx] = UInt256Get(hash); // leaf
+        idx++;
+    }
+    
+    return idx;
 }
 
 // sets the hashes and flags fields for a block created with BRMerkleBlockNew()
@@ -237,37 +409,85 @@ void BRMerkleBlockSetTxHashes(BRMerkleBlock *block, const UInt256 hashes[], size
     if (block->hashes) free(block->hashes);
     block->hashes = (hashesCount > 0) ? malloc(hashesCount*sizeof(UInt256)) : NULL;
     if (block->hashes) memcpy(block->hashes, hashes, hashesCount*sizeof(UInt256));
+    block->hashesCount = (block->hashes) ? hashesCount : 0;
     if (block->flags) free(block->flags);
     block->flags = (flagsLen > 0) ? malloc(flagsLen) : NULL;
     if (block->flags) memcpy(block->flags, flags, flagsLen);
+    block->flagsLen = (block->flags) ? flagsLen : 0;
 }
 
-// recursively walks the merkle tree to calculate the merkle root
-// NOTE: this merkle tree design has a security vulnerability (CVE-2012-2459), which can be defended against by
-// considering the merkle root invalid if there are duplicate hashes in any rows with an even number of elements
-static UInt256 _BRMerkleBlockRootR(const BRMerkleBlock *block, size_t *hashIdx, size_t *flagIdx, int depth)
+// depth-first traversal of the tree rows in levels, writing a flag bit for each node visited and the hashes of leaves
+// and of nodes that aren't parents of a matched tx
+static void _BRMerkleBlockBuildR(UInt256 **levels, const size_t *widths, const uint8_t *matched, size_t txCount,
+                                 int depth, size_t pos, UInt256 *hashes, size_t *hashIdx, uint8_t *flags, size_t *flagIdx)
 {
-    uint8_t flag;
-    UInt256 hashes[2], md = UINT256_ZERO;
-
-    if (*flagIdx/8 < block->flagsLen && *hashIdx < block->hashesCount) {
-        flag = (block->flags[*flagIdx/8] & (1 << (*flagIdx % 8)));
-        (*flagIdx)++;
-
-        if (flag && depth != _ceil_log2(block->totalTx)) {
-            hashes[0] = _BRMerkleBlockRootR(block, hashIdx, flagIdx, depth + 1); // left branch
-            hashes[1] = _BRMerkleBlockRootR(block, hashIdx, flagIdx, depth + 1); // right branch
-
-            if (! UInt256IsZero(hashes[0]) && ! UInt256Eq(hashes[0], hashes[1])) {
-                if (UInt256IsZero(hashes[1])) hashes[1] = hashes[0]; // if right branch is missing, dup left branch
-                BRSHA256_2(&md, hashes, sizeof(hashes));
-            }
-            else *hashIdx = SIZE_MAX; // defend against (CVE-2012-2459)
+    size_t i, end = (pos + 1) << depth;
+    uint8_t parent = 0;
+
+    for (i = pos << depth; ! parent && i < end && i < txCount; i++) parent = (! matched || matched[i]);
+    if (parent) flags[*flagIdx/8] |= (1 << (*flagIdx % 8));
+    (*flagIdx)++;
+
+    if (depth == 0 || ! parent) hashes[(*hashIdx)++] = levels[depth][pos];
+    else {
+        _BRMerkleBlockBuildR(levels, widths, matched, txCount, depth - 1, pos*2, hashes, hashIdx, flags, flagIdx);
+
+        if (pos*2 + 1 < widths[depth - 1]) {
+            _BRMerkleBlockBuildR(levels, widths, matched, txCount, depth - 1, pos*2 + 1, hashes, hashIdx, flags,
+                                 flagIdx);
         }
-        else md = block->hashes[(*hashIdx)++]; // leaf
     }
-    
-    return md;
+}
+
+// builds the partial merkle tree for a full block's txHashes, in block order, keeping the hashes where matched[i] is
+// true, or all of them if matched is NULL, and sets the block's totalTx, hashes and flags fields
+// returns true if the resulting merkle root matches block->merkleRoot
+int BRMerkleBlockSetMatchedTxHashes(BRMerkleBlock *block, const UInt256 txHashes[], size_t txCount,
+                                    const uint8_t *matched)
+{
+    UInt256 *levels[32], *rows, *hashes, pair[2];
+    size_t widths[32], i, j, total = 0, hashIdx = 0, flagIdx = 0;
+    uint8_t *flags;
+    int depth = 0, r = 1;
+
+    assert(block != NULL);
+    assert(txHashes != NULL || txCount == 0);
+    if (txCount == 0 || txCount > UINT32_MAX) return 0;
+
+    // compute each row of the tree bottom-up, rows with an odd width duplicate their last hash to pair it
+    for (widths[0] = txCount; widths[depth] > 1; depth++) widths[depth + 1] = (widths[depth] + 1)/2;
+    for (i = 0; i <= depth; i++) total += widths[i];
+    rows = malloc(total*sizeof(*rows));
+    hashes = malloc(txCount*sizeof(*hashes)); // each hash covers a distinct range of leaves
+    flags = calloc((2*total + 7)/8, 1);
+    assert(rows != NULL && hashes != NULL && flags != NULL);
+    levels[0] = rows;
+    memcpy(levels[0], txHashes, txCount*sizeof(*rows));
+
+    for (i = 1; i <= depth; i++) levels[i] = levels[i - 1] + widths[i - 1];
+
+    for (i = 1; i <= depth; i++) {
+        // the complete pairs of a row are consecutive in the row below, so they're hashed together as a batch
+        BRSHA256_2Batch(levels[i], levels[i - 1], sizeof(pair), sizeof(pair), widths[i - 1]/2);
+
+        for (j = 0; j < widths[i - 1]/2; j++) {
+            if (UInt256Eq(levels[i - 1][j*2], levels[i - 1][j*2 + 1])) r = 0; // defend against (CVE-2012-2459)
+        }
+
+        if (widths[i - 1] % 2) {
+            pair[0] = pair[1] = levels[i - 1][widths[i - 1] - 1];
+            BRSHA256_2(&levels[i][widths[i] - 1], pair, sizeof(pair));
+        }
+    }
+
+    if (! UInt256Eq(levels[depth][0], block->merkleRoot)) r = 0;
+    _BRMerkleBlockBuildR(levels, widths, matched, txCount, depth, 0, hashes, &hashIdx, flags, &flagIdx);
+    block->totalTx = (uint32_t)txCount;
+    BRMerkleBlockSetTxHashes(block, hashes, hashIdx, flags, (flagIdx + 7)/8);
+    free(flags);
+    free(hashes);
+    free(rows);
+    return r;
 }
 
 // true if merkle tree and timestamp are valid, and proof-of-work matches the stated difficulty target
@@ -277,33 +497,71 @@ int BRMerkleBlockIsValid(const BRMerkleBlock *block, uint32_t currentTime)
 {
     assert(block != NULL);
     
+    BRMerkleBlockView view = _BRMerkleBlockView(block);
+    
+    return BRMerkleBlockViewIsValid(&view, currentTime, BLOCK_MAX_PROOF_OF_WORK);
+}
+
+// true if the block view's timestamp is valid, and proof-of-work matches the stated difficulty target
+static int _BRMerkleBlockViewHeaderIsValid(const BRMerkleBlockView *block, uint32_t currentTime,
+                                           uint32_t maxProofOfWork)
+{
     // target is in "compact" format, where the most significant byte is the size of the value in bytes, next
     // bit is the sign, and the last 23 bits is the value after having been right shifted by (size - 3)*8 bits
+    // t is filled in a byte at a time so any size up to 32 bytes stays in bounds
     const uint32_t size = block->target >> 24, target = block->target & 0x007fffff;
-    size_t hashIdx = 0, flagIdx = 0;
-    UInt256 merkleRoot = _BRMerkleBlockRootR(block, &hashIdx, &flagIdx, 0), t = UINT256_ZERO;
+    uint8_t t[sizeof(UInt256)] = { 0 };
     int r = 1;
     
-    // check if merkle root is correct
-    if (block->totalTx > 0 && ! UInt256Eq(merkleRoot, block->merkleRoot)) r = 0;
-    
     // check if timestamp is too far in future
     if (block->timestamp > currentTime + BLOCK_MAX_TIME_DRIFT) r = 0;
     
     // check if proof-of-work target is out of range
-    if (target == 0 || (block->target & 0x00800000) || block->target > MAX_PROOF_OF_WORK) r = 0;
+    if (target == 0 || (block->target & 0x00800000) || block->target > maxProofOfWork || size > sizeof(t)) r = 0;
     
-    if (size > 3) UInt32SetLE(&t.u8[size - 3], target);
-    else UInt32SetLE(t.u8, target >> (3 - size)*8);
+    for (uint32_t i = 0; r && i < 3; i++) { // target bytes shifted below the least significant byte are dropped
+        if (size + i >= 3) t[size + i - 3] = (uint8_t)(target >> i*8);
+    }
     
     for (int i = sizeof(t) - 1; r && i >= 0; i--) { // check proof-of-work
-        if (block->blockHash.u8[i] < t.u8[i]) break;
-        if (block->blockHash.u8[i] > t.u8[i]) r = 0;
+        if (block->blockHash.u8[i] < t[i]) break;
+        if (block->blockHash.u8[i] > t[i]) r = 0;
     }
     
     return r;
 }
 
+// true if the block view's merkle tree and timestamp are valid, and proof-of-work matches the stated difficulty target,
+// which can be no higher than maxProofOfWork
+int BRMerkleBlockViewIsValid(const BRMerkleBlockView *block, uint32_t currentTime, uint32_t maxProofOfWork)
+{
+    assert(block != NULL);
+    
+    // check if merkle root is correct
+    if (block->totalTx > 0 && ! UInt256Eq(_BRMerkleBlockRoot(block, NULL, 0, NULL), block->merkleRoot)) return 0;
+    return _BRMerkleBlockViewHeaderIsValid(block, currentTime, maxProofOfWork);
+}
+
+// true if the block view is valid as with BRMerkleBlockViewIsValid(), populating txHashes with up to hashesCount of its
+// matched tx hashes in the same pass over the merkle tree, and setting txCount to the total number of them
+int BRMerkleBlockViewIsValidTxHashes(const BRMerkleBlockView *view, uint32_t currentTime, uint32_t maxProofOfWork,
+                                     UInt256 *txHashes, size_t hashesCount, size_t *txCount)
+{
+    UInt256 merkleRoot;
+    
+    assert(view != NULL);
+    assert(txHashes != NULL || hashesCount == 0);
+    assert(txCount != NULL);
+    *txCount = 0;
+    
+    if (view->totalTx > 0) {
+        merkleRoot = _BRMerkleBlockRoot(view, txHashes, hashesCount, txCount);
+        if (! UInt256Eq(merkleRoot, view->merkleRoot)) return 0;
+    }
+    
+    return _BRMerkleBlockViewHeaderIsValid(view, currentTime, maxProofOfWork);
+}
+
 // true if the given tx hash is known to be included in the block
 int BRMerkleBlockContainsTxHash(const BRMerkleBlock *block, UInt256 txHash)
 {
@@ -329,7 +587,7 @@ int BRMerkleBlockContainsTxHash(const BRMerkleBlock *block, UInt256 txHash)
 // multiplied by the time between the last transition block's timestamp and this one (in seconds), divided by the
 // targeted time between transitions (14*24*60*60 seconds). If the new difficulty is more than 4x or less than 1/4 of
 // the previous difficulty, the change is limited to either 4x or 1/4. There is also a minimum difficulty value
-// intuitively named MAX_PROOF_OF_WORK... since larger values are less difficult.
+// intuitively named BLOCK_MAX_PROOF_OF_WORK... since larger values are less difficult.
 int BRMerkleBlockVerifyDifficulty(const BRMerkleBlock *block, const BRMerkleBlock *previous, uint32_t transitionTime)
 {
     int size, r = 1;
@@ -361,7 +619,7 @@ int BRMerkleBlockVerifyDifficulty(const BRMerkleBlock *block, const BRMerkleBloc
         while (size < 1 || target > 0x007fffff) target >>= 8, size++; // normalize target for "compact" format
         target |= size << 24;
     
-        if (target > MAX_PROOF_OF_WORK) target = MAX_PROOF_OF_WORK; // limit to MAX_PROOF_OF_WORK
+        if (target > BLOCK_MAX_PROOF_OF_WORK) target = BLOCK_MAX_PROOF_OF_WORK; // limit to BLOCK_MAX_PROOF_OF_WORK
         if (block->target != target) r = 0;
     }
     else if (r && block->target != previous->target) r = 0;
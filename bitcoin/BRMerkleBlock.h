@@ -36,6 +36,7 @@ extern "C" {
 #define BLOCK_DIFFICULTY_INTERVAL 2016 // number of blocks between difficulty target adjustments
 #define BLOCK_UNKNOWN_HEIGHT      INT32_MAX
 #define BLOCK_MAX_TIME_DRIFT      (2*60*60) // the furthest in the future a block is allowed to be timestamped
+#define BLOCK_MAX_PROOF_OF_WORK   0x1d00ffff // highest value for difficulty target (higher values are less difficult)
 
 typedef struct {
     UInt256 blockHash;
@@ -53,6 +54,23 @@ typedef struct {
     uint32_t height;
 } BRMerkleBlock;
 
+// a merkleblock or header parsed in place by BRMerkleBlockViewParse(), the hashes and flags point into the parsed buffer
+// so a view is only valid as long as that buffer is
+typedef struct {
+    UInt256 blockHash;
+    uint32_t version;
+    UInt256 prevBlock;
+    UInt256 merkleRoot;
+    uint32_t timestamp; // time interval since unix epoch
+    uint32_t target;
+    uint32_t nonce;
+    uint32_t totalTx;
+    const uint8_t *hashes; // hashesCount serialized 32 byte hashes
+    size_t hashesCount;
+    const uint8_t *flags;
+    size_t flagsLen;
+} BRMerkleBlockView;
+
 #define BR_MERKLE_BLOCK_NONE ((const BRMerkleBlock) { UINT256_ZERO, 0, UINT256_ZERO, UINT256_ZERO, 0, 0, 0, 0, NULL, 0,\
                                                       NULL, 0, 0 })
 
@@ -66,6 +84,30 @@ BRMerkleBlock *BRMerkleBlockCopy(const BRMerkleBlock *block);
 // returns a merkle block struct that must be freed by calling BRMerkleBlockFree()
 BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen);
 
+// parses a serialized merkleblock or header in place, without allocating or copying the hashes and flags
+// returns number of bytes parsed, or zero if buf doesn't contain a valid serialization
+size_t BRMerkleBlockViewParse(BRMerkleBlockView *view, const uint8_t *buf, size_t bufLen);
+
+// parses viewsCount consecutive 81 byte headers, as serialized in a headers message, hashing them as a batch
+// returns number of bytes parsed, or zero if buf doesn't contain viewsCount headers
+size_t BRMerkleBlockViewParseHeaders(BRMerkleBlockView views[], size_t viewsCount, const uint8_t *buf, size_t bufLen);
+
+// returns a newly allocated merkle block with a copy of view's data that must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRMerkleBlockViewCopy(const BRMerkleBlockView *view);
+
+// populates txHashes with the matched tx hashes in the block view
+// returns number of tx hashes written, or the total hashesCount needed if txHashes is NULL
+size_t BRMerkleBlockViewTxHashes(const BRMerkleBlockView *view, UInt256 *txHashes, size_t hashesCount);
+
+// true if the block view's merkle tree and timestamp are valid, and proof-of-work matches the stated difficulty target,
+// which can be no higher than maxProofOfWork (the chain's BRChainParams maxProofOfWork)
+int BRMerkleBlockViewIsValid(const BRMerkleBlockView *view, uint32_t currentTime, uint32_t maxProofOfWork);
+
+// true if the block view is valid as with BRMerkleBlockViewIsValid(), populating txHashes with up to hashesCount of its
+// matched tx hashes in the same pass over the merkle tree, and setting txCount to the total number of them
+int BRMerkleBlockViewIsValidTxHashes(const BRMerkleBlockView *view, uint32_t currentTime, uint32_t maxProofOfWork,
+                                     UInt256 *txHashes, size_t hashesCount, size_t *txCount);
+
 // returns number of bytes written to buf, or total bufLen needed if buf is NULL (block->height is not serialized)
 size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t bufLen);
 
@@ -77,7 +119,14 @@ size_t BRMerkleBlockTxHashes(const BRMerkleBlock *block, UInt256 *txHashes, size
 void BRMerkleBlockSetTxHashes(BRMerkleBlock *block, const UInt256 hashes[], size_t hashesCount,
                               const uint8_t *flags, size_t flagsLen);
 
-// true if merkle tree and timestamp are valid, and proof-of-work matches the stated difficulty target
+// builds the partial merkle tree for a full block's txHashes, in block order, keeping the hashes where matched[i] is
+// true, or all of them if matched is NULL, and sets the block's totalTx, hashes and flags fields
+// returns true if the resulting merkle root matches block->merkleRoot
+int BRMerkleBlockSetMatchedTxHashes(BRMerkleBlock *block, const UInt256 txHashes[], size_t txCount,
+                                    const uint8_t *matched);
+
+// true if merkle tree and timestamp are valid, and proof-of-work matches the stated difficulty target, which can be no
+// higher than BLOCK_MAX_PROOF_OF_WORK
 // NOTE: this only checks if the block difficulty matches the difficulty target in the header, it does not check if the
 // target is correct for the block's height in the chain - use BRMerkleBlockVerifyDifficulty() for that
 int BRMerkleBlockIsValid(const BRMerkleBlock *block, uint32_t currentTime);
@@ -43,6 +43,14 @@
 #include <sys/time.h>
 #include <netinet/in.h>	
 #include <arpa/inet.h>
+#include <poll.h>
+
+#if defined (__linux__) && ! defined (PEER_REACTOR_USE_POLL)
+#include <sys/epoll.h>
+#define PEER_REACTOR_EPOLL 1
+#else
+#define PEER_REACTOR_EPOLL 0
+#endif
 
 #define HEADER_LENGTH      24
 #define MAX_MSG_LENGTH     0x02000000
@@ -57,6 +65,19 @@
 
 #define PTHREAD_STACK_SIZE  (512 * 1024)
 
+#define PEER_REACTOR_COUNT       2      // number of threads servicing all peer sockets
+#define PEER_REACTOR_WAIT_MS     1000   // longest a reactor waits before checking peer timers
+#define PEER_REACTOR_READ_LIMIT  4      // reads per ready socket per wakeup, so one busy peer can't starve the others
+#define PEER_RECV_BUFFER_SIZE    0x4000
+#define PEER_SEND_BUFFER_LIMIT   0x400000 // most unsent bytes queued for a peer before it's dropped as too slow
+
+#define PEER_HEADERS_MAX_THREADS 4      // most threads validating a single headers message
+#define PEER_HEADERS_PER_THREAD  500    // fewest headers worth handing to another thread
+
+#ifndef MSG_NOSIGNAL   // linux based systems have a MSG_NOSIGNAL send flag, useful for supressing SIGPIPE signals
+#define MSG_NOSIGNAL 0 // set to 0 if undefined (BSD has the SO_NOSIGPIPE sockopt, and windows has no signals at all)
+#endif
+
 // the standard blockchain download protocol works as follows (for SPV mode):
 // - local peer sends getblocks
 // - remote peer reponds with inv containing up to 500 block hashes
@@ -95,6 +116,8 @@ typedef enum {
     inv_filtered_witness_block = inv_filtered_block | WITNESS_FLAG
 } inv_type;
 
+typedef struct BRPeerReactorStruct BRPeerReactor;
+
 typedef struct {
     BRPeer peer; // superstruct on top of BRPeer
     uint32_t magicNumber;
@@ -104,11 +127,11 @@ typedef struct {
     volatile int needsFilterUpdate;
     uint64_t nonce, feePerKb;
     char *useragent;
-    uint32_t version, lastblock, earliestKeyTime, currentBlockHeight;
+    uint32_t version, lastblock, earliestKeyTime, currentBlockHeight, maxProofOfWork;
     double startTime, pingTime;
     volatile double disconnectTime, mempoolTime;
     int sentVerack, gotVerack, sentGetaddr, sentFilter, sentGetdata, sentMempool, sentGetblocks;
-    UInt256 lastBlockHash;
+    UInt256 lastBlockHash, lastHeaderHash;
     BRMerkleBlock *currentBlock;
     UInt256 *currentBlockTxHashes, *knownBlockHashes, *knownTxHashes;
     BRSet *knownTxHashSet;
@@ -127,12 +150,24 @@ typedef struct {
     BRTransaction *(*requestedTx)(void *info, UInt256 txHash);
     int (*networkIsReachable)(void *info);
     void (*threadCleanup)(void *info);
+    void (*relayedFilterHeaders)(void *info, UInt256 stopHash, UInt256 prevFilterHeader, const UInt256 filterHashes[],
+                                 size_t count);
+    void (*relayedFilter)(void *info, UInt256 blockHash, const uint8_t *filter, size_t filterLen);
+    void (*relayedHeaders)(void *info, BRMerkleBlock *headers[], size_t count);
     void **volatile pongInfo;
     void (**volatile pongCallback)(void *info, int success);
     void *volatile mempoolInfo;
     void (*volatile mempoolCallback)(void *info, int success);
-    pthread_t thread;
-    pthread_mutex_t lock;
+    BRPeerReactor *reactor; // reactor servicing the socket, NULL when disconnected
+    volatile int disconnecting;
+    int connecting, error, sendWatched; // these fields are only used on the reactor thread
+    double msgTimeout;
+    uint8_t *recvBuf;
+    size_t recvStart, recvEnd, recvCapacity;
+    uint8_t *sendBuf; // bytes the socket had no room for, guarded by sendLock
+    size_t sendStart, sendEnd, sendCapacity;
+    double sendTimeout;
+    pthread_mutex_t sendLock, lock;
 } BRPeerContext;
 
 void BRPeerSendVersionMessage(BRPeer *peer);
@@ -359,6 +394,11 @@ static int _BRPeerAcceptInvMessage(BRPeer *peer, const uint8_t *msg, size_t msgL
             r = 0;
         }
         else {
+            // in block filter mode new blocks are announced with inv and picked up with getheaders, never getdata
+            if (ctx->relayedFilter && blockCount > 0 && ! UInt256IsZero(ctx->lastHeaderHash)) {
+                BRPeerSendGetheaders(peer, &ctx->lastHeaderHash, 1, UINT256_ZERO);
+            }
+
             if (! ctx->sentFilter && ! ctx->sentGetblocks) blockCount = 0;
             if (blockCount == 1 && UInt256Eq(ctx->lastBlockHash, UInt256Get(blocks[0]))) blockCount = 0;
             if (blockCount == 1) ctx->lastBlockHash = UInt256Get(blocks[0]);
@@ -415,17 +455,16 @@ static int _BRPeerAcceptInvMessage(BRPeer *peer, const uint8_t *msg, size_t msgL
 static int _BRPeerAcceptTxMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
-    BRTransaction *tx = BRTransactionParse(msg, msgLen);
+    BRTransaction *tx = NULL;
     UInt256 txHash;
     int r = 1;
 
-    if (! tx) {
-        peer_log(peer, "malformed tx message with length: %zu", msgLen);
+    if (! ctx->sentFilter && ! ctx->sentGetdata) { // checked before parsing so an unwanted tx is never copied
+        peer_log(peer, "got tx message before loading filter");
         r = 0;
     }
-    else if (! ctx->sentFilter && ! ctx->sentGetdata) {
-        peer_log(peer, "got tx message before loading filter");
-        BRTransactionFree(tx);
+    else if (! (tx = BRTransactionParse(msg, msgLen))) {
+        peer_log(peer, "malformed tx message with length: %zu", msgLen);
         r = 0;
     }
     else {
@@ -456,6 +495,159 @@ static int _BRPeerAcceptTxMessage(BRPeer *peer, const uint8_t *msg, size_t msgLe
     return r;
 }
 
+typedef struct {
+    const uint8_t *buf; // serialized headers, 81 bytes each
+    size_t count;
+    BRMerkleBlock **headers; // set to a copy of each header to be relayed, left NULL for skipped headers
+    uint32_t now, earliestKeyTime, maxProofOfWork;
+    int relayAll; // in block filter mode every header is relayed
+    size_t invalid; // index of the first invalid header, or count if all are valid
+    UInt256 invalidHash;
+    int done; // set once the share has been validated, when it was queued to the headers pool
+} BRPeerHeadersWorker;
+
+// validates proof-of-work and timestamps for a share of a headers message in place, hashing them in batches, and copies
+// out the ones that will be relayed, stopping at the first invalid header
+static void *_BRPeerHeadersWorkerRoutine(void *info)
+{
+    BRPeerHeadersWorker *worker = info;
+    BRMerkleBlockView views[32];
+    size_t i, j, n;
+
+    worker->invalid = worker->count;
+
+    for (i = 0; i < worker->invalid; i += n) {
+        n = (worker->count - i < sizeof(views)/sizeof(*views)) ? worker->count - i : sizeof(views)/sizeof(*views);
+        BRMerkleBlockViewParseHeaders(views, n, &worker->buf[81*i], 81*n);
+
+        for (j = 0; j < n && i + j < worker->invalid; j++) {
+            if (! BRMerkleBlockViewIsValid(&views[j], worker->now, worker->maxProofOfWork)) {
+                worker->invalid = i + j;
+                worker->invalidHash = views[j].blockHash;
+            }
+            else if (worker->relayAll ||
+                     views[j].timestamp + 7*24*60*60 - BLOCK_MAX_TIME_DRIFT <= worker->earliestKeyTime) {
+                worker->headers[i + j] = BRMerkleBlockViewCopy(&views[j]);
+            } // headers newer than a week before earliestKeyTime are replaced by merkleblocks
+        }
+    }
+
+    return NULL;
+}
+
+// Shares of a large headers message are validated on a small, fixed pool of worker threads shared by every BRPeer in
+// the process. The reactor thread queues all but the first share of a message, validates the first itself, takes back
+// any queued share no pool thread has started on yet, and then waits for the rest.
+
+typedef struct {
+    pthread_mutex_t lock; // guards queue and the done flag of each queued worker
+    pthread_cond_t queued, done;
+    BRPeerHeadersWorker **queue;
+    size_t threadCount;
+} BRPeerHeadersPool;
+
+static BRPeerHeadersPool _peerHeadersPool;
+static pthread_once_t _peerHeadersPoolOnce = PTHREAD_ONCE_INIT;
+
+static void *_peerHeadersPoolThreadRoutine(void *arg)
+{
+    BRPeerHeadersPool *pool = arg;
+    BRPeerHeadersWorker *worker;
+
+#if defined (__ANDROID__)
+    pthread_setname_np(pthread_self(), "Core Bitcoin Peer Headers");
+#elif defined (__APPLE__)
+    pthread_setname_np("Core Bitcoin Peer Headers");
+#endif
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (1) {
+        while (array_count(pool->queue) == 0) pthread_cond_wait(&pool->queued, &pool->lock);
+        worker = pool->queue[0];
+        array_rm(pool->queue, 0);
+        pthread_mutex_unlock(&pool->lock);
+        _BRPeerHeadersWorkerRoutine(worker);
+        pthread_mutex_lock(&pool->lock);
+        worker->done = 1;
+        pthread_cond_broadcast(&pool->done);
+    }
+
+    return NULL; // detached threads don't need to return a value
+}
+
+static void _peerHeadersPoolStart(void)
+{
+    BRPeerHeadersPool *pool = &_peerHeadersPool;
+    long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threadCount = (cpuCount > 1) ? (size_t)cpuCount - 1 : 0; // the reactor thread validates a share too
+
+    if (threadCount > PEER_HEADERS_MAX_THREADS - 1) threadCount = PEER_HEADERS_MAX_THREADS - 1;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->queued, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    array_new(pool->queue, PEER_HEADERS_MAX_THREADS*PEER_REACTOR_COUNT);
+
+    for (size_t i = 0; i < threadCount; i++) {
+        pthread_attr_t attr;
+        pthread_t thread;
+        int ok = (pthread_attr_init(&attr) == 0);
+
+        if (ok) {
+            ok = (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) == 0 &&
+                  pthread_attr_setstacksize(&attr, PTHREAD_STACK_SIZE) == 0 &&
+                  pthread_create(&thread, &attr, _peerHeadersPoolThreadRoutine, pool) == 0);
+            pthread_attr_destroy(&attr);
+        }
+
+        if (ok) pool->threadCount++;
+        else _peer_log("error creating peer headers thread");
+    }
+}
+
+// returns the number of pool threads, starting them if they haven't been
+static size_t _peerHeadersPoolThreadCount(void)
+{
+    pthread_once(&_peerHeadersPoolOnce, _peerHeadersPoolStart);
+    return _peerHeadersPool.threadCount;
+}
+
+// validates count shares of a headers message, the first on the calling thread and the others on the pool, returning
+// once every share is done
+static void _peerHeadersPoolRun(BRPeerHeadersWorker workers[], size_t count)
+{
+    BRPeerHeadersPool *pool = &_peerHeadersPool;
+    size_t i, j;
+
+    if (count < 2 || _peerHeadersPoolThreadCount() == 0) {
+        for (i = 0; i < count; i++) _BRPeerHeadersWorkerRoutine(&workers[i]);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    for (i = 1; i < count; i++) array_add(pool->queue, &workers[i]);
+    pthread_cond_broadcast(&pool->queued);
+    pthread_mutex_unlock(&pool->lock);
+    _BRPeerHeadersWorkerRoutine(&workers[0]);
+    pthread_mutex_lock(&pool->lock);
+
+    for (i = count - 1; i > 0; i--) { // pool threads take shares from the front of the queue, so take back from the end
+        for (j = array_count(pool->queue); j > 0 && pool->queue[j - 1] != &workers[i]; j--);
+        if (j == 0) continue;
+        array_rm(pool->queue, j - 1);
+        pthread_mutex_unlock(&pool->lock);
+        _BRPeerHeadersWorkerRoutine(&workers[i]);
+        pthread_mutex_lock(&pool->lock);
+        workers[i].done = 1;
+    }
+
+    for (i = 1; i < count; i++) {
+        while (! workers[i].done) pthread_cond_wait(&pool->done, &pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
 static int _BRPeerAcceptHeadersMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
@@ -473,16 +665,26 @@ static int _BRPeerAcceptHeadersMessage(BRPeer *peer, const uint8_t *msg, size_t
         // To improve chain download performance, if this message contains 2000 headers then request the next 2000
         // headers immediately, and switch to requesting blocks when we receive a header newer than earliestKeyTime
         uint32_t timestamp = (count > 0) ? UInt32GetLE(&msg[off + 81*(count - 1) + 68]) : 0;
-    
-        if (count >= 2000 || (timestamp > 0 && timestamp + 7*24*60*60 + BLOCK_MAX_TIME_DRIFT >= ctx->earliestKeyTime)) {
+        int pastKeyTime = (timestamp > 0 && timestamp + 7*24*60*60 + BLOCK_MAX_TIME_DRIFT >= ctx->earliestKeyTime);
+        UInt256 lastHash = UINT256_ZERO;
+        
+        if (count > 0) BRSHA256_2(&lastHash, &msg[off + 81*(count - 1)], 80);
+
+        // in block filter mode every header is relayed, and a short or empty message just means the tip was reached
+        if (count >= 2000 || pastKeyTime || ctx->relayedFilter) {
             size_t last = 0;
             time_t now = time(NULL);
             UInt256 locators[2];
             
-            BRSHA256_2(&locators[0], &msg[off + 81*(count - 1)], 80);
-            BRSHA256_2(&locators[1], &msg[off], 80);
+            locators[0] = lastHash;
+            if (count > 0) BRSHA256_2(&locators[1], &msg[off], 80);
+            if (count > 0) ctx->lastHeaderHash = lastHash;
 
-            if (timestamp > 0 && timestamp + 7*24*60*60 + BLOCK_MAX_TIME_DRIFT >= ctx->earliestKeyTime) {
+            if (ctx->relayedFilter) {
+                // past earliestKeyTime the filter scan paces further requests, so headers don't outrun the filters
+                if (count >= 2000 && ! pastKeyTime) BRPeerSendGetheaders(peer, locators, 2, UINT256_ZERO);
+            }
+            else if (pastKeyTime) {
                 // request blocks for the remainder of the chain
                 timestamp = (++last < count) ? UInt32GetLE(&msg[off + 81*last + 68]) : 0;
 
@@ -495,23 +697,55 @@ static int _BRPeerAcceptHeadersMessage(BRPeer *peer, const uint8_t *msg, size_t
             }
             else BRPeerSendGetheaders(peer, locators, 2, UINT256_ZERO);
 
-            for (size_t i = 0; r && i < count; i++) {
-                BRMerkleBlock *block = BRMerkleBlockParse(&msg[off + 81*i], 81);
-                
-                if (! block) {
-                    peer_log(peer, "malformed headers message with length: %zu", msgLen);
-                    r = 0;
-                }
-                else if (! BRMerkleBlockIsValid(block, (uint32_t)now)) {
-                    peer_log(peer, "invalid block header: %s", u256hex(block->blockHash));
-                    BRMerkleBlockFree(block);
-                    r = 0;
-                }
-                else if (ctx->relayedBlock) {
-                    ctx->relayedBlock(ctx->info, block);
-                }
-                else BRMerkleBlockFree(block);
+            // hashing and proof-of-work checks are split across the headers pool in contiguous shares, the calling
+            // thread taking the first, and the copies are then relayed in order for the difficulty and chain checks
+            BRMerkleBlock **headers = calloc(count + 1, sizeof(*headers));
+            size_t i, j, n, valid, share, threadCount = (count + PEER_HEADERS_PER_THREAD - 1)/PEER_HEADERS_PER_THREAD;
+
+            assert(headers != NULL);
+            if (threadCount > 1 && threadCount > _peerHeadersPoolThreadCount() + 1) {
+                threadCount = _peerHeadersPoolThreadCount() + 1;
             }
+
+            if (threadCount < 1) threadCount = 1;
+            share = (count + threadCount - 1)/threadCount;
+
+            BRPeerHeadersWorker workers[threadCount];
+
+            for (i = 0; i < threadCount; i++) {
+                j = (i*share < count) ? i*share : count;
+                n = (count - j < share) ? count - j : share;
+                workers[i] = (BRPeerHeadersWorker) { &msg[off + 81*j], n, &headers[j], (uint32_t)now,
+                                                     ctx->earliestKeyTime, ctx->maxProofOfWork,
+                                                     (ctx->relayedFilter != NULL), n, UINT256_ZERO, 0 };
+            }
+
+            _peerHeadersPoolRun(workers, threadCount);
+
+            for (i = 0, valid = 0; i < threadCount && workers[i].invalid == workers[i].count; i++) {
+                valid += workers[i].count;
+            }
+
+            if (i < threadCount) { // headers ahead of an invalid one are still relayed, the rest are dropped
+                peer_log(peer, "invalid block header: %s", u256hex(workers[i].invalidHash));
+                valid += workers[i].invalid;
+                r = 0;
+            }
+
+            for (i = 0, n = 0; i < count; i++) {
+                if (! headers[i]) continue;
+                else if (i < valid && (ctx->relayedHeaders || ctx->relayedBlock)) headers[n++] = headers[i];
+                else BRMerkleBlockFree(headers[i]);
+            }
+
+            if (ctx->relayedHeaders && n > 0) {
+                ctx->relayedHeaders(ctx->info, headers, n);
+            }
+            else {
+                for (i = 0; i < n; i++) ctx->relayedBlock(ctx->info, headers[i]);
+            }
+
+            free(headers);
         }
         else {
             peer_log(peer, "non-standard headers message, %zu is fewer header(s) than expected", count);
@@ -715,39 +949,39 @@ static int _BRPeerAcceptMerkleblockMessage(BRPeer *peer, const uint8_t *msg, siz
     // a merkleblock message, the remote node is expected to send tx messages for the tx referenced in the block. When a
     // non-tx message is received we should have all the tx in the merkleblock.
     BRPeerContext *ctx = (BRPeerContext *)peer;
-    BRMerkleBlock *block = BRMerkleBlockParse(msg, msgLen);
+    BRMerkleBlockView view;
+    BRMerkleBlock *block = NULL;
+    UInt256 _hashes[128], *hashes = _hashes;
+    size_t len = BRMerkleBlockViewParse(&view, msg, msgLen), count = 0;
     int r = 1;
   
-    if (! block) {
+    // every matched tx hash is one of the block's hashes, so hashesCount bounds them
+    if (len > 0 && view.hashesCount > 128) hashes = malloc(view.hashesCount*sizeof(UInt256));
+    assert(hashes != NULL);
+    
+    if (len == 0) {
         peer_log(peer, "malformed merkleblock message with length: %zu", msgLen);
         r = 0;
     }
-    else if (! BRMerkleBlockIsValid(block, (uint32_t)time(NULL))) {
-        peer_log(peer, "invalid merkleblock: %s", u256hex(block->blockHash));
-        BRMerkleBlockFree(block);
-        block = NULL;
+    else if (! BRMerkleBlockViewIsValidTxHashes(&view, (uint32_t)time(NULL), ctx->maxProofOfWork, hashes,
+                                                view.hashesCount, &count)) {
+        peer_log(peer, "invalid merkleblock: %s", u256hex(view.blockHash));
         r = 0;
     }
     else if (! ctx->sentFilter && ! ctx->sentGetdata) {
         peer_log(peer, "got merkleblock message before loading a filter");
-        BRMerkleBlockFree(block);
-        block = NULL;
         r = 0;
     }
     else {
-        size_t count = BRMerkleBlockTxHashes(block, NULL, 0);
-        UInt256 _hashes[128], *hashes = (count <= 128) ? _hashes : malloc(count*sizeof(UInt256));
-        
-        assert(hashes != NULL);
-        count = BRMerkleBlockTxHashes(block, hashes, count);
-
         for (size_t i = count; i > 0; i--) { // reverse order for more efficient removal as tx arrive
             if (BRSetContains(ctx->knownTxHashSet, &hashes[i - 1])) continue;
             array_add(ctx->currentBlockTxHashes, hashes[i - 1]);
         }
 
-        if (hashes != _hashes) free(hashes);
+        block = BRMerkleBlockViewCopy(&view); // the block is valid and will be relayed, so it's now worth copying
     }
+    
+    if (hashes != _hashes) free(hashes);
 
     if (block) {
         if (array_count(ctx->currentBlockTxHashes) > 0) { // wait til we get all tx messages before processing the block
@@ -762,6 +996,138 @@ static int _BRPeerAcceptMerkleblockMessage(BRPeer *peer, const uint8_t *msg, siz
     return r;
 }
 
+// full blocks are only requested in block filter mode, for blocks whose filter matched the wallet
+static int _BRPeerAcceptBlockMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    BRMerkleBlockView view;
+    BRMerkleBlock *block = NULL;
+    BRTransaction **txs = NULL;
+    UInt256 *txHashes = NULL;
+    size_t off = 80, len = 0, count = 0, i;
+    int r = 1;
+
+    if (! ctx->relayedFilter || ! ctx->sentGetdata) {
+        peer_log(peer, "got block message without requesting it");
+        r = 0;
+    }
+    else if (BRMerkleBlockViewParse(&view, msg, (msgLen < 80) ? msgLen : 80) == 0 ||
+             (count = (size_t)BRVarInt(&msg[off], msgLen - off, &len)) == 0 || len == 0 ||
+             count > (msgLen - off - len)/60) { // a serialized tx takes at least 60 bytes
+        peer_log(peer, "malformed block message with length: %zu", msgLen);
+        r = 0;
+    }
+    else {
+        off += len;
+        txs = calloc(count, sizeof(*txs));
+        txHashes = malloc(count*sizeof(*txHashes));
+        assert(txs != NULL && txHashes != NULL);
+
+        // BRTransactionParse() doesn't report the length it consumed, so step over each tx by its serialized size
+        for (i = 0; r && i < count; i++) {
+            txs[i] = (off < msgLen) ? BRTransactionParse(&msg[off], msgLen - off) : NULL;
+
+            if (! txs[i]) {
+                peer_log(peer, "malformed block message with length: %zu", msgLen);
+                r = 0;
+            }
+            else {
+                txHashes[i] = txs[i]->txHash;
+                off += BRTransactionSerialize(txs[i], NULL, 0);
+            }
+        }
+
+        block = BRMerkleBlockViewCopy(&view);
+
+        // the view holds just the header, the merkle root is checked as the block's tx hashes are set
+        if (r && (! BRMerkleBlockSetMatchedTxHashes(block, txHashes, count, NULL) ||
+                  ! BRMerkleBlockViewIsValid(&view, (uint32_t)time(NULL), ctx->maxProofOfWork))) {
+            peer_log(peer, "invalid block: %s", u256hex(block->blockHash));
+            r = 0;
+        }
+    }
+
+    if (r && block) {
+        peer_log(peer, "got block %s with %zu tx", u256hex(block->blockHash), count);
+
+        for (i = 0; i < count; i++) { // tx are relayed ahead of their block, just as with a merkleblock
+            if (ctx->relayedTx) ctx->relayedTx(ctx->info, txs[i]);
+            else BRTransactionFree(txs[i]);
+            txs[i] = NULL;
+        }
+
+        if (ctx->relayedBlock) ctx->relayedBlock(ctx->info, block);
+        else BRMerkleBlockFree(block);
+    }
+    else if (block) BRMerkleBlockFree(block);
+
+    for (i = 0; txs && i < count; i++) {
+        if (txs[i]) BRTransactionFree(txs[i]);
+    }
+
+    if (txs) free(txs);
+    if (txHashes) free(txHashes);
+    return r;
+}
+
+// described in BIP157: https://github.com/bitcoin/bips/blob/master/bip-0157.mediawiki
+static int _BRPeerAcceptCfheadersMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    size_t off = sizeof(uint8_t) + 2*sizeof(UInt256), len = 0,
+           count = (off < msgLen) ? (size_t)BRVarInt(&msg[off], msgLen - off, &len) : 0;
+    int r = 1;
+
+    if (! ctx->relayedFilterHeaders) {
+        peer_log(peer, "got cfheaders message without requesting filters");
+        r = 0;
+    }
+    else if (len == 0 || off + len + count*sizeof(UInt256) > msgLen || count > 2000) {
+        peer_log(peer, "malformed cfheaders message with length: %zu", msgLen);
+        r = 0;
+    }
+    else if (msg[0] != 0) { // only basic filters are requested
+        peer_log(peer, "dropping cfheaders message of filter type %u", msg[0]);
+    }
+    else {
+        UInt256 stopHash = UInt256Get(&msg[1]), prevHeader = UInt256Get(&msg[1 + sizeof(UInt256)]), *hashes;
+
+        peer_log(peer, "got %zu filter hash(es) up to %s", count, u256hex(stopHash));
+        off += len;
+        hashes = (count > 0) ? malloc(count*sizeof(*hashes)) : NULL;
+        assert(hashes != NULL || count == 0);
+        for (size_t i = 0; i < count; i++) hashes[i] = UInt256Get(&msg[off + i*sizeof(UInt256)]);
+        ctx->relayedFilterHeaders(ctx->info, stopHash, prevHeader, hashes, count);
+        if (hashes) free(hashes);
+    }
+
+    return r;
+}
+
+// described in BIP157: https://github.com/bitcoin/bips/blob/master/bip-0157.mediawiki
+static int _BRPeerAcceptCfilterMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    size_t off = sizeof(uint8_t) + sizeof(UInt256), len = 0,
+           filterLen = (off < msgLen) ? (size_t)BRVarInt(&msg[off], msgLen - off, &len) : 0;
+    int r = 1;
+
+    if (! ctx->relayedFilter) {
+        peer_log(peer, "got cfilter message without requesting filters");
+        r = 0;
+    }
+    else if (len == 0 || filterLen > msgLen - off - len) {
+        peer_log(peer, "malformed cfilter message with length: %zu", msgLen);
+        r = 0;
+    }
+    else if (msg[0] != 0) {
+        peer_log(peer, "dropping cfilter message of filter type %u", msg[0]);
+    }
+    else ctx->relayedFilter(ctx->info, UInt256Get(&msg[1]), &msg[off + len], filterLen);
+
+    return r;
+}
+
 // described in BIP61: https://github.com/bitcoin/bips/blob/master/bip-0061.mediawiki
 static int _BRPeerAcceptRejectMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
 {
@@ -860,88 +1226,66 @@ static int _BRPeerAcceptMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen,
     else if (strncmp(MSG_MERKLEBLOCK, type, 12) == 0) r = _BRPeerAcceptMerkleblockMessage(peer, msg, msgLen);
     else if (strncmp(MSG_REJECT, type, 12) == 0) r = _BRPeerAcceptRejectMessage(peer, msg, msgLen);
     else if (strncmp(MSG_FEEFILTER, type, 12) == 0) r = _BRPeerAcceptFeeFilterMessage(peer, msg, msgLen);
+    else if (strncmp(MSG_BLOCK, type, 12) == 0) r = _BRPeerAcceptBlockMessage(peer, msg, msgLen);
+    else if (strncmp(MSG_CFHEADERS, type, 12) == 0) r = _BRPeerAcceptCfheadersMessage(peer, msg, msgLen);
+    else if (strncmp(MSG_CFILTER, type, 12) == 0) r = _BRPeerAcceptCfilterMessage(peer, msg, msgLen);
     else peer_log(peer, "dropping %s, length %zu, not implemented", type, msgLen);
 
     return r;
 }
 
-static int _BRPeerOpenSocket(BRPeer *peer, int domain, double timeout, int *error)
+// creates a non-blocking socket and starts connecting it to peer, falling back to IPv4 if IPv6 fails immediately
+// returns the socket, or -1 with error set
+static int _BRPeerOpenSocket(BRPeer *peer, int domain, int *error)
 {
-    BRPeerContext *ctx = (BRPeerContext *)peer;
     struct sockaddr_storage addr;
-    struct timeval tv;
-    fd_set fds;
-    socklen_t addrLen, optLen;
-    int count, arg = 0, err = 0, on = 1, r = 1;
-    int sock;
-
-    pthread_mutex_lock(&ctx->lock);
-    sock = ctx->socket = socket(domain, SOCK_STREAM, 0);
-    pthread_mutex_unlock(&ctx->lock);
+    socklen_t addrLen;
+    int arg = 0, err = 0, on = 1;
+    int sock = socket(domain, SOCK_STREAM, 0);
 
     if (sock < 0) {
-        err = errno;
-        r = 0;
+        *error = errno;
+        return -1;
     }
-    else {
-        tv.tv_sec = 1; // one second timeout for send/receive, so thread doesn't block for too long
-        tv.tv_usec = 0;
-        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
-        setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+
+    setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
 #ifdef SO_NOSIGPIPE // BSD based systems have a SO_NOSIGPIPE socket option to supress SIGPIPE signals
-        setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
 #endif
-        arg = fcntl(sock, F_GETFL, NULL);
-        if (arg < 0 || fcntl(sock, F_SETFL, arg | O_NONBLOCK) < 0) r = 0; // temporarily set socket non-blocking
-        if (! r) err = errno;
+    arg = fcntl(sock, F_GETFL, NULL);
+
+    if (arg < 0 || fcntl(sock, F_SETFL, arg | O_NONBLOCK) < 0) { // the reactor needs non-blocking sockets
+        *error = errno;
+        close(sock);
+        return -1;
     }
 
-    if (r) {
-        memset(&addr, 0, sizeof(addr));
-        
-        if (domain == PF_INET6) {
-            ((struct sockaddr_in6 *)&addr)->sin6_family = AF_INET6;
-            ((struct sockaddr_in6 *)&addr)->sin6_addr = *(struct in6_addr *)&peer->address;
-            ((struct sockaddr_in6 *)&addr)->sin6_port = htons(peer->port);
-            addrLen = sizeof(struct sockaddr_in6);
-        }
-        else {
-            ((struct sockaddr_in *)&addr)->sin_family = AF_INET;
-            ((struct sockaddr_in *)&addr)->sin_addr = *(struct in_addr *)&peer->address.u32[3];
-            ((struct sockaddr_in *)&addr)->sin_port = htons(peer->port);
-            addrLen = sizeof(struct sockaddr_in);
-        }
-        
-        if (connect(sock, (struct sockaddr *)&addr, addrLen) < 0) err = errno;
-        
-        if (err == EINPROGRESS) {
-            err = 0;
-            optLen = sizeof(err);
-            tv.tv_sec = timeout;
-            tv.tv_usec = (long)(timeout*1000000) % 1000000;
-            FD_ZERO(&fds);
-            FD_SET(sock, &fds);
-            count = select(sock + 1, NULL, &fds, NULL, &tv);
-
-            if (count <= 0 || getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &optLen) < 0 || err) {
-                if (count == 0) err = ETIMEDOUT;
-                if (count < 0 || ! err) err = errno;
-                r = 0;
-            }
-        }
-        else if (err && domain == PF_INET6 && _BRPeerIsIPv4(peer)) {
-            return _BRPeerOpenSocket(peer, PF_INET, timeout, error); // fallback to IPv4
-        }
-        else if (err) r = 0;
+    memset(&addr, 0, sizeof(addr));
 
-        if (r) peer_log(peer, "socket connected");
-        fcntl(sock, F_SETFL, arg); // restore socket non-blocking status
+    if (domain == PF_INET6) {
+        ((struct sockaddr_in6 *)&addr)->sin6_family = AF_INET6;
+        ((struct sockaddr_in6 *)&addr)->sin6_addr = *(struct in6_addr *)&peer->address;
+        ((struct sockaddr_in6 *)&addr)->sin6_port = htons(peer->port);
+        addrLen = sizeof(struct sockaddr_in6);
+    }
+    else {
+        ((struct sockaddr_in *)&addr)->sin_family = AF_INET;
+        ((struct sockaddr_in *)&addr)->sin_addr = *(struct in_addr *)&peer->address.u32[3];
+        ((struct sockaddr_in *)&addr)->sin_port = htons(peer->port);
+        addrLen = sizeof(struct sockaddr_in);
     }
 
-    if (! r && err) peer_log(peer, "connect error: %s", strerror(err));
-    if (error && err) *error = err;
-    return r;
+    if (connect(sock, (struct sockaddr *)&addr, addrLen) < 0) err = errno;
+
+    if (err && err != EINPROGRESS) {
+        close(sock);
+        if (domain == PF_INET6 && _BRPeerIsIPv4(peer)) return _BRPeerOpenSocket(peer, PF_INET, error); // fallback
+        peer_log(peer, "connect error: %s", strerror(err));
+        *error = err;
+        return -1;
+    }
+
+    return sock;
 }
 
 static int _peerCheckAndGetSocket (BRPeerContext *ctx, int *socket) {
@@ -985,124 +1329,285 @@ static double _peerGetMempoolTime (BRPeerContext *ctx) {
     return value;
 }
 
+static double _peerCurrentTime (void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (double)tv.tv_usec/1000000;
+}
+
+/// MARK: - Reactor
+
+// Rather than a thread per connection, peer sockets are multiplexed over a small, fixed set of reactor threads shared
+// by every BRPeer in the process. Each reactor waits on its sockets with epoll (or poll where epoll isn't available),
+// completes non-blocking connects, reads whatever is available into the peer's receive buffer, and dispatches each
+// complete message to _BRPeerAcceptMessage() on the reactor thread. Peer callbacks therefore run on a reactor thread.
+
+struct BRPeerReactorStruct {
+    pthread_t thread;
+    pthread_mutex_t lock; // guards peers
+    BRPeerContext **peers;
+    int wake[2]; // pipe written to interrupt a wait when a peer is added or asked to disconnect
+#if PEER_REACTOR_EPOLL
+    int epoll;
+#endif
+    int running;
+};
 
-static void *_peerThreadRoutine(void *arg)
+static BRPeerReactor _peerReactors[PEER_REACTOR_COUNT];
+static pthread_once_t _peerReactorsOnce = PTHREAD_ONCE_INIT;
+
+static void _peerReactorWake(BRPeerReactor *reactor)
 {
-    BRPeer *peer = arg;
-    BRPeerContext *ctx = arg;
-    int socket, error = 0;
+    uint8_t byte = 0;
 
-    pthread_cleanup_push(ctx->threadCleanup, ctx->info);
-    
-    if (_BRPeerOpenSocket(peer, PF_INET6, CONNECT_TIMEOUT, &error)) {
-        struct timeval tv;
-        double time = 0, msgTimeout;
-        uint8_t header[HEADER_LENGTH], *payload = malloc(0x1000);
-        size_t len = 0, payloadLen = 0x1000;
-        ssize_t n = 0;
+    if (write(reactor->wake[1], &byte, sizeof(byte)) < 0 && errno != EAGAIN) {
+        _peer_log("peer reactor wake failed: %s", strerror(errno));
+    }
+}
 
-        assert(payload != NULL);
-        gettimeofday(&tv, NULL);
-        ctx->startTime = tv.tv_sec + (double)tv.tv_usec/1000000;
-        BRPeerSendVersionMessage(peer);
-
-        while (_peerCheckAndGetSocket(ctx, &socket) && ! error) {
-            len = 0;
-
-            while (socket >= 0 && ! error && len < HEADER_LENGTH) {
-                n = read(socket, &header[len], sizeof(header) - len);
-                if (n > 0) len += n;
-                if (n == 0) error = ECONNRESET;
-                if (n < 0 && errno != EWOULDBLOCK) error = errno;
-                gettimeofday(&tv, NULL);
-                time = tv.tv_sec + (double)tv.tv_usec/1000000;
-                if (! error && time >= _peerGetDisconnectTime(ctx)) error = ETIMEDOUT;
-
-                if (! error && time >= _peerGetMempoolTime(ctx)) {
-                    peer_log(peer, "done waiting for mempool response");
-                    BRPeerSendPing(peer, ctx->mempoolInfo, ctx->mempoolCallback);
-                    ctx->mempoolCallback = NULL;
-
-                    pthread_mutex_lock(&ctx->lock);
-                    ctx->mempoolTime = DBL_MAX;
-                    pthread_mutex_unlock(&ctx->lock);
-                }
+static void _peerReactorDrain(BRPeerReactor *reactor)
+{
+    uint8_t bytes[64];
 
-                while (sizeof(uint32_t) <= len && UInt32GetLE(header) != ctx->magicNumber) {
-                    memmove(header, &header[1], --len); // consume one byte at a time until we find the magic number
-                }
+    while (read(reactor->wake[0], bytes, sizeof(bytes)) > 0);
+}
 
-                socket = _peerGetSocket(ctx);
-            }
-            
-            if (error) {
-                peer_log(peer, "%s", strerror(error));
-            }
-            else if (header[15] != 0) { // verify header type field is NULL terminated
-                peer_log(peer, "malformed message header: type not NULL terminated");
+#if PEER_REACTOR_EPOLL
+static void _peerReactorWatch(BRPeerReactor *reactor, BRPeerContext *ctx, int socket, int op)
+{
+    struct epoll_event event = { (ctx->connecting) ? EPOLLOUT : (ctx->sendWatched) ? EPOLLIN | EPOLLOUT : EPOLLIN,
+                                 { .ptr = ctx } };
+
+    if (epoll_ctl(reactor->epoll, op, socket, &event) < 0 && ! ctx->error) ctx->error = errno;
+}
+#endif
+
+// completes a non-blocking connect, starting the version handshake if it succeeded
+static void _peerReactorConnected(BRPeerReactor *reactor, BRPeerContext *ctx)
+{
+    BRPeer *peer = &ctx->peer;
+    socklen_t optLen = sizeof(int);
+    int socket = _peerGetSocket(ctx), err = 0;
+
+    if (getsockopt(socket, SOL_SOCKET, SO_ERROR, &err, &optLen) < 0) err = errno;
+
+    if (err) {
+        peer_log(peer, "connect error: %s", strerror(err));
+        ctx->error = err;
+        return;
+    }
+
+    ctx->connecting = 0;
+#if PEER_REACTOR_EPOLL
+    _peerReactorWatch(reactor, ctx, socket, EPOLL_CTL_MOD);
+#endif
+    peer_log(peer, "socket connected");
+    ctx->startTime = _peerCurrentTime();
+    BRPeerSendVersionMessage(peer);
+}
+
+// frames and dispatches every complete message in the receive buffer, returns an errno.h code on failure
+static int _peerReactorDispatch(BRPeerContext *ctx, double time)
+{
+    BRPeer *peer = &ctx->peer;
+    UInt256 hash;
+    int error = 0;
+
+    while (! error && ctx->recvEnd - ctx->recvStart >= sizeof(uint32_t)) {
+        uint8_t *header = &ctx->recvBuf[ctx->recvStart];
+        size_t i, len = ctx->recvEnd - ctx->recvStart;
+
+        // skip anything before the magic number in one step
+        for (i = 0; i + sizeof(uint32_t) <= len && UInt32GetLE(&header[i]) != ctx->magicNumber; i++);
+        ctx->recvStart += i;
+        header += i;
+        len -= i;
+        if (len < HEADER_LENGTH) break;
+
+        const char *type = (const char *)(&header[4]);
+        uint32_t msgLen = UInt32GetLE(&header[16]);
+        uint32_t checksum = UInt32GetLE(&header[20]);
+
+        if (header[15] != 0) { // verify header type field is NULL terminated
+            peer_log(peer, "malformed message header: type not NULL terminated");
+            error = EPROTO;
+        }
+        else if (msgLen > MAX_MSG_LENGTH) { // check message length
+            peer_log(peer, "error reading %s, message length %"PRIu32" is too long", type, msgLen);
+            error = EPROTO;
+        }
+        else if (len < HEADER_LENGTH + msgLen) { // wait for the rest of the payload
+            if (ctx->msgTimeout == DBL_MAX) ctx->msgTimeout = time + MESSAGE_TIMEOUT;
+            break;
+        }
+        else {
+            BRSHA256_2(&hash, &header[HEADER_LENGTH], msgLen);
+            ctx->recvStart += HEADER_LENGTH + msgLen;
+            ctx->msgTimeout = DBL_MAX;
+
+            if (UInt32GetLE(&hash) != checksum) { // verify checksum
+                peer_log(peer, "error reading %s, invalid checksum %x, expected %x, payload length:%"PRIu32
+                         ", SHA256_2:%s", type, UInt32GetLE(&hash), checksum, msgLen, u256hex(hash));
                 error = EPROTO;
             }
-            else if (len == HEADER_LENGTH) {
-                const char *type = (const char *)(&header[4]);
-                uint32_t msgLen = UInt32GetLE(&header[16]);
-                uint32_t checksum = UInt32GetLE(&header[20]);
-                UInt256 hash;
-                
-                if (msgLen > MAX_MSG_LENGTH) { // check message length
-                    peer_log(peer, "error reading %s, message length %"PRIu32" is too long", type, msgLen);
-                    error = EPROTO;
-                }
-                else {
-                    if (msgLen > payloadLen) payload = realloc(payload, (payloadLen = msgLen));
-                    assert(payload != NULL);
-                    len = 0;
-                    socket = _peerGetSocket(ctx);
-                    msgTimeout = time + MESSAGE_TIMEOUT;
-                    
-                    while (socket >= 0 && ! error && len < msgLen) {
-                        n = read(socket, &payload[len], msgLen - len);
-                        if (n > 0) len += n;
-                        if (n == 0) error = ECONNRESET;
-                        if (n < 0 && errno != EWOULDBLOCK) error = errno;
-                        gettimeofday(&tv, NULL);
-                        time = tv.tv_sec + (double)tv.tv_usec/1000000;
-                        if (n > 0) msgTimeout = time + MESSAGE_TIMEOUT;
-                        if (! error && time >= msgTimeout) error = ETIMEDOUT;
-                        socket = _peerGetSocket(ctx);
-                    }
-                    
-                    if (error) {
-                        peer_log(peer, "%s", strerror(error));
-                    }
-                    else if (len == msgLen) {
-                        BRSHA256_2(&hash, payload, msgLen);
-                        
-                        if (UInt32GetLE(&hash) != checksum) { // verify checksum
-                            peer_log(peer, "error reading %s, invalid checksum %x, expected %x, payload length:%"PRIu32
-                                     ", SHA256_2:%s", type, UInt32GetLE(&hash), checksum, msgLen, u256hex(hash));
-                            error = EPROTO;
-                        }
-                        else if (! _BRPeerAcceptMessage(peer, payload, msgLen, type)) error = EPROTO;
-                    }
-                }
-            }
+            else if (! _BRPeerAcceptMessage(peer, &header[HEADER_LENGTH], msgLen, type)) error = EPROTO;
+            else if (! _peerCheckAndGetSocket(ctx, NULL) || ctx->disconnecting) break; // a handler disconnected
         }
-        
-        free(payload);
     }
 
+    return error;
+}
+
+// reads what's available from the socket into the receive buffer and dispatches complete messages
+static void _peerReactorRead(BRPeerContext *ctx, double time)
+{
+    int socket = _peerGetSocket(ctx);
+    ssize_t n = 0;
+
+    for (int reads = 0; ! ctx->error && reads < PEER_REACTOR_READ_LIMIT; reads++) {
+        size_t pending = ctx->recvEnd - ctx->recvStart, needed = PEER_RECV_BUFFER_SIZE;
+
+        // a partially received message needs room for all of it
+        if (pending >= HEADER_LENGTH && UInt32GetLE(&ctx->recvBuf[ctx->recvStart]) == ctx->magicNumber) {
+            needed = HEADER_LENGTH + UInt32GetLE(&ctx->recvBuf[ctx->recvStart + 16]);
+            if (needed < PEER_RECV_BUFFER_SIZE) needed = PEER_RECV_BUFFER_SIZE;
+        }
+
+        if (ctx->recvStart > 0 && ctx->recvCapacity - ctx->recvEnd < PEER_RECV_BUFFER_SIZE/4) { // compact
+            memmove(ctx->recvBuf, &ctx->recvBuf[ctx->recvStart], pending);
+            ctx->recvStart = 0;
+            ctx->recvEnd = pending;
+        }
+
+        if (needed > ctx->recvCapacity && needed <= HEADER_LENGTH + MAX_MSG_LENGTH) {
+            if (ctx->recvStart > 0) memmove(ctx->recvBuf, &ctx->recvBuf[ctx->recvStart], pending);
+            ctx->recvStart = 0;
+            ctx->recvEnd = pending;
+            ctx->recvBuf = realloc(ctx->recvBuf, needed);
+            assert(ctx->recvBuf != NULL);
+            ctx->recvCapacity = needed;
+        }
+
+        n = read(socket, &ctx->recvBuf[ctx->recvEnd], ctx->recvCapacity - ctx->recvEnd);
+
+        if (n > 0) {
+            ctx->recvEnd += n;
+            if (ctx->msgTimeout != DBL_MAX) ctx->msgTimeout = time + MESSAGE_TIMEOUT;
+            ctx->error = _peerReactorDispatch(ctx, time);
+            if (ctx->recvStart == ctx->recvEnd) ctx->recvStart = ctx->recvEnd = 0;
+        }
+        else if (n == 0) ctx->error = ECONNRESET;
+        else if (errno == EWOULDBLOCK || errno == EAGAIN) break;
+        else if (errno != EINTR) ctx->error = errno;
+    }
+}
+
+// sends as much of the send buffer as the socket has room for, returns an errno.h code on failure, sendLock held
+static int _peerSendBuffered(BRPeerContext *ctx, int socket, double time)
+{
+    ssize_t n = 0;
+    int error = 0;
+
+    while (! error && ctx->sendStart < ctx->sendEnd) {
+        n = send(socket, &ctx->sendBuf[ctx->sendStart], ctx->sendEnd - ctx->sendStart, MSG_NOSIGNAL);
+
+        if (n > 0) {
+            ctx->sendStart += n;
+            ctx->sendTimeout = time + MESSAGE_TIMEOUT;
+        }
+        else if (n < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) break;
+        else if (n < 0 && errno != EINTR) error = errno;
+    }
+
+    if (ctx->sendStart == ctx->sendEnd) ctx->sendStart = ctx->sendEnd = 0;
+    return error;
+}
+
+// flushes the peer's send buffer, watching for room in the socket's send buffer while bytes remain unsent
+static void _peerReactorWrite(BRPeerReactor *reactor, BRPeerContext *ctx, double time)
+{
+    int socket = _peerGetSocket(ctx), pending;
+
+    if (ctx->error || ctx->connecting || socket < 0) return;
+    pthread_mutex_lock(&ctx->sendLock);
+    ctx->error = _peerSendBuffered(ctx, socket, time);
+    pending = (ctx->sendStart < ctx->sendEnd);
+    if (! ctx->error && pending && time >= ctx->sendTimeout) ctx->error = ETIMEDOUT;
+    pthread_mutex_unlock(&ctx->sendLock);
+
+    if (! ctx->error && pending != ctx->sendWatched) {
+        ctx->sendWatched = pending;
+#if PEER_REACTOR_EPOLL
+        _peerReactorWatch(reactor, ctx, socket, EPOLL_CTL_MOD);
+#endif
+    }
+}
+
+// checks the peer's disconnect, mempool and message timers
+static void _peerReactorCheckTimers(BRPeerContext *ctx, double time)
+{
+    BRPeer *peer = &ctx->peer;
+
+    if (ctx->error) return;
+
+    if (time >= _peerGetDisconnectTime(ctx) || time >= ctx->msgTimeout) {
+        ctx->error = ETIMEDOUT;
+    }
+    else if (! ctx->connecting && time >= _peerGetMempoolTime(ctx)) {
+        peer_log(peer, "done waiting for mempool response");
+        BRPeerSendPing(peer, ctx->mempoolInfo, ctx->mempoolCallback);
+        ctx->mempoolCallback = NULL;
+
+        pthread_mutex_lock(&ctx->lock);
+        ctx->mempoolTime = DBL_MAX;
+        pthread_mutex_unlock(&ctx->lock);
+    }
+}
+
+// closes the peer's socket and reports the disconnect, after which ctx may have been freed by the callbacks
+static void _peerReactorClose(BRPeerReactor *reactor, BRPeerContext *ctx)
+{
+    BRPeer *peer = &ctx->peer;
+    void (*threadCleanup)(void *) = ctx->threadCleanup;
+    void *info = ctx->info;
+    int socket, error = ctx->error;
+
+    pthread_mutex_lock(&reactor->lock);
+    for (size_t i = array_count(reactor->peers); i > 0; i--) {
+        if (reactor->peers[i - 1] == ctx) array_rm(reactor->peers, i - 1);
+    }
+    pthread_mutex_unlock(&reactor->lock);
+
     pthread_mutex_lock(&ctx->lock);
     socket = ctx->socket;
+    ctx->socket = -1;
     ctx->status = BRPeerStatusDisconnected;
+    ctx->reactor = NULL;
     pthread_mutex_unlock(&ctx->lock);
 
+#if PEER_REACTOR_EPOLL
+    if (socket >= 0) epoll_ctl(reactor->epoll, EPOLL_CTL_DEL, socket, NULL);
+#endif
     if (socket >= 0) close(socket);
+    if (error) peer_log(peer, "%s", strerror(error));
     peer_log(peer, "disconnected");
-    
+
+    free(ctx->recvBuf);
+    ctx->recvBuf = NULL;
+    ctx->recvStart = ctx->recvEnd = ctx->recvCapacity = 0;
+    ctx->sendWatched = 0;
+
+    pthread_mutex_lock(&ctx->sendLock);
+    free(ctx->sendBuf);
+    ctx->sendBuf = NULL;
+    ctx->sendStart = ctx->sendEnd = ctx->sendCapacity = 0;
+    pthread_mutex_unlock(&ctx->sendLock);
+
     while (array_count(ctx->pongCallback) > 0) {
         void (*pongCallback)(void *, int) = ctx->pongCallback[0];
         void *pongInfo = ctx->pongInfo[0];
-        
+
         array_rm(ctx->pongCallback, 0);
         array_rm(ctx->pongInfo, 0);
         if (pongCallback) pongCallback(pongInfo, 0);
@@ -1111,10 +1616,143 @@ static void *_peerThreadRoutine(void *arg)
     if (ctx->mempoolCallback) ctx->mempoolCallback(ctx->mempoolInfo, 0);
     ctx->mempoolCallback = NULL;
     if (ctx->disconnected) ctx->disconnected(ctx->info, error);
-    pthread_cleanup_pop(1);
+    threadCleanup(info);
+}
+
+static void *_peerReactorThreadRoutine(void *arg)
+{
+    BRPeerReactor *reactor = arg;
+    BRPeerContext **peers, **ready;
+    double time;
+
+#if defined (__ANDROID__)
+    pthread_setname_np(reactor->thread, "Core Bitcoin Peer Reactor");
+#elif defined (__APPLE__)
+    pthread_setname_np("Core Bitcoin Peer Reactor");
+#endif
+
+    array_new(peers, 10);
+    array_new(ready, 10);
+
+    while (1) {
+        pthread_mutex_lock(&reactor->lock);
+        array_clear(peers);
+        array_add_array(peers, reactor->peers, array_count(reactor->peers));
+        pthread_mutex_unlock(&reactor->lock);
+        array_clear(ready);
+
+#if PEER_REACTOR_EPOLL
+        struct epoll_event events[64];
+        int count = epoll_wait(reactor->epoll, events, 64, PEER_REACTOR_WAIT_MS);
+
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.ptr == NULL) _peerReactorDrain(reactor);
+            else array_add(ready, events[i].data.ptr);
+        }
+#else
+        struct pollfd fds[array_count(peers) + 1];
+        BRPeerContext *fdPeers[array_count(peers) + 1];
+        nfds_t fdCount = 1;
+
+        fds[0] = (struct pollfd) { reactor->wake[0], POLLIN, 0 };
+
+        for (size_t i = 0; i < array_count(peers); i++) {
+            int socket = _peerGetSocket(peers[i]);
+
+            if (socket < 0 || peers[i]->error) continue;
+            fdPeers[fdCount] = peers[i];
+            fds[fdCount++] = (struct pollfd) { socket, (peers[i]->connecting) ? POLLOUT :
+                                               (peers[i]->sendWatched) ? POLLIN | POLLOUT : POLLIN, 0 };
+        }
+
+        if (poll(fds, fdCount, PEER_REACTOR_WAIT_MS) > 0) {
+            if (fds[0].revents) _peerReactorDrain(reactor);
+
+            for (nfds_t i = 1; i < fdCount; i++) {
+                if (fds[i].revents) array_add(ready, fdPeers[i]);
+            }
+        }
+#endif
+
+        time = _peerCurrentTime();
+
+        for (size_t i = 0; i < array_count(ready); i++) {
+            if (ready[i]->error) continue;
+            else if (ready[i]->connecting) _peerReactorConnected(reactor, ready[i]);
+            else _peerReactorRead(ready[i], time);
+        }
+
+        for (size_t i = 0; i < array_count(peers); i++) {
+            if (! peers[i]->error && peers[i]->disconnecting) peers[i]->error = ECONNRESET;
+            _peerReactorWrite(reactor, peers[i], time);
+            _peerReactorCheckTimers(peers[i], time);
+            if (peers[i]->error) _peerReactorClose(reactor, peers[i]);
+        }
+    }
+
     return NULL; // detached threads don't need to return a value
 }
 
+static void _peerReactorsStart(void)
+{
+    for (size_t i = 0; i < PEER_REACTOR_COUNT; i++) {
+        BRPeerReactor *reactor = &_peerReactors[i];
+        pthread_attr_t attr;
+        int ok;
+
+        pthread_mutex_init(&reactor->lock, NULL);
+        array_new(reactor->peers, 10);
+        ok = (pipe(reactor->wake) == 0);
+        if (ok) fcntl(reactor->wake[0], F_SETFL, fcntl(reactor->wake[0], F_GETFL, NULL) | O_NONBLOCK);
+        if (ok) fcntl(reactor->wake[1], F_SETFL, fcntl(reactor->wake[1], F_GETFL, NULL) | O_NONBLOCK);
+
+#if PEER_REACTOR_EPOLL
+        struct epoll_event event = { EPOLLIN, { .ptr = NULL } };
+
+        reactor->epoll = (ok) ? epoll_create1(0) : -1;
+        ok = (ok && reactor->epoll >= 0 && epoll_ctl(reactor->epoll, EPOLL_CTL_ADD, reactor->wake[0], &event) == 0);
+#endif
+
+        ok = (ok && pthread_attr_init(&attr) == 0);
+
+        if (ok) {
+            ok = (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) == 0 &&
+                  pthread_attr_setstacksize(&attr, PTHREAD_STACK_SIZE) == 0 &&
+                  pthread_create(&reactor->thread, &attr, _peerReactorThreadRoutine, reactor) == 0);
+            pthread_attr_destroy(&attr);
+        }
+
+        reactor->running = ok;
+        if (! ok) _peer_log("error creating peer reactor thread");
+    }
+}
+
+// hands a connecting peer to the least loaded reactor, returns false if no reactor is running
+static int _peerReactorAdd(BRPeerContext *ctx)
+{
+    BRPeerReactor *reactor = NULL;
+    int socket;
+
+    pthread_once(&_peerReactorsOnce, _peerReactorsStart);
+
+    for (size_t i = 0; i < PEER_REACTOR_COUNT; i++) {
+        if (! _peerReactors[i].running) continue;
+        if (! reactor || array_count(_peerReactors[i].peers) < array_count(reactor->peers)) reactor = &_peerReactors[i];
+    }
+
+    if (! reactor) return 0;
+    ctx->reactor = reactor;
+    socket = ctx->socket;
+#if PEER_REACTOR_EPOLL
+    if (socket >= 0) _peerReactorWatch(reactor, ctx, socket, EPOLL_CTL_ADD);
+#endif
+    pthread_mutex_lock(&reactor->lock);
+    array_add(reactor->peers, ctx);
+    pthread_mutex_unlock(&reactor->lock);
+    _peerReactorWake(reactor);
+    return 1;
+}
+
 static void _dummyThreadCleanup(void *info)
 {
 }
@@ -1126,6 +1764,7 @@ BRPeer *BRPeerNew(uint32_t magicNumber)
     
     assert(ctx != NULL);
     ctx->magicNumber = magicNumber;
+    ctx->maxProofOfWork = BLOCK_MAX_PROOF_OF_WORK;
     array_new(ctx->useragent, 40);
     array_new(ctx->knownBlockHashes, 10);
     array_new(ctx->currentBlockTxHashes, 10);
@@ -1144,6 +1783,7 @@ BRPeer *BRPeerNew(uint32_t magicNumber)
         pthread_mutexattr_init(&attr);
         pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL);
         pthread_mutex_init(&ctx->lock, &attr);
+        pthread_mutex_init(&ctx->sendLock, &attr);
         pthread_mutexattr_destroy(&attr);
     }
 
@@ -1157,11 +1797,14 @@ BRPeer *BRPeerNew(uint32_t magicNumber)
 // void relayedTx(void *, BRTransaction *) - called when a "tx" message is received from peer
 // void hasTx(void *, UInt256 txHash) - called when an "inv" message with an already-known tx hash is received from peer
 // void rejectedTx(void *, UInt256 txHash, uint8_t) - called when a "reject" message is received from peer
-// void relayedBlock(void *, BRMerkleBlock *) - called when a "merkleblock" or "headers" message is received from peer
+// void relayedBlock(void *, BRMerkleBlock *) - called when a "merkleblock", "block" or "headers" message is received
+//                                               from peer (headers newer than a week before earliestKeyTime are not
+//                                               relayed unless in block filter mode)
 // void notfound(void *, const UInt256[], size_t, const UInt256[], size_t) - called when "notfound" message is received
 // BRTransaction *requestedTx(void *, UInt256) - called when "getdata" message with a tx hash is received from peer
 // int networkIsReachable(void *) - must return true when networking is available, false otherwise
-// void threadCleanup(void *) - called before a thread terminates to faciliate any needed cleanup
+// void threadCleanup(void *) - called after disconnected(), once the network thread is done with peer, to faciliate any
+//                              needed cleanup (callbacks run on one of a few network threads shared by all peers)
 void BRPeerSetCallbacks(BRPeer *peer, void *info,
                         void (*connected)(void *info),
                         void (*disconnected)(void *info, int error),
@@ -1194,12 +1837,45 @@ void BRPeerSetCallbacks(BRPeer *peer, void *info,
     ctx->threadCleanup = (threadCleanup) ? threadCleanup : _dummyThreadCleanup;
 }
 
+// setting these callbacks switches peer to BIP157 block filter mode, where all headers are relayed, full blocks are
+// requested with getdata instead of merkleblocks, and new block announcements are followed with getheaders
+// void relayedFilterHeaders(void *, UInt256, UInt256, const UInt256[], size_t) - called when a "cfheaders" message is
+//                                                                               received from peer
+// void relayedFilter(void *, UInt256, const uint8_t *, size_t) - called when a "cfilter" message is received from peer
+void BRPeerSetBlockFilterCallbacks(BRPeer *peer,
+                                   void (*relayedFilterHeaders)(void *info, UInt256 stopHash, UInt256 prevFilterHeader,
+                                                                const UInt256 filterHashes[], size_t count),
+                                   void (*relayedFilter)(void *info, UInt256 blockHash, const uint8_t *filter,
+                                                         size_t filterLen))
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+
+    ctx->relayedFilterHeaders = relayedFilterHeaders;
+    ctx->relayedFilter = relayedFilter;
+}
+
+// setting this callback relays the headers of each "headers" message together, in order, instead of one at a time
+// through relayedBlock(), once they've all had their proof-of-work checked
+// void relayedHeaders(void *, BRMerkleBlock *[], size_t) - called with the headers of a "headers" message, which the
+//                                                           callback takes ownership of (but not of the array)
+void BRPeerSetRelayedHeadersCallback(BRPeer *peer,
+                                     void (*relayedHeaders)(void *info, BRMerkleBlock *headers[], size_t count))
+{
+    ((BRPeerContext *)peer)->relayedHeaders = relayedHeaders;
+}
+
 // set earliestKeyTime to wallet creation time in order to speed up initial sync
 void BRPeerSetEarliestKeyTime(BRPeer *peer, uint32_t earliestKeyTime)
 {
     ((BRPeerContext *)peer)->earliestKeyTime = earliestKeyTime;
 }
 
+// set maxProofOfWork to the chain's highest difficulty target, BLOCK_MAX_PROOF_OF_WORK unless set
+void BRPeerSetMaxProofOfWork(BRPeer *peer, uint32_t maxProofOfWork)
+{
+    ((BRPeerContext *)peer)->maxProofOfWork = maxProofOfWork;
+}
+
 // call this when local block height changes (helps detect tarpit nodes)
 void BRPeerSetCurrentBlockHeight(BRPeer *peer, uint32_t currentBlockHeight)
 {
@@ -1223,11 +1899,10 @@ BRPeerStatus BRPeerConnectStatus(BRPeer *peer)
 void BRPeerConnect(BRPeer *peer)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
-    struct timeval tv;
-    pthread_attr_t attr;
+    int error = 0;
 
     pthread_mutex_lock(&ctx->lock);
-    if (ctx->status == BRPeerStatusDisconnected || ctx->waitingForNetwork) {
+    if ((ctx->status == BRPeerStatusDisconnected || ctx->waitingForNetwork) && ! ctx->reactor) {
         ctx->status = BRPeerStatusConnecting;
     
         if (ctx->networkIsReachable && ! ctx->networkIsReachable(ctx->info)) { // delay until network is reachable
@@ -1237,25 +1912,20 @@ void BRPeerConnect(BRPeer *peer)
         else {
             peer_log(peer, "connecting");
             ctx->waitingForNetwork = 0;
-            gettimeofday(&tv, NULL);
 
-            // No race - set before the thread starts.
-            ctx->disconnectTime = tv.tv_sec + (double)tv.tv_usec/1000000 + CONNECT_TIMEOUT;
+            // No race - set before the reactor sees the peer.
+            ctx->disconnectTime = _peerCurrentTime() + CONNECT_TIMEOUT;
+            ctx->msgTimeout = DBL_MAX;
+            ctx->disconnecting = 0;
+            ctx->connecting = 1;
+            ctx->socket = _BRPeerOpenSocket(peer, PF_INET6, &error);
+            ctx->error = error; // a failed connect is reported by the reactor, the same as any other disconnect
 
-            if (pthread_attr_init(&attr) != 0) {
-                // error = ENOMEM;
+            if (! _peerReactorAdd(ctx)) {
                 peer_log(peer, "error creating thread");
+                if (ctx->socket >= 0) close(ctx->socket);
+                ctx->socket = -1;
                 ctx->status = BRPeerStatusDisconnected;
-                //if (ctx->disconnected) ctx->disconnected(ctx->info, error);
-            }
-            else if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0 ||
-                     pthread_attr_setstacksize(&attr, PTHREAD_STACK_SIZE) != 0 ||
-                     pthread_create(&ctx->thread, &attr, _peerThreadRoutine, peer) != 0) {
-                // error = EAGAIN;
-                peer_log(peer, "error creating thread");
-                pthread_attr_destroy(&attr);
-                ctx->status = BRPeerStatusDisconnected;
-                //if (ctx->disconnected) ctx->disconnected(ctx->info, error);
             }
         }
     }
@@ -1266,15 +1936,19 @@ void BRPeerConnect(BRPeer *peer)
 void BRPeerDisconnect(BRPeer *peer)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
+    BRPeerReactor *reactor;
     int socket = -1;
 
     if (_peerCheckAndGetSocket(ctx, &socket)) {
         pthread_mutex_lock(&ctx->lock);
         ctx->status = BRPeerStatusDisconnected;
+        ctx->disconnecting = 1;
+        reactor = ctx->reactor;
         pthread_mutex_unlock(&ctx->lock);
 
+        // the reactor closes the socket once it has finished with it
         if (shutdown(socket, SHUT_RDWR) < 0) peer_log(peer, "%s", strerror(errno));
-        close(socket);
+        if (reactor) _peerReactorWake(reactor);
     }
 }
 
@@ -1348,10 +2022,6 @@ uint64_t BRPeerFeePerKb(BRPeer *peer)
     return feePerKb;
 }
 
-#ifndef MSG_NOSIGNAL   // linux based systems have a MSG_NOSIGNAL send flag, useful for supressing SIGPIPE signals
-#define MSG_NOSIGNAL 0 // set to 0 if undefined (BSD has the SO_NOSIGPIPE sockopt, and windows has no signals at all)
-#endif
-
 // sends a bitcoin protocol message to peer
 void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const char *type)
 {
@@ -1360,10 +2030,10 @@ void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const ch
     }
     else {
         BRPeerContext *ctx = (BRPeerContext *)peer;
+        BRPeerReactor *reactor;
         uint8_t buf[HEADER_LENGTH + msgLen], hash[32];
-        size_t off = 0;
+        size_t off = 0, pending;
         ssize_t n = 0;
-        struct timeval tv;
         int socket, error = 0;
         
         UInt32SetLE(&buf[off], ctx->magicNumber);
@@ -1376,20 +2046,46 @@ void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const ch
         memcpy(&buf[off], hash, sizeof(uint32_t));
         off += sizeof(uint32_t);
         memcpy(&buf[off], msg, msgLen);
+        off = 0;
         peer_log(peer, "sending %s", type);
-        msgLen = 0;
+        pthread_mutex_lock(&ctx->sendLock);
         socket = _peerGetSocket(ctx);
+        pending = ctx->sendEnd - ctx->sendStart;
         if (socket < 0) error = ENOTCONN;
-        
-        while (socket >= 0 && ! error && msgLen < sizeof(buf)) {
-            n = send(socket, &buf[msgLen], sizeof(buf) - msgLen, MSG_NOSIGNAL);
-            if (n >= 0) msgLen += n;
-            if (n < 0 && errno != EWOULDBLOCK) error = errno;
-            gettimeofday(&tv, NULL);
-            if (! error && tv.tv_sec + (double)tv.tv_usec/1000000 >= _peerGetDisconnectTime(ctx)) error = ETIMEDOUT;
-            socket = _peerGetSocket(ctx);
+        else if (pending > 0 && pending + sizeof(buf) > PEER_SEND_BUFFER_LIMIT) error = ENOBUFS; // peer isn't keeping up
+
+        while (! error && pending == 0 && off < sizeof(buf)) { // nothing queued ahead of it, try sending right away
+            n = send(socket, &buf[off], sizeof(buf) - off, MSG_NOSIGNAL);
+            if (n > 0) off += n;
+            else if (n < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) break;
+            else if (n < 0 && errno != EINTR) error = errno;
         }
-        
+
+        if (! error && off < sizeof(buf)) { // leave the rest for the reactor to send when the socket has room
+            if (ctx->sendStart > 0) memmove(ctx->sendBuf, &ctx->sendBuf[ctx->sendStart], pending);
+            ctx->sendStart = 0;
+            ctx->sendEnd = pending;
+
+            if (pending + sizeof(buf) - off > ctx->sendCapacity) {
+                ctx->sendCapacity = pending + sizeof(buf) - off;
+                ctx->sendBuf = realloc(ctx->sendBuf, ctx->sendCapacity);
+                assert(ctx->sendBuf != NULL);
+            }
+
+            memcpy(&ctx->sendBuf[ctx->sendEnd], &buf[off], sizeof(buf) - off);
+            ctx->sendEnd += sizeof(buf) - off;
+            if (pending == 0) ctx->sendTimeout = _peerCurrentTime() + MESSAGE_TIMEOUT;
+        }
+
+        pthread_mutex_unlock(&ctx->sendLock);
+
+        if (! error && pending == 0 && off < sizeof(buf)) { // have the reactor start watching for room to send
+            pthread_mutex_lock(&ctx->lock);
+            reactor = ctx->reactor;
+            pthread_mutex_unlock(&ctx->lock);
+            if (reactor) _peerReactorWake(reactor);
+        }
+
         if (error) {
             peer_log(peer, "%s", strerror(error));
             BRPeerDisconnect(peer);
@@ -1582,8 +2278,8 @@ void BRPeerSendGetdata(BRPeer *peer, const UInt256 txHashes[], size_t txCount, c
             off += sizeof(UInt256);
         }
         
-        for (i = 0; i < blockCount; i++) {
-            UInt32SetLE(&msg[off], inv_filtered_block);
+        for (i = 0; i < blockCount; i++) { // block filter mode fetches whole blocks, bloom filter mode merkleblocks
+            UInt32SetLE(&msg[off], (((BRPeerContext *)peer)->relayedFilter) ? inv_witness_block : inv_filtered_block);
             off += sizeof(uint32_t);
             UInt256Set(&msg[off], blockHashes[i]);
             off += sizeof(UInt256);
@@ -1615,6 +2311,32 @@ void BRPeerSendPing(BRPeer *peer, void *info, void (*pongCallback)(void *info, i
 }
 
 // useful to get additional tx after a bloom filter update
+// BIP157 getcfheaders/getcfilters, for basic filters of the blocks from startHeight through the block with stopHash
+static void _BRPeerSendFilterRequest(BRPeer *peer, const char *type, uint32_t startHeight, UInt256 stopHash)
+{
+    uint8_t msg[sizeof(uint8_t) + sizeof(uint32_t) + sizeof(UInt256)];
+    size_t off = 0;
+
+    msg[off] = 0; // basic filter type
+    off += sizeof(uint8_t);
+    UInt32SetLE(&msg[off], startHeight);
+    off += sizeof(uint32_t);
+    UInt256Set(&msg[off], stopHash);
+    off += sizeof(UInt256);
+    peer_log(peer, "calling %s from %"PRIu32" to %s", type, startHeight, u256hex(stopHash));
+    BRPeerSendMessage(peer, msg, off, type);
+}
+
+void BRPeerSendGetcfheaders(BRPeer *peer, uint32_t startHeight, UInt256 stopHash)
+{
+    _BRPeerSendFilterRequest(peer, MSG_GETCFHEADERS, startHeight, stopHash);
+}
+
+void BRPeerSendGetcfilters(BRPeer *peer, uint32_t startHeight, UInt256 stopHash)
+{
+    _BRPeerSendFilterRequest(peer, MSG_GETCFILTERS, startHeight, stopHash);
+}
+
 void BRPeerRerequestBlocks(BRPeer *peer, UInt256 fromBlock)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
@@ -1640,7 +2362,10 @@ void BRPeerFree(BRPeer *peer)
     if (ctx->knownTxHashSet) BRSetFree(ctx->knownTxHashSet);
     if (ctx->pongCallback) array_free(ctx->pongCallback);
     if (ctx->pongInfo) array_free(ctx->pongInfo);
+    if (ctx->recvBuf) free(ctx->recvBuf);
+    if (ctx->sendBuf) free(ctx->sendBuf);
     
+    pthread_mutex_destroy(&ctx->sendLock);
     pthread_mutex_destroy(&ctx->lock);
     free(ctx);
 }
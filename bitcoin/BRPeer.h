@@ -56,6 +56,7 @@ extern "C" {
 #define SERVICES_NODE_BLOOM   0x04 // BIP111: https://github.com/bitcoin/bips/blob/master/bip-0111.mediawiki
 #define SERVICES_NODE_WITNESS 0x08 // BIP144: https://github.com/bitcoin/bips/blob/master/bip-0144.mediawiki
 #define SERVICES_NODE_BCASH   0x20 // https://github.com/Bitcoin-UAHF/spec/blob/master/uahf-technical-spec.md
+#define SERVICES_NODE_COMPACT_FILTERS 0x40 // BIP157: https://github.com/bitcoin/bips/blob/master/bip-0157.mediawiki
     
 #define BR_VERSION "2.1"
 #define USER_AGENT "/bread:" BR_VERSION "/"
@@ -83,6 +84,10 @@ extern "C" {
 #define MSG_ALERT       "alert"
 #define MSG_REJECT      "reject"   // described in BIP61: https://github.com/bitcoin/bips/blob/master/bip-0061.mediawiki
 #define MSG_FEEFILTER   "feefilter"// described in BIP133 https://github.com/bitcoin/bips/blob/master/bip-0133.mediawiki
+#define MSG_GETCFILTERS "getcfilters" // described in BIP157 https://github.com/bitcoin/bips/blob/master/bip-0157.mediawiki
+#define MSG_CFILTER     "cfilter"
+#define MSG_GETCFHEADERS "getcfheaders"
+#define MSG_CFHEADERS   "cfheaders"
 
 #define REJECT_INVALID     0x10 // transaction is invalid for some reason (invalid signature, output value > input, etc)
 #define REJECT_SPENT       0x12 // an input is already spent
@@ -118,11 +123,14 @@ BRPeer *BRPeerNew(uint32_t magicNumber);
 // void relayedTx(void *, BRTransaction *) - called when a "tx" message is received from peer
 // void hasTx(void *, UInt256 txHash) - called when an "inv" message with an already-known tx hash is received from peer
 // void rejectedTx(void *, UInt256 txHash, uint8_t) - called when a "reject" message is received from peer
-// void relayedBlock(void *, BRMerkleBlock *) - called when a "merkleblock" or "headers" message is received from peer
+// void relayedBlock(void *, BRMerkleBlock *) - called when a "merkleblock", "block" or "headers" message is received
+//                                               from peer (headers newer than a week before earliestKeyTime are not
+//                                               relayed unless in block filter mode)
 // void notfound(void *, const UInt256[], size_t, const UInt256[], size_t) - called when "notfound" message is received
 // BRTransaction *requestedTx(void *, UInt256) - called when "getdata" message with a tx hash is received from peer
 // int networkIsReachable(void *) - must return true when networking is available, false otherwise
-// void threadCleanup(void *) - called before a thread terminates to faciliate any needed cleanup    
+// void threadCleanup(void *) - called after disconnected(), once the network thread is done with peer, to faciliate any
+//                              needed cleanup (callbacks run on one of a few network threads shared by all peers)
 void BRPeerSetCallbacks(BRPeer *peer, void *info,
                         void (*connected)(void *info),
                         void (*disconnected)(void *info, int error),
@@ -138,9 +146,30 @@ void BRPeerSetCallbacks(BRPeer *peer, void *info,
                         int (*networkIsReachable)(void *info),
                         void (*threadCleanup)(void *info));
 
+// setting these callbacks switches peer to BIP157 block filter mode, where all headers are relayed, full blocks are
+// requested with getdata instead of merkleblocks, and new block announcements are followed with getheaders
+// void relayedFilterHeaders(void *, UInt256, UInt256, const UInt256[], size_t) - called when a "cfheaders" message is
+//                                                                               received from peer
+// void relayedFilter(void *, UInt256, const uint8_t *, size_t) - called when a "cfilter" message is received from peer
+void BRPeerSetBlockFilterCallbacks(BRPeer *peer,
+                                   void (*relayedFilterHeaders)(void *info, UInt256 stopHash, UInt256 prevFilterHeader,
+                                                                const UInt256 filterHashes[], size_t count),
+                                   void (*relayedFilter)(void *info, UInt256 blockHash, const uint8_t *filter,
+                                                         size_t filterLen));
+
+// setting this callback relays the headers of each "headers" message together, in order, instead of one at a time
+// through relayedBlock(), once they've all had their proof-of-work checked
+// void relayedHeaders(void *, BRMerkleBlock *[], size_t) - called with the headers of a "headers" message, which the
+//                                                           callback takes ownership of (but not of the array)
+void BRPeerSetRelayedHeadersCallback(BRPeer *peer,
+                                     void (*relayedHeaders)(void *info, BRMerkleBlock *headers[], size_t count));
+
 // set earliestKeyTime to wallet creation time in order to speed up initial sync
 void BRPeerSetEarliestKeyTime(BRPeer *peer, uint32_t earliestKeyTime);
 
+// set maxProofOfWork to the chain's highest difficulty target, BLOCK_MAX_PROOF_OF_WORK unless set
+void BRPeerSetMaxProofOfWork(BRPeer *peer, uint32_t maxProofOfWork);
+
 // call this when local best block height changes (helps detect tarpit nodes)
 void BRPeerSetCurrentBlockHeight(BRPeer *peer, uint32_t currentBlockHeight);
 
@@ -189,6 +218,8 @@ void BRPeerSendGetdata(BRPeer *peer, const UInt256 txHashes[], size_t txCount, c
                        size_t blockCount);
 void BRPeerSendGetaddr(BRPeer *peer);
 void BRPeerSendPing(BRPeer *peer, void *info, void (*pongCallback)(void *info, int success));
+void BRPeerSendGetcfheaders(BRPeer *peer, uint32_t startHeight, UInt256 stopHash);
+void BRPeerSendGetcfilters(BRPeer *peer, uint32_t startHeight, UInt256 stopHash);
 
 // useful to get additional tx after a bloom filter update
 void BRPeerRerequestBlocks(BRPeer *peer, UInt256 fromBlock);
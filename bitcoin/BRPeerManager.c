@@ -24,6 +24,7 @@
 
 #include "BRPeerManager.h"
 #include "BRBloomFilter.h"
+#include "BRBlockFilter.h"
 #include "BRSet.h"
 #include "BRArray.h"
 #include "BRInt.h"
@@ -43,6 +44,18 @@
 #define MAX_CONNECT_FAILURES  20 // notify user of network problems after this many connect failures in a row
 #define PEER_FLAG_SYNCED      0x01
 #define PEER_FLAG_NEEDSUPDATE 0x02
+#define FILTER_SCAN_AHEAD     2000 // headers past earliestKeyTime to queue ahead of the chain while checking filters
+
+// states of a header waiting on its block filter in block filter mode
+#define FILTER_BLOCK_NEEDS_HEADER 0 // waiting for its filter hash in a cfheaders message
+#define FILTER_BLOCK_NEEDS_FILTER 1 // filter hash known, waiting for the filter
+#define FILTER_BLOCK_CHECKED      2 // filter checked against the wallet scripts
+#define FILTER_BLOCK_REQUESTED    3 // filter matched, and the full block was requested
+#define FILTER_BLOCK_RECEIVED     4 // full block received
+
+#define FILTER_REQUEST_NONE    0
+#define FILTER_REQUEST_HEADERS 1
+#define FILTER_REQUEST_FILTERS 2
 
 #define genesis_block_hash(params) UInt256Reverse((params)->checkpoints[0].hash)
 
@@ -133,6 +146,14 @@ static int _BRTxPeerListRemovePeer(BRTxPeerList *list, UInt256 txHash, const BRP
     return 0;
 }
 
+// a header past earliestKeyTime, waiting in block filter mode for its BIP158 filter to be checked before it's added to
+// the chain, or replaced by the full block if the filter matched the wallet
+typedef struct {
+    BRMerkleBlock *block;
+    UInt256 filterHash, filterHeader;
+    int state, matched;
+} BRFilterBlock;
+
 // comparator for sorting peers by timestamp, most recent first
 inline static int _peerTimestampCompare(const void *peer, const void *otherPeer)
 {
@@ -177,7 +198,16 @@ struct BRPeerManagerStruct {
     double fpRate, averageTxPerBlock;
     BRSet *blocks, *orphans, *checkpoints;
     BRMerkleBlock *lastBlock, *lastOrphan;
+    BRHeaderStore *headerStore;
     BRTxPeerList *txRelays, *txRequests;
+    int useBlockFilters, isScanningFilters, filterRequest;
+    BRFilterBlock *filterBlocks; // headers waiting on block filters in chain order, starting at index filterHead
+    size_t filterHead, filterRequestCount;
+    BRMerkleBlock *scannedBlock; // filter block being added to the chain
+    UInt256 filterHeader, filterHeaderBlockHash; // filter header of the last block taken from filterBlocks
+    UInt256 filterRequestStop, filterHeadersFrom, filterOrphanPrev;
+    uint8_t *filterScriptData;
+    BRBlockFilterElement *filterScripts; // wallet output scripts that block filters are matched against
     BRPublishedTx *publishedTx;
     UInt256 *publishedTxHashes;
     void *info;
@@ -238,6 +268,39 @@ static void _BRPeerManagerAddTxToPublishList(BRPeerManager *manager, BRTransacti
     }
 }
 
+// returns the block with blockHash, paging it in from the header store if it has been pruned from memory
+static BRMerkleBlock *_BRPeerManagerBlock(BRPeerManager *manager, UInt256 blockHash)
+{
+    BRMerkleBlock *block = BRSetGet(manager->blocks, &blockHash);
+
+    if (! block && manager->headerStore) {
+        block = BRHeaderStoreBlockForHash(manager->headerStore, blockHash);
+        if (block) BRSetAdd(manager->blocks, block);
+    }
+
+    return block;
+}
+
+// true if the header store holds the main chain up to lastBlock
+static int _BRPeerManagerHeaderStoreIsCurrent(BRPeerManager *manager)
+{
+    return (manager->headerStore && manager->lastBlock &&
+            UInt256Eq(BRHeaderStoreHashAtHeight(manager->headerStore, manager->lastBlock->height),
+                      manager->lastBlock->blockHash));
+}
+
+// appends block, which extends the main chain, to the header store, restarting the store from block if it doesn't
+// connect to the stored headers
+static void _BRPeerManagerStoreHeader(BRPeerManager *manager, BRMerkleBlock *block)
+{
+    if (! manager->headerStore || UInt256IsZero(block->merkleRoot)) return; // checkpoints don't have a full header
+
+    if (! BRHeaderStoreAdd(manager->headerStore, block)) {
+        BRHeaderStoreTruncate(manager->headerStore, 0);
+        BRHeaderStoreAdd(manager->headerStore, block);
+    }
+}
+
 static size_t _BRPeerManagerBlockLocators(BRPeerManager *manager, UInt256 locators[], size_t locatorsCount)
 {
     // append 10 most recent block hashes, decending, then continue appending, doubling the step back each time,
@@ -245,6 +308,18 @@ static size_t _BRPeerManagerBlockLocators(BRPeerManager *manager, UInt256 locato
     BRMerkleBlock *block = manager->lastBlock;
     int32_t step = 1, i = 0, j;
     
+    if (_BRPeerManagerHeaderStoreIsCurrent(manager)) { // look up locators by height rather than walking the chain
+        uint32_t height = block->height, first = BRHeaderStoreFirstHeight(manager->headerStore);
+
+        while (height > 0 && height >= first) {
+            if (locators && i < locatorsCount) locators[i] = BRHeaderStoreHashAtHeight(manager->headerStore, height);
+            if (++i >= 10) step *= 2;
+            height = (height > (uint32_t)step) ? height - (uint32_t)step : 0;
+        }
+
+        block = NULL;
+    }
+
     while (block && block->height > 0) {
         if (locators && i < locatorsCount) locators[i] = block->blockHash;
         if (++i >= 10) step *= 2;
@@ -258,6 +333,81 @@ static size_t _BRPeerManagerBlockLocators(BRPeerManager *manager, UInt256 locato
     return ++i;
 }
 
+/// MARK: - Block Filter Scan
+
+// rebuilds the wallet output scripts that block filters are matched against, generating spare addresses the same way
+// the bloom filter does, so the scripts don't need rebuilding for each wallet tx found, returns the number of scripts
+static size_t _BRPeerManagerLoadFilterScripts(BRPeerManager *manager)
+{
+    BRWalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL_EXTENDED, SEQUENCE_EXTERNAL_CHAIN);
+    BRWalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL_EXTENDED, SEQUENCE_INTERNAL_CHAIN);
+
+    size_t i, off, len, addrsCount = BRWalletAllAddrs(manager->wallet, NULL, 0);
+    BRAddress *addrs = malloc(addrsCount*sizeof(*addrs));
+    uint8_t script[42]; // large enough for any address script
+
+    assert(addrs != NULL);
+    addrsCount = BRWalletAllAddrs(manager->wallet, addrs, addrsCount);
+    array_clear(manager->filterScriptData);
+    array_clear(manager->filterScripts);
+
+    for (i = 0; i < addrsCount; i++) {
+        len = BRAddressScriptPubKey(script, sizeof(script), manager->params->addrParams, addrs[i].s);
+        if (len == 0) continue;
+        array_add_array(manager->filterScriptData, script, len);
+        array_add(manager->filterScripts, ((const BRBlockFilterElement) { NULL, len }));
+    }
+
+    for (i = 0, off = 0; i < array_count(manager->filterScripts); i++) { // data can move while it grows, so set it last
+        manager->filterScripts[i].data = &manager->filterScriptData[off];
+        off += manager->filterScripts[i].dataLen;
+    }
+
+    free(addrs);
+    return array_count(manager->filterScripts);
+}
+
+// drops the headers waiting on block filters from index i on, along with any filter request that covered them
+static void _BRPeerManagerTruncateFilterBlocks(BRPeerManager *manager, size_t i)
+{
+    size_t count = array_count(manager->filterBlocks);
+
+    if (i < manager->filterHead) i = manager->filterHead;
+    for (size_t j = i; j < count; j++) BRMerkleBlockFree(manager->filterBlocks[j].block);
+
+    if (i < count) {
+        array_set_count(manager->filterBlocks, i);
+        manager->filterRequest = FILTER_REQUEST_NONE;
+        manager->filterHeadersFrom = UINT256_ZERO;
+    }
+
+    if (manager->filterHead == array_count(manager->filterBlocks)) { // empty, so start over at the front
+        array_clear(manager->filterBlocks);
+        manager->filterHead = 0;
+    }
+}
+
+// drops all the headers waiting on block filters, and any requests for them
+static void _BRPeerManagerClearFilterBlocks(BRPeerManager *manager)
+{
+    _BRPeerManagerTruncateFilterBlocks(manager, 0);
+    manager->filterRequest = FILTER_REQUEST_NONE;
+    manager->filterHeadersFrom = UINT256_ZERO;
+    manager->filterOrphanPrev = UINT256_ZERO;
+}
+
+// sends getheaders to peer for the headers following the last one waiting on a block filter, or following the chain
+static void _BRPeerManagerFilterGetheaders(BRPeerManager *manager, BRPeer *peer)
+{
+    size_t n = array_count(manager->filterBlocks), tail = (n > manager->filterHead) ? 1 : 0,
+           count = tail + _BRPeerManagerBlockLocators(manager, NULL, 0);
+    UInt256 locators[count];
+
+    if (tail) locators[0] = manager->filterBlocks[n - 1].block->blockHash;
+    count = tail + _BRPeerManagerBlockLocators(manager, &locators[tail], count - tail);
+    BRPeerSendGetheaders(peer, locators, count, UINT256_ZERO);
+}
+
 static void _setApplyFreeBlock(void *info, void *block)
 {
     BRMerkleBlockFree(block);
@@ -600,7 +750,11 @@ static void _BRPeerManagerLoadMempools(BRPeerManager *manager)
         info->peer = peer;
         info->manager = manager;
         
-        if (peer != manager->downloadPeer || manager->fpRate > BLOOM_REDUCED_FALSEPOSITIVE_RATE*5.0) {
+        if (manager->useBlockFilters) { // without a bloom filter there's no mempool to load, just publish pending tx
+            _BRPeerManagerPublishPendingTx(manager, peer);
+            BRPeerSendPing(peer, info, _mempoolDone);
+        }
+        else if (peer != manager->downloadPeer || manager->fpRate > BLOOM_REDUCED_FALSEPOSITIVE_RATE*5.0) {
             _BRPeerManagerLoadBloomFilter(manager, peer);
             _BRPeerManagerPublishPendingTx(manager, peer);
             BRPeerSendPing(peer, info, _loadBloomFilterDone); // load mempool after updating bloomfilter
@@ -733,7 +887,13 @@ static void _peerConnected(void *info)
         peer_log(peer, "node isn't synced");
         BRPeerDisconnect(peer);
     }
-    else if (BRPeerVersion(peer) >= 70011 && (peer->services & SERVICES_NODE_BLOOM) != SERVICES_NODE_BLOOM) {
+    else if (manager->useBlockFilters &&
+             (peer->services & SERVICES_NODE_COMPACT_FILTERS) != SERVICES_NODE_COMPACT_FILTERS) {
+        peer_log(peer, "node doesn't serve compact block filters");
+        BRPeerDisconnect(peer);
+    }
+    else if (! manager->useBlockFilters && BRPeerVersion(peer) >= 70011 &&
+             (peer->services & SERVICES_NODE_BLOOM) != SERVICES_NODE_BLOOM) {
         peer_log(peer, "node doesn't support SPV mode");
         BRPeerDisconnect(peer);
     }
@@ -742,13 +902,13 @@ static void _peerConnected(void *info)
               manager->lastBlock->height >= BRPeerLastBlock(peer))) {
         if (manager->lastBlock->height >= BRPeerLastBlock(peer)) { // only load bloom filter if we're done syncing
             manager->connectFailureCount = 0; // also reset connect failure count if we're already synced
-            _BRPeerManagerLoadBloomFilter(manager, peer);
+            if (! manager->useBlockFilters) _BRPeerManagerLoadBloomFilter(manager, peer);
             _BRPeerManagerPublishPendingTx(manager, peer);
             peerInfo = calloc(1, sizeof(*peerInfo));
             assert(peerInfo != NULL);
             peerInfo->peer = peer;
             peerInfo->manager = manager;
-            BRPeerSendPing(peer, peerInfo, _loadBloomFilterDone);
+            BRPeerSendPing(peer, peerInfo, (manager->useBlockFilters) ? _mempoolDone : _loadBloomFilterDone);
         }
     }
     else { // select the peer with the lowest ping time to download the chain from if we're behind
@@ -770,7 +930,8 @@ static void _peerConnected(void *info)
         manager->downloadPeer = peer;
         manager->isConnected = 1;
         manager->estimatedHeight = BRPeerLastBlock(peer);
-        _BRPeerManagerLoadBloomFilter(manager, peer);
+        if (manager->useBlockFilters) _BRPeerManagerLoadFilterScripts(manager);
+        else _BRPeerManagerLoadBloomFilter(manager, peer);
         BRPeerSetCurrentBlockHeight(peer, manager->lastBlock->height);
         _BRPeerManagerPublishPendingTx(manager, peer);
             
@@ -780,9 +941,10 @@ static void _peerConnected(void *info)
             
             BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // schedule sync timeout
 
-            // request just block headers up to a week before earliestKeyTime, and then merkleblocks after that
+            // request just block headers up to a week before earliestKeyTime, and then merkleblocks after that (in block
+            // filter mode it's headers all the way, with the blocks after that checked against their filters)
             // we do not reset connect failure count yet incase this request times out
-            if (manager->lastBlock->timestamp + 7*24*60*60 >= manager->earliestKeyTime) {
+            if (manager->lastBlock->timestamp + 7*24*60*60 >= manager->earliestKeyTime && ! manager->useBlockFilters) {
                 BRPeerSendGetblocks(peer, locators, count, UINT256_ZERO);
             }
             else BRPeerSendGetheaders(peer, locators, count, UINT256_ZERO);
@@ -836,6 +998,7 @@ static void _peerDisconnected(void *info, int error)
     if (peer == manager->downloadPeer) { // download peer disconnected
         manager->isConnected = 0;
         manager->downloadPeer = NULL;
+        _BRPeerManagerClearFilterBlocks(manager); // the next download peer picks up filters where the chain left off
         if (manager->connectFailureCount > MAX_CONNECT_FAILURES) manager->connectFailureCount = MAX_CONNECT_FAILURES;
     }
 
@@ -937,7 +1100,9 @@ static void _peerRelayedTx(void *info, BRTransaction *tx)
         BRPeerScheduleDisconnect(peer, -1); // cancel publish tx timeout
     }
 
-    if (manager->syncStartHeight == 0 || BRWalletContainsTransaction(manager->wallet, tx)) {
+    // in block filter mode tx only arrive in full blocks, most of which aren't wallet tx
+    if ((manager->syncStartHeight == 0 && ! manager->useBlockFilters) ||
+        BRWalletContainsTransaction(manager->wallet, tx)) {
         isWalletTx = BRWalletRegisterTransaction(manager->wallet, tx);
         if (isWalletTx) tx = BRWalletTransactionForHash(manager->wallet, tx->txHash);
     }
@@ -1091,7 +1256,7 @@ static int _BRPeerManagerVerifyBlock(BRPeerManager *manager, BRMerkleBlock *bloc
         UInt256 prevBlock;
 
         for (uint32_t i = 0; b && i < BLOCK_DIFFICULTY_INTERVAL; i++) {
-            b = BRSetGet(manager->blocks, &b->prevBlock);
+            b = _BRPeerManagerBlock(manager, b->prevBlock);
         }
 
         if (! b) {
@@ -1100,11 +1265,12 @@ static int _BRPeerManagerVerifyBlock(BRPeerManager *manager, BRMerkleBlock *bloc
         }
         else prevBlock = b->prevBlock;
 
-        while (b) { // free up some memory
+        while (b) { // free up some memory, older transition blocks can be paged back in if there's a header store
             b = BRSetGet(manager->blocks, &prevBlock);
             if (b) prevBlock = b->prevBlock;
 
-            if (b && (b->height % BLOCK_DIFFICULTY_INTERVAL) != 0) {
+            if (b && ((b->height % BLOCK_DIFFICULTY_INTERVAL) != 0 ||
+                      (manager->headerStore && ! BRSetContains(manager->checkpoints, b)))) {
                 BRSetRemove(manager->blocks, b);
                 BRMerkleBlockFree(b);
             }
@@ -1141,6 +1307,282 @@ static void _peerRelayedBlockFailed (BRMerkleBlock *blockToFree, BRPeer *peer, c
     assert (0);
 }
 
+static void _peerRelayedBlock(void *info, BRMerkleBlock *block);
+
+// with manager->lock held, adds headers that extend the main chain to it in order, verifying the difficulty of each
+// against the headers before it, then stores them and saves any transition blocks together, in place of a
+// _peerRelayedBlock() call for each, returns the number of headers added from the start of headers, stopping at the
+// first that isn't a plain valid extension of the chain (those are left to the caller), or after the header that an
+// orphan, returned in next, was waiting on
+static size_t _BRPeerManagerCommitHeaders(BRPeerManager *manager, BRPeer *peer, BRMerkleBlock *headers[], size_t count,
+                                          BRMerkleBlock **next)
+{
+    BRMerkleBlock orphan, *block, *saveBlocks[count];
+    size_t i, saveCount = 0;
+
+    *next = NULL;
+    if (! manager->lastBlock || ! manager->downloadPeer || (! manager->bloomFilter && ! manager->useBlockFilters)) {
+        return 0;
+    }
+
+    for (i = 0; i < count && ! *next; i++) {
+        block = headers[i];
+
+        // headers near earliestKeyTime, at the tip, or already received, go through _peerRelayedBlock()
+        if (block->totalTx > 0 || block == manager->scannedBlock ||
+            block->timestamp + 7*24*60*60 - 2*60*60 > manager->earliestKeyTime ||
+            ! UInt256Eq(block->prevBlock, manager->lastBlock->blockHash) ||
+            manager->lastBlock->height + 1 >= manager->estimatedHeight ||
+            manager->lastBlock->height + 1 >= BRPeerLastBlock(peer)) break;
+
+        block->height = manager->lastBlock->height + 1;
+        if (! _BRPeerManagerVerifyBlock(manager, block, manager->lastBlock, peer)) break;
+        if ((block->height % 500) == 0) peer_log(peer, "adding block #%"PRIu32, block->height);
+        BRSetAdd(manager->blocks, block);
+        manager->lastBlock = block;
+        _BRPeerManagerStoreHeader(manager, block);
+
+        if ((block->height % BLOCK_DIFFICULTY_INTERVAL) == 0 && block->height + 100 < manager->estimatedHeight) {
+            saveBlocks[saveCount++] = block; // save transition blocks immediately
+        }
+
+        if (BRSetCount(manager->orphans) > 0) { // check if the next block was received as an orphan
+            orphan.prevBlock = block->blockHash;
+            *next = BRSetRemove(manager->orphans, &orphan);
+        }
+    }
+
+    if (i > 0) {
+        BRPeerSetCurrentBlockHeight(manager->downloadPeer, manager->lastBlock->height);
+
+        if (peer == manager->downloadPeer) {
+            BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
+            manager->connectFailureCount = 0; // reset failure count once we know our initial request didn't timeout
+        }
+    }
+
+    if (saveCount > 0 && manager->saveBlocks) manager->saveBlocks(manager->info, 0, saveBlocks, saveCount);
+    return i;
+}
+
+// in block filter mode, takes a header past earliestKeyTime from the download peer to wait on its block filter, or a
+// full block requested for a matching filter, returns false if block should be handled as a regular relayed block
+static int _BRPeerManagerAddFilterBlock(BRPeerManager *manager, BRPeer *peer, BRMerkleBlock *block)
+{
+    BRFilterBlock *blocks;
+    BRMerkleBlock *prev;
+    size_t i, count;
+    int r = 1;
+
+    pthread_mutex_lock(&manager->lock);
+    blocks = manager->filterBlocks;
+    count = array_count(blocks);
+    i = manager->filterHead;
+
+    if (! manager->useBlockFilters || block == manager->scannedBlock) {
+        r = 0;
+    }
+    else if (block->totalTx > 0) { // only full blocks whose filters matched are requested
+        if (i < count && blocks[i].state == FILTER_BLOCK_REQUESTED &&
+            UInt256Eq(blocks[i].block->blockHash, block->blockHash)) {
+            block->height = blocks[i].block->height;
+            BRMerkleBlockFree(blocks[i].block);
+            blocks[i].block = block;
+            blocks[i].state = FILTER_BLOCK_RECEIVED;
+        }
+        else {
+            peer_log(peer, "dropping unrequested block %s", u256hex(block->blockHash));
+            BRMerkleBlockFree(block);
+        }
+    }
+    else if (block->timestamp + 7*24*60*60 - 2*60*60 <= manager->earliestKeyTime) {
+        r = 0; // older headers are added to the chain directly
+    }
+    else if (peer != manager->downloadPeer) { // filters are only requested from the download peer
+        BRMerkleBlockFree(block);
+    }
+    else {
+        while (i < count && ! UInt256Eq(blocks[i].block->prevBlock, block->prevBlock)) i++;
+
+        if (i < count && UInt256Eq(blocks[i].block->blockHash, block->blockHash)) { // already waiting
+            BRMerkleBlockFree(block);
+        }
+        else if (i < count || (count > manager->filterHead &&
+                               UInt256Eq(block->prevBlock, blocks[count - 1].block->blockHash))) {
+            // block either extends the headers waiting on filters, or forks from them and replaces what follows
+            block->height = (i < count) ? blocks[i].block->height : blocks[count - 1].block->height + 1;
+            _BRPeerManagerTruncateFilterBlocks(manager, i);
+            array_add(manager->filterBlocks, ((const BRFilterBlock) { block, UINT256_ZERO, UINT256_ZERO,
+                                                                      FILTER_BLOCK_NEEDS_HEADER, 0 }));
+        }
+        else if ((prev = _BRPeerManagerBlock(manager, block->prevBlock)) &&
+                 (prev == manager->lastBlock || ! BRSetContains(manager->blocks, block))) {
+            // block follows the chain, or a fork of it, so the waiting headers start over from block
+            block->height = prev->height + 1;
+            _BRPeerManagerTruncateFilterBlocks(manager, 0);
+            array_add(manager->filterBlocks, ((const BRFilterBlock) { block, UINT256_ZERO, UINT256_ZERO,
+                                                                      FILTER_BLOCK_NEEDS_HEADER, 0 }));
+        }
+        else if (prev) { // already in the chain
+            BRMerkleBlockFree(block);
+        }
+        else {
+            // ask for the headers leading up to an orphan, unless we already did
+            if (! UInt256Eq(manager->filterOrphanPrev, block->prevBlock)) {
+                peer_log(peer, "relayed orphan header %s, previous %s", u256hex(block->blockHash),
+                         u256hex(block->prevBlock));
+                manager->filterOrphanPrev = block->prevBlock;
+                _BRPeerManagerFilterGetheaders(manager, peer);
+            }
+
+            BRMerkleBlockFree(block);
+        }
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+    return r;
+}
+
+// requests filter hashes or filters for the first headers that need them, one request at a time
+static void _BRPeerManagerRequestFilters(BRPeerManager *manager, BRPeer *peer)
+{
+    BRFilterBlock *blocks = manager->filterBlocks;
+    size_t i = manager->filterHead, j, count = array_count(blocks);
+
+    while (i < count && blocks[i].state != FILTER_BLOCK_NEEDS_FILTER &&
+           blocks[i].state != FILTER_BLOCK_NEEDS_HEADER) i++;
+    if (i == count) return;
+
+    if (blocks[i].state == FILTER_BLOCK_NEEDS_FILTER) { // up to 1000 filters per getcfilters (BIP157)
+        for (j = i; j + 1 < count && j + 1 - i < 1000 && blocks[j + 1].state == FILTER_BLOCK_NEEDS_FILTER; j++);
+        manager->filterRequest = FILTER_REQUEST_FILTERS;
+        BRPeerSendGetcfilters(peer, blocks[i].block->height, blocks[j].block->blockHash);
+    }
+    else { // up to 2000 filter hashes per getcfheaders, and headers needing them are always last
+        j = (count - i > 2000) ? i + 1999 : count - 1;
+        manager->filterRequest = FILTER_REQUEST_HEADERS;
+        BRPeerSendGetcfheaders(peer, blocks[i].block->height, blocks[j].block->blockHash);
+    }
+
+    manager->filterRequestStop = blocks[j].block->blockHash;
+    manager->filterRequestCount = j + 1 - i;
+    BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
+}
+
+// adds headers whose filters didn't match the wallet to the chain in order, along with full blocks for the filters
+// that did, and keeps filters and headers downloading ahead of the chain
+static void _BRPeerManagerScanFilters(BRPeerManager *manager, void *info)
+{
+    BRFilterBlock *blocks;
+    BRMerkleBlock *tail;
+    size_t i, j, head, count;
+    int matched;
+
+    pthread_mutex_lock(&manager->lock);
+
+    if (manager->isScanningFilters) { // another thread is already scanning, and will pick these up too
+        pthread_mutex_unlock(&manager->lock);
+        return;
+    }
+
+    manager->isScanningFilters = 1;
+
+    while (array_count(manager->filterBlocks) > manager->filterHead) {
+        blocks = manager->filterBlocks;
+        i = head = manager->filterHead;
+        count = array_count(blocks);
+        matched = 0;
+
+        // take the checked headers from the front of the queue, up to and including the first full block
+        while (i < count && blocks[i].state == FILTER_BLOCK_CHECKED && ! blocks[i].matched) i++;
+        if (i < count && blocks[i].state == FILTER_BLOCK_RECEIVED) i++, matched = 1;
+
+        if (i == head) { // the first header is waiting on its filter, or on its full block
+            if (blocks[i].state == FILTER_BLOCK_CHECKED && manager->downloadPeer) {
+                blocks[i].state = FILTER_BLOCK_REQUESTED;
+                BRPeerSendGetdata(manager->downloadPeer, NULL, 0, &blocks[i].block->blockHash, 1);
+            }
+
+            break;
+        }
+
+        BRMerkleBlock *scanned[i - head];
+
+        for (j = head; j < i; j++) scanned[j - head] = blocks[j].block;
+        manager->filterHeader = blocks[i - 1].filterHeader;
+        manager->filterHeaderBlockHash = blocks[i - 1].block->blockHash;
+        manager->filterHead = i;
+
+        if (manager->filterHead == count || manager->filterHead >= FILTER_SCAN_AHEAD) { // reclaim the taken entries
+            array_rm_range(manager->filterBlocks, 0, manager->filterHead);
+            manager->filterHead = 0;
+        }
+
+        if (matched) { // keep just the wallet tx from the full block, as if it were a merkleblock
+            BRMerkleBlock *block = scanned[i - head - 1];
+            size_t txCount = BRMerkleBlockTxHashes(block, NULL, 0);
+            UInt256 *txHashes = malloc(txCount*sizeof(*txHashes));
+            uint8_t *isWalletTx = malloc(txCount);
+
+            assert(txHashes != NULL && isWalletTx != NULL);
+            txCount = BRMerkleBlockTxHashes(block, txHashes, txCount);
+
+            for (j = 0; j < txCount; j++) {
+                isWalletTx[j] = (BRWalletTransactionForHash(manager->wallet, txHashes[j]) != NULL);
+            }
+
+            BRMerkleBlockSetMatchedTxHashes(block, txHashes, txCount, isWalletTx);
+            free(isWalletTx);
+            free(txHashes);
+        }
+
+        for (j = 0; j < i - head; j++) {
+            manager->scannedBlock = scanned[j];
+            pthread_mutex_unlock(&manager->lock);
+            _peerRelayedBlock(info, scanned[j]);
+            pthread_mutex_lock(&manager->lock);
+        }
+
+        manager->scannedBlock = NULL;
+
+        // wallet tx in the full block may have used up addresses, in which case the filters that didn't match the old
+        // scripts need to be checked again
+        if (matched && array_count(manager->filterScripts) < _BRPeerManagerLoadFilterScripts(manager)) {
+            for (j = manager->filterHead; j < array_count(manager->filterBlocks); j++) {
+                if (manager->filterBlocks[j].state == FILTER_BLOCK_CHECKED && ! manager->filterBlocks[j].matched) {
+                    manager->filterBlocks[j].state = FILTER_BLOCK_NEEDS_FILTER;
+                }
+            }
+        }
+    }
+
+    count = array_count(manager->filterBlocks);
+    tail = (count > manager->filterHead) ? manager->filterBlocks[count - 1].block : manager->lastBlock;
+
+    if (manager->downloadPeer && manager->filterRequest == FILTER_REQUEST_NONE) {
+        _BRPeerManagerRequestFilters(manager, manager->downloadPeer);
+    }
+
+    // past earliestKeyTime headers are requested as the queue drains, so they don't get too far ahead of the filters,
+    // and not while the last batch is still arriving, which shows as headers at the tail without filter headers yet
+    if (manager->downloadPeer && count - manager->filterHead < FILTER_SCAN_AHEAD &&
+        (count == manager->filterHead || manager->filterBlocks[count - 1].state != FILTER_BLOCK_NEEDS_HEADER) &&
+        tail->height < BRPeerLastBlock(manager->downloadPeer) &&
+        tail->timestamp + 7*24*60*60 - 2*60*60 > manager->earliestKeyTime &&
+        ! UInt256Eq(tail->blockHash, manager->filterHeadersFrom)) {
+        manager->filterHeadersFrom = tail->blockHash;
+        _BRPeerManagerFilterGetheaders(manager, manager->downloadPeer);
+        BRPeerScheduleDisconnect(manager->downloadPeer, PROTOCOL_TIMEOUT); // reschedule sync timeout
+    }
+
+    // once synced, cancel the timeout for the last filter request when there's nothing more to wait for
+    if (manager->syncStartHeight == 0 && count == manager->filterHead &&
+        manager->filterRequest == FILTER_REQUEST_NONE) _BRPeerManagerSyncStopped(manager);
+
+    manager->isScanningFilters = 0;
+    pthread_mutex_unlock(&manager->lock);
+}
+
 static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
 {
     if (NULL == info || NULL == block) {
@@ -1159,6 +1601,12 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         return;
     }
 
+    // in block filter mode, headers past earliestKeyTime are added to the chain once their filters are checked
+    if (_BRPeerManagerAddFilterBlock(manager, peer, block)) {
+        _BRPeerManagerScanFilters(manager, info);
+        return;
+    }
+
     // Check manager - ensure anything dereferenced subsequently is valid
     if (NULL == manager->blocks ||
         NULL == manager->wallet ||
@@ -1190,7 +1638,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     }
     
     // track the observed bloom filter false positive rate using a low pass filter to smooth out variance
-    if (peer == manager->downloadPeer && block->totalTx > 0) {
+    if (peer == manager->downloadPeer && block->totalTx > 0 && ! manager->useBlockFilters) {
         for (i = 0; i < txCount; i++) { // wallet tx are not false-positives
             if (! BRWalletTransactionForHash(manager->wallet, txHashes[i])) fpCount++;
         }
@@ -1216,11 +1664,14 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     }
 
     // ignore block headers that are newer than one week before earliestKeyTime (it's a header if it has 0 totalTx)
-    if (block->totalTx == 0 && block->timestamp + 7*24*60*60 - 2*60*60 > manager->earliestKeyTime) {
+    // (unless it's a header whose block filter was checked)
+    if (block->totalTx == 0 && block->timestamp + 7*24*60*60 - 2*60*60 > manager->earliestKeyTime &&
+        block != manager->scannedBlock) {
         BRMerkleBlockFree(block);
         block = NULL;
     }
-    else if (manager->bloomFilter == NULL) { // ingore potentially incomplete blocks when a filter update is pending
+    else if (manager->bloomFilter == NULL && ! manager->useBlockFilters) {
+        // ingore potentially incomplete blocks when a filter update is pending
         BRMerkleBlockFree(block);
         block = NULL;
 
@@ -1246,8 +1697,14 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
                 size_t locatorsCount = _BRPeerManagerBlockLocators(manager, locators,
                                                                    sizeof(locators)/sizeof(*locators));
                 
-                peer_log(peer, "calling getblocks");
-                BRPeerSendGetblocks(peer, locators, locatorsCount, UINT256_ZERO);
+                if (manager->useBlockFilters) {
+                    peer_log(peer, "calling getheaders");
+                    BRPeerSendGetheaders(peer, locators, locatorsCount, UINT256_ZERO);
+                }
+                else {
+                    peer_log(peer, "calling getblocks");
+                    BRPeerSendGetblocks(peer, locators, locatorsCount, UINT256_ZERO);
+                }
             }
             
             BRSetAdd(manager->orphans, block); // BUG: limit total orphans to avoid memory exhaustion attack
@@ -1267,6 +1724,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         
         BRSetAdd(manager->blocks, block);
         manager->lastBlock = block;
+        _BRPeerManagerStoreHeader(manager, block);
         if (txCount > 0) BRWalletUpdateTransactions(manager->wallet, txHashes, txCount, block->height, txTime);
         if (manager->downloadPeer) BRPeerSetCurrentBlockHeight(manager->downloadPeer, block->height);
             
@@ -1290,7 +1748,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         }
         
         b = manager->lastBlock;
-        while (b && b->height > block->height) b = BRSetGet(manager->blocks, &b->prevBlock); // is block in main chain?
+        while (b && b->height > block->height) b = _BRPeerManagerBlock(manager, b->prevBlock); // is block in main chain?
 
         if (NULL == b) {
             _peerRelayedBlockFailed (block, peer, "In 'already have a block' missed 'b'");
@@ -1333,8 +1791,8 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
             b2 = manager->lastBlock;
             
             while (b && b2 && ! BRMerkleBlockEq(b, b2)) { // walk back to where the fork joins the main chain
-                b = BRSetGet(manager->blocks, &b->prevBlock);
-                if (b && b->height < b2->height) b2 = BRSetGet(manager->blocks, &b2->prevBlock);
+                b = _BRPeerManagerBlock(manager, b->prevBlock);
+                if (b && b->height < b2->height) b2 = _BRPeerManagerBlock(manager, b2->prevBlock);
             }
 
             if (NULL == b) {
@@ -1368,6 +1826,19 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
             }
         
             manager->lastBlock = block;
+
+            if (manager->headerStore && b2) { // replace the stored headers after the join point with the new main chain
+                BRMerkleBlock **chain;
+
+                array_new(chain, block->height - b2->height);
+
+                for (b = block; b && b->height > b2->height; b = BRSetGet(manager->blocks, &b->prevBlock)) {
+                    array_add(chain, b);
+                }
+
+                for (i = array_count(chain); i > 0; i--) _BRPeerManagerStoreHeader(manager, chain[i - 1]);
+                array_free(chain);
+            }
             
             if (block->height == manager->estimatedHeight) { // chain download is complete
                 saveCount = (block->height % BLOCK_DIFFICULTY_INTERVAL) + BLOCK_DIFFICULTY_INTERVAL + 1;
@@ -1415,6 +1886,113 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     if (next) _peerRelayedBlock(info, next);
 }
 
+// headers from a "headers" message arrive here already hashed with their proof-of-work checked, those that extend the
+// main chain during the regular chain download are verified in order and committed together under a single lock, and
+// any others go through _peerRelayedBlock() one at a time
+static void _peerRelayedHeaders(void *info, BRMerkleBlock *headers[], size_t count)
+{
+    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
+    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    BRMerkleBlock *next = NULL;
+    size_t i = 0, n;
+
+    while (i < count) {
+        pthread_mutex_lock(&manager->lock);
+        n = _BRPeerManagerCommitHeaders(manager, peer, &headers[i], count - i, &next);
+        pthread_mutex_unlock(&manager->lock);
+        i += n;
+        if (next) _peerRelayedBlock(info, next);
+        if (n == 0) _peerRelayedBlock(info, headers[i++]);
+    }
+}
+
+static void _peerRelayedFilterHeaders(void *info, UInt256 stopHash, UInt256 prevFilterHeader,
+                                      const UInt256 filterHashes[], size_t count)
+{
+    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
+    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    BRFilterBlock *blocks;
+    UInt256 header;
+    size_t i, n;
+    int misbehavin = 0;
+
+    pthread_mutex_lock(&manager->lock);
+    blocks = manager->filterBlocks;
+    n = array_count(blocks);
+    i = manager->filterHead;
+    while (i < n && blocks[i].state != FILTER_BLOCK_NEEDS_HEADER) i++;
+
+    if (peer != manager->downloadPeer || manager->filterRequest != FILTER_REQUEST_HEADERS ||
+        ! UInt256Eq(stopHash, manager->filterRequestStop) || count != manager->filterRequestCount || i + count > n ||
+        ! UInt256Eq(blocks[i + count - 1].block->blockHash, stopHash)) {
+        peer_log(peer, "ignoring unexpected cfheaders up to %s", u256hex(stopHash));
+    }
+    else {
+        // verify the filter hashes continue the filter header chain, the first filter header after connecting to a
+        // new download peer is taken on trust, much like the first block header after a checkpoint
+        if (i > manager->filterHead) header = blocks[i - 1].filterHeader;
+        else if (UInt256Eq(blocks[i].block->prevBlock, manager->filterHeaderBlockHash)) header = manager->filterHeader;
+        else header = prevFilterHeader;
+
+        if (! UInt256Eq(header, prevFilterHeader)) {
+            peer_log(peer, "relayed cfheaders that don't connect to the filter header chain, previous %s, expected %s",
+                     u256hex(prevFilterHeader), u256hex(header));
+            misbehavin = 1;
+        }
+        else {
+            for (size_t j = 0; j < count; j++) {
+                header = BRBlockFilterHeader(filterHashes[j], header);
+                blocks[i + j].filterHash = filterHashes[j];
+                blocks[i + j].filterHeader = header;
+                blocks[i + j].state = FILTER_BLOCK_NEEDS_FILTER;
+            }
+
+            manager->filterRequest = FILTER_REQUEST_NONE;
+        }
+    }
+
+    if (misbehavin) _BRPeerManagerPeerMisbehavin(manager, peer);
+    pthread_mutex_unlock(&manager->lock);
+    if (! misbehavin) _BRPeerManagerScanFilters(manager, info);
+}
+
+static void _peerRelayedFilter(void *info, UInt256 blockHash, const uint8_t *filter, size_t filterLen)
+{
+    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
+    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    BRFilterBlock *blocks;
+    size_t i, n;
+    int misbehavin = 0;
+
+    pthread_mutex_lock(&manager->lock);
+    blocks = manager->filterBlocks;
+    n = array_count(blocks);
+    i = manager->filterHead;
+    while (i < n && blocks[i].state != FILTER_BLOCK_NEEDS_FILTER) i++; // filters arrive in chain order
+    while (i < n && ! UInt256Eq(blocks[i].block->blockHash, blockHash)) i++;
+
+    if (peer != manager->downloadPeer || i == n || blocks[i].state != FILTER_BLOCK_NEEDS_FILTER) {
+        peer_log(peer, "ignoring unexpected cfilter for block %s", u256hex(blockHash));
+    }
+    else if (! UInt256Eq(BRBlockFilterHash(filter, filterLen), blocks[i].filterHash)) {
+        peer_log(peer, "relayed cfilter that doesn't match its filter header, block %s", u256hex(blockHash));
+        misbehavin = 1;
+    }
+    else {
+        blocks[i].matched = BRBlockFilterMatchAny(filter, filterLen, blockHash, manager->filterScripts,
+                                                  array_count(manager->filterScripts));
+        blocks[i].state = FILTER_BLOCK_CHECKED;
+        if (blocks[i].matched) peer_log(peer, "block filter matched wallet at height %"PRIu32, blocks[i].block->height);
+
+        if (manager->filterRequest == FILTER_REQUEST_FILTERS && manager->filterRequestCount > 0 &&
+            --manager->filterRequestCount == 0) manager->filterRequest = FILTER_REQUEST_NONE;
+    }
+
+    if (misbehavin) _BRPeerManagerPeerMisbehavin(manager, peer);
+    pthread_mutex_unlock(&manager->lock);
+    if (! misbehavin) _BRPeerManagerScanFilters(manager, info);
+}
+
 static void _peerDataNotfound(void *info, const UInt256 txHashes[], size_t txCount,
                              const UInt256 blockHashes[], size_t blockCount)
 {
@@ -1570,6 +2148,9 @@ BRPeerManager *BRPeerManagerNew(const BRChainParams *params, BRWallet *wallet, u
 
     array_new(manager->txRelays, 10);
     array_new(manager->txRequests, 10);
+    array_new(manager->filterBlocks, 0);
+    array_new(manager->filterScriptData, 0);
+    array_new(manager->filterScripts, 0);
     array_new(manager->publishedTx, 10);
     array_new(manager->publishedTxHashes, 10);
     pthread_mutex_init(&manager->lock, NULL);
@@ -1608,6 +2189,18 @@ void BRPeerManagerSetCallbacks(BRPeerManager *manager, void *info,
     manager->threadCleanup = (threadCleanup) ? threadCleanup : _dummyThreadCleanup;
 }
 
+// not thread-safe, set the header store once before calling BRPeerManagerConnect()
+// verified main chain headers are appended to store, and blocks pruned from memory are paged back in from it as needed
+// so that only a recent window of blocks is kept in memory - store must stay open until the manager is freed
+void BRPeerManagerSetHeaderStore(BRPeerManager *manager, BRHeaderStore *store)
+{
+    assert(manager != NULL);
+    pthread_mutex_lock(&manager->lock);
+    manager->headerStore = store;
+    if (store) _BRPeerManagerStoreHeader(manager, manager->lastBlock);
+    pthread_mutex_unlock(&manager->lock);
+}
+
 // specifies a single fixed peer to use when connecting to the bitcoin network
 // set address to UINT128_ZERO to revert to default behavior
 void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t port)
@@ -1629,6 +2222,17 @@ void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t
     }
 }
 
+// not thread-safe, call once before BRPeerManagerConnect() to sync with BIP157/158 compact block filters instead of
+// bloom filters - the filters of blocks after earliestKeyTime are checked against wallet addresses, and only the blocks
+// whose filters match are downloaded in full, so peers learn nothing about the wallet, but they must serve filters
+void BRPeerManagerSetUseBlockFilters(BRPeerManager *manager, int useBlockFilters)
+{
+    assert(manager != NULL);
+    pthread_mutex_lock(&manager->lock);
+    manager->useBlockFilters = useBlockFilters;
+    pthread_mutex_unlock(&manager->lock);
+}
+
 // current connect status
 BRPeerStatus BRPeerManagerConnectStatus(BRPeerManager *manager)
 {
@@ -1705,7 +2309,13 @@ void BRPeerManagerConnect(BRPeerManager *manager)
                 BRPeerSetCallbacks(info->peer, info, _peerConnected, _peerDisconnected, _peerRelayedPeers,
                                    _peerRelayedTx, _peerHasTx, _peerRejectedTx, _peerRelayedBlock, _peerDataNotfound,
                                    _peerSetFeePerKb, _peerRequestedTx, _peerNetworkIsReachable, _peerThreadCleanup);
+                BRPeerSetRelayedHeadersCallback(info->peer, _peerRelayedHeaders);
+                if (manager->useBlockFilters) {
+                    BRPeerSetBlockFilterCallbacks(info->peer, _peerRelayedFilterHeaders, _peerRelayedFilter);
+                }
+
                 BRPeerSetEarliestKeyTime(info->peer, manager->earliestKeyTime);
+                BRPeerSetMaxProofOfWork(info->peer, manager->params->maxProofOfWork);
                 BRPeerConnect(info->peer);
 
                 if (BRPeerConnectStatus(info->peer) == BRPeerStatusDisconnected) {
@@ -1771,6 +2381,7 @@ static int _BRPeerManagerRescan(BRPeerManager *manager, BRMerkleBlock *newLastBl
     if (NULL == newLastBlock) return 0;
 
     manager->lastBlock = newLastBlock;
+    _BRPeerManagerClearFilterBlocks(manager);
     _peer_log("BPM: rescanning with %u last block height", manager->lastBlock->height);
 
     if (manager->downloadPeer) { // disconnect the current download peer so a new random one will be selected
@@ -1840,6 +2451,12 @@ static BRMerkleBlock *_BRPeerManagerLookupBlockFromBlockNumber(BRPeerManager *ma
         block = BRSetGet (manager->blocks, &block->prevBlock);
     }
 
+    // blockNumber was pruned from memory - page it in from the header store
+    if (blockNumber < manager->lastBlock->height && _BRPeerManagerHeaderStoreIsCurrent (manager)) {
+        UInt256 hash = BRHeaderStoreHashAtHeight (manager->headerStore, blockNumber);
+        if (! UInt256IsZero (hash)) return _BRPeerManagerBlock (manager, hash);
+    }
+
     // blockNumber not in the (abbreviated) chain - look through checkpoints
     for (int i = 0; i < manager->params->checkpointsCount; i++)
         if (manager->params->checkpoints[i].height == blockNumber) {
@@ -2082,6 +2699,10 @@ void BRPeerManagerFree(BRPeerManager *manager)
     array_free(manager->txRelays);
     for (size_t i = array_count(manager->txRequests); i > 0; i--) array_free(manager->txRequests[i - 1].peers);
     array_free(manager->txRequests);
+    _BRPeerManagerClearFilterBlocks(manager);
+    array_free(manager->filterBlocks);
+    array_free(manager->filterScriptData);
+    array_free(manager->filterScripts);
 
     for (size_t i = array_count(manager->publishedTx); i > 0; i--) {
         tx = manager->publishedTx[i - 1].tx;
@@ -30,6 +30,7 @@
 #include "BRTransaction.h"
 #include "BRWallet.h"
 #include "BRChainParams.h"
+#include "BRHeaderStore.h"
 #include <stddef.h>
 #include <inttypes.h>
 
@@ -69,6 +70,16 @@ void BRPeerManagerSetCallbacks(BRPeerManager *manager, void *info,
 // set address to UINT128_ZERO to revert to default behavior
 void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t port);
 
+// not thread-safe, set the header store once before calling BRPeerManagerConnect()
+// verified main chain headers are appended to store, and blocks pruned from memory are paged back in from it as needed
+// so that only a recent window of blocks is kept in memory - store must stay open until the manager is freed
+void BRPeerManagerSetHeaderStore(BRPeerManager *manager, BRHeaderStore *store);
+
+// not thread-safe, call once before BRPeerManagerConnect() to sync with BIP157/158 compact block filters instead of
+// bloom filters - the filters of blocks after earliestKeyTime are checked against wallet addresses, and only the blocks
+// whose filters match are downloaded in full, so peers learn nothing about the wallet, but they must serve filters
+void BRPeerManagerSetUseBlockFilters(BRPeerManager *manager, int useBlockFilters);
+
 // current connect status
 BRPeerStatus BRPeerManagerConnectStatus(BRPeerManager *manager);
 
@@ -418,6 +418,10 @@ BRPeerSyncManagerSetFixedPeer (BRPeerSyncManager manager,
                                UInt128 address,
                                uint16_t port);
 
+static void
+BRPeerSyncManagerSetHeaderStore (BRPeerSyncManager manager,
+                                 BRHeaderStore *store);
+
 static void
 BRPeerSyncManagerConnect(BRPeerSyncManager manager);
 
@@ -521,6 +525,23 @@ BRSyncManagerNewForMode(BRCryptoSyncMode mode,
                                                                      blocksCount,
                                                                      peers,
                                                                      peersCount));
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS: {
+            // a P2P sync manager in every other respect; only its peer manager's filtering differs
+            BRPeerSyncManager peerManager = BRPeerSyncManagerNew (eventContext,
+                                                                  eventCallback,
+                                                                  params,
+                                                                  wallet,
+                                                                  earliestKeyTime,
+                                                                  blockHeight,
+                                                                  confirmationsUntilFinal,
+                                                                  isNetworkReachable,
+                                                                  blocks,
+                                                                  blocksCount,
+                                                                  peers,
+                                                                  peersCount);
+            BRPeerManagerSetUseBlockFilters (peerManager->peerManager, 1);
+            return BRPeerSyncManagerAsSyncManager (peerManager);
+        }
         default:
         assert (0);
         return NULL;
@@ -625,6 +646,21 @@ BRSyncManagerSetFixedPeer (BRSyncManager manager,
     }
 }
 
+extern void
+BRSyncManagerSetHeaderStore (BRSyncManager manager,
+                             BRHeaderStore *store) {
+    switch (manager->mode) {
+        case CRYPTO_SYNC_MODE_API_ONLY:
+        break;
+        case CRYPTO_SYNC_MODE_P2P_ONLY:
+        BRPeerSyncManagerSetHeaderStore (BRSyncManagerAsPeerSyncManager(manager), store);
+        break;
+        default:
+        assert (0);
+        break;
+    }
+}
+
 extern void
 BRSyncManagerConnect(BRSyncManager manager) {
     switch (manager->mode) {
@@ -1720,6 +1756,12 @@ BRPeerSyncManagerSetFixedPeer (BRPeerSyncManager manager,
     BRPeerManagerSetFixedPeer (manager->peerManager, address, port);
 }
 
+static void
+BRPeerSyncManagerSetHeaderStore (BRPeerSyncManager manager,
+                                 BRHeaderStore *store) {
+    BRPeerManagerSetHeaderStore (manager->peerManager, store);
+}
+
 static void
 BRPeerSyncManagerConnect(BRPeerSyncManager manager) {
     BRPeerManagerConnect (manager->peerManager);
@@ -15,6 +15,7 @@
 
 #include "BRChainParams.h"
 #include "BRMerkleBlock.h"
+#include "BRHeaderStore.h"
 #include "BRPeer.h"
 #include "BRWallet.h"
 #include "support/BRBase.h"
@@ -171,6 +172,15 @@ BRSyncManagerSetFixedPeer (BRSyncManager manager,
                            UInt128 address,
                            uint16_t port);
 
+/**
+ * Set the header store that a P2P sync manager appends verified block headers to and pages
+ * pruned blocks back in from.  Must be called before connecting; `store` must remain open
+ * until the sync manager is freed.  Ignored by an API sync manager.
+ */
+extern void
+BRSyncManagerSetHeaderStore (BRSyncManager manager,
+                             OwnershipKept BRHeaderStore *store);
+
 extern void
 BRSyncManagerConnect(BRSyncManager manager);
 
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <time.h>
+#include <pthread.h>
 
 #define TX_VERSION           0x00000001
 #define TX_LOCKTIME          0x00000000
@@ -36,6 +37,11 @@
 #define SIGHASH_ANYONECANPAY 0x80 // let other people add inputs, I don't care where the rest of the bitcoins come from
 #define SIGHASH_FORKID       0x40 // use BIP143 digest method (for b-cash/b-gold signatures)
 
+#define TX_SIGN_MAX_THREADS  64
+#define TX_SIGN_P2WPKH       0
+#define TX_SIGN_P2PKH        1
+#define TX_SIGN_P2PK         2
+
 size_t BRTxInputAddress(const BRTxInput *input, char *address, size_t addrLen, BRAddressParams params)
 {
     size_t r = BRAddressFromScriptPubKey(address, addrLen, params, input->script, input->scriptLen);
@@ -184,41 +190,62 @@ static size_t _BRTransactionOutputData(const BRTransaction *tx, uint8_t *data, s
     return (! data || off <= dataLen) ? off : 0;
 }
 
+// BIP143 hashPrevouts, hashSequence and hashOutputs, which are the same in the signature pre-image of every input, so
+// they only need to be computed once per transaction instead of once per input
+typedef struct {
+    UInt256 prevoutsHash, sequenceHash, outputsHash;
+    int isSet;
+} BRTxSigHashCache;
+
+static void _BRTxSigHashCacheSet(BRTxSigHashCache *cache, const BRTransaction *tx)
+{
+    size_t i, bufLen = _BRTransactionOutputData(tx, NULL, 0, SIZE_MAX);
+    uint8_t _buf[0x1000], *buf = (bufLen <= 0x1000) ? _buf : malloc(bufLen);
+    uint8_t prevouts[(sizeof(UInt256) + sizeof(uint32_t))*tx->inCount], sequences[sizeof(uint32_t)*tx->inCount];
+    
+    for (i = 0; i < tx->inCount; i++) {
+        UInt256Set(&prevouts[(sizeof(UInt256) + sizeof(uint32_t))*i], tx->inputs[i].txHash);
+        UInt32SetLE(&prevouts[(sizeof(UInt256) + sizeof(uint32_t))*i + sizeof(UInt256)], tx->inputs[i].index);
+        UInt32SetLE(&sequences[sizeof(uint32_t)*i], tx->inputs[i].sequence);
+    }
+
+    BRSHA256_2(&cache->prevoutsHash, prevouts, sizeof(prevouts)); // inputs hash
+    BRSHA256_2(&cache->sequenceHash, sequences, sizeof(sequences)); // sequence hash
+    bufLen = _BRTransactionOutputData(tx, buf, bufLen, SIZE_MAX);
+    BRSHA256_2(&cache->outputsHash, buf, bufLen); // SIGHASH_ALL outputs hash
+    if (buf != _buf) free(buf);
+    cache->isSet = 1;
+}
+
 // writes the BIP143 witness program data that needs to be hashed and signed for the tx input at index
 // https://github.com/bitcoin/bips/blob/master/bip-0143.mediawiki
+// cache may be NULL, otherwise it's filled in if not already set, and reused for subsequent inputs
 // returns number of bytes written, or total len needed if data is NULL
 static size_t _BRTransactionWitnessData(const BRTransaction *tx, uint8_t *data, size_t dataLen, size_t index,
-                                        int hashType)
+                                        int hashType, BRTxSigHashCache *cache)
 {
+    BRTxSigHashCache _cache = { UINT256_ZERO, UINT256_ZERO, UINT256_ZERO, 0 };
     BRTxInput input;
     int anyoneCanPay = (hashType & SIGHASH_ANYONECANPAY), sigHash = (hashType & 0x1f);
-    size_t i, off = 0;
+    size_t off = 0;
     uint8_t scriptCode[] = { OP_DUP, OP_HASH160, 20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
                              0, 0, 0, 0, 0, 0, 0, 0, 0, OP_EQUALVERIFY, OP_CHECKSIG };
 
     if (index >= tx->inCount) return 0;
+    if (! cache) cache = &_cache;
+    if (data && ! cache->isSet) _BRTxSigHashCacheSet(cache, tx);
     if (data && off + sizeof(uint32_t) <= dataLen) UInt32SetLE(&data[off], tx->version); // tx version
     off += sizeof(uint32_t);
     
     if (! anyoneCanPay) {
-        uint8_t buf[(sizeof(UInt256) + sizeof(uint32_t))*tx->inCount];
-        
-        for (i = 0; i < tx->inCount; i++) {
-            UInt256Set(&buf[(sizeof(UInt256) + sizeof(uint32_t))*i], tx->inputs[i].txHash);
-            UInt32SetLE(&buf[(sizeof(UInt256) + sizeof(uint32_t))*i + sizeof(UInt256)], tx->inputs[i].index);
-        }
-        
-        if (data && off + sizeof(UInt256) <= dataLen) BRSHA256_2(&data[off], buf, sizeof(buf)); // inputs hash
+        if (data && off + sizeof(UInt256) <= dataLen) UInt256Set(&data[off], cache->prevoutsHash); // inputs hash
     }
     else if (data && off + sizeof(UInt256) <= dataLen) UInt256Set(&data[off], UINT256_ZERO); // anyone-can-pay
     
     off += sizeof(UInt256);
     
     if (! anyoneCanPay && sigHash != SIGHASH_SINGLE && sigHash != SIGHASH_NONE) {
-        uint8_t buf[sizeof(uint32_t)*tx->inCount];
-        
-        for (i = 0; i < tx->inCount; i++) UInt32SetLE(&buf[sizeof(uint32_t)*i], tx->inputs[i].sequence);
-        if (data && off + sizeof(UInt256) <= dataLen) BRSHA256_2(&data[off], buf, sizeof(buf)); // sequence hash
+        if (data && off + sizeof(UInt256) <= dataLen) UInt256Set(&data[off], cache->sequenceHash); // sequence hash
     }
     else if (data && off + sizeof(UInt256) <= dataLen) UInt256Set(&data[off], UINT256_ZERO);
     
@@ -236,12 +263,7 @@ static size_t _BRTransactionWitnessData(const BRTransaction *tx, uint8_t *data,
     off += _BRTxInputData(&input, (data ? &data[off] : NULL), (off <= dataLen ? dataLen - off : 0));
     
     if (sigHash != SIGHASH_SINGLE && sigHash != SIGHASH_NONE) {
-        size_t bufLen = _BRTransactionOutputData(tx, NULL, 0, SIZE_MAX);
-        uint8_t _buf[0x1000], *buf = (bufLen <= 0x1000) ? _buf : malloc(bufLen);
-        
-        bufLen = _BRTransactionOutputData(tx, buf, bufLen, SIZE_MAX);
-        if (data && off + sizeof(UInt256) <= dataLen) BRSHA256_2(&data[off], buf, bufLen); // SIGHASH_ALL outputs hash
-        if (buf != _buf) free(buf);
+        if (data && off + sizeof(UInt256) <= dataLen) UInt256Set(&data[off], cache->outputsHash); // SIGHASH_ALL outputs
     }
     else if (sigHash == SIGHASH_SINGLE && index < tx->outCount) {
         uint8_t buf[_BRTransactionOutputData(tx, NULL, 0, index)];
@@ -268,7 +290,7 @@ static size_t _BRTransactionData(const BRTransaction *tx, uint8_t *data, size_t
     int anyoneCanPay = (hashType & SIGHASH_ANYONECANPAY), sigHash = (hashType & 0x1f), witnessFlag = 0;
     size_t i, count, len, woff, off = 0;
     
-    if (hashType & SIGHASH_FORKID) return _BRTransactionWitnessData(tx, data, dataLen, index, hashType);
+    if (hashType & SIGHASH_FORKID) return _BRTransactionWitnessData(tx, data, dataLen, index, hashType, NULL);
     if (anyoneCanPay && index >= tx->inCount) return 0;
     
     for (i = 0; index == SIZE_MAX && ! witnessFlag && i < tx->inCount; i++) {
@@ -351,6 +373,89 @@ static size_t _BRTransactionData(const BRTransaction *tx, uint8_t *data, size_t
     return (! data || off <= dataLen) ? off : 0;
 }
 
+// same as _BRTransactionData() for a signature pre-image, but reuses cache for BIP143 and fork-id signatures
+static size_t _BRTransactionSigData(const BRTransaction *tx, uint8_t *data, size_t dataLen, size_t index, int hashType,
+                                    BRTxSigHashCache *cache)
+{
+    if (hashType & SIGHASH_FORKID) return _BRTransactionWitnessData(tx, data, dataLen, index, hashType, cache);
+    return _BRTransactionData(tx, data, dataLen, index, hashType);
+}
+
+// base (non-witness) and witness sizes if signed, or estimated sizes assuming compact pubkey sigs
+static void _BRTransactionSizes(const BRTransaction *tx, size_t *size, size_t *witSize)
+{
+    const BRTxInput *input;
+    
+    *size = 8 + BRVarIntSize(tx->inCount) + BRVarIntSize(tx->outCount);
+    *witSize = 0;
+    
+    for (size_t i = 0; i < tx->inCount; i++) {
+        input = &tx->inputs[i];
+        
+        if (input->signature && input->witness) {
+            *size += sizeof(UInt256) + sizeof(uint32_t) + BRVarIntSize(input->sigLen) + input->sigLen + sizeof(uint32_t);
+            *witSize += input->witLen;
+        }
+        else if (input->script && input->scriptLen > 0 && input->script[0] == OP_0) { // estimated P2WPKH signature size
+            *witSize += TX_INPUT_SIZE;
+        }
+        else *size += TX_INPUT_SIZE; // estimated P2PKH signature size
+    }
+    
+    for (size_t i = 0; i < tx->outCount; i++) {
+        *size += sizeof(uint64_t) + BRVarIntSize(tx->outputs[i].scriptLen) + tx->outputs[i].scriptLen;
+    }
+    
+    if (*witSize > 0) *witSize += 2 + tx->inCount;
+}
+
+// caches size and vsize of a signed tx, both are fixed until inputs or outputs are added
+static void _BRTransactionSetSizes(BRTransaction *tx)
+{
+    size_t size, witSize;
+    
+    _BRTransactionSizes(tx, &size, &witSize);
+    tx->size = size + witSize;
+    tx->vsize = (size*4 + witSize + 3)/4;
+}
+
+// sets txHash, wtxHash, size and vsize of a signed tx from a single serialization, the txHash pre-image being the same bytes with
+// the segwit marker, flag and witness data cut out
+static void _BRTransactionSetHashes(BRTransaction *tx)
+{
+    size_t i, j, len, count, witLen = 0, dataLen = BRTransactionSerialize(tx, NULL, 0);
+    uint8_t _data[0x1000], *data = (dataLen <= sizeof(_data)) ? _data : malloc(dataLen);
+    int witnessFlag = 0;
+
+    assert(data != NULL);
+    dataLen = BRTransactionSerialize(tx, data, dataLen);
+    
+    for (i = 0; i < tx->inCount; i++) { // length of the witness data that precedes locktime
+        for (count = 0, j = 0; j < tx->inputs[i].witLen; count++) {
+            j += BRVarInt(&tx->inputs[i].witness[j], tx->inputs[i].witLen - j, &len);
+            j += len;
+        }
+        
+        witLen += BRVarIntSize(count) + tx->inputs[i].witLen;
+        if (tx->inputs[i].witLen > 0) witnessFlag = 1;
+    }
+    
+    if (dataLen > 0 && witnessFlag) {
+        BRSHA256_2(&tx->wtxHash, data, dataLen);
+        memmove(&data[dataLen - (witLen + sizeof(uint32_t))], &data[dataLen - sizeof(uint32_t)], sizeof(uint32_t));
+        dataLen -= witLen;
+        memmove(&data[sizeof(uint32_t)], &data[sizeof(uint32_t) + 2], dataLen - (sizeof(uint32_t) + 2));
+        BRSHA256_2(&tx->txHash, data, dataLen - 2);
+    }
+    else if (dataLen > 0) {
+        BRSHA256_2(&tx->txHash, data, dataLen);
+        tx->wtxHash = tx->txHash;
+    }
+    
+    if (data != _data) free(data);
+    _BRTransactionSetSizes(tx);
+}
+
 // returns a newly allocated empty transaction that must be freed by calling BRTransactionFree()
 BRTransaction *BRTransactionNew(void)
 {
@@ -389,6 +494,8 @@ BRTransaction *BRTransactionCopy(const BRTransaction *tx)
         BRTransactionAddOutput(cpy, tx->outputs[i].amount, tx->outputs[i].script, tx->outputs[i].scriptLen);
     }
 
+    cpy->size = tx->size;
+    cpy->vsize = tx->vsize;
     return cpy;
 }
 
@@ -491,6 +598,7 @@ BRTransaction *BRTransactionParse(const uint8_t *buf, size_t bufLen)
         tx->wtxHash = tx->txHash;
     }
     
+    if (tx && isSigned) _BRTransactionSetSizes(tx);
     return tx;
 }
 
@@ -521,6 +629,7 @@ void BRTransactionAddInput(BRTransaction *tx, UInt256 txHash, uint32_t index, ui
         if (witness) BRTxInputSetWitness(&input, witness, witLen);
         array_add(tx->inputs, input);
         tx->inCount = array_count(tx->inputs);
+        tx->size = tx->vsize = 0;
     }
 }
 
@@ -536,6 +645,7 @@ void BRTransactionAddOutput(BRTransaction *tx, uint64_t amount, const uint8_t *s
         BRTxOutputSetScript(&output, script, scriptLen);
         array_add(tx->outputs, output);
         tx->outCount = array_count(tx->outputs);
+        tx->size = tx->vsize = 0;
     }
 }
 
@@ -559,60 +669,22 @@ void BRTransactionShuffleOutputs(BRTransaction *tx)
 // size in bytes if signed, or estimated size assuming compact pubkey sigs
 size_t BRTransactionSize(const BRTransaction *tx)
 {
-    BRTxInput *input;
-    size_t size, witSize = 0;
+    size_t size = 0, witSize = 0;
 
     assert(tx != NULL);
-    size = (tx) ? 8 + BRVarIntSize(tx->inCount) + BRVarIntSize(tx->outCount) : 0;
-    
-    for (size_t i = 0; tx && i < tx->inCount; i++) {
-        input = &tx->inputs[i];
-        
-        if (input->signature && input->witness) {
-            size += sizeof(UInt256) + sizeof(uint32_t) + BRVarIntSize(input->sigLen) + input->sigLen + sizeof(uint32_t);
-            witSize += input->witLen;
-        }
-        else if (input->script && input->scriptLen > 0 && input->script[0] == OP_0) { // estimated P2WPKH signature size
-            witSize += TX_INPUT_SIZE;
-        }
-        else size += TX_INPUT_SIZE; // estimated P2PKH signature size
-    }
-    
-    for (size_t i = 0; tx && i < tx->outCount; i++) {
-        size += sizeof(uint64_t) + BRVarIntSize(tx->outputs[i].scriptLen) + tx->outputs[i].scriptLen;
-    }
-    
-    if (witSize > 0) witSize += 2 + tx->inCount;
+    if (tx && tx->size > 0) return tx->size;
+    if (tx) _BRTransactionSizes(tx, &size, &witSize);
     return size + witSize;
 }
 
 // virtual transaction size as defined by BIP141: https://github.com/bitcoin/bips/blob/master/bip-0141.mediawiki
 size_t BRTransactionVSize(const BRTransaction *tx)
 {
-    BRTxInput *input;
-    size_t size, witSize = 0;
+    size_t size = 0, witSize = 0;
     
     assert(tx != NULL);
-    size = (tx) ? 8 + BRVarIntSize(tx->inCount) + BRVarIntSize(tx->outCount) : 0;
-    
-    for (size_t i = 0; i < tx->inCount; i++) {
-        input = &tx->inputs[i];
-        
-        if (input->signature && input->witness) {
-            size += sizeof(UInt256) + sizeof(uint32_t) + BRVarIntSize(input->sigLen) + input->sigLen + sizeof(uint32_t);
-            witSize += tx->inputs[i].witLen;
-        }
-        else if (input->script && input->scriptLen > 0 && input->script[0] == OP_0) { // estimated P2WPKH signature size
-            witSize += TX_INPUT_SIZE;
-        }
-        else size += TX_INPUT_SIZE; // estimated P2PKH signature size
-    }
-    
-    for (size_t i = 0; i < tx->outCount; i++) {
-        size += sizeof(uint64_t) + BRVarIntSize(tx->outputs[i].scriptLen) + tx->outputs[i].scriptLen;
-    }
-    
-    if (witSize > 0) witSize += 2 + tx->inCount;
+    if (tx && tx->vsize > 0) return tx->vsize;
+    if (tx) _BRTransactionSizes(tx, &size, &witSize);
     return (size*4 + witSize + 3)/4;
 }
 
@@ -639,18 +711,85 @@ int BRTransactionIsSigned(const BRTransaction *tx)
 // forkId is 0 for bitcoin, 0x40 for b-cash, 0x4f for b-gold
 // returns true if tx is signed
 int BRTransactionSign(BRTransaction *tx, int forkId, BRKey keys[], size_t keysCount)
+{
+    return BRTransactionSignParallel(tx, forkId, keys, keysCount, 1);
+}
+
+// an input to be signed, along with its signature once signed
+typedef struct {
+    size_t index;
+    BRKey *key;
+    int type; // TX_SIGN_P2WPKH, TX_SIGN_P2PKH or TX_SIGN_P2PK
+    uint8_t sig[73];
+    size_t sigLen;
+} BRTxSignItem;
+
+typedef struct {
+    const BRTransaction *tx;
+    BRTxSigHashCache *cache;
+    BRTxSignItem *items;
+    size_t count, offset, stride;
+    int hashType;
+} BRTxSignWorker;
+
+// computes the signature pre-image hash and signs items offset, offset + stride, offset + stride*2, ...
+// the tx and keys are only read, and each item is written by exactly one worker
+static void *_BRTxSignWorkerRoutine(void *info)
+{
+    BRTxSignWorker *worker = info;
+    BRTxSignItem *item;
+    size_t i, dataLen;
+    uint8_t _data[0x1000], *data;
+    UInt256 md;
+    
+    for (i = worker->offset; i < worker->count; i += worker->stride) {
+        item = &worker->items[i];
+        
+        if (item->type == TX_SIGN_P2WPKH) {
+            dataLen = _BRTransactionWitnessData(worker->tx, NULL, 0, item->index, worker->hashType, worker->cache);
+            data = (dataLen <= sizeof(_data)) ? _data : malloc(dataLen);
+            assert(data != NULL);
+            dataLen = _BRTransactionWitnessData(worker->tx, data, dataLen, item->index, worker->hashType, worker->cache);
+        }
+        else {
+            dataLen = _BRTransactionSigData(worker->tx, NULL, 0, item->index, worker->hashType, worker->cache);
+            data = (dataLen <= sizeof(_data)) ? _data : malloc(dataLen);
+            assert(data != NULL);
+            dataLen = _BRTransactionSigData(worker->tx, data, dataLen, item->index, worker->hashType, worker->cache);
+        }
+        
+        BRSHA256_2(&md, data, dataLen);
+        if (data != _data) free(data);
+        item->sigLen = BRKeySign(item->key, item->sig, sizeof(item->sig) - 1, md);
+        item->sig[item->sigLen++] = worker->hashType;
+    }
+    
+    return NULL;
+}
+
+// adds signatures to any inputs with NULL signatures that can be signed with any keys, signing on up to threadCount
+// threads (including the calling thread), with the same result as BRTransactionSign()
+// forkId is 0 for bitcoin, 0x40 for b-cash, 0x4f for b-gold
+// returns true if tx is signed
+int BRTransactionSignParallel(BRTransaction *tx, int forkId, BRKey keys[], size_t keysCount, size_t threadCount)
 {
     UInt160 pkh[keysCount];
-    size_t i, j;
+    BRTxSigHashCache cache = { UINT256_ZERO, UINT256_ZERO, UINT256_ZERO, 0 };
+    BRTxSignItem *items;
+    size_t i, j, count = 0;
     
     assert(tx != NULL);
     assert(keys != NULL || keysCount == 0);
+    if (! tx) return 0;
     
-    for (i = 0; tx && i < keysCount; i++) {
-        pkh[i] = BRKeyHash160(&keys[i]);
+    for (i = 0; i < keysCount; i++) {
+        pkh[i] = BRKeyHash160(&keys[i]); // also sets each key's cached pubKey, so workers only read keys
     }
     
-    for (i = 0; tx && i < tx->inCount; i++) {
+    items = calloc(tx->inCount + 1, sizeof(*items));
+    assert(items != NULL);
+    
+    for (i = 0; i < tx->inCount; i++) {
         BRTxInput *input = &tx->inputs[i];
         const uint8_t *hash = BRScriptPKH(input->script, input->scriptLen);
         
@@ -660,56 +799,78 @@ int BRTransactionSign(BRTransaction *tx, int forkId, BRKey keys[], size_t keysCo
         
         const uint8_t *elems[BRScriptElements(NULL, 0, input->script, input->scriptLen)];
         size_t elemsCount = BRScriptElements(elems, sizeof(elems)/sizeof(*elems), input->script, input->scriptLen);
-        uint8_t pubKey[BRKeyPubKey(&keys[j], NULL, 0)];
-        size_t pkLen = BRKeyPubKey(&keys[j], pubKey, sizeof(pubKey));
-        uint8_t sig[73], script[1 + sizeof(sig) + 1 + sizeof(pubKey)];
-        size_t sigLen, scriptLen;
-        UInt256 md = UINT256_ZERO;
+        
+        items[count].index = i;
+        items[count].key = &keys[j];
         
         if (elemsCount == 2 && *elems[0] == OP_0 && *elems[1] == 20) { // pay-to-witness-pubkey-hash
-            uint8_t data[_BRTransactionWitnessData(tx, NULL, 0, i, forkId | SIGHASH_ALL)];
-            size_t dataLen = _BRTransactionWitnessData(tx, data, sizeof(data), i, forkId | SIGHASH_ALL);
-            
-            BRSHA256_2(&md, data, dataLen);
-            sigLen = BRKeySign(&keys[j], sig, sizeof(sig) - 1, md);
-            sig[sigLen++] = forkId | SIGHASH_ALL;
-            scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
+            items[count].type = TX_SIGN_P2WPKH;
+        }
+        else if (elemsCount >= 2 && *elems[elemsCount - 2] == OP_EQUALVERIFY) { // pay-to-pubkey-hash
+            items[count].type = TX_SIGN_P2PKH;
+        }
+        else items[count].type = TX_SIGN_P2PK; // pay-to-pubkey
+        
+        // signature pre-images don't depend on other input signatures, and the BIP143 hashes are shared by workers
+        if ((items[count].type == TX_SIGN_P2WPKH || (forkId & SIGHASH_FORKID)) && ! cache.isSet) {
+            _BRTxSigHashCacheSet(&cache, tx);
+        }
+        
+        count++;
+    }
+    
+    if (threadCount > count) threadCount = count;
+    if (threadCount > TX_SIGN_MAX_THREADS) threadCount = TX_SIGN_MAX_THREADS;
+    if (threadCount < 1) threadCount = 1;
+    
+    BRTxSignWorker workers[threadCount];
+    pthread_t threads[threadCount];
+    int started[threadCount];
+    
+    for (i = 0; i < threadCount; i++) {
+        workers[i] = (BRTxSignWorker) { tx, &cache, items, count, i, threadCount, forkId | SIGHASH_ALL };
+        started[i] = (i > 0 && pthread_create(&threads[i], NULL, _BRTxSignWorkerRoutine, &workers[i]) == 0);
+    }
+    
+    for (i = 0; i < threadCount; i++) {
+        if (i == 0 || ! started[i]) _BRTxSignWorkerRoutine(&workers[i]); // calling thread does any unstarted work
+    }
+    
+    for (i = 1; i < threadCount; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+    
+    for (i = 0; i < count; i++) { // assemble scripts and witnesses in input order
+        BRTxInput *input = &tx->inputs[items[i].index];
+        uint8_t pubKey[BRKeyPubKey(items[i].key, NULL, 0)];
+        size_t pkLen = BRKeyPubKey(items[i].key, pubKey, sizeof(pubKey));
+        uint8_t script[1 + sizeof(items[i].sig) + 1 + sizeof(pubKey)];
+        size_t scriptLen;
+        
+        scriptLen = BRScriptPushData(script, sizeof(script), items[i].sig, items[i].sigLen);
+        
+        if (items[i].type == TX_SIGN_P2WPKH) {
             scriptLen += BRScriptPushData(&script[scriptLen], sizeof(script) - scriptLen, pubKey, pkLen);
             BRTxInputSetSignature(input, script, 0);
             BRTxInputSetWitness(input, script, scriptLen);
         }
-        else if (elemsCount >= 2 && *elems[elemsCount - 2] == OP_EQUALVERIFY) { // pay-to-pubkey-hash
-            uint8_t data[_BRTransactionData(tx, NULL, 0, i, forkId | SIGHASH_ALL)];
-            size_t dataLen = _BRTransactionData(tx, data, sizeof(data), i, forkId | SIGHASH_ALL);
-            
-            BRSHA256_2(&md, data, dataLen);
-            sigLen = BRKeySign(&keys[j], sig, sizeof(sig) - 1, md);
-            sig[sigLen++] = forkId | SIGHASH_ALL;
-            scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
+        else if (items[i].type == TX_SIGN_P2PKH) {
             scriptLen += BRScriptPushData(&script[scriptLen], sizeof(script) - scriptLen, pubKey, pkLen);
             BRTxInputSetSignature(input, script, scriptLen);
             BRTxInputSetWitness(input, script, 0);
         }
-        else { // pay-to-pubkey
-            uint8_t data[_BRTransactionData(tx, NULL, 0, i, forkId | SIGHASH_ALL)];
-            size_t dataLen = _BRTransactionData(tx, data, sizeof(data), i, forkId | SIGHASH_ALL);
-
-            BRSHA256_2(&md, data, dataLen);
-            sigLen = BRKeySign(&keys[j], sig, sizeof(sig) - 1, md);
-            sig[sigLen++] = forkId | SIGHASH_ALL;
-            scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
+        else {
             BRTxInputSetSignature(input, script, scriptLen);
             BRTxInputSetWitness(input, script, 0);
         }
+        
     }
     
-    if (tx && BRTransactionIsSigned(tx)) {
-        uint8_t data[BRTransactionSerialize(tx, NULL, 0)];
-        size_t len = BRTransactionSerialize(tx, data, sizeof(data));
-        BRTransaction *t = BRTransactionParse(data, len);
-        
-        if (t) tx->txHash = t->txHash, tx->wtxHash = t->wtxHash;
-        if (t) BRTransactionFree(t);
+    free(items);
+    tx->size = tx->vsize = 0; // signatures were added, sizes are cached again once all inputs are signed
+    
+    if (BRTransactionIsSigned(tx)) {
+        _BRTransactionSetHashes(tx);
         return 1;
     }
     else return 0;
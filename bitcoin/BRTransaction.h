@@ -91,6 +91,7 @@ typedef struct {
     uint32_t lockTime;
     uint32_t blockHeight;
     uint32_t timestamp; // time interval since unix epoch
+    size_t size, vsize; // set when a tx is signed or parsed, cleared when inputs or outputs are added, 0 if not known
 } BRTransaction;
 
 // returns a newly allocated empty transaction that must be freed by calling BRTransactionFree()
@@ -135,6 +136,12 @@ int BRTransactionIsSigned(const BRTransaction *tx);
 // returns true if tx is signed
 int BRTransactionSign(BRTransaction *tx, int forkId, BRKey keys[], size_t keysCount);
 
+// adds signatures to any inputs with NULL signatures that can be signed with any keys, signing on up to threadCount
+// threads (including the calling thread), with the same result as BRTransactionSign()
+// forkId is 0 for bitcoin, 0x40 for b-cash, 0x4f for b-gold
+// returns true if tx is signed
+int BRTransactionSignParallel(BRTransaction *tx, int forkId, BRKey keys[], size_t keysCount, size_t threadCount);
+
 // true if tx meets IsStandard() rules: https://bitcoin.org/en/developer-guide#standard-transactions
 int BRTransactionIsStandard(const BRTransaction *tx);
 
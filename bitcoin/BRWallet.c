@@ -22,6 +22,10 @@
 //  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 //  THE SOFTWARE.
 
+#if defined(__linux__) && ! defined(_GNU_SOURCE)
+#define _GNU_SOURCE // for pthread_rwlockattr_setkind_np()
+#endif
+
 #include "BRWallet.h"
 #include "BRSet.h"
 #include "BRAddress.h"
@@ -31,7 +35,9 @@
 #include <limits.h>
 #include <float.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <assert.h>
+#include <sys/time.h>
 
 inline static size_t _pkhHash(const void *pkh)
 {
@@ -66,21 +72,80 @@ inline static size_t _txChainIndex(const BRTransaction *tx, const UInt160 *chain
     return -1;
 }
 
+#define WALLET_DERIVATION_BATCH       64 // minimum number of new addresses per key derivation thread
+#define WALLET_DERIVATION_MAX_THREADS 4
+
+#define WALLET_UNDO_DEPTH 1000 // number of most recently applied transactions that can be undone without a full replay
+
+// balance state is built by applying wallet->transactions in order, one at a time, and each applied transaction leaves
+// an undo record so that inserting, removing or re-ordering recent transactions only replays the affected suffix
+typedef struct {
+    BRSet *set;
+    void *item, *replaced;
+} BRWalletSetOp;
+
+typedef struct {
+    size_t idx;
+    BRUTXO utxo;
+} BRWalletSpentUTXO;
+
+typedef struct {
+    uint64_t balance, totalSent, totalReceived; // values before tx was applied
+    size_t utxoCount, opsIdx, spentIdx, deferredIdx, deferredCount;
+} BRWalletUndo;
+
+#define COIN_SELECTION_MAX_TRIES 100000 // maximum number of steps in a branch-and-bound coin selection search
+
+// a spendable wallet output considered for coin selection
+typedef struct {
+    const BRTransaction *tx;
+    uint32_t n;
+    uint64_t amount;
+    int64_t value; // effective value: amount less the fee for spending it
+    int isWitness;
+} BRWalletCoin;
+
+// amounts received, sent and fee for a signed transaction, cached by txHash
+typedef struct {
+    UInt256 txHash; // first member so entries can be found in a set using BRTransactionHash and BRTransactionEq
+    UInt256 wtxHash; // an entry is stale if the tx signatures differ
+    uint64_t received, sent, fee;
+    unsigned pkhGeneration, txAddGeneration, txRemoveGeneration;
+    int inputsKnown; // true if every input tx was in wallet->allTx, so only removals from allTx can change sent and fee
+} BRWalletTxAmounts;
+
+// running vsize estimate for an unsigned transaction
+typedef struct {
+    size_t inCount, outCount, size, witSize;
+} BRWalletTxSize;
+
 struct BRWalletStruct {
     uint64_t balance, totalSent, totalReceived, feePerKb, *balanceHist;
     uint32_t blockHeight;
-    BRUTXO *utxos;
+    BRUTXO *utxos; // spent utxos are left in place with a zero hash until compacted
     BRTransaction **transactions;
-    BRMasterPubKey masterPubKey;
+    BRMasterPubKey masterPubKey, chainPubKeys[2]; // chainPubKeys are the external and internal chain nodes
     BRAddressParams addrParams;
     UInt160 *internalChain, *externalChain;
-    BRSet *allTx, *invalidTx, *pendingTx, *spentOutputs, *usedPKH, *allPKH;
+    BRSet *allTx, *invalidTx, *pendingTx, *spentOutputs, *usedPKH, *allPKH, *utxoIndex, *unknownPKH;
+    const BRTxInput **deferredSpends; // inputs of pending tx not yet removed from utxos
+    size_t pendingIdx; // index in transactions of the first pending tx, or SIZE_MAX
+    BRWalletUndo *undo;
+    BRWalletSetOp *undoOps;
+    BRWalletSpentUTXO *undoSpent;
+    const BRTxInput **undoDeferred;
     void *callbackInfo;
     void (*balanceChanged)(void *info, uint64_t balance);
     void (*txAdded)(void *info, BRTransaction *tx);
     void (*txUpdated)(void *info, const UInt256 txHashes[], size_t txCount, uint32_t blockHeight, uint32_t timestamp);
     void (*txDeleted)(void *info, UInt256 txHash, int notifyUser, int recommendRescan);
-    pthread_mutex_t lock;
+    BRSet *txAmounts; // BRWalletTxAmounts for signed transactions, guarded by amountsLock
+    unsigned pkhGeneration, txAddGeneration, txRemoveGeneration; // counts changes to allPKH and allTx
+    pthread_mutex_t amountsLock; // taken while holding the wallet lock shared, so queries can update txAmounts
+    pthread_rwlock_t lock; // queries share the lock, anything that changes the wallet holds it exclusively
+    // copies of balance, totals, feePerKb and blockHeight, published by writers so they can be read without the lock
+    _Atomic(uint64_t) publishedBalance, publishedTotalSent, publishedTotalReceived, publishedFeePerKb;
+    _Atomic(uint32_t) publishedBlockHeight;
 };
 
 inline static int _BRWalletTxIsAscending(BRWallet *wallet, const BRTransaction *tx1, const BRTransaction *tx2)
@@ -117,7 +182,8 @@ inline static int _BRWalletTxCompare(BRWallet *wallet, const BRTransaction *tx1,
 }
 
 // inserts tx into wallet->transactions, keeping wallet->transactions sorted by date, oldest first (insertion sort)
-inline static void _BRWalletInsertTx(BRWallet *wallet, BRTransaction *tx)
+// returns the index tx was inserted at
+inline static size_t _BRWalletInsertTx(BRWallet *wallet, BRTransaction *tx)
 {
     size_t i = array_count(wallet->transactions);
     
@@ -129,6 +195,7 @@ inline static void _BRWalletInsertTx(BRWallet *wallet, BRTransaction *tx)
     }
     
     wallet->transactions[i] = tx;
+    return i;
 }
 
 // non-threadsafe version of BRWalletContainsTransaction()
@@ -153,44 +220,147 @@ static int _BRWalletContainsTx(BRWallet *wallet, const BRTransaction *tx)
     return r;
 }
 
-static void _BRWalletUpdateBalance(BRWallet *wallet)
+static void _BRWalletUnapplyTx(BRWallet *wallet);
+
+// adds item to set, recording the change so it can be reverted by _BRWalletUnapplyTx()
+inline static void _BRWalletSetAdd(BRWallet *wallet, BRSet *set, void *item)
+{
+    void *replaced = BRSetAdd(set, item);
+    
+    array_add(wallet->undoOps, ((const BRWalletSetOp) { set, item, replaced }));
+}
+
+// rebuilds the utxo outpoint index, needed whenever wallet->utxos moves to a new memory location
+static void _BRWalletReindexUTXOs(BRWallet *wallet)
+{
+    BRSetClear(wallet->utxoIndex);
+    
+    for (size_t i = 0; i < array_count(wallet->utxos); i++) {
+        if (! UInt256IsZero(wallet->utxos[i].hash)) BRSetAdd(wallet->utxoIndex, &wallet->utxos[i]);
+    }
+}
+
+inline static void _BRWalletAddUTXO(BRWallet *wallet, BRUTXO o)
+{
+    BRUTXO *utxos = wallet->utxos;
+    
+    array_add(wallet->utxos, o);
+    if (wallet->utxos != utxos) _BRWalletReindexUTXOs(wallet);
+    else BRSetAdd(wallet->utxoIndex, &wallet->utxos[array_count(wallet->utxos) - 1]);
+}
+
+// removes the utxo matching outpoint (a BRUTXO or BRTxInput) if any, leaving a zero hash placeholder in wallet->utxos
+// so the position of the remaining utxos (and of any spent utxo that is later restored) doesn't change
+inline static void _BRWalletSpendUTXO(BRWallet *wallet, const void *outpoint)
+{
+    BRUTXO *o = BRSetRemove(wallet->utxoIndex, outpoint);
+    BRTransaction *t;
+    
+    if (o) {
+        t = BRSetGet(wallet->allTx, &o->hash);
+        wallet->balance -= t->outputs[o->n].amount;
+        array_add(wallet->undoSpent, ((const BRWalletSpentUTXO) { (size_t)(o - wallet->utxos), *o }));
+        *o = (const BRUTXO) { UINT256_ZERO, 0 };
+    }
+}
+
+// drops undo records for all but the most recent WALLET_UNDO_DEPTH transactions (raising the undo watermark)
+static void _BRWalletUndoTrim(BRWallet *wallet)
+{
+    size_t i, n = array_count(wallet->undo) - WALLET_UNDO_DEPTH;
+    BRWalletUndo *u = &wallet->undo[n];
+    
+    if (u->opsIdx > 0) array_rm_range(wallet->undoOps, 0, u->opsIdx);
+    if (u->spentIdx > 0) array_rm_range(wallet->undoSpent, 0, u->spentIdx);
+    if (u->deferredIdx > 0) array_rm_range(wallet->undoDeferred, 0, u->deferredIdx);
+
+    for (i = array_count(wallet->undo); i > n; i--) {
+        wallet->undo[i - 1].opsIdx -= u->opsIdx;
+        wallet->undo[i - 1].spentIdx -= u->spentIdx;
+        wallet->undo[i - 1].deferredIdx -= u->deferredIdx;
+    }
+    
+    array_rm_range(wallet->undo, 0, n);
+}
+
+inline static void _BRWalletUndoClear(BRWallet *wallet)
+{
+    array_clear(wallet->undo);
+    array_clear(wallet->undoOps);
+    array_clear(wallet->undoSpent);
+    array_clear(wallet->undoDeferred);
+}
+
+// removes spent utxo placeholders from wallet->utxos
+static void _BRWalletCompactUTXOs(BRWallet *wallet)
 {
-    int isInvalid, isPending;
-    uint64_t balance = 0, prevBalance = 0;
-    time_t now = time(NULL);
     size_t i, j;
-    BRTransaction *tx, *t;
-    const uint8_t *pkh;
     
+    for (i = 0, j = 0; i < array_count(wallet->utxos); i++) {
+        if (! UInt256IsZero(wallet->utxos[i].hash)) wallet->utxos[j++] = wallet->utxos[i];
+    }
+    
+    array_set_count(wallet->utxos, j);
+    _BRWalletReindexUTXOs(wallet);
+    _BRWalletUndoClear(wallet); // undo records refer to utxo positions, so earlier transactions now require a replay
+}
+
+// clears all balance state so the next call to _BRWalletUpdateBalance() replays the entire transaction history
+static void _BRWalletBalanceReset(BRWallet *wallet)
+{
     array_clear(wallet->utxos);
     array_clear(wallet->balanceHist);
+    array_clear(wallet->deferredSpends);
+    _BRWalletUndoClear(wallet);
+    BRSetClear(wallet->utxoIndex);
     BRSetClear(wallet->spentOutputs);
     BRSetClear(wallet->invalidTx);
     BRSetClear(wallet->pendingTx);
     BRSetClear(wallet->usedPKH);
+    BRSetClear(wallet->unknownPKH);
+    wallet->balance = 0;
     wallet->totalSent = 0;
     wallet->totalReceived = 0;
+    wallet->pendingIdx = SIZE_MAX;
+}
 
-    for (i = 0; i < array_count(wallet->transactions); i++) {
-        tx = wallet->transactions[i];
+// rolls back the balance state to just before wallet->transactions[txIdx] was applied, undoing one transaction at a
+// time if txIdx is at or above the undo watermark, or resetting for a full replay if it's below
+static void _BRWalletBalanceRewind(BRWallet *wallet, size_t txIdx)
+{
+    size_t watermark = array_count(wallet->balanceHist) - array_count(wallet->undo);
+    
+    if (txIdx < watermark) _BRWalletBalanceReset(wallet);
+    while (array_count(wallet->balanceHist) > txIdx) _BRWalletUnapplyTx(wallet);
+}
 
-        // check if any inputs are invalid or already spent
-        if (tx->blockHeight == TX_UNCONFIRMED) {
-            for (j = 0, isInvalid = 0; ! isInvalid && j < tx->inCount; j++) {
-                if (BRSetContains(wallet->spentOutputs, &tx->inputs[j]) ||
-                    BRSetContains(wallet->invalidTx, &tx->inputs[j].txHash)) isInvalid = 1;
-            }
-        
-            if (isInvalid) {
-                BRSetAdd(wallet->invalidTx, tx);
-                array_add(wallet->balanceHist, balance);
-                continue;
-            }
-        }
+// applies the next transaction in wallet->transactions that isn't yet reflected in balanceHist
+static void _BRWalletApplyTx(BRWallet *wallet, time_t now)
+{
+    size_t j, txIdx = array_count(wallet->balanceHist);
+    BRTransaction *tx = wallet->transactions[txIdx];
+    BRWalletUndo undo = { wallet->balance, wallet->totalSent, wallet->totalReceived, array_count(wallet->utxos),
+                          array_count(wallet->undoOps), array_count(wallet->undoSpent),
+                          array_count(wallet->undoDeferred), array_count(wallet->deferredSpends) };
+    uint64_t prevBalance = wallet->balance;
+    int isInvalid = 0, isPending = 0;
+    const uint8_t *pkh;
 
+    // check if any inputs are invalid or already spent
+    if (tx->blockHeight == TX_UNCONFIRMED) {
+        for (j = 0; ! isInvalid && j < tx->inCount; j++) {
+            if (BRSetContains(wallet->spentOutputs, &tx->inputs[j]) ||
+                BRSetContains(wallet->invalidTx, &tx->inputs[j].txHash)) isInvalid = 1;
+        }
+    }
+    
+    if (isInvalid) {
+        _BRWalletSetAdd(wallet, wallet->invalidTx, tx);
+    }
+    else {
         // add inputs to spent output set
         for (j = 0; j < tx->inCount; j++) {
-            BRSetAdd(wallet->spentOutputs, &tx->inputs[j]);
+            _BRWalletSetAdd(wallet, wallet->spentOutputs, &tx->inputs[j]);
         }
 
         // check if tx is pending
@@ -209,44 +379,138 @@ static void _BRWalletUpdateBalance(BRWallet *wallet)
                 if (BRSetContains(wallet->pendingTx, &tx->inputs[j].txHash)) isPending = 1; // check for pending inputs
                 // TODO: XXX handle BIP68 check lock time verify rules
             }
+        }
+    }
+
+    if (isPending) {
+        // outputs spent by a pending tx remain in the UTXO set until the next non-pending tx is applied
+        _BRWalletSetAdd(wallet, wallet->pendingTx, tx);
+        if (wallet->pendingIdx == SIZE_MAX) wallet->pendingIdx = txIdx;
+        
+        for (j = 0; j < tx->inCount; j++) {
+            array_add(wallet->deferredSpends, &tx->inputs[j]);
+        }
+    }
+    else if (! isInvalid) {
+        // remove outputs spent by preceding pending transactions, and by this one, from the UTXO set
+        if (array_count(wallet->deferredSpends) > 0) {
+            array_add_array(wallet->undoDeferred, wallet->deferredSpends, array_count(wallet->deferredSpends));
             
-            if (isPending) {
-                BRSetAdd(wallet->pendingTx, tx);
-                array_add(wallet->balanceHist, balance);
-                continue;
+            for (j = 0; j < array_count(wallet->deferredSpends); j++) {
+                _BRWalletSpendUTXO(wallet, wallet->deferredSpends[j]);
             }
+            
+            array_clear(wallet->deferredSpends);
         }
-
+        
+        for (j = 0; j < tx->inCount; j++) {
+            _BRWalletSpendUTXO(wallet, &tx->inputs[j]);
+        }
+        
         // add outputs to UTXO set
         // TODO: don't add outputs below TX_MIN_OUTPUT_AMOUNT
         // TODO: don't add coin generation outputs < 100 blocks deep
         // NOTE: balance/UTXOs will then need to be recalculated when last block changes
         for (j = 0; j < tx->outCount; j++) {
             pkh = BRScriptPKH(tx->outputs[j].script, tx->outputs[j].scriptLen);
-
+            
             if (pkh && BRSetContains(wallet->allPKH, pkh)) {
-                BRSetAdd(wallet->usedPKH, (void *)pkh);
-                array_add(wallet->utxos, ((const BRUTXO) { tx->txHash, (uint32_t)j }));
-                balance += tx->outputs[j].amount;
+                _BRWalletSetAdd(wallet, wallet->usedPKH, (void *)pkh);
+                
+                // transaction ordering is not guaranteed, so the output may already be spent by an earlier tx
+                if (! BRSetContains(wallet->spentOutputs, &((const BRUTXO) { tx->txHash, (uint32_t)j }))) {
+                    _BRWalletAddUTXO(wallet, ((const BRUTXO) { tx->txHash, (uint32_t)j }));
+                    wallet->balance += tx->outputs[j].amount;
+                }
             }
-        }
-
-        // transaction ordering is not guaranteed, so check the entire UTXO set against the entire spent output set
-        for (j = array_count(wallet->utxos); j > 0; j--) {
-            if (! BRSetContains(wallet->spentOutputs, &wallet->utxos[j - 1])) continue;
-            t = BRSetGet(wallet->allTx, &wallet->utxos[j - 1].hash);
-            balance -= t->outputs[wallet->utxos[j - 1].n].amount;
-            array_rm(wallet->utxos, j - 1);
+            else if (pkh) _BRWalletSetAdd(wallet, wallet->unknownPKH, (void *)pkh);
         }
         
-        if (prevBalance < balance) wallet->totalReceived += balance - prevBalance;
-        if (balance < prevBalance) wallet->totalSent += prevBalance - balance;
-        array_add(wallet->balanceHist, balance);
-        prevBalance = balance;
+        if (prevBalance < wallet->balance) wallet->totalReceived += wallet->balance - prevBalance;
+        if (wallet->balance < prevBalance) wallet->totalSent += prevBalance - wallet->balance;
     }
+    
+    array_add(wallet->balanceHist, wallet->balance);
+    array_add(wallet->undo, undo);
+    if (array_count(wallet->undo) >= WALLET_UNDO_DEPTH*2) _BRWalletUndoTrim(wallet);
+}
+
+// reverts the most recently applied transaction
+static void _BRWalletUnapplyTx(BRWallet *wallet)
+{
+    BRWalletUndo *u = &wallet->undo[array_count(wallet->undo) - 1];
+    BRWalletSpentUTXO *s;
+    BRWalletSetOp *op;
+    size_t i;
+    
+    assert(array_count(wallet->undo) > 0);
+    
+    for (i = array_count(wallet->utxos); i > u->utxoCount; i--) { // remove utxos added by tx
+        if (! UInt256IsZero(wallet->utxos[i - 1].hash)) BRSetRemove(wallet->utxoIndex, &wallet->utxos[i - 1]);
+    }
+    
+    array_set_count(wallet->utxos, u->utxoCount);
+    
+    for (i = array_count(wallet->undoSpent); i > u->spentIdx; i--) { // restore utxos spent by tx
+        s = &wallet->undoSpent[i - 1];
+        wallet->utxos[s->idx] = s->utxo;
+        BRSetAdd(wallet->utxoIndex, &wallet->utxos[s->idx]);
+    }
+    
+    array_set_count(wallet->undoSpent, u->spentIdx);
+    
+    for (i = array_count(wallet->undoOps); i > u->opsIdx; i--) {
+        op = &wallet->undoOps[i - 1];
+        if (op->replaced) BRSetAdd(op->set, op->replaced);
+        else BRSetRemove(op->set, op->item);
+    }
+    
+    array_set_count(wallet->undoOps, u->opsIdx);
+    
+    if (array_count(wallet->undoDeferred) > u->deferredIdx) { // restore deferred spends consumed by tx
+        array_clear(wallet->deferredSpends);
+        array_add_array(wallet->deferredSpends, &wallet->undoDeferred[u->deferredIdx],
+                        array_count(wallet->undoDeferred) - u->deferredIdx);
+        array_set_count(wallet->undoDeferred, u->deferredIdx);
+    }
+    else array_set_count(wallet->deferredSpends, u->deferredCount);
+    
+    wallet->balance = u->balance;
+    wallet->totalSent = u->totalSent;
+    wallet->totalReceived = u->totalReceived;
+    array_rm_last(wallet->balanceHist);
+    if (wallet->pendingIdx == array_count(wallet->balanceHist)) wallet->pendingIdx = SIZE_MAX;
+    array_rm_last(wallet->undo);
+}
 
+// publishes balance, totals, feePerKb and blockHeight for lock free reads, called by writers before releasing the lock
+static void _BRWalletPublish(BRWallet *wallet)
+{
+    atomic_store_explicit(&wallet->publishedBalance, wallet->balance, memory_order_relaxed);
+    atomic_store_explicit(&wallet->publishedTotalSent, wallet->totalSent, memory_order_relaxed);
+    atomic_store_explicit(&wallet->publishedTotalReceived, wallet->totalReceived, memory_order_relaxed);
+    atomic_store_explicit(&wallet->publishedFeePerKb, wallet->feePerKb, memory_order_relaxed);
+    atomic_store_explicit(&wallet->publishedBlockHeight, wallet->blockHeight, memory_order_relaxed);
+}
+
+// brings balance, utxos and spent outputs up to date with wallet->transactions, applying only the transactions that
+// aren't yet reflected in balanceHist (callers rewind with _BRWalletBalanceRewind() before reordering transactions)
+static void _BRWalletUpdateBalance(BRWallet *wallet)
+{
+    time_t now = time(NULL);
+    size_t utxoCount;
+    
+    // pending status depends on the current time and block height, so always re-evaluate pending transactions
+    if (wallet->pendingIdx < array_count(wallet->balanceHist)) _BRWalletBalanceRewind(wallet, wallet->pendingIdx);
+    
+    while (array_count(wallet->balanceHist) < array_count(wallet->transactions)) {
+        _BRWalletApplyTx(wallet, now);
+    }
+    
+    utxoCount = BRSetCount(wallet->utxoIndex);
+    if (array_count(wallet->utxos) - utxoCount > utxoCount + WALLET_UNDO_DEPTH) _BRWalletCompactUTXOs(wallet);
     assert(array_count(wallet->balanceHist) == array_count(wallet->transactions));
-    wallet->balance = balance;
+    _BRWalletPublish(wallet);
 }
 
 // allocates and populates a BRWallet struct which must be freed by calling BRWalletFree()
@@ -255,6 +519,7 @@ BRWallet *BRWalletNew(BRAddressParams addrParams, BRTransaction *transactions[],
     BRWallet *wallet = NULL;
     BRTransaction *tx;
     const uint8_t *pkh;
+    pthread_rwlockattr_t lockAttr;
 
     assert(transactions != NULL || txCount == 0);
     wallet = calloc(1, sizeof(*wallet));
@@ -263,6 +528,8 @@ BRWallet *BRWalletNew(BRAddressParams addrParams, BRTransaction *transactions[],
     array_new(wallet->transactions, txCount + 100);
     wallet->feePerKb = DEFAULT_FEE_PER_KB;
     wallet->masterPubKey = mpk;
+    wallet->chainPubKeys[SEQUENCE_EXTERNAL_CHAIN] = BRBIP32ChainPubKey(mpk, SEQUENCE_EXTERNAL_CHAIN);
+    wallet->chainPubKeys[SEQUENCE_INTERNAL_CHAIN] = BRBIP32ChainPubKey(mpk, SEQUENCE_INTERNAL_CHAIN);
     wallet->addrParams = addrParams;
     array_new(wallet->internalChain, 100);
     array_new(wallet->externalChain, 100);
@@ -273,7 +540,23 @@ BRWallet *BRWalletNew(BRAddressParams addrParams, BRTransaction *transactions[],
     wallet->spentOutputs = BRSetNew(BRUTXOHash, BRUTXOEq, txCount + 100);
     wallet->usedPKH = BRSetNew(_pkhHash, _pkhEq, txCount + 100);
     wallet->allPKH = BRSetNew(_pkhHash, _pkhEq, txCount + 100);
-    pthread_mutex_init(&wallet->lock, NULL);
+    wallet->utxoIndex = BRSetNew(BRUTXOHash, BRUTXOEq, 100);
+    wallet->unknownPKH = BRSetNew(_pkhHash, _pkhEq, txCount + 100);
+    array_new(wallet->deferredSpends, 10);
+    wallet->pendingIdx = SIZE_MAX;
+    array_new(wallet->undo, WALLET_UNDO_DEPTH*2);
+    array_new(wallet->undoOps, 100);
+    array_new(wallet->undoSpent, 100);
+    array_new(wallet->undoDeferred, 10);
+    pthread_rwlockattr_init(&lockAttr);
+#if defined(__GLIBC__) || (defined(__ANDROID_API__) && __ANDROID_API__ >= 23)
+    // glibc and bionic prefer readers by default, which lets a steady stream of queries starve sync updates
+    pthread_rwlockattr_setkind_np(&lockAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&wallet->lock, &lockAttr);
+    pthread_rwlockattr_destroy(&lockAttr);
+    wallet->txAmounts = BRSetNew(BRTransactionHash, BRTransactionEq, txCount + 100);
+    pthread_mutex_init(&wallet->amountsLock, NULL);
 
     for (size_t i = 0; transactions && i < txCount; i++) {
         tx = transactions[i];
@@ -290,6 +573,7 @@ BRWallet *BRWalletNew(BRAddressParams addrParams, BRTransaction *transactions[],
     BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL_EXTENDED, SEQUENCE_EXTERNAL_CHAIN);
     BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL_EXTENDED, SEQUENCE_INTERNAL_CHAIN);
 
+    _BRWalletBalanceReset(wallet); // usedPKH was only needed to generate addresses, it's rebuilt by the replay
     _BRWalletUpdateBalance(wallet);
 
     if (txCount > 0 && ! _BRWalletContainsTx(wallet, transactions[0])) { // verify transactions match master pubKey
@@ -336,7 +620,27 @@ size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress addrs[], uint32_t gapLimi
 
     assert(wallet != NULL);
     assert(gapLimit > 0);
-    pthread_mutex_lock(&wallet->lock);
+    
+    // addresses are usually already generated, so look for them with the lock shared first
+    pthread_rwlock_rdlock(&wallet->lock);
+    if (internal == SEQUENCE_EXTERNAL_CHAIN) chain = wallet->externalChain;
+    if (internal == SEQUENCE_INTERNAL_CHAIN) chain = wallet->internalChain;
+    assert(chain != NULL);
+    i = count = array_count(chain);
+    while (i > 0 && ! BRSetContains(wallet->usedPKH, &chain[i - 1])) i--;
+    
+    if (i + gapLimit <= count) {
+        for (j = 0; addrs && j < gapLimit; j++) {
+            BRAddressFromHash160(addrs[j].s, sizeof(*addrs), wallet->addrParams, &chain[i + j]);
+        }
+        
+        pthread_rwlock_unlock(&wallet->lock);
+        return j;
+    }
+    
+    pthread_rwlock_unlock(&wallet->lock);
+    j = 0;
+    pthread_rwlock_wrlock(&wallet->lock);
     if (internal == SEQUENCE_EXTERNAL_CHAIN) chain = wallet->externalChain;
     if (internal == SEQUENCE_INTERNAL_CHAIN) chain = wallet->internalChain;
     assert(chain != NULL);
@@ -347,14 +651,23 @@ size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress addrs[], uint32_t gapLimi
     while (i > 0 && ! BRSetContains(wallet->usedPKH, &chain[i - 1])) i--;
     
     while (i + gapLimit > count) { // generate new addresses up to gapLimit
+        size_t n = i + gapLimit - count, threadCount = (n + WALLET_DERIVATION_BATCH - 1)/WALLET_DERIVATION_BATCH, k;
+        BRECPoint *pubKeys = malloc(n*sizeof(*pubKeys));
         BRKey key;
-        uint8_t pubKey[BRBIP32PubKey(NULL, 0, wallet->masterPubKey, internal, count)];
-        size_t len = BRBIP32PubKey(pubKey, sizeof(pubKey), wallet->masterPubKey, internal, (uint32_t)count);
         
-        if (! BRKeySetPubKey(&key, pubKey, len)) break;
-        array_add(chain, BRKeyHash160(&key));
-        count++;
-        if (BRSetContains(wallet->usedPKH, &chain[array_count(chain) - 1])) i = count;
+        assert(pubKeys != NULL);
+        if (threadCount > WALLET_DERIVATION_MAX_THREADS) threadCount = WALLET_DERIVATION_MAX_THREADS;
+        BRBIP32PubKeyRange(pubKeys, n, wallet->chainPubKeys[internal], (uint32_t)count, threadCount);
+        if (array_capacity(chain) < count + n) array_set_capacity(chain, count + n);
+        
+        for (k = 0; k < n && BRKeySetPubKey(&key, pubKeys[k].p, sizeof(pubKeys[k])); k++) {
+            array_add(chain, BRKeyHash160(&key));
+            count++;
+            if (BRSetContains(wallet->usedPKH, &chain[array_count(chain) - 1])) i = count;
+        }
+        
+        free(pubKeys);
+        if (k < n) break; // invalid key
     }
 
     if (addrs && i + gapLimit <= count) {
@@ -363,6 +676,8 @@ size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress addrs[], uint32_t gapLimi
         }
     }
     
+    if (count > startCount) wallet->pkhGeneration++;
+    
     // was chain moved to a new memory location?
     if (chain == origChain) {
         for (i = startCount; i < count; i++) {
@@ -384,7 +699,15 @@ size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress addrs[], uint32_t gapLimi
         }
     }
 
-    pthread_mutex_unlock(&wallet->lock);
+    // if an already applied transaction has an output to one of the new addresses, the balance must be replayed
+    for (i = startCount; i < count && ! BRSetContains(wallet->unknownPKH, &chain[i]); i++);
+    
+    if (i < count) {
+        _BRWalletBalanceReset(wallet);
+        _BRWalletUpdateBalance(wallet);
+    }
+
+    pthread_rwlock_unlock(&wallet->lock);
     return j;
 }
 
@@ -394,9 +717,7 @@ uint64_t BRWalletBalance(BRWallet *wallet)
     uint64_t balance;
 
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
-    balance = wallet->balance;
-    pthread_mutex_unlock(&wallet->lock);
+    balance = atomic_load_explicit(&wallet->publishedBalance, memory_order_relaxed);
     return balance;
 }
 
@@ -404,14 +725,14 @@ uint64_t BRWalletBalance(BRWallet *wallet)
 size_t BRWalletUTXOs(BRWallet *wallet, BRUTXO *utxos, size_t utxosCount)
 {
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
-    if (! utxos || array_count(wallet->utxos) < utxosCount) utxosCount = array_count(wallet->utxos);
+    pthread_rwlock_rdlock(&wallet->lock);
+    if (! utxos || BRSetCount(wallet->utxoIndex) < utxosCount) utxosCount = BRSetCount(wallet->utxoIndex);
 
-    for (size_t i = 0; utxos && i < utxosCount; i++) {
-        utxos[i] = wallet->utxos[i];
+    for (size_t i = 0, j = 0; utxos && j < utxosCount; i++) {
+        if (! UInt256IsZero(wallet->utxos[i].hash)) utxos[j++] = wallet->utxos[i];
     }
 
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return utxosCount;
 }
 
@@ -420,14 +741,14 @@ size_t BRWalletUTXOs(BRWallet *wallet, BRUTXO *utxos, size_t utxosCount)
 size_t BRWalletTransactions(BRWallet *wallet, BRTransaction *transactions[], size_t txCount)
 {
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     if (! transactions || array_count(wallet->transactions) < txCount) txCount = array_count(wallet->transactions);
 
     for (size_t i = 0; transactions && i < txCount; i++) {
         transactions[i] = wallet->transactions[i];
     }
     
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return txCount;
 }
 
@@ -439,7 +760,7 @@ size_t BRWalletTxUnconfirmedBefore(BRWallet *wallet, BRTransaction *transactions
     size_t total, n = 0;
 
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     total = array_count(wallet->transactions);
     while (n < total && wallet->transactions[(total - n) - 1]->blockHeight >= blockHeight) n++;
     if (! transactions || n < txCount) txCount = n;
@@ -448,7 +769,7 @@ size_t BRWalletTxUnconfirmedBefore(BRWallet *wallet, BRTransaction *transactions
         transactions[i] = wallet->transactions[(total - n) + i];
     }
 
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return txCount;
 }
 
@@ -458,9 +779,7 @@ uint64_t BRWalletTotalSent(BRWallet *wallet)
     uint64_t totalSent;
     
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
-    totalSent = wallet->totalSent;
-    pthread_mutex_unlock(&wallet->lock);
+    totalSent = atomic_load_explicit(&wallet->publishedTotalSent, memory_order_relaxed);
     return totalSent;
 }
 
@@ -470,9 +789,7 @@ uint64_t BRWalletTotalReceived(BRWallet *wallet)
     uint64_t totalReceived;
     
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
-    totalReceived = wallet->totalReceived;
-    pthread_mutex_unlock(&wallet->lock);
+    totalReceived = atomic_load_explicit(&wallet->publishedTotalReceived, memory_order_relaxed);
     return totalReceived;
 }
 
@@ -482,18 +799,17 @@ uint64_t BRWalletFeePerKb(BRWallet *wallet)
     uint64_t feePerKb;
     
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
-    feePerKb = wallet->feePerKb;
-    pthread_mutex_unlock(&wallet->lock);
+    feePerKb = atomic_load_explicit(&wallet->publishedFeePerKb, memory_order_relaxed);
     return feePerKb;
 }
 
 void BRWalletSetFeePerKb(BRWallet *wallet, uint64_t feePerKb)
 {
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_wrlock(&wallet->lock);
     wallet->feePerKb = feePerKb;
-    pthread_mutex_unlock(&wallet->lock);
+    _BRWalletPublish(wallet);
+    pthread_rwlock_unlock(&wallet->lock);
 }
 
 BRAddressParams BRWalletGetAddressParams (BRWallet *wallet) {
@@ -543,7 +859,7 @@ size_t BRWalletAllAddrs(BRWallet *wallet, BRAddress addrs[], size_t addrsCount)
     size_t i, internalCount = 0, externalCount = 0;
     
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     internalCount = (! addrs || array_count(wallet->internalChain) < addrsCount) ?
                     array_count(wallet->internalChain) : addrsCount;
 
@@ -558,7 +874,7 @@ size_t BRWalletAllAddrs(BRWallet *wallet, BRAddress addrs[], size_t addrsCount)
         BRAddressFromHash160(addrs[internalCount + i].s, sizeof(*addrs), wallet->addrParams, &wallet->externalChain[i]);
     }
 
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return internalCount + externalCount;
 }
 
@@ -570,10 +886,10 @@ int BRWalletContainsAddress(BRWallet *wallet, const char *addr)
     
     assert(wallet != NULL);
     assert(addr != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     if (addr) BRAddressHash160(&pkh, wallet->addrParams, addr);
     r = BRSetContains(wallet->allPKH, &pkh);
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return r;
 }
 
@@ -585,10 +901,10 @@ int BRWalletAddressIsUsed(BRWallet *wallet, const char *addr)
     
     assert(wallet != NULL);
     assert(addr != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     if (addr) BRAddressHash160(&pkh, wallet->addrParams, addr);
     r = BRSetContains(wallet->usedPKH, &pkh);
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return r;
 }
 
@@ -626,9 +942,140 @@ BRTransaction *BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput out
 // use feePerKb UINT64_MAX to indicate that the wallet feePerKb should be used
 BRTransaction *BRWalletCreateTxForOutputsWithFeePerKb(BRWallet *wallet, uint64_t feePerKb, const BRTxOutput outputs[], size_t outCount)
 {
-    BRTransaction *tx, *transaction = BRTransactionNew();
-    uint64_t feeAmount, amount = 0, balance = 0, minAmount;
+    return BRWalletCreateTxForOutputsWithStrategy(wallet, feePerKb, outputs, outCount, BRCoinSelectionFirstFit, 0);
+}
+
+// adds an unsigned input to a running vsize estimate
+inline static void _txSizeAddInput(BRWalletTxSize *s, int isWitness)
+{
+    if (isWitness) s->witSize += TX_INPUT_SIZE; // estimated P2WPKH signature size
+    else s->size += TX_INPUT_SIZE; // estimated P2PKH signature size
+    s->inCount++;
+}
+
+inline static void _txSizeRemoveInput(BRWalletTxSize *s, int isWitness)
+{
+    if (isWitness) s->witSize -= TX_INPUT_SIZE;
+    else s->size -= TX_INPUT_SIZE;
+    s->inCount--;
+}
+
+// same result as BRTransactionVSize() for a transaction with the estimated inputs and outputs, none of them signed
+inline static size_t _txSizeVSize(const BRWalletTxSize *s)
+{
+    size_t size = 8 + BRVarIntSize(s->inCount) + BRVarIntSize(s->outCount) + s->size,
+           witSize = (s->witSize > 0) ? s->witSize + 2 + s->inCount : 0;
+    
+    return (size*4 + witSize + 3)/4;
+}
+
+inline static int _coinValueDescending(const void *c1, const void *c2)
+{
+    int64_t v1 = ((const BRWalletCoin *)c1)->value, v2 = ((const BRWalletCoin *)c2)->value;
+    
+    return (v1 < v2) ? 1 : (v1 > v2) ? -1 : 0;
+}
+
+inline static int _coinValueAscending(const void *c1, const void *c2)
+{
+    return _coinValueDescending(c2, c1);
+}
+
+inline static double _timeNow(void)
+{
+    struct timeval tv;
+    
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (double)tv.tv_usec/1000000;
+}
+
+// depth-first branch-and-bound search over coins sorted by descending effective value for an input set that pays for
+// the outputs with no change output, leaving at most minAmount extra as fee; the input set wasting the least is written
+// to selected, and true is returned if one was found before the search was exhausted, timed out, or ran out of tries
+static int _BRWalletSelectCoinsBnB(const BRWalletCoin coins[], size_t count, uint8_t selected[], uint64_t feePerKb,
+                                   uint64_t feeRate, const BRWalletTxSize *txSize, uint64_t amount, uint64_t minAmount,
+                                   double timeout)
+{
+    BRWalletTxSize s = *txSize;
+    uint8_t *included;
+    int64_t *rest, value = 0, target = amount + _txSizeVSize(txSize)*feeRate/1000;
+    uint64_t total = 0, fee, waste = UINT64_MAX;
+    size_t i, tries, depth = 0;
+    double end = (timeout > 0) ? _timeNow() + timeout : DBL_MAX;
+    int backtrack;
+    
+    while (count > 0 && coins[count - 1].value <= 0) count--; // uneconomical to spend
+    if (count == 0) return 0;
+    included = calloc(count, sizeof(*included));
+    rest = calloc(count + 1, sizeof(*rest));
+    assert(included != NULL && rest != NULL);
+    for (i = count; i > 0; i--) rest[i - 1] = rest[i] + coins[i - 1].value; // effective value left after each depth
+    
+    for (tries = 0; tries < COIN_SELECTION_MAX_TRIES; tries++) {
+        if ((tries % 1000) == 999 && _timeNow() > end) break;
+        backtrack = 0;
+        
+        if (value > target + (int64_t)minAmount) { // overshot, any further inputs only add fee
+            backtrack = 1;
+        }
+        else if (value >= target) { // candidate, check against the actual fee before accepting it
+            fee = _txFee(feePerKb, _txSizeVSize(&s));
+            
+            if (_txSizeVSize(&s) <= TX_MAX_SIZE && total >= amount + fee && total - (amount + fee) <= minAmount &&
+                total - (amount + fee) < waste) {
+                waste = total - (amount + fee);
+                memcpy(selected, included, count);
+            }
+
+            backtrack = 1;
+        }
+        else if (value + rest[depth] < target) backtrack = 1; // not enough left to reach the target
+        
+        if (waste == 0) break; // can't do better than an exact match
+        
+        if (backtrack) { // exclude the most recently included coin and try the next branch
+            while (depth > 0 && ! included[depth - 1]) depth--;
+            if (depth == 0) break; // search exhausted
+            depth--;
+            included[depth] = 0;
+            value -= coins[depth].value;
+            total -= coins[depth].amount;
+            _txSizeRemoveInput(&s, coins[depth].isWitness);
+            depth++;
+        }
+        else if (depth > 0 && ! included[depth - 1] && coins[depth].value == coins[depth - 1].value &&
+                 coins[depth].isWitness == coins[depth - 1].isWitness) { // same as the previous omitted coin
+            depth++;
+        }
+        else {
+            included[depth] = 1;
+            value += coins[depth].value;
+            total += coins[depth].amount;
+            _txSizeAddInput(&s, coins[depth].isWitness);
+            depth++;
+        }
+    }
+
+    free(rest);
+    free(included);
+    return (waste != UINT64_MAX);
+}
+
+// returns an unsigned transaction that satisifes the given transaction outputs, with inputs chosen using strategy
+// timeout is the time budget in seconds for the branch-and-bound search, 0 for no limit besides the maximum tries
+// result must be freed using BRTransactionFree()
+// use feePerKb UINT64_MAX to indicate that the wallet feePerKb should be used
+BRTransaction *BRWalletCreateTxForOutputsWithStrategy(BRWallet *wallet, uint64_t feePerKb, const BRTxOutput outputs[],
+                                                     size_t outCount, BRCoinSelectionStrategy strategy, double timeout)
+{
+    BRTransaction *transaction = BRTransactionNew();
+    const BRTransaction *tx;
+    uint64_t feeAmount, amount = 0, balance = 0, minAmount, feeRate;
     size_t i, j, cpfpSize = 0;
+    BRWalletTxSize txSize = { 0, outCount, 0, 0 }, s;
+    BRWalletCoin *coins, coin;
+    uint8_t *selected = NULL;
+    const BRTxOutput *out;
     BRUTXO *o;
     BRAddress addr = BR_ADDRESS_NONE;
     
@@ -638,33 +1085,80 @@ BRTransaction *BRWalletCreateTxForOutputsWithFeePerKb(BRWallet *wallet, uint64_t
     for (i = 0; outputs && i < outCount; i++) {
         assert(outputs[i].script != NULL && outputs[i].scriptLen > 0);
         BRTransactionAddOutput(transaction, outputs[i].amount, outputs[i].script, outputs[i].scriptLen);
+        txSize.size += sizeof(uint64_t) + BRVarIntSize(outputs[i].scriptLen) + outputs[i].scriptLen;
         amount += outputs[i].amount;
     }
     
     minAmount = BRWalletMinOutputAmountWithFeePerKb(wallet, feePerKb);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     feePerKb = UINT64_MAX == feePerKb ? wallet->feePerKb : feePerKb;
-    feeAmount = _txFee(feePerKb, BRTransactionVSize(transaction) + TX_OUTPUT_SIZE);
+    feeRate = (feePerKb > TX_FEE_PER_KB) ? feePerKb : TX_FEE_PER_KB;
+    feeAmount = _txFee(feePerKb, _txSizeVSize(&txSize) + TX_OUTPUT_SIZE);
+    array_new(coins, BRSetCount(wallet->utxoIndex));
     
-    // TODO: use up all UTXOs for all used addresses to avoid leaving funds in addresses whose public key is revealed
-    // TODO: avoid combining addresses in a single transaction when possible to reduce information leakage
-    // TODO: use up UTXOs received from any of the output scripts that this transaction sends funds to, to mitigate an
-    //       attacker double spending and requesting a refund
     for (i = 0; i < array_count(wallet->utxos); i++) {
         o = &wallet->utxos[i];
+        if (UInt256IsZero(o->hash)) continue; // spent
         tx = BRSetGet(wallet->allTx, o);
         if (! tx || o->n >= tx->outCount) continue;
-        BRTransactionAddInput(transaction, tx->txHash, o->n, tx->outputs[o->n].amount,
-                              tx->outputs[o->n].script, tx->outputs[o->n].scriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+        out = &tx->outputs[o->n];
+        coin.tx = tx;
+        coin.n = o->n;
+        coin.amount = out->amount;
+        coin.isWitness = (out->script && out->scriptLen > 0 && out->script[0] == OP_0);
+        coin.value = (int64_t)out->amount - (int64_t)((coin.isWitness ? (TX_INPUT_SIZE + 4)/4 : TX_INPUT_SIZE)*feeRate/1000);
+        array_add(coins, coin);
+    }
+    
+    // effective value pre-sort, so the inputs that cost the least to spend relative to their amount come first
+    if (strategy == BRCoinSelectionBranchAndBound || strategy == BRCoinSelectionLargestFirst) {
+        qsort(coins, array_count(coins), sizeof(*coins), _coinValueDescending);
+    }
+    else if (strategy == BRCoinSelectionConsolidate) {
+        qsort(coins, array_count(coins), sizeof(*coins), _coinValueAscending);
+    }
+    
+    if (strategy == BRCoinSelectionBranchAndBound && array_count(coins) > 0) {
+        selected = calloc(array_count(coins), sizeof(*selected));
+        assert(selected != NULL);
         
-        if (BRTransactionVSize(transaction) + TX_OUTPUT_SIZE > TX_MAX_SIZE) { // transaction size-in-bytes too large
+        if (_BRWalletSelectCoinsBnB(coins, array_count(coins), selected, feePerKb, feeRate, &txSize, amount, minAmount,
+                                    timeout)) {
+            for (i = 0; i < array_count(coins); i++) {
+                if (! selected[i]) continue;
+                out = &coins[i].tx->outputs[coins[i].n];
+                BRTransactionAddInput(transaction, coins[i].tx->txHash, coins[i].n, out->amount, out->script,
+                                      out->scriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+                _txSizeAddInput(&txSize, coins[i].isWitness);
+                balance += out->amount;
+            }
+            
+            feeAmount = _txFee(feePerKb, _txSizeVSize(&txSize) + cpfpSize); // no change output
+            array_clear(coins); // done, skip largest-first fallback
+        }
+        
+        free(selected);
+    }
+    
+    // TODO: use up all UTXOs for all used addresses to avoid leaving funds in addresses whose public key is revealed
+    // TODO: avoid combining addresses in a single transaction when possible to reduce information leakage
+    // TODO: use up UTXOs received from any of the output scripts that this transaction sends funds to, to mitigate an
+    //       attacker double spending and requesting a refund
+    for (i = 0; i < array_count(coins); i++) {
+        if (strategy != BRCoinSelectionFirstFit && coins[i].value <= 0) continue; // uneconomical to spend
+        s = txSize;
+        _txSizeAddInput(&s, coins[i].isWitness);
+        
+        if (_txSizeVSize(&s) + TX_OUTPUT_SIZE > TX_MAX_SIZE) { // transaction size-in-bytes too large
+            // consolidate as many inputs as fit
+            if (strategy == BRCoinSelectionConsolidate && balance >= amount + feeAmount) break;
             BRTransactionFree(transaction);
             transaction = NULL;
         
             // check for sufficient total funds before building a smaller transaction
-            if (wallet->balance < amount + _txFee(feePerKb, 10 + array_count(wallet->utxos)*TX_INPUT_SIZE +
+            if (wallet->balance < amount + _txFee(feePerKb, 10 + BRSetCount(wallet->utxoIndex)*TX_INPUT_SIZE +
                                                   (outCount + 1)*TX_OUTPUT_SIZE + cpfpSize)) break;
-            pthread_mutex_unlock(&wallet->lock);
+            pthread_rwlock_unlock(&wallet->lock);
 
             if (outputs[outCount - 1].amount > amount + feeAmount + minAmount - balance) {
                 BRTxOutput newOutputs[outCount];
@@ -674,16 +1168,23 @@ BRTransaction *BRWalletCreateTxForOutputsWithFeePerKb(BRWallet *wallet, uint64_t
                 }
                 
                 newOutputs[outCount - 1].amount -= amount + feeAmount - balance; // reduce last output amount
-                transaction = BRWalletCreateTxForOutputsWithFeePerKb(wallet, feePerKb, newOutputs, outCount);
+                transaction = BRWalletCreateTxForOutputsWithStrategy(wallet, feePerKb, newOutputs, outCount,
+                                                                     strategy, timeout);
             }
-            else transaction = BRWalletCreateTxForOutputsWithFeePerKb(wallet, feePerKb, outputs, outCount - 1); // remove last output
+            else transaction = BRWalletCreateTxForOutputsWithStrategy(wallet, feePerKb, outputs, outCount - 1,
+                                                                      strategy, timeout); // remove last output
 
             balance = amount = feeAmount = 0;
-            pthread_mutex_lock(&wallet->lock);
+            pthread_rwlock_rdlock(&wallet->lock);
             break;
         }
         
-        balance += tx->outputs[o->n].amount;
+        tx = coins[i].tx;
+        BRTransactionAddInput(transaction, tx->txHash, coins[i].n, tx->outputs[coins[i].n].amount,
+                              tx->outputs[coins[i].n].script, tx->outputs[coins[i].n].scriptLen, NULL, 0, NULL, 0,
+                              TXIN_SEQUENCE);
+        txSize = s;
+        balance += tx->outputs[coins[i].n].amount;
         
 //        // size of unconfirmed, non-change inputs for child-pays-for-parent fee
 //        // don't include parent tx with more than 10 inputs or 10 outputs
@@ -691,15 +1192,17 @@ BRTransaction *BRWalletCreateTxForOutputsWithFeePerKb(BRWallet *wallet, uint64_t
 //            ! _BRWalletTxIsSend(wallet, tx)) cpfpSize += BRTransactionVSize(tx);
 
         // fee amount after adding a change output
-        feeAmount = _txFee(feePerKb, BRTransactionVSize(transaction) + TX_OUTPUT_SIZE + cpfpSize);
+        feeAmount = _txFee(feePerKb, _txSizeVSize(&txSize) + TX_OUTPUT_SIZE + cpfpSize);
 
         // increase fee to round off remaining wallet balance to nearest 100 satoshi
         if (wallet->balance > amount + feeAmount) feeAmount += (wallet->balance - (amount + feeAmount)) % 100;
         
-        if (balance == amount + feeAmount || balance >= amount + feeAmount + minAmount) break;
+        if (strategy != BRCoinSelectionConsolidate &&
+            (balance == amount + feeAmount || balance >= amount + feeAmount + minAmount)) break;
     }
     
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
+    array_free(coins);
     
     if (transaction && (outCount < 1 || balance < amount + feeAmount)) { // no outputs/insufficient funds
         BRTransactionFree(transaction);
@@ -722,6 +1225,17 @@ BRTransaction *BRWalletCreateTxForOutputsWithFeePerKb(BRWallet *wallet, uint64_t
 // seed is the master private key (wallet seed) corresponding to the master public key given when the wallet was created
 // returns true if all inputs were signed, or false if there was an error or not all inputs were able to be signed
 int BRWalletSignTransaction(BRWallet *wallet, BRTransaction *tx, uint8_t forkId, const void *seed, size_t seedLen)
+{
+    return BRWalletSignTransactionParallel(wallet, tx, forkId, seed, seedLen, 1);
+}
+
+// signs any inputs in tx that can be signed using private keys from the wallet, deriving keys and signing on up to
+// threadCount threads (including the calling thread), with the same result as BRWalletSignTransaction()
+// forkId is 0 for bitcoin, 0x40 for b-cash
+// seed is the master private key (wallet seed) corresponding to the master public key given when the wallet was created
+// returns true if all inputs were signed, or false if there was an error or not all inputs were able to be signed
+int BRWalletSignTransactionParallel(BRWallet *wallet, BRTransaction *tx, uint8_t forkId, const void *seed,
+                                    size_t seedLen, size_t threadCount)
 {
     uint32_t j, internalIdx[tx->inCount], externalIdx[tx->inCount];
     size_t i, internalCount = 0, externalCount = 0;
@@ -729,7 +1243,7 @@ int BRWalletSignTransaction(BRWallet *wallet, BRTransaction *tx, uint8_t forkId,
     
     assert(wallet != NULL);
     assert(tx != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     
     for (i = 0; tx && i < tx->inCount; i++) {
         const uint8_t *pkh = BRScriptPKH(tx->inputs[i].script, tx->inputs[i].scriptLen);
@@ -743,16 +1257,18 @@ int BRWalletSignTransaction(BRWallet *wallet, BRTransaction *tx, uint8_t forkId,
         }
     }
 
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
 
     BRKey keys[internalCount + externalCount];
 
     if (seed) {
-        BRBIP32PrivKeyList(keys, internalCount, seed, seedLen, SEQUENCE_INTERNAL_CHAIN, internalIdx);
-        BRBIP32PrivKeyList(&keys[internalCount], externalCount, seed, seedLen, SEQUENCE_EXTERNAL_CHAIN, externalIdx);
+        BRBIP32PrivKeyListParallel(keys, internalCount, seed, seedLen, SEQUENCE_INTERNAL_CHAIN, internalIdx,
+                                   threadCount);
+        BRBIP32PrivKeyListParallel(&keys[internalCount], externalCount, seed, seedLen, SEQUENCE_EXTERNAL_CHAIN,
+                                   externalIdx, threadCount);
         // TODO: XXX wipe seed callback
         seed = NULL;
-        if (tx) r = BRTransactionSign(tx, forkId, keys, internalCount + externalCount);
+        if (tx) r = BRTransactionSignParallel(tx, forkId, keys, internalCount + externalCount, threadCount);
         for (i = 0; i < internalCount + externalCount; i++) BRKeyClean(&keys[i]);
     }
     else r = -1; // user canceled authentication
@@ -767,9 +1283,9 @@ int BRWalletContainsTransaction(BRWallet *wallet, const BRTransaction *tx)
     
     assert(wallet != NULL);
     assert(tx != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     if (tx) r = _BRWalletContainsTx(wallet, tx);
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return r;
 }
 
@@ -782,7 +1298,7 @@ int BRWalletRegisterTransaction(BRWallet *wallet, BRTransaction *tx)
     assert(tx != NULL && BRTransactionIsSigned(tx));
     
     if (tx && BRTransactionIsSigned(tx)) {
-        pthread_mutex_lock(&wallet->lock);
+        pthread_rwlock_wrlock(&wallet->lock);
 
         if (! BRSetContains(wallet->allTx, tx)) {
             if (_BRWalletContainsTx(wallet, tx)) {
@@ -790,19 +1306,20 @@ int BRWalletRegisterTransaction(BRWallet *wallet, BRTransaction *tx)
                 // TODO: handle tx replacement with input sequence numbers
                 //       (for now, replacements appear invalid until confirmation)
                 BRSetAdd(wallet->allTx, tx);
-                _BRWalletInsertTx(wallet, tx);
+                wallet->txAddGeneration++;
+                _BRWalletBalanceRewind(wallet, _BRWalletInsertTx(wallet, tx));
                 _BRWalletUpdateBalance(wallet);
                 wasAdded = 1;
             }
             else { // keep track of unconfirmed non-wallet tx for invalid tx checks and child-pays-for-parent fees
                    // BUG: limit total non-wallet unconfirmed tx to avoid memory exhaustion attack
-                if (tx->blockHeight == TX_UNCONFIRMED) BRSetAdd(wallet->allTx, tx);
+                if (tx->blockHeight == TX_UNCONFIRMED) BRSetAdd(wallet->allTx, tx), wallet->txAddGeneration++;
                 r = 0;
                 // BUG: XXX memory leak if tx is not added to wallet->allTx, and we can't just free it
             }
         }
     
-        pthread_mutex_unlock(&wallet->lock);
+        pthread_rwlock_unlock(&wallet->lock);
     }
     else r = 0;
 
@@ -810,7 +1327,7 @@ int BRWalletRegisterTransaction(BRWallet *wallet, BRTransaction *tx)
         // when a wallet address is used in a transaction, generate a new address to replace it
         BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL, SEQUENCE_EXTERNAL_CHAIN);
         BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL, SEQUENCE_INTERNAL_CHAIN);
-        if (wallet->balanceChanged) wallet->balanceChanged(wallet->callbackInfo, wallet->balance);
+        if (wallet->balanceChanged) wallet->balanceChanged(wallet->callbackInfo, BRWalletBalance(wallet));
         if (wallet->txAdded) wallet->txAdded(wallet->callbackInfo, tx);
     }
 
@@ -826,7 +1343,7 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash)
 
     assert(wallet != NULL);
     assert(! UInt256IsZero(txHash));
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_wrlock(&wallet->lock);
     tx = BRSetGet(wallet->allTx, &txHash);
 
     if (tx) {
@@ -845,7 +1362,7 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash)
         }
         
         if (array_count(hashes) > 0) {
-            pthread_mutex_unlock(&wallet->lock);
+            pthread_rwlock_unlock(&wallet->lock);
             
             for (size_t i = array_count(hashes); i > 0; i--) {
                 BRWalletRemoveTransaction(wallet, hashes[i - 1]);
@@ -856,12 +1373,13 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash)
         else {
             for (size_t i = array_count(wallet->transactions); i > 0; i--) {
                 if (! BRTransactionEq(wallet->transactions[i - 1], tx)) continue;
+                _BRWalletBalanceRewind(wallet, i - 1);
                 array_rm(wallet->transactions, i - 1);
                 break;
             }
             
             _BRWalletUpdateBalance(wallet);
-            pthread_mutex_unlock(&wallet->lock);
+            pthread_rwlock_unlock(&wallet->lock);
             
             // if this is for a transaction we sent, and it wasn't already known to be invalid, notify user
             if (BRWalletAmountSentByTx(wallet, tx) > 0 && BRWalletTransactionIsValid(wallet, tx)) {
@@ -875,13 +1393,13 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash)
                 }
             }
 
-            if (wallet->balanceChanged) wallet->balanceChanged(wallet->callbackInfo, wallet->balance);
+            if (wallet->balanceChanged) wallet->balanceChanged(wallet->callbackInfo, BRWalletBalance(wallet));
             if (wallet->txDeleted) wallet->txDeleted(wallet->callbackInfo, txHash, notifyUser, recommendRescan);
         }
         
         array_free(hashes);
     }
-    else pthread_mutex_unlock(&wallet->lock);
+    else pthread_rwlock_unlock(&wallet->lock);
 }
 
 // returns the transaction with the given hash if it's been registered in the wallet
@@ -891,9 +1409,9 @@ BRTransaction *BRWalletTransactionForHash(BRWallet *wallet, UInt256 txHash)
     
     assert(wallet != NULL);
     assert(! UInt256IsZero(txHash));
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     tx = BRSetGet(wallet->allTx, &txHash);
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return tx;
 }
 
@@ -903,10 +1421,10 @@ BRTransaction *BRWalletTransactionCopyForHash(BRWallet *wallet, UInt256 txHash)
 
     assert(wallet != NULL);
     assert(! UInt256IsZero(txHash));
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     tx = BRSetGet(wallet->allTx, &txHash);
     if (tx) tx = BRTransactionCopy (tx);
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return tx;
 }
 
@@ -923,7 +1441,7 @@ int BRWalletTransactionIsValid(BRWallet *wallet, const BRTransaction *tx)
     // TODO: XXX conflicted tx with the same wallet outputs should be presented as the same tx to the user
 
     if (tx && tx->blockHeight == TX_UNCONFIRMED) { // only unconfirmed transactions can be invalid
-        pthread_mutex_lock(&wallet->lock);
+        pthread_rwlock_rdlock(&wallet->lock);
 
         if (! BRSetContains(wallet->allTx, tx)) {
             for (size_t i = 0; r && i < tx->inCount; i++) {
@@ -932,7 +1450,7 @@ int BRWalletTransactionIsValid(BRWallet *wallet, const BRTransaction *tx)
         }
         else if (BRSetContains(wallet->invalidTx, tx)) r = 0;
 
-        pthread_mutex_unlock(&wallet->lock);
+        pthread_rwlock_unlock(&wallet->lock);
 
         for (size_t i = 0; r && i < tx->inCount; i++) {
             t = BRWalletTransactionForHash(wallet, tx->inputs[i].txHash);
@@ -953,9 +1471,7 @@ int BRWalletTransactionIsPending(BRWallet *wallet, const BRTransaction *tx)
     
     assert(wallet != NULL);
     assert(tx != NULL && BRTransactionIsSigned(tx));
-    pthread_mutex_lock(&wallet->lock);
-    blockHeight = wallet->blockHeight;
-    pthread_mutex_unlock(&wallet->lock);
+    blockHeight = atomic_load_explicit(&wallet->publishedBlockHeight, memory_order_relaxed);
 
     if (tx && tx->blockHeight == TX_UNCONFIRMED) { // only unconfirmed transactions can be postdated
         if (BRTransactionVSize(tx) > TX_MAX_SIZE) r = 1; // check transaction size is under TX_MAX_SIZE
@@ -1010,11 +1526,11 @@ void BRWalletUpdateTransactions(BRWallet *wallet, const UInt256 txHashes[], size
     BRTransaction *tx;
     UInt256 hashes[txCount];
     int needsUpdate = 0;
-    size_t i, j, k;
+    size_t i, j, k, n;
     
     assert(wallet != NULL);
     assert(txHashes != NULL || txCount == 0);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_wrlock(&wallet->lock);
     if (blockHeight > wallet->blockHeight) wallet->blockHeight = blockHeight;
     
     for (i = 0, j = 0; txHashes && i < txCount; i++) {
@@ -1027,21 +1543,29 @@ void BRWalletUpdateTransactions(BRWallet *wallet, const UInt256 txHashes[], size
             for (k = array_count(wallet->transactions); k > 0; k--) { // remove and re-insert tx to keep wallet sorted
                 if (! BRTransactionEq(wallet->transactions[k - 1], tx)) continue;
                 array_rm(wallet->transactions, k - 1);
-                _BRWalletInsertTx(wallet, tx);
+                n = _BRWalletInsertTx(wallet, tx);
+                
+                // replay from the earlier of the old and new positions if tx moved, or if its status may change
+                if (n != k - 1 || BRSetContains(wallet->pendingTx, tx) || BRSetContains(wallet->invalidTx, tx)) {
+                    _BRWalletBalanceRewind(wallet, (n < k - 1) ? n : k - 1);
+                    needsUpdate = 1;
+                }
+                
                 break;
             }
             
             hashes[j++] = txHashes[i];
-            if (BRSetContains(wallet->pendingTx, tx) || BRSetContains(wallet->invalidTx, tx)) needsUpdate = 1;
         }
         else if (blockHeight != TX_UNCONFIRMED) { // remove and free confirmed non-wallet tx
             BRSetRemove(wallet->allTx, tx);
+            wallet->txRemoveGeneration++;
             BRTransactionFree(tx);
         }
     }
     
     if (needsUpdate) _BRWalletUpdateBalance(wallet);
-    pthread_mutex_unlock(&wallet->lock);
+    else _BRWalletPublish(wallet);
+    pthread_rwlock_unlock(&wallet->lock);
     if (j > 0 && wallet->txUpdated) wallet->txUpdated(wallet->callbackInfo, hashes, j, blockHeight, timestamp);
 }
 
@@ -1051,7 +1575,7 @@ void BRWalletSetTxUnconfirmedAfter(BRWallet *wallet, uint32_t blockHeight)
     size_t i, j, count;
     
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_wrlock(&wallet->lock);
     wallet->blockHeight = blockHeight;
     count = i = array_count(wallet->transactions);
     while (i > 0 && wallet->transactions[i - 1]->blockHeight > blockHeight) i--;
@@ -1059,85 +1583,140 @@ void BRWalletSetTxUnconfirmedAfter(BRWallet *wallet, uint32_t blockHeight)
 
     UInt256 hashes[count];
 
+    if (count > 0) _BRWalletBalanceRewind(wallet, i);
+
     for (j = 0; j < count; j++) {
         wallet->transactions[i + j]->blockHeight = TX_UNCONFIRMED;
         hashes[j] = wallet->transactions[i + j]->txHash;
     }
     
     if (count > 0) _BRWalletUpdateBalance(wallet);
-    pthread_mutex_unlock(&wallet->lock);
+    else _BRWalletPublish(wallet);
+    pthread_rwlock_unlock(&wallet->lock);
     if (count > 0 && wallet->txUpdated) wallet->txUpdated(wallet->callbackInfo, hashes, count, TX_UNCONFIRMED, 0);
 }
 
-// returns the amount received by the wallet from the transaction (total outputs to change and/or receive addresses)
-uint64_t BRWalletAmountReceivedFromTx(BRWallet *wallet, const BRTransaction *tx)
+static void _setApplyFree(void *info, void *item)
+{
+    free(item);
+}
+
+// computes the amounts received, sent and fee for tx, wallet->lock must be held
+static void _BRWalletComputeTxAmounts(BRWallet *wallet, const BRTransaction *tx, BRWalletTxAmounts *amounts)
 {
-    uint64_t amount = 0;
     const uint8_t *pkh;
     
-    assert(wallet != NULL);
-    assert(tx != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    amounts->received = amounts->sent = amounts->fee = 0;
+    amounts->inputsKnown = 1;
     
     // TODO: don't include outputs below TX_MIN_OUTPUT_AMOUNT
-    for (size_t i = 0; tx && i < tx->outCount; i++) {
+    for (size_t i = 0; i < tx->outCount; i++) {
         pkh = BRScriptPKH(tx->outputs[i].script, tx->outputs[i].scriptLen);
-        if (pkh && BRSetContains(wallet->allPKH, pkh)) amount += tx->outputs[i].amount;
+        if (pkh && BRSetContains(wallet->allPKH, pkh)) amounts->received += tx->outputs[i].amount;
     }
     
-    pthread_mutex_unlock(&wallet->lock);
-    return amount;
-}
-
-// returns the amount sent from the wallet by the trasaction (total wallet outputs consumed, change and fee included)
-uint64_t BRWalletAmountSentByTx(BRWallet *wallet, const BRTransaction *tx)
-{
-    uint64_t amount = 0;
-    
-    assert(wallet != NULL);
-    assert(tx != NULL);
-    pthread_mutex_lock(&wallet->lock);
-    
-    for (size_t i = 0; tx && i < tx->inCount; i++) {
+    for (size_t i = 0; i < tx->inCount; i++) {
         BRTransaction *t = BRSetGet(wallet->allTx, &tx->inputs[i].txHash);
         uint32_t n = tx->inputs[i].index;
-        const uint8_t *pkh;
-
+        
         if (t && n < t->outCount) {
             pkh = BRScriptPKH(t->outputs[n].script, t->outputs[n].scriptLen);
-            if (pkh && BRSetContains(wallet->allPKH, pkh)) amount += t->outputs[n].amount;
+            if (pkh && BRSetContains(wallet->allPKH, pkh)) amounts->sent += t->outputs[n].amount;
+            amounts->fee += t->outputs[n].amount;
         }
+        else amounts->inputsKnown = 0;
     }
     
-    pthread_mutex_unlock(&wallet->lock);
-    return amount;
+    for (size_t i = 0; i < tx->outCount && amounts->inputsKnown; i++) {
+        amounts->fee -= tx->outputs[i].amount;
+    }
+    
+    if (! amounts->inputsKnown) amounts->fee = UINT64_MAX;
 }
 
-// returns the fee for the given transaction if all its inputs are from wallet transactions, UINT64_MAX otherwise
-uint64_t BRWalletFeeForTx(BRWallet *wallet, const BRTransaction *tx)
+// amounts received, sent and fee for tx, from wallet->txAmounts if tx is signed and its entry is still current
+// wallet->lock must be held
+static BRWalletTxAmounts _BRWalletTxAmounts(BRWallet *wallet, const BRTransaction *tx)
 {
-    uint64_t amount = 0;
-    
-    assert(wallet != NULL);
-    assert(tx != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    BRWalletTxAmounts *entry, amounts;
+    int isSigned = BRTransactionIsSigned(tx);
     
-    for (size_t i = 0; tx && i < tx->inCount && amount != UINT64_MAX; i++) {
-        BRTransaction *t = BRSetGet(wallet->allTx, &tx->inputs[i].txHash);
-        uint32_t n = tx->inputs[i].index;
+    if (isSigned) {
+        pthread_mutex_lock(&wallet->amountsLock);
+        entry = BRSetGet(wallet->txAmounts, &tx->txHash);
         
-        if (t && n < t->outCount) {
-            amount += t->outputs[n].amount;
+        if (entry && UInt256Eq(entry->wtxHash, tx->wtxHash) && entry->pkhGeneration == wallet->pkhGeneration &&
+            entry->txRemoveGeneration == wallet->txRemoveGeneration &&
+            (entry->inputsKnown || entry->txAddGeneration == wallet->txAddGeneration)) {
+            amounts = *entry;
+            pthread_mutex_unlock(&wallet->amountsLock);
+            return amounts;
         }
-        else amount = UINT64_MAX;
+        
+        pthread_mutex_unlock(&wallet->amountsLock);
     }
     
-    pthread_mutex_unlock(&wallet->lock);
+    _BRWalletComputeTxAmounts(wallet, tx, &amounts);
     
-    for (size_t i = 0; tx && i < tx->outCount && amount != UINT64_MAX; i++) {
-        amount -= tx->outputs[i].amount;
+    if (isSigned) {
+        amounts.txHash = tx->txHash;
+        amounts.wtxHash = tx->wtxHash;
+        amounts.pkhGeneration = wallet->pkhGeneration;
+        amounts.txAddGeneration = wallet->txAddGeneration;
+        amounts.txRemoveGeneration = wallet->txRemoveGeneration;
+        pthread_mutex_lock(&wallet->amountsLock);
+        entry = BRSetGet(wallet->txAmounts, &tx->txHash);
+        
+        // start over rather than let entries for transactions that aren't in the wallet accumulate
+        if (! entry && BRSetCount(wallet->txAmounts) >= BRSetCount(wallet->allTx)*2 + 100) {
+            BRSetApply(wallet->txAmounts, NULL, _setApplyFree);
+            BRSetClear(wallet->txAmounts);
+        }
+        
+        if (! entry) entry = malloc(sizeof(*entry)), assert(entry != NULL), BRSetAdd(wallet->txAmounts, entry);
+        *entry = amounts;
+        pthread_mutex_unlock(&wallet->amountsLock);
     }
     
+    return amounts;
+}
+
+// returns the amount received by the wallet from the transaction (total outputs to change and/or receive addresses)
+uint64_t BRWalletAmountReceivedFromTx(BRWallet *wallet, const BRTransaction *tx)
+{
+    uint64_t amount;
+    
+    assert(wallet != NULL);
+    assert(tx != NULL);
+    pthread_rwlock_rdlock(&wallet->lock);
+    amount = (tx) ? _BRWalletTxAmounts(wallet, tx).received : 0;
+    pthread_rwlock_unlock(&wallet->lock);
+    return amount;
+}
+
+// returns the amount sent from the wallet by the trasaction (total wallet outputs consumed, change and fee included)
+uint64_t BRWalletAmountSentByTx(BRWallet *wallet, const BRTransaction *tx)
+{
+    uint64_t amount;
+    
+    assert(wallet != NULL);
+    assert(tx != NULL);
+    pthread_rwlock_rdlock(&wallet->lock);
+    amount = (tx) ? _BRWalletTxAmounts(wallet, tx).sent : 0;
+    pthread_rwlock_unlock(&wallet->lock);
+    return amount;
+}
+
+// returns the fee for the given transaction if all its inputs are from wallet transactions, UINT64_MAX otherwise
+uint64_t BRWalletFeeForTx(BRWallet *wallet, const BRTransaction *tx)
+{
+    uint64_t amount;
+    
+    assert(wallet != NULL);
+    assert(tx != NULL);
+    pthread_rwlock_rdlock(&wallet->lock);
+    amount = (tx) ? _BRWalletTxAmounts(wallet, tx).fee : 0;
+    pthread_rwlock_unlock(&wallet->lock);
     return amount;
 }
 
@@ -1148,7 +1727,7 @@ uint64_t BRWalletBalanceAfterTx(BRWallet *wallet, const BRTransaction *tx)
     
     assert(wallet != NULL);
     assert(tx != NULL && BRTransactionIsSigned(tx));
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     balance = wallet->balance;
     
     for (size_t i = array_count(wallet->transactions); tx && i > 0; i--) {
@@ -1157,7 +1736,7 @@ uint64_t BRWalletBalanceAfterTx(BRWallet *wallet, const BRTransaction *tx)
         break;
     }
 
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     return balance;
 }
 
@@ -1167,9 +1746,7 @@ uint64_t BRWalletFeeForTxSize(BRWallet *wallet, size_t size)
     uint64_t fee;
     
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
-    fee = _txFee(wallet->feePerKb, size);
-    pthread_mutex_unlock(&wallet->lock);
+    fee = _txFee(atomic_load_explicit(&wallet->publishedFeePerKb, memory_order_relaxed), size);
     return fee;
 }
 
@@ -1218,10 +1795,8 @@ uint64_t BRWalletMinOutputAmountWithFeePerKb(BRWallet *wallet, uint64_t feePerKb
     uint64_t amount;
     
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
-    feePerKb = UINT64_MAX == feePerKb ? wallet->feePerKb : feePerKb;
+    if (UINT64_MAX == feePerKb) feePerKb = atomic_load_explicit(&wallet->publishedFeePerKb, memory_order_relaxed);
     amount = (TX_MIN_OUTPUT_AMOUNT*feePerKb + MIN_FEE_PER_KB - 1)/MIN_FEE_PER_KB;
-    pthread_mutex_unlock(&wallet->lock);
     return (amount > TX_MIN_OUTPUT_AMOUNT) ? amount : TX_MIN_OUTPUT_AMOUNT;
 }
 
@@ -1241,11 +1816,12 @@ uint64_t BRWalletMaxOutputAmountWithFeePerKb(BRWallet *wallet, uint64_t feePerKb
     size_t i, txSize, cpfpSize = 0, inCount = 0;
 
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_rdlock(&wallet->lock);
     feePerKb = UINT64_MAX == feePerKb ? wallet->feePerKb : feePerKb;
 
     for (i = array_count(wallet->utxos); i > 0; i--) {
         o = &wallet->utxos[i - 1];
+        if (UInt256IsZero(o->hash)) continue; // spent
         tx = BRSetGet(wallet->allTx, &o->hash);
         if (! tx || o->n >= tx->outCount) continue;
         inCount++;
@@ -1259,7 +1835,7 @@ uint64_t BRWalletMaxOutputAmountWithFeePerKb(BRWallet *wallet, uint64_t feePerKb
 
     txSize = 8 + BRVarIntSize(inCount) + TX_INPUT_SIZE*inCount + BRVarIntSize(2) + TX_OUTPUT_SIZE*2;
     fee = _txFee(feePerKb, txSize + cpfpSize);
-    pthread_mutex_unlock(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
     
     return (amount > fee) ? amount - fee : 0;
 }
@@ -1273,7 +1849,7 @@ static void _setApplyFreeTx(void *info, void *tx)
 void BRWalletFree(BRWallet *wallet)
 {
     assert(wallet != NULL);
-    pthread_mutex_lock(&wallet->lock);
+    pthread_rwlock_wrlock(&wallet->lock);
     BRSetFree(wallet->allPKH);
     BRSetFree(wallet->usedPKH);
     BRSetFree(wallet->invalidTx);
@@ -1281,13 +1857,23 @@ void BRWalletFree(BRWallet *wallet)
     BRSetApply(wallet->allTx, NULL, _setApplyFreeTx);
     BRSetFree(wallet->allTx);
     BRSetFree(wallet->spentOutputs);
+    BRSetFree(wallet->utxoIndex);
+    BRSetFree(wallet->unknownPKH);
+    BRSetApply(wallet->txAmounts, NULL, _setApplyFree);
+    BRSetFree(wallet->txAmounts);
+    array_free(wallet->deferredSpends);
+    array_free(wallet->undo);
+    array_free(wallet->undoOps);
+    array_free(wallet->undoSpent);
+    array_free(wallet->undoDeferred);
     array_free(wallet->internalChain);
     array_free(wallet->externalChain);
     array_free(wallet->balanceHist);
     array_free(wallet->transactions);
     array_free(wallet->utxos);
-    pthread_mutex_unlock(&wallet->lock);
-    pthread_mutex_destroy(&wallet->lock);
+    pthread_rwlock_unlock(&wallet->lock);
+    pthread_rwlock_destroy(&wallet->lock);
+    pthread_mutex_destroy(&wallet->amountsLock);
     free(wallet);
 }
 
@@ -135,6 +135,13 @@ size_t BRWalletUTXOs(BRWallet *wallet, BRUTXO utxos[], size_t utxosCount);
 uint64_t BRWalletFeePerKb(BRWallet *wallet);
 void BRWalletSetFeePerKb(BRWallet *wallet, uint64_t feePerKb);
 
+typedef enum {
+    BRCoinSelectionFirstFit,       // spend outputs in wallet order until the amount and fee are covered
+    BRCoinSelectionBranchAndBound, // search for inputs that need no change output, falling back to largest-first
+    BRCoinSelectionLargestFirst,   // spend outputs with the largest effective value first, for the fewest inputs
+    BRCoinSelectionConsolidate     // spend every output worth more than its fee, smallest first, up to TX_MAX_SIZE
+} BRCoinSelectionStrategy;
+
 // returns an unsigned transaction that sends the specified amount from the wallet to the given address
 // result must be freed using BRTransactionFree()
 BRTransaction *BRWalletCreateTransaction(BRWallet *wallet, uint64_t amount, const char *addr);
@@ -153,12 +160,27 @@ BRTransaction *BRWalletCreateTxForOutputs(BRWallet *wallet, const BRTxOutput out
 // use feePerKb UINT64_MAX to indicate that the wallet feePerKb should be used
 BRTransaction *BRWalletCreateTxForOutputsWithFeePerKb(BRWallet *wallet, uint64_t feePerKb, const BRTxOutput outputs[], size_t outCount);
 
+// returns an unsigned transaction that satisifes the given transaction outputs, with inputs chosen using strategy
+// timeout is the time budget in seconds for the branch-and-bound search, 0 for no limit besides the maximum tries
+// result must be freed using BRTransactionFree()
+// use feePerKb UINT64_MAX to indicate that the wallet feePerKb should be used
+BRTransaction *BRWalletCreateTxForOutputsWithStrategy(BRWallet *wallet, uint64_t feePerKb, const BRTxOutput outputs[],
+                                                     size_t outCount, BRCoinSelectionStrategy strategy, double timeout);
+
 // signs any inputs in tx that can be signed using private keys from the wallet
 // forkId is 0 for bitcoin, 0x40 for b-cash
 // seed is the master private key (wallet seed) corresponding to the master public key given when the wallet was created
 // returns true if all inputs were signed, or false if there was an error or not all inputs were able to be signed
 int BRWalletSignTransaction(BRWallet *wallet, BRTransaction *tx, uint8_t forkId, const void *seed, size_t seedLen);
 
+// signs any inputs in tx that can be signed using private keys from the wallet, deriving keys and signing on up to
+// threadCount threads (including the calling thread), with the same result as BRWalletSignTransaction()
+// forkId is 0 for bitcoin, 0x40 for b-cash
+// seed is the master private key (wallet seed) corresponding to the master public key given when the wallet was created
+// returns true if all inputs were signed, or false if there was an error or not all inputs were able to be signed
+int BRWalletSignTransactionParallel(BRWallet *wallet, BRTransaction *tx, uint8_t forkId, const void *seed,
+                                    size_t seedLen, size_t threadCount);
+
 // true if the given transaction is associated with the wallet (even if it hasn't been registered)
 int BRWalletContainsTransaction(BRWallet *wallet, const BRTransaction *tx);
 
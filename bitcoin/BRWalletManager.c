@@ -30,6 +30,12 @@
 #define BWM_SLEEP_SECONDS                        (1)
 #define BWM_SYNC_AFTER_WAKEUPS                   (60)
 
+// bytes of blocks, transactions and peers queued for writing before saves block
+#define BWM_FILE_SERVICE_QUEUE_LIMIT             (4 * 1024 * 1024)
+
+// block headers are kept in '<basePath>/<currency>-<network>-headers', beside the file service's SQLite database
+#define BWM_HEADER_STORE_FILENAME                "headers"
+
 // default to TRUE in case client's don't bother updating this value
 #define DEFAULT_NETWORK_IS_REACHABLE             (1)
 
@@ -450,6 +456,11 @@ BRWalletSweeperValidate (BRWalletSweeper sweeper) {
  */
 
 struct BRTransactionWithStateStruct {
+    // The owned transaction's hash and block height as of when it was last indexed.  The hash
+    // comes first so that a UInt256 can be used to look up a BRTransactionWithState by hash.
+    UInt256 txHash;
+    uint32_t blockHeight;
+
     uint8_t isDeleted;
     BRTransaction *refedTransaction;
     BRTransaction *ownedTransaction;
@@ -493,15 +504,164 @@ static void BRTransactionWithStateFree(BRTransactionWithState txn) {
     free (txn);
 }
 
+static size_t BRTransactionWithStateHashValue (const void *txnWithState) {
+    return (size_t) ((const UInt256 *) txnWithState)->u32[0];
+}
+
+static int BRTransactionWithStateHashEq (const void *txnWithState1, const void *txnWithState2) {
+    return (txnWithState1 == txnWithState2 ||
+            UInt256Eq (*(const UInt256 *) txnWithState1, *(const UInt256 *) txnWithState2));
+}
+
+static size_t BRTransactionWithStateOwnedValue (const void *txnWithState) {
+    return (size_t) ((const struct BRTransactionWithStateStruct *) txnWithState)->ownedTransaction;
+}
+
+static int BRTransactionWithStateOwnedEq (const void *txnWithState1, const void *txnWithState2) {
+    return (((const struct BRTransactionWithStateStruct *) txnWithState1)->ownedTransaction ==
+            ((const struct BRTransactionWithStateStruct *) txnWithState2)->ownedTransaction);
+}
+
+/**
+ * Create the (empty) indexes over `manager->transactions`, sized for `capacity` transactions.
+ */
+static void
+BRWalletManagerCreateTransactionIndexes (BRWalletManager manager,
+                                         size_t capacity) {
+    manager->transactionsByHash  = BRSetNew (BRTransactionWithStateHashValue, BRTransactionWithStateHashEq, capacity);
+    manager->transactionsByOwned = BRSetNew (BRTransactionWithStateOwnedValue, BRTransactionWithStateOwnedEq, capacity);
+    array_new (manager->confirmedTransactions, capacity);
+}
+
+/**
+ * Find the position in `manager->confirmedTransactions` of the first transaction with a block
+ * height at or above `blockHeight`.
+ */
+static size_t
+BRWalletManagerConfirmedLowerBound (BRWalletManager manager,
+                                    uint64_t blockHeight) {
+    size_t lo = 0, hi = array_count (manager->confirmedTransactions);
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (manager->confirmedTransactions[mid]->blockHeight < blockHeight) lo = mid + 1;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+/**
+ * Add the tracked transaction to the indexes, keyed on its owned transaction's current hash and
+ * block height. Deleted transactions are not indexed. Must be called with `manager->lock` held,
+ * and again (after `BRWalletManagerUnindexTransaction`) whenever the hash or block height changes.
+ */
+static void
+BRWalletManagerIndexTransaction (BRWalletManager manager,
+                                 BRTransactionWithState txnWithState) {
+    if (txnWithState->isDeleted) return;
+
+    txnWithState->txHash = txnWithState->ownedTransaction->txHash;
+    txnWithState->blockHeight = txnWithState->ownedTransaction->blockHeight;
+    BRSetAdd (manager->transactionsByOwned, txnWithState);
+
+    // unsigned transactions have no hash yet; of any duplicates, only one is indexed at a time
+    if (!UInt256IsZero (txnWithState->txHash) &&
+        !BRSetContains (manager->transactionsByHash, txnWithState)) {
+        BRSetAdd (manager->transactionsByHash, txnWithState);
+    }
+
+    // confirmations almost always arrive in block order, making this an append
+    if (TX_UNCONFIRMED != txnWithState->blockHeight &&
+        BRTransactionIsSigned (txnWithState->ownedTransaction)) {
+        size_t index = BRWalletManagerConfirmedLowerBound (manager, (uint64_t) txnWithState->blockHeight + 1);
+        array_insert (manager->confirmedTransactions, index, txnWithState);
+    }
+}
+
+/**
+ * Remove the tracked transaction from the indexes, using the hash and block height it was
+ * indexed with. Must be called with `manager->lock` held.
+ */
+static void
+BRWalletManagerUnindexTransaction (BRWalletManager manager,
+                                   BRTransactionWithState txnWithState) {
+    if (txnWithState == BRSetGet (manager->transactionsByOwned, txnWithState)) {
+        BRSetRemove (manager->transactionsByOwned, txnWithState);
+    }
+
+    if (txnWithState == BRSetGet (manager->transactionsByHash, txnWithState)) {
+        BRSetRemove (manager->transactionsByHash, txnWithState);
+
+        // index the next tracked duplicate, if any; this is rare, so a linear scan is fine
+        for (size_t index = 0; index < array_count (manager->transactions); index++) {
+            BRTransactionWithState other = manager->transactions[index];
+            if (other != txnWithState && !other->isDeleted && UInt256Eq (other->txHash, txnWithState->txHash)) {
+                BRSetAdd (manager->transactionsByHash, other);
+                break;
+            }
+        }
+    }
+
+    for (size_t index = BRWalletManagerConfirmedLowerBound (manager, txnWithState->blockHeight);
+         index < array_count (manager->confirmedTransactions) &&
+         manager->confirmedTransactions[index]->blockHeight == txnWithState->blockHeight;
+         index++) {
+        if (manager->confirmedTransactions[index] == txnWithState) {
+            array_rm (manager->confirmedTransactions, index);
+            break;
+        }
+    }
+}
+
 static BRTransactionWithState
 BRWalletManagerAddTransaction(BRWalletManager manager,
                               BRTransaction *ownedTransaction,
                               BRTransaction *refedTransaction) {
     BRTransactionWithState txnWithState = BRTransactionWithStateNew (ownedTransaction, refedTransaction);
     array_add (manager->transactions, txnWithState);
+    BRWalletManagerIndexTransaction (manager, txnWithState);
     return txnWithState;
 }
 
+/**
+ * Set the block height and timestamp of the tracked transaction, keeping the indexes current.
+ */
+static void
+BRWalletManagerSetTransactionBlock (BRWalletManager manager,
+                                    BRTransactionWithState txnWithState,
+                                    uint32_t height,
+                                    uint32_t timestamp) {
+    BRWalletManagerUnindexTransaction (manager, txnWithState);
+    BRTransactionWithStateSetBlock (txnWithState, height, timestamp);
+    BRWalletManagerIndexTransaction (manager, txnWithState);
+}
+
+/**
+ * Mark the tracked transaction as deleted, removing it from the indexes.
+ */
+static void
+BRWalletManagerDeleteTransaction (BRWalletManager manager,
+                                  BRTransactionWithState txnWithState) {
+    BRWalletManagerUnindexTransaction (manager, txnWithState);
+    BRTransactionWithStateSetDeleted (txnWithState);
+}
+
+/**
+ * Re-index the tracked transaction after its owned transaction has been signed, which sets
+ * its hash.
+ */
+static void
+BRWalletManagerUpdateTransactionSigned (BRWalletManager manager,
+                                        BRTransactionWithState txnWithState) {
+    pthread_mutex_lock (&manager->lock);
+    if (!txnWithState->isDeleted) {
+        BRWalletManagerUnindexTransaction (manager, txnWithState);
+        BRWalletManagerIndexTransaction (manager, txnWithState);
+    }
+    pthread_mutex_unlock (&manager->lock);
+}
+
 /**
  * Find the tracked transaction using the `owned` transaction pointer. Deleted transactions
  * are not checked (i.e. they are skipped).
@@ -509,17 +669,9 @@ BRWalletManagerAddTransaction(BRWalletManager manager,
 static BRTransactionWithState
 BRWalletManagerFindTransactionByOwned (BRWalletManager manager,
                                        BRTransaction *transaction) {
-    BRTransactionWithState txnWithState = NULL;
+    struct BRTransactionWithStateStruct key = { .ownedTransaction = transaction };
 
-    for (size_t index = 0; index < array_count(manager->transactions); index++) {
-        if (!manager->transactions[index]->isDeleted &&
-            manager->transactions[index]->ownedTransaction == transaction) {
-            txnWithState = manager->transactions[index];
-            break;
-        }
-    }
-
-    return txnWithState;
+    return BRSetGet (manager->transactionsByOwned, &key);
 }
 
 /**
@@ -533,23 +685,20 @@ BRWalletManagerFindTransactionWithLastConfirmedSend(BRWalletManager manager,
     BRTransactionWithState txnWithState = NULL;
 
     if (lastBlockHeight >= confirmationsUntilFinal) {
-        for (size_t index = 0; index < array_count (manager->transactions); index++) {
+        // Walk down from the highest confirmed transaction below the cutoff height; whether a
+        // transaction is valid and is a send depends on the rest of the wallet, so those are
+        // checked here rather than when indexing.
+        for (size_t index = BRWalletManagerConfirmedLowerBound (manager, lastBlockHeight - confirmationsUntilFinal);
+             NULL == txnWithState && index > 0;
+             index--) {
             // ensure:
-            // - tx is not deleted
             // - tx is valid (i.e. no previous transaction spend any of utxos, and no inputs are invalid)
             // - AND the transaction was a SEND
-            // - AND the transaction has been confirmed
-            if (!manager->transactions[index]->isDeleted &&
-                BRTransactionIsSigned (manager->transactions[index]->ownedTransaction) &&
-                BRWalletTransactionIsValid (manager->wallet, manager->transactions[index]->ownedTransaction) &&
-                0 != BRWalletAmountSentByTx (manager->wallet, manager->transactions[index]->ownedTransaction) &&
-                TX_UNCONFIRMED != manager->transactions[index]->ownedTransaction->blockHeight &&
-                manager->transactions[index]->ownedTransaction->blockHeight < (lastBlockHeight - confirmationsUntilFinal)) {
-
-                if (NULL == txnWithState ||
-                    txnWithState->ownedTransaction->blockHeight < manager->transactions[index]->ownedTransaction->blockHeight) {
-                    txnWithState =  manager->transactions[index];
-                }
+            BRTransaction *transaction = manager->confirmedTransactions[index - 1]->ownedTransaction;
+
+            if (BRWalletTransactionIsValid (manager->wallet, transaction) &&
+                0 != BRWalletAmountSentByTx (manager->wallet, transaction)) {
+                txnWithState = manager->confirmedTransactions[index - 1];
             }
         }
     }
@@ -564,17 +713,7 @@ BRWalletManagerFindTransactionWithLastConfirmedSend(BRWalletManager manager,
 static BRTransactionWithState
 BRWalletManagerFindTransactionByHash (BRWalletManager manager,
                                       UInt256 hash) {
-    BRTransactionWithState txnWithState = NULL;
-
-    for (size_t index = 0; index < array_count(manager->transactions); index++) {
-        if (!manager->transactions[index]->isDeleted &&
-            UInt256Eq (manager->transactions[index]->ownedTransaction->txHash, hash)) {
-            txnWithState = manager->transactions[index];
-            break;
-        }
-    }
-
-    return txnWithState;
+    return UInt256IsZero (hash) ? NULL : BRSetGet (manager->transactionsByHash, &hash);
 }
 
 static void
@@ -583,6 +722,10 @@ BRWalletManagerFreeTransactions(BRWalletManager manager) {
         BRTransactionWithStateFree (manager->transactions[index]);
     }
     array_free(manager->transactions);
+
+    if (NULL != manager->transactionsByHash) BRSetFree (manager->transactionsByHash);
+    if (NULL != manager->transactionsByOwned) BRSetFree (manager->transactionsByOwned);
+    if (NULL != manager->confirmedTransactions) array_free (manager->confirmedTransactions);
 }
 
 /// MARK: - Transaction File Service
@@ -652,23 +795,24 @@ fileServiceTypeTransactionV1Reader (BRFileServiceContext context,
 
 static BRArrayOf(BRTransaction*)
 initialTransactionsLoad (BRWalletManager manager) {
-    BRSetOf(BRTransaction*) transactionSet = BRSetNew(BRTransactionHash, BRTransactionEq, 100);
-    if (1 != fileServiceLoad (manager->fileService, transactionSet, fileServiceTypeTransactions, 1)) {
-        BRSetFreeAll(transactionSet, (void (*) (void*)) BRTransactionFree);
+    BRArrayOf(BRTransaction*) transactions;
+    array_new (transactions, 100);
+
+    // Stream the transactions; there is no need to accumulate them into a set first.
+    BRFileServiceCursor cursor = fileServiceCursorCreate (manager->fileService, fileServiceTypeTransactions);
+    if (NULL != cursor) {
+        BRTransaction *transaction;
+        while (NULL != (transaction = fileServiceCursorNext (cursor)))
+            array_add (transactions, transaction);
+    }
+
+    if (NULL == cursor || 1 != fileServiceCursorRelease (cursor)) {
+        array_free_all (transactions, BRTransactionFree);
         _peer_log ("BWM: failed to load transactions");
         return NULL;
     }
 
-    size_t transactionsCount = BRSetCount(transactionSet);
-
-    BRArrayOf(BRTransaction*) transactions;
-    array_new (transactions, transactionsCount);
-    array_set_count(transactions, transactionsCount);
-
-    BRSetAll(transactionSet, (void**) transactions, transactionsCount);
-    BRSetFree(transactionSet);
-
-    _peer_log ("BWM: loaded %zu transactions", transactionsCount);
+    _peer_log ("BWM: loaded %zu transactions", array_count (transactions));
     return transactions;
 }
 
@@ -735,25 +879,45 @@ fileServiceTypeBlockV1Reader (BRFileServiceContext context,
     return block;
 }
 
+static uint64_t
+fileServiceTypeBlockKey (BRFileServiceContext context,
+                         BRFileService fs,
+                         const void *entity) {
+    const BRMerkleBlock *block = entity;
+    return block->height;
+}
+
 static BRArrayOf(BRMerkleBlock*)
 initialBlocksLoad (BRWalletManager manager) {
-    BRSetOf(BRMerkleBlock*) blockSet = BRSetNew(BRMerkleBlockHash, BRMerkleBlockEq, 100);
-    if (1 != fileServiceLoad (manager->fileService, blockSet, fileServiceTypeBlocks, 1)) {
-        BRSetFreeAll(blockSet, (void (*) (void*)) BRMerkleBlockFree);
+    BRArrayOf(BRMerkleBlock*) blocks;
+    array_new (blocks, 100);
+
+    // The peer manager starts from the checkpoint preceding `earliestKeyTime` by a week, or from
+    // the last saved difficulty transition block after that.  Saved blocks below that checkpoint
+    // are never used; skip them.
+    const BRCheckPoint *checkpoint = (manager->earliestKeyTime > 7*24*60*60
+                                      ? BRChainParamsGetCheckpointBefore (manager->chainParams,
+                                                                          manager->earliestKeyTime - 7*24*60*60)
+                                      : NULL);
+    uint32_t minimumHeight = (NULL == checkpoint ? 0 : checkpoint->height);
+
+    BRFileServiceCursor cursor = fileServiceCursorCreateFromKey (manager->fileService, fileServiceTypeBlocks, minimumHeight);
+    if (NULL != cursor) {
+        BRMerkleBlock *block;
+        while (NULL != (block = fileServiceCursorNext (cursor))) {
+            // Blocks saved without a key are not skipped by the cursor.
+            if (block->height < minimumHeight) BRMerkleBlockFree (block);
+            else array_add (blocks, block);
+        }
+    }
+
+    if (NULL == cursor || 1 != fileServiceCursorRelease (cursor)) {
+        array_free_all (blocks, BRMerkleBlockFree);
         _peer_log ("BWM: failed to load blocks");
         return NULL;
     }
 
-    size_t blocksCount = BRSetCount(blockSet);
-
-    BRArrayOf(BRMerkleBlock*) blocks;
-    array_new (blocks, blocksCount);
-    array_set_count(blocks, blocksCount);
-
-    BRSetAll(blockSet, (void**) blocks, blocksCount);
-    BRSetFree(blockSet);
-
-    _peer_log ("BWM: loaded %zu blocks", blocksCount);
+    _peer_log ("BWM: loaded %zu blocks", array_count (blocks));
     return blocks;
 }
 
@@ -933,6 +1097,32 @@ static_on_release BRFileServiceTypeSpecification fileServiceSpecifications[] = {
 };
 static_on_release size_t fileServiceSpecificationsCount = (sizeof (fileServiceSpecifications) / sizeof (BRFileServiceTypeSpecification));
 
+/// MARK: - Header Store
+
+static char *
+bwmHeaderStorePath (const char *basePath,
+                    const char *currency,
+                    const char *network) {
+    size_t pathLength = strlen (basePath) + 1 + strlen (currency) + 1 + strlen (network) + 1 + strlen (BWM_HEADER_STORE_FILENAME) + 1;
+    char  *path       = malloc (pathLength);
+    sprintf (path, "%s/%s-%s-%s", basePath, currency, network, BWM_HEADER_STORE_FILENAME);
+    return path;
+}
+
+static BRHeaderStore *
+bwmHeaderStoreOpen (const char *basePath,
+                    const char *currency,
+                    const char *network) {
+    char *path = bwmHeaderStorePath (basePath, currency, network);
+    BRHeaderStore *store = BRHeaderStoreOpen (path);
+
+    // An unreadable store only costs memory; the peer manager works without one.
+    if (NULL == store) _peer_log ("BWM: header store unavailable at %s", path);
+
+    free (path);
+    return store;
+}
+
 
 
 /// MARK: - Wallet Manager
@@ -958,6 +1148,10 @@ bwmCreateErrorHandler (BRWalletManager bwm, int fileService, const char* reason)
             BRSyncManagerFree (bwm->syncManager);
         }
 
+        if (NULL != bwm->headerStore) {
+            BRHeaderStoreClose (bwm->headerStore);
+        }
+
         if (NULL != bwm->transactions) {
             BRWalletManagerFreeTransactions (bwm);
         }
@@ -984,7 +1178,8 @@ BRWalletManagerNew (BRWalletManagerClient client,
                     const char *baseStoragePath,
                     uint64_t blockHeight,
                     uint64_t confirmationsUntilFinal) {
-    assert (mode == CRYPTO_SYNC_MODE_API_ONLY || CRYPTO_SYNC_MODE_P2P_ONLY);
+    assert (mode == CRYPTO_SYNC_MODE_API_ONLY || mode == CRYPTO_SYNC_MODE_P2P_ONLY ||
+            mode == CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS);
 
     BRWalletManager bwm = calloc (1, sizeof (struct BRWalletManagerStruct));
     if (NULL == bwm) {
@@ -1036,6 +1231,16 @@ BRWalletManagerNew (BRWalletManagerClient client,
         return bwmCreateErrorHandler (bwm, 1, "create");
     }
 
+    // Key blocks by height so that loading can skip those before the starting checkpoint.
+    fileServiceDefineKey (bwm->fileService, fileServiceTypeBlocks, bwm, fileServiceTypeBlockKey);
+
+    // Keep SQLite writes off the peer manager threads; if this fails we write synchronously.
+    fileServiceEnableWriteBehind (bwm->fileService, BWM_FILE_SERVICE_QUEUE_LIMIT);
+
+    // Open the header store; the P2P sync manager pages pruned blocks back in from it.  Without
+    // one, the peer manager keeps every difficulty transition block in memory instead.
+    bwm->headerStore = bwmHeaderStoreOpen (baseStoragePath, currencyName, networkName);
+
     /// Load transactions for the wallet manager.
     BRArrayOf(BRTransaction*) transactions = initialTransactionsLoad(bwm);
     /// Load blocks and peers for the peer manager.
@@ -1057,6 +1262,7 @@ BRWalletManagerNew (BRWalletManagerClient client,
 
     // Create the transaction array with enough initial capacity to hold all the loaded transactions
     array_new(bwm->transactions, array_count(transactions));
+    BRWalletManagerCreateTransactionIndexes (bwm, array_count(transactions));
 
     // Create the Wallet being managed and populate with the loaded transactions
     _peer_log ("BWM: initializing wallet with %zu transactions", array_count(transactions));
@@ -1094,6 +1300,7 @@ BRWalletManagerNew (BRWalletManagerClient client,
                                                 DEFAULT_NETWORK_IS_REACHABLE,
                                                 blocks, array_count(blocks),
                                                 peers,  array_count(peers));
+    if (NULL != bwm->headerStore) BRSyncManagerSetHeaderStore (bwm->syncManager, bwm->headerStore);
 
     // No longer need the loaded txns/blocks/peers
     array_free(transactions); array_free(blocks); array_free(peers);
@@ -1180,6 +1387,7 @@ BRWalletManagerFree (BRWalletManager manager) {
         BRWalletManagerStop (manager);
 
         BRSyncManagerFree (manager->syncManager);
+        if (NULL != manager->headerStore) BRHeaderStoreClose (manager->headerStore);
         BRWalletFree (manager->wallet);
 
         BRWalletManagerFreeTransactions (manager);
@@ -1244,6 +1452,10 @@ BRWalletManagerWipe (const BRChainParams *params,
     const char *networkName  = getNetworkName  (params);
     const char *currencyName = getCurrencyName (params);
     fileServiceWipe (baseStoragePath, currencyName, networkName);
+
+    char *headerStorePath = bwmHeaderStorePath (baseStoragePath, currencyName, networkName);
+    remove (headerStorePath);
+    free (headerStorePath);
 }
 
 extern void
@@ -1327,6 +1539,7 @@ BRWalletManagerSetMode (BRWalletManager manager, BRCryptoSyncMode mode) {
                                                         isNetworkReachable,
                                                         blocks, array_count (blocks),
                                                         peers, array_count (peers));
+        if (NULL != manager->headerStore) BRSyncManagerSetHeaderStore (manager->syncManager, manager->headerStore);
 
         // No longer need the loaded blocks/peers
         array_free(blocks); array_free(peers);
@@ -1450,6 +1663,7 @@ BRWalletManagerSignTransaction (BRWalletManager manager,
                                       seed,
                                       seedLen)) {
         success = 1;
+        BRWalletManagerUpdateTransactionSigned (manager, txnWithState);
         bwmSignalTransactionEvent(manager,
                                   wallet,
                                   BRTransactionWithStateGetOwned (txnWithState),
@@ -1479,6 +1693,7 @@ BRWalletManagerSignTransactionForKey (BRWalletManager manager,
                                 key,
                                 1)) {
         success = 1;
+        BRWalletManagerUpdateTransactionSigned (manager, txnWithState);
         bwmSignalTransactionEvent(manager,
                                   wallet,
                                   BRTransactionWithStateGetOwned (txnWithState),
@@ -1645,18 +1860,24 @@ _BRWalletManagerTxUpdated (void *info,
                            uint32_t timestamp) {
     BRWalletManager manager = (BRWalletManager) info;
 
+    // a block's worth of transactions is updated at once; the writer saves them together
+    fileServiceBeginBatch (manager->fileService);
+
     for (size_t index = 0; index < count; index++) {
         BRTransaction *transaction = BRWalletTransactionCopyForHash(manager->wallet, hashes[index]);
         if (NULL != transaction) {
             // assert timestamp and blockHeight in transaction
-            // filesystem changes are NOT queued; they are acted upon immediately
             fileServiceSave (manager->fileService, fileServiceTypeTransactions, transaction);
-
-            bwmSignalTxUpdated (manager, hashes[index], blockHeight, timestamp);
-
             BRTransactionFree (transaction);
         }
     }
+
+    fileServiceCommitBatch (manager->fileService);
+
+    for (size_t index = 0; index < count; index++) {
+        if (NULL != BRWalletTransactionForHash (manager->wallet, hashes[index]))
+            bwmSignalTxUpdated (manager, hashes[index], blockHeight, timestamp);
+    }
 }
 
 static void
@@ -1691,7 +1912,7 @@ bwmHandleTxAdded (BRWalletManager manager,
     } else {
         // this is a transaction we've submitted; set the reference transaction from the wallet
         BRTransactionWithStateSetReferenced (txnWithState, refedTransaction);
-        BRTransactionWithStateSetBlock (txnWithState, ownedTransaction->blockHeight, ownedTransaction->timestamp);
+        BRWalletManagerSetTransactionBlock (manager, txnWithState, ownedTransaction->blockHeight, ownedTransaction->timestamp);
 
         // we already have an owned copy of this transaction; free up the passed one
         BRTransactionFree (ownedTransaction);
@@ -1726,7 +1947,7 @@ bwmHandleTxUpdated (BRWalletManager manager,
     BRTransactionWithState txnWithState = BRWalletManagerFindTransactionByHash (manager, hash);
     assert (NULL != txnWithState && BRTransactionIsSigned (BRTransactionWithStateGetOwned (txnWithState)));
 
-    BRTransactionWithStateSetBlock (txnWithState, blockHeight, timestamp);
+    BRWalletManagerSetTransactionBlock (manager, txnWithState, blockHeight, timestamp);
     pthread_mutex_unlock (&manager->lock);
 
     bwmSignalTransactionEvent(manager,
@@ -1746,7 +1967,7 @@ bwmHandleTxDeleted (BRWalletManager manager,
     BRTransactionWithState txnWithState = BRWalletManagerFindTransactionByHash (manager, hash);
     assert (NULL != txnWithState && BRTransactionIsSigned (BRTransactionWithStateGetOwned (txnWithState)));
 
-    BRTransactionWithStateSetDeleted (txnWithState);
+    BRWalletManagerDeleteTransaction (manager, txnWithState);
     pthread_mutex_unlock (&manager->lock);
 
     bwmSignalTransactionEvent(manager,
@@ -1809,9 +2030,10 @@ _BRWalletManagerSyncEvent(void * context,
             break;
         }
         case SYNC_MANAGER_ADD_BLOCKS: {
-            // filesystem changes are NOT queued; they are acted upon immediately
-            for (size_t index = 0; index < event.u.blocks.count; index++)
-                fileServiceSave (bwm->fileService, fileServiceTypeBlocks, event.u.blocks.blocks[index]);
+            // filesystem changes are queued; the writer saves the blocks together
+            fileServiceSaveMany (bwm->fileService, fileServiceTypeBlocks,
+                                 (const void **) event.u.blocks.blocks,
+                                 event.u.blocks.count);
             break;
         }
         case SYNC_MANAGER_SET_PEERS: {
@@ -1837,9 +2059,11 @@ _BRWalletManagerSyncEvent(void * context,
             break;
         }
         case SYNC_MANAGER_ADD_PEERS: {
-            // filesystem changes are NOT queued; they are acted upon immediately
+            // filesystem changes are queued; the writer saves the batch's peers together
+            fileServiceBeginBatch (bwm->fileService);
             for (size_t index = 0; index < event.u.peers.count; index++)
                 fileServiceSave (bwm->fileService, fileServiceTypePeers, &event.u.peers.peers[index]);
+            fileServiceCommitBatch (bwm->fileService);
             break;
         }
         case SYNC_MANAGER_CONNECTED: {
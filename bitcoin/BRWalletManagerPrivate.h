@@ -16,6 +16,7 @@
 #include "ethereum/event/BREvent.h"
 #include "support/BRBase.h"
 #include "support/BRArray.h"
+#include "support/BRSet.h"
 #include "support/BRFileService.h"
 
 #ifdef __cplusplus
@@ -42,6 +43,9 @@ struct BRWalletManagerStruct {
     /** The file service */
     BRFileService fileService;
 
+    /** The block header store, shared by successive P2P sync managers; NULL if it couldn't be opened */
+    BRHeaderStore *headerStore;
+
     /**
      * The chain parameters associated with the wallet
      */
@@ -72,6 +76,15 @@ struct BRWalletManagerStruct {
      * associated with the `wallet`.
      */
     BRArrayOf(BRTransactionWithState) transactions;
+
+    /*
+     * Indexes over the `transactions` that haven't been deleted: by owned transaction hash (signed
+     * transactions only), by owned transaction pointer, and the confirmed, signed transactions
+     * ordered by block height.
+     */
+    BRSet *transactionsByHash;
+    BRSet *transactionsByOwned;
+    BRArrayOf(BRTransactionWithState) confirmedTransactions;
 };
 
 /// Mark: - Wallet Callbacks
@@ -39,6 +39,8 @@
 
 #include "bitcoin/BRBloomFilter.h"
 #include "bitcoin/BRMerkleBlock.h"
+#include "bitcoin/BRHeaderStore.h"
+#include "bitcoin/BRBlockFilter.h"
 #include "bitcoin/BRWallet.h"
 #include "bitcoin/BRBIP38Key.h"
 #include "bitcoin/BRPeer.h"
@@ -54,7 +56,10 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <time.h>
+#include <sys/time.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
 
@@ -216,6 +221,38 @@ int BRSetTests()
 
     if (BRSetCount(s) != 0) r = 0, fprintf(stderr, "***FAILED*** %s: BRSetCount() test 2\n", __func__);
     
+    int present[1000] = { 0 }, count = 0, j;
+    void *t;
+    
+    for (i = 0; i < 100000; i++) { // random adds and removes, checking membership of every item along the way
+        j = BRRand(1000);
+        
+        if (BRRand(2)) {
+            if ((BRSetAdd(s, &x[j]) != NULL) != present[j])
+                r = 0, fprintf(stderr, "***FAILED*** %s: BRSetAdd() test %d\n", __func__, i);
+            if (! present[j]) count++;
+            present[j] = 1;
+        }
+        else {
+            if ((BRSetRemove(s, &x[j]) != NULL) != present[j])
+                r = 0, fprintf(stderr, "***FAILED*** %s: BRSetRemove() test %d\n", __func__, i);
+            if (present[j]) count--;
+            present[j] = 0;
+        }
+        
+        if (i % 1000 != 0) continue;
+        
+        for (j = 0; j < 1000; j++) {
+            if (BRSetContains(s, &x[j]) != present[j])
+                r = 0, fprintf(stderr, "***FAILED*** %s: BRSetContains() test %d\n", __func__, j);
+        }
+        
+        for (j = 0, t = BRSetIterate(s, NULL); t; t = BRSetIterate(s, t)) j++;
+        if (j != count || BRSetCount(s) != count)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRSetIterate() test %d\n", __func__, i);
+    }
+    
+    BRSetFree(s);
     return r;
 }
 
@@ -519,6 +556,46 @@ int BRHashTests()
                     "\x14\x7c\x4e\x72\xb9\x80\x77\x85\xaf\xee\x48\xbb", *(UInt256 *)md))
         r = 0, fprintf(stderr, "\n***FAILED*** %s: BRSHA256() test 6", __func__);
 
+    // a message exactly 56bytes long, where the length no longer fits in the padding block
+    s = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    BRSHA256(md, s, strlen(s));
+    if (! UInt256Eq(*(UInt256 *)"\x24\x8d\x6a\x61\xd2\x06\x38\xb8\xe5\xc0\x26\x93\x0c\x3e\x60\x39\xa3\x3c\xe4\x59"
+                    "\x64\xff\x21\x67\xf6\xec\xed\xd4\x19\xdb\x06\xc1", *(UInt256 *)md))
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRSHA256() test 7", __func__);
+
+    // test sha256 batches against single messages, with counts that don't fill every vector lane
+    
+    uint8_t batchData[19*203], batchMds[19*32], batchMd[32];
+    const size_t batchLens[] = { 0, 1, 32, 55, 56, 63, 64, 80, 119, 120, 200 };
+    
+    for (size_t i = 0; i < sizeof(batchData); i++) batchData[i] = (uint8_t)(i*131 + 7);
+    
+    for (size_t i = 0; i < sizeof(batchLens)/sizeof(*batchLens); i++) {
+        for (size_t n = 1; n <= 19; n += 9) {
+            BRSHA256Batch(batchMds, batchData, batchLens[i], batchLens[i] + 3, n);
+            
+            for (size_t j = 0; j < n; j++) {
+                BRSHA256(batchMd, &batchData[j*(batchLens[i] + 3)], batchLens[i]);
+                if (memcmp(batchMd, &batchMds[j*32], 32) != 0)
+                    r = 0, fprintf(stderr, "\n***FAILED*** %s: BRSHA256Batch() test %zu", __func__, batchLens[i]);
+            }
+            
+            BRSHA256_2Batch(batchMds, batchData, batchLens[i], batchLens[i] + 3, n);
+            
+            for (size_t j = 0; j < n; j++) {
+                BRSHA256_2(batchMd, &batchData[j*(batchLens[i] + 3)], batchLens[i]);
+                if (memcmp(batchMd, &batchMds[j*32], 32) != 0)
+                    r = 0, fprintf(stderr, "\n***FAILED*** %s: BRSHA256_2Batch() test %zu", __func__, batchLens[i]);
+            }
+        }
+    }
+    
+    // merkle rows hash pairs of hashes in place
+    for (size_t j = 0; j < 19; j++) BRSHA256_2(&batchMds[j*32], &batchData[j*64], 64);
+    BRSHA256_2Batch(batchData, batchData, 64, 64, 19);
+    if (memcmp(batchMds, batchData, 19*32) != 0)
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRSHA256_2Batch() in place test", __func__);
+
     // test sha512
     
     s = "Free online SHA512 Calculator, type text here...";
@@ -664,6 +741,15 @@ int BRHashTests()
                     "\x82\x27\x3b\x7b\xfa\xd8\x04\x5d\x85\xa4\x70", *(UInt256 *)md))
         r = 0, fprintf(stderr, "***FAILED*** %s: Keccak-256() test 1\n", __func__);
 
+    // test keccak-512
+
+    s = "";
+    BRKeccak512(md, s, strlen(s));
+    if (! UInt512Eq(*(UInt512 *)"\x0e\xab\x42\xde\x4c\x3c\xeb\x92\x35\xfc\x91\xac\xff\xe7\x46\xb2\x9c\x29\xa8\xc3\x66"
+                    "\xb7\xc6\x0e\x4e\x67\xc4\x66\xf3\x6a\x43\x04\xc0\x0f\xa9\xca\xf9\xd8\x79\x76\xba\x46\x9b"
+                    "\xcb\xe0\x67\x13\xb4\x35\xf0\x91\xef\x27\x69\xfb\x16\x0c\xda\xb3\x3d\x36\x70\x68\x0e", *(UInt512 *)md))
+        r = 0, fprintf(stderr, "***FAILED*** %s: Keccak-512() test 1\n", __func__);
+
     // test murmurHash3-x86_32
     
     if (BRMurmur3_32("", 0, 0) != 0)
@@ -2041,6 +2127,16 @@ int BRBIP32SequenceTests()
                     uint256("7b6a7dd645507d775215a9035be06700e1ed8c541da9351b4bd14bd50ab61428")))
         r = 0, fprintf(stderr, "***FAILED*** %s: BRBIP32PubKey() test\n", __func__);
 
+    BRECPoint pubKeys[100];
+    
+    BRBIP32PubKeyRange(pubKeys, 100, BRBIP32ChainPubKey(mpk, SEQUENCE_INTERNAL_CHAIN), 5, 4);
+    
+    for (uint32_t i = 0; i < 100; i++) {
+        BRBIP32PubKey(pubKey, sizeof(pubKey), mpk, SEQUENCE_INTERNAL_CHAIN, 5 + i);
+        if (memcmp(pubKey, pubKeys[i].p, sizeof(pubKey)) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRBIP32PubKeyRange() test %u\n", __func__, i);
+    }
+
     UInt512 dk;
     BRAddress addr;
 
@@ -2169,6 +2265,15 @@ int BRTransactionTests()
     
     if (len2 != len3 || memcmp(buf2, buf3, len2) != 0)
         r = 0, fprintf(stderr, "\n***FAILED*** %s: BRTransactionSerialize() test 1", __func__);
+    
+    size_t size = BRTransactionSize(tx); // sizes are cached when parsed, and recalculated when outputs are added
+    
+    if (tx->size != len3 || size != len3 || BRTransactionVSize(tx) != len3)
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRTransactionSize() test 1", __func__);
+    
+    BRTransactionAddOutput(tx, 1000000, script, scriptLen);
+    if (tx->size != 0 || BRTransactionSize(tx) != size + sizeof(uint64_t) + BRVarIntSize(scriptLen) + scriptLen)
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRTransactionSize() test 2", __func__);
     BRTransactionFree(tx);
     
     tx = BRTransactionNew();
@@ -2240,6 +2345,9 @@ int BRTransactionTests()
     BRTransactionAddOutput(tx, 1000000, script, scriptLen);
     BRTransactionAddOutput(tx, 1000000, script, scriptLen);
     BRTransactionAddOutput(tx, 1000000, script, scriptLen);
+    
+    BRTransaction *ptx = BRTransactionCopy(tx);
+    
     BRTransactionSign(tx, 0, k, 2);
     BRAddressFromScriptSig(addr.s, sizeof(addr), BRMainNetParams->addrParams,
                            tx->inputs[tx->inCount - 1].signature, tx->inputs[tx->inCount - 1].sigLen);
@@ -2248,13 +2356,25 @@ int BRTransactionTests()
     
     uint8_t buf6[BRTransactionSerialize(tx, NULL, 0)];
     size_t len6 = BRTransactionSerialize(tx, buf6, sizeof(buf6));
+    UInt256 txHash = tx->txHash, wtxHash = tx->wtxHash;
+    
+    BRTransactionSignParallel(ptx, 0, k, 2, 4);
+    
+    uint8_t pbuf[BRTransactionSerialize(ptx, NULL, 0)];
+    size_t plen = BRTransactionSerialize(ptx, pbuf, sizeof(pbuf));
     
+    if (plen != len6 || memcmp(pbuf, buf6, len6) != 0 || ! UInt256Eq(ptx->txHash, txHash))
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRTransactionSignParallel() test", __func__);
+    BRTransactionFree(ptx);
     BRTransactionFree(tx);
     tx = BRTransactionParse(buf6, len6);
     if (! tx || ! BRTransactionIsSigned(tx))
         r = 0, fprintf(stderr, "\n***FAILED*** %s: BRTransactionParse() test 3", __func__);
     if (! tx) return r;
     
+    if (! UInt256Eq(tx->txHash, txHash) || ! UInt256Eq(tx->wtxHash, wtxHash) || UInt256Eq(txHash, wtxHash))
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRTransactionSign() txHash test", __func__);
+    
     uint8_t buf7[BRTransactionSerialize(tx, NULL, 0)];
     size_t len7 = BRTransactionSerialize(tx, buf7, sizeof(buf7));
     
@@ -2377,6 +2497,33 @@ static void walletTxDeleted(void *info, UInt256 txHash, int notifyUser, int reco
     printf("tx deleted: %s\n", u256hex(txHash));
 }
 
+typedef struct {
+    BRWallet *wallet;
+    _Atomic(int) done;
+    int ok;
+} _WalletReaderInfo;
+
+// queries the wallet until done is set, checking that the balance never goes down while transactions are registered
+static void *walletReaderThread(void *arg)
+{
+    _WalletReaderInfo *info = arg;
+    BRAddress addrs[10];
+    uint64_t balance, last = 0;
+
+    info->ok = 1;
+
+    while (! info->done) {
+        balance = BRWalletBalance(info->wallet);
+        if (balance < last) info->ok = 0;
+        last = balance;
+        if (BRWalletUnusedAddrs(info->wallet, addrs, 10, 0) != 10) info->ok = 0;
+        if (BRWalletTransactions(info->wallet, NULL, 0) > 1000) info->ok = 0;
+        if (BRWalletTotalReceived(info->wallet) < BRWalletBalance(info->wallet)) info->ok = 0;
+    }
+
+    return NULL;
+}
+
 // TODO: test standard free transaction no change
 // TODO: test free transaction who's inputs are too new to hit min free priority
 // TODO: test transaction with change below min allowable output
@@ -2547,6 +2694,140 @@ int BRWalletTests()
     BRTransactionFree(tx);
     BRWalletFree(w);
     
+    // balance updates are applied incrementally, so verify out of order inserts, spends and re-orgs match a full replay
+    BRTransaction *txs[5], *txCopies[5];
+    
+    w = BRWalletNew(BRMainNetParams->addrParams, NULL, 0, mpk);
+    
+    for (uint32_t i = 0; i < 4; i++) {
+        txs[i] = BRTransactionNew();
+        BRTransactionAddInput(txs[i], inHash, i, 1, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+        BRTransactionAddOutput(txs[i], SATOSHIS*(i + 1), outScript, outScriptLen);
+        BRTransactionSign(txs[i], 0, &k, 1);
+        txs[i]->blockHeight = 100 - i; // each tx is inserted before the previous one
+        txs[i]->timestamp = 1;
+        BRWalletRegisterTransaction(w, txs[i]);
+    }
+    
+    txs[4] = BRWalletCreateTransaction(w, SATOSHIS*5/2, addr.s);
+    if (txs[4]) BRWalletSignTransaction(w, txs[4], 0x00, &seed, sizeof(seed));
+    if (txs[4]) txs[4]->timestamp = 1, BRWalletRegisterTransaction(w, txs[4]);
+    if (! txs[4] || BRWalletBalance(w) + BRWalletFeeForTx(w, txs[4]) != SATOSHIS*10 - SATOSHIS*5/2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletRegisterTransaction() test 6\n", __func__);
+    
+    if (txs[4]) BRWalletUpdateTransactions(w, &txs[4]->txHash, 1, 99, 1);
+    BRWalletSetTxUnconfirmedAfter(w, 98);
+    BRWalletUpdateTransactions(w, &txs[0]->txHash, 1, 101, 1);
+
+    for (size_t i = 0; i < 5; i++) txCopies[i] = (txs[i]) ? BRTransactionCopy(txs[i]) : NULL;
+    
+    BRWallet *w2 = (txs[4]) ? BRWalletNew(BRMainNetParams->addrParams, txCopies, 5, mpk) : NULL;
+    
+    if (! w2 || BRWalletBalance(w) != BRWalletBalance(w2) || BRWalletUTXOs(w, NULL, 0) != BRWalletUTXOs(w2, NULL, 0) ||
+        BRWalletTotalSent(w) != BRWalletTotalSent(w2) || BRWalletTotalReceived(w) != BRWalletTotalReceived(w2))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletSetTxUnconfirmedAfter() test\n", __func__);
+    
+    if (w2) BRWalletFree(w2);
+    BRWalletFree(w);
+    
+    // coin selection strategies
+    BRTxOutput out = BR_TX_OUTPUT_NONE;
+    
+    tx = BRTransactionNew();
+    BRTransactionAddInput(tx, inHash, 0, 1, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(tx, 100000, outScript, outScriptLen);
+    BRTransactionAddOutput(tx, 200000, outScript, outScriptLen);
+    BRTransactionAddOutput(tx, 300000, outScript, outScriptLen);
+    BRTransactionAddOutput(tx, 5000000, outScript, outScriptLen);
+    BRTransactionAddOutput(tx, 700000, outScript, outScriptLen);
+    BRTransactionSign(tx, 0, &k, 1);
+    w = BRWalletNew(BRMainNetParams->addrParams, &tx, 1, mpk);
+    BRWalletSetFeePerKb(w, 10000);
+    BRTxOutputSetAddress(&out, BRMainNetParams->addrParams, addr.s);
+    
+    out.amount = 550000;
+    tx = BRWalletCreateTxForOutputsWithStrategy(w, UINT64_MAX, &out, 1, BRCoinSelectionLargestFirst, 0);
+    if (! tx || tx->inCount != 1 || tx->inputs[0].amount != 5000000)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletCreateTxForOutputsWithStrategy() test 1\n", __func__);
+    
+    if (tx) BRTransactionFree(tx);
+    tx = BRWalletCreateTxForOutputsWithStrategy(w, UINT64_MAX, &out, 1, BRCoinSelectionConsolidate, 0);
+    if (! tx || tx->inCount != 5 || tx->outCount != 2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletCreateTxForOutputsWithStrategy() test 2\n", __func__);
+    
+    if (tx) BRTransactionFree(tx);
+    out.amount = 500000 - 3400; // 200000 + 300000 inputs less the fee for a 340 byte tx at 10 satoshis-per-byte
+    tx = BRWalletCreateTxForOutputsWithStrategy(w, UINT64_MAX, &out, 1, BRCoinSelectionBranchAndBound, 1.0);
+    if (! tx || tx->inCount != 2 || tx->outCount != 1 || BRWalletFeeForTx(w, tx) != 3400)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletCreateTxForOutputsWithStrategy() test 3\n", __func__);
+    
+    if (tx) BRTransactionFree(tx);
+    out.amount = 5500000; // no input set can fund this without change, so falls back to largest-first
+    tx = BRWalletCreateTxForOutputsWithStrategy(w, UINT64_MAX, &out, 1, BRCoinSelectionBranchAndBound, 1.0);
+    if (! tx || tx->inCount != 2 || tx->outCount != 2)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletCreateTxForOutputsWithStrategy() test 4\n", __func__);
+    
+    if (tx) BRTransactionFree(tx);
+    BRWalletFree(w);
+    
+    // queries made from other threads while transactions are registered
+    w = BRWalletNew(BRMainNetParams->addrParams, NULL, 0, mpk);
+    recvAddr = BRWalletReceiveAddress(w);
+    outScriptLen = BRAddressScriptPubKey(outScript, sizeof(outScript), BRMainNetParams->addrParams, recvAddr.s);
+    
+    _WalletReaderInfo readers[4];
+    pthread_t readerThreads[4];
+    
+    for (size_t i = 0; i < 4; i++) {
+        readers[i].wallet = w;
+        readers[i].done = 0;
+        if (pthread_create(&readerThreads[i], NULL, walletReaderThread, &readers[i]) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: pthread_create() test\n", __func__);
+    }
+    
+    for (uint32_t i = 0; i < 200; i++) {
+        tx = BRTransactionNew();
+        UInt32SetLE(inHash.u8, i + 1);
+        BRTransactionAddInput(tx, inHash, 0, 1, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+        BRTransactionAddOutput(tx, 1000 + i, outScript, outScriptLen);
+        BRTransactionSign(tx, 0, &k, 1);
+        if (! BRWalletRegisterTransaction(w, tx)) BRTransactionFree(tx);
+    }
+    
+    for (size_t i = 0; i < 4; i++) {
+        readers[i].done = 1;
+        pthread_join(readerThreads[i], NULL);
+        if (! readers[i].ok) r = 0, fprintf(stderr, "***FAILED*** %s: concurrent query test %zu\n", __func__, i);
+    }
+    
+    if (BRWalletBalance(w) != 200*1000 + 199*200/2 || BRWalletTransactions(w, NULL, 0) != 200)
+        r = 0, fprintf(stderr, "***FAILED*** %s: concurrent BRWalletRegisterTransaction() test\n", __func__);
+    
+    // cached amounts must follow the input tx becoming known to the wallet
+    BRTransaction *parent = BRTransactionNew(), *child = BRTransactionNew();
+    
+    UInt32SetLE(inHash.u8, 1000);
+    BRTransactionAddInput(parent, inHash, 0, 1, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(parent, 50000, inScript, inScriptLen);
+    BRTransactionAddOutput(parent, 60000, outScript, outScriptLen);
+    BRTransactionSign(parent, 0, &k, 1);
+    BRTransactionAddInput(child, parent->txHash, 1, 60000, outScript, outScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(child, 55000, inScript, inScriptLen);
+    BRTxInputSetSignature(&child->inputs[0], inScript, inScriptLen); // a signature isn't verified, only needs to exist
+    BRTxInputSetWitness(&child->inputs[0], inScript, 0);
+    child->txHash = child->wtxHash = uint256("00000000000000000000000000000000000000000000000000000000000003e9");
+    
+    if (BRWalletFeeForTx(w, child) != UINT64_MAX || BRWalletAmountSentByTx(w, child) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletFeeForTx() test 1\n", __func__);
+    
+    if (! BRWalletRegisterTransaction(w, parent)) BRTransactionFree(parent);
+    if (BRWalletFeeForTx(w, child) != 5000 || BRWalletAmountSentByTx(w, child) != 60000 ||
+        BRWalletAmountReceivedFromTx(w, child) != 0 || BRWalletAmountReceivedFromTx(w, parent) != 60000)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletFeeForTx() test 2\n", __func__);
+    
+    BRTransactionFree(child);
+    BRWalletFree(w);
+    
     amt = BRBitcoinAmount(50000, 50000);
     if (amt != SATOSHIS) r = 0, fprintf(stderr, "***FAILED*** %s: BRBitcoinAmount() test 1\n", __func__);
 
@@ -2726,11 +3007,315 @@ int BRMerkleBlockTests()
 
     if (c) BRMerkleBlockFree(c);
 
+    BRMerkleBlockView view;
+
+    if (BRMerkleBlockViewParse(&view, (uint8_t *)block, sizeof(block) - 1) != sizeof(block) - 1 ||
+        ! UInt256Eq(view.blockHash, b->blockHash) || view.hashes != (uint8_t *)&block[85])
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewParse() test 1\n", __func__);
+
+    if (! BRMerkleBlockViewIsValid(&view, (uint32_t)time(NULL), BLOCK_MAX_PROOF_OF_WORK))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewIsValid() test\n", __func__);
+
+    UInt256 viewTxHashes[4];
+
+    if (BRMerkleBlockViewTxHashes(&view, viewTxHashes, 4) != 4 ||
+        memcmp(viewTxHashes, txHashes, sizeof(viewTxHashes)) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewTxHashes() test\n", __func__);
+
+    size_t viewTxCount = 0;
+
+    memset(viewTxHashes, 0, sizeof(viewTxHashes));
+    if (! BRMerkleBlockViewIsValidTxHashes(&view, (uint32_t)time(NULL), BLOCK_MAX_PROOF_OF_WORK, viewTxHashes, 4,
+                                           &viewTxCount) ||
+        viewTxCount != 4 || memcmp(viewTxHashes, txHashes, sizeof(viewTxHashes)) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewIsValidTxHashes() test 1\n", __func__);
+
+    view.hashesCount--; // the tree runs out of hashes
+    if (BRMerkleBlockViewIsValidTxHashes(&view, (uint32_t)time(NULL), BLOCK_MAX_PROOF_OF_WORK, viewTxHashes, 4,
+                                         &viewTxCount))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewIsValidTxHashes() test 2\n", __func__);
+
+    view.hashesCount++, view.flagsLen++; // flags left over after the tree is walked
+    if (BRMerkleBlockViewIsValid(&view, (uint32_t)time(NULL), BLOCK_MAX_PROOF_OF_WORK))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewIsValidTxHashes() test 3\n", __func__);
+
+    view.flagsLen--;
+
+    c = BRMerkleBlockViewCopy(&view);
+
+    if (BRMerkleBlockSerialize(c, block2, sizeof(block2)) != sizeof(block2) ||
+        memcmp(block, block2, sizeof(block2)) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewCopy() test\n", __func__);
+
+    BRMerkleBlockFree(c);
+
+    if (BRMerkleBlockViewParse(&view, (uint8_t *)block, sizeof(block) - 2) != 0) // truncated flags
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewParse() test 2\n", __func__);
+
+    if (BRMerkleBlockViewParse(&view, (uint8_t *)block, 81) != 80 || view.totalTx != 0 || view.hashesCount != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewParse() test 3\n", __func__);
+
+    // partial trees of every shape up to 40 txs, with odd rows at different heights, round trip through
+    // BRMerkleBlockSetMatchedTxHashes()
+    UInt256 treeHashes[40], treeRow[41], treeMatchedHashes[40], treeTxHashes[40];
+    uint8_t treeMatched[40];
+    size_t treeTxCount, treeMatchedCount;
+
+    for (size_t n = 1; n <= 40; n++) {
+        for (size_t i = treeMatchedCount = 0; i < n; i++) {
+            BRSHA256(&treeHashes[i], &i, sizeof(i));
+            treeMatched[i] = (i % 3 == n % 2);
+            if (treeMatched[i]) treeMatchedHashes[treeMatchedCount++] = treeHashes[i];
+        }
+
+        memcpy(treeRow, treeHashes, n*sizeof(*treeRow));
+
+        for (size_t w = n; w > 1; w = (w + 1)/2) {
+            if (w % 2) treeRow[w] = treeRow[w - 1];
+            BRSHA256_2Batch(treeRow, treeRow, 2*sizeof(UInt256), 2*sizeof(UInt256), (w + 1)/2);
+        }
+
+        c = BRMerkleBlockNew();
+        c->merkleRoot = treeRow[0];
+        c->target = 0x1d00ffff; // a zero block hash meets any target
+
+        if (! BRMerkleBlockSetMatchedTxHashes(c, treeHashes, n, treeMatched) ||
+            BRMerkleBlockTxHashes(c, treeTxHashes, n) != treeMatchedCount ||
+            memcmp(treeTxHashes, treeMatchedHashes, treeMatchedCount*sizeof(UInt256)) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockTxHashes() tree test %zu\n", __func__, n);
+
+        view = (BRMerkleBlockView) { c->blockHash, c->version, c->prevBlock, c->merkleRoot, c->timestamp, c->target,
+                                     c->nonce, c->totalTx, (const uint8_t *)c->hashes, c->hashesCount, c->flags,
+                                     c->flagsLen };
+        memset(treeTxHashes, 0, sizeof(treeTxHashes));
+
+        if (! BRMerkleBlockViewIsValidTxHashes(&view, (uint32_t)time(NULL), BLOCK_MAX_PROOF_OF_WORK, treeTxHashes, n,
+                                               &treeTxCount) ||
+            treeTxCount != treeMatchedCount ||
+            memcmp(treeTxHashes, treeMatchedHashes, treeMatchedCount*sizeof(UInt256)) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockViewIsValidTxHashes() tree test %zu\n", __func__, n);
+
+        BRMerkleBlockFree(c);
+    }
 
     if (b) BRMerkleBlockFree(b);
     return r;
 }
 
+// returns a header-only block at height on top of prev, with nonce making it distinct from other blocks at that height
+static BRMerkleBlock *_BRHeaderStoreTestBlock(const BRMerkleBlock *prev, uint32_t height, uint32_t nonce)
+{
+    BRMerkleBlock *block = BRMerkleBlockNew();
+    uint8_t buf[80];
+
+    block->version = 2;
+    block->prevBlock = (prev) ? prev->blockHash : UINT256_ZERO;
+    block->merkleRoot = uint256("4c30b63cfcdc2d35e3329421b9805ef0c6565d35381ca857762ea0b3a5a128bb");
+    block->timestamp = 1500000000 + height*600;
+    block->target = 0x1d00ffff;
+    block->nonce = nonce;
+    block->height = height;
+    BRMerkleBlockSerialize(block, buf, sizeof(buf));
+    BRSHA256_2(&block->blockHash, buf, sizeof(buf));
+    return block;
+}
+
+int BRHeaderStoreTests()
+{
+    int r = 1, fd;
+    char path[] = "/tmp/BRHeaderStoreTests.XXXXXX";
+    const uint32_t first = 2016, count = 20000; // enough headers to grow both the file and the hash index
+    BRHeaderStore *store;
+    BRMerkleBlock *b, *prev = NULL, *fork;
+    UInt256 *hashes = calloc(count, sizeof(*hashes)), work;
+
+    fd = mkstemp(path);
+    if (fd >= 0) close(fd);
+    store = (fd >= 0) ? BRHeaderStoreOpen(path) : NULL;
+    if (! store) return free(hashes), fprintf(stderr, "***FAILED*** %s: BRHeaderStoreOpen() test\n", __func__), 0;
+
+    if (BRHeaderStoreCount(store) != 0 || BRHeaderStoreLastHeight(store) != BLOCK_UNKNOWN_HEIGHT)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreCount() test 0\n", __func__);
+
+    for (uint32_t i = 0; i < count; i++) {
+        b = _BRHeaderStoreTestBlock(prev, first + i, i);
+        hashes[i] = b->blockHash;
+
+        if (! BRHeaderStoreAdd(store, b))
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreAdd() test %"PRIu32"\n", __func__, i);
+
+        if (prev) BRMerkleBlockFree(prev);
+        prev = b;
+    }
+
+    if (BRHeaderStoreCount(store) != count || BRHeaderStoreFirstHeight(store) != first ||
+        BRHeaderStoreLastHeight(store) != first + count - 1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreCount() test 1\n", __func__);
+
+    // already stored headers are accepted as is, gaps and unconnected headers are rejected
+    if (! BRHeaderStoreAdd(store, prev) || BRHeaderStoreCount(store) != count)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreAdd() test existing\n", __func__);
+
+    b = _BRHeaderStoreTestBlock(prev, first + count + 1, 0);
+    if (BRHeaderStoreAdd(store, b)) r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreAdd() test gap\n", __func__);
+    BRMerkleBlockFree(b);
+
+    b = _BRHeaderStoreTestBlock(NULL, first + 10, 0);
+    if (BRHeaderStoreAdd(store, b) || BRHeaderStoreCount(store) != count)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreAdd() test unconnected\n", __func__);
+    BRMerkleBlockFree(b);
+
+    for (uint32_t i = 0; i < count; i += 997) {
+        if (! UInt256Eq(BRHeaderStoreHashAtHeight(store, first + i), hashes[i]) ||
+            BRHeaderStoreHeightForHash(store, hashes[i]) != first + i)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreHeightForHash() test %"PRIu32"\n", __func__, i);
+
+        b = BRHeaderStoreBlockForHash(store, hashes[i]);
+        if (! b || ! UInt256Eq(b->blockHash, hashes[i]) || b->height != first + i || b->nonce != i)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreBlockForHash() test %"PRIu32"\n", __func__, i);
+        if (b) BRMerkleBlockFree(b);
+    }
+
+    // each 0x1d00ffff header is 0x100010001 hashes of work
+    work = BRHeaderStoreChainWork(store, first + count - 1);
+    if (UInt64GetLE(&work.u8[0]) != count*0x100010001ULL || UInt64GetLE(&work.u8[8]) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreChainWork() test\n", __func__);
+
+    // a fork replaces the headers after the join point
+    b = BRHeaderStoreBlockAtHeight(store, first + count - 11);
+    fork = _BRHeaderStoreTestBlock(b, first + count - 10, UINT32_MAX);
+
+    if (! BRHeaderStoreAdd(store, fork) || BRHeaderStoreLastHeight(store) != first + count - 10 ||
+        BRHeaderStoreHeightForHash(store, hashes[count - 1]) != BLOCK_UNKNOWN_HEIGHT ||
+        BRHeaderStoreHeightForHash(store, hashes[count - 10]) != BLOCK_UNKNOWN_HEIGHT ||
+        BRHeaderStoreHeightForHash(store, fork->blockHash) != first + count - 10 ||
+        BRHeaderStoreHeightForHash(store, hashes[count - 11]) != first + count - 11)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreAdd() test fork\n", __func__);
+
+    BRMerkleBlockFree(b);
+    BRHeaderStoreClose(store);
+
+    // headers survive closing and reopening the store
+    store = BRHeaderStoreOpen(path);
+
+    if (! store || BRHeaderStoreCount(store) != count - 9 ||
+        BRHeaderStoreHeightForHash(store, fork->blockHash) != first + count - 10 ||
+        BRHeaderStoreHeightForHash(store, hashes[0]) != first)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreOpen() test reopen\n", __func__);
+
+    if (store) {
+        BRHeaderStoreTruncate(store, 0);
+        if (BRHeaderStoreCount(store) != 0 || BRHeaderStoreHeightForHash(store, hashes[0]) != BLOCK_UNKNOWN_HEIGHT)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreTruncate() test\n", __func__);
+        BRHeaderStoreClose(store);
+    }
+
+    BRMerkleBlockFree(fork);
+    BRMerkleBlockFree(prev);
+    free(hashes);
+    unlink(path);
+    return r;
+}
+
+int BRBlockFilterTests()
+{
+    int r = 1;
+    // BIP158 test vector for the testnet genesis block, whose only output script is the coinbase pay-to-pubkey
+    UInt256 blockHash = UInt256Reverse(uint256("000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943")),
+            header, txHashes[5], out[5], row[3], pair[2];
+    const char *scriptHex = "4104678afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4f35504"
+                            "e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac";
+    uint8_t script[67], other[67], filter[4096], scripts[200][25], matched[5] = { 0, 0, 1, 0, 0 };
+    BRBlockFilterElement elems[200], dups[3];
+    size_t len, i;
+    BRMerkleBlock *block;
+
+    for (i = 0; i < sizeof(script); i++) script[i] = _hexu(scriptHex[i*2]) << 4 | _hexu(scriptHex[i*2 + 1]);
+    elems[0] = (BRBlockFilterElement) { script, sizeof(script) };
+    len = BRBlockFilterBuild(filter, sizeof(filter), blockHash, elems, 1);
+
+    if (len != 4 || memcmp(filter, "\x01\x9d\xfc\xa8", 4) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBlockFilterBuild() test 1\n", __func__);
+
+    header = BRBlockFilterHeader(BRBlockFilterHash(filter, len), UINT256_ZERO);
+
+    if (! UInt256Eq(header, UInt256Reverse(uint256("21584579b7eb08997773e5aeff3a7f932700042d0ed2a6129012b7d7ae81b750"))))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBlockFilterHeader() test\n", __func__);
+
+    memcpy(other, script, sizeof(other));
+    other[10] ^= 0x01;
+    elems[1] = (BRBlockFilterElement) { other, sizeof(other) };
+
+    if (! BRBlockFilterMatchAny(filter, len, blockHash, elems, 1) ||
+        ! BRBlockFilterMatchAny(filter, len, blockHash, elems, 2))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBlockFilterMatchAny() test 1\n", __func__);
+
+    if (BRBlockFilterMatchAny(filter, len, blockHash, &elems[1], 1) ||
+        BRBlockFilterMatchAny(filter, len, UINT256_ZERO, elems, 1) || BRBlockFilterMatchAny(filter, 2, blockHash, elems, 1))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBlockFilterMatchAny() test 2\n", __func__);
+
+    // duplicate and empty elements are skipped
+    dups[0] = elems[0], dups[1] = (BRBlockFilterElement) { other, 0 }, dups[2] = elems[0];
+
+    if (BRBlockFilterBuild(NULL, 0, blockHash, dups, 3) != 4 || BRBlockFilterBuild(filter, 3, blockHash, dups, 3) != 0 ||
+        BRBlockFilterBuild(filter, sizeof(filter), blockHash, dups, 3) != 4 || memcmp(filter, "\x01\x9d\xfc\xa8", 4) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBlockFilterBuild() test 2\n", __func__);
+
+    if (BRBlockFilterBuild(filter, sizeof(filter), blockHash, NULL, 0) != 1 || filter[0] != 0 ||
+        BRBlockFilterMatchAny(filter, 1, blockHash, elems, 1))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBlockFilterBuild() test 3\n", __func__);
+
+    // the first 100 scripts go in the filter, each should match, and none of the other 100 should
+    for (i = 0; i < 200; i++) {
+        memcpy(scripts[i], "\x76\xa9\x14", 3);
+        BRSHA256(&pair[0], &i, sizeof(i));
+        memcpy(&scripts[i][3], &pair[0], 20);
+        memcpy(&scripts[i][23], "\x88\xac", 2);
+        elems[i] = (BRBlockFilterElement) { scripts[i], sizeof(scripts[i]) };
+    }
+
+    len = BRBlockFilterBuild(filter, sizeof(filter), blockHash, elems, 100);
+
+    for (i = 0; len > 0 && i < 100; i++) {
+        if (! BRBlockFilterMatchAny(filter, len, blockHash, &elems[i], 1)) break;
+    }
+
+    if (len == 0 || i < 100 || BRBlockFilterMatchAny(filter, len, blockHash, &elems[100], 100) ||
+        ! BRBlockFilterMatchAny(filter, len, blockHash, &elems[99], 101))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBlockFilterMatchAny() test 3\n", __func__);
+
+    // a block of five tx, pruned to the one its filter matched
+    for (i = 0; i < 5; i++) BRSHA256(&txHashes[i], &i, sizeof(i));
+
+    for (i = 0; i < 3; i++) {
+        pair[0] = txHashes[i*2], pair[1] = (i*2 + 1 < 5) ? txHashes[i*2 + 1] : txHashes[i*2];
+        BRSHA256_2(&row[i], pair, sizeof(pair));
+    }
+
+    BRSHA256_2(&pair[0], row, sizeof(pair));
+    row[1] = row[2];
+    BRSHA256_2(&pair[1], &row[1], sizeof(pair));
+    block = BRMerkleBlockNew();
+    BRSHA256_2(&block->merkleRoot, pair, sizeof(pair));
+
+    if (! BRMerkleBlockSetMatchedTxHashes(block, txHashes, 5, NULL) || block->totalTx != 5 ||
+        BRMerkleBlockTxHashes(block, out, 5) != 5 || memcmp(out, txHashes, sizeof(out)) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockSetMatchedTxHashes() test 1\n", __func__);
+
+    if (! BRMerkleBlockSetMatchedTxHashes(block, txHashes, 5, matched) || block->hashesCount != 4 ||
+        BRMerkleBlockTxHashes(block, out, 5) != 1 || ! UInt256Eq(out[0], txHashes[2]))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockSetMatchedTxHashes() test 2\n", __func__);
+
+    txHashes[3] = txHashes[2]; // rows with duplicate pairs must be rejected (CVE-2012-2459)
+
+    if (BRMerkleBlockSetMatchedTxHashes(block, txHashes, 5, NULL) ||
+        BRMerkleBlockSetMatchedTxHashes(block, txHashes, 0, NULL))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockSetMatchedTxHashes() test 3\n", __func__);
+
+    BRMerkleBlockFree(block);
+    return r;
+}
+
 int BRPaymentProtocolTests()
 {
     int r = 1;
@@ -3169,6 +3754,25 @@ int BRPaymentProtocolEncryptionTests()
 
 void BRPeerAcceptMessageTest(BRPeer *peer, const uint8_t *msg, size_t len, const char *type);
 
+typedef struct {
+    UInt256 hashes[2000];
+    size_t count;
+} BRPeerTestHeaders;
+
+static void peerRelayedHeaders(void *info, BRMerkleBlock *headers[], size_t count)
+{
+    BRPeerTestHeaders *relayed = info;
+
+    for (size_t i = 0; i < count; i++) {
+        if (relayed->count < sizeof(relayed->hashes)/sizeof(*relayed->hashes)) {
+            relayed->hashes[relayed->count] = headers[i]->blockHash;
+        }
+
+        relayed->count++;
+        BRMerkleBlockFree(headers[i]);
+    }
+}
+
 int BRPeerTests()
 {
     int r = 1;
@@ -3176,6 +3780,57 @@ int BRPeerTests()
     const char msg[] = "my message";
     
     BRPeerAcceptMessageTest(p, (const uint8_t *)msg, sizeof(msg) - 1, "inv");
+    BRPeerFree(p);
+
+    // a full headers message is validated in shares on the headers thread pool, and relayed in order up to the first
+    // header with invalid proof-of-work
+    static BRPeerTestHeaders relayed;
+    static uint8_t headers[3 + 2000*81];
+    UInt256 hashes[2000];
+    uint32_t timestamp = (uint32_t)time(NULL) - 30*24*60*60 - 2000*10*60, nonce;
+    size_t off = BRVarIntSet(headers, sizeof(headers), 2000);
+
+    for (uint32_t h = 0; h < 2000; h++, off += 81) {
+        UInt32SetLE(&headers[off], 1); // version
+        UInt256Set(&headers[off + 4], (h > 0) ? hashes[h - 1] : UINT256_ZERO);
+        BRSHA256(&headers[off + 36], &h, sizeof(h)); // merkle root
+        UInt32SetLE(&headers[off + 68], timestamp + h*10*60);
+        UInt32SetLE(&headers[off + 72], 0x207fffff); // target
+        nonce = 0;
+
+        do { // mine the header, about half of all hashes meet the target
+            UInt32SetLE(&headers[off + 76], nonce++);
+            BRSHA256_2(&hashes[h], &headers[off], 80);
+        } while (hashes[h].u8[31] >= 0x7f);
+    }
+
+    p = BRPeerNew(BRMainNetParams->magicNumber);
+    BRPeerSetCallbacks(p, &relayed, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    BRPeerSetRelayedHeadersCallback(p, peerRelayedHeaders);
+    BRPeerSetEarliestKeyTime(p, (uint32_t)time(NULL));
+    BRPeerAcceptMessageTest(p, headers, off, "headers");
+    if (relayed.count != 0) r = 0, fprintf(stderr, "***FAILED*** %s: headers maxProofOfWork test\n", __func__);
+
+    BRPeerSetMaxProofOfWork(p, 0x207fffff);
+    relayed.count = 0;
+    BRPeerAcceptMessageTest(p, headers, off, "headers");
+    if (relayed.count != 2000 || memcmp(relayed.hashes, hashes, sizeof(hashes)) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: headers test\n", __func__);
+
+    off = 3 + 1700*81;
+    nonce = 0;
+
+    do { // unmine header 1700
+        UInt32SetLE(&headers[off + 76], nonce++);
+        BRSHA256_2(&hashes[1700], &headers[off], 80);
+    } while (hashes[1700].u8[31] < 0x80);
+
+    relayed.count = 0;
+    BRPeerAcceptMessageTest(p, headers, sizeof(headers), "headers");
+    if (relayed.count != 1700 || memcmp(relayed.hashes, hashes, 1700*sizeof(*hashes)) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: headers invalid proof-of-work test\n", __func__);
+
+    BRPeerFree(p);
     return r;
 }
 
@@ -3231,10 +3886,16 @@ int BRRunTests()
     printf("%s\n", (BRBloomFilterTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BRMerkleBlockTests...               ");
     printf("%s\n", (BRMerkleBlockTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("BRHeaderStoreTests...               ");
+    printf("%s\n", (BRHeaderStoreTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("BRBlockFilterTests...               ");
+    printf("%s\n", (BRBlockFilterTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BRPaymentProtocolTests...           ");
     printf("%s\n", (BRPaymentProtocolTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BRPaymentProtocolEncryptionTests... ");
     printf("%s\n", (BRPaymentProtocolEncryptionTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("BRPeerTests...                      ");
+    printf("%s\n", (BRPeerTests()) ? "success" : (fail++, "***FAIL***"));
     printf("\n");
     
     if (fail > 0) printf("%d TEST FUNCTION(S) ***FAILED***\n", fail);
@@ -3365,6 +4026,936 @@ extern int BRRunTestsSync (const char *paperKey,
     return 1;
 }
 
+inline static size_t _perfHashUInt256(const void *u) { return (size_t)UInt64GetLE(u); }
+inline static int _perfEqUInt256(const void *u1, const void *u2) { return UInt256Eq(UInt256Get(u1), UInt256Get(u2)); }
+
+inline static double _perfNow(void)
+{
+    struct timeval tv;
+    
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (double)tv.tv_usec/1000000;
+}
+
+// the BRSet implementation from before the power-of-two rewrite, kept here as the baseline for BRRunPerfTestsSet(): a
+// linear probed hashtable of prime size with a maximum load factor of 2/3, that calls hash() on every probe start and
+// rehash, eq() on every occupied bucket it probes, and re-adds the rest of the probe run after a removal
+
+static const size_t _perfOldSetSizes[] = {
+    1, 3, 7, 13, 23, 37, 59, 97, 149, 227, 347, 523, 787, 1187, 1783, 2677, 4019, 6037, 9059, 13591,
+    20389, 30593, 45887, 68863, 103307, 154981, 232487, 348739, 523129, 784697, 1177067, 1765609,
+    2648419, 3972643, 5958971, 8938469, 13407707, 20111563, 30167359, 45251077, 67876637, 101814991,
+    152722489, 229083739, 343625629, 515438447, 773157683, 1159736527, 1739604799, 2609407319, 3914111041
+};
+
+typedef struct {
+    void **table;
+    size_t size;
+    size_t itemCount;
+    size_t (*hash)(const void *);
+    int (*eq)(const void *, const void *);
+} _BRPerfOldSet;
+
+static void _perfOldSetInit(_BRPerfOldSet *set, size_t (*hash)(const void *), int (*eq)(const void *, const void *),
+                            size_t capacity)
+{
+    size_t i = 0, n = sizeof(_perfOldSetSizes)/sizeof(*_perfOldSetSizes);
+
+    while (i < n && _perfOldSetSizes[i] < capacity) i++;
+    assert(i + 1 < n);
+    set->table = calloc(_perfOldSetSizes[i + 1], sizeof(void *));
+    assert(set->table != NULL);
+    set->size = _perfOldSetSizes[i + 1];
+    set->itemCount = 0;
+    set->hash = hash;
+    set->eq = eq;
+}
+
+static void *_perfOldSetAdd(_BRPerfOldSet *set, void *item)
+{
+    size_t i, size = set->size;
+    void *t;
+
+    i = set->hash(item) % size;
+    t = set->table[i];
+
+    while (t && t != item && ! set->eq(t, item)) { // probe for empty bucket
+        i = (i + 1) % size;
+        t = set->table[i];
+    }
+
+    if (! t) set->itemCount++;
+    set->table[i] = item;
+
+    if (set->itemCount > ((size + 2)/3)*2) { // limit load factor to 2/3
+        _BRPerfOldSet newSet;
+
+        _perfOldSetInit(&newSet, set->hash, set->eq, size);
+        for (i = 0; i < size; i++) if (set->table[i]) _perfOldSetAdd(&newSet, set->table[i]);
+        free(set->table);
+        *set = newSet;
+    }
+
+    return t;
+}
+
+static void *_perfOldSetGet(const _BRPerfOldSet *set, const void *item)
+{
+    size_t size = set->size, i = set->hash(item) % size;
+    void *t = set->table[i];
+
+    while (t != item && t && ! set->eq(t, item)) { // probe for item
+        i = (i + 1) % size;
+        t = set->table[i];
+    }
+
+    return t;
+}
+
+static void *_perfOldSetRemove(_BRPerfOldSet *set, const void *item)
+{
+    size_t size = set->size, i = set->hash(item) % size;
+    void *r = set->table[i], *t;
+
+    while (r != item && r && ! set->eq(r, item)) { // probe for item
+        i = (i + 1) % size;
+        r = set->table[i];
+    }
+
+    if (r) {
+        set->itemCount--;
+        set->table[i] = NULL;
+        i = (i + 1) % size;
+        t = set->table[i];
+
+        while (t) { // hashtable cleanup
+            set->itemCount--;
+            set->table[i] = NULL;
+            _perfOldSetAdd(set, t);
+            i = (i + 1) % size;
+            t = set->table[i];
+        }
+    }
+
+    return r;
+}
+
+// times BRSet adds, lookups of members and non-members, and removes for sets of 10^3 up to maxCount random 32 byte
+// items (as with transaction hashes), side by side with the previous BRSet implementation above, printing nanoseconds
+// per operation for each, returns true if every operation gave the expected result
+// members are looked up by a copy, as with hashes parsed from a message, rather than by the pointer in the set
+extern int BRRunPerfTestsSet (size_t maxCount) {
+    UInt256 *items = calloc(maxCount*2, sizeof(*items)), u;
+    double start, add, get, miss, rm;
+    size_t i, n, found;
+    _BRPerfOldSet old;
+    BRSet *set;
+    int r = 1;
+
+    assert(items != NULL);
+    for (i = 0; i < maxCount*2; i++) BRSHA256(&items[i], &i, sizeof(i)); // second half are never added
+
+    for (n = 1000; n <= maxCount; n *= 10) {
+        _perfOldSetInit(&old, _perfHashUInt256, _perfEqUInt256, 0);
+        start = _perfNow();
+        for (i = 0; i < n; i++) _perfOldSetAdd(&old, &items[i]);
+        add = _perfNow() - start;
+        start = _perfNow();
+        for (i = 0, found = 0; i < n; i++) u = items[i], found += (_perfOldSetGet(&old, &u) != NULL);
+        get = _perfNow() - start;
+        if (found != n) r = 0;
+        start = _perfNow();
+        for (i = 0, found = 0; i < n; i++) found += (_perfOldSetGet(&old, &items[maxCount + i]) != NULL);
+        miss = _perfNow() - start;
+        if (found != 0) r = 0;
+        start = _perfNow();
+        for (i = 0; i < n; i++) if (_perfOldSetRemove(&old, &items[i]) != &items[i]) r = 0;
+        rm = _perfNow() - start;
+        if (old.itemCount != 0) r = 0;
+        free(old.table);
+        printf("old   %8zu items: add %6.1fns, get %6.1fns, miss %6.1fns, remove %6.1fns\n", n, add*1e9/n,
+               get*1e9/n, miss*1e9/n, rm*1e9/n);
+
+        set = BRSetNew(_perfHashUInt256, _perfEqUInt256, 0);
+        start = _perfNow();
+        for (i = 0; i < n; i++) BRSetAdd(set, &items[i]);
+        add = _perfNow() - start;
+        start = _perfNow();
+        for (i = 0, found = 0; i < n; i++) u = items[i], found += BRSetContains(set, &u);
+        get = _perfNow() - start;
+        if (found != n) r = 0;
+        start = _perfNow();
+        for (i = 0, found = 0; i < n; i++) found += BRSetContains(set, &items[maxCount + i]);
+        miss = _perfNow() - start;
+        if (found != 0) r = 0;
+        start = _perfNow();
+        for (i = 0; i < n; i++) if (BRSetRemove(set, &items[i]) != &items[i]) r = 0;
+        rm = _perfNow() - start;
+        if (BRSetCount(set) != 0) r = 0;
+        BRSetFree(set);
+        printf("BRSet %8zu items: add %6.1fns, get %6.1fns, miss %6.1fns, remove %6.1fns\n", n, add*1e9/n,
+               get*1e9/n, miss*1e9/n, rm*1e9/n);
+    }
+
+    free(items);
+    return r;
+}
+
+// double-sha-256 hashes count 64 byte merkle pairs and 80 byte headers one at a time, and as batches, printing the time
+// per message for each, returns true if the batches matched the single hashes
+extern int BRRunPerfTestsSHA256 (size_t count) {
+    uint8_t *data = malloc(count*81), *mds = malloc(count*32), *batchMds = malloc(count*32);
+    const size_t lens[] = { 64, 80 }, strides[] = { 64, 81 };
+    double start, single, batch;
+    size_t i, j;
+    int r = 1;
+
+    assert(data != NULL && mds != NULL && batchMds != NULL);
+    for (i = 0; i < count*81; i++) data[i] = (uint8_t)(i*131 + 7);
+
+    for (j = 0; j < sizeof(lens)/sizeof(*lens); j++) {
+        start = _perfNow();
+        for (i = 0; i < count; i++) BRSHA256_2(&mds[i*32], &data[i*strides[j]], lens[j]);
+        single = _perfNow() - start;
+        start = _perfNow();
+        BRSHA256_2Batch(batchMds, data, lens[j], strides[j], count);
+        batch = _perfNow() - start;
+        if (memcmp(mds, batchMds, count*32) != 0) r = 0;
+        printf("BRSHA256_2 %8zu %2zu byte messages: single %6.1fns, batch %6.1fns\n", count, lens[j],
+               single*1e9/count, batch*1e9/count);
+    }
+
+    free(batchMds);
+    free(mds);
+    free(data);
+    return r;
+}
+
+// serializes blockCount merkleblocks of txCount txs each, filtered to match every matchInterval'th tx, then times
+// parsing them and checking their merkle trees while extracting their matched tx hashes, first with a separate
+// BRMerkleBlockViewIsValid() and BRMerkleBlockViewTxHashes(), then with BRMerkleBlockViewIsValidTxHashes(), printing
+// the time per block for each, returns true if every block was valid and both found the same tx hashes
+extern int BRRunPerfTestsMerkleBlock (size_t txCount, size_t matchInterval, size_t blockCount) {
+    UInt256 *txHashes = calloc(txCount + 1, sizeof(*txHashes)), *row = calloc(txCount + 1, sizeof(*row)),
+            *found = calloc(txCount, sizeof(*found)), *found2 = calloc(txCount, sizeof(*found2));
+    uint8_t *matched = calloc(txCount, sizeof(*matched)), **msgs = calloc(blockCount, sizeof(*msgs));
+    size_t *msgsLen = calloc(blockCount, sizeof(*msgsLen)), i, j, n, n2, w;
+    uint32_t now = (uint32_t)time(NULL);
+    double start, separate, single;
+    BRMerkleBlockView view;
+    BRMerkleBlock *block;
+    int r = 1;
+
+    assert(txHashes != NULL && row != NULL && found != NULL && found2 != NULL && matched != NULL && msgs != NULL &&
+           msgsLen != NULL);
+    
+    for (i = 0; i < blockCount; i++) {
+        for (j = 0; j < txCount; j++) {
+            size_t h[2] = { i, j };
+            
+            BRSHA256_2(&txHashes[j], h, sizeof(h));
+            matched[j] = ((i + j) % matchInterval == 0);
+        }
+
+        memcpy(row, txHashes, txCount*sizeof(*row));
+
+        for (w = txCount; w > 1; w = (w + 1)/2) {
+            if (w % 2) row[w] = row[w - 1];
+            BRSHA256_2Batch(row, row, 2*sizeof(UInt256), 2*sizeof(UInt256), (w + 1)/2);
+        }
+
+        block = BRMerkleBlockNew();
+        block->merkleRoot = row[0];
+        block->target = 0x1d00ffff; // a zero block hash meets any target
+        if (! BRMerkleBlockSetMatchedTxHashes(block, txHashes, txCount, matched)) r = 0;
+        msgsLen[i] = BRMerkleBlockSerialize(block, NULL, 0);
+        msgs[i] = malloc(msgsLen[i]);
+        assert(msgs[i] != NULL);
+        BRMerkleBlockSerialize(block, msgs[i], msgsLen[i]);
+        BRMerkleBlockFree(block);
+    }
+
+    // the blocks aren't mined, so their parsed hashes are cleared to meet the target
+    start = _perfNow();
+    
+    for (i = 0; i < blockCount; i++) {
+        if (BRMerkleBlockViewParse(&view, msgs[i], msgsLen[i]) == 0) r = 0;
+        view.blockHash = UINT256_ZERO;
+        if (! BRMerkleBlockViewIsValid(&view, now, BLOCK_MAX_PROOF_OF_WORK)) r = 0;
+        n = BRMerkleBlockViewTxHashes(&view, found, txCount);
+    }
+    
+    separate = _perfNow() - start;
+    start = _perfNow();
+    
+    for (i = 0; i < blockCount; i++) {
+        if (BRMerkleBlockViewParse(&view, msgs[i], msgsLen[i]) == 0) r = 0;
+        view.blockHash = UINT256_ZERO;
+        if (! BRMerkleBlockViewIsValidTxHashes(&view, now, BLOCK_MAX_PROOF_OF_WORK, found2, txCount, &n2)) r = 0;
+    }
+    
+    single = _perfNow() - start;
+    
+    // compare the matched tx hashes of the last block
+    if (blockCount > 0 && (n != n2 || memcmp(found, found2, n*sizeof(*found)) != 0)) r = 0;
+    printf("BRMerkleBlock %6zu tx, %4zu matched: separate walks %8.1fns, single walk %8.1fns\n", txCount,
+           (blockCount > 0) ? n2 : 0, separate*1e9/blockCount, single*1e9/blockCount);
+
+    for (i = 0; i < blockCount; i++) free(msgs[i]);
+    free(msgsLen);
+    free(msgs);
+    free(matched);
+    free(found2);
+    free(found);
+    free(row);
+    free(txHashes);
+    return r;
+}
+
+// signs a transaction with inCount inputs using 1, 2, 4, ... up to maxThreads threads, printing the time taken for each
+// returns true if every parallel signing matched the serial signing byte-for-byte
+extern int BRRunPerfTestsSign (size_t inCount, size_t maxThreads) {
+    const char *phrase = "a random seed";
+    UInt512 seed;
+    BRBIP39DeriveKey(&seed, phrase, NULL);
+
+    BRMasterPubKey mpk = BRBIP32MasterPubKey(&seed, sizeof(seed));
+    BRWallet *wallet = BRWalletNew(BRMainNetParams->addrParams, NULL, 0, mpk);
+    size_t addrCount = BRWalletAllAddrs(wallet, NULL, 0);
+    BRAddress addrs[addrCount];
+    BRTransaction *tx = BRTransactionNew(), *ptx;
+    UInt256 inHash = UINT256_ZERO;
+    size_t len, plen, threads;
+    double start, serial = 0, elapsed;
+    int r = 1;
+
+    BRWalletAllAddrs(wallet, addrs, addrCount);
+
+    for (uint32_t i = 0; i < inCount; i++) { // inputs alternating between the wallet's P2PKH and P2WPKH addresses
+        BRAddress waddr = (i % 2) ? BRWalletAddressToLegacy(wallet, &addrs[i % addrCount]) : addrs[i % addrCount];
+        uint8_t script[BRAddressScriptPubKey(NULL, 0, BRMainNetParams->addrParams, waddr.s)];
+        size_t scriptLen = BRAddressScriptPubKey(script, sizeof(script), BRMainNetParams->addrParams, waddr.s);
+
+        UInt32SetLE(inHash.u8, i + 1);
+        BRTransactionAddInput(tx, inHash, i, 10000, script, scriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+    }
+
+    uint8_t outScript[BRAddressScriptPubKey(NULL, 0, BRMainNetParams->addrParams, addrs[0].s)];
+    size_t outScriptLen = BRAddressScriptPubKey(outScript, sizeof(outScript), BRMainNetParams->addrParams, addrs[0].s);
+
+    BRTransactionAddOutput(tx, 10000*inCount/2, outScript, outScriptLen);
+    ptx = BRTransactionCopy(tx);
+    start = ((double)clock())/CLOCKS_PER_SEC;
+    BRWalletSignTransaction(wallet, tx, 0x00, &seed, sizeof(seed));
+    serial = ((double)clock())/CLOCKS_PER_SEC - start;
+    printf("sign %zu inputs, serial: %f cpu-seconds\n", inCount, serial);
+
+    uint8_t buf[BRTransactionSerialize(tx, NULL, 0)];
+    len = BRTransactionSerialize(tx, buf, sizeof(buf));
+
+    for (threads = 1; threads <= maxThreads; threads *= 2) {
+        struct timeval tv0, tv1;
+        BRTransaction *t = BRTransactionCopy(ptx);
+
+        gettimeofday(&tv0, NULL);
+        BRWalletSignTransactionParallel(wallet, t, 0x00, &seed, sizeof(seed), threads);
+        gettimeofday(&tv1, NULL);
+        elapsed = (tv1.tv_sec - tv0.tv_sec) + (double)(tv1.tv_usec - tv0.tv_usec)/1000000;
+
+        uint8_t pbuf[BRTransactionSerialize(t, NULL, 0)];
+        plen = BRTransactionSerialize(t, pbuf, sizeof(pbuf));
+        if (plen != len || memcmp(pbuf, buf, len) != 0) r = 0;
+        printf("sign %zu inputs, %zu thread(s): %f seconds%s\n", inCount, threads, elapsed,
+               (plen != len || memcmp(pbuf, buf, len) != 0) ? " ***MISMATCH***" : "");
+        BRTransactionFree(t);
+    }
+
+    BRTransactionFree(ptx);
+    BRTransactionFree(tx);
+    BRWalletFree(wallet);
+    return r;
+}
+
+#define SIM_MAGIC_NUMBER 0xdab5bffa
+#define SIM_MAX_HEADERS  2000
+#define SIM_TARGET       0x207fffff // sim headers are mined at this trivial difficulty target
+
+// a synthetic chain of block headers served by loopback peers, for benchmarking chain sync offline
+typedef struct {
+    uint8_t *headers; // serialized 80 byte headers, indexed by height
+    UInt256 *hashes; // block hashes, indexed by height
+    BRSet *hashSet; // pointers into hashes, for looking up the height of a locator
+    uint32_t count;
+    useconds_t latency; // delay before answering each getheaders request, to simulate network round trip time
+    int connections;
+    pthread_mutex_t lock;
+    uint8_t **blocks; // serialized full blocks indexed by height, or NULL if block filters aren't served
+    size_t *blockLens;
+    uint8_t **filters; // serialized basic block filters, indexed by height
+    size_t *filterLens;
+    UInt256 *filterHeaders; // indexed by height
+    size_t blocksServed; // blocks sent in answer to getdata
+    uint8_t *transitionsSaved; // set for each difficulty transition block saved by the peer manager, if not NULL
+    size_t wrongBlocksSaved; // saved blocks that don't match the chain at their height
+} _BRSimChain;
+
+typedef struct {
+    _BRSimChain *chain;
+    int fd;
+} _BRSimConnection;
+
+static int _simSend(int fd, const char *type, const uint8_t *payload, size_t len)
+{
+    uint8_t msg[24 + len], hash[32];
+    size_t off = 0;
+    ssize_t n = 0;
+    int flags = 0;
+
+#ifdef MSG_NOSIGNAL
+    flags = MSG_NOSIGNAL;
+#endif
+    memset(msg, 0, 24);
+    UInt32SetLE(msg, SIM_MAGIC_NUMBER);
+    strncpy((char *)&msg[4], type, 12);
+    UInt32SetLE(&msg[16], (uint32_t)len);
+    BRSHA256_2(hash, payload, len);
+    memcpy(&msg[20], hash, 4);
+    if (len > 0) memcpy(&msg[24], payload, len);
+    while (n >= 0 && off < sizeof(msg)) n = send(fd, &msg[off], sizeof(msg) - off, flags), off += (n > 0) ? n : 0;
+    return (off == sizeof(msg));
+}
+
+static int _simRead(int fd, uint8_t *buf, size_t len)
+{
+    size_t off = 0;
+    ssize_t n = 1;
+
+    while (n > 0 && off < len) n = read(fd, &buf[off], len - off), off += (n > 0) ? n : 0;
+    return (off == len);
+}
+
+// answers a getheaders request with up to 2000 headers following the first known locator, ending at hashStop
+static int _simSendHeaders(_BRSimChain *chain, int fd, const uint8_t *msg, size_t len)
+{
+    size_t off = sizeof(uint32_t), l, count = (size_t)BRVarInt(&msg[off], len - off, &l), i, n = 0;
+    uint32_t start = 1, end;
+    UInt256 hashStop;
+
+    off += l;
+    if (off + (count + 1)*sizeof(UInt256) > len) return 0;
+
+    for (i = 0; i < count; i++) {
+        UInt256 locator = UInt256Get(&msg[off + i*sizeof(UInt256)]);
+        const UInt256 *hash = BRSetGet(chain->hashSet, &locator);
+
+        if (hash) start = (uint32_t)(hash - chain->hashes) + 1;
+        if (hash) break;
+    }
+
+    hashStop = UInt256Get(&msg[off + count*sizeof(UInt256)]);
+    end = (start + SIM_MAX_HEADERS < chain->count) ? start + SIM_MAX_HEADERS : chain->count;
+
+    for (uint32_t h = start; ! UInt256IsZero(hashStop) && h < end; h++) {
+        if (UInt256Eq(chain->hashes[h], hashStop)) end = h + 1;
+    }
+
+    uint8_t *buf = malloc(BRVarIntSize(end - start) + (end - start)*81);
+
+    assert(buf != NULL);
+    n = BRVarIntSet(buf, BRVarIntSize(end - start), end - start);
+
+    for (uint32_t h = start; h < end; h++) {
+        memcpy(&buf[n], &chain->headers[h*80], 80);
+        buf[n + 80] = 0; // tx count
+        n += 81;
+    }
+
+    usleep(chain->latency);
+    l = _simSend(fd, "headers", buf, n);
+    free(buf);
+    return (int)l;
+}
+
+// answers a getcfheaders or getcfilters request for the blocks from the start height through the one with stopHash
+static int _simSendFilters(_BRSimChain *chain, int fd, const uint8_t *msg, size_t len, int headers)
+{
+    UInt256 stopHash = (len >= 37) ? UInt256Get(&msg[5]) : UINT256_ZERO;
+    const UInt256 *hash = BRSetGet(chain->hashSet, &stopHash);
+    uint32_t start = (len >= 37) ? UInt32GetLE(&msg[1]) : 0, stop = (hash) ? (uint32_t)(hash - chain->hashes) : 0, h;
+    size_t n = 0;
+    int r = 1;
+
+    if (! chain->filters || ! hash || start == 0 || start > stop || stop - start >= ((headers) ? 2000 : 1000)) return 0;
+    usleep(chain->latency);
+
+    if (headers) {
+        uint8_t *buf = malloc(1 + 2*sizeof(UInt256) + 3 + (stop - start + 1)*sizeof(UInt256));
+
+        assert(buf != NULL);
+        buf[n++] = 0; // basic filter type
+        UInt256Set(&buf[n], stopHash);
+        n += sizeof(UInt256);
+        UInt256Set(&buf[n], chain->filterHeaders[start - 1]);
+        n += sizeof(UInt256);
+        n += BRVarIntSet(&buf[n], 3, stop - start + 1);
+
+        for (h = start; h <= stop; h++, n += sizeof(UInt256)) {
+            UInt256Set(&buf[n], BRBlockFilterHash(chain->filters[h], chain->filterLens[h]));
+        }
+
+        r = _simSend(fd, "cfheaders", buf, n);
+        free(buf);
+    }
+
+    for (h = start; ! headers && r && h <= stop; h++) {
+        uint8_t buf[1 + sizeof(UInt256) + 9 + chain->filterLens[h]];
+
+        n = 0;
+        buf[n++] = 0;
+        UInt256Set(&buf[n], chain->hashes[h]);
+        n += sizeof(UInt256);
+        n += BRVarIntSet(&buf[n], 9, chain->filterLens[h]);
+        memcpy(&buf[n], chain->filters[h], chain->filterLens[h]);
+        r = _simSend(fd, "cfilter", buf, n + chain->filterLens[h]);
+    }
+
+    return r;
+}
+
+// answers a getdata request with the blocks it asks for, other inventory types are ignored
+static int _simSendBlocks(_BRSimChain *chain, int fd, const uint8_t *msg, size_t len)
+{
+    size_t off = 0, l, count = (size_t)BRVarInt(msg, len, &l), i;
+    int r = 1;
+
+    off += l;
+    if (! chain->blocks || off + count*36 > len) return 0;
+
+    for (i = 0; r && i < count; i++, off += 36) {
+        UInt256 blockHash = UInt256Get(&msg[off + sizeof(uint32_t)]);
+        const UInt256 *hash = BRSetGet(chain->hashSet, &blockHash);
+
+        if (! hash || (UInt32GetLE(&msg[off]) & ~0x40000000) != 2) continue; // a block, with or without witness flag
+        pthread_mutex_lock(&chain->lock);
+        chain->blocksServed++;
+        pthread_mutex_unlock(&chain->lock);
+        r = _simSend(fd, "block", chain->blocks[hash - chain->hashes], chain->blockLens[hash - chain->hashes]);
+    }
+
+    return r;
+}
+
+static void *_simConnectionRoutine(void *arg)
+{
+    _BRSimConnection *conn = arg;
+    _BRSimChain *chain = conn->chain;
+    uint8_t hdr[24], version[86], *msg = NULL;
+    size_t len;
+    int r = 1;
+
+    memset(version, 0, sizeof(version));
+    UInt32SetLE(&version[0], 70013); // protocol version
+    UInt64SetLE(&version[4], SERVICES_NODE_NETWORK | SERVICES_NODE_BLOOM |
+                             ((chain->filters) ? SERVICES_NODE_COMPACT_FILTERS : 0));
+    UInt64SetLE(&version[12], (uint64_t)time(NULL));
+    UInt32SetLE(&version[81], chain->count - 1); // lastblock
+
+    while (r && _simRead(conn->fd, hdr, sizeof(hdr))) {
+        len = UInt32GetLE(&hdr[16]);
+        msg = realloc(msg, len + 1);
+        assert(msg != NULL);
+        r = _simRead(conn->fd, msg, len);
+
+        if (! r) break;
+        else if (strncmp((char *)&hdr[4], "version", 12) == 0) {
+            r = _simSend(conn->fd, "version", version, sizeof(version)) && _simSend(conn->fd, "verack", NULL, 0);
+        }
+        else if (strncmp((char *)&hdr[4], "ping", 12) == 0) r = _simSend(conn->fd, "pong", msg, len);
+        else if (strncmp((char *)&hdr[4], "getheaders", 12) == 0) r = _simSendHeaders(chain, conn->fd, msg, len);
+        else if (strncmp((char *)&hdr[4], "getcfheaders", 12) == 0) r = _simSendFilters(chain, conn->fd, msg, len, 1);
+        else if (strncmp((char *)&hdr[4], "getcfilters", 12) == 0) r = _simSendFilters(chain, conn->fd, msg, len, 0);
+        else if (strncmp((char *)&hdr[4], "getdata", 12) == 0) r = _simSendBlocks(chain, conn->fd, msg, len);
+    }
+
+    free(msg);
+    close(conn->fd);
+    free(conn);
+    pthread_mutex_lock(&chain->lock);
+    chain->connections--;
+    pthread_mutex_unlock(&chain->lock);
+    return NULL;
+}
+
+typedef struct {
+    _BRSimChain *chain;
+    int fd;
+    uint16_t port;
+    pthread_t thread;
+} _BRSimPeer;
+
+static void *_simAcceptRoutine(void *arg)
+{
+    _BRSimPeer *sim = arg;
+    int fd;
+
+    while ((fd = accept(sim->fd, NULL, NULL)) >= 0) {
+        _BRSimConnection *conn = calloc(1, sizeof(*conn));
+        pthread_t thread;
+
+        assert(conn != NULL);
+        conn->chain = sim->chain;
+        conn->fd = fd;
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &(int) { 1 }, sizeof(int));
+#endif
+        pthread_mutex_lock(&sim->chain->lock);
+        sim->chain->connections++;
+        pthread_mutex_unlock(&sim->chain->lock);
+
+        if (pthread_create(&thread, NULL, _simConnectionRoutine, conn) == 0) pthread_detach(thread);
+        else _simConnectionRoutine(conn);
+    }
+
+    return NULL;
+}
+
+// listens for loopback connections to chain on an ephemeral port, returns false on failure
+static int _simPeerStart(_BRSimPeer *sim, _BRSimChain *chain)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addrLen = sizeof(addr);
+    int r = 1;
+
+    sim->chain = chain;
+    sim->fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(sim->fd >= 0);
+    if (bind(sim->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(sim->fd, 8) != 0) r = 0;
+    getsockname(sim->fd, (struct sockaddr *)&addr, &addrLen);
+    sim->port = ntohs(addr.sin_port);
+    pthread_create(&sim->thread, NULL, _simAcceptRoutine, sim);
+    return r;
+}
+
+static void _simPeerStop(_BRSimPeer *sim)
+{
+    shutdown(sim->fd, SHUT_RDWR);
+    close(sim->fd);
+    pthread_join(sim->thread, NULL);
+}
+
+// waits for connections closed by the peer managers to finish, then frees the chain
+static void _simChainFree(_BRSimChain *chain)
+{
+    pthread_mutex_lock(&chain->lock);
+
+    while (chain->connections > 0) {
+        pthread_mutex_unlock(&chain->lock);
+        usleep(1000);
+        pthread_mutex_lock(&chain->lock);
+    }
+
+    pthread_mutex_unlock(&chain->lock);
+    pthread_mutex_destroy(&chain->lock);
+
+    for (uint32_t h = 0; chain->blocks && h < chain->count; h++) {
+        free(chain->blocks[h]);
+        free(chain->filters[h]);
+    }
+
+    free(chain->blocks);
+    free(chain->blockLens);
+    free(chain->filters);
+    free(chain->filterLens);
+    free(chain->filterHeaders);
+    free(chain->transitionsSaved);
+    BRSetFree(chain->hashSet);
+    free(chain->hashes);
+    free(chain->headers);
+}
+
+// the sim chain's difficulty target never changes
+static int _simVerifyDifficulty(const BRMerkleBlock *block, const BRSet *blockSet)
+{
+    return (block->target == SIM_TARGET);
+}
+
+// mines header at SIM_TARGET, where about half of all block hashes pass, and sets blockHash to its hash
+static void _simMine(uint8_t *header, UInt256 *blockHash)
+{
+    uint32_t nonce = 0;
+
+    do {
+        UInt32SetLE(&header[76], nonce++);
+        BRSHA256_2(blockHash, header, 80);
+    } while (blockHash->u8[sizeof(*blockHash) - 1] >= ((SIM_TARGET >> 16) & 0xff));
+}
+
+// checks the blocks the peer manager saves against chain, recording the difficulty transitions
+static void _simSaveBlocks(void *info, int replace, BRMerkleBlock *blocks[], size_t blocksCount)
+{
+    _BRSimChain *chain = info;
+
+    for (size_t i = 0; i < blocksCount; i++) {
+        uint32_t h = blocks[i]->height;
+
+        if (h >= chain->count || ! UInt256Eq(blocks[i]->blockHash, chain->hashes[h])) chain->wrongBlocksSaved++;
+        else if (chain->transitionsSaved && h % BLOCK_DIFFICULTY_INTERVAL == 0) {
+            chain->transitionsSaved[h/BLOCK_DIFFICULTY_INTERVAL] = 1;
+        }
+    }
+}
+
+// syncs a peer manager to the end of chain from the given loopback peer, returns the seconds taken, or -1 on timeout
+static double _simSync(const BRChainParams *params, _BRSimChain *chain, _BRSimPeer *sim)
+{
+    BRMerkleBlock *genesis = BRMerkleBlockParse(chain->headers, 80);
+    BRMasterPubKey mpk = BR_MASTER_PUBKEY_NONE;
+    UInt128 loopback = { .u8 = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 127, 0, 0, 1 } };
+    BRPeer peer = { loopback, sim->port, SERVICES_NODE_NETWORK, (uint64_t)time(NULL), 0 };
+    UInt512 seed;
+    double start, elapsed = -1;
+
+    BRBIP39DeriveKey(&seed, "a random seed", NULL);
+    mpk = BRBIP32MasterPubKey(&seed, sizeof(seed));
+    BRWallet *wallet = BRWalletNew(params->addrParams, NULL, 0, mpk);
+
+    genesis->height = 0; // start the sync from the genesis block rather than the last checkpoint
+    BRPeerManager *manager = BRPeerManagerNew(params, wallet, (uint32_t)time(NULL), &genesis, 1, &peer, 1);
+
+    BRPeerManagerSetCallbacks(manager, chain, NULL, NULL, NULL, _simSaveBlocks, NULL, NULL, NULL);
+    BRPeerManagerSetFixedPeer(manager, loopback, sim->port);
+    start = _perfNow();
+    BRPeerManagerConnect(manager);
+
+    while (_perfNow() - start < 60 && BRPeerManagerLastBlockHeight(manager) < chain->count - 2) usleep(1000);
+    if (BRPeerManagerLastBlockHeight(manager) >= chain->count - 2) elapsed = _perfNow() - start;
+    BRPeerManagerDisconnect(manager);
+    BRPeerManagerFree(manager);
+    BRWalletFree(wallet);
+    return elapsed;
+}
+
+// builds a chain of headerCount headers mined at a trivial target, and times syncing them from a loopback peer that
+// waits latency milliseconds before answering each getheaders request, which exercises the parallel validation of
+// headers messages and their batch commit to the chain
+// returns true if the sync reached the end of the chain, and every difficulty transition block was saved
+extern int BRRunPerfTestsHeaderSync (uint32_t headerCount, uint32_t latency) {
+    _BRSimChain chain = { NULL, NULL, NULL, headerCount + 2, latency*1000, 0 };
+    _BRSimPeer sim;
+    BRCheckPoint checkpoint;
+    BRChainParams params = *BRMainNetParams;
+    static const char *dnsSeeds[] = { NULL };
+    uint32_t now = (uint32_t)time(NULL), timestamp = now - 30*24*60*60 - headerCount*10*60, saved = 0,
+             // transitions in the last 100 blocks aren't saved until the merkleblocks after the headers are downloaded
+             transitions = (headerCount > 100) ? (headerCount - 100)/BLOCK_DIFFICULTY_INTERVAL : 0;
+    double elapsed;
+    int r = 1;
+
+    chain.headers = calloc(chain.count, 80);
+    chain.hashes = calloc(chain.count, sizeof(UInt256));
+    chain.hashSet = BRSetNew(_perfHashUInt256, _perfEqUInt256, chain.count);
+    chain.transitionsSaved = calloc(chain.count/BLOCK_DIFFICULTY_INTERVAL + 1, sizeof(*chain.transitionsSaved));
+    assert(chain.headers != NULL && chain.hashes != NULL && chain.transitionsSaved != NULL);
+    pthread_mutex_init(&chain.lock, NULL);
+
+    for (uint32_t h = 0; h < chain.count; h++) { // the last block is recent, so the chain ends where headers would
+        uint8_t *header = &chain.headers[h*80];
+        UInt256 merkleRoot;
+
+        BRSHA256(&merkleRoot, &h, sizeof(h));
+        UInt32SetLE(&header[0], 1); // version
+        UInt256Set(&header[4], (h > 0) ? chain.hashes[h - 1] : UINT256_ZERO);
+        UInt256Set(&header[36], merkleRoot);
+        UInt32SetLE(&header[68], (h + 1 < chain.count) ? timestamp + h*10*60 : now);
+        UInt32SetLE(&header[72], SIM_TARGET);
+        _simMine(header, &chain.hashes[h]);
+        BRSetAdd(chain.hashSet, &chain.hashes[h]);
+    }
+
+    checkpoint = (BRCheckPoint) { 0, UInt256Reverse(chain.hashes[0]), timestamp, SIM_TARGET };
+    params.dnsSeeds = dnsSeeds;
+    params.magicNumber = SIM_MAGIC_NUMBER;
+    params.services = SERVICES_NODE_NETWORK;
+    params.verifyDifficulty = _simVerifyDifficulty;
+    params.maxProofOfWork = SIM_TARGET;
+    params.checkpoints = &checkpoint;
+    params.checkpointsCount = 1;
+    if (! _simPeerStart(&sim, &chain)) r = 0;
+    params.standardPort = sim.port;
+
+    elapsed = (r) ? _simSync(&params, &chain, &sim) : -1;
+    for (uint32_t i = 1; i <= transitions; i++) saved += chain.transitionsSaved[i];
+    if (elapsed < 0 || saved != transitions || chain.wrongBlocksSaved > 0) r = 0;
+    printf("header sync %"PRIu32" headers, %"PRIu32"ms latency: %f seconds, %"PRIu32" of %"PRIu32" transition blocks "
+           "saved, %zu wrong blocks saved\n", headerCount, latency, elapsed, saved, transitions,
+           chain.wrongBlocksSaved);
+    _simPeerStop(&sim);
+    _simChainFree(&chain);
+    return r;
+}
+
+// serializes a sim tx spending output 0 of prevHash to script, and returns its hash
+static size_t _simTx(uint8_t *buf, size_t bufLen, UInt256 prevHash, const uint8_t *script, size_t scriptLen,
+                     UInt256 *txHash)
+{
+    BRTransaction *tx = BRTransactionNew();
+    uint8_t sig[] = { 0x04, 0xff, 0xff, 0x00, 0x1d }; // a signature placeholder
+    size_t len;
+
+    BRTransactionAddInput(tx, prevHash, 0, 0, NULL, 0, sig, sizeof(sig), NULL, 0, TXIN_SEQUENCE);
+    BRTransactionAddOutput(tx, 5000000000, script, scriptLen);
+    len = BRTransactionSerialize(tx, buf, bufLen);
+    BRSHA256_2(txHash, buf, len);
+    BRTransactionFree(tx);
+    return len;
+}
+
+// builds a chain of blockCount blocks, the last scanCount of them newer than the wallet's earliestKeyTime, paying the
+// next wallet address in every matchInterval'th of those, and times syncing it with BIP157/158 block filters from a
+// loopback peer serving canned filters
+// returns true if every payment was found, and only the blocks that paid the wallet were downloaded
+extern int BRRunPerfTestsFilterSync (uint32_t blockCount, uint32_t scanCount, uint32_t matchInterval) {
+    _BRSimChain chain = { NULL, NULL, NULL, blockCount, 0, 0 };
+    _BRSimPeer sim;
+    BRChainParams params = *BRMainNetParams;
+    static const char *dnsSeeds[] = { NULL };
+    uint32_t now = (uint32_t)time(NULL), timestamp = now - (blockCount - 1)*10*60, first = blockCount - scanCount,
+             earliestKeyTime = timestamp + first*10*60 + 7*24*60*60 - 2*60*60 - 1;
+    UInt128 loopback = { .u8 = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 127, 0, 0, 1 } };
+    BRAddress addrs[scanCount/matchInterval + 1];
+    BRCheckPoint checkpoint;
+    BRMasterPubKey mpk;
+    UInt512 seed;
+    size_t payments = 0, txCount = 0;
+    double start, elapsed = -1;
+    int r = 1;
+
+    assert(scanCount < blockCount && matchInterval > 0);
+    BRBIP39DeriveKey(&seed, "a random seed", NULL);
+    mpk = BRBIP32MasterPubKey(&seed, sizeof(seed));
+    BRWallet *wallet = BRWalletNew(params.addrParams, NULL, 0, mpk);
+
+    BRWalletUnusedAddrs(wallet, addrs, (uint32_t)(scanCount/matchInterval + 1), SEQUENCE_EXTERNAL_CHAIN);
+    chain.headers = calloc(chain.count, 80);
+    chain.hashes = calloc(chain.count, sizeof(UInt256));
+    chain.hashSet = BRSetNew(_perfHashUInt256, _perfEqUInt256, chain.count);
+    chain.blocks = calloc(chain.count, sizeof(*chain.blocks));
+    chain.blockLens = calloc(chain.count, sizeof(*chain.blockLens));
+    chain.filters = calloc(chain.count, sizeof(*chain.filters));
+    chain.filterLens = calloc(chain.count, sizeof(*chain.filterLens));
+    chain.filterHeaders = calloc(chain.count, sizeof(*chain.filterHeaders));
+    assert(chain.headers != NULL && chain.hashes != NULL && chain.blocks != NULL && chain.blockLens != NULL &&
+           chain.filters != NULL && chain.filterLens != NULL && chain.filterHeaders != NULL);
+    pthread_mutex_init(&chain.lock, NULL);
+
+    for (uint32_t h = 0; h < chain.count; h++) {
+        uint8_t *header = &chain.headers[h*80], txs[2][256], scripts[2][42] = { { 0x76, 0xa9, 0x14 } };
+        BRBlockFilterElement elems[2];
+        UInt256 txHashes[2], merkleRoot;
+        size_t txsLen[2] = { 0, 0 }, n = 0;
+
+        // every block has a tx paying someone else, and the blocks that pay the wallet one more tx spending it
+        BRSHA256(&merkleRoot, &h, sizeof(h));
+        memcpy(&scripts[0][3], &merkleRoot, 20);
+        memcpy(&scripts[0][23], "\x88\xac", 2);
+        elems[n] = (BRBlockFilterElement) { scripts[0], 25 };
+        txsLen[n] = _simTx(txs[n], sizeof(txs[n]), merkleRoot, scripts[0], 25, &txHashes[n]);
+        n++;
+
+        if (h > first && (h - first) % matchInterval == 0) {
+            elems[n].data = scripts[1];
+            elems[n].dataLen = BRAddressScriptPubKey(scripts[1], sizeof(scripts[1]), params.addrParams,
+                                                     addrs[payments++].s);
+            txsLen[n] = _simTx(txs[n], sizeof(txs[n]), txHashes[0], elems[n].data, elems[n].dataLen, &txHashes[n]);
+            n++;
+        }
+
+        if (n > 1) BRSHA256_2(&merkleRoot, txHashes, sizeof(txHashes));
+        else merkleRoot = txHashes[0];
+        UInt32SetLE(&header[0], 1); // version
+        UInt256Set(&header[4], (h > 0) ? chain.hashes[h - 1] : UINT256_ZERO);
+        UInt256Set(&header[36], merkleRoot);
+        UInt32SetLE(&header[68], timestamp + h*10*60);
+        UInt32SetLE(&header[72], SIM_TARGET);
+        _simMine(header, &chain.hashes[h]);
+        BRSetAdd(chain.hashSet, &chain.hashes[h]);
+
+        chain.blockLens[h] = 80 + 1 + txsLen[0] + ((n > 1) ? txsLen[1] : 0);
+        chain.blocks[h] = malloc(chain.blockLens[h]);
+        assert(chain.blocks[h] != NULL);
+        memcpy(chain.blocks[h], header, 80);
+        chain.blocks[h][80] = (uint8_t)n;
+        memcpy(&chain.blocks[h][81], txs[0], txsLen[0]);
+        if (n > 1) memcpy(&chain.blocks[h][81 + txsLen[0]], txs[1], txsLen[1]);
+
+        chain.filterLens[h] = BRBlockFilterBuild(NULL, 0, chain.hashes[h], elems, n);
+        chain.filters[h] = malloc(chain.filterLens[h]);
+        assert(chain.filters[h] != NULL);
+        BRBlockFilterBuild(chain.filters[h], chain.filterLens[h], chain.hashes[h], elems, n);
+        chain.filterHeaders[h] = BRBlockFilterHeader(BRBlockFilterHash(chain.filters[h], chain.filterLens[h]),
+                                                     (h > 0) ? chain.filterHeaders[h - 1] : UINT256_ZERO);
+    }
+
+    checkpoint = (BRCheckPoint) { 0, UInt256Reverse(chain.hashes[0]), timestamp, SIM_TARGET };
+    params.dnsSeeds = dnsSeeds;
+    params.magicNumber = SIM_MAGIC_NUMBER;
+    params.services = SERVICES_NODE_NETWORK;
+    params.verifyDifficulty = _simVerifyDifficulty;
+    params.maxProofOfWork = SIM_TARGET;
+    params.checkpoints = &checkpoint;
+    params.checkpointsCount = 1;
+    if (! _simPeerStart(&sim, &chain)) r = 0;
+    params.standardPort = sim.port;
+
+    BRPeer peer = { loopback, sim.port, SERVICES_NODE_NETWORK, now, 0 };
+    BRMerkleBlock *genesis = BRMerkleBlockParse(chain.headers, 80);
+
+    genesis->height = 0;
+    BRPeerManager *manager = BRPeerManagerNew(&params, wallet, earliestKeyTime, &genesis, 1, &peer, 1);
+
+    BRPeerManagerSetUseBlockFilters(manager, 1);
+    BRPeerManagerSetFixedPeer(manager, loopback, sim.port);
+    start = _perfNow();
+    if (r) BRPeerManagerConnect(manager);
+
+    while (r && _perfNow() - start < 60 && BRPeerManagerLastBlockHeight(manager) < chain.count - 1) usleep(1000);
+    if (BRPeerManagerLastBlockHeight(manager) >= chain.count - 1) elapsed = _perfNow() - start;
+    BRPeerManagerDisconnect(manager);
+    txCount = BRWalletTransactions(wallet, NULL, 0);
+
+    // besides the payments, only blocks with false positive filter matches for the wallet's scripts may be downloaded
+    size_t addrsCount = BRWalletAllAddrs(wallet, NULL, 0), matches = 0;
+    BRAddress *walletAddrs = calloc(addrsCount, sizeof(*walletAddrs));
+    uint8_t (*scripts)[42] = calloc(addrsCount, sizeof(*scripts));
+    BRBlockFilterElement *elems = calloc(addrsCount, sizeof(*elems));
+
+    assert(walletAddrs != NULL && scripts != NULL && elems != NULL);
+    addrsCount = BRWalletAllAddrs(wallet, walletAddrs, addrsCount);
+
+    for (size_t i = 0; i < addrsCount; i++) {
+        elems[i].data = scripts[i];
+        elems[i].dataLen = BRAddressScriptPubKey(scripts[i], sizeof(scripts[i]), params.addrParams, walletAddrs[i].s);
+    }
+
+    for (uint32_t h = first; h < chain.count; h++) {
+        if (BRBlockFilterMatchAny(chain.filters[h], chain.filterLens[h], chain.hashes[h], elems, addrsCount)) matches++;
+    }
+
+    if (elapsed < 0 || txCount != payments || chain.blocksServed < payments || chain.blocksServed > matches) r = 0;
+    printf("filter sync %"PRIu32" blocks, %"PRIu32" scanned: %f seconds, %zu of %zu payments found, %zu blocks "
+           "downloaded, %zu filters matched\n", chain.count - 1, scanCount, elapsed, txCount, payments,
+           chain.blocksServed, matches);
+    free(elems);
+    free(scripts);
+    free(walletAddrs);
+
+    BRPeerManagerFree(manager);
+    BRWalletFree(wallet);
+    _simPeerStop(&sim);
+    _simChainFree(&chain);
+    return r;
+}
+
 #ifndef BITCOIN_TEST_NO_MAIN
 void syncStarted(void *info)
 {
@@ -287,10 +287,8 @@ cryptoWalletManagerCreate (BRCryptoCWMListener listener,
 
             // Load transfers from persistent storage
             BRArrayOf(BRGenericTransfer) transfers = genManagerLoadTransfers (cwm->u.gen);
-            for (size_t index = 0; index < array_count (transfers); index++) {
-                // TODO: A BRGenericTransfer must allow us to determine the Wallet (via a Currency).
-                cryptoWalletManagerHandleTransferGEN (cwm, transfers[index]);
-            }
+            // TODO: A BRGenericTransfer must allow us to determine the Wallet (via a Currency).
+            cryptoWalletManagerHandleTransfersGEN (cwm, transfers);
             array_free (transfers);
 
             // Having added the transfers, get the wallet balance...
@@ -1373,8 +1371,9 @@ cryptoWalletManagerFindWalletAsGEN (BRCryptoWalletManager cwm,
     return wallet;
 }
 
-extern void
-cryptoWalletManagerHandleTransferGEN (BRCryptoWalletManager cwm,
+// Handle `transferGeneric` w/o saving it; return the generic transfer, now fully updated, to save.
+static BRGenericTransfer
+cryptoWalletManagerUpdateTransferGEN (BRCryptoWalletManager cwm,
                                       OwnershipGiven BRGenericTransfer transferGeneric) {
     int transferWasCreated = 0;
 
@@ -1431,8 +1430,8 @@ cryptoWalletManagerHandleTransferGEN (BRCryptoWalletManager cwm,
     if (!transferWasCreated)
         genTransferRelease(transferGeneric);
 
-    // Save the transfer as it is now fully updated.
-    genManagerSaveTransfer (cwm->u.gen, cryptoTransferAsGEN(transfer));
+    // The transfer is now fully updated; it is saved by our caller.
+    BRGenericTransfer transferToSave = cryptoTransferAsGEN(transfer);
 
     // If we created the transfer...
     if (transferWasCreated) {
@@ -1482,6 +1481,28 @@ cryptoWalletManagerHandleTransferGEN (BRCryptoWalletManager cwm,
     cryptoTransferGive(transfer);
     cryptoWalletGive (wallet);
     cryptoCurrencyGive(currency);
+
+    return transferToSave;
+}
+
+extern void
+cryptoWalletManagerHandleTransferGEN (BRCryptoWalletManager cwm,
+                                      OwnershipGiven BRGenericTransfer transferGeneric) {
+    genManagerSaveTransfer (cwm->u.gen, cryptoWalletManagerUpdateTransferGEN (cwm, transferGeneric));
+}
+
+extern void
+cryptoWalletManagerHandleTransfersGEN (BRCryptoWalletManager cwm,
+                                       OwnershipKept BRArrayOf(BRGenericTransfer) transfersGeneric) {
+    BRArrayOf(BRGenericTransfer) transfersToSave;
+    array_new (transfersToSave, array_count (transfersGeneric));
+
+    for (size_t index = 0; index < array_count (transfersGeneric); index++)
+        array_add (transfersToSave, cryptoWalletManagerUpdateTransferGEN (cwm, transfersGeneric[index]));
+
+    // Save together, once handled; the announcements above are not made within a DB transaction.
+    genManagerSaveTransfers (cwm->u.gen, transfersToSave);
+    array_free (transfersToSave);
 }
 
 extern const char *
@@ -1814,5 +1835,7 @@ cryptoSyncModeString (BRCryptoSyncMode m) {
         return "CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC";
         case CRYPTO_SYNC_MODE_P2P_ONLY:
         return "CRYPTO_SYNC_MODE_P2P_ONLY";
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
+        return "CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS";
     }
 }
@@ -1958,10 +1958,8 @@ cwmAnnounceGetTransactionsItem (OwnershipKept BRCryptoWalletManager cwm,
 
             if (transfers != NULL) {
                 pthread_mutex_lock (&cwm->lock);
-                for (size_t index = 0; index < array_count (transfers); index++) {
-                    // TODO: A BRGenericTransfer must allow us to determine the Wallet (via a Currency).
-                    cryptoWalletManagerHandleTransferGEN (cwm, transfers[index]);
-                }
+                // TODO: A BRGenericTransfer must allow us to determine the Wallet (via a Currency).
+                cryptoWalletManagerHandleTransfersGEN (cwm, transfers);
                 pthread_mutex_unlock (&cwm->lock);
 
                 // The wallet manager takes ownership of the actual transfers - so just
@@ -123,6 +123,14 @@ extern void
 cryptoWalletManagerHandleTransferGEN (BRCryptoWalletManager cwm,
                                       OwnershipGiven BRGenericTransfer transferGeneric);
 
+/**
+ * Handle each of `transfersGeneric`, taking ownership of the transfers but not the array, then
+ * save them all in a single DB transaction.
+ */
+extern void
+cryptoWalletManagerHandleTransfersGEN (BRCryptoWalletManager cwm,
+                                       OwnershipKept BRArrayOf(BRGenericTransfer) transfersGeneric);
+
 private_extern void
 cryptoWalletManagerSetTransferStateGEN (BRCryptoWalletManager cwm,
                                         BRCryptoWallet wallet,
@@ -155,15 +155,20 @@ ethAddressGetHash (BREthereumAddress address) {
 
 extern BREthereumAddress
 ethAddressRlpDecode (BRRlpItem item, BRRlpCoder coder) {
+    return ethAddressRlpDecodeView (rlpItemGetView (coder, item));
+}
+
+extern BREthereumAddress
+ethAddressRlpDecodeView (BRRlpView view) {
     BREthereumAddress address = EMPTY_ADDRESS_INIT;
 
-    BRRlpData data = rlpDecodeBytes(coder, item);
+    BRRlpData data = rlpViewDecodeBytesSharedDontRelease (view);
     if (0 != data.bytesCount) {
         assert (20 == data.bytesCount);
         memcpy (address.bytes, data.bytes, 20);
     }
 
-    rlpDataRelease(data);
+    // Safe to ignore data release.
     return address;
 }
 
@@ -173,6 +178,12 @@ ethAddressRlpEncode(BREthereumAddress address,
     return rlpEncodeBytes(coder, address.bytes, 20);
 }
 
+extern void
+ethAddressRlpWrite (BREthereumAddress address,
+                    BRRlpWriter writer) {
+    rlpWriterWriteBytes (writer, address.bytes, 20);
+}
+
 extern BREthereumBoolean
 ethAddressEqual (BREthereumAddress address1,
               BREthereumAddress address2) {
@@ -92,10 +92,17 @@ extern BREthereumAddress
 ethAddressRlpDecode (BRRlpItem item,
                      BRRlpCoder coder);
 
+extern BREthereumAddress
+ethAddressRlpDecodeView (BRRlpView view);
+
 extern BRRlpItem
 ethAddressRlpEncode(BREthereumAddress address,
                     BRRlpCoder coder);
 
+extern void
+ethAddressRlpWrite (BREthereumAddress address,
+                    BRRlpWriter writer);
+
 extern BREthereumBoolean
 ethAddressEqual (BREthereumAddress address1,
                  BREthereumAddress address2);
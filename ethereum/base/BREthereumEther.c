@@ -109,6 +109,11 @@ ethEtherRlpEncode (const BREthereumEther ether, BRRlpCoder coder) {
     return rlpEncodeUInt256(coder, ether.valueInWEI, 1);
 }
 
+extern void
+ethEtherRlpWrite (const BREthereumEther ether, BRRlpWriter writer) {
+    rlpWriterWriteUInt256 (writer, ether.valueInWEI, 1);
+}
+
 extern BREthereumEther
 ethEtherRlpDecode (BRRlpItem item, BRRlpCoder coder) {
     return ethEtherCreate(rlpDecodeUInt256(coder, item, 1));
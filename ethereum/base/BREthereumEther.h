@@ -102,6 +102,9 @@ ethEtherGetValueString(const BREthereumEther ether, BREthereumEtherUnit unit);
 extern BRRlpItem
 ethEtherRlpEncode (const BREthereumEther ether, BRRlpCoder coder);
 
+extern void
+ethEtherRlpWrite (const BREthereumEther ether, BRRlpWriter writer);
+
 extern BREthereumEther
 ethEtherRlpDecode (BRRlpItem item, BRRlpCoder coder);
     
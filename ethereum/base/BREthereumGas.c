@@ -35,6 +35,11 @@ ethGasRlpEncode (BREthereumGas gas, BRRlpCoder coder) {
     return rlpEncodeUInt64(coder, gas.amountOfGas, 1);
 }
 
+extern void
+ethGasRlpWrite (BREthereumGas gas, BRRlpWriter writer) {
+    rlpWriterWriteUInt64 (writer, gas.amountOfGas, 1);
+}
+
 extern BREthereumGas
 ethGasRlpDecode (BRRlpItem item, BRRlpCoder coder) {
     return ethGasCreate(rlpDecodeUInt64(coder, item, 1));
@@ -69,6 +74,11 @@ ethGasPriceRlpEncode (BREthereumGasPrice price, BRRlpCoder coder) {
     return ethEtherRlpEncode(price.etherPerGas, coder);
 }
 
+extern void
+ethGasPriceRlpWrite (BREthereumGasPrice price, BRRlpWriter writer) {
+    ethEtherRlpWrite (price.etherPerGas, writer);
+}
+
 extern BREthereumGasPrice
 ethGasPriceRlpDecode (BRRlpItem item, BRRlpCoder coder) {
     return ethGasPriceCreate(ethEtherRlpDecode(item, coder));
@@ -35,6 +35,9 @@ ethGasCompare (BREthereumGas e1, BREthereumGas e2);
 extern BRRlpItem
 ethGasRlpEncode (BREthereumGas gas, BRRlpCoder coder);
 
+extern void
+ethGasRlpWrite (BREthereumGas gas, BRRlpWriter writer);
+
 extern BREthereumGas
 ethGasRlpDecode (BRRlpItem item, BRRlpCoder coder);
 
@@ -77,6 +80,9 @@ ethGasPriceGetGasCost(BREthereumGasPrice price, BREthereumGas gas, int *overflow
 extern BRRlpItem
 ethGasPriceRlpEncode (BREthereumGasPrice price, BRRlpCoder coder);
 
+extern void
+ethGasPriceRlpWrite (BREthereumGasPrice price, BRRlpWriter writer);
+
 extern BREthereumGasPrice
 ethGasPriceRlpDecode (BRRlpItem item, BRRlpCoder coder);
     
@@ -89,13 +89,18 @@ ethHashRlpEncode(BREthereumHash hash, BRRlpCoder coder) {
 
 extern BREthereumHash
 ethHashRlpDecode (BRRlpItem item, BRRlpCoder coder) {
+    return ethHashRlpDecodeView (rlpItemGetView (coder, item));
+}
+
+extern BREthereumHash
+ethHashRlpDecodeView (BRRlpView view) {
     BREthereumHash hash;
 
-    BRRlpData data = rlpDecodeBytes(coder, item);
+    BRRlpData data = rlpViewDecodeBytesSharedDontRelease (view);
     assert (ETHEREUM_HASH_BYTES == data.bytesCount);
 
     memcpy (hash.bytes, data.bytes, ETHEREUM_HASH_BYTES);
-    rlpDataRelease(data);
+    // Safe to ignore data release.
 
     return hash;
 }
@@ -109,6 +114,19 @@ ethHashEncodeList (BRArrayOf (BREthereumHash) hashes, BRRlpCoder coder) {
     return rlpEncodeListItems (coder, items, itemCount);
 }
 
+extern void
+ethHashRlpWrite (BREthereumHash hash, BRRlpWriter writer) {
+    rlpWriterWriteBytes (writer, hash.bytes, ETHEREUM_HASH_BYTES);
+}
+
+extern void
+ethHashWriteList (BRArrayOf(BREthereumHash) hashes, BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+    for (size_t index = 0; index < array_count(hashes); index++)
+        ethHashRlpWrite (hashes[index], writer);
+    rlpWriterEndList (writer);
+}
+
 extern void
 ethHashFillString (BREthereumHash hash,
                    BREthereumHashString string) {
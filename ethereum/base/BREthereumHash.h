@@ -94,9 +94,18 @@ ethHashRlpEncode(BREthereumHash hash, BRRlpCoder coder);
 extern BREthereumHash
 ethHashRlpDecode (BRRlpItem item, BRRlpCoder coder);
 
+extern BREthereumHash
+ethHashRlpDecodeView (BRRlpView view);
+
 extern BRRlpItem
 ethHashEncodeList (BRArrayOf(BREthereumHash) hashes, BRRlpCoder coder);
 
+extern void
+ethHashRlpWrite (BREthereumHash hash, BRRlpWriter writer);
+
+extern void
+ethHashWriteList (BRArrayOf(BREthereumHash) hashes, BRRlpWriter writer);
+
 // BRSet Support
 inline static int
 ethHashSetValue (const BREthereumHash *hash) {
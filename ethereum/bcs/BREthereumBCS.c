@@ -36,6 +36,10 @@
 // We really can't set this limit; we've seen 15 before.  But, what about a rogue node?
 #define BCS_REORG_LIMIT    (10)
 
+// The number of threads, including the BCS thread, used to verify the Proof of Work of a batch
+// of headers.  Each header is a hashimoto computation of about a millisecond.
+#define BCS_POW_THREAD_COUNT   (4)
+
 #undef BCS_SHOW_ORPHANS
 
 #undef BCS_REPORT_IGNORED_ANNOUNCE
@@ -180,7 +184,8 @@ bcsCreate (BREthereumNetwork network,
            OwnershipGiven BRSetOf(BREthereumNodeConfig) peers,
            OwnershipGiven BRSetOf(BREthereumBlock) blocks,
            OwnershipGiven BRSetOf(BREthereumTransaction) transactions,
-           OwnershipGiven BRSetOf(BREthereumLog) logs) {
+           OwnershipGiven BRSetOf(BREthereumLog) logs,
+           const char *storagePath) {
 
     BREthereumBCS bcs = (BREthereumBCS) calloc (1, sizeof(struct BREthereumBCSStruct));
 
@@ -298,7 +303,11 @@ bcsCreate (BREthereumNetwork network,
                                bcs->les,
                                bcs->handler);
 
-    bcs->pow = proofOfWorkCreate();
+    // Anchor the PoW at the chain or, if newer, the latest checkpoint.
+    const BREthereumBlockCheckpoint *checkpoint = blockCheckpointLookupLatest (bcs->network);
+    bcs->pow = (blockGetNumber (bcs->chain) > checkpoint->number
+                ? proofOfWorkCreate (storagePath, blockGetNumber (bcs->chain), blockGetTimestamp (bcs->chain))
+                : proofOfWorkCreate (storagePath, checkpoint->number, checkpoint->timestamp));
 
     return bcs;
 }
@@ -399,6 +408,7 @@ bcsSyncRange (BREthereumBCS bcs,
             blockNumberStartAdjusted = maximum (blockNumberStart, blockNumberStop - SYNC_LINEAR_LIMIT + 1);
             break;
 
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             //
             // For a FULL_BLOCKCHAIN sync we run our 'N-Ary Search on Account Changes' algorithm
@@ -992,6 +1002,73 @@ bcsUnwindChain (BREthereumBCS bcs,
     bcsPendOrphanedTransactionsAndLogs (bcs);
 }
 
+static int
+bcsBlocksContain (BRArrayOf(BREthereumBlock) blocks,
+                  BREthereumBlock block) {
+    for (size_t index = 0; index < array_count (blocks); index++)
+        if (block == blocks[index]) return 1;
+    return 0;
+}
+
+/**
+ * Evict each block with a header that was accepted before its PoW could be computed and that has
+ * since failed, see proofOfWorkDefer(), along with every block chained from it.  A chained block
+ * is first unwound, with the blocks after it, into orphans; a block at or before
+ * `bcs->chainTail` has been saved and is kept.
+ */
+static void
+bcsEvictFailedPoW (BREthereumBCS bcs) {
+    BRArrayOf(BREthereumHash) hashes = proofOfWorkTakeFailed (bcs->pow);
+    if (NULL == hashes) return;
+
+    BRArrayOf(BREthereumBlock) evicted;
+    array_new (evicted, array_count (hashes));
+
+    for (size_t index = 0; index < array_count (hashes); index++) {
+        BREthereumBlock block = BRSetGet (bcs->blocks, &hashes[index]);
+        if (NULL == block || blockGetNumber (block) <= blockGetNumber (bcs->chainTail) ||
+            bcsBlocksContain (evicted, block)) continue;
+
+        eth_log ("BCS", "Block %" PRIu64 " Invalid (Deferred PoW)", blockGetNumber (block));
+
+        // If `block` is chained, unwind the chain through `block`
+        BREthereumBlock chained = bcs->chain;
+        while (NULL != chained && block != chained) chained = blockGetNext (chained);
+
+        if (NULL != chained) {
+            while (block != bcs->chain) {
+                BREthereumBlock next = blockGetNext (bcs->chain);
+                bcsMakeOrphan (bcs, bcs->chain);
+                bcs->chain = next;
+            }
+            bcs->chain = bcsMakeOrphan (bcs, block);
+        }
+
+        BRSetAdd (bcs->orphans, block);
+        array_add (evicted, block);
+    }
+    array_free (hashes);
+
+    // Every orphan chained from an evicted block is evicted too
+    for (size_t index = 0; index < array_count (evicted); index++) {
+        BREthereumHash hash = blockGetHash (evicted[index]);
+        FOR_SET (BREthereumBlock, orphan, bcs->orphans)
+            if (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (hash, blockHeaderGetParentHash (blockGetHeader (orphan)))) &&
+                !bcsBlocksContain (evicted, orphan))
+                array_add (evicted, orphan);
+    }
+
+    // Pend what was included in the evicted blocks, while they are still orphans, then reclaim
+    bcsPendOrphanedTransactionsAndLogs (bcs);
+
+    for (size_t index = 0; index < array_count (evicted); index++)
+        bcsReclaimBlock (bcs, evicted[index], 1);
+    array_free (evicted);
+
+    // Another block might now extend the chain
+    bcsChainThenPurgeOrphans (bcs);
+}
+
 static void
 bcsShowBlockForChain (BREthereumBCS bcs,
                       BREthereumBlock block,
@@ -1124,13 +1201,14 @@ bcsExtendChainIfPossible (BREthereumBCS bcs,
     BREthereumHash blockParentHash = blockHeaderGetParentHash(blockGetHeader(block));
     BREthereumBlock blockParent = BRSetGet(bcs->blocks, &blockParentHash);
 
-    // If we have a parent, but `header` is inconsistent with its parent, then ignore `header`
+    // If we have a parent, but `header` is inconsistent with its parent, then ignore `header`.
+    // The Proof of Work was checked as `header` arrived; see bcsHandleBlockHeaders().
     if (NULL != blockParent &&
         ETHEREUM_BOOLEAN_IS_FALSE (blockHeaderIsValid (blockGetHeader(block),
                                                        blockGetHeader(blockParent),
                                                        blockGetOmmersCount(blockParent),
                                                        blockGetHeader(bcs->genesis),
-                                                       bcs->pow))) {
+                                                       NULL))) {
 
         eth_log("BCS", "Block %" PRIu64 " Inconsistent", blockGetNumber(block));
         // TODO: Can we release `block`?
@@ -1375,8 +1453,24 @@ bcsHandleBlockHeaders (BREthereumBCS bcs,
     BRArrayOf(BREthereumHash) accountsHashes = NULL;
     BRArrayOf(uint64_t) proofNumbers = NULL;
 
-    for (size_t index = 0; index < array_count(headers); index++)
+    // First evict any blocks whose deferred PoW check has since failed.
+    bcsEvictFailedPoW (bcs);
+
+    // Check the Proof of Work for all `headers` at once, on multiple threads.  Headers from an
+    // epoch without a generated cache are deferred, and checked once the cache is generated in
+    // background; headers from an implausible, far-future epoch are invalid.
+    size_t headersCount = array_count(headers);
+    BREthereumBoolean *headersValid = calloc (headersCount > 0 ? headersCount : 1, sizeof (BREthereumBoolean));
+    blockHeadersAreValidPoW (headers, headersCount, bcs->pow, BCS_POW_THREAD_COUNT, headersValid);
+
+    for (size_t index = 0; index < headersCount; index++) {
         // Each `headers[index]` has 'OwnershipGiven'
+        if (ETHEREUM_BOOLEAN_IS_FALSE (headersValid[index])) {
+            eth_log("BCS", "Block %" PRIu64 " Invalid (PoW)", blockHeaderGetNumber(headers[index]));
+            blockHeaderRelease (headers[index]);
+            continue;
+        }
+
         bcsHandleBlockHeaderInternal (bcs, node,
                                       headers[index],
                                       isFromSync,
@@ -1384,6 +1478,8 @@ bcsHandleBlockHeaders (BREthereumBCS bcs,
                                       &receiptsHashes,
                                       &accountsHashes,
                                       &proofNumbers);
+    }
+    free (headersValid);
 
     array_free(headers);
 
@@ -1490,6 +1586,7 @@ static void
 bcsHandleBlockBody (BREthereumBCS bcs,
                     BREthereumNodeReference node,
                     BREthereumHash blockHash,
+                    BREthereumHash transactionsRoot,
                     OwnershipGiven BRArrayOf(BREthereumTransaction) transactions,
                     OwnershipGiven BRArrayOf(BREthereumBlockHeader) ommers) {
     // Ensure we have a Block
@@ -1513,6 +1610,17 @@ bcsHandleBlockBody (BREthereumBCS bcs,
     // We must be in a 'bodies needed' status
     assert (ETHEREUM_BOOLEAN_IS_TRUE(blockHasStatusTransactionsRequest(block, BLOCK_REQUEST_PENDING)));
 
+    // The transactions must be those committed to by the block's header; otherwise the node has
+    // sent a bogus body.  Flag the block as in error and don't look for transactions.
+    if (ETHEREUM_BOOLEAN_IS_FALSE (ethHashEqual (transactionsRoot,
+                                                 blockHeaderGetTransactionsRoot (blockGetHeader(block))))) {
+        eth_log ("BCS", "Block %" PRIu64 " Invalid (Bodies)", blockGetNumber(block));
+        blockReportStatusError (block, ETHEREUM_BOOLEAN_TRUE);
+        blockReportStatusTransactions (block, NULL);
+        bcsReleaseOmmersAndTransactionsFully(bcs, transactions, ommers);
+        return;
+    }
+
     eth_log("BCS", "Bodies %" PRIu64 " O:%2zu, T:%3zu",
             blockGetNumber(block),
             array_count(ommers),
@@ -1611,7 +1719,8 @@ bcsHandleBlockBodies (BREthereumBCS bcs,
                       OwnershipGiven BRArrayOf(BREthereumBlockBodyPair) pairs) {
     for (size_t index = 0; index < array_count(hashes); index++)
         // Transactions and Uncles have 'OwnershipGiven'
-        bcsHandleBlockBody (bcs, node, hashes[index], pairs[index].transactions, pairs[index].uncles);
+        bcsHandleBlockBody (bcs, node, hashes[index], pairs[index].transactionsRoot,
+                            pairs[index].transactions, pairs[index].uncles);
     array_free (hashes);
     array_free (pairs);
 }
@@ -1735,6 +1844,15 @@ bcsHandleTransactionReceipts (BREthereumBCS bcs,
     // We must be in a 'receipts needed' status
     assert (ETHEREUM_BOOLEAN_IS_TRUE(blockHasStatusLogsRequest(block, BLOCK_REQUEST_PENDING)));
 
+    // The receipts must be those committed to by the block's header; as for bodies, above.
+    if (ETHEREUM_BOOLEAN_IS_FALSE (blockReceiptsAreValid (block, receipts))) {
+        eth_log ("BCS", "Block %" PRIu64 " Invalid (Receipts)", blockGetNumber(block));
+        blockReportStatusError (block, ETHEREUM_BOOLEAN_TRUE);
+        blockReportStatusLogs (block, NULL);
+        bcsReleaseReceiptsFully(bcs, receipts);
+        return;
+    }
+
     eth_log("BCS", "Receipts %" PRIu64 " Count %zu",
             blockGetNumber(block),
             array_count(receipts));
@@ -2035,6 +2153,9 @@ bcsPeriodicDispatcher (BREventHandler handler,
     // TODO: Avoid-ish a race condition on bcsRelease. This is the wrong approach.
     if (NULL == bcs->les) return;
 
+    // Evict blocks whose deferred PoW check has since failed.
+    bcsEvictFailedPoW (bcs);
+
     // If nothing to do; simply skip out.
     if ((NULL == bcs->pendingTransactions || 0 == array_count (bcs->pendingTransactions)) &&
         (NULL == bcs->pendingLogs         || 0 == array_count (bcs->pendingLogs)))
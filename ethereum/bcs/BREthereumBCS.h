@@ -156,6 +156,8 @@ typedef struct {
  *
  * @parameters
  * @parameter headers - is this a BRArray; assume so for now.
+ * @parameter storagePath - the directory for the Proof of Work caches; if NULL the caches are
+ *    regenerated, rather than loaded, on each bcsCreate().
  */
 extern BREthereumBCS
 bcsCreate (BREthereumNetwork network,
@@ -165,7 +167,8 @@ bcsCreate (BREthereumNetwork network,
            BRSetOf(BREthereumNodeConfig) peers,
            BRSetOf(BREthereumBlock) blocks,
            BRSetOf(BREthereumTransaction) transactions,
-           BRSetOf(BREthereumLog) logs);
+           BRSetOf(BREthereumLog) logs,
+           const char *storagePath);
 
 extern void
 bcsStart (BREthereumBCS bcs);
@@ -13,6 +13,7 @@
 #include <assert.h>
 #include "support/BRArray.h"
 #include "ethereum/base/BREthereumLogic.h"
+#include "ethereum/mpt/BREthereumMPT.h"
 #include "BREthereumBlock.h"
 #include "BREthereumLog.h"
 
@@ -265,6 +266,16 @@ blockHeaderGetGasUsed (BREthereumBlockHeader header) {
     return header->gasUsed;
 }
 
+extern BREthereumHash
+blockHeaderGetTransactionsRoot (BREthereumBlockHeader header) {
+    return header->transactionsRoot;
+}
+
+extern BREthereumHash
+blockHeaderGetReceiptsRoot (BREthereumBlockHeader header) {
+    return header->receiptsRoot;
+}
+
 extern BREthereumHash
 blockHeaderGetMixHash (BREthereumBlockHeader header) {
     return header->mixHash;
@@ -457,17 +468,12 @@ blockHeaderValidateDifficulty (BREthereumBlockHeader this,
 static int
 blockHeaderValidatePoWMixHash (BREthereumBlockHeader this,
                                BREthereumHash mixHash) {
-    return (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (mixHash, EMPTY_HASH_INIT)) || // no POW
-            ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (mixHash, this->mixHash)));
+    return ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (mixHash, this->mixHash));
 }
 
 static int
 blockHeaderValidatePoWNFactor (BREthereumBlockHeader this,
                                UInt256 powNFactor) {
-
-    // Special case for no POW
-    if (1 == UInt256Eq (powNFactor, UINT256_ZERO)) return 1;
-
     // validate as n_factor <= 2^256 / difficulty
     //
     // We'll compute as: `n_factor * difficulty <= 2^256` and notice that 2^256 is the smallest
@@ -480,6 +486,21 @@ blockHeaderValidatePoWNFactor (BREthereumBlockHeader this,
     return 0 == overflow; /* || result == 2^256 */
 }
 
+static int
+blockHeaderValidatePoW (BREthereumBlockHeader this,
+                        UInt256 n,
+                        BREthereumHash m) {
+    return (blockHeaderValidatePoWMixHash (this, m) &&
+            blockHeaderValidatePoWNFactor (this, n));
+}
+
+extern BREthereumBoolean
+blockHeaderIsValidPoW (BREthereumBlockHeader header,
+                       UInt256 n,
+                       BREthereumHash m) {
+    return AS_ETHEREUM_BOOLEAN (blockHeaderValidatePoW (header, n, m));
+}
+
 static int
 blockHeaderValidateAll (BREthereumBlockHeader this,
                         BREthereumBlockHeader parent,
@@ -491,18 +512,24 @@ blockHeaderValidateAll (BREthereumBlockHeader this,
     UInt256 n = UINT256_ZERO;
     BREthereumHash m = EMPTY_HASH_INIT;
 
-    if (NULL != pow)
-        proofOfWorkCompute (pow, this, &n, &m);
+    // An implausible epoch is invalid; if the PoW can't be computed yet, defer it.
+    if (NULL != pow && ETHEREUM_BOOLEAN_IS_FALSE (proofOfWorkIsPlausible (pow, this))) return 0;
+
+    int computed = (NULL != pow &&
+                    ETHEREUM_BOOLEAN_IS_TRUE (proofOfWorkCompute (pow, this, &n, &m)));
+
+    int valid = (blockHeaderValidateTimestamp  (this, parent) &&
+                 blockHeaderValidateNumber     (this, parent) &&
+                 blockHeaderValidateGasLimit   (this, parent) &&
+                 blockHeaderValidateGasUsed    (this, parent) &&
+                 blockHeaderValidateExtraData  (this, parent) &&
+                 // TODO: Disabled, see CORE-203 (parentOmmersCount isn't correct if non-zero).
+                 // blockHeaderValidateDifficulty (this, parent, parentOmmersCount, genesis) &&
+                 (!computed || blockHeaderValidatePoW (this, n, m)));
 
-    return (blockHeaderValidateTimestamp  (this, parent) &&
-            blockHeaderValidateNumber     (this, parent) &&
-            blockHeaderValidateGasLimit   (this, parent) &&
-            blockHeaderValidateGasUsed    (this, parent) &&
-            blockHeaderValidateExtraData  (this, parent) &&
-            // TODO: Disabled, see CORE-203 (parentOmmersCount isn't correct if non-zero).
-            // blockHeaderValidateDifficulty (this, parent, parentOmmersCount, genesis) &&
-            (NULL == pow || blockHeaderValidatePoWMixHash (this, m)) &&
-            (NULL == pow || blockHeaderValidatePoWNFactor (this, n)));
+    if (valid && computed) proofOfWorkNoteVerified (pow, this);
+    if (valid && !computed && NULL != pow) proofOfWorkDefer (pow, this);
+    return valid;
 }
 
 extern BREthereumBoolean
@@ -526,6 +553,37 @@ blockHeaderIsValid (BREthereumBlockHeader header,
                                 blockHeaderValidateAll (header, parent, parentOmmersCount, genesis, pow));
 }
 
+extern void
+blockHeadersAreValidPoW (BREthereumBlockHeader *headers,
+                         size_t headersCount,
+                         BREthereumProofOfWork pow,
+                         size_t threadCount,
+                         BREthereumBoolean *valid) {
+    if (0 == headersCount) return;
+
+    UInt256           *ns       = calloc (headersCount, sizeof (UInt256));
+    BREthereumHash    *ms       = calloc (headersCount, sizeof (BREthereumHash));
+    BREthereumBoolean *computed = calloc (headersCount, sizeof (BREthereumBoolean));
+
+    proofOfWorkComputeMany (pow, headers, headersCount, ns, ms, computed, threadCount);
+
+    for (size_t index = 0; index < headersCount; index++) {
+        if (ETHEREUM_BOOLEAN_IS_FALSE (computed[index])) {
+            valid[index] = proofOfWorkIsPlausible (pow, headers[index]);
+            if (ETHEREUM_BOOLEAN_IS_TRUE (valid[index])) proofOfWorkDefer (pow, headers[index]);
+        }
+        else if (blockHeaderValidatePoW (headers[index], ns[index], ms[index])) {
+            proofOfWorkNoteVerified (pow, headers[index]);
+            valid[index] = ETHEREUM_BOOLEAN_TRUE;
+        }
+        else valid[index] = ETHEREUM_BOOLEAN_FALSE;
+    }
+
+    free (computed);
+    free (ms);
+    free (ns);
+}
+
 //
 // Block Header RLP Encode / Decode
 //
@@ -560,47 +618,82 @@ blockHeaderRlpEncode (BREthereumBlockHeader header,
     return rlpEncodeListItems(coder, items, itemsCount);
 }
 
+extern void
+blockHeaderRlpWrite (BREthereumBlockHeader header,
+                     BREthereumBoolean withNonce,
+                     BREthereumRlpType type,
+                     BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+
+    ethHashRlpWrite (header->parentHash, writer);
+    ethHashRlpWrite (header->ommersHash, writer);
+    ethAddressRlpWrite (header->beneficiary, writer);
+    ethHashRlpWrite (header->stateRoot, writer);
+    ethHashRlpWrite (header->transactionsRoot, writer);
+    ethHashRlpWrite (header->receiptsRoot, writer);
+    bloomFilterRlpWrite (header->logsBloom, writer);
+    rlpWriterWriteUInt256 (writer, header->difficulty, 0);
+    rlpWriterWriteUInt64 (writer, header->number, 0);
+    rlpWriterWriteUInt64 (writer, header->gasLimit, 0);
+    rlpWriterWriteUInt64 (writer, header->gasUsed, 0);
+    rlpWriterWriteUInt64 (writer, header->timestamp, 0);
+    rlpWriterWriteBytes (writer, header->extraData, header->extraDataCount);
+
+    if (ETHEREUM_BOOLEAN_IS_TRUE(withNonce)) {
+        ethHashRlpWrite (header->mixHash, writer);
+        rlpWriterWriteUInt64 (writer, header->nonce, 0);
+    }
+
+    rlpWriterEndList (writer);
+}
+
 extern BREthereumBlockHeader
 blockHeaderRlpDecode (BRRlpItem item,
                       BREthereumRlpType type,
                       BRRlpCoder coder) {
+    return blockHeaderRlpDecodeView (rlpItemGetView (coder, item), type);
+}
+
+extern BREthereumBlockHeader
+blockHeaderRlpDecodeView (BRRlpView view,
+                          BREthereumRlpType type) {
     BREthereumBlockHeader header = (BREthereumBlockHeader) calloc (1, sizeof(struct BREthereumBlockHeaderRecord));
 
-    size_t itemsCount = 0;
-    const BRRlpItem *items = rlpDecodeList(coder, item, &itemsCount);
+    BRRlpView items[15];
+    size_t itemsCount = rlpViewGetItems (view, items, 15);
     assert (13 == itemsCount || 15 == itemsCount);
 
     header->hash = ethHashCreateEmpty();
 
-    header->parentHash = ethHashRlpDecode(items[0], coder);
-    header->ommersHash = ethHashRlpDecode(items[1], coder);
-    header->beneficiary = ethAddressRlpDecode(items[2], coder);
-    header->stateRoot = ethHashRlpDecode(items[3], coder);
-    header->transactionsRoot = ethHashRlpDecode(items[4], coder);
-    header->receiptsRoot = ethHashRlpDecode(items[5], coder);
-    header->logsBloom = bloomFilterRlpDecode(items[6], coder);
-    header->difficulty = rlpDecodeUInt256(coder, items[7], 0);
-    header->number = rlpDecodeUInt64(coder, items[8], 0);
-    header->gasLimit = rlpDecodeUInt64(coder, items[9], 0);
-    header->gasUsed = rlpDecodeUInt64(coder, items[10], 0);
-    header->timestamp = rlpDecodeUInt64(coder, items[11], 0);
-
-    BRRlpData extraData = rlpDecodeBytes(coder, items[12]);
+    header->parentHash = ethHashRlpDecodeView(items[0]);
+    header->ommersHash = ethHashRlpDecodeView(items[1]);
+    header->beneficiary = ethAddressRlpDecodeView(items[2]);
+    header->stateRoot = ethHashRlpDecodeView(items[3]);
+    header->transactionsRoot = ethHashRlpDecodeView(items[4]);
+    header->receiptsRoot = ethHashRlpDecodeView(items[5]);
+    header->logsBloom = bloomFilterRlpDecodeView(items[6]);
+    header->difficulty = rlpViewDecodeUInt256(items[7]);
+    header->number = rlpViewDecodeUInt64(items[8]);
+    header->gasLimit = rlpViewDecodeUInt64(items[9]);
+    header->gasUsed = rlpViewDecodeUInt64(items[10]);
+    header->timestamp = rlpViewDecodeUInt64(items[11]);
+
+    BRRlpData extraData = rlpViewDecodeBytesSharedDontRelease(items[12]);
+    assert (extraData.bytesCount <= 32);
     memset (header->extraData, 0, 32);
     memcpy (header->extraData, extraData.bytes, extraData.bytesCount);
     header->extraDataCount = extraData.bytesCount;
-    rlpDataRelease(extraData);
 
     if (15 == itemsCount) {
-        header->mixHash = ethHashRlpDecode(items[13], coder);
-        header->nonce = rlpDecodeUInt64(coder, items[14], 0);
+        header->mixHash = ethHashRlpDecodeView(items[13]);
+        header->nonce = rlpViewDecodeUInt64(items[14]);
     }
 
 #if defined (BLOCK_HEADER_LOG_ALLOC_COUNT)
     eth_log ("MEM", "Block Header Create RLP: %d", ++blockHeaderAllocCount);
 #endif
 
-    BRRlpData data = rlpItemGetDataSharedDontRelease(coder, item);
+    BRRlpData data = rlpViewGetDataSharedDontRelease(view);
     header->hash = ethHashCreateFromData(data);
     // Safe to ignore data release.
 
@@ -793,14 +886,58 @@ blockGetTransactionMerkleRoot (BREthereumBlock block) {
 #endif
 
 static BREthereumHash
-blockGetTransactionTrieRoot (BREthereumBlock block) {
-    // TODO: Implement...
-    return block->header->transactionsRoot;  // assume correct.
+blockGetTransactionTrieRoot (BREthereumBlock block,
+                             BREthereumNetwork network) {
+    BRRlpWriter writer = rlpWriterCreate();
+    size_t count = blockGetTransactionsCount(block);
+
+    for (int pass = 0; pass < 2; pass++) {
+        if (1 == pass) rlpWriterBeginWriting (writer, NULL);
+        rlpWriterBeginList (writer);
+        for (size_t index = 0; index < count; index++)
+            transactionRlpWrite (block->transactions[index], network, RLP_TYPE_TRANSACTION_SIGNED, writer);
+        rlpWriterEndList (writer);
+    }
+    BRRlpData data = rlpWriterEndWriting (writer);
+    rlpWriterRelease (writer);
+
+    BREthereumHash root = mptGetRootFromListView (rlpDataGetView (data));
+    rlpDataRelease (data);
+
+    return root;
+}
+
+extern BREthereumBoolean
+blockTransactionsAreValid (BREthereumBlock block,
+                           BREthereumNetwork network) {
+    return ethHashEqual (block->header->transactionsRoot, blockGetTransactionTrieRoot (block, network));
+}
+
+static BREthereumHash
+blockGetReceiptTrieRoot (BRArrayOf(BREthereumTransactionReceipt) receipts) {
+    BRRlpWriter writer = rlpWriterCreate();
+    size_t count = (NULL == receipts ? 0 : array_count (receipts));
+
+    for (int pass = 0; pass < 2; pass++) {
+        if (1 == pass) rlpWriterBeginWriting (writer, NULL);
+        rlpWriterBeginList (writer);
+        for (size_t index = 0; index < count; index++)
+            transactionReceiptRlpWrite (receipts[index], writer);
+        rlpWriterEndList (writer);
+    }
+    BRRlpData data = rlpWriterEndWriting (writer);
+    rlpWriterRelease (writer);
+
+    BREthereumHash root = mptGetRootFromListView (rlpDataGetView (data));
+    rlpDataRelease (data);
+
+    return root;
 }
 
 extern BREthereumBoolean
-blockTransactionsAreValid (BREthereumBlock block) {
-    return (ethHashCompare(block->header->transactionsRoot, blockGetTransactionTrieRoot(block)));
+blockReceiptsAreValid (BREthereumBlock block,
+                       BRArrayOf(BREthereumTransactionReceipt) receipts) {
+    return ethHashEqual (block->header->receiptsRoot, blockGetReceiptTrieRoot (receipts));
 }
 
 extern unsigned long
@@ -999,6 +1136,40 @@ blockOmmersRlpDecode (BRRlpItem item,
     return headers;
 }
 
+extern BRArrayOf(BREthereumTransaction)
+blockTransactionsRlpDecodeView (BRRlpView view,
+                                BREthereumNetwork network,
+                                BREthereumRlpType type,
+                                BRRlpCoder coder) {
+    BRArrayOf(BREthereumTransaction) transactions;
+    array_new(transactions, rlpViewGetItemsCount (view));
+
+    for (BRRlpView itemView = rlpViewGetFirstItem (view);
+         !rlpViewIsEmpty (itemView);
+         itemView = rlpViewGetNextItem (view, itemView)) {
+        BRRlpItem item = rlpViewCreateItem (coder, itemView);
+        array_add (transactions, transactionRlpDecode (item, network, type, coder));
+        rlpItemRelease (coder, item);
+    }
+
+    return transactions;
+}
+
+extern BRArrayOf (BREthereumBlockHeader)
+blockOmmersRlpDecodeView (BRRlpView view,
+                          BREthereumNetwork network,
+                          BREthereumRlpType type) {
+    BRArrayOf (BREthereumBlockHeader) headers;
+    array_new(headers, rlpViewGetItemsCount (view));
+
+    for (BRRlpView itemView = rlpViewGetFirstItem (view);
+         !rlpViewIsEmpty (itemView);
+         itemView = rlpViewGetNextItem (view, itemView))
+        array_add (headers, blockHeaderRlpDecodeView (itemView, type));
+
+    return headers;
+}
+
 //
 // Block Encode
 //
@@ -15,6 +15,7 @@
 #include "ethereum/base/BREthereumBase.h"
 #include "BREthereumTransaction.h"
 #include "BREthereumLog.h"
+#include "BREthereumTransactionReceipt.h"
 #include "BREthereumAccountState.h"
 #include "BREthereumBloomFilter.h"
 
@@ -70,7 +71,9 @@ blockHeaderIsInternallyValid (BREthereumBlockHeader header);
 /**
  * Check if the block header is valid.  If `parent` is NULL, then `header` is consisder
  * consistent (we'll check again at some point once we have the parent).  If `pow` is provided
- * then ProofOfWork is computed and used in validity.
+ * then ProofOfWork is computed and used in validity - unless the cache for `header`'s epoch is
+ * not yet available, see proofOfWorkCompute().  A header with an implausible epoch, see
+ * proofOfWorkIsPlausible(), is invalid.
  *
  * @note Section 4.3.3 'Block Header Validity in https://ethereum.github.io/yellowpaper/paper.pdf
  *
@@ -89,17 +92,55 @@ blockHeaderIsValid (BREthereumBlockHeader header,
                     BREthereumBlockHeader genesis,
                     BREthereumProofOfWork pow);
 
+/**
+ * Check the ProofOfWork of each of `headers`, computing on up to `threadCount` threads, and set
+ * `valid[index]`.  As for blockHeaderIsValid(), a header is valid if the cache for its epoch is
+ * not yet available, but only if its epoch is plausible; such a header is deferred, see
+ * proofOfWorkDefer(), and checked once the cache is generated.
+ */
+extern void
+blockHeadersAreValidPoW (BREthereumBlockHeader *headers,
+                         size_t headersCount,
+                         BREthereumProofOfWork pow,
+                         size_t threadCount,
+                         BREthereumBoolean *valid);
+
+/**
+ * Check `header`'s ProofOfWork given its Ethash result `n` and mix digest `m`, as computed by
+ * proofOfWorkCompute().
+ */
+extern BREthereumBoolean
+blockHeaderIsValidPoW (BREthereumBlockHeader header,
+                       UInt256 n,
+                       BREthereumHash m);
+
 extern BREthereumBlockHeader
 blockHeaderRlpDecode (BRRlpItem item,
                       BREthereumRlpType type,
                       BRRlpCoder coder);
 
+/**
+ * Decode a header from a view, typically of a LES message frame, without creating RLP items.
+ */
+extern BREthereumBlockHeader
+blockHeaderRlpDecodeView (BRRlpView view,
+                          BREthereumRlpType type);
+
 extern BRRlpItem
 blockHeaderRlpEncode (BREthereumBlockHeader header,
                       BREthereumBoolean withNonce,
                       BREthereumRlpType type,
                       BRRlpCoder coder);
 
+/**
+ * RLP write header, as for blockHeaderRlpEncode(), but without creating RLP items.
+ */
+extern void
+blockHeaderRlpWrite (BREthereumBlockHeader header,
+                     BREthereumBoolean withNonce,
+                     BREthereumRlpType type,
+                     BRRlpWriter writer);
+
 extern BREthereumHash
 blockHeaderGetHash (BREthereumBlockHeader header);
 
@@ -118,6 +159,12 @@ blockHeaderGetTimestamp (BREthereumBlockHeader header);
 extern BREthereumHash
 blockHeaderGetParentHash (BREthereumBlockHeader header);
 
+extern BREthereumHash
+blockHeaderGetTransactionsRoot (BREthereumBlockHeader header);
+
+extern BREthereumHash
+blockHeaderGetReceiptsRoot (BREthereumBlockHeader header);
+
 extern BREthereumHash
 blockHeaderGetMixHash (BREthereumBlockHeader header);
 
@@ -219,8 +266,25 @@ blockGetTransactionsCount (BREthereumBlock block);
 extern BREthereumTransaction
 blockGetTransaction (BREthereumBlock block, size_t index);
 
+/**
+ * Check that the trie of `block`'s transactions, RLP encoded for `network`, has the header's
+ * transactionsRoot.
+ *
+ * Note: A transaction signed before EIP-155 re-encodes with an EIP-155 `v` and thus not as it
+ * was mined; for a body received from a peer use the `transactionsRoot` computed as the body
+ * was decoded (see BREthereumBlockBodyPair).
+ */
+extern BREthereumBoolean
+blockTransactionsAreValid (BREthereumBlock block,
+                           BREthereumNetwork network);
+
+/**
+ * Check that the trie of `receipts`, the transaction receipts for `block`, has the header's
+ * receiptsRoot.
+ */
 extern BREthereumBoolean
-blockTransactionsAreValid (BREthereumBlock block);
+blockReceiptsAreValid (BREthereumBlock block,
+                       BRArrayOf(BREthereumTransactionReceipt) receipts);
 
 extern unsigned long
 blockGetOmmersCount (BREthereumBlock block);
@@ -338,11 +402,13 @@ blockClrNext (BREthereumBlock block) {
 /// MARK: - Block Body Pair
 
 /**
- * A Block Body Pair ...
+ * A Block Body Pair ...  The `transactionsRoot` is the trie root of the transactions computed
+ * from their RLP encoding as received - to check against the block header's transactionsRoot.
  */
 typedef struct {
     BRArrayOf(BREthereumTransaction) transactions;
     BRArrayOf(BREthereumBlockHeader) uncles;
+    BREthereumHash transactionsRoot;
 } BREthereumBlockBodyPair;
 
 extern void
@@ -515,6 +581,20 @@ blockTransactionsRlpDecode (BRRlpItem item,
                             BREthereumRlpType type,
                             BRRlpCoder coder);
 
+extern BRArrayOf(BREthereumBlockHeader)
+blockOmmersRlpDecodeView (BRRlpView view,
+                          BREthereumNetwork network,
+                          BREthereumRlpType type);
+
+/**
+ * Transactions are decoded from RLP items; `coder` creates one small item per transaction.
+ */
+extern BRArrayOf(BREthereumTransaction)
+blockTransactionsRlpDecodeView (BRRlpView view,
+                                BREthereumNetwork network,
+                                BREthereumRlpType type,
+                                BRRlpCoder coder);
+
 /// MARK: - Genesis Blocks
 
 /**
@@ -569,22 +649,86 @@ blockFree (BREthereumBlock block);
 
 /// MARK: - Proof of Work
 
+/**
+ * Create a Proof of Work, verifying Ethash in 'light' mode from the per-epoch cache.  If `path`
+ * is not NULL, it is an existing directory into which each epoch's cache is saved, named by the
+ * epoch's seed hash, so as to be mapped, rather than regenerated, thereafter.
+ *
+ * The anchor block, given by `anchorNumber` and `anchorTimestamp`, is trusted - such as the chain
+ * head or a checkpoint.  It bounds the epoch of a plausible header, see proofOfWorkIsPlausible().
+ */
 extern BREthereumProofOfWork
-proofOfWorkCreate (void);
+proofOfWorkCreate (const char *path,
+                   uint64_t anchorNumber,
+                   uint64_t anchorTimestamp);
 
 extern void
 proofOfWorkRelease (BREthereumProofOfWork pow);
 
+/**
+ * Generate, in the calling thread, the cache for `header`'s epoch, if not already available.
+ */
 extern void
 proofOfWorkGenerate (BREthereumProofOfWork pow,
                      BREthereumBlockHeader header);
 
+/**
+ * Check if `header`'s epoch is plausible: no more than one past the epoch reached since the
+ * anchor block, at the fastest plausible block rate, or one past the newest verified epoch.  A
+ * header with an implausible epoch is invalid; its cache is never generated.
+ */
+extern BREthereumBoolean
+proofOfWorkIsPlausible (BREthereumProofOfWork pow,
+                        BREthereumBlockHeader header);
+
+/**
+ * Note that `header`'s PoW, as computed by proofOfWorkCompute(), has been verified.  Caches are
+ * thereafter not generated for epochs older than the one prior to `header`'s.
+ */
 extern void
+proofOfWorkNoteVerified (BREthereumProofOfWork pow,
+                         BREthereumBlockHeader header);
+
+/**
+ * Defer checking `header`, which was accepted without its PoW being computed, until the cache
+ * for its epoch is generated.  Only headers from an epoch whose cache will be generated are
+ * deferred.  A deferred header that then fails is reported by proofOfWorkTakeFailed().
+ */
+extern void
+proofOfWorkDefer (BREthereumProofOfWork pow,
+                  BREthereumBlockHeader header);
+
+/**
+ * Return the hashes of the deferred headers that have failed since the last call, or NULL if
+ * there are none.
+ */
+extern OwnershipGiven BRArrayOf(BREthereumHash)
+proofOfWorkTakeFailed (BREthereumProofOfWork pow);
+
+/**
+ * Compute the Ethash result `n` and mix digest `m` for `header`.  If the cache for `header`'s
+ * epoch is not available then return FALSE, without blocking, and start generating the cache
+ * in the background - but only for a plausible epoch no older than the one prior to the newest
+ * verified epoch.
+ */
+extern BREthereumBoolean
 proofOfWorkCompute (BREthereumProofOfWork pow,
                     BREthereumBlockHeader header,
                     UInt256 *n,
                     BREthereumHash *m);
 
+/**
+ * Compute as proofOfWorkCompute() for each of `headers` using up to `threadCount` threads
+ * (including the calling thread).  Sets `computed[index]` as proofOfWorkCompute() returns.
+ */
+extern void
+proofOfWorkComputeMany (BREthereumProofOfWork pow,
+                        BREthereumBlockHeader *headers,
+                        size_t headersCount,
+                        UInt256 *ns,
+                        BREthereumHash *ms,
+                        BREthereumBoolean *computed,
+                        size_t threadCount);
 
 #ifdef __cplusplus
 }
@@ -102,16 +102,26 @@ bloomFilterRlpEncode(BREthereumBloomFilter filter, BRRlpCoder coder) {
     return rlpEncodeBytes(coder, filter.bytes, 256);
 }
 
+extern void
+bloomFilterRlpWrite (BREthereumBloomFilter filter, BRRlpWriter writer) {
+    rlpWriterWriteBytes (writer, filter.bytes, 256);
+}
+
 extern BREthereumBloomFilter
 bloomFilterRlpDecode (BRRlpItem item, BRRlpCoder coder) {
+    return bloomFilterRlpDecodeView (rlpItemGetView (coder, item));
+}
+
+extern BREthereumBloomFilter
+bloomFilterRlpDecodeView (BRRlpView view) {
     BREthereumBloomFilter filter;
 
-    BRRlpData data = rlpDecodeBytes(coder, item);
+    BRRlpData data = rlpViewDecodeBytesSharedDontRelease (view);
     assert (256 == data.bytesCount);
 
     memcpy (filter.bytes, data.bytes, 256);
-    rlpDataRelease(data);
-    
+    // Safe to ignore data release.
+
     return filter;
 }
 
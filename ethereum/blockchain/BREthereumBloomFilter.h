@@ -102,9 +102,15 @@ bloomFilterMatch (const BREthereumBloomFilter filter, const BREthereumBloomFilte
 extern BRRlpItem
 bloomFilterRlpEncode(BREthereumBloomFilter filter, BRRlpCoder coder);
 
+extern void
+bloomFilterRlpWrite (BREthereumBloomFilter filter, BRRlpWriter writer);
+
 extern BREthereumBloomFilter
 bloomFilterRlpDecode (BRRlpItem item, BRRlpCoder coder);
 
+extern BREthereumBloomFilter
+bloomFilterRlpDecodeView (BRRlpView view);
+
 /**
  * Return a hex-encode string representation of `filter`.
  */
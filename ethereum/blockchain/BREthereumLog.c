@@ -108,15 +108,14 @@ logTopicAsAddress (BREthereumLogTopic topic) {
 // Support
 //
 static BREthereumLogTopic
-logTopicRlpDecode (BRRlpItem item,
-                       BRRlpCoder coder) {
+logTopicRlpDecode (BRRlpView view) {
     BREthereumLogTopic topic;
 
-    BRRlpData data = rlpDecodeBytes(coder, item);
+    BRRlpData data = rlpViewDecodeBytesSharedDontRelease (view);
     assert (32 == data.bytesCount);
 
     memcpy (topic.bytes, data.bytes, 32);
-    rlpDataRelease(data);
+    // Safe to ignore data release.
 
     return topic;
 }
@@ -428,16 +427,14 @@ logTopicsRlpEncode (BREthereumLog log,
 }
 
 static BREthereumLogTopic *
-logTopicsRlpDecode (BRRlpItem item,
-                    BRRlpCoder coder) {
-    size_t itemsCount = 0;
-    const BRRlpItem *items = rlpDecodeList(coder, item, &itemsCount);
-
+logTopicsRlpDecode (BRRlpView view) {
     BREthereumLogTopic *topics;
-    array_new(topics, itemsCount);
+    array_new(topics, rlpViewGetItemsCount (view));
 
-    for (int i = 0; i < itemsCount; i++) {
-        BREthereumLogTopic topic = logTopicRlpDecode(items[i], coder);
+    for (BRRlpView item = rlpViewGetFirstItem (view);
+         !rlpViewIsEmpty (item);
+         item = rlpViewGetNextItem (view, item)) {
+        BREthereumLogTopic topic = logTopicRlpDecode(item);
         array_add(topics, topic);
     }
 
@@ -448,29 +445,39 @@ extern BREthereumLog
 logRlpDecode (BRRlpItem item,
               BREthereumRlpType type,
               BRRlpCoder coder) {
+    return logRlpDecodeView (rlpItemGetView (coder, item), type, coder);
+}
+
+extern BREthereumLog
+logRlpDecodeView (BRRlpView view,
+                  BREthereumRlpType type,
+                  BRRlpCoder coder) {
     BREthereumLog log = (BREthereumLog) calloc (1, sizeof (struct BREthereumLogRecord));
 
-    size_t itemsCount = 0;
-    const BRRlpItem *items = rlpDecodeList(coder, item, &itemsCount);
+    BRRlpView items[6];
+    size_t itemsCount = rlpViewGetItems (view, items, 6);
     assert ((3 == itemsCount && RLP_TYPE_NETWORK == type) ||
             (6 == itemsCount && RLP_TYPE_ARCHIVE == type));
 
-    log->address = ethAddressRlpDecode(items[0], coder);
-    log->topics = logTopicsRlpDecode (items[1], coder);
+    log->address = ethAddressRlpDecodeView(items[0]);
+    log->topics = logTopicsRlpDecode (items[1]);
 
-    log->data = rlpItemGetData (coder, items[2]); //  rlpDecodeBytes(coder, items[2]);
+    log->data = rlpDataCopy (rlpViewGetDataSharedDontRelease (items[2])); //  rlpDecodeBytes(coder, items[2]);
 
     // 
     log->identifier.transactionReceiptIndex = LOG_TRANSACTION_RECEIPT_INDEX_UNKNOWN;
 
     if (RLP_TYPE_ARCHIVE == type) {
-        BREthereumHash hash = ethHashRlpDecode(items[3], coder);
+        BREthereumHash hash = ethHashRlpDecodeView(items[3]);
 
-        uint64_t transactionReceiptIndex = rlpDecodeUInt64(coder, items[4], 0);
+        uint64_t transactionReceiptIndex = rlpViewDecodeUInt64(items[4]);
         assert (transactionReceiptIndex <= (uint64_t) SIZE_MAX);
 
         logInitializeIdentifier (log, hash, (size_t) transactionReceiptIndex);
-        log->status = transactionStatusRLPDecode(items[5], NULL, coder);
+
+        BRRlpItem statusItem = rlpViewCreateItem (coder, items[5]);
+        log->status = transactionStatusRLPDecode(statusItem, NULL, coder);
+        rlpItemRelease (coder, statusItem);
     }
     return log;
 }
@@ -495,6 +502,30 @@ logRlpEncode(BREthereumLog log,
     return rlpEncodeListItems(coder, items, (RLP_TYPE_ARCHIVE == type ? 6 : 3));
 }
 
+extern void
+logRlpWrite (BREthereumLog log,
+             BREthereumRlpType type,
+             BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+
+    ethAddressRlpWrite (log->address, writer);
+
+    rlpWriterBeginList (writer);
+    for (size_t index = 0; index < array_count(log->topics); index++)
+        rlpWriterWriteBytes (writer, log->topics[index].bytes, 32);
+    rlpWriterEndList (writer);
+
+    rlpWriterWriteData (writer, log->data);  // already RLP encoded
+
+    if (RLP_TYPE_ARCHIVE == type) {
+        ethHashRlpWrite (log->identifier.transactionHash, writer);
+        rlpWriterWriteUInt64 (writer, log->identifier.transactionReceiptIndex, 0);
+        transactionStatusRLPWrite (log->status, writer);
+    }
+
+    rlpWriterEndList (writer);
+}
+
 /* Log (2) w/ LogTopic (3)
  ETH: LES-RECEIPTS:         L  2: [
  ETH: LES-RECEIPTS:           L  3: [
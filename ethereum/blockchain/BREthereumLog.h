@@ -163,6 +163,14 @@ extern BREthereumLog
 logRlpDecode (BRRlpItem item,
               BREthereumRlpType type,
               BRRlpCoder coder);
+
+/**
+ * Decode a log from a view.  The `coder` is only used for a RLP_TYPE_ARCHIVE status.
+ */
+extern BREthereumLog
+logRlpDecodeView (BRRlpView view,
+                  BREthereumRlpType type,
+                  BRRlpCoder coder);
 /**
  * [QUASI-INTERNAL - used by BREthereumBlock]
  */
@@ -171,6 +179,14 @@ logRlpEncode(BREthereumLog log,
              BREthereumRlpType type,
              BRRlpCoder coder);
 
+/**
+ * [QUASI-INTERNAL - used by BREthereumTransactionReceipt]
+ */
+extern void
+logRlpWrite (BREthereumLog log,
+             BREthereumRlpType type,
+             BRRlpWriter writer);
+
 extern void
 logRelease (BREthereumLog log);
 
@@ -9,9 +9,17 @@
 //  See the CONTRIBUTORS file at the project root for a list of contributors.
 
 #include <stdlib.h>
-#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "support/BRArray.h"
-#include "support/BRSet.h"
+#include "support/BRCrypto.h"
 #include "ethereum/rlp/BRRlp.h"
 #include "BREthereumBlock.h"
 
@@ -27,141 +35,833 @@
 #define POW_CACHE_ROUNDS          (3)
 #define POW_ACCESSES              (64)
 
+#define POW_HASH_WORDS            (POW_HASH_BYTES / POW_WORD_BYTES)     // 16
+#define POW_MIX_WORDS             (POW_MIX_BYTES  / POW_WORD_BYTES)     // 32
+
+// The caches for two epochs are kept; at an epoch boundary headers from both are common.
+#define POW_CACHES_COUNT          (2)
+
+// Cache generation checks for a 'quit' every so many items
+#define POW_QUIT_CHECK_ITEMS      (1 << 14)
+
+// The most threads used by proofOfWorkComputeMany()
+#define POW_MAX_THREADS           (16)
+
+// The most headers deferred until their epoch's cache is generated; beyond this the oldest
+// deferred header is dropped, unchecked.
+#define POW_DEFERRED_MAX          (4096)
+
+// The fewest seconds per block, on average, used to bound a plausible epoch from the anchor block.
+// Mainnet has never averaged less than 13 seconds.
+#define POW_PLAUSIBLE_BLOCK_SECONDS (10)
+
 //
-// Proof Of Work
+// Ethash, per https://github.com/ethereum/wiki/wiki/Ethash, in 'light' mode: the per-epoch cache
+// (16MB and up) is kept but the dataset (1GB and up) is never generated; each dataset item that
+// hashimoto accesses is computed from the cache.
 //
+// The cache and the mix are handled as arrays of 32-bit words, which are the little-endian
+// interpretation of the Keccak output bytes.  We assume a little-endian host, as does the rest
+// of Core, and use the bytes directly as words.
+//
+
+/// MARK: - Cache
+
+typedef struct {
+    uint64_t epoch;
+
+    /// The cache, as `itemsCount` items of POW_HASH_WORDS each
+    uint32_t *words;
+    size_t itemsCount;
+
+    /// The full dataset size, as needed by hashimoto, in bytes
+    uint64_t datasetSize;
+
+    /// If non-zero, `words` is mapped from a file
+    int mapped;
+
+    /// The cache is freed when unreferenced.  Protected by the ProofOfWork lock.
+    size_t references;
+} BREthereumPoWCache;
+
+static inline uint32_t
+powFNV (uint32_t v1, uint32_t v2) {
+    return (v1 * 0x01000193) ^ v2;
+}
+
+static int
+powIsPrime (uint64_t x) {
+    if (x < 2) return 0;
+    for (uint64_t d = 2; d * d <= x; d++)
+        if (0 == x % d) return 0;
+    return 1;
+}
+
+static uint64_t
+powCacheSize (uint64_t epoch) {
+    uint64_t size = POW_CACHE_INIT + POW_CACHE_GROWTH * epoch - POW_HASH_BYTES;
+    while (!powIsPrime (size / POW_HASH_BYTES))
+        size -= 2 * POW_HASH_BYTES;
+    return size;
+}
+
+static uint64_t
+powDatasetSize (uint64_t epoch) {
+    uint64_t size = (uint64_t) POW_DATA_SET_INIT + POW_DATA_SET_GROWTH * epoch - POW_MIX_BYTES;
+    while (!powIsPrime (size / POW_MIX_BYTES))
+        size -= 2 * POW_MIX_BYTES;
+    return size;
+}
+
+/**
+ * Compute the seed hash for `epoch`.  Returns 0 (leaving `seed` partially computed) if `quit`
+ * becomes set, otherwise 1.
+ */
+static int
+powSeedHash (uint64_t epoch, BREthereumHash *seed, volatile int *quit) {
+    memset (seed->bytes, 0, ETHEREUM_HASH_BYTES);
+
+    for (uint64_t index = 0; index < epoch; index++) {
+        if (0 == index % POW_QUIT_CHECK_ITEMS && *quit) return 0;
+        BRKeccak256 (seed->bytes, seed->bytes, ETHEREUM_HASH_BYTES);
+    }
+    return 1;
+}
+
+static char *
+powCacheFilename (const char *path, BREthereumHash seed) {
+    char seedHex[2 * ETHEREUM_HASH_BYTES + 1];
+    hexEncode (seedHex, sizeof (seedHex), seed.bytes, ETHEREUM_HASH_BYTES);
+
+    size_t filenameLength = strlen (path) + strlen ("/eth-ethash-") + strlen (seedHex) + 1;
+    char  *filename       = malloc (filenameLength);
+    sprintf (filename, "%s/eth-ethash-%s", path, seedHex);
+    return filename;
+}
+
+static void
+powCacheRelease (BREthereumPoWCache *cache) {
+    if (cache->mapped) munmap (cache->words, cache->itemsCount * POW_HASH_BYTES);
+    else free (cache->words);
+    free (cache);
+}
+
+/**
+ * Compute the cache words.  Returns 0 (leaving `words` partially computed) if `quit` becomes
+ * set, otherwise 1.
+ */
+static int
+powCacheCompute (uint32_t *words, size_t itemsCount, BREthereumHash seed, volatile int *quit) {
+    uint8_t *bytes = (uint8_t *) words;
+
+    // Sequentially hash the seed into the cache items
+    BRKeccak512 (bytes, seed.bytes, ETHEREUM_HASH_BYTES);
+    for (size_t index = 1; index < itemsCount; index++) {
+        if (0 == index % POW_QUIT_CHECK_ITEMS && *quit) return 0;
+        BRKeccak512 (&bytes[index * POW_HASH_BYTES], &bytes[(index - 1) * POW_HASH_BYTES], POW_HASH_BYTES);
+    }
+
+    // Then, for each of the cache rounds, run RandMemoHash over the items
+    for (size_t round = 0; round < POW_CACHE_ROUNDS; round++) {
+        for (size_t index = 0; index < itemsCount; index++) {
+            if (0 == index % POW_QUIT_CHECK_ITEMS && *quit) return 0;
+
+            uint32_t *item   = &words[index * POW_HASH_WORDS];
+            uint32_t *prior  = &words[((index + itemsCount - 1) % itemsCount) * POW_HASH_WORDS];
+            uint32_t *other  = &words[(item[0] % itemsCount) * POW_HASH_WORDS];
+
+            uint32_t temp[POW_HASH_WORDS];
+            for (size_t word = 0; word < POW_HASH_WORDS; word++)
+                temp[word] = prior[word] ^ other[word];
+
+            BRKeccak512 (item, temp, POW_HASH_BYTES);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Map the cache file, if it exists, has the expected size and ends with the expected tag.  The
+ * file is named by the seed hash and is never partially written, see powCacheSave().
+ */
+static uint32_t *
+powCacheLoad (const char *filename, BREthereumHash seed, size_t itemsCount) {
+    int fd = open (filename, O_RDONLY);
+    if (-1 == fd) return NULL;
+
+    // The cache rounds rewrite every item, item 0 included, so no single item is checkable
+    // without recomputing the cache; instead the file ends with keccak512(seed), written last.
+    uint8_t tag[POW_HASH_BYTES], tagExpected[POW_HASH_BYTES];
+    BRKeccak512 (tagExpected, seed.bytes, ETHEREUM_HASH_BYTES);
+
+    struct stat fileStat;
+    if (0 != fstat (fd, &fileStat) ||
+        (uint64_t) fileStat.st_size != (itemsCount + 1) * POW_HASH_BYTES ||
+        POW_HASH_BYTES != pread (fd, tag, POW_HASH_BYTES, (off_t) (itemsCount * POW_HASH_BYTES)) ||
+        0 != memcmp (tag, tagExpected, POW_HASH_BYTES)) {
+        close (fd);
+        return NULL;
+    }
+
+    void *bytes = mmap (NULL, itemsCount * POW_HASH_BYTES, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+
+    return (MAP_FAILED == bytes ? NULL : bytes);
+}
+
+/**
+ * Save the cache words, followed by the tag, into `filename`.  The words are written into a
+ * temporary file that is synced to disk and then renamed, so that a cache file is either
+ * complete or doesn't exist.
+ */
+static void
+powCacheSave (const char *filename, BREthereumHash seed, const uint32_t *words, size_t itemsCount) {
+    size_t tempFilenameLength = strlen (filename) + strlen (".tmp") + 1;
+    char  *tempFilename       = malloc (tempFilenameLength);
+    sprintf (tempFilename, "%s.tmp", filename);
+
+    uint8_t tag[POW_HASH_BYTES];
+    BRKeccak512 (tag, seed.bytes, ETHEREUM_HASH_BYTES);
+
+    FILE *file = fopen (tempFilename, "wb");
+    if (NULL != file) {
+        int saved = (itemsCount == fwrite (words, POW_HASH_BYTES, itemsCount, file) &&
+                     1 == fwrite (tag, POW_HASH_BYTES, 1, file) &&
+                     0 == fflush (file) &&
+                     0 == fsync (fileno (file)));
+        saved = (0 == fclose (file) && saved);
+
+        if (!saved || 0 != rename (tempFilename, filename))
+            remove (tempFilename);
+    }
+    free (tempFilename);
+}
+
+/**
+ * Remove every cache file in `path` other than those for `epochs`, including any temporary file
+ * left by an interrupted save.
+ */
+static void
+powCachePrune (const char *path, const uint64_t *epochs, size_t epochsCount, volatile int *quit) {
+    char  *kept[epochsCount];
+    size_t keptCount = 0;
+
+    for (; keptCount < epochsCount; keptCount++) {
+        BREthereumHash seed;
+        if (!powSeedHash (epochs[keptCount], &seed, quit)) break;
+        kept[keptCount] = powCacheFilename (path, seed);
+    }
+
+    DIR *dir = (keptCount == epochsCount ? opendir (path) : NULL);
+    if (NULL != dir) {
+        struct dirent *entry;
+        while (NULL != (entry = readdir (dir))) {
+            if (0 != strncmp (entry->d_name, "eth-ethash-", strlen ("eth-ethash-"))) continue;
+
+            char *filename = malloc (strlen (path) + 1 + strlen (entry->d_name) + 1);
+            sprintf (filename, "%s/%s", path, entry->d_name);
+
+            int keep = 0;
+            for (size_t index = 0; index < keptCount; index++)
+                if (0 == strcmp (filename, kept[index])) keep = 1;
+
+            if (!keep) remove (filename);
+            free (filename);
+        }
+        closedir (dir);
+    }
+
+    for (size_t index = 0; index < keptCount; index++)
+        free (kept[index]);
+}
+
+/**
+ * Create the cache for `epoch` - mapped from a file in `path`, if one exists, otherwise computed
+ * and then saved into `path`.  If `path` is NULL the cache is only computed.  Returns NULL if
+ * `quit` becomes set or if memory for the cache is not available.
+ */
+static BREthereumPoWCache *
+powCacheCreate (uint64_t epoch, const char *path, volatile int *quit) {
+    BREthereumHash seed;
+    if (!powSeedHash (epoch, &seed, quit)) return NULL;
+
+    size_t itemsCount   = (size_t) (powCacheSize (epoch) / POW_HASH_BYTES);
+    char  *filename     = (NULL == path ? NULL : powCacheFilename (path, seed));
+
+    uint32_t *words = (NULL == filename ? NULL : powCacheLoad (filename, seed, itemsCount));
+    int mapped = (NULL != words);
+
+    if (!mapped) {
+        words = malloc (itemsCount * POW_HASH_BYTES);
+
+        if (NULL == words || !powCacheCompute (words, itemsCount, seed, quit)) {
+            if (NULL != words)    free (words);
+            if (NULL != filename) free (filename);
+            return NULL;
+        }
+
+        if (NULL != filename) powCacheSave (filename, seed, words, itemsCount);
+    }
+    if (NULL != filename) free (filename);
+
+    BREthereumPoWCache *cache = malloc (sizeof (BREthereumPoWCache));
+    if (NULL == cache) {
+        if (mapped) munmap (words, itemsCount * POW_HASH_BYTES);
+        else free (words);
+        return NULL;
+    }
+
+    cache->epoch = epoch;
+    cache->words = words;
+    cache->itemsCount  = itemsCount;
+    cache->datasetSize = powDatasetSize (epoch);
+    cache->mapped = mapped;
+    cache->references = 0;
+
+    return cache;
+}
+
+/// MARK: - Hashimoto
+
+/**
+ * Compute the dataset item at `index` from `cache`.
+ */
+static void
+powDatasetItem (const BREthereumPoWCache *cache,
+                uint32_t index,
+                uint32_t item[POW_HASH_WORDS]) {
+    size_t itemsCount = cache->itemsCount;
+
+    memcpy (item, &cache->words[(index % itemsCount) * POW_HASH_WORDS], POW_HASH_BYTES);
+    item[0] ^= index;
+    BRKeccak512 (item, item, POW_HASH_BYTES);
+
+    for (uint32_t parent = 0; parent < POW_PARENTS; parent++) {
+        size_t parentIndex = powFNV (index ^ parent, item[parent % POW_HASH_WORDS]) % itemsCount;
+        const uint32_t *parentItem = &cache->words[parentIndex * POW_HASH_WORDS];
+
+        for (size_t word = 0; word < POW_HASH_WORDS; word++)
+            item[word] = powFNV (item[word], parentItem[word]);
+    }
+
+    BRKeccak512 (item, item, POW_HASH_BYTES);
+}
+
+/**
+ * Compute hashimoto for `header` from `cache`, filling the mix digest `m` and the result `n`.
+ */
+static void
+powHashimotoLight (const BREthereumPoWCache *cache,
+                   BREthereumBlockHeader header,
+                   UInt256 *n,
+                   BREthereumHash *m) {
+    // The header hash excludes the mixHash and nonce.
+    BRRlpWriter writer = rlpWriterCreate();
+    blockHeaderRlpWrite (header, ETHEREUM_BOOLEAN_FALSE, RLP_TYPE_NETWORK, writer);
+    rlpWriterBeginWriting (writer, NULL);
+    blockHeaderRlpWrite (header, ETHEREUM_BOOLEAN_FALSE, RLP_TYPE_NETWORK, writer);
+    BRRlpData data = rlpWriterEndWriting (writer);
+    rlpWriterRelease (writer);
+
+    // seed = keccak512 (headerHash ++ nonce), with nonce as 8 little-endian bytes
+    uint8_t  seedInput[ETHEREUM_HASH_BYTES + sizeof (uint64_t)];
+    uint32_t seed[POW_HASH_WORDS];
+
+    BRKeccak256 (seedInput, data.bytes, data.bytesCount);
+    rlpDataRelease (data);
+
+    uint64_t nonce = blockHeaderGetNonce (header);
+    memcpy (&seedInput[ETHEREUM_HASH_BYTES], &nonce, sizeof (uint64_t));
+    BRKeccak512 (seed, seedInput, sizeof (seedInput));
+
+    // mix = seed, replicated to POW_MIX_WORDS
+    uint32_t mix[POW_MIX_WORDS];
+    for (size_t word = 0; word < POW_MIX_WORDS; word++)
+        mix[word] = seed[word % POW_HASH_WORDS];
+
+    uint32_t pages = (uint32_t) (cache->datasetSize / POW_MIX_BYTES);
+
+    for (uint32_t access = 0; access < POW_ACCESSES; access++) {
+        uint32_t page = powFNV (access ^ seed[0], mix[access % POW_MIX_WORDS]) % pages;
+
+        // A page is POW_MIX_BYTES / POW_HASH_BYTES (2) consecutive dataset items
+        uint32_t data[POW_MIX_WORDS];
+        powDatasetItem (cache, 2 * page + 0, &data[0]);
+        powDatasetItem (cache, 2 * page + 1, &data[POW_HASH_WORDS]);
+
+        for (size_t word = 0; word < POW_MIX_WORDS; word++)
+            mix[word] = powFNV (mix[word], data[word]);
+    }
+
+    // Compress the mix into the mix digest
+    uint32_t cmix[POW_MIX_WORDS / 4];
+    for (size_t word = 0; word < POW_MIX_WORDS; word += 4)
+        cmix[word / 4] = powFNV (powFNV (powFNV (mix[word], mix[word + 1]), mix[word + 2]), mix[word + 3]);
+
+    memcpy (m->bytes, cmix, ETHEREUM_HASH_BYTES);
+
+    // result = keccak256 (seed ++ cmix), as a big-endian number
+    uint8_t resultInput[POW_HASH_BYTES + ETHEREUM_HASH_BYTES];
+    memcpy (&resultInput[0], seed, POW_HASH_BYTES);
+    memcpy (&resultInput[POW_HASH_BYTES], cmix, ETHEREUM_HASH_BYTES);
+
+    UInt256 result;
+    BRKeccak256 (result.u8, resultInput, sizeof (resultInput));
+    *n = UInt256Reverse (result);
+}
+
+/// MARK: - Proof Of Work
+
 struct BREthereumProofOfWorkStruct {
-    int foo;
+    /// The directory holding cache files; if NULL caches are not saved.
+    char *path;
+
+    /// The caches available, by epoch; a slot might be NULL.
+    BREthereumPoWCache *caches[POW_CACHES_COUNT];
+
+    /// The anchor block - a block trusted by the creator, such as the chain head or a checkpoint.
+    /// Headers with an epoch beyond that plausibly reached, since the anchor, are rejected.
+    uint64_t anchorNumber;
+    uint64_t anchorTimestamp;
+
+    /// The newest epoch of the anchor or of a header with verified PoW.  Caches are only
+    /// generated, in the background, for this epoch or later - not for historical headers.
+    uint64_t epochNewest;
+
+    /// Headers accepted before the cache for their epoch was available; each is checked once the
+    /// cache is installed.  The hashes of those that fail await proofOfWorkTakeFailed().
+    BRArrayOf(BREthereumBlockHeader) deferred;
+    BRArrayOf(BREthereumHash) failed;
+
+    /// The background cache generation thread.
+    pthread_t thread;
+    int threadRunning;
+    int threadJoinable;
+    uint64_t threadEpoch;
+    volatile int threadQuit;
+
+    pthread_mutex_t lock;
 };
 
 extern BREthereumProofOfWork
-proofOfWorkCreate (void) {
+proofOfWorkCreate (const char *path,
+                   uint64_t anchorNumber,
+                   uint64_t anchorTimestamp) {
     BREthereumProofOfWork pow = calloc (1, sizeof (struct BREthereumProofOfWorkStruct));
 
-    pow->foo = 0;
+    pow->path = (NULL == path ? NULL : strdup (path));
+    pow->anchorNumber    = anchorNumber;
+    pow->anchorTimestamp = anchorTimestamp;
+    pow->epochNewest = anchorNumber / POW_EPOCH;
+    array_new (pow->deferred, 100);
+    array_new (pow->failed, 10);
+    pow->threadRunning  = 0;
+    pow->threadJoinable = 0;
+    pow->threadQuit = 0;
+
+    {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL);
+
+        pthread_mutex_init(&pow->lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
 
     return pow;
 }
 
 extern void
 proofOfWorkRelease (BREthereumProofOfWork pow) {
+    // Stop any background generation
+    pthread_mutex_lock (&pow->lock);
+    pow->threadQuit = 1;
+    int joinable = pow->threadJoinable;
+    pthread_mutex_unlock (&pow->lock);
+
+    if (joinable) pthread_join (pow->thread, NULL);
+
+    for (size_t index = 0; index < POW_CACHES_COUNT; index++)
+        if (NULL != pow->caches[index])
+            powCacheRelease (pow->caches[index]);
+
+    blockHeadersRelease (pow->deferred);
+    array_free (pow->failed);
+
+    if (NULL != pow->path) free (pow->path);
+
+    pthread_mutex_destroy (&pow->lock);
     free (pow);
 }
 
-#if defined (INCLUDE_UNUSED_FUNCTIONS)
 static uint64_t
-powEpoch (BREthereumBlockHeader header) {
-    return blockHeaderGetNonce(header) / POW_EPOCH;
+proofOfWorkGetEpoch (BREthereumBlockHeader header) {
+    return blockHeaderGetNumber (header) / POW_EPOCH;
 }
 
+/// The newest plausible epoch: one past that reached, at the fastest plausible block rate, since
+/// the anchor block, or one past `epochNewest`.  Called with pow->lock held.
 static uint64_t
-powPrime (uint64_t x, uint64_t y) {
-    return (0 == x % y
-            ? x
-            : powPrime (x - 2 * y, y));
-}
+proofOfWorkGetEpochPlausible (BREthereumProofOfWork pow) {
+    uint64_t now     = (uint64_t) time (NULL);
+    uint64_t elapsed = (now > pow->anchorTimestamp ? now - pow->anchorTimestamp : 0);
+    uint64_t epoch   = (pow->anchorNumber + elapsed / POW_PLAUSIBLE_BLOCK_SECONDS) / POW_EPOCH;
 
-static uint64_t
-powDatasetSize (BREthereumBlockHeader header) {
-    return powPrime (POW_DATA_SET_INIT + POW_DATA_SET_GROWTH * powEpoch(header) - POW_MIX_BYTES,
-                     POW_MIX_BYTES);
+    return 1 + (epoch > pow->epochNewest ? epoch : pow->epochNewest);
 }
 
-static uint64_t
-powCacheSize (BREthereumBlockHeader header) {
-    return powPrime (POW_CACHE_INIT + POW_CACHE_GROWTH * powEpoch(header) - POW_HASH_BYTES,
-                     POW_HASH_BYTES);
-}
+extern BREthereumBoolean
+proofOfWorkIsPlausible (BREthereumProofOfWork pow,
+                        BREthereumBlockHeader header) {
+    pthread_mutex_lock (&pow->lock);
+    int plausible = proofOfWorkGetEpoch (header) <= proofOfWorkGetEpochPlausible (pow);
+    pthread_mutex_unlock (&pow->lock);
 
-static BREthereumHash
-powSeedHashInternal (uint64_t number) {
-    BREthereumHash bytes;
+    return AS_ETHEREUM_BOOLEAN (plausible);
+}
 
-    if (0 == number)
-        memset (bytes.bytes, 0, 32);
-    else
-        bytes = powSeedHashInternal(number - POW_EPOCH);
+extern void
+proofOfWorkNoteVerified (BREthereumProofOfWork pow,
+                         BREthereumBlockHeader header) {
+    uint64_t epoch = proofOfWorkGetEpoch (header);
 
-    return hashCreateFromData ((BRRlpData) { 32, bytes.bytes });
+    pthread_mutex_lock (&pow->lock);
+    if (epoch > pow->epochNewest) pow->epochNewest = epoch;
+    pthread_mutex_unlock (&pow->lock);
 }
 
-static BREthereumHash
-powSeedHash (BREthereumBlockHeader header) {
-    return powSeedHashInternal(blockHeaderGetNumber(header));
+/// Return the cache for `epoch`, with a reference, or NULL.  Called with pow->lock held.
+static BREthereumPoWCache *
+proofOfWorkFindCache (BREthereumProofOfWork pow, uint64_t epoch) {
+    for (size_t index = 0; index < POW_CACHES_COUNT; index++) {
+        BREthereumPoWCache *cache = pow->caches[index];
+        if (NULL != cache && epoch == cache->epoch) {
+            cache->references += 1;
+            return cache;
+        }
+    }
+    return NULL;
 }
 
-static BREthereumData
-powLittleRMH (BREthereumData x, uint64_t i, uint64_t n) {
-    return x;
+/// Called with pow->lock held.
+static void
+proofOfWorkReleaseCache (BREthereumProofOfWork pow, BREthereumPoWCache *cache) {
+    assert (cache->references > 0);
+    cache->references -= 1;
+
+    // Release if unreferenced and no longer in a slot.
+    if (0 == cache->references) {
+        for (size_t index = 0; index < POW_CACHES_COUNT; index++)
+            if (cache == pow->caches[index]) return;
+        powCacheRelease (cache);
+    }
 }
 
-static BREthereumData
-powBigRMH (BREthereumData x, uint64_t n) {
-    for (uint64_t i = 0; i < n; i++)
-        powLittleRMH(x, i, n);
-    return x;
+/// Install `cache`, replacing the cache for the oldest epoch.  Called with pow->lock held.
+static void
+proofOfWorkInstallCache (BREthereumProofOfWork pow, BREthereumPoWCache *cache) {
+    size_t slot = 0;
+
+    for (size_t index = 0; index < POW_CACHES_COUNT; index++) {
+        BREthereumPoWCache *existing = pow->caches[index];
+
+        // Already have this epoch; keep the existing one.
+        if (NULL != existing && cache->epoch == existing->epoch) {
+            powCacheRelease (cache);
+            return;
+        }
+
+        // Prefer an empty slot, otherwise the slot with the oldest epoch.
+        if (NULL != pow->caches[slot] &&
+            (NULL == existing || existing->epoch < pow->caches[slot]->epoch))
+            slot = index;
+    }
+
+    BREthereumPoWCache *replaced = pow->caches[slot];
+    pow->caches[slot] = cache;
+
+    // A referenced cache is released by proofOfWorkReleaseCache()
+    if (NULL != replaced && 0 == replaced->references)
+        powCacheRelease (replaced);
 }
 
-static BREthereumData
-powCacheRounds (BREthereumData x, uint64_t y, uint64_t n) {
-    return (0 == y
-            ? x
-            : (1 == y
-               ? powBigRMH (x, n)
-               : powCacheRounds (powBigRMH (x, n), y - 1, n)));
+/// Check the deferred `header` with `cache`, noting it if verified and its hash if not.
+static void
+proofOfWorkCheckDeferred (BREthereumProofOfWork pow,
+                          BREthereumPoWCache *cache,
+                          BREthereumBlockHeader header) {
+    UInt256 n;
+    BREthereumHash m;
+
+    powHashimotoLight (cache, header, &n, &m);
+
+    if (ETHEREUM_BOOLEAN_IS_TRUE (blockHeaderIsValidPoW (header, n, m)))
+        proofOfWorkNoteVerified (pow, header);
+    else {
+        pthread_mutex_lock (&pow->lock);
+        array_add (pow->failed, blockHeaderGetHash (header));
+        pthread_mutex_unlock (&pow->lock);
+    }
 }
 
+/// Check the deferred headers from `epoch`, whose cache has been installed, and drop those from
+/// an epoch whose cache will no longer be generated.
 static void
-powBigFNV (BREthereumData x,
-           BREthereumData y) {
+proofOfWorkCheckDeferredForEpoch (BREthereumProofOfWork pow, uint64_t epoch) {
+    BRArrayOf(BREthereumBlockHeader) headers;
+    array_new (headers, 10);
+
+    pthread_mutex_lock (&pow->lock);
+    BREthereumPoWCache *cache = proofOfWorkFindCache (pow, epoch);
+    for (size_t index = array_count (pow->deferred); index > 0; index--) {
+        BREthereumBlockHeader header = pow->deferred[index - 1];
+        uint64_t headerEpoch = proofOfWorkGetEpoch (header);
+
+        if ((NULL != cache && epoch == headerEpoch) || headerEpoch + 1 < pow->epochNewest) {
+            array_rm (pow->deferred, index - 1);
+            if (epoch == headerEpoch) array_add (headers, header);
+            else blockHeaderRelease (header);
+        }
+    }
+    pthread_mutex_unlock (&pow->lock);
+
+    for (size_t index = 0; index < array_count (headers); index++)
+        proofOfWorkCheckDeferred (pow, cache, headers[index]);
+    blockHeadersRelease (headers);
+
+    if (NULL != cache) {
+        pthread_mutex_lock (&pow->lock);
+        proofOfWorkReleaseCache (pow, cache);
+        pthread_mutex_unlock (&pow->lock);
+    }
 }
 
-static BREthereumData
-powMix (BREthereumData m,
-        BREthereumData c,
-        uint64_t i,
-        uint64_t p) {
-    return (0 == p
-            ? m
-            : m);
+/// Remove the cache files other than those of the installed caches and of one being generated.
+static void
+proofOfWorkPruneCacheFiles (BREthereumProofOfWork pow, volatile int *quit) {
+    uint64_t epochs[POW_CACHES_COUNT + 1];
+    size_t   epochsCount = 0;
+
+    if (NULL == pow->path) return;
+
+    pthread_mutex_lock (&pow->lock);
+    for (size_t index = 0; index < POW_CACHES_COUNT; index++)
+        if (NULL != pow->caches[index])
+            epochs[epochsCount++] = pow->caches[index]->epoch;
+    if (pow->threadRunning)
+        epochs[epochsCount++] = pow->threadEpoch;
+    pthread_mutex_unlock (&pow->lock);
+
+    powCachePrune (pow->path, epochs, epochsCount, quit);
 }
 
-static BREthereumData
-powParents (BREthereumData c,
-            uint64_t i,
-            uint64_t p,
-            BREthereumData m) {
-    return (p < POW_PARENTS - 1
-            ? powParents(c, i, p + 1, powMix (m, c, i, p + 1))
-            : powMix (m, c, i, p + 1));
+static void *
+proofOfWorkGenerateThread (BREthereumProofOfWork pow) {
+    uint64_t epoch = pow->threadEpoch;
+    BREthereumPoWCache *cache = powCacheCreate (epoch, pow->path, &pow->threadQuit);
+
+    pthread_mutex_lock (&pow->lock);
+    if (NULL != cache) proofOfWorkInstallCache (pow, cache);
+    pow->threadRunning = 0;
+    pthread_mutex_unlock (&pow->lock);
+
+    if (NULL != cache) {
+        proofOfWorkCheckDeferredForEpoch (pow, epoch);
+        proofOfWorkPruneCacheFiles (pow, &pow->threadQuit);
+    }
+
+    return NULL;
 }
 
-static BREthereumData
-powDatasetItem (BREthereumData c,
-                uint64_t i) {
-    return powParents(c, i, -i, (BREthereumData) { 0, NULL });
+/// Start generating the cache for `epoch` unless already generating.  Called with pow->lock held.
+static void
+proofOfWorkGenerateInBackground (BREthereumProofOfWork pow, uint64_t epoch) {
+    if (pow->threadRunning || pow->threadQuit) return;
+
+    // Join the prior, completed, thread
+    if (pow->threadJoinable) {
+        pthread_join (pow->thread, NULL);
+        pow->threadJoinable = 0;
+    }
+
+    pow->threadEpoch = epoch;
+    if (0 == pthread_create (&pow->thread, NULL, (void* (*) (void*)) proofOfWorkGenerateThread, pow)) {
+        pow->threadRunning  = 1;
+        pow->threadJoinable = 1;
+    }
 }
-// On and On and On....
-#endif
 
 extern void
-proofOfWorkGenerate(BREthereumProofOfWork pow,
-                       BREthereumBlockHeader header) {
-    //
+proofOfWorkGenerate (BREthereumProofOfWork pow,
+                     BREthereumBlockHeader header) {
+    uint64_t epoch = proofOfWorkGetEpoch (header);
+
+    pthread_mutex_lock (&pow->lock);
+    BREthereumPoWCache *cache = proofOfWorkFindCache (pow, epoch);
+    if (NULL != cache) proofOfWorkReleaseCache (pow, cache);
+    pthread_mutex_unlock (&pow->lock);
+
+    if (NULL != cache) return;
+
+    int quit = 0;
+    cache = powCacheCreate (epoch, pow->path, &quit);
+    if (NULL == cache) return;
+
+    pthread_mutex_lock (&pow->lock);
+    proofOfWorkInstallCache (pow, cache);
+    pthread_mutex_unlock (&pow->lock);
+
+    proofOfWorkCheckDeferredForEpoch (pow, epoch);
+    proofOfWorkPruneCacheFiles (pow, &quit);
 }
 
 extern void
-proofOfWorkCompute (BREthereumProofOfWork pow,
-                       BREthereumBlockHeader header,
-                       UInt256 *n,
-                       BREthereumHash *m) {
+proofOfWorkDefer (BREthereumProofOfWork pow,
+                  BREthereumBlockHeader header) {
+    uint64_t epoch = proofOfWorkGetEpoch (header);
+
+    pthread_mutex_lock (&pow->lock);
+    BREthereumPoWCache *cache = proofOfWorkFindCache (pow, epoch);
+
+    // Only an epoch whose cache will be generated; see proofOfWorkComputeInternal().
+    if (NULL == cache && epoch + 1 >= pow->epochNewest) {
+        if (POW_DEFERRED_MAX == array_count (pow->deferred)) {
+            blockHeaderRelease (pow->deferred[0]);
+            array_rm (pow->deferred, 0);
+        }
+        array_add (pow->deferred, blockHeaderCopy (header));
+    }
+    pthread_mutex_unlock (&pow->lock);
+
+    // The cache was installed after `header` was computed; check it now.
+    if (NULL != cache) {
+        proofOfWorkCheckDeferred (pow, cache, header);
+
+        pthread_mutex_lock (&pow->lock);
+        proofOfWorkReleaseCache (pow, cache);
+        pthread_mutex_unlock (&pow->lock);
+    }
+}
+
+extern OwnershipGiven BRArrayOf(BREthereumHash)
+proofOfWorkTakeFailed (BREthereumProofOfWork pow) {
+    BRArrayOf(BREthereumHash) failed = NULL;
+
+    pthread_mutex_lock (&pow->lock);
+    if (array_count (pow->failed) > 0) {
+        failed = pow->failed;
+        array_new (pow->failed, 10);
+    }
+    pthread_mutex_unlock (&pow->lock);
+
+    return failed;
+}
+
+/// Compute as proofOfWorkCompute() but only start generating a cache for an epoch that is
+/// plausible and no older than `epochNewest` (or the one prior).
+static BREthereumBoolean
+proofOfWorkComputeInternal (BREthereumProofOfWork pow,
+                            BREthereumBlockHeader header,
+                            uint64_t epochNewest,
+                            UInt256 *n,
+                            BREthereumHash *m) {
     assert (NULL != n && NULL != m);
+    uint64_t epoch = proofOfWorkGetEpoch (header);
+
+    pthread_mutex_lock (&pow->lock);
+    if (epochNewest < pow->epochNewest) epochNewest = pow->epochNewest;
+
+    BREthereumPoWCache *cache = proofOfWorkFindCache (pow, epoch);
+    if (NULL == cache &&
+        epoch + 1 >= epochNewest &&
+        epoch <= proofOfWorkGetEpochPlausible (pow))
+        proofOfWorkGenerateInBackground (pow, epoch);
+    pthread_mutex_unlock (&pow->lock);
+
+    if (NULL == cache) return ETHEREUM_BOOLEAN_FALSE;
+
+    powHashimotoLight (cache, header, n, m);
+
+    pthread_mutex_lock (&pow->lock);
+    proofOfWorkReleaseCache (pow, cache);
+    pthread_mutex_unlock (&pow->lock);
+
+    return ETHEREUM_BOOLEAN_TRUE;
+}
+
+extern BREthereumBoolean
+proofOfWorkCompute (BREthereumProofOfWork pow,
+                    BREthereumBlockHeader header,
+                    UInt256 *n,
+                    BREthereumHash *m) {
+    return proofOfWorkComputeInternal (pow, header, 0, n, m);
+}
+
+typedef struct {
+    BREthereumProofOfWork pow;
+    uint64_t epochNewest;
+    BREthereumBlockHeader *headers;
+    UInt256 *ns;
+    BREthereumHash *ms;
+    BREthereumBoolean *computed;
+    size_t count, offset, stride;
+} BREthereumPoWWorker;
+
+// computes headers offset, offset + stride, offset + stride*2, ...
+static void *
+proofOfWorkComputeWorker (void *info) {
+    BREthereumPoWWorker *worker = info;
+
+    for (size_t index = worker->offset; index < worker->count; index += worker->stride)
+        worker->computed[index] = proofOfWorkComputeInternal (worker->pow,
+                                                              worker->headers[index],
+                                                              worker->epochNewest,
+                                                              &worker->ns[index],
+                                                              &worker->ms[index]);
+    return NULL;
+}
+
+extern void
+proofOfWorkComputeMany (BREthereumProofOfWork pow,
+                        BREthereumBlockHeader *headers,
+                        size_t headersCount,
+                        UInt256 *ns,
+                        BREthereumHash *ms,
+                        BREthereumBoolean *computed,
+                        size_t threadCount) {
+    size_t index;
+
+    if (0 == headersCount) return;
+
+    // Find the newest plausible epoch first so that older `headers` don't start a cache
+    // generation.  This only applies to `headers`; pow->epochNewest awaits verification.
+    pthread_mutex_lock (&pow->lock);
+    uint64_t epochPlausible = proofOfWorkGetEpochPlausible (pow);
+    pthread_mutex_unlock (&pow->lock);
+
+    uint64_t epochNewest = 0;
+    for (index = 0; index < headersCount; index++) {
+        uint64_t epoch = proofOfWorkGetEpoch (headers[index]);
+        if (epoch > epochNewest && epoch <= epochPlausible)
+            epochNewest = epoch;
+    }
+
+    if (threadCount > headersCount)    threadCount = headersCount;
+    if (threadCount > POW_MAX_THREADS) threadCount = POW_MAX_THREADS;
+    if (threadCount < 1) threadCount = 1;
+
+    BREthereumPoWWorker workers[threadCount];
+    pthread_t threads[threadCount];
+    int started[threadCount];
 
-    // On and on and on
+    for (index = 0; index < threadCount; index++) {
+        workers[index] = (BREthereumPoWWorker) { pow, epochNewest, headers, ns, ms, computed, headersCount, index, threadCount };
+        started[index] = (index > 0 && 0 == pthread_create (&threads[index], NULL, proofOfWorkComputeWorker, &workers[index]));
+    }
 
-    // TODO: Actually compute something.
+    for (index = 0; index < threadCount; index++)
+        if (0 == index || !started[index]) proofOfWorkComputeWorker (&workers[index]); // calling thread does any unstarted work
 
-    // For now, return values that allow subsequent use to succeed
-    *n = UINT256_ZERO;
-    *m = blockHeaderGetMixHash (header);
+    for (index = 1; index < threadCount; index++)
+        if (started[index]) pthread_join (threads[index], NULL);
 }
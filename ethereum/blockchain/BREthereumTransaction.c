@@ -323,8 +323,7 @@ transactionExtractAddress(BREthereumTransaction transaction,
 
     int success = 1;
 
-    BRRlpItem item = transactionRlpEncode (transaction, network, RLP_TYPE_TRANSACTION_UNSIGNED, coder);
-    BRRlpData data = rlpItemGetData(coder, item);
+    BRRlpData data = transactionGetRlpData (transaction, network, RLP_TYPE_TRANSACTION_UNSIGNED);
 
     BREthereumAddress address = ethSignatureExtractAddress(transaction->signature,
                                    data.bytes,
@@ -332,7 +331,6 @@ transactionExtractAddress(BREthereumTransaction transaction,
                                    &success);
     
     rlpDataRelease(data);
-    rlpItemRelease(coder, item);
     return address;
 }
 
@@ -409,6 +407,58 @@ transactionRlpEncode(BREthereumTransaction transaction,
     return result;
 }
 
+extern void
+transactionRlpWrite (BREthereumTransaction transaction,
+                     BREthereumNetwork network,
+                     BREthereumRlpType type,
+                     BRRlpWriter writer) {
+    // As for transactionRlpEncode(), including the EIP-155 handling of { v, r, s }
+    size_t offset = rlpWriterGetBytesCount (writer);
+
+    rlpWriterBeginList (writer);
+    rlpWriterWriteUInt64 (writer, transaction->nonce, 1);
+    ethGasPriceRlpWrite (transaction->gasPrice, writer);
+    ethGasRlpWrite (transaction->gasLimit, writer);
+    ethAddressRlpWrite (transaction->targetAddress, writer);
+    ethEtherRlpWrite (transaction->amount, writer);
+    rlpWriterWriteHexString (writer, transaction->data);
+
+    transaction->chainId = ethNetworkGetChainId(network);
+
+    switch (type) {
+        case RLP_TYPE_TRANSACTION_UNSIGNED:
+            rlpWriterWriteUInt64 (writer, transaction->chainId, 1);
+            rlpWriterWriteString (writer, "");
+            rlpWriterWriteString (writer, "");
+            break;
+
+        case RLP_TYPE_TRANSACTION_SIGNED: // aka NETWORK
+        case RLP_TYPE_ARCHIVE:
+            rlpWriterWriteUInt64 (writer, transaction->signature.sig.vrs.v + 8 +
+                                  2 * transaction->chainId, 1);
+
+            rlpWriterWriteBytesPurgeLeadingZeros (writer,
+                                                  transaction->signature.sig.vrs.r,
+                                                  sizeof (transaction->signature.sig.vrs.r));
+
+            rlpWriterWriteBytesPurgeLeadingZeros (writer,
+                                                  transaction->signature.sig.vrs.s,
+                                                  sizeof (transaction->signature.sig.vrs.s));
+
+            if (RLP_TYPE_ARCHIVE == type) {
+                ethAddressRlpWrite (transaction->sourceAddress, writer);
+                ethHashRlpWrite (transaction->hash, writer);
+                transactionStatusRLPWrite (transaction->status, writer);
+            }
+            break;
+    }
+
+    rlpWriterEndList (writer);
+
+    if (RLP_TYPE_TRANSACTION_SIGNED == type && rlpWriterIsWriting (writer))
+        transaction->hash = ethHashCreateFromData (rlpWriterGetDataSharedDontRelease (writer, offset));
+}
+
 //
 // Tranaction RLP Decode
 //
@@ -502,12 +552,14 @@ extern BRRlpData
 transactionGetRlpData (BREthereumTransaction transaction,
                        BREthereumNetwork network,
                        BREthereumRlpType type) {
-    BRRlpCoder coder = rlpCoderCreate();
-    BRRlpItem item   = transactionRlpEncode (transaction, network, type, coder);
-    BRRlpData data   = rlpItemGetData (coder, item);
+    BRRlpWriter writer = rlpWriterCreate();
+
+    transactionRlpWrite (transaction, network, type, writer);
+    rlpWriterBeginWriting (writer, NULL);
+    transactionRlpWrite (transaction, network, type, writer);
 
-    rlpItemRelease  (coder, item);
-    rlpCoderRelease (coder);
+    BRRlpData data = rlpWriterEndWriting (writer);
+    rlpWriterRelease (writer);
 
     return data;
 }
@@ -519,9 +571,7 @@ transactionGetRlpHexEncoded (BREthereumTransaction transaction,
                              const char *prefix) {
     if (NULL == prefix) prefix = "";
 
-    BRRlpCoder coder = rlpCoderCreate();
-    BRRlpItem item = transactionRlpEncode (transaction, network, type, coder);
-    BRRlpData data = rlpItemGetDataSharedDontRelease(coder, item);
+    BRRlpData data = transactionGetRlpData (transaction, network, type);
 
     char *result;
 
@@ -534,8 +584,7 @@ transactionGetRlpHexEncoded (BREthereumTransaction transaction,
         hexEncode(&result[strlen(prefix)], 2 * data.bytesCount + 1, data.bytes, data.bytesCount);
     }
 
-    rlpItemRelease(coder, item);
-    rlpCoderRelease(coder);
+    rlpDataRelease(data);
     return result;
 }
 
@@ -180,6 +180,16 @@ transactionRlpEncode(BREthereumTransaction transaction,
                      BREthereumRlpType type,
                      BRRlpCoder coder);
 
+/**
+ * RLP write transaction, as for transactionRlpEncode(), but without creating RLP items.  For
+ * RLP_TYPE_TRANSACTION_SIGNED the transaction's hash is set in the writing pass.
+ */
+extern void
+transactionRlpWrite (BREthereumTransaction transaction,
+                     BREthereumNetwork network,
+                     BREthereumRlpType type,
+                     BRRlpWriter writer);
+
 extern BRRlpData
 transactionGetRlpData (BREthereumTransaction transaction,
                        BREthereumNetwork network,
@@ -104,16 +104,15 @@ transactionReceiptLogsRlpEncode (BREthereumTransactionReceipt log,
 }
 
 static BREthereumLog *
-transactionReceiptLogsRlpDecode (BRRlpItem item,
-                                 BRRlpCoder coder) {
-    size_t itemsCount = 0;
-    const BRRlpItem *items = rlpDecodeList(coder, item, &itemsCount);
-
+transactionReceiptLogsRlpDecode (BRRlpView view) {
     BREthereumLog *logs;
-    array_new(logs, itemsCount);
+    array_new(logs, rlpViewGetItemsCount (view));
 
-    for (int i = 0; i < itemsCount; i++) {
-        BREthereumLog log = logRlpDecode(items[i], RLP_TYPE_NETWORK, coder);
+    for (BRRlpView item = rlpViewGetFirstItem (view);
+         !rlpViewIsEmpty (item);
+         item = rlpViewGetNextItem (view, item)) {
+        // A RLP_TYPE_NETWORK log does not use a coder.
+        BREthereumLog log = logRlpDecodeView(item, RLP_TYPE_NETWORK, NULL);
         array_add(logs, log);
     }
 
@@ -126,17 +125,22 @@ transactionReceiptLogsRlpDecode (BRRlpItem item,
 extern BREthereumTransactionReceipt
 transactionReceiptRlpDecode (BRRlpItem item,
                              BRRlpCoder coder) {
+    return transactionReceiptRlpDecodeView (rlpItemGetView (coder, item));
+}
+
+extern BREthereumTransactionReceipt
+transactionReceiptRlpDecodeView (BRRlpView view) {
     BREthereumTransactionReceipt receipt = calloc (1, sizeof(struct BREthereumTransactionReceiptRecord));
     memset (receipt, 0, sizeof(struct BREthereumTransactionReceiptRecord));
     
-    size_t itemsCount = 0;
-    const BRRlpItem *items = rlpDecodeList(coder, item, &itemsCount);
+    BRRlpView items[4];
+    size_t itemsCount = rlpViewGetItems (view, items, 4);
     assert (4 == itemsCount);
     
-    receipt->stateRoot = rlpDecodeBytes(coder, items[0]);
-    receipt->gasUsed = rlpDecodeUInt64(coder, items[1], 0);
-    receipt->bloomFilter = bloomFilterRlpDecode(items[2], coder);
-    receipt->logs = transactionReceiptLogsRlpDecode(items[3], coder);
+    receipt->stateRoot = rlpDataCopy (rlpViewDecodeBytesSharedDontRelease(items[0]));
+    receipt->gasUsed = rlpViewDecodeUInt64(items[1]);
+    receipt->bloomFilter = bloomFilterRlpDecodeView(items[2]);
+    receipt->logs = transactionReceiptLogsRlpDecode(items[3]);
     
     return receipt;
 }
@@ -157,6 +161,22 @@ transactionReceiptRlpEncode(BREthereumTransactionReceipt receipt,
     return rlpEncodeListItems(coder, items, 4);
 }
 
+extern void
+transactionReceiptRlpWrite (BREthereumTransactionReceipt receipt,
+                            BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+    rlpWriterWriteBytes (writer, receipt->stateRoot.bytes, receipt->stateRoot.bytesCount);
+    rlpWriterWriteUInt64 (writer, receipt->gasUsed, 1);
+    bloomFilterRlpWrite (receipt->bloomFilter, writer);
+
+    rlpWriterBeginList (writer);
+    for (size_t index = 0; index < array_count(receipt->logs); index++)
+        logRlpWrite (receipt->logs[index], RLP_TYPE_NETWORK, writer);
+    rlpWriterEndList (writer);
+
+    rlpWriterEndList (writer);
+}
+
 extern BRArrayOf (BREthereumTransactionReceipt)
 transactionReceiptDecodeList (BRRlpItem item,
                               BRRlpCoder coder) {
@@ -170,6 +190,18 @@ transactionReceiptDecodeList (BRRlpItem item,
     return receipts;
 }
 
+extern BRArrayOf (BREthereumTransactionReceipt)
+transactionReceiptDecodeListView (BRRlpView view) {
+    BRArrayOf (BREthereumTransactionReceipt) receipts;
+    array_new (receipts, rlpViewGetItemsCount (view));
+
+    for (BRRlpView item = rlpViewGetFirstItem (view);
+         !rlpViewIsEmpty (item);
+         item = rlpViewGetNextItem (view, item))
+        array_add (receipts, transactionReceiptRlpDecodeView (item));
+    return receipts;
+}
+
 extern void
 transactionReceiptsRelease (BRArrayOf(BREthereumTransactionReceipt) receipts) {
     if (NULL != receipts) {
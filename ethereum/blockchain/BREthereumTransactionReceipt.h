@@ -53,15 +53,28 @@ transactionReceiptMatchAddress (BREthereumTransactionReceipt receipt,
 extern BREthereumTransactionReceipt
 transactionReceiptRlpDecode (BRRlpItem item,
                              BRRlpCoder coder);
+
+extern BREthereumTransactionReceipt
+transactionReceiptRlpDecodeView (BRRlpView view);
     
 extern BRRlpItem
 transactionReceiptRlpEncode(BREthereumTransactionReceipt receipt,
                             BRRlpCoder coder);
 
+/**
+ * Write `receipt` in its consensus encoding - the encoding hashed into a block's receiptsRoot.
+ */
+extern void
+transactionReceiptRlpWrite (BREthereumTransactionReceipt receipt,
+                            BRRlpWriter writer);
+
 extern BRArrayOf (BREthereumTransactionReceipt)
 transactionReceiptDecodeList (BRRlpItem item,
                               BRRlpCoder coder);
 
+extern BRArrayOf (BREthereumTransactionReceipt)
+transactionReceiptDecodeListView (BRRlpView view);
+
 extern void
 transactionReceiptRelease (BREthereumTransactionReceipt receipt);
 
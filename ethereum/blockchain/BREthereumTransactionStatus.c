@@ -204,6 +204,43 @@ transactionStatusRLPEncode (BREthereumTransactionStatus status,
     return rlpEncodeListItems(coder, items, 3);
 }
 
+extern void
+transactionStatusRLPWrite (BREthereumTransactionStatus status,
+                           BRRlpWriter writer) {
+    // As for transactionStatusRLPEncode()
+    rlpWriterBeginList (writer);
+    rlpWriterWriteUInt64 (writer, status.type, 0);
+
+    switch (status.type) {
+        case TRANSACTION_STATUS_UNKNOWN:
+        case TRANSACTION_STATUS_QUEUED:
+        case TRANSACTION_STATUS_PENDING:
+            rlpWriterBeginList (writer);
+            rlpWriterEndList (writer);
+            rlpWriterWriteString (writer, "");
+            break;
+
+        case TRANSACTION_STATUS_INCLUDED:
+            rlpWriterBeginList (writer);
+            ethHashRlpWrite (status.u.included.blockHash, writer);
+            rlpWriterWriteUInt64 (writer, status.u.included.blockNumber, 0);
+            rlpWriterWriteUInt64 (writer, status.u.included.transactionIndex, 0);
+            rlpWriterWriteUInt64 (writer, status.u.included.blockTimestamp, 0);
+            ethGasRlpWrite (status.u.included.gasUsed, writer);
+            rlpWriterEndList (writer);
+            rlpWriterWriteString (writer, "");
+            break;
+
+        case TRANSACTION_STATUS_ERRORED:
+            rlpWriterBeginList (writer);
+            rlpWriterEndList (writer);
+            rlpWriterWriteUInt64 (writer, status.u.errored.type, 0);
+            break;
+    }
+
+    rlpWriterEndList (writer);
+}
+
 extern BRArrayOf (BREthereumTransactionStatus)
 transactionStatusDecodeList (BRRlpItem item,
                              const char *reasons[],
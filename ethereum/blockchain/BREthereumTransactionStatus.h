@@ -141,6 +141,10 @@ extern BRRlpItem
 transactionStatusRLPEncode (BREthereumTransactionStatus status,
                             BRRlpCoder coder);
 
+extern void
+transactionStatusRLPWrite (BREthereumTransactionStatus status,
+                           BRRlpWriter writer);
+
 extern BRArrayOf (BREthereumTransactionStatus)
 transactionStatusDecodeList (BRRlpItem item,
                              const char *reasons[],
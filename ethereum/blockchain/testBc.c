@@ -9,8 +9,13 @@
 //  See the CONTRIBUTORS file at the project root for a list of contributors.
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "ethereum/mpt/BREthereumMPT.h"
 #include "ethereum/blockchain/BREthereumBlockChain.h"
 
 //
@@ -133,6 +138,123 @@ runBlockHeaderTests (void) {
 
 }
 
+// Block 4000001 with its nonce changed, from 0x5d345a1001da875e to 0x5d345a1001da875f
+#define BLOCK_HEADER_4000001_BAD_NONCE_RLP "f9020ea0b8a3f7f5cfc1748f91a684f20fe89031202cbadcd15078c49b85ec2a57f43853a01dcc4de8dec75d7aab85b567b6ccd41ad312451b948a7413f0a142fd40d4934794ea674fdde714fd979de3edf0f56aa9716b898ec8a07b01440ffe0282749577cf99f6c90aa39e496af23bbdc64ab57a3f0d1bf8a467a0ab330290ef6907c3e411691347a3ba6933482354e48dc46738f2226aab0d848ca03db9076bd070e771806d05df3bfe7d83aae07fc94e35310ea304509f57fb27acb90100000000000000000000000000000000000000000004000000000000000000000000000000000000000000000000800000280000000000000000000000000000000000000000000000000000000000000000010000000000000000000000000400000000000000000000000000000000000000000000000000000000800000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000020000000000000000000080000000000000000000000000000000000000000000000000000041000000000000000000000000000004000000000000000000000008703e5d1c1e295f1833d090183666c488305282e84596297a38d65746865726d696e652d657536a04db91248cc4af54907e32cc5c160eeb7d5813cce11c87bbc85a0dc6db2b65419885d345a1001da875f"
+
+static void
+runBlockProofOfWorkTest (void) {
+    BREthereumBlockHeader header_0       = testGetBlockHeader(BLOCK_HEADER_0_RLP);
+    BREthereumBlockHeader header_4000000 = testGetBlockHeader(BLOCK_HEADER_4000000_RLP);
+    BREthereumBlockHeader header_4000001 = testGetBlockHeader(BLOCK_HEADER_4000001_RLP);
+    BREthereumBlockHeader header_bad     = testGetBlockHeader(BLOCK_HEADER_4000001_BAD_NONCE_RLP);
+    BREthereumBlockHeader header_6000000 = testGetBlockHeader(BLOCK_HEADER_6000000_RLP);
+
+    BREthereumProofOfWork pow = proofOfWorkCreate (NULL, 4000000, blockHeaderGetTimestamp (header_4000000));
+
+    UInt256 n;
+    BREthereumHash m;
+
+    // Epoch 133 (blocks 3,990,000 to 4,019,999)
+    clock_t start = clock();
+    proofOfWorkGenerate (pow, header_4000001);
+    printf ("    PoW Cache (Epoch 133): %.2f seconds\n", ((double) (clock() - start)) / CLOCKS_PER_SEC);
+
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (proofOfWorkCompute (pow, header_4000001, &n, &m)));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (m, blockHeaderGetMixHash (header_4000001))));
+
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (blockHeaderIsValid (header_4000001,
+                                                          header_4000000,
+                                                          0,
+                                                          header_0,
+                                                          pow)));
+
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (blockHeaderIsValid (header_bad,
+                                                           header_4000000,
+                                                           0,
+                                                           header_0,
+                                                           pow)));
+
+    // Validate many, on multiple threads
+    BREthereumBlockHeader headers[] = { header_4000000, header_bad, header_4000001 };
+    BREthereumBoolean valid[3];
+
+    blockHeadersAreValidPoW (headers, 3, pow, 2, valid);
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (valid[0]));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (valid[1]));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (valid[2]));
+
+    // No cache for epoch 200; not computed (and the cache is started in the background)
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (proofOfWorkCompute (pow, header_6000000, &n, &m)));
+
+    proofOfWorkRelease (pow);
+
+    // Anchored at 4,000,000 as if just mined; epoch 200 is implausible, thus invalid and without
+    // a cache generated.
+    pow = proofOfWorkCreate (NULL, 4000000, (uint64_t) time (NULL));
+
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (proofOfWorkIsPlausible (pow, header_4000001)));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (proofOfWorkIsPlausible (pow, header_6000000)));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (proofOfWorkCompute (pow, header_6000000, &n, &m)));
+
+    BREthereumBlockHeader headersFuture[] = { header_4000001, header_6000000 };
+    blockHeadersAreValidPoW (headersFuture, 2, pow, 2, valid);
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (valid[0]));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (valid[1]));
+
+    proofOfWorkRelease (pow);
+
+    // Headers deferred before their cache exists are checked as the cache is installed; the cache
+    // is saved and any other cache file is removed.
+    char path[] = "/tmp/BREthereumPoWTests.XXXXXX";
+    assert (NULL != mkdtemp (path));
+
+    char stale[sizeof (path) + 32];
+    sprintf (stale, "%s/eth-ethash-stale", path);
+    FILE *staleFile = fopen (stale, "w");
+    assert (NULL != staleFile);
+    fclose (staleFile);
+
+    pow = proofOfWorkCreate (path, 4000000, blockHeaderGetTimestamp (header_4000000));
+    proofOfWorkDefer (pow, header_bad);
+    proofOfWorkDefer (pow, header_4000001);
+    assert (NULL == proofOfWorkTakeFailed (pow));
+
+    proofOfWorkGenerate (pow, header_4000001);
+    BRArrayOf(BREthereumHash) failed = proofOfWorkTakeFailed (pow);
+    assert (NULL != failed && 1 == array_count (failed));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (failed[0], blockHeaderGetHash (header_bad))));
+    array_free (failed);
+    proofOfWorkRelease (pow);
+
+    assert (0 != access (stale, F_OK));
+
+    // The saved cache is mapped, rather than regenerated.
+    pow = proofOfWorkCreate (path, 4000000, blockHeaderGetTimestamp (header_4000000));
+    start = clock();
+    proofOfWorkGenerate (pow, header_4000001);
+    printf ("    PoW Cache (Epoch 133, Saved): %.2f seconds\n", ((double) (clock() - start)) / CLOCKS_PER_SEC);
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (proofOfWorkCompute (pow, header_4000001, &n, &m)));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (m, blockHeaderGetMixHash (header_4000001))));
+    proofOfWorkRelease (pow);
+
+    DIR *dir = opendir (path);
+    assert (NULL != dir);
+    for (struct dirent *entry = readdir (dir); NULL != entry; entry = readdir (dir)) {
+        if ('.' == entry->d_name[0]) continue;
+        char filename[sizeof (path) + 256];
+        sprintf (filename, "%s/%s", path, entry->d_name);
+        remove (filename);
+    }
+    closedir (dir);
+    rmdir (path);
+
+    blockHeaderRelease (header_6000000);
+    blockHeaderRelease (header_bad);
+    blockHeaderRelease (header_4000001);
+    blockHeaderRelease (header_4000000);
+    blockHeaderRelease (header_0);
+}
+
 //
 // block Test
 //
@@ -286,12 +408,95 @@ runBlockCheckpointTest (void) {
 }
 
 #define BLOCK_6000000_RLP "f9408df90210a05d85a965cd1c00cbb7affb25371aeb2d7f610fda7207eb081c1ea2cb23254d5aa01dcc4de8dec75d7aab85b567b6ccd41ad312451b948a7413f0a142fd40d4934794829bd824b016326a401d083b33d092293333a830a0ecd323023ea0c000b6370e884ecd16cbe37244102688fc5c2e8c8a73bc1b18e1a050115fbf29591a3505eabfac5c5a6a8585e1d1c064a04348f00af02ddf79b58ea0d7adcb6c39b2aa65a8aa739e8638bdde4b3e01cd0ff1d0024fdca745ba3e6ea5b90100800b000004742018800113013800401243200020280a002206a2210000080300000c0088440401102010100202412c0302002804490118901200404d01040020000000449800241984c2120c4000200005482604c00480a021934009d8202802802000484214310003104450040009042062002200840048080001522008200281500001002421048282158006ac00488000098162a1000002068064040221108080082000484000280408014082810601100d00201000225200800810042420240008060840010042980010200440400000401082c8080420500003004670231400200d0020010000000082804aa02402088080505408580040508000800200870c6071524d8baa835b8d80837a214f8379fab1845b5246248fe4b883e5bda9e7a59ee4bb99e9b1bca0aed9520a8d287b8b459db916f2fe8e3337db07189fa8e8bb0f3e8e2cf5c7a98888b38c11380f0b72c3f93e76f86f835e2b9685174876e800830249f094f50fcf9de1b62c329b3f8586b36611caac2f3267878292a8a56e10008026a0d981d8ac73953f722173c0319081fd7a7baa49fbc67b7f7a42c2eafd53f19c82a035c957575a78c02c887ffe8d8f096d626df47304571866f51521e17606f2c445f870835e2b9785174876e800830249f0947356d3316503db27f2f6e0cdbd1b7cc1a8dd2743880de0b6b3a76400008026a0bd1a925b5ef7749533f6255edcd73942abd9d4b6f25d271f00768f77948b6152a07b1103e8287d6cd0bb81aa1fb26327f7dafec203d8458388357c67badae59832f871835e2b9885174876e800830249f09439cd97834842f1cf633ec5214537cec22a7c6757890261b671eb3c289c008025a0f3efc8a0b0150fea45e4680812679c32afb0521c20e920c73d3c5b1a929ed496a02d562a97dc792578357071c77be70796fed70367f743a781d35cef2f5b0c810af86f835e2b9985174876e800830249f0940e2b2d735723fd1b4374f1fd0d1ce073bd3cc3248778cad1e25d00008026a0f31209eb9a722f0400d800c3f131ea8fde55a692999973fc9f010a013a338857a021df840c6ec31d4f27c0f95da47e49973e7bc11300e0e383cb0ba89c751efa04f8ad835e2b9a85174876e800830249f09488518ddba475934f1c35e4c03a126c851cd4b56680b8446ea056a900000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000154cc7ad435e00026a0f27637a367f785bf4cfe960de63666447488353320f9a1b857fe3852e36053d7a0153806f1db8067255b1ed70d90b4ceff378312b80e3f02d8d1d2779540d05c6cf8ad835e2b9b85174876e800830249f0944c69db6b28acb2acee7ef334abfe6af5e0944e6880b8446ea056a9000000000000000000000000d26114cd6ee289accf82350c8d8487fedb8a0c07000000000000000000000000000000000000000000000029331e6558f0e0000025a03280170c21f71cfa070339712fee5d4bff15432a8f9f4e64d73e9a915293bd60a033c7d1e8d5ea41e11321b843df4335cb791858ed2c55336f905cd9603b89d080f8ad835e2b9c85174876e800830249f0949992ec3cf6a55b00978cddf2b27bc6882d88d1ec80b844a9059cbb000000000000000000000000aa09e495885d58520effd15d16eecc8145cb922b00000000000000000000000000000000000000000000000cd337e10de340d00026a0def4a6bde1f301bcec38a2bf42315bb188a986602d679c7f55f0e47df790b13da058ca48ac09be067a8b90e82af704b682f74d547dcb108b3d78ace4763a85a7c2f8b24585174876e800830249f094e94b04a0fed112f3664e45adb2b8915693dd5ff38806951fa52a779400b8440f2c9329000000000000000000000000fbb1b73c4f0bda4f67dca266ce6ef42f520fbb98000000000000000000000000e592b0d8baa2cb677034389b76a71b0d1823e0d125a0dc8969c085ec1587f29c9b0c82af42a4aa9eb61cd34d2493aca488a3bac2d7b9a020b2b4fcc557502ca999bdb5df89d1ceac33e8d01aeaf8c084ed95194ef38215f8b482090385174876e800830249f094e94b04a0fed112f3664e45adb2b8915693dd5ff3881d558a1da22f2800b8440f2c9329000000000000000000000000fbb1b73c4f0bda4f67dca266ce6ef42f520fbb98000000000000000000000000e592b0d8baa2cb677034389b76a71b0d1823e0d126a05b4f71c10d65bef2f8c51ea83af3b445f7cc3f6749ffab82217f6ea876be7826a06e87c6dc9f0fa40198d142bb60ba0aa3f32cd1f110c6d3fab5866743c9a07ccef86b018515a73b6200825208946e941712d44706d67b141edda5550adaa88c4495879fdf42f6e480008026a090bbe676448a6bbc26f85885a51b2846ad33773a7374da56f1a2f2cab557a530a00bdc7531463b8ede4fbff2ba69e761abb2ebb123cdb64aeb7e2bbfc45185af72f8ac82d59c85147d357000830124f89499ea4db9ee77acd40b119bd1dc4e33e1c070b80d80b844a9059cbb0000000000000000000000003984df092065c520dfddba0994b1cbb5ddfab81c000000000000000000000000000000000000000000000132c167bb3d8868000026a0ee12cd7af1a422e44d9ea46fc43414538c64519fcb7fc5d51df3da4950798235a077ddcedc071e175d1b035a8e61ea28755da8752d3ba9d4393ca1b413e0e4fd3ef86f830d7df3850df8475800825208946016ddc07f22fbbb28d6273c2c9c0d368a8541a7880138e974a95320008026a0c843a26bc693aa1f58a22a5d71208b856867d99bece8005d5abf79c54a002ab6a042b91792baf2a931402e96346e4a1cd26f5c90e522cdbe71dca10ea011473ea1f8ad8326e6c4850df847580083019ae494809826cceab68c387726af962713b64cb5cb3cca80b844a9059cbb0000000000000000000000005bd9b682f24da3a4f23bf66423a1763f6098cbaf00000000000000000000000000000000000000000000005102f7525457c0000026a06d6c1599eb3df9bd995dca135f7a5a3de434fb354b8876f1300a1506cc7bc3caa03b59e60eb21d647fe508429a2a6044b995236c276ca08eebf229d1d3b3d42955f8ad830c7742850df847580083019b6494809826cceab68c387726af962713b64cb5cb3cca80b844a9059cbb000000000000000000000000f910ae9e1f1fef7dc72456ed2bb4c80983bd2783000000000000000000000000000000000000000000000dd070ba88dd8b7d000026a06aaf5891461987202e28654922c3d7e2602bd279591fb5b3f8019a660e39ea89a018aa51ac4378bbed64510ac502fad9dfa0b76472d4999ab63b02b25e8f191963f86f830c7743850df847580082520894bf97ec898673b6a45f00bd22e282dbb51398e78c880bee583d7dbb00008025a033952328e37991c4da1095ce5848ef0ccbcbe5f5c367b0d9a7a28a271b0b2d1ea00c157dc2260db04f67979d1fcd307b6b44babd3d17566bafb635325c4082895af86f830c7744850df8475800825208946c54acc96a8ea8d869b4567d60a2fef10cf8af8e881e477877b3f650008025a0d2b33b9377692e9ba09b7c4508ffc14b66a29b0cb8ee4cd1c8066e13cc83e88da07a1299dcb8d6cbe8392a2adb02085cc245accabb85e0339f665451509ff852b8f86f830dda23850df847580082520894439bb28b95a851a00c38c1d21593fa2b23e69abd8817297aa8422080008026a08f0e0c373cfe50633d8c290139a87564c9976233b055fd9bdb6123b3e537d535a064718bd4b3d641e5ff23455ecdaf0e8b4ca582ecad4dbf443401e362576029b3f86f830dda24850df8475800825208948ff48d0d345aa80cd5fccab600a3220c250701358808d7142001ec80008025a03f5c7d6818749d0c7939e0208868337120aba4c50e1b89f10b407667bfec44f0a05844ab916f0c171947b69dbb0d5b5bf2ddd23667816edd6b3a1b6d8ba9d4e12ef86f830dda25850df847580082520894b5f6873b47b9944b78140dfffb2b2aee7b46c5848803b49bb5170fd0008025a05dbde2fab02e41620a9b6d501a3c3b517e18b50bcc171041af5af92cf933fca6a07beb8d08265272950da93577de1804db9ca8f3b7ee08d348cb526b4a7390dbcaf86c1d850d4576fa00825208944c9db4cd776d69b599930dfd9704126d2736992c880a70eb363fcb1e268025a0d14fe5dc1bc9420f55447d115de8c269bd2a53681c2abc8149ba3a5a1bfc9cefa0646f6baf6cd83dfb67164348c747e658e1329d34eadd9a9f69afd7b30720c0e9f8708209a2850c22a758408304f58894c7ed8919c70dd8ccf1a57c0ed75b25ceb2dd22d18089000101d521928b414626a0b5889c55a0ebbf86627524affc9c4fdedc4608bee7a0f9880b5ec965d58e4264a02da32e817e2483ec2199ec0121b93384ac820049a75e11b40d152fc7558a5d72f8ac823cb2850bdfd63e0083030d4094b7cb1c96db6b22b0d3d9536e0108d062bd488f7480b844a9059cbb0000000000000000000000001ae5d5903acb0cecad760c8702f4f05d34650e810000000000000000000000000000000000000000000000088401b3c82da17c0025a0cf1216c5df64144987b47bba276d0db70744617d36d07f30a53af6392ab7ac3ca03609acd469aa143732edbb178d96b270d9578634e6c5811e4d4c758ce513c59df86d825378850ba43b740082520894ddd04b2b2714adf5e3598de2469fb92092dc076687ac696558ffb8008025a07b3a4c442ed04b734b544e2dff95e139793cb316df8d30724d48b51635e82cd8a000a844b425c3359bb3ce2355763ee55aa692e9ba5fd08bc86b651927db49b875f86c01850ba43b740082863e942e30126921a4625be4d7ae4727b5207ce07c335d880721400b5a4164008025a0bf6e936e0fb4f926a328ad5c805381eb67617e07fb6e5d27ccb74c4c448a9112a03e7f986d87f8fe7696b2da31e1fbc04b66e42c4172409fa833319fbfd0e2d73cf86c0a850ba43b740083028b0a94f5bec430576ff1b82e44ddb5a1c93f6f9d0884f387ae1ff448b5a8008026a0176d3a68b9066eb3a9885bcbadda5c6bd7571b6122deddead043093f32a09b97a07639b1aeded119d9c5ab098fd0b558662375b3d8ec2ec8732552ed9062f9baa6f86d8272ed850ba43b7400825208944fd1f044f8f0043f766a20f4181897ea550dde15876a675dc705e0008026a076b9a39ae1f200048f325df190d28460ac6cee25edb8e63a82ebb102a1dadba0a05baf37902f12067459c2540e199801ea3a367aceac409de3e3c9cf122922d7e4f86e8272ee850ba43b740082863e941e6812aa07c62ece36f7694c60d5b56be4f4325c8804949d5e0e7628008025a07754bfad7859325bc11ec101eb1f9159632f05f36eed334090f17763e033df7ba0138d1ac7c3a37feeec3efe3e7901864134da785f37a6a80a094b7668459df74ef86b17850b2d05e00082520894f1e74e2f009e63ade0fc0fba842159405d8490628711c37937e080008025a0fb3a25083b37b0f6f0f24b517c9a5efe591f26fdd4fda7e710d510ddf55e62f0a0481df187f2482557c4873321b833f68487b45bb2bce6cd3cbb019f73c78b070df871830102b7850ab03dc81b8304f58894c5f60fa4613493931b605b6da1e9febbdeb61e16808901059d000b30da083525a0eef84b92d085e32bb2f4d1038403356d2c49335627a4b758ff23af4d74a227c8a05cbd3bd6b47521515cb5dd250ac11e38ccec37565a759d635dc298e055a724d3f86e82ba46850a5ae2dfb183057e40943714e5671be406fc1920351984f44292378314778087010b01000b30da26a0dd4541fc03deee47a61f2ed0b25a21ac634913d19cbb8478a7a37b4dbf613997a05707218a21fa108329ab691491eb1fcaf43b81873527baadf6e3f533965fffd2f86b0c8506fc23ac0082520894e3e1d847f4d369faa89b01393b34a8193da6dead878bf8057ee14a808025a04f386118ea5a09974525d4e4f2bf8f7ec83912e7f350425c4490402d36abc2f9a00db0a80ce3a5b22d03f7893b71b4e997efa1c0cafb868e45874e29f91d000389f86e8261a98505d21dba0082abe0941aca81be23edbcaee016743dbe69ae372d826f9d88027e6947473a5c008025a0c5d72c890bc0611d84b387ca749ef5e74882e9987090d24d0a9e45003ca2ec38a047624f979307be43d5c40b4f98ee4c022411520d4d9ac85569dbde44d07ef732f86b82049485051f4d5c00831e8480946e6e0d828c96f0d73b9d2db60182357fc0f6abc380847f99fac826a07f3f9f324fbe94675faa3aa64b8a43806340b0c595314efd7c9f4dedf253ac4ba01905b095a912c58493794f3c19260b4844c4f0f2452ac8c03ca12c30fea14c63f86c8085051f4d5c0082b7a0946fc82a5fe25a5cdb58bc74600a40a69c065263f8880dc0b96df8e770008026a0415408186d37f78347c839df702a601df8f49e430cab693e7117cff9ec099d18a020a3eda18dc58996b7bfb6e528b7ea79bde61d7efa2121d31dc2c64fb1dfa793f8938235528504e3b292008303fb4c94048717ea892f23fb0126f00640e2b18072efd9d288016345785d8a0000a4dc6dd152000000000000000000000000000000000000000000000000000000000000000f25a03b9795a43774c3cebf96cda154fa212f5f84d66179b816c566f691250e2cbbdfa0097f7895133d2b72c999c0d25b9f6dd024bdb7404fd531cffad23592c9d8c42bf8b3318504bfef4c008305826d94a62142888aba8370742be823c1782d17a0389da18903d408d5b3c36285cbb844a65b37a16e6577636f6e7472616374000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000226a0fdf18445d3e69b38b5ba30cd0c2a4b87c8449e2ac0789a9b78a011ae64eb7b5fa055404a4b9689f429760a31dada8c848ff37fc81a54d08d64c81532cefec15231f8ac8250648504a817c8008301d034941985365e9f78359a9b6ad760e32412f4a445e86280b844a9059cbb0000000000000000000000003f5ce5fbfe3e9af3971dd833d26ba9b5c936f0be0000000000000000000000000000000000000000000000237a8354c77217d40026a08d0bdd6208cf150d5e92fbd480a841d3dbb2f531cad25a3a1a4d74815e61323aa01c3a80f2bd4e38117670035e4c2d0e7281a6fc18663aac03ee7c163c38aa2541f8ac8241e68504a817c8008301250294df2c7238198ad8b389666574f2d8bc411a4b742880b844a9059cbb0000000000000000000000003f5ce5fbfe3e9af3971dd833d26ba9b5c936f0be000000000000000000000000000000000000000000001a1d4d18755d0400000025a0993c609d8afd3c15c9224d5ee89eae8506ffef1aa4193f731954b4fc01b4012da07ce2bfedaf8e8d1cc06ba4751d45731c02f55e87d7d8f1169308b580742fbd8af8aa148504a817c80083011d7294b7cb1c96db6b22b0d3d9536e0108d062bd488f7480b844a9059cbb0000000000000000000000003f5ce5fbfe3e9af3971dd833d26ba9b5c936f0be0000000000000000000000000000000000000000000000243a41738388a07c0025a07a3c6b0f97e0698fd5220bb6b935142fd4a5e22fda102a25df0e224741b2c2c7a06950d15b5bfef24c14e96b7961964e5822a14f094a7a75cf90869780d589f1a0f89081908504a817c80082fe90940b95993a39a363d99280ac950f5e4536ab5c5566871550f7dca70000a41a695230000000000000000000000000ea571341f70b2fe15716e494d1ff95a47d1cdc0e26a094df936834cab142496ca403e79ba8456fa4a5b8d4dae6649ece53693773c068a036e4d561fcbd47b572525470d7a4e958e0fc67e906a0aa8a43012c5743b22851f8aa038504a817c80083011d7294b7cb1c96db6b22b0d3d9536e0108d062bd488f7480b844a9059cbb0000000000000000000000003f5ce5fbfe3e9af3971dd833d26ba9b5c936f0be0000000000000000000000000000000000000000000000132bce69b1689ca00026a08fba12f5674b1509004ddc091aaca03b6046fd77ef23b012e3664d0498d9f586a07a3b9a42d3f896a05826bf55caedfa0129a70c997b432e75c2afd773bf9ca693f8aa088504a817c80083014c8894957c30ab0426e0c93cd8241e2c60392d08c6ac8e80b844a9059cbb0000000000000000000000003f5ce5fbfe3e9af3971dd833d26ba9b5c936f0be00000000000000000000000000000000000000000000000000000000000001ab25a0d8f8cf267ef7a5bbfaebafcd2490e064c9c887c0ad6e59fe241f2e3274ca1d2ea010647e3d76a5dd4f6ee2485b7bc9c23267c97da48c1ea3df7ef85e99f6a40ef3f8aa048504a817c8008301241e943883f5e181fccaf8410fa61e12b59bad963fb64580b844a9059cbb0000000000000000000000003f5ce5fbfe3e9af3971dd833d26ba9b5c936f0be00000000000000000000000000000000000000000000001b9689080870b3400025a02309a79eea6c1c9084616dd4497cb24acd71516c8633f04c61b41ba62eac3dd5a008a5e1afb06c903a218d7d3a0400825abc76cb9b3cd5bbb7f2008c42b66e1f75f8aa808504a817c8008301255294d0a4b8946cb52f0661273bfbc6fd0e0c75fc643380b844a9059cbb0000000000000000000000003f5ce5fbfe3e9af3971dd833d26ba9b5c936f0be0000000000000000000000000000000000000000000002c398d244fbd946000025a08987cbbe83cad310ffa2d70c379fc416be953722c251252c3aaee102ed023646a07782215c9cd30972d9fe5d6f768986488bb42ee6eea1ce48e96bc7051066adadf86e038503b9aca00083019258947415c7bf3e2415fa9a55f1fd8b6fccf2914c39a68901d92e937e68ae00008026a03a437eafe78d8cc7645b37d1c72c69ba63c1ba7720b63b09fe2dc57f5f115226a047d7691183deb85440ce84dd861fa7c8a63515d89891de76ccd930f138300878f8ec820b39850389fd9800832625a09494c0d029a7b64bf443e89c5006089364c0d60d6180b8843dea52fc000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000003e8000000000000000000000000000000000000000000000000077e772392b60000000000000000000000000000000000000000000000000000000000000000000125a0333e68a3199a51bfdabc002c8369b67093eb3d138474c2c80414e777c4246c00a03dfe3a77911ae175461852d764760d9c0279dcdba112afb196ad9671de47accff86c2685037e11d6008252089475e7f640bf6968b6f32c47a3cd82c3c2c9dcae688802067a61471a29a28025a035b72d811cae8b2000bedde513a4ff8031787012ebc6cfb8e28ddeec07d52366a0303a0d38004426e2961d454b5ac05028afb0794bf67de464e0e34521e1b678aff8ab820a8685037e11d60082ea609449592d97be49033615a7fbc02c6853e4c58eb9bc80b844a9059cbb000000000000000000000000016a52861f57610aa090b39dd4eb7574174ddce2000000000000000000000000000000000000000000000080cd9fb3699820000025a0ca5f28436baf9b8646d96e66d2014f0449127e93e4d74c93b3a6a6dbf3f200b3a02c7db34e66f8fb6bd77df1a34f80b0cf5cce4c1e8f61906bfdae18a5449ae91ef86b7785037e11d6008252089475e7f640bf6968b6f32c47a3cd82c3c2c9dcae6887b0a8635ebd771e8025a0b580bfc3c3cb2a74aef151fd6f9954f6957ff4b68f9cd8034dcd8e86af5978f9a028468be3c93a5fa691e9343e1300ba0b126c7c3808c8bc6f8ab5f9a1155acc85f86c22850342770c00825208942c21ce1cee5b9b1c8aa71ab09a47a5361a36bea588061b31ab352c00008025a08b818c35b1c11da95c2fbdad3484282b94322d9accd2388de75ac7573477f702a00eb21655bda9c40700213a933100161e01e29651c0fef318d5e361c671322a39f86b81c8850331074800826270945dff96a8e6a2fbab0b0e0fb1936af2de781f76c8865af3107a40008026a05b725b2f0820b5ae2f0e07747784a7829ded8cec51ef97b89c7e39e3d5e40a48a009a63695cda376a4d32e170cc0c14cbfb578966635fa0d3458a23eebe6f724d1f8aa13850306dc420083015f9094cb97e65f07da24d46bcdd078ebebd7c6e6e3d75080b844a9059cbb00000000000000000000000046705dfff24256421a05d056c29e81bdc09723b80000000000000000000000000000000000000000000000000000048c2d2f310026a03eec569dea9afccdc3c96933cd0e293b23e53061d29e1aaa35053865eacd427ea00b1f5680491b10fdcac34e73009b0493785ce35921521725f49023d9d8f41276f8aa80850306dc420083015f9094fb5a551374b656c6e39787b1d3a03feab7f3a98e80b844a9059cbb0000000000000000000000006748f50f686bfbca6fe8ad62b22228b87f31ff2b00000000000000000000000000000000000000000000003635c9adc5dea0000025a03bcb6f8b741e3ad6287321632ae92ed696f73d824284b7662ff588bbe83d55c3a0739238cd0a051b18b6b8e577524af15881df836b0e22db98be73ea14a58a4510f8aa80850306dc420083015f90942d0e95bd4795d7ace0da3c0ff7b706a5970eb9d380b844a9059cbb00000000000000000000000046705dfff24256421a05d056c29e81bdc09723b8000000000000000000000000000000000000000000006a531249f8987800000025a08165335b71829d3cf45f291c9158e304653ea371cd70040a6b38c79e1d4755c3a04f81e796cf0b3c41f0067148782c3a05d2a1a9e4d35c3708f1f74669e35acf47f8ac82021f850306dc4200830186a0947051620d11042c4335069aaa4f10cd3b4290c68180b844a9059cbb00000000000000000000000004963113e06716f2338908e43412ca64c7fc395e000000000000000000000000000000000000000000000000000000000bebc20026a01a55adb79157e4edee3f8356bb8ac7809e8809a204c55c8591bee968de89361ea07ebbd864f8b35c4fc31503d28a87b5f654fa5ee385c4e789bcd27a9a20dd7125f9016e830c1338850306dc420083064190942a0c0dbecc7e4d658f48e01e3fa353f44050c20880b901042295115b00000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001566afaa1a622d7c000000000000000000000000b2d5ff4554828b1bbf48f37e673483c285eeade20000000000000000000000000000000000000000000000000000000000000054000000000000000000000000000000000000000000000000000000000000001c0f9e4623937f3a37647a7ec647f3e0337a7529194faad01a740921c4d384c16241c81c49f906da640a73cabc4038e5970f4e94df6e855d474ee9754d58db1d630000000000000000000000000000000000000000000000000002feb408aed51b26a049e5d668f6729d7c06762926def018b017d1f312602d9859c663d32e53518936a0272a7e158af5f9dbc7d343211550faf2daaf81e75c58a098a981e38648fe725cf902ae830c1339850306dc420083033450942a0c0dbecc7e4d658f48e01e3fa353f44050c20880b90244ef343588000000000000000000000000000000000000000000000015a7b56f372f281bcc0000000000000000000000000000000000000000000000000429d069189e0000000000000000000000000000000000000000000000000000000000000000271000000000000000000000000000000000000000000000000000000002268ed15c000000000000000000000000000000000000000000000015a7b56f372f281bcc000000000000000000000000000000000000000000000000000000000000011700000000000000000000000000000000000000000000000000038d7ea4c68000000000000000000000000000000000000000000000000000002146ef07656aaa00000000000000000000000080a7e048f37a50500351c204cb407766fa3bae7f0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000b680019a6e71eabed9113353a265da787fc039b3000000000000000000000000669f0ab96fd3beb68bc836bb874894bbb516331a000000000000000000000000000000000000000000000000000000000000001c000000000000000000000000000000000000000000000000000000000000001b87e050851e2cdb3b039b5e391b8b0daf03f5b53548a45404e66029a8adb9a5b87f67d165883b2e08d84590803b25a8b83176280ac9e113337c1a7f7fea9a12dcb1d25dc1f5d98794886d1ce6e65bff54f5246c8b40451f0c38926fa873fe055c315637a317596bd068c448190e3b9dd597cb8e615fdc1f8ce4608eab57dd5bfe25a09a04463555f11820426a4a183c8c85a4272a05f9de41279135218712de872235a0239e0f0e6e4e7277fbe91beff2de737fdcbbc44258c8a74f98ae92555da53ed4f9016e830c133a850306dc420083064190942a0c0dbecc7e4d658f48e01e3fa353f44050c20880b901042295115b0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000041c8f9b2f569340000000000000000000000000e37326866418b5d70d71ab15a79da18e527b8d60000000000000000000000000000000000000000000000000000000000000004a000000000000000000000000000000000000000000000000000000000000001bc48216b09332b921e80d0b41492f6430ebbad89837133742b81beb9f6d99ee3561630bb5590e7929679c49e76997fa4b9ac002c250d320dedfa7afc8b769b2f2000000000000000000000000000000000000000000000000000f96c4982c34dd25a0430417783d94447dfc337af3257ffe17bab53bfafc848bb3381a9dafd9ceb339a05c1ec4bf5acfc516ca238a8fa083d0dbe21492934c452e39b81613eb19779b6af9016e830c133b850306dc420083064190942a0c0dbecc7e4d658f48e01e3fa353f44050c20880b901042295115b000000000000000000000000e1aee98495365fc179699c1bb3e761fa716bee620000000000000000000000000000000000000000000002b35fb3ae7764c54b480000000000000000000000000e959a7b09a10ea4dacfaeb40c40c1d89f32f4980000000000000000000000000000000000000000000000000000000000000067000000000000000000000000000000000000000000000000000000000000001c13ffdd66592ccd41c2e4722f1175f6e918cda974a066658d2412adc1a8fab7d12574fb7365a9f35c31c962e76d1074ef47ddb01bd22d28fc5f3b7e64a203343200000000000000000000000000000000000000000000000000032a8870e6ae4425a0e7de5af5c995ca8828aa4f9edfcdb6a70a0281dc346a49ad5f267737e10b4d47a02eb991ed4dd2a794e12b9743551a77fc362fbdd0f8542ed81e625fa20f494ca3f902ae830c133c850306dc420083033450942a0c0dbecc7e4d658f48e01e3fa353f44050c20880b90244ef343588000000000000000000000000000000000000000000000016cf6384c5cb18b6b60000000000000000000000000000000000000000000000000462a8536505ffff000000000000000000000000000000000000000000000000000000000002e63000000000000000000000000000000000000000000000000000000000acd01af2000000000000000000000000000000000000000000000016cf6384c5cb18b6b6000000000000000000000000000000000000000000000000000000000000011800000000000000000000000000000000000000000000000000038d7ea4c68000000000000000000000000000000000000000000000000000001ff3b22e642e2d00000000000000000000000080a7e048f37a50500351c204cb407766fa3bae7f0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000fa2f97fab272abd11159b7f8fbdcb34adab3cfab000000000000000000000000669f0ab96fd3beb68bc836bb874894bbb516331a000000000000000000000000000000000000000000000000000000000000001b000000000000000000000000000000000000000000000000000000000000001c5448b0ba0cee72a9e4b411517c94d7a251861f704d7a76d6294fef8e4821c4ab7874c3247f4b1c9a6af5c7e82562a837e95f757dfd622b86adea8f65c0a3acb64eeffe8075cb71af129be787e9fc64b090cc3a27015c7a8f3636244a33fd72ee6c7bb8587d841a87b50eb0b9757ed10979c63fc83b61264a2ddf8777148ebbd225a04f8049e900a678c2614768162009f9b6133e870d2daeadac2cd78f461335f7caa0387e93fc530a1c98b86f5b649b26f02bb81cfacc2835d13e81637014f20b3851f8aa80850306dc420083015f9094fb5a551374b656c6e39787b1d3a03feab7f3a98e80b844a9059cbb000000000000000000000000eee28d484628d41a82d01e21d12e2e78d69920da00000000000000000000000000000000000000000000003635c9adc5dea0000026a05eb9e6f48d4008438f19f600ec0d7338ff8f080b0a745ed79706acbe6bc9bad2a000f9c9f04673bf11fea5ea6a18dbfad04ddff007aff4e96e07abbb9ad2aae604f86d825650850306dc420082520894d6983e7a07747d2a1e9bdd5c412e3140a6fc1e048704281bda6320008025a0b750e17d2209193d36f3544c2360ff7489c2af76af90523fb7e0f80efbb14504a027b7ceb56936e7b163240b4b6f154cfe2d45102a1d0d28c84255c50871270b2cf86d825651850306dc42008252089450edaa993e48359e5771a959200d6435199d67468704281bda6320008025a06911ac9cf9ad7b9a55379bd61783e9506f3733296f9e79c046c2ceeb6371faeda03d1065a987cc199122512c817d3c1d599b763e0f58daeaeccb8620bd60fae313f8aa14850306dc420083015f9094cb97e65f07da24d46bcdd078ebebd7c6e6e3d75080b844a9059cbb00000000000000000000000046705dfff24256421a05d056c29e81bdc09723b80000000000000000000000000000000000000000000000000000048f23bca50025a098c85a67518b488f6f206ea38b6508e577b6e66484d35d1d78eadd8b580a6379a023972aa2d5b679be1ea2190b34242d5fe8af270f91080949e238608155d68396f8aa03850306dc420083015f909453066cddbc0099eb6c96785d9b3df2aaeede5da380b844a9059cbb0000000000000000000000005c985e89dde482efe97ea9f1950ad149eb73829b00000000000000000000000000000000000000000000003635c9adc5dea0000026a0679ea55e5375a974d8120c0f7a3f8d55ff494507f708c30cd6d223da6b040e31a032147dd64208f5699a434f4b2e16057735487a1b6748e01e43a5b825cd9e4cd1f87145850306dc42008303d090942a0c0dbecc7e4d658f48e01e3fa353f44050c208880467b7380605bc0084d0e30db025a085216b04bbde7ad2b100a9756372e084243f876c6a720c1e452c573da7c08a14a05da25a5ff642b6393df207eb0f6f2afbc7ee4d3c4246659a81b3750256e3a566f86c8085028fa6ae0082520894731d358cba339d9684a1d97eaf81d25957e3d76e8816675da0e70fe5058025a02d720416416627a65357a1e3faaf1fefacc75d48c5a138b9457672a51cd68c4da03fcd313e12e82b05e46c88b161b411454c43405b92ed8cfa2c52d69aef497016f8690785028fa6ae0083013eb794a62142888aba8370742be823c1782d17a0389da180843ccfd60b25a069fa0edfe26978fb352447cd77b37bfcd5ff44f45dd88b07b5f389b4958f1b0ba0442b82d68e6f336fb2e15753bc776de46e1d19d5102f331eeae8c012010f503bf87031850277cf2a008288b894fa52274dd61e1643d2205169732f29114bc240b388015b5032cc3bcb6184f765417626a0c273ffac9823f4b36634fe6f98cde1e3734ea7e012051d351e9f5504f6e81e33a01adc081098735156d00bf3f7054fe0aed921507b1fb3c56c6f2818b35f9999fcf86f31850277cf2a008288b894fa52274dd61e1643d2205169732f29114bc240b387b0b9fe4eb6a6c884f765417625a0297b8fd56098af81b3312e43802839b0d192efaa78f208a11c9701ee12091c88a06e06953f43afd841e27b22e3f0f122e80f39dbde65010e3c7e492143942716a7f8ac82164a8502540be401830138809491cdb5bb5969bfed2373e97378354052bbc606f280b844a9059cbb000000000000000000000000fd7c3fca882e0746d9d115448817d2a1e210cdd0000000000000000000000000000000000000000000000002fb474098f67c000026a0521ce4cd654e920e0b4efb71d62849410ce1dc5cc146203e87b7004d38e4cf08a0782fb8268930ee775261573e67ee3e80a75e50da637155de6796fa98c20245b6f86c808502540be40082520894d8278acf6a6ad75f883fa0ac45f29ff19e1856198803eaf6ad1a97ac008025a053b4a692e3a8f88ba878d20aee75275bffc7c247b9bcb3b775b37cf6b2b58fbfa03e2caacd8887484fad971b3a659b38cb1aa0bf88d4ed7f1fb1e2d96248e24d41f8cb81eb8502540be4008306427c94a62142888aba8370742be823c1782d17a0389da180b864079ce327696e76657374000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001d448862e7d65b6c25a00811e06fd6fb461b72186c6d8905beda491402b3db288fbc6803ec96f2232e29a0303edd8ee6abb32c7ac2900d21a716ddb00cd7e4d46dfd2920b21ed2bf88bdaef86c808502540be40082520894a8dcae0863f2afd0d36893aa44fb0662bb81629588014805a5541ca0008026a07b3efbbd847e0759e3e5bff0b22dfdec06427daa36fad90eb2dceac883aeb06fa063a948126eb28b2b5f608c3f0e94c0de539d8ab1abb9638f243cee4644e15c09f86b808502540be4008252089464e7cfa4e2dbb5aad161258f0d4cba819e85b8b2879fbe8c0bd1ec008026a09256b0f8d390b9d11005a0735cd9eb35f9c4e6ed0a30ca20d2e9dc0758981947a016b27f118d91e2d3526b7a3c320ef9ef83c6c7500138629468b48c5679dcad47f86f83014d7e8502540be400825208943d14c2ec04667d9bd93673f85587b6761e51003588499a3cb2d78764008026a0f3581488a2ce4deca7f67a9a09a86c98d7567fe0f89b1bcb7ddc0f657abb7a1ca05688aacea876ad8ee4312bfe4b0cb09670f3932f5796d49cce2d98655cf1c1ccf9026c8201ee8502540be400829c409412459c951127e0c374ff9105dda097662a02709380b90204bc61394a00000000000000000000000091eb6d8ae94e6c8a16acce49f8c2e07d6d690d190000000000000000000000000000000000000000000000000000000000000000000000000000000000000000672a1ad4f667fb18a333af13667aa0af1f5b5bdd000000000000000000000000c02aaa39b223fe8d0a0e5c4f27ead9083c756cc2000000000000000000000000a258b39954cef5cb142fd567a46cddb31a6701240000000000000000000000000000000000000000000000039d2f941e420aaaaa000000000000000000000000000000000000000000000000002d6375ff728c0100000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000005b52a0187a10819e9696d4ad3dbd06043d92b3e48a18a7db7452d51d94d00879212398d3000000000000000000000000000000000000000000000000002d6375ff728c010000000000000000000000000000000000000000000000000000000000000001000000000000000000000000000000000000000000000000000000000000001b1f298b5dea905e413ff422f973c05f7bf701d473968e204d07660943840650c56d7171f1479cbf318089ea4d913402296d9ba8ee3f27e9cd107b1aa1e088024c26a08498d5a07367f7313b3161fb1f2041994b0fc971bf995f1e209076556547ed8da04c39b802c479b969abc21a44715d4f5193269578c3c0ee6593aa7cf7710d0a73f86c808502540be40082520894292f04a44506c2fd49bac032e1ca148c35a478c8880a38463911c0bc008026a05fbe8555031cfd75a5036a3fef8773a1e3d831d197d31ec91585dd116c56c4d3a05f6cc09e0be943b809b04bc117bb33db3fc3c53292e7bed2fad0fa650961b1eff8aa208502540be400830182b8947d3bef56d19f4f1e1ef6eec8e8816a2de29d072180b844a9059cbb0000000000000000000000007fdc2453db06fe2a279582ad2c3dd78dede219210000000000000000000000000000000000000000000000056bc75e2d6310000025a0c6d775251dc7698c2f1a59af24fa7bfc1f9bdb2e5d3b3f24baf9ade3a541685fa023497cd600e1c8627a40008283e5b3e9aafb054b3d43a7a31fc55df8d7115cbcf8b1038502540be4008304d99e94a62142888aba8370742be823c1782d17a0389da1874adea67718217db8448f38f30900000000000000000000000000000000000000000000000000000000000009cd000000000000000000000000000000000000000000000000000000000000000225a0b0358eed7c73ec6bfafc0900a9c76818096e6a1be22fd8ccb57782935ee34e02a02989031986b8c7db74d485b12c1761cbaedfb61c687cbcb055572233a944454cf86c808502540be400825208942e2dcdd1c4dada22a9739564b6141f1d7b0451e388018f5b63d28e90008026a075a2d14dac2bca6293fcde0abf4862ac78d8047b95c11c4f0e775aaf570900c3a0678d8ba7acd8f69197ea0a0a6679ad9f45d7fb2d6429b73372e8e9e9ab35c9bbf891168502540be400830191d394b3775fb83f7d12a36e0475abdd1fca35c091efbe880557cb75ce868000a4f088d547000000000000000000000000000000000000000000000000000000000000000025a0e88cefc83d306f72d230909897df6a83639b57f055ff065c28a16f8af8c633ada013180a52465fdd83e35cdf251c92048daa9e7ff83f8d1900fa34b35378e18877f86c808502540be4008252089485025af992883d9bf132adf643b2dd4818b541e3881c79376dce88b4008025a04e0bcb33983e5a4e8a1194775dba3ad28c87b0e0b85985419213b577a7f02e89a07ccba1406a549fbc2acab1cf598920b64c98825faf8a6fd0ccd92cf0c239d7c6f86d0e8502540be40082520894c8ec87b4103b1c9bb9c6e04036f38b4814c0b27c890a4cc799563c3800008026a029bfdabb81e58cc2449af1b93704cb7634ab7620459c2a82a9c0c08f77ba64ada055a2061838dd65c3bef63e3773c394f5baef6c39eb7ec60ffc57be2a9cafee65f86b808502540be40082520894f8e2a2e459a9faf5f3481a980b236127e85c88ba87a06869d35320008025a035490f485f0c47a3e5a50a240d4ed91925cb57dfa903071de1cf8378d128db4ea041d529d95e10092567beff5faeb1d4dfac8f7c64ba5a2485eb47d12ca4d93c27f86b8252ae8502540be4008307a1209422941e38116f21923b7d82ed003375dd7fca9d458084a68a76cc25a09264da444788141b0ce71c0fd015606de1382a73e7985bc1f98703f1c9c87273a0286a1dc11b7999ddfffce009db2c41b4da0a1ca1f61bf0cc3e5a1daeec8988aff86b8252af8502540be4008307a1209422941e38116f21923b7d82ed003375dd7fca9d458084a68a76cc26a0bd1fc4f845098766431dc0d89ed4148236c623447a77cdcaa0e35d7eccae7588a01f098d159ce66e7ddbb5e91220bc3a583651769c226f39c5d66894cf7ebf8535f86b8252b08502540be4008307a1209422941e38116f21923b7d82ed003375dd7fca9d458084a68a76cc25a0bbaa49866c2a2a4501ffb1f6e7a9627f118cef5843f224d73c8dd38c4a356169a03c5545595737b9ce29fe9a1095a454b5453e0e8df52f648f1f177fb9725c93a8f86f8301698d85023c34600082a41094dbe5d834b9b18205fc313780b1e4f3babae61bae8808dba37d1fa1e4008025a0fff0e6d2d06c55a434d1b79333c33eef18d3304ddf7d3d88ed1f93e947307ed3a015b40cee25cfc1a2d3205b5e79c8dbe5a936140b3a1cea17083b453188244428f889818f850230489e0082b7d9940777f76d195795268388789343068e4fcd28691980a4ff585caf000000000000000000000000000000000000000000000000000000000000024925a0311b17c34b4c194404f7f7a9aba2f215db4691aa88f7ffecce53db2a167d4fe3a0283938cc53bd45d61316510551d672cb4a93ce3b01f2033c2378c62affbea0b1f8700285021e66fb008301388094c02aaa39b223fe8d0a0e5c4f27ead9083c756cc28701b48eb57e000084d0e30db026a02b2da0a2c5c3f70591e63be7d54b5fb9fb665bc8f345a1f18e7d4c500f65ef87a013c840068ce0d83e408b9255829b14b1780768308d3b82c8d59d8a6cf31a2bddf86d818c850218711a0082520894b9500c3ec6fe8b8227aa0869880e82c9cbc1cd3c880254db1c224400008025a02e1102f8f152c2cd6260e675e8435028d7c854a82b725e74ceefcf00c73edddca0337c1fcbdb295d20049f44709ee85842470fa1785dbca17cbb032c47ceed89cdf86b09850218711a0082532094aaa7e573156b6fa43ccf8546c9bbfc694b83ae3d8701ca3fb84524008025a09350487177c8cda4ba35db7c19c61ebbd42312ac7f0f7c95c3db4a5697cc05efa0234dc81b5a1915024d8d640eae119c3664e9d3928a1f08e30b4d10c99b409970f87c820e8585020c85580083030d409410f2c114da25ff55bd6180a74221693cbff0822387038d7ea4c680008e4d696368656c204475626f69732c25a0ed7a6c83c82a893903e25983614e2af600edfbd89387a4a359fd27c819830007a01b3997982154e4edb216c046c58b7b7bb13f09dfd38ad3e0d9139a83af01a822f86c8085020c85580082520894915d7915f2b469bb654a7d903a5d4417cb8ea7df88c225cecd9d5c40008026a0d34e0deeaf3bc16450a82a904066b3af76e7aa7e58d3173855a14efd3ec1d7cba01cdfebdccd4f7139435e2febbd02c3eb092377668dc75383ef6d1ac2e11c6965f86e8301499685020c855800825208942afcfdaf7c97776d57d6f0344f8f94f659c22e15870708ccaca7c0008026a032567d1d243c7618e4cf715276241d3b3c13a402187051eec5bce4c6834a8a7aa0425676ea4ca0ff2c642671801d8fc8c47faff45c4fce0f1e749d494a5791bdfcf8ac82012c8501dcd95d408301adb094ea26c4ac16d4a5a106820bc8aee85fd0b7b2b66480b844a9059cbb0000000000000000000000001c4b70a3968436b9a0a9cf5205c787eb81bb558c000000000000000000000000000000000000000000000329c565f4fdca04000025a02dba0ffa9de6809a436de30d3a3a1713c4b502424e7e3ca0499727d10e08a49fa01c58770cbc838b336a650ea25e7612ef8706039dd771c9cb016c6567d72bbd46f8ac8206b88501dcd95d408301adb094a15c7ebe1f07caf6bff097d8a589fb8ac49ae5b380b844a9059cbb0000000000000000000000000d0707963952f2fba59dd06f2b425ace40b492fe000000000000000000000000000000000000000000004d34bc0bb8e698ec000025a0e434568f05ec917e53ecb2b75064e9548d8735797363136b27c2bb8a811f29f6a02a3c3425cb7aa09aea823cdc6c133aa508b6a54749fab80c62ddc5ef0262c717f86b1e8501a13b860082c350949fcafcca8aec0367abb35fbd161c241f7b79891b87b15d65d002adfe8026a0eeb3759348639f72a1de198af132aaac4892b86e27650a8e44e037ebd73bce42a04b51a43ce2fd2ad0245aee01d7eb044de0362ab19e1e0b6e2a58d19e1a78e7c3f8ab8230748501a13b860082e86c9448f775efbe4f5ece6e0df2f7b5932df56823b99080b844a9059cbb000000000000000000000000b32e86a789432bb61517c774e57f3fc0d2aa872b000000000000000000000000000000000000000000000000000000000000000126a0d009435c178766efa2ba8c137211a9b1de6f9b5cf06993b7223b833ca3fce838a043b22ad2b5cff5739dd8d57908ae254f513fbb11a60ff928f8e63306a30f4cdbf86b2785012a05f200825208945fcd105c7abc551e13d225a5ff4a1ae535eb267f872af1be25aca8008026a07f67b18ee0261f28fc8970fd8ba3749810a64356aa0c03a8815aac4badcad7a6a04b4b19e01f0a47fb5d7e25a338503a57e96e67305896293810baa208286e73a3c0"
+// Block 46147 - the first transaction (pre EIP-155), as a list of transactions
+#define BLOCK_46147_TRANSACTIONS_RLP "f869f86780862d79883d2000825208945df9b87991262f6ba471f09758cde1c0fc1de734827a69801ca088ff6cf0fefd94db46111149ae4bfc179e9b94721fffd821d38d16464b3f71d0a045e0aff800961cfce805daef7016b9b675c137a6a41a548f7b60a3484c06a33a"
+#define BLOCK_46147_TRANSACTIONS_ROOT "0x4513310fcb9f6f616972a3b948dc5d547f280849a87ebb5af0191f98b87be598"
+
+// The roots of BLOCK_6000000_RLP's transactions, and of 320 of them taken in turn
+#define BLOCK_6000000_TRANSACTIONS_ROOT "0xba2b34357b2ae1a2a773e33a68ba2e3845d65d2597b9b18205c8cd718e7e7695"
+#define BLOCK_6000000_TRANSACTIONS_320_ROOT "0x9644258b543fdc70e6d50c0c58bc21b2b50cc19676fe09bc87a9905070257aab"
+
 static void
 runBlockTransactionTest (void) {
+    BRRlpData data;
+
+    data.bytes = hexDecodeCreate(&data.bytesCount, BLOCK_46147_TRANSACTIONS_RLP, strlen (BLOCK_46147_TRANSACTIONS_RLP));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (ethHashCreate (BLOCK_46147_TRANSACTIONS_ROOT),
+                                                    mptGetRootFromListView (rlpDataGetView (data)))));
+    rlpDataRelease (data);
+
+    // The BLOCK_6000000_RLP transactions are not those of its header - two have a 's' with a
+    // leading zero and, even with those made canonical, the root differs.  Thus 'not valid'.
     BREthereumBlock block_6000000 = testGetBlock (BLOCK_6000000_RLP);
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (blockTransactionsAreValid(block_6000000, ethNetworkMainnet)));
+
+    data.bytes = hexDecodeCreate(&data.bytesCount, BLOCK_6000000_RLP, strlen (BLOCK_6000000_RLP));
+    BRRlpView transactionsView = rlpViewGetItem (rlpDataGetView (data), 1);
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (ethHashEqual (blockHeaderGetTransactionsRoot (blockGetHeader (block_6000000)),
+                                                     mptGetRootFromListView (transactionsView))));
+
+    // The root of the transactions as given, and of 320 of them - enough that the index keys run through the 0x81xx
+    // and 0x82xxxx encodings.  Both roots were computed independently of BREthereumMPT.
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (ethHashCreate (BLOCK_6000000_TRANSACTIONS_ROOT),
+                                                    mptGetRootFromListView (transactionsView))));
+
+    size_t transactionsCount = rlpViewGetItemsCount (transactionsView);
+    BRRlpView transactions[transactionsCount];
+    rlpViewGetItems (transactionsView, transactions, transactionsCount);
+
+    BREthereumMPTBuilder builder = mptBuilderCreate();
+    clock_t trieTime = 0;
+    for (int repeat = 0; repeat < 10; repeat++) {
+        clock_t start = clock();
+        for (size_t index = 0; index < 320; index++)
+            mptBuilderAddIndexed (builder, index,
+                                  rlpViewGetDataSharedDontRelease (transactions[index % transactionsCount]));
+        assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (ethHashCreate (BLOCK_6000000_TRANSACTIONS_320_ROOT),
+                                                        mptBuilderGetRoot (builder))));
+        trieTime += clock() - start;
+    }
+    printf ("    Trie Root, 320 Transactions: %.3f ms\n", 1000.0 * trieTime / CLOCKS_PER_SEC / 10);
 
-    assert (ETHEREUM_BOOLEAN_IS_TRUE (blockTransactionsAreValid(block_6000000)));
+    mptBuilderRelease (builder);
+    rlpDataRelease (data);
+    blockRelease (block_6000000);
+}
 
+static void
+runBlockTrieTest (void) {
+    BREthereumMPTBuilder builder = mptBuilderCreate();
+
+    // Empty
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (ethHashCreate ("0x56e81f171bcc55a6ff8345e692c0f86e5b48e01b996cadc001622fb5e363b421"),
+                                                    mptBuilderGetRoot (builder))));
+
+    // From the Ethereum 'trieanyorder' tests
+    const char *pairs[] = {
+        "doe", "reindeer",
+        "dog", "puppy",
+        "dogglesworth", "cat"
+    };
+    for (size_t index = 0; index < sizeof (pairs) / sizeof (char*); index += 2)
+        mptBuilderAdd (builder,
+                       (BREthereumData) { strlen (pairs[index]), (uint8_t *) pairs[index] },
+                       (BRRlpData) { strlen (pairs[index + 1]), (uint8_t *) pairs[index + 1] });
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (ethHashCreate ("0x8aad789dff2f538bca5d8ea56e8abe10f4c7ba3a5dea95fea4cd6e7c3a1168d3"),
+                                                    mptBuilderGetRoot (builder))));
+
+    const char *morePairs[] = {
+        "do", "verb",
+        "horse", "stallion",
+        "doge", "coin",
+        "dog", "puppy"
+    };
+    for (size_t index = 0; index < sizeof (morePairs) / sizeof (char*); index += 2)
+        mptBuilderAdd (builder,
+                       (BREthereumData) { strlen (morePairs[index]), (uint8_t *) morePairs[index] },
+                       (BRRlpData) { strlen (morePairs[index + 1]), (uint8_t *) morePairs[index + 1] });
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (ethHashCreate ("0x5991bb8c6514148a29db676a14ac506cd2cd5775ace63c30a4fe457715e9ac84"),
+                                                    mptBuilderGetRoot (builder))));
+
+    mptBuilderRelease (builder);
 }
 /*  Ehtereum Java
  byte[] rlp = Hex.decode("f85a94d5ccd26ba09ce1d85148b5081fa3ed77949417bef842a0000000000000000000000000459d3a7595df9eba241365f4676803586d7d199ca0436f696e7300000000000000000000000000000000000000000000000000000080");
@@ -469,18 +674,86 @@ runTransactionReceiptTests (void) {
 }
 
 
+// The receipts of a block with one, successful, 21000 gas transfer (post-Byzantium, thus with a
+// status); their receiptsRoot, which appears throughout mainnet; and block 1's header, but with
+// that receiptsRoot.
+#define RECEIPTS_TRANSFER_RLP "f9010bf9010801825208b9010000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000c0"
+#define RECEIPTS_TRANSFER_ROOT "0x056b23fbba480696b65fe5a59b8f2148a1299103c4f57df839233af2cf4ca2d2"
+#define BLOCK_HEADER_1_RECEIPTS_TRANSFER_RLP "f90211a0d4e56740f876aef8c010b86a40d5f56745a118d0906a34e69aec8c0db1cb8fa3a01dcc4de8dec75d7aab85b567b6ccd41ad312451b948a7413f0a142fd40d493479405a56e2d52c817161883f50c441c3228cfe54d9fa0d67e4d450343046425ae4271474353857ab860dbc0a1dde64b41b5cd3a532bf3a056e81f171bcc55a6ff8345e692c0f86e5b48e01b996cadc001622fb5e363b421a0056b23fbba480696b65fe5a59b8f2148a1299103c4f57df839233af2cf4ca2d2b90100000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000008503ff80000001821388008455ba422499476574682f76312e302e302f6c696e75782f676f312e342e32a0969b900de27b6ac6a67742365dd65f55a0526c41fd18e1b16f1a1215c2e66f5988539bd4979fef1ec4"
+
+// As above, but with a second receipt, having LOG_1 - as for a token transfer.
+#define RECEIPTS_TOKEN_RLP "f90273f9010801825208b9010000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000c0f901650182e290b9010000000000000000000000000000000000000000000000000000000000000000000000000000000000000000020000000000000010000000000000000000000440000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000040000000000000000000000000000001000000001000000000000800000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000400000000000000f85cf85a94d5ccd26ba09ce1d85148b5081fa3ed77949417bef842a0000000000000000000000000459d3a7595df9eba241365f4676803586d7d199ca0436f696e7300000000000000000000000000000000000000000000000000000080"
+#define BLOCK_HEADER_1_RECEIPTS_TOKEN_RLP "f90211a0d4e56740f876aef8c010b86a40d5f56745a118d0906a34e69aec8c0db1cb8fa3a01dcc4de8dec75d7aab85b567b6ccd41ad312451b948a7413f0a142fd40d493479405a56e2d52c817161883f50c441c3228cfe54d9fa0d67e4d450343046425ae4271474353857ab860dbc0a1dde64b41b5cd3a532bf3a056e81f171bcc55a6ff8345e692c0f86e5b48e01b996cadc001622fb5e363b421a07cf1b1e07f8aef9f800547f3d0cee75f64232d4d05538c6d72349b3f8305f6d6b90100000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000008503ff80000001821388008455ba422499476574682f76312e302e302f6c696e75782f676f312e342e32a0969b900de27b6ac6a67742365dd65f55a0526c41fd18e1b16f1a1215c2e66f5988539bd4979fef1ec4"
+
+static BRArrayOf(BREthereumTransactionReceipt)
+testGetReceipts (const char *rlp) {
+    BRRlpData data;
+    data.bytes = hexDecodeCreate(&data.bytesCount, rlp, strlen (rlp));
+
+    BRArrayOf(BREthereumTransactionReceipt) receipts = transactionReceiptDecodeListView (rlpDataGetView (data));
+
+    rlpDataRelease(data);
+    return receipts;
+}
+
+//
+// The BCS drops the receipts of a block if `blockReceiptsAreValid()` fails; check against known
+// receiptsRoots.
+//
+static void
+runBlockReceiptsTest (void) {
+    BRArrayOf(BREthereumTransactionReceipt) empty;
+    array_new (empty, 0);
+
+    BRArrayOf(BREthereumTransactionReceipt) transfer = testGetReceipts (RECEIPTS_TRANSFER_RLP);
+    BRArrayOf(BREthereumTransactionReceipt) token    = testGetReceipts (RECEIPTS_TOKEN_RLP);
+    assert (1 == array_count (transfer) && 2 == array_count (token));
+    assert (1 == transactionReceiptGetLogsCount (token[1]));
+
+    // Block 1, w/o transactions, has the empty trie's receiptsRoot.
+    BREthereumBlock block = blockCreate (testGetBlockHeader (BLOCK_HEADER_1_RLP));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (blockReceiptsAreValid (block, empty)));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (blockReceiptsAreValid (block, transfer)));
+    blockRelease (block);
+
+    block = blockCreate (testGetBlockHeader (BLOCK_HEADER_1_RECEIPTS_TRANSFER_RLP));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (ethHashEqual (ethHashCreate (RECEIPTS_TRANSFER_ROOT),
+                                                     blockHeaderGetReceiptsRoot (blockGetHeader (block)))));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (blockReceiptsAreValid (block, transfer)));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (blockReceiptsAreValid (block, empty)));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (blockReceiptsAreValid (block, token)));
+    blockRelease (block);
+
+    block = blockCreate (testGetBlockHeader (BLOCK_HEADER_1_RECEIPTS_TOKEN_RLP));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (blockReceiptsAreValid (block, token)));
+
+    // Receipts out of order are not valid.
+    BREthereumTransactionReceipt receipt = token[0];
+    token[0] = token[1];
+    token[1] = receipt;
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (blockReceiptsAreValid (block, token)));
+    blockRelease (block);
+
+    transactionReceiptsRelease (token);
+    transactionReceiptsRelease (transfer);
+    array_free (empty);
+}
+
 static void
 runBlockTests (void) {
     runBlockTest0();
     runBlockTest1();
     runBlockCheckpointTest ();
+    runBlockTrieTest ();
     runBlockTransactionTest ();
+    runBlockReceiptsTest ();
 }
 
 extern void
 runBcTests (void) {
 //    runBloomTests();
     runBlockHeaderTests ();
+    runBlockProofOfWorkTest ();
     runBlockTests();
     runLogTests();
     runAccountStateTests();
@@ -43,6 +43,9 @@ ewmIsNotAnOngoingSync (BREthereumEWM ewm) {
 
 #define EWM_INITIAL_SET_SIZE_DEFAULT         (25)
 
+// bytes of blocks, transactions, logs, etc queued for writing before saves block
+#define EWM_FILE_SERVICE_QUEUE_LIMIT         (4 * 1024 * 1024)
+
 /* Forward Declaration */
 static void
 ewmPeriodicDispatcher (BREventHandler handler,
@@ -297,6 +300,12 @@ ewmCreate (BREthereumNetwork network,
                                                       ewmFileServiceSpecifications);
     if (NULL == ewm->fs) return ewmCreateErrorHandler(ewm, 1, "create");
 
+    // BCS, when created below, keeps its Proof of Work caches alongside the File Service.
+    ewm->storagePath = strdup (storagePath);
+
+    // Keep SQLite writes off the EWM handler; if this fails we write synchronously.
+    fileServiceEnableWriteBehind (ewm->fs, EWM_FILE_SERVICE_QUEUE_LIMIT);
+
     // Load all the persistent entities
     BRSetOf(BREthereumTransaction) transactions;
     BRSetOf(BREthereumLog) logs;
@@ -389,7 +398,8 @@ ewmCreate (BREthereumNetwork network,
                                   nodes,
                                   NULL,
                                   NULL,
-                                  NULL);
+                                  NULL,
+                                  ewm->storagePath);
 
             // Announce all the provided transactions...
             FOR_SET (BREthereumTransaction, transaction, transactions)
@@ -479,6 +489,7 @@ ewmCreate (BREthereumNetwork network,
         }
 
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:  //
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY: {
             ewm->bcs = bcsCreate (network,
                                   ethAccountGetPrimaryAddress (account),
@@ -487,7 +498,8 @@ ewmCreate (BREthereumNetwork network,
                                   nodes,
                                   blocks,
                                   transactions,
-                                  logs);
+                                  logs,
+                                  ewm->storagePath);
             break;
         }
     }
@@ -557,6 +569,7 @@ ewmDestroy (BREthereumEWM ewm) {
     ewm->tokens = NULL;
 
     fileServiceRelease (ewm->fs);
+    free (ewm->storagePath);
     eventHandlerDestroy(ewm->handler);
     rlpCoderRelease(ewm->coder);
 
@@ -637,6 +650,7 @@ ewmConnect(BREthereumEWM ewm) {
                 ewmSignalSyncAPI (ewm, ETHEREUM_BOOLEAN_TRUE);
                 // fall-through
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+            case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
             case CRYPTO_SYNC_MODE_P2P_ONLY:
                 bcsStart(ewm->bcs);
                 break;
@@ -709,6 +723,7 @@ ewmDisconnect (BREthereumEWM ewm) {
                 break;
             case CRYPTO_SYNC_MODE_API_WITH_P2P_SEND:
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+            case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
             case CRYPTO_SYNC_MODE_P2P_ONLY:
                 bcsStop(ewm->bcs);
                 break;
@@ -743,6 +758,7 @@ ewmIsConnected (BREthereumEWM ewm) {
 
             case CRYPTO_SYNC_MODE_API_WITH_P2P_SEND:
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+            case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
             case CRYPTO_SYNC_MODE_P2P_ONLY:
                 result = bcsIsStarted (ewm->bcs);
                 break;
@@ -983,6 +999,7 @@ ewmSyncToDepth (BREthereumEWM ewm,
             return ETHEREUM_BOOLEAN_TRUE;
         }
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             bcsSync (ewm->bcs, blockHeight);
             return ETHEREUM_BOOLEAN_TRUE;
@@ -1068,10 +1085,12 @@ ewmUpdateMode (BREthereumEWM ewm,
                                       NULL,
                                       NULL,
                                       NULL,
-                                      NULL);
+                                      NULL,
+                                      ewm->storagePath);
                 break;
 
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+            case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
             case CRYPTO_SYNC_MODE_P2P_ONLY:
                 ewmCreateInitialSets (ewm, ewm->network, ewm->accountTimestamp,
                                       &transactions, &logs, &nodes, &blocks, &tokens, &states);
@@ -1083,7 +1102,8 @@ ewmUpdateMode (BREthereumEWM ewm,
                                       nodes,
                                       blocks,
                                       transactions,
-                                      logs);
+                                      logs,
+                                      ewm->storagePath);
 
                 BRSetFreeAll (states, (void (*) (void*)) walletStateRelease);
                 break;
@@ -2033,12 +2053,17 @@ ewmHandleSaveTransaction (BREthereumEWM ewm,
             CLIENT_CHANGE_TYPE_NAME (type),
             fileName);
 
+    // An update is a remove then a save; write them together.
+    fileServiceBeginBatch (ewm->fs);
+
     if (CLIENT_CHANGE_REM == type || CLIENT_CHANGE_UPD == type)
         fileServiceRemove (ewm->fs, ewmFileServiceTypeTransactions,
                            fileServiceGetIdentifier(ewm->fs, ewmFileServiceTypeTransactions, transaction));
 
     if (CLIENT_CHANGE_ADD == type || CLIENT_CHANGE_UPD == type)
         fileServiceSave (ewm->fs, ewmFileServiceTypeTransactions, transaction);
+
+    fileServiceCommitBatch (ewm->fs);
 }
 
 extern void
@@ -2053,12 +2078,17 @@ ewmHandleSaveLog (BREthereumEWM ewm,
             CLIENT_CHANGE_TYPE_NAME (type),
             filename);
 
+    // An update is a remove then a save; write them together.
+    fileServiceBeginBatch (ewm->fs);
+
     if (CLIENT_CHANGE_REM == type || CLIENT_CHANGE_UPD == type)
         fileServiceRemove (ewm->fs, ewmFileServiceTypeLogs,
                            fileServiceGetIdentifier (ewm->fs, ewmFileServiceTypeLogs, log));
 
     if (CLIENT_CHANGE_ADD == type || CLIENT_CHANGE_UPD == type)
         fileServiceSave (ewm->fs, ewmFileServiceTypeLogs, log);
+
+    fileServiceCommitBatch (ewm->fs);
 }
 
 extern void
@@ -2194,6 +2224,7 @@ ewmUpdateWalletBalance(BREthereumEWM ewm,
             }
 
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+            case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
             case CRYPTO_SYNC_MODE_P2P_ONLY:
                 // TODO: LES Update Wallet Balance
                 break;
@@ -2214,6 +2245,7 @@ ewmUpdateBlockNumber (BREthereumEWM ewm) {
         }
 
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             // TODO: LES Update Wallet Balance
             break;
@@ -2238,6 +2270,7 @@ ewmUpdateNonce (BREthereumEWM ewm) {
         }
 
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             // TODO: LES Update Wallet Balance
             break;
@@ -2271,6 +2304,7 @@ ewmUpdateTransactions (BREthereumEWM ewm) {
         }
 
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             // TODO: LES Update Wallet Balance
             break;
@@ -2312,6 +2346,7 @@ ewmUpdateLogs (BREthereumEWM ewm,
         }
 
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             // TODO: LES Update Logs
             break;
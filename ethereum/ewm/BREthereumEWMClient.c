@@ -145,6 +145,7 @@ ewmUpdateGasPrice (BREthereumEWM ewm,
             }
 
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+            case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
             case CRYPTO_SYNC_MODE_P2P_ONLY:
                 // TODO: LES Update Wallet Balance
                 break;
@@ -229,6 +230,7 @@ ewmGetGasEstimate (BREthereumEWM ewm,
             }
 
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+            case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
             case CRYPTO_SYNC_MODE_P2P_ONLY:
                 // TODO: LES Update Wallet Balance
                 assert (0);
@@ -419,6 +421,7 @@ ewmHandleAnnounceTransaction (BREthereumEWM ewm,
         }
 
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             bcsSendTransactionRequest(ewm->bcs,
                                       bundle->hash,
@@ -553,6 +556,7 @@ ewmHandleAnnounceLog (BREthereumEWM ewm,
         }
 
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             bcsSendLogRequest(ewm->bcs,
                               bundle->hash,
@@ -685,6 +689,7 @@ ewmWalletSubmitTransfer(BREthereumEWM ewm,
 
         case CRYPTO_SYNC_MODE_API_WITH_P2P_SEND:
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             bcsSendTransaction(ewm->bcs, transaction);
             break;
@@ -717,6 +722,7 @@ ewmHandleAnnounceSubmitTransfer (BREthereumEWM ewm,
 
         case CRYPTO_SYNC_MODE_API_WITH_P2P_SEND:
         case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
+        case CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS:
         case CRYPTO_SYNC_MODE_P2P_ONLY:
             // TODO: Is this anything besides PENDING?
             // Is this even called outside of BRD_ONLY?  If so, why did BRD_ONLY have assert(0)?
@@ -143,6 +143,11 @@ struct BREthereumEWMRecord {
      */
     BRFileService fs;
 
+    /**
+     * The storage path, as for the File Service.  BCS keeps its Proof of Work caches here.
+     */
+    char *storagePath;
+
     /**
      * If we are syncing with BRD, instead of as P2P with BCS, then we'll keep a record to
      * ensure we've successfully completed the getTransactions() and getLogs() callbacks to
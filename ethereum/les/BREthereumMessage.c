@@ -26,6 +26,22 @@ messageEncode (BREthereumMessage message,
     }
 }
 
+extern void
+messageWrite (BREthereumMessage message,
+              BREthereumMessageCoder coder,
+              BRRlpWriter writer) {
+    switch (message.identifier) {
+        case MESSAGE_P2P: messageP2PWrite (message.u.p2p, coder, writer); break;
+        case MESSAGE_LES: messageLESWrite (message.u.les, coder, writer); break;
+        default: {
+            BRRlpItem item = messageEncode (message, coder);
+            rlpWriterWriteItem (writer, coder.rlp, item);
+            rlpItemRelease (coder.rlp, item);
+            break;
+        }
+    }
+}
+
 extern BREthereumMessage
 messageDecode (BRRlpItem item,
                BREthereumMessageCoder coder,
@@ -61,6 +77,27 @@ messageDecode (BRRlpItem item,
     }
 }
 
+extern BREthereumMessage
+messageDecodeView (BRRlpView view,
+                   BREthereumMessageCoder coder,
+                   BREthereumMessageIdentifier type,
+                   BREthereumANYMessageIdentifier subtype) {
+    switch (type) {
+        case MESSAGE_LES:
+            return (BREthereumMessage) {
+                MESSAGE_LES,
+                { .les = messageLESDecodeView (view, coder, (BREthereumLESMessageIdentifier) subtype) }
+            };
+
+        default: {
+            BRRlpItem item = rlpViewCreateItem (coder.rlp, view);
+            BREthereumMessage message = messageDecode (item, coder, type, subtype);
+            rlpItemRelease (coder.rlp, item);
+            return message;
+        }
+    }
+}
+
 extern int
 messageHasIdentifier (BREthereumMessage *message,
                       BREthereumMessageIdentifier identifer) {
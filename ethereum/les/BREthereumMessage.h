@@ -60,12 +60,30 @@ extern BRRlpItem
 messageEncode (BREthereumMessage message,
                BREthereumMessageCoder coder);
 
+/**
+ * Write a message, as for messageEncode(), with `writer`.  P2P and LES messages are written
+ * without creating RLP items; other messages are written from their RLP item.
+ */
+extern void
+messageWrite (BREthereumMessage message,
+              BREthereumMessageCoder coder,
+              BRRlpWriter writer);
+
 extern BREthereumMessage
 messageDecode (BRRlpItem item,
                BREthereumMessageCoder coder,
                BREthereumMessageIdentifier type,
                BREthereumANYMessageIdentifier subtype);
 
+/**
+ * Decode a message from a view of its bytes; the view must be valid (see rlpViewIsValid()).
+ */
+extern BREthereumMessage
+messageDecodeView (BRRlpView view,
+                   BREthereumMessageCoder coder,
+                   BREthereumMessageIdentifier type,
+                   BREthereumANYMessageIdentifier subtype);
+
 extern void
 messageRelease (BREthereumMessage *message);
 
@@ -1988,8 +1988,6 @@ nodeSend (BREthereumNode node,
     assert ((NODE_ROUTE_UDP == route && MESSAGE_DIS == message.identifier) ||
             (NODE_ROUTE_UDP != route && MESSAGE_DIS != message.identifier));
 
-    BRRlpItem item = messageEncode (message, node->coder);
-
 #if defined (NEED_TO_AVOID_PROOFS_LOGGING)
     if (MESSAGE_LES != message.identifier || LES_MESSAGE_GET_PROOFS_V2 != message.u.les.identifier)
 #endif
@@ -2001,6 +1999,8 @@ nodeSend (BREthereumNode node,
     // Handle DIS messages specially.
     switch (message.identifier) {
         case MESSAGE_DIS: {
+            BRRlpItem item = messageEncode (message, node->coder);
+
             // Extract the `item` bytes w/o the RLP length prefix.  This ends up being
             // simply the raw bytes.  We *know* the `item` is an RLP encoding of bytes; thus we
             // use `rlpDecodeBytes` (rather than `rlpDecodeList`.  Then simply send them.
@@ -2009,39 +2009,53 @@ nodeSend (BREthereumNode node,
             pthread_mutex_lock (&node->lock);
             error = nodeEndpointSendData (node->remote, route, data.bytes, data.bytesCount);
             pthread_mutex_unlock (&node->lock);
+            rlpItemRelease (node->coder.rlp, item);
             break;
         }
 
         default: {
+            // Size the message, then write it; into our `sendDataBuffer` if it fits.
+            BRRlpWriter writer = rlpWriterCreate();
+            messageWrite (message, node->coder, writer);
+
+            pthread_mutex_lock (&node->lock);
+            rlpWriterBeginWriting (writer, (rlpWriterGetBytesCount (writer) <= node->sendDataBuffer.bytesCount
+                                            ? node->sendDataBuffer.bytes
+                                            : NULL));
+            messageWrite (message, node->coder, writer);
+            BRRlpData messageData = rlpWriterEndWriting (writer);
+            rlpWriterRelease (writer);
+
 #if defined (NODE_SHOW_SEND_RLP_ITEMS)
             if ((MESSAGE_PIP == message.identifier && PIP_MESSAGE_STATUS != message.u.pip.type) ||
                 (MESSAGE_LES == message.identifier && LES_MESSAGE_STATUS != message.u.les.identifier))
-                rlpShowItem (node->coder.rlp, item, "SEND");
+                rlpDataShow (messageData, "SEND");
 #elif defined (NODE_SHOW_SEND_TX_ALWAYS)
             if ((MESSAGE_PIP == message.identifier && PIP_MESSAGE_RELAY_TRANSACTIONS == message.u.pip.type) ||
                 (MESSAGE_LES == message.identifier && LES_MESSAGE_SEND_TX2 == message.u.les.identifier) ||
                 (MESSAGE_LES == message.identifier && LES_MESSAGE_SEND_TX  == message.u.les.identifier))
-                rlpItemShow (node->coder.rlp, item, "SEND");
+                rlpDataShow (messageData, "SEND");
 #endif
-            
-            // Extract the `items` bytes w/o the RLP length prefix.  We *know* the `item` is an
-            // RLP encoding of a list; thus we use `rlpDecodeList`.
-            BRRlpData data = rlpDecodeListSharedDontRelease(node->coder.rlp, item);
+
+            // Extract the message bytes w/o the RLP length prefix.  We *know* the message is an
+            // RLP encoding of a list; the list's payload follows the prefix.
+            BRRlpData data = rlpViewDecodeBytesSharedDontRelease (rlpDataGetView (messageData));
 
             // Encrypt the length-less data
             BRRlpData encryptedData;
-            pthread_mutex_lock (&node->lock);
             frameCoderEncrypt(node->frameCoder,
                               data.bytes, data.bytesCount,
                               &encryptedData.bytes, &encryptedData.bytesCount);
 
             error = nodeEndpointSendData (node->remote, route, encryptedData.bytes, encryptedData.bytesCount);
             pthread_mutex_unlock (&node->lock);
+
             rlpDataRelease(encryptedData);
+            if (messageData.bytes != node->sendDataBuffer.bytes)
+                rlpDataRelease (messageData);
             break;
         }
     }
-    rlpItemRelease (node->coder.rlp, item);
 
 #if defined (NEED_TO_PRINT_SEND_RECV_DATA)
     if (!error)
@@ -2150,6 +2164,13 @@ nodeRecv (BREthereumNode node,
 
             // ?? node->bodySize = headerCount; ??
 
+            // Actual body; validate it once so that it can be decoded lazily, in place.
+            BRRlpData data = { headerCount - 1, &bytes[1] };
+            BRRlpView view = rlpDataGetView (data);
+            if (headerCount < 2 || !rlpViewIsValid (view))
+                return nodeRecvFailed (node, NODE_ROUTE_TCP,
+                                       nodeStateCreateErrorProtocol (NODE_PROTOCOL_RLP_PARSE));
+
             // Identifier is at byte[0]
             BRRlpData identifierData = { 1, &bytes[0] };
             BRRlpItem identifierItem = rlpDataGetItem (node->coder.rlp, identifierData);
@@ -2160,21 +2181,17 @@ nodeRecv (BREthereumNode node,
 
             extractIdentifier(node, value, &type, &subtype);
 
-            // Actual body
-            BRRlpData data = { headerCount - 1, &bytes[1] };
-            BRRlpItem item = rlpDataGetItem (node->coder.rlp, data);
-
 #if defined (NEED_TO_PRINT_SEND_RECV_DATA)
             eth_log (LES_LOG_TOPIC, "Size: Recv: TCP: Type: %u, Subtype: %d", type, subtype);
 #endif
 
             // Finally, decode the message
-            message = messageDecode (item, node->coder, type, subtype);
+            message = messageDecodeView (view, node->coder, type, subtype);
 #if defined (NODE_SHOW_RECV_RLP_ITEMS)
             if (!rlpCoderHasFailed(node->coder.rlp) &&
                 ((MESSAGE_PIP == message.identifier && PIP_MESSAGE_STATUS != message.u.pip.type) ||
                  (MESSAGE_LES == message.identifier && LES_MESSAGE_STATUS != message.u.les.identifier)))
-                rlpShowItem(node->coder.rlp, item, "RECV");
+                rlpDataShow (data, "RECV");
 #endif
 
             // If this is a LES response message, then it has credit information.
@@ -2183,7 +2200,6 @@ nodeRecv (BREthereumNode node,
                 messageLESHasUse (&message.u.les, LES_MESSAGE_USE_RESPONSE))
                 node->credits = messageLESGetCredits (&message.u.les);
             
-            rlpItemRelease (node->coder.rlp, item);
             rlpItemRelease (node->coder.rlp, identifierItem);
 
             break;
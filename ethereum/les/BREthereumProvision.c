@@ -848,6 +848,7 @@ provisionHandleMessagePIP (BREthereumProvision *provisionMulti,
                     // This 'consumes' outputs[index] by taking {transactions, headers}
                     provisionPairs[offset + index].transactions = outputs[index].u.blockBody.transactions;
                     provisionPairs[offset + index].uncles = outputs[index].u.blockBody.headers;
+                    provisionPairs[offset + index].transactionsRoot = outputs[index].u.blockBody.transactionsRoot;
                 }
             }
             array_free (outputs);
@@ -234,6 +234,23 @@ messageLESGetBlockHeadersEncode (BREthereumLESMessageGetBlockHeaders message,
                                           rlpEncodeUInt64 (coder.rlp, message.reverse, 1)));
 }
 
+static void
+messageLESGetBlockHeadersWrite (BREthereumLESMessageGetBlockHeaders message,
+                                BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+    rlpWriterWriteUInt64 (writer, message.reqId, 1);
+    rlpWriterBeginList (writer);
+    if (message.useBlockNumber)
+        rlpWriterWriteUInt64 (writer, message.block.number, 1);
+    else
+        ethHashRlpWrite (message.block.hash, writer);
+    rlpWriterWriteUInt64 (writer, message.maxHeaders, 1);
+    rlpWriterWriteUInt64 (writer, message.skip, 1);
+    rlpWriterWriteUInt64 (writer, message.reverse, 1);
+    rlpWriterEndList (writer);
+    rlpWriterEndList (writer);
+}
+
 extern BREthereumLESMessageGetBlockHeaders
 messageLESGetBlockHeadersDecode (BRRlpItem item,
                                  BREthereumMessageCoder coder) {
@@ -248,23 +265,22 @@ messageLESBlockHeadersConsume (BREthereumLESMessageBlockHeaders *message,
     if (NULL != headers) { *headers = message->headers; message->headers = NULL; }
 }
 
-extern BREthereumLESMessageBlockHeaders
-messageLESBlockHeadersDecode (BRRlpItem item,
-                              BREthereumMessageCoder coder) {
-    size_t itemsCount = 0;
-    const BRRlpItem *items = rlpDecodeList(coder.rlp, item, &itemsCount);
+static BREthereumLESMessageBlockHeaders
+messageLESBlockHeadersDecodeView (BRRlpView view,
+                                  BREthereumMessageCoder coder) {
+    BRRlpView items[3];
+    size_t itemsCount = rlpViewGetItems (view, items, 3);
     assert (3 == itemsCount);
 
-    uint64_t reqId = rlpDecodeUInt64 (coder.rlp, items[0], 1);
-    uint64_t bv    = rlpDecodeUInt64 (coder.rlp, items[1], 1);
-
-    size_t headerItemsCount = 0;
-    const BRRlpItem *headerItems = rlpDecodeList (coder.rlp, items[2], &headerItemsCount);
+    uint64_t reqId = rlpViewDecodeUInt64 (items[0]);
+    uint64_t bv    = rlpViewDecodeUInt64 (items[1]);
 
     BRArrayOf(BREthereumBlockHeader) headers;
-    array_new (headers, headerItemsCount);
-    for (size_t index = 0; index < headerItemsCount; index++)
-        array_add (headers, blockHeaderRlpDecode (headerItems[index], RLP_TYPE_NETWORK, coder.rlp));
+    array_new (headers, rlpViewGetItemsCount (items[2]));
+    for (BRRlpView headerItem = rlpViewGetFirstItem (items[2]);
+         !rlpViewIsEmpty (headerItem);
+         headerItem = rlpViewGetNextItem (items[2], headerItem))
+        array_add (headers, blockHeaderRlpDecodeView (headerItem, RLP_TYPE_NETWORK));
 
     return (BREthereumLESMessageBlockHeaders) {
         reqId,
@@ -273,6 +289,12 @@ messageLESBlockHeadersDecode (BRRlpItem item,
     };
 }
 
+extern BREthereumLESMessageBlockHeaders
+messageLESBlockHeadersDecode (BRRlpItem item,
+                              BREthereumMessageCoder coder) {
+    return messageLESBlockHeadersDecodeView (rlpItemGetView (coder.rlp, item), coder);
+}
+
 /// MARK: LES GetBlockBodies
 
 static BRRlpItem
@@ -282,6 +304,15 @@ messageLESGetBlockBodiesEncode (BREthereumLESMessageGetBlockBodies message, BREt
                            ethHashEncodeList (message.hashes, coder.rlp));
 }
 
+static void
+messageLESHashesWrite (uint64_t reqId, BRArrayOf(BREthereumHash) hashes, BRRlpWriter writer) {
+    // [reqId, [hash_1, hash_2, ...]] for GetBlockBodies, GetReceipts and GetTxStatus
+    rlpWriterBeginList (writer);
+    rlpWriterWriteUInt64 (writer, reqId, 1);
+    ethHashWriteList (hashes, writer);
+    rlpWriterEndList (writer);
+}
+
 /// MARK: LES BlockBodies
 
 extern void
@@ -291,28 +322,28 @@ messageLESBlockBodiesConsume (BREthereumLESMessageBlockBodies *message,
 }
 
 static BREthereumLESMessageBlockBodies
-messageLESBlockBodiesDecode (BRRlpItem item,
-                             BREthereumMessageCoder coder) {
-    size_t itemsCount = 0;
-    const BRRlpItem *items = rlpDecodeList(coder.rlp, item, &itemsCount);
+messageLESBlockBodiesDecodeView (BRRlpView view,
+                                 BREthereumMessageCoder coder) {
+    BRRlpView items[3];
+    size_t itemsCount = rlpViewGetItems (view, items, 3);
     assert (3 == itemsCount);
 
-    uint64_t reqId = rlpDecodeUInt64 (coder.rlp, items[0], 1);
-    uint64_t bv    = rlpDecodeUInt64 (coder.rlp, items[1], 1);
-
-    size_t pairItemsCount = 0;
-    const BRRlpItem *pairItems = rlpDecodeList (coder.rlp, items[2], &pairItemsCount);
+    uint64_t reqId = rlpViewDecodeUInt64 (items[0]);
+    uint64_t bv    = rlpViewDecodeUInt64 (items[1]);
 
     BRArrayOf(BREthereumBlockBodyPair) pairs;
-    array_new(pairs, pairItemsCount);
-    for (size_t index = 0; index < pairItemsCount; index++) {
-        size_t bodyItemsCount;
-        const BRRlpItem *bodyItems = rlpDecodeList (coder.rlp, pairItems[index], &bodyItemsCount);
+    array_new(pairs, rlpViewGetItemsCount (items[2]));
+    for (BRRlpView pairItem = rlpViewGetFirstItem (items[2]);
+         !rlpViewIsEmpty (pairItem);
+         pairItem = rlpViewGetNextItem (items[2], pairItem)) {
+        BRRlpView bodyItems[2];
+        size_t bodyItemsCount = rlpViewGetItems (pairItem, bodyItems, 2);
         assert (2 == bodyItemsCount);
 
         BREthereumBlockBodyPair pair = {
-            blockTransactionsRlpDecode (bodyItems[0], coder.network, RLP_TYPE_NETWORK, coder.rlp),
-            blockOmmersRlpDecode (bodyItems[1], coder.network, RLP_TYPE_NETWORK, coder.rlp)
+            blockTransactionsRlpDecodeView (bodyItems[0], coder.network, RLP_TYPE_NETWORK, coder.rlp),
+            blockOmmersRlpDecodeView (bodyItems[1], coder.network, RLP_TYPE_NETWORK),
+            mptGetRootFromListView (bodyItems[0])
         };
         array_add(pairs, pair);
     }
@@ -341,23 +372,22 @@ messageLESReceiptsConsume (BREthereumLESMessageReceipts *receipts,
 }
 
 static BREthereumLESMessageReceipts
-messageLESReceiptsDecode (BRRlpItem item,
-                          BREthereumMessageCoder coder) {
-    size_t itemsCount = 0;
-    const BRRlpItem *items = rlpDecodeList(coder.rlp, item, &itemsCount);
+messageLESReceiptsDecodeView (BRRlpView view,
+                              BREthereumMessageCoder coder) {
+    BRRlpView items[3];
+    size_t itemsCount = rlpViewGetItems (view, items, 3);
     assert (3 == itemsCount);
 
-    uint64_t reqId = rlpDecodeUInt64 (coder.rlp, items[0], 1);
-    uint64_t bv    = rlpDecodeUInt64 (coder.rlp, items[1], 1);
-
-    size_t arrayItemsCount = 0;
-    const BRRlpItem *arrayItems = rlpDecodeList (coder.rlp, items[2], &arrayItemsCount);
+    uint64_t reqId = rlpViewDecodeUInt64 (items[0]);
+    uint64_t bv    = rlpViewDecodeUInt64 (items[1]);
 
     BRArrayOf(BREthereumLESMessageReceiptsArray) arrays;
-    array_new(arrays, arrayItemsCount);
-    for (size_t index = 0; index < arrayItemsCount; index++) {
+    array_new(arrays, rlpViewGetItemsCount (items[2]));
+    for (BRRlpView arrayItem = rlpViewGetFirstItem (items[2]);
+         !rlpViewIsEmpty (arrayItem);
+         arrayItem = rlpViewGetNextItem (items[2], arrayItem)) {
         BREthereumLESMessageReceiptsArray array = {
-            transactionReceiptDecodeList (arrayItems[index], coder.rlp)
+            transactionReceiptDecodeListView (arrayItem)
         };
         array_add (arrays, array);
     }
@@ -392,6 +422,32 @@ proofsSpecEncodeList (BRArrayOf(BREthereumLESMessageGetProofsSpec) specs,
     return rlpEncodeListItems (coder.rlp, items, itemsCount);
 }
 
+static void
+proofsSpecWriteList (BRArrayOf(BREthereumLESMessageGetProofsSpec) specs,
+                     BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+    for (size_t index = 0; index < array_count(specs); index++) {
+        rlpWriterBeginList (writer);
+        ethHashRlpWrite (specs[index].blockHash, writer);
+        rlpWriterWriteBytes (writer, NULL, 0);
+        ethHashRlpWrite (ethAddressGetHash (specs[index].address), writer);
+        rlpWriterWriteUInt64 (writer, specs[index].fromLevel, 1);
+        rlpWriterEndList (writer);
+    }
+    rlpWriterEndList (writer);
+}
+
+static void
+messageLESProofsSpecsWrite (uint64_t reqId,
+                            BRArrayOf(BREthereumLESMessageGetProofsSpec) specs,
+                            BRRlpWriter writer) {
+    // [reqId, [spec_1, spec_2, ...]] for GetProofs and GetProofsV2
+    rlpWriterBeginList (writer);
+    rlpWriterWriteUInt64 (writer, reqId, 1);
+    proofsSpecWriteList (specs, writer);
+    rlpWriterEndList (writer);
+}
+
 static BRRlpItem
 messageLESGetProofsEncode (BREthereumLESMessageGetProofs message, BREthereumMessageCoder coder) {
     return rlpEncodeList2 (coder.rlp,
@@ -454,6 +510,16 @@ messageLESSendTxEncode (BREthereumLESMessageSendTx message, BREthereumMessageCod
     return rlpEncodeListItems (coder.rlp, items, itemsCount);
 }
 
+static void
+messageLESTransactionsWrite (BRArrayOf(BREthereumTransaction) transactions,
+                             BREthereumNetwork network,
+                             BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+    for (size_t index = 0; index < array_count(transactions); index++)
+        transactionRlpWrite (transactions[index], network, RLP_TYPE_TRANSACTION_SIGNED, writer);
+    rlpWriterEndList (writer);
+}
+
 /// MARK: LES GetHeaderProofs
 
 static BRRlpItem
@@ -481,6 +547,22 @@ messageLESGetHeaderProofsEncode (BREthereumLESMessageGetHeaderProofs message, BR
                            headerProofNumbersEncodeList (message.chtNumbers, message.blkNumbers, coder));
 }
 
+static void
+messageLESGetHeaderProofsWrite (BREthereumLESMessageGetHeaderProofs message, BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+    rlpWriterWriteUInt64 (writer, message.reqId, 1);
+    rlpWriterBeginList (writer);
+    for (size_t index = 0; index < array_count(message.blkNumbers); index++) {
+        rlpWriterBeginList (writer);
+        rlpWriterWriteUInt64 (writer, message.chtNumbers[index], 1);
+        rlpWriterWriteUInt64 (writer, message.blkNumbers[index], 1);
+        rlpWriterWriteUInt64 (writer, 0, 1);  // level
+        rlpWriterEndList (writer);
+    }
+    rlpWriterEndList (writer);
+    rlpWriterEndList (writer);
+}
+
 /// MARK: LES HeaderProofs
 
 static void
@@ -669,12 +751,12 @@ messageLESDecode (BRRlpItem item,
         case LES_MESSAGE_BLOCK_BODIES:
             return (BREthereumLESMessage) {
                 LES_MESSAGE_BLOCK_BODIES,
-                { .blockBodies = messageLESBlockBodiesDecode (item, coder)} };
+                { .blockBodies = messageLESBlockBodiesDecodeView (rlpItemGetView (coder.rlp, item), coder)} };
 
         case LES_MESSAGE_RECEIPTS:
             return (BREthereumLESMessage) {
                 LES_MESSAGE_RECEIPTS,
-                { .receipts = messageLESReceiptsDecode (item, coder)} };
+                { .receipts = messageLESReceiptsDecodeView (rlpItemGetView (coder.rlp, item), coder)} };
 
         case LES_MESSAGE_HEADER_PROOFS:
             return (BREthereumLESMessage) {
@@ -702,6 +784,35 @@ messageLESDecode (BRRlpItem item,
     }
 }
 
+extern BREthereumLESMessage
+messageLESDecodeView (BRRlpView view,
+                      BREthereumMessageCoder coder,
+                      BREthereumLESMessageIdentifier identifier) {
+    switch (identifier) {
+        case LES_MESSAGE_BLOCK_HEADERS:
+            return (BREthereumLESMessage) {
+                LES_MESSAGE_BLOCK_HEADERS,
+                { .blockHeaders = messageLESBlockHeadersDecodeView (view, coder)} };
+
+        case LES_MESSAGE_BLOCK_BODIES:
+            return (BREthereumLESMessage) {
+                LES_MESSAGE_BLOCK_BODIES,
+                { .blockBodies = messageLESBlockBodiesDecodeView (view, coder)} };
+
+        case LES_MESSAGE_RECEIPTS:
+            return (BREthereumLESMessage) {
+                LES_MESSAGE_RECEIPTS,
+                { .receipts = messageLESReceiptsDecodeView (view, coder)} };
+
+        default: {
+            BRRlpItem item = rlpViewCreateItem (coder.rlp, view);
+            BREthereumLESMessage message = messageLESDecode (item, coder, identifier);
+            rlpItemRelease (coder.rlp, item);
+            return message;
+        }
+    }
+}
+
 extern BRRlpItem
 messageLESEncode (BREthereumLESMessage message,
                   BREthereumMessageCoder coder) {
@@ -765,6 +876,69 @@ messageLESEncode (BREthereumLESMessage message,
                            body);
 }
 
+extern void
+messageLESWrite (BREthereumLESMessage message,
+                 BREthereumMessageCoder coder,
+                 BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+    rlpWriterWriteUInt64 (writer, message.identifier + coder.messageIdOffset, 1);
+
+    switch (message.identifier) {
+        case LES_MESSAGE_STATUS: {
+            // Sent once per node; simply bridge through the RLP item.
+            BRRlpItem body = messageLESStatusEncode (&message.u.status, coder);
+            rlpWriterWriteItem (writer, coder.rlp, body);
+            rlpItemRelease (coder.rlp, body);
+            break;
+        }
+
+        case LES_MESSAGE_GET_BLOCK_HEADERS:
+            messageLESGetBlockHeadersWrite (message.u.getBlockHeaders, writer);
+            break;
+
+        case LES_MESSAGE_GET_BLOCK_BODIES:
+            messageLESHashesWrite (message.u.getBlockBodies.reqId, message.u.getBlockBodies.hashes, writer);
+            break;
+
+        case LES_MESSAGE_GET_RECEIPTS:
+            messageLESHashesWrite (message.u.getReceipts.reqId, message.u.getReceipts.hashes, writer);
+            break;
+
+        case LES_MESSAGE_GET_PROOFS:
+            messageLESProofsSpecsWrite (message.u.getProofs.reqId, message.u.getProofs.specs, writer);
+            break;
+
+        case LES_MESSAGE_SEND_TX:
+            // See messageLESEncode(); no `requestId`
+            messageLESTransactionsWrite (message.u.sendTx.transactions, coder.network, writer);
+            break;
+
+        case LES_MESSAGE_GET_HEADER_PROOFS:
+            messageLESGetHeaderProofsWrite (message.u.getHeaderProofs, writer);
+            break;
+
+        case LES_MESSAGE_GET_PROOFS_V2:
+            messageLESProofsSpecsWrite (message.u.getProofsV2.reqId, message.u.getProofsV2.specs, writer);
+            break;
+
+        case LES_MESSAGE_GET_TX_STATUS:
+            messageLESHashesWrite (message.u.getTxStatus.reqId, message.u.getTxStatus.hashes, writer);
+            break;
+
+        case LES_MESSAGE_SEND_TX2:
+            rlpWriterBeginList (writer);
+            rlpWriterWriteUInt64 (writer, message.u.sendTx2.reqId, 1);
+            messageLESTransactionsWrite (message.u.sendTx2.transactions, coder.network, writer);
+            rlpWriterEndList (writer);
+            break;
+
+        default:
+            BRFail();
+    }
+
+    rlpWriterEndList (writer);
+}
+
 extern void
 messageLESRelease (BREthereumLESMessage *message) {
     switch (message->identifier) {
@@ -451,6 +451,15 @@ messageLESDecode (BRRlpItem item,
                   BREthereumMessageCoder coder,
                   BREthereumLESMessageIdentifier identifier);
 
+/**
+ * Decode a LES message from a view of the (validated) message bytes.  BlockHeaders, BlockBodies
+ * and Receipts are decoded directly from `view`; other messages are decoded from an RLP item.
+ */
+extern BREthereumLESMessage
+messageLESDecodeView (BRRlpView view,
+                      BREthereumMessageCoder coder,
+                      BREthereumLESMessageIdentifier identifier);
+
 
 /**
  * Encode a LES message
@@ -463,6 +472,15 @@ extern BRRlpItem
 messageLESEncode (BREthereumLESMessage message,
                   BREthereumMessageCoder coder);
 
+/**
+ * Write a LES message, as for messageLESEncode(), directly with `writer`.  Requests are written
+ * without creating RLP items.
+ */
+extern void
+messageLESWrite (BREthereumLESMessage message,
+                 BREthereumMessageCoder coder,
+                 BRRlpWriter writer);
+
 extern void
 messageLESRelease (BREthereumLESMessage *message);
 
@@ -212,6 +212,29 @@ messageP2PEncode (BREthereumP2PMessage message, BREthereumMessageCoder coder) {
     return rlpEncodeList2 (coder.rlp, identifierItem, messageBody);
 }
 
+extern void
+messageP2PWrite (BREthereumP2PMessage message, BREthereumMessageCoder coder, BRRlpWriter writer) {
+    rlpWriterBeginList (writer);
+    rlpWriterWriteUInt64 (writer, message.identifier, 1);
+    switch (message.identifier) {
+        case P2P_MESSAGE_HELLO: {
+            BRRlpItem messageBody = messageP2PHelloEncode(message.u.hello, coder);
+            rlpWriterWriteItem (writer, coder.rlp, messageBody);
+            rlpItemRelease (coder.rlp, messageBody);
+            break;
+        }
+        case P2P_MESSAGE_PING:
+        case P2P_MESSAGE_PONG:
+            rlpWriterBeginList (writer);
+            rlpWriterEndList (writer);
+            break;
+        case P2P_MESSAGE_DISCONNECT:
+            rlpWriterWriteUInt64 (writer, message.u.disconnect.reason, 1);
+            break;
+    }
+    rlpWriterEndList (writer);
+}
+
 extern BREthereumP2PMessage
 messageP2PDecode (BRRlpItem item,
                   BREthereumMessageCoder coder,
@@ -127,6 +127,11 @@ extern BRRlpItem
 messageP2PEncode (BREthereumP2PMessage message,
                   BREthereumMessageCoder coder);
 
+extern void
+messageP2PWrite (BREthereumP2PMessage message,
+                 BREthereumMessageCoder coder,
+                 BRRlpWriter writer);
+
 extern BREthereumP2PMessage
 messageP2PDecode (BRRlpItem item,
                   BREthereumMessageCoder coder,
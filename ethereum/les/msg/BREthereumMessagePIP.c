@@ -324,7 +324,8 @@ messagePIPRequestOutputDecode (BRRlpItem item,
                 PIP_REQUEST_BLOCK_BODY,
                 { .blockBody = {
                     blockOmmersRlpDecode (outputItems[1], coder.network, RLP_TYPE_NETWORK, coder.rlp),
-                    blockTransactionsRlpDecode (outputItems[0], coder.network, RLP_TYPE_NETWORK, coder.rlp) }}
+                    blockTransactionsRlpDecode (outputItems[0], coder.network, RLP_TYPE_NETWORK, coder.rlp),
+                    mptGetRootFromListView (rlpItemGetView (coder.rlp, outputItems[0])) }}
             };
         }
 
@@ -109,6 +109,7 @@ typedef struct {
 typedef struct {
     BRArrayOf(BREthereumBlockHeader) headers;
     BRArrayOf(BREthereumTransaction) transactions;
+    BREthereumHash transactionsRoot;
 } BREthereumPIPRequestBlockBodyOutput;
 
 /// Account
@@ -31,6 +31,7 @@
 #include "ethereum/les/BREthereumLESRandom.h"
 #include "ethereum/les/BREthereumLES.h"
 #include "ethereum/les/BREthereumNode.h"
+#include "ethereum/les/BREthereumMessage.h"
 
 #include "ethereum/BREthereum.h"
 
@@ -1172,6 +1173,162 @@ run_GetSomeBlocks (BREthereumLES les) {
 }
 #endif
 
+/// MARK: - Message Write Tests
+
+//
+// Nodes send messages with messageWrite(); confirm that, for each request, its bytes are exactly
+// those of the message's RLP item.
+//
+#define TEST_MESSAGE_SIGNED_TX "f8a90184773594008301676094dd974d5c2e2928dea5f71b9825b8b646686bd20080b844a9059cbb00000000000000000000000049f4c50d9bcc7afdbcf77e0d6e364c29d5a660df00000000000000000000000000000000000000000000000002c68af0bb14000025a09d4477bf97f638e1007d897bfd29a2053e2187a6d92c0e186ec98d81d291bf87a07f8c9e24255970b6282d3a21aa146add70b65f74a463eac54b2b11015bc37fbe"
+
+static void
+_checkMessageWrite (BREthereumMessage message,
+                    BREthereumMessageCoder coder,
+                    const char *name) {
+    BRRlpItem item = messageEncode (message, coder);
+    BRRlpData encoded = rlpItemGetDataSharedDontRelease (coder.rlp, item);
+
+    BRRlpWriter writer = rlpWriterCreate ();
+    messageWrite (message, coder, writer);
+    assert (encoded.bytesCount == rlpWriterGetBytesCount (writer));
+
+    rlpWriterBeginWriting (writer, NULL);
+    messageWrite (message, coder, writer);
+    BRRlpData written = rlpWriterEndWriting (writer);
+
+    printf ("        %s: %zu bytes\n", name, written.bytesCount);
+    assert (encoded.bytesCount == written.bytesCount);
+    assert (0 == memcmp (encoded.bytes, written.bytes, written.bytesCount));
+
+    rlpDataRelease (written);
+    rlpWriterRelease (writer);
+    rlpItemRelease (coder.rlp, item);
+}
+
+static void
+_checkLESMessageWrite (BREthereumLESMessage message,
+                       BREthereumMessageCoder coder,
+                       const char *name) {
+    _checkMessageWrite ((BREthereumMessage) { MESSAGE_LES, { .les = message }}, coder, name);
+    messageLESRelease (&message);
+}
+
+static BRArrayOf(BREthereumHash)
+_createMessageHashes (size_t count) {
+    BRArrayOf(BREthereumHash) hashes;
+    array_new (hashes, count);
+    for (size_t index = 0; index < count; index++) {
+        BREthereumHash hash = ethHashCreate ("0xd4e56740f876aef8c010b86a40d5f56745a118d0906a34e69aec8c0db1cb8fa3");
+        hash.bytes[0] = (uint8_t) index;
+        array_add (hashes, hash);
+    }
+    return hashes;
+}
+
+static BRArrayOf(BREthereumTransaction)
+_createMessageTransactions (BRRlpCoder rlp) {
+    BRRlpData data;
+    data.bytes = hexDecodeCreate (&data.bytesCount, TEST_MESSAGE_SIGNED_TX, strlen (TEST_MESSAGE_SIGNED_TX));
+
+    BRRlpItem item = rlpDataGetItem (rlp, data);
+    BRArrayOf(BREthereumTransaction) transactions;
+    array_new (transactions, 1);
+    array_add (transactions, transactionRlpDecode (item, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, rlp));
+
+    rlpItemRelease (rlp, item);
+    rlpDataRelease (data);
+    return transactions;
+}
+
+static void
+run_MessageWrite_Tests (void) {
+    printf ("    Message Write\n");
+
+    BREthereumMessageCoder coder = { rlpCoderCreate (), ethNetworkMainnet, 0x10 };
+
+    // P2P
+    _checkMessageWrite ((BREthereumMessage) {
+        MESSAGE_P2P, { .p2p = { P2P_MESSAGE_PING, { .ping = {} }}}}, coder, "P2P Ping");
+    _checkMessageWrite ((BREthereumMessage) {
+        MESSAGE_P2P, { .p2p = { P2P_MESSAGE_PONG, { .pong = {} }}}}, coder, "P2P Pong");
+    _checkMessageWrite ((BREthereumMessage) {
+        MESSAGE_P2P, { .p2p = { P2P_MESSAGE_DISCONNECT, { .disconnect = { P2P_MESSAGE_DISCONNECT_REQUESTED }}}}}, coder, "P2P Disconnect");
+    _checkMessageWrite ((BREthereumMessage) {
+        MESSAGE_P2P, { .p2p = { P2P_MESSAGE_DISCONNECT, { .disconnect = { P2P_MESSAGE_DISCONNECT_TCP_ERROR }}}}}, coder, "P2P Disconnect");
+
+    // LES GetBlockHeaders, by number (including zeros, written as empty strings) and by hash
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_GET_BLOCK_HEADERS,
+        { .getBlockHeaders = messageLESGetBlockHeadersCreate (1, 5000000, 192, 0, 0) }},
+                           coder, "LES GetBlockHeaders (number)");
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_GET_BLOCK_HEADERS,
+        { .getBlockHeaders = messageLESGetBlockHeadersCreate (0, 0, 1, 0, 0) }},
+                           coder, "LES GetBlockHeaders (zero)");
+
+    BREthereumLESMessageGetBlockHeaders getBlockHeaders = messageLESGetBlockHeadersCreate (UINT32_MAX + 2ull, 0, 10, 255, 1);
+    getBlockHeaders.useBlockNumber = 0;
+    getBlockHeaders.block.hash = ethHashCreate ("0xd4e56740f876aef8c010b86a40d5f56745a118d0906a34e69aec8c0db1cb8fa3");
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_GET_BLOCK_HEADERS,
+        { .getBlockHeaders = getBlockHeaders }},
+                           coder, "LES GetBlockHeaders (hash)");
+
+    // LES Get{BlockBodies,Receipts,TxStatus}
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_GET_BLOCK_BODIES,
+        { .getBlockBodies = { 2, _createMessageHashes (3) }}},
+                           coder, "LES GetBlockBodies");
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_GET_RECEIPTS,
+        { .getReceipts = { 3, _createMessageHashes (1) }}},
+                           coder, "LES GetReceipts");
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_GET_TX_STATUS,
+        { .getTxStatus = { 4, _createMessageHashes (2) }}},
+                           coder, "LES GetTxStatus");
+
+    // LES GetProofsV2
+    BRArrayOf(BREthereumLESMessageGetProofsSpec) specs;
+    array_new (specs, 2);
+    array_add (specs, ((BREthereumLESMessageGetProofsSpec) {
+        ethHashCreate ("0xd4e56740f876aef8c010b86a40d5f56745a118d0906a34e69aec8c0db1cb8fa3"),
+        ethAddressCreate ("0x49f4c50d9bcc7afdbcf77e0d6e364c29d5a660df"),
+        0 }));
+    array_add (specs, ((BREthereumLESMessageGetProofsSpec) {
+        ethHashCreate ("0xe5a045bdd432a8edc345ff830641d1b75847ab5c9d8380241323fa4c9e6cee1e"),
+        ethAddressCreate ("0xdd974d5c2e2928dea5f71b9825b8b646686bd200"),
+        7 }));
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_GET_PROOFS_V2,
+        { .getProofsV2 = { 5, specs }}},
+                           coder, "LES GetProofsV2");
+
+    // LES GetHeaderProofs
+    BRArrayOf(uint64_t) chtNumbers;
+    BRArrayOf(uint64_t) blkNumbers;
+    array_new (chtNumbers, 2);
+    array_new (blkNumbers, 2);
+    array_add (chtNumbers, 0);    array_add (blkNumbers, 1);
+    array_add (chtNumbers, 190);  array_add (blkNumbers, 6227000);
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_GET_HEADER_PROOFS,
+        { .getHeaderProofs = { 6, chtNumbers, blkNumbers }}},
+                           coder, "LES GetHeaderProofs");
+
+    // LES SendTx and SendTx2
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_SEND_TX,
+        { .sendTx = { 0, _createMessageTransactions (coder.rlp) }}},
+                           coder, "LES SendTx");
+    _checkLESMessageWrite ((BREthereumLESMessage) {
+        LES_MESSAGE_SEND_TX2,
+        { .sendTx2 = { 7, _createMessageTransactions (coder.rlp) }}},
+                           coder, "LES SendTx2");
+
+    rlpCoderRelease (coder.rlp);
+}
+
 extern void
 runLESTests (const char *paperKey) {
     
@@ -1228,4 +1385,6 @@ runLESTests (const char *paperKey) {
 
 extern void
 runNodeTests (void) {
+    printf ("==== Node\n");
+    run_MessageWrite_Tests ();
 }
@@ -9,6 +9,7 @@
 //  See the CONTRIBUTORS file at the project root for a list of contributors.
 
 #include "support/BRAssert.h"
+#include "support/BRCrypto.h"
 #include "BREthereumMPT.h"
 
 #undef MPT_SHOW_PROOF_NODES
@@ -383,6 +384,293 @@ mptKeyGetFromHash (BREthereumHash hash) {
     return data;
 }
 
+/// MARK: - MPT Builder
+
+// A child node reference: empty, the child's encoding embedded (when under 32 bytes) or the
+// Keccak of the child's encoding.
+typedef struct {
+    uint8_t bytesCount;
+    uint8_t bytes[32];
+} BREthereumMPTReference;
+
+typedef struct {
+    size_t keyOffset;       // into `nibbles`; the `nibbles` array may move while adding
+    size_t keyCount;        // in nibbles
+    const uint8_t *key;     // assigned once all pairs are added
+    BRRlpData value;        // shared
+} BREthereumMPTBuilderEntry;
+
+typedef struct {
+    BREthereumMPTNodeType type;
+    const uint8_t *path;                    // leaf and extension; each byte a nibble
+    size_t pathCount;
+    BREthereumMPTReference *references;     // extension: 1; branch: 16
+    BRRlpData value;                        // leaf and branch
+} BREthereumMPTBuilderNode;
+
+struct BREthereumMPTBuilderRecord {
+    BRArrayOf(BREthereumMPTBuilderEntry) entries;
+    BRArrayOf(uint8_t) nibbles;
+
+    // Every node is written with `writer` into `buffer`
+    BRRlpWriter writer;
+    uint8_t *buffer;
+    size_t bufferCount;
+};
+
+extern BREthereumMPTBuilder
+mptBuilderCreate (void) {
+    BREthereumMPTBuilder builder = calloc (1, sizeof (struct BREthereumMPTBuilderRecord));
+    array_new (builder->entries, 256);
+    array_new (builder->nibbles, 1024);
+    builder->writer = rlpWriterCreate();
+    return builder;
+}
+
+extern void
+mptBuilderRelease (BREthereumMPTBuilder builder) {
+    array_free (builder->entries);
+    array_free (builder->nibbles);
+    rlpWriterRelease (builder->writer);
+    if (NULL != builder->buffer) free (builder->buffer);
+    free (builder);
+}
+
+extern void
+mptBuilderAdd (BREthereumMPTBuilder builder,
+               BREthereumData key,
+               BRRlpData value) {
+    BREthereumMPTBuilderEntry entry = { array_count (builder->nibbles), 2 * key.count, NULL, value };
+
+    for (size_t index = 0; index < key.count; index++) {
+        array_add (builder->nibbles, NIBBLE_UPPER (key.bytes[index]));
+        array_add (builder->nibbles, NIBBLE_LOWER (key.bytes[index]));
+    }
+    array_add (builder->entries, entry);
+}
+
+extern void
+mptBuilderAddIndexed (BREthereumMPTBuilder builder,
+                      uint64_t index,
+                      BRRlpData value) {
+    uint8_t bytes[1 + sizeof (uint64_t)];
+    size_t bytesCount = 0;
+
+    // The RLP encoding of `index`, as a UInt64 with zero as the empty string
+    if (0 == index) bytes[bytesCount++] = 0x80;
+    else if (index < 0x80) bytes[bytesCount++] = (uint8_t) index;
+    else {
+        size_t length = 0;
+        for (uint64_t remaining = index; remaining > 0; remaining >>= 8) length++;
+
+        bytes[bytesCount++] = (uint8_t) (0x80 + length);
+        for (size_t byte = length; byte > 0; byte--)
+            bytes[bytesCount++] = (uint8_t) (index >> (8 * (byte - 1)));
+    }
+
+    mptBuilderAdd (builder, (BREthereumData) { bytesCount, bytes }, value);
+}
+
+static void
+mptBuilderWritePath (BRRlpWriter writer,
+                     const uint8_t *path,
+                     size_t pathCount,
+                     int isLeaf) {
+    // Hex-prefix encoding; see the table below.
+    uint8_t bytes[1 + pathCount / 2];
+    size_t bytesCount = 0, index = 0;
+    size_t odd = pathCount & 1;
+
+    bytes[bytesCount++] = (uint8_t) ((((isLeaf ? 2 : 0) + odd) << 4) | (odd ? path[index++] : 0));
+    for (; index < pathCount; index += 2)
+        bytes[bytesCount++] = (uint8_t) ((path[index] << 4) | path[index + 1]);
+
+    rlpWriterWriteBytes (writer, bytes, bytesCount);
+}
+
+static void
+mptBuilderWriteReference (BRRlpWriter writer,
+                          const BREthereumMPTReference *reference) {
+    if (sizeof (reference->bytes) == reference->bytesCount || 0 == reference->bytesCount)
+        rlpWriterWriteBytes (writer, reference->bytes, reference->bytesCount);
+    else
+        // An embedded node is already RLP encoded.
+        rlpWriterWriteData (writer, (BRRlpData) { reference->bytesCount, (uint8_t *) reference->bytes });
+}
+
+static void
+mptBuilderWriteNode (BRRlpWriter writer,
+                     const BREthereumMPTBuilderNode *node) {
+    rlpWriterBeginList (writer);
+    switch (node->type) {
+        case MPT_NODE_LEAF:
+            mptBuilderWritePath (writer, node->path, node->pathCount, 1);
+            rlpWriterWriteBytes (writer, node->value.bytes, node->value.bytesCount);
+            break;
+
+        case MPT_NODE_EXTENSION:
+            mptBuilderWritePath (writer, node->path, node->pathCount, 0);
+            mptBuilderWriteReference (writer, &node->references[0]);
+            break;
+
+        case MPT_NODE_BRANCH:
+            for (size_t index = 0; index < 16; index++)
+                mptBuilderWriteReference (writer, &node->references[index]);
+            rlpWriterWriteBytes (writer, node->value.bytes, node->value.bytesCount);
+            break;
+    }
+    rlpWriterEndList (writer);
+}
+
+static BREthereumMPTReference
+mptBuilderEncodeNode (BREthereumMPTBuilder builder,
+                      const BREthereumMPTBuilderNode *node,
+                      int isRoot) {
+    // Size, then write into `buffer`
+    mptBuilderWriteNode (builder->writer, node);
+
+    size_t bytesCount = rlpWriterGetBytesCount (builder->writer);
+    if (bytesCount > builder->bufferCount) {
+        builder->buffer = realloc (builder->buffer, bytesCount);
+        builder->bufferCount = bytesCount;
+    }
+
+    rlpWriterBeginWriting (builder->writer, builder->buffer);
+    mptBuilderWriteNode (builder->writer, node);
+    BRRlpData encoding = rlpWriterEndWriting (builder->writer);
+
+    // The root is always hashed; otherwise only an encoding of 32 bytes or more.
+    BREthereumMPTReference reference;
+    if (isRoot || encoding.bytesCount >= sizeof (reference.bytes)) {
+        reference.bytesCount = sizeof (reference.bytes);
+        BRKeccak256 (reference.bytes, encoding.bytes, encoding.bytesCount);
+    }
+    else {
+        reference.bytesCount = (uint8_t) encoding.bytesCount;
+        memcpy (reference.bytes, encoding.bytes, encoding.bytesCount);
+    }
+    return reference;
+}
+
+static BREthereumMPTReference
+mptBuilderBuild (BREthereumMPTBuilder builder,
+                 BREthereumMPTBuilderEntry *entries,
+                 size_t entriesCount,
+                 size_t depth,
+                 int isRoot) {
+    BREthereumMPTBuilderEntry *first = &entries[0];
+    BREthereumMPTBuilderEntry *last  = &entries[entriesCount - 1];
+
+    // A single entry is a leaf holding the rest of its key
+    if (1 == entriesCount)
+        return mptBuilderEncodeNode (builder, &(BREthereumMPTBuilderNode) {
+            MPT_NODE_LEAF,
+            &first->key[depth],
+            first->keyCount - depth,
+            NULL,
+            first->value
+        }, isRoot);
+
+    // With `entries` sorted, the prefix shared by all is the prefix shared by the first and last.
+    size_t prefixCount = 0;
+    while (depth + prefixCount < first->keyCount &&
+           depth + prefixCount < last->keyCount  &&
+           first->key[depth + prefixCount] == last->key[depth + prefixCount])
+        prefixCount++;
+
+    // A shared prefix is an extension to a branch
+    if (prefixCount > 0) {
+        BREthereumMPTReference reference = mptBuilderBuild (builder, entries, entriesCount, depth + prefixCount, 0);
+        return mptBuilderEncodeNode (builder, &(BREthereumMPTBuilderNode) {
+            MPT_NODE_EXTENSION,
+            &first->key[depth],
+            prefixCount,
+            &reference,
+            { 0, NULL }
+        }, isRoot);
+    }
+
+    // Otherwise a branch.  A key ending here sorts first and is the branch's value.
+    BREthereumMPTReference references[16];
+    memset (references, 0, sizeof (references));
+
+    BRRlpData value = { 0, NULL };
+    if (depth == first->keyCount) {
+        value = first->value;
+        entries++;
+        entriesCount--;
+        assert (depth < entries[0].keyCount);   // Keys must be distinct
+    }
+
+    for (size_t start = 0, end; start < entriesCount; start = end) {
+        uint8_t nibble = entries[start].key[depth];
+        for (end = start + 1; end < entriesCount && nibble == entries[end].key[depth]; end++);
+        references[nibble] = mptBuilderBuild (builder, &entries[start], end - start, depth + 1, 0);
+    }
+
+    return mptBuilderEncodeNode (builder, &(BREthereumMPTBuilderNode) {
+        MPT_NODE_BRANCH,
+        NULL,
+        0,
+        references,
+        value
+    }, isRoot);
+}
+
+static int
+mptBuilderEntryCompare (const void *v1, const void *v2) {
+    const BREthereumMPTBuilderEntry *e1 = v1;
+    const BREthereumMPTBuilderEntry *e2 = v2;
+
+    size_t count = (e1->keyCount < e2->keyCount ? e1->keyCount : e2->keyCount);
+    int result = memcmp (e1->key, e2->key, count);
+    return (0 != result
+            ? result
+            : (e1->keyCount < e2->keyCount ? -1 : (e1->keyCount > e2->keyCount ? 1 : 0)));
+}
+
+extern BREthereumHash
+mptBuilderGetRoot (BREthereumMPTBuilder builder) {
+    BREthereumHash root;
+    size_t entriesCount = array_count (builder->entries);
+
+    if (0 == entriesCount) {
+        // The empty trie is the Keccak of the RLP empty string
+        uint8_t empty = 0x80;
+        BRKeccak256 (root.bytes, &empty, 1);
+    }
+    else {
+        for (size_t index = 0; index < entriesCount; index++)
+            builder->entries[index].key = &builder->nibbles[builder->entries[index].keyOffset];
+
+        qsort (builder->entries, entriesCount, sizeof (BREthereumMPTBuilderEntry), mptBuilderEntryCompare);
+
+        BREthereumMPTReference reference = mptBuilderBuild (builder, builder->entries, entriesCount, 0, 1);
+        memcpy (root.bytes, reference.bytes, sizeof (root.bytes));
+    }
+
+    array_clear (builder->entries);
+    array_clear (builder->nibbles);
+
+    return root;
+}
+
+extern BREthereumHash
+mptGetRootFromListView (BRRlpView list) {
+    BREthereumMPTBuilder builder = mptBuilderCreate();
+
+    uint64_t index = 0;
+    for (BRRlpView item = rlpViewGetFirstItem (list);
+         !rlpViewIsEmpty (item);
+         item = rlpViewGetNextItem (list, item))
+        mptBuilderAddIndexed (builder, index++, rlpViewGetDataSharedDontRelease (item));
+
+    BREthereumHash root = mptBuilderGetRoot (builder);
+    mptBuilderRelease (builder);
+
+    return root;
+}
+
 /*
  https://github.com/ethereum/wiki/wiki/Patricia-Tree
 
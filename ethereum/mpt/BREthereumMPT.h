@@ -89,6 +89,58 @@ mptKeyGetFromUInt64 (uint64_t value);
 extern BREthereumData
 mptKeyGetFromHash (BREthereumHash hash);
 
+/// MARK: - MPT Builder
+
+/**
+ * An MPT Builder computes the root hash of a trie from a set of {key, value} pairs - such as
+ * the transactionsRoot or receiptsRoot of a block, keyed by the RLP encoding of the index.
+ *
+ * Pairs are added in any order; the trie is only built by mptBuilderGetRoot() which sorts the
+ * keys and then encodes every node, bottom-up, exactly once.  Each node is Keccak-ed at most
+ * once (and only if its encoding is 32 bytes or more, per the Yellow Paper) - there is no
+ * rehashing of a path as pairs are added.  The builder can be reused after getting the root.
+ */
+typedef struct BREthereumMPTBuilderRecord *BREthereumMPTBuilder;
+
+extern BREthereumMPTBuilder
+mptBuilderCreate (void);
+
+extern void
+mptBuilderRelease (BREthereumMPTBuilder builder);
+
+/**
+ * Add a {key, value} pair.  The `key` bytes are copied; `value` is shared and must remain
+ * valid until mptBuilderGetRoot().  Keys must be distinct.
+ */
+extern void
+mptBuilderAdd (BREthereumMPTBuilder builder,
+               BREthereumData key,
+               BRRlpData value);
+
+/**
+ * Add a {key, value} pair with the key as the RLP encoding of `index`.  As above, `value` is
+ * shared.
+ */
+extern void
+mptBuilderAddIndexed (BREthereumMPTBuilder builder,
+                      uint64_t index,
+                      BRRlpData value);
+
+/**
+ * Build the trie from the added pairs and return its root hash.  With no pairs the root is the
+ * empty trie hash.  All pairs are then removed, leaving `builder` ready for reuse.
+ */
+extern BREthereumHash
+mptBuilderGetRoot (BREthereumMPTBuilder builder);
+
+/**
+ * Return the root hash of the trie holding the RLP encoding of each item in `list`, keyed by
+ * the RLP encoding of the item's index.  This is the transactionsRoot for a list of a block's
+ * transactions, or the receiptsRoot for a list of its receipts.
+ */
+extern BREthereumHash
+mptGetRootFromListView (BRRlpView list);
+
 #ifdef __cplusplus
 }
 #endif
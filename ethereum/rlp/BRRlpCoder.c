@@ -33,31 +33,47 @@ typedef enum {
     CODER_LIST,
 } BRRlpItemType;
 
-#define ITEM_DEFAULT_BYTES_COUNT  1024
-#define ITEM_DEFAULT_ITEMS_COUNT    15
+/**
+ * An item allocated from a decode arena (see rlpDataGetItem()).  Its bytes and its items are
+ * owned by the arena, not by the item.  The first item in the arena is the ARENA_ROOT; the
+ * arena is freed in one shot when the root item is released.
+ */
+#define ITEM_FLAG_ARENA           (1 << 0)
+#define ITEM_FLAG_ARENA_ROOT      (1 << 1)
+
+// Small encodings (up to a 32 byte hash plus its prefix) and short lists live in the item itself.
+#define ITEM_INLINE_BYTES_COUNT    40
+#define ITEM_INLINE_ITEMS_COUNT   (ITEM_INLINE_BYTES_COUNT / sizeof (BRRlpItem))
 
 struct  BRRlpItemRecord {
     BRRlpItemType type;
+    int flags;
 
-    // The encoding
+    // The encoding.  For a decoded item this references the arena's copy of the decoded data.
     size_t bytesCount;
     uint8_t *bytes;
-    uint8_t  bytesArray [ITEM_DEFAULT_BYTES_COUNT];
 
     // If CODER_LIST, then reference the component items.
     size_t itemsCount;
     BRRlpItem *items;
-    BRRlpItem  itemsArray [ITEM_DEFAULT_ITEMS_COUNT];
 
-    // double linked-list of free/busy items.
-    BRRlpItem next, prev;
+    // A CODER_ITEM uses `bytesArray`; a CODER_LIST uses `itemsArray`.  A CODER_LIST always
+    // allocates its bytes.
+    union {
+        uint8_t   bytesArray [ITEM_INLINE_BYTES_COUNT];
+        BRRlpItem itemsArray [ITEM_INLINE_ITEMS_COUNT];
+    } u;
+
+    // singly linked-list of free items.
+    BRRlpItem next;
 };
 
 static void
 itemReleaseMemory (BRRlpItem item) {
-    if (item->bytesArray != item->bytes && NULL != item->bytes) free (item->bytes);
-    if (item->itemsArray != item->items && NULL != item->items) free (item->items);
-
+    if (!(item->flags & ITEM_FLAG_ARENA)) {
+        if (item->u.bytesArray != item->bytes && NULL != item->bytes) free (item->bytes);
+        if (item->u.itemsArray != item->items && NULL != item->items) free (item->items);
+    }
     memset (item, 0, sizeof (struct BRRlpItemRecord));
 }
 
@@ -77,19 +93,15 @@ struct BRRlpCoderRecord {
     BRRlpItem free;
 
     /**
-     * A doubly-linked list of busy RLP items.  Fact is, we don't need to keep this list - you
-     * acquire an item and you best be sure to release it and if you don't you've leaked memory.
-     *
-     * Well, in order to ensure that memory is not leaked, we keep a `busy` list and then on
-     * `rlpCoderRelease()` we assert that there a no busy items - ensuring all are released.
+     * The number of busy RLP items - acquired but not yet released.  A decode arena counts as a
+     * single busy item.  In order to ensure that memory is not leaked, on `rlpCoderRelease()` we
+     * assert that there a no busy items - ensuring all are released.
      *
-     * This busy list caused a problem (see bugfix/CORE-152).  It was singly linked and thus to
-     * remove an item we were forced to traverse the list to find the just-prior item and then
-     * set prev->next = item->next.  When we had an RLP item with ~300,000 sub-items the
-     * traversal was computationally unmanageable.  Thus we changed to a doubly-linked list.  Fact
-     * is we probaby don't need `busy`.
+     * This was once a list of busy items which caused a problem (see bugfix/CORE-152).  When we
+     * had an RLP item with ~300,000 sub-items the list maintenance was computationally
+     * unmanageable.  Decoded items now come from an arena and are never individually tracked.
      */
-    BRRlpItem busy;
+    size_t busyCount;
 
     /**
      * It is not likely that this lock is actually needed, base on current `BRRlpCoder` use - coders
@@ -103,7 +115,7 @@ rlpCoderCreate (void) {
     BRRlpCoder coder = malloc (sizeof (struct BRRlpCoderRecord));
     coder->failed = 0;
     coder->free = NULL;
-    coder->busy = NULL;
+    coder->busyCount = 0;
 
     {
         pthread_mutexattr_t attr;
@@ -146,7 +158,7 @@ rlpCoderRelease (BRRlpCoder coder) {
     pthread_mutex_lock(&coder->lock);
 
     // Every single Item must be returned!
-    assert (NULL == coder->busy);
+    assert (0 == coder->busyCount);
     _rlpCoderReclaimInternal (coder);
 
     pthread_mutex_unlock(&coder->lock);
@@ -166,16 +178,10 @@ _rlpCoderAcquireItemInternal (BRRlpCoder coder) {
     }
     else item = calloc (1, sizeof (struct BRRlpItemRecord));
 
-    assert (NULL == item->next       && NULL == item->prev &&
-            0    == item->bytesCount && 0    == item->itemsCount);
-
-    // Doubly-link `item` to `busy`
-    if (NULL != coder->busy) coder->busy->prev = item;
-    item->next = coder->busy;
-
-    // Update `coder` to show `item` as busy.
-    coder->busy = item;
+    assert (NULL == item->next       && 0 == item->flags &&
+            0    == item->bytesCount && 0 == item->itemsCount);
 
+    coder->busyCount++;
     return item;
 }
 
@@ -188,40 +194,35 @@ rlpCoderAcquireItem (BRRlpCoder coder) {
 }
 
 static void
-_rlpCoderReturnItemInternal (BRRlpCoder coder, BRRlpItem prev, BRRlpItem item, BRRlpItem next) {
-    assert (NULL == item->next       && NULL == item->prev &&
-            0    == item->bytesCount && 0    == item->itemsCount);
-
-    // If `item` is a the head of our `busy` list, then just move `busy`
-    if (item == coder->busy)
-        coder->busy = next;
-
-    // If `item` is not at the head of our `busy` list, then splice out `item` by
-    // linking as `prev` <==> `next`
-    else {
-        if (NULL != prev) prev->next = next;
-        if (NULL != next) next->prev = prev;
-    }
+_rlpCoderReturnItemInternal (BRRlpCoder coder, BRRlpItem item) {
+    assert (NULL == item->next       && 0 == item->flags &&
+            0    == item->bytesCount && 0 == item->itemsCount);
 
     // The `item` is no longer busy.  Singlely link to `free`.
-    item->prev = NULL;
     item->next = coder->free;
-
-    // Update `coder` to show `item` as free.
     coder->free = item;
+
+    assert (coder->busyCount > 0);
+    coder->busyCount--;
 }
 
 static void
 _rlpCoderReleaseItemInternal (BRRlpCoder coder, BRRlpItem item) {
+    // An arena item is released along with its arena; the arena is released with its root.
+    if (item->flags & ITEM_FLAG_ARENA) {
+        if (item->flags & ITEM_FLAG_ARENA_ROOT) {
+            assert (coder->busyCount > 0);
+            coder->busyCount--;
+            free (item);
+        }
+        return;
+    }
+
     for (size_t index = 0; index < item->itemsCount; index++)
         _rlpCoderReleaseItemInternal (coder, item->items[index]);
 
-    // Surely get these before itemReleaseMemory() blows them away.
-    BRRlpItem prev = item->prev;
-    BRRlpItem next = item->next;
-
     itemReleaseMemory(item);
-    _rlpCoderReturnItemInternal (coder, prev, item, next);
+    _rlpCoderReturnItemInternal (coder, item);
 }
 
 static void
@@ -247,19 +248,19 @@ static uint8_t *
 itemEnsureBytes (BRRlpCoder coder, BRRlpItem item, size_t bytesCount) {
     assert (NULL == item->bytes);
     item->bytesCount = bytesCount;
-    item->bytes = (item->bytesCount > ITEM_DEFAULT_BYTES_COUNT
-                   ? malloc (item->bytesCount)
-                   : item->bytesArray);
+    item->bytes = (CODER_ITEM == item->type && item->bytesCount <= ITEM_INLINE_BYTES_COUNT
+                   ? item->u.bytesArray
+                   : malloc (item->bytesCount));
     return item->bytes;
 }
 
 static BRRlpItem
 itemFillList (BRRlpCoder coder, BRRlpItem item, BRRlpItem *items, size_t itemsCount) {
-    item->type = CODER_LIST;
+    assert (CODER_LIST == item->type);
     item->itemsCount = itemsCount;
-    item->items = (item->itemsCount > ITEM_DEFAULT_ITEMS_COUNT
+    item->items = (item->itemsCount > ITEM_INLINE_ITEMS_COUNT
                    ? calloc (item->itemsCount, sizeof (BRRlpItem))
-                   : item->itemsArray);
+                   : item->u.itemsArray);
     for (int i = 0; i < itemsCount; i++)
         item->items[i] = items[i];
     return item;
@@ -542,7 +543,7 @@ coderEncodeList (BRRlpCoder coder, BRRlpItem *items, size_t itemsCount) {
     }
 
     // Acquire an item
-    BRRlpItem item = rlpCoderAcquireItem(coder);
+    BRRlpItem item = itemCreateEmpty (coder, CODER_LIST);
 
     // Eventually fill these by concatentating bytes from each of `items`
     size_t bytesCount = 0;
@@ -898,76 +899,578 @@ rlpGetItem_FillData (BRRlpCoder coder, uint8_t *bytes) {
     return data;
 }
 
-#define DEFAULT_ITEM_INCREMENT 20
+/**
+ * Count the items needed to decode `data` into `itemsCount` and the list items that won't fit
+ * in an item's `itemsArray` into `listItemsCount`.
+ */
+static void
+rlpArenaCount (BRRlpCoder coder, BRRlpData data, size_t *itemsCount, size_t *listItemsCount) {
+    *itemsCount += 1;
+
+    // If not a list, then we are done.
+    if (data.bytes[0] < RLP_PREFIX_LIST) return;
+
+    // Start of `data` encodes a list with a number of bytes.  We'll count sub-items after the
+    // list's length.
+    uint8_t bytesOffset = 0;
+    size_t bytesCount = decodeLength(data.bytes, RLP_PREFIX_LIST, &bytesOffset);
+    assert (data.bytesCount == bytesCount + bytesOffset);
+
+    uint8_t *bytesLimit = data.bytes + data.bytesCount;
+    uint8_t *bytes = data.bytes + bytesOffset;
+    size_t count = 0;
+
+    while (bytes < bytesLimit) {
+        BRRlpData d = rlpGetItem_FillData(coder, bytes);
+        if (d.bytesCount > (size_t) (bytesLimit - bytes)) { rlpCoderSetFailed (coder); break; }
+
+        rlpArenaCount (coder, d, itemsCount, listItemsCount);
+        bytes += d.bytesCount;
+        count += 1;
+    }
+
+    if (count > ITEM_INLINE_ITEMS_COUNT)
+        *listItemsCount += count;
+}
+
+/**
+ * Fill the next arena item from `data`, recursively filling sub-items.  The `data` bytes must be
+ * the arena's copy; the item references them directly.
+ */
+static BRRlpItem
+rlpArenaFill (BRRlpCoder coder, BRRlpData data, BRRlpItem *nextItem, BRRlpItem **nextListItems) {
+    BRRlpItem item = (*nextItem)++;
+
+    item->flags = ITEM_FLAG_ARENA;
+    item->bytesCount = data.bytesCount;
+    item->bytes = data.bytes;
+    item->itemsCount = 0;
+    item->items = NULL;
+    item->next = NULL;
+
+    if (data.bytes[0] < RLP_PREFIX_LIST) {
+        item->type = CODER_ITEM;
+        return item;
+    }
+    item->type = CODER_LIST;
+
+    uint8_t bytesOffset = 0;
+    decodeLength(data.bytes, RLP_PREFIX_LIST, &bytesOffset);
+
+    uint8_t *bytesLimit = data.bytes + data.bytesCount;
+    uint8_t *bytesStart = data.bytes + bytesOffset;
+
+    // Walk the sub-items once, shallowly, to size `items`...
+    size_t count = 0;
+    for (uint8_t *bytes = bytesStart; bytes < bytesLimit; count++) {
+        BRRlpData d = rlpGetItem_FillData(coder, bytes);
+        if (d.bytesCount > (size_t) (bytesLimit - bytes)) break;
+        bytes += d.bytesCount;
+    }
+
+    if (count > ITEM_INLINE_ITEMS_COUNT) {
+        item->items = *nextListItems;
+        *nextListItems += count;
+    }
+    else item->items = item->u.itemsArray;
+    item->itemsCount = count;
+
+    // ... and then again to fill them.
+    uint8_t *bytes = bytesStart;
+    for (size_t index = 0; index < count; index++) {
+        BRRlpData d = rlpGetItem_FillData(coder, bytes);
+        item->items[index] = rlpArenaFill (coder, d, nextItem, nextListItems);
+        bytes += d.bytesCount;
+    }
+
+    return item;
+}
 
 /**
  * Convet the bytes in `data` into an `item`.  If `data` represents a RLP list, then `item` will
  * represent a list.
+ *
+ * All the items are allocated from a single arena which also holds one copy of `data`; every
+ * item's bytes reference that copy.  The returned item is the arena's root; releasing it releases
+ * the arena and thus every item.  Sub-items must not be released on their own.
  */
 extern BRRlpItem
 rlpDataGetItem (BRRlpCoder coder, BRRlpData data) {
     assert (0 != data.bytesCount);
 
-    BRRlpItem result = rlpCoderAcquireItem (coder);
-    uint8_t *encodedBytes = itemEnsureBytes (coder, result, data.bytesCount);
-    memcpy (encodedBytes, data.bytes, data.bytesCount);
+    size_t itemsCount = 0;
+    size_t listItemsCount = 0;
+    rlpArenaCount (coder, data, &itemsCount, &listItemsCount);
+
+    // The arena: items, then list items, then the bytes.
+    size_t itemsSize     = itemsCount     * sizeof (struct BRRlpItemRecord);
+    size_t listItemsSize = listItemsCount * sizeof (BRRlpItem);
+    uint8_t *arena = malloc (itemsSize + listItemsSize + data.bytesCount);
 
-    uint8_t prefix = data.bytes[0];
+    BRRlpItem  nextItem      = (BRRlpItem) arena;
+    BRRlpItem *nextListItems = (BRRlpItem *) (arena + itemsSize);
+
+    BRRlpData arenaData = { data.bytesCount, arena + itemsSize + listItemsSize };
+    memcpy (arenaData.bytes, data.bytes, data.bytesCount);
+
+    BRRlpItem result = rlpArenaFill (coder, arenaData, &nextItem, &nextListItems);
+    result->flags |= ITEM_FLAG_ARENA_ROOT;
+
+    assert ((uint8_t *) nextItem == arena + itemsSize);
+    assert ((uint8_t *) nextListItems == arena + itemsSize + listItemsSize);
+
+    pthread_mutex_lock(&coder->lock);
+    coder->busyCount++;
+    pthread_mutex_unlock(&coder->lock);
+
+    return result;
+}
+
+//
+// View
+//
+
+// Deeper nesting than this is never seen in Ethereum data and only bounds the validation stack.
+#define RLP_VIEW_DEPTH_LIMIT   (64)
+
+/**
+ * Decode the length prefix at `bytes`, returning the `offset` to the payload and the payload's
+ * `length`.  Returns 0 if the prefix, or the payload, extends beyond `bytesCount`.
+ */
+static int
+viewDecodeLength (const uint8_t *bytes, size_t bytesCount, size_t *offset, size_t *length) {
+    if (0 == bytesCount) return 0;
 
-    // If not a list, then we are done; just return an `item` with `data`
-    if (prefix < RLP_PREFIX_LIST) {
-        return result;
+    uint8_t prefix = bytes[0];
+    if (prefix < RLP_PREFIX_BYTES) {
+        *offset = 0;
+        *length = 1;
+        return 1;
     }
 
-    // If a list, then we'll consume `data` with sub-items.
+    uint8_t baseline = (prefix < RLP_PREFIX_LIST ? RLP_PREFIX_BYTES : RLP_PREFIX_LIST);
+    if ((prefix - baseline) <= RLP_PREFIX_LENGTH_LIMIT) {
+        *offset = 1;
+        *length = prefix - baseline;
+    }
     else {
-        // We can have an arbitrary number of sub-times.  Assume we have DEFAULT_ITEM_INCREMENT
-        // but be willing to increase the number if needed.
-        BRRlpItem itemsArray[DEFAULT_ITEM_INCREMENT];
-        size_t itemsIndex = 0;
-        size_t itemsCount = DEFAULT_ITEM_INCREMENT;
-
-        // We'll use this to accumulate subitems.
-        BRRlpItem *items = itemsArray;
-
-        // The upper limit on bytes to consume.
-        uint8_t *bytesLimit = data.bytes + data.bytesCount;
-        uint8_t *bytes = data.bytes;
-
-        // Start of `data` encodes a list with a number of bytes.  We'll start extracting
-        // sub-items after the list's length.
-        uint8_t bytesOffset = 0;
-        size_t bytesCount = decodeLength(data.bytes, RLP_PREFIX_LIST, &bytesOffset);
-        assert (data.bytesCount == bytesCount + bytesOffset);
-
-        // Start of the first sub-item
-        bytes += bytesOffset;
-        
-        while (bytes < bytesLimit) {
-            // Get the `data` for this sub-item and then recurse
-            BRRlpData d = rlpGetItem_FillData(coder, bytes);
-            items[itemsIndex++] = rlpDataGetItem (coder, d);
-
-            // Move to the next sub-item
-            bytes += d.bytesCount;
-
-            // Extend `items` is we've used the allocated number.
-            if (itemsIndex == itemsCount) {
-                itemsCount += DEFAULT_ITEM_INCREMENT;
-                if (items == itemsArray) {
-                    // Move 'off' the stack allocated array.
-                    items = malloc(itemsCount * sizeof(BRRlpItem));
-                    memcpy (items, itemsArray, itemsIndex * sizeof(BRRlpItem));
-                }
-                else
-                    items = realloc(items, itemsCount * sizeof (BRRlpItem));
-            }
+        // Between 1 and 8 bytes, big-endian, encode the length
+        size_t lengthByteCount = (prefix - baseline) - RLP_PREFIX_LENGTH_LIMIT;
+        if (1 + lengthByteCount > bytesCount) return 0;
+
+        uint64_t value = 0;
+        for (size_t index = 1; index <= lengthByteCount; index++)
+            value = (value << 8) | bytes[index];
+        if (value > (uint64_t) SIZE_MAX) return 0;
+
+        *offset = 1 + lengthByteCount;
+        *length = (size_t) value;
+    }
+    return *length <= bytesCount - *offset;
+}
+
+static int
+viewIsValid (const uint8_t *bytes, size_t bytesCount, int depth) {
+    size_t offset, length;
+    if (!viewDecodeLength (bytes, bytesCount, &offset, &length) || offset + length != bytesCount)
+        return 0;
+
+    if (bytes[0] < RLP_PREFIX_LIST) return 1;
+    if (depth >= RLP_VIEW_DEPTH_LIMIT) return 0;
+
+    for (size_t index = offset; index < bytesCount; index += offset + length) {
+        if (!viewDecodeLength (&bytes[index], bytesCount - index, &offset, &length) ||
+            !viewIsValid (&bytes[index], offset + length, depth + 1))
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Return a view of the item at `bytes`, bounded by `bytesLimit`; empty if there is no item.
+ */
+static BRRlpView
+viewCreateAt (uint8_t *bytes, uint8_t *bytesLimit) {
+    size_t offset, length;
+    if (bytes >= bytesLimit ||
+        !viewDecodeLength (bytes, bytesLimit - bytes, &offset, &length))
+        return RLP_VIEW_EMPTY;
+    return (BRRlpView) { offset + length, bytes };
+}
+
+extern BRRlpView
+rlpDataGetView (BRRlpData data) {
+    return (BRRlpView) { data.bytesCount, data.bytes };
+}
+
+extern BRRlpView
+rlpItemGetView (BRRlpCoder coder, BRRlpItem item) {
+    assert (itemIsValid (coder, item));
+    return (BRRlpView) { item->bytesCount, item->bytes };
+}
+
+extern BRRlpItem
+rlpViewCreateItem (BRRlpCoder coder, BRRlpView view) {
+    return rlpDataGetItem (coder, rlpViewGetDataSharedDontRelease (view));
+}
+
+extern int
+rlpViewIsValid (BRRlpView view) {
+    return viewIsValid (view.bytes, view.bytesCount, 0);
+}
+
+extern int
+rlpViewIsEmpty (BRRlpView view) {
+    return 0 == view.bytesCount;
+}
+
+extern int
+rlpViewIsList (BRRlpView view) {
+    return 0 != view.bytesCount && view.bytes[0] >= RLP_PREFIX_LIST;
+}
+
+extern BRRlpView
+rlpViewGetFirstItem (BRRlpView view) {
+    if (!rlpViewIsList (view)) return RLP_VIEW_EMPTY;
+
+    size_t offset, length;
+    if (!viewDecodeLength (view.bytes, view.bytesCount, &offset, &length))
+        return RLP_VIEW_EMPTY;
+
+    return viewCreateAt (view.bytes + offset, view.bytes + offset + length);
+}
+
+extern BRRlpView
+rlpViewGetNextItem (BRRlpView view, BRRlpView item) {
+    assert (item.bytes >= view.bytes && item.bytes + item.bytesCount <= view.bytes + view.bytesCount);
+    return viewCreateAt (item.bytes + item.bytesCount, view.bytes + view.bytesCount);
+}
+
+extern size_t
+rlpViewGetItemsCount (BRRlpView view) {
+    return rlpViewGetItems (view, NULL, 0);
+}
+
+extern BRRlpView
+rlpViewGetItem (BRRlpView view, size_t index) {
+    BRRlpView item = rlpViewGetFirstItem (view);
+    while (index-- > 0 && !rlpViewIsEmpty (item))
+        item = rlpViewGetNextItem (view, item);
+    return item;
+}
+
+extern size_t
+rlpViewGetItems (BRRlpView view, BRRlpView *items, size_t itemsCount) {
+    size_t count = 0;
+    for (BRRlpView item = rlpViewGetFirstItem (view);
+         !rlpViewIsEmpty (item);
+         item = rlpViewGetNextItem (view, item)) {
+        if (count < itemsCount) items[count] = item;
+        count += 1;
+    }
+    return count;
+}
+
+extern BRRlpData
+rlpViewGetDataSharedDontRelease (BRRlpView view) {
+    return (BRRlpData) { view.bytesCount, view.bytes };
+}
+
+extern BRRlpData
+rlpViewDecodeBytesSharedDontRelease (BRRlpView view) {
+    size_t offset, length;
+    if (!viewDecodeLength (view.bytes, view.bytesCount, &offset, &length))
+        return (BRRlpData) { 0, NULL };
+    return (BRRlpData) { length, view.bytes + offset };
+}
+
+/**
+ * Fill `targetCount` bytes into `target` from the number in `view`.  A number too large for
+ * `target`, which only a misbehaving peer sends, is truncated to its low-order bytes rather than
+ * asserted against.
+ */
+static void
+viewDecodeNumber (BRRlpView view, uint8_t *target, size_t targetCount) {
+    BRRlpData data = rlpViewDecodeBytesSharedDontRelease (view);
+
+    if (data.bytesCount > targetCount) {
+        data.bytes += data.bytesCount - targetCount;
+        data.bytesCount = targetCount;
+    }
+    convertFromBigEndian (target, targetCount, data.bytes, data.bytesCount);
+}
+
+extern uint64_t
+rlpViewDecodeUInt64 (BRRlpView view) {
+    uint64_t value = 0;
+    viewDecodeNumber (view, (uint8_t *) &value, sizeof (uint64_t));
+    return value;
+}
+
+extern UInt256
+rlpViewDecodeUInt256 (BRRlpView view) {
+    UInt256 value = UINT256_ZERO;
+    viewDecodeNumber (view, (uint8_t *) &value, sizeof (UInt256));
+    return value;
+}
+
+//
+// Writer
+//
+
+#define WRITER_DEFAULT_LISTS_COUNT    (32)
+
+typedef struct {
+    size_t index;       // Into `lengths`
+    size_t offset;      // Of the list's payload
+} BRRlpWriterList;
+
+struct BRRlpWriterRecord {
+    /**
+     * A boolean to indicate the second pass.
+     */
+    int writing;
+
+    /**
+     * The buffer written in the second pass and an indication of who owns it.
+     */
+    uint8_t *bytes;
+    int bytesOwned;
+
+    /**
+     * In the first pass, the bytes sized so far; in the second pass, the bytes written so far.
+     */
+    size_t bytesCount;
+
+    /**
+     * The payload length of each list, in the order the lists are begun.  Filled in the first
+     * pass; consumed, at `lengthsIndex`, in the second pass.
+     */
+    size_t *lengths;
+    size_t lengthsCount;
+    size_t lengthsAllocated;
+    size_t lengthsIndex;
+
+    /**
+     * The stack of lists begun, but not ended.
+     */
+    BRRlpWriterList *lists;
+    size_t listsCount;
+    size_t listsAllocated;
+};
+
+extern BRRlpWriter
+rlpWriterCreate (void) {
+    BRRlpWriter writer = calloc (1, sizeof (struct BRRlpWriterRecord));
+
+    writer->lengthsAllocated = WRITER_DEFAULT_LISTS_COUNT;
+    writer->lengths = malloc (writer->lengthsAllocated * sizeof (size_t));
+
+    writer->listsAllocated = WRITER_DEFAULT_LISTS_COUNT;
+    writer->lists = malloc (writer->listsAllocated * sizeof (BRRlpWriterList));
+
+    return writer;
+}
+
+extern void
+rlpWriterRelease (BRRlpWriter writer) {
+    if (writer->bytesOwned && NULL != writer->bytes) free (writer->bytes);
+    free (writer->lengths);
+    free (writer->lists);
+    free (writer);
+}
+
+extern int
+rlpWriterIsWriting (BRRlpWriter writer) {
+    return writer->writing;
+}
+
+extern size_t
+rlpWriterGetBytesCount (BRRlpWriter writer) {
+    return writer->bytesCount;
+}
+
+extern void
+rlpWriterBeginWriting (BRRlpWriter writer, uint8_t *bytes) {
+    assert (!writer->writing && 0 == writer->listsCount);
+
+    writer->bytesOwned = (NULL == bytes);
+    writer->bytes = (NULL != bytes ? bytes : malloc (writer->bytesCount));
+
+    writer->writing = 1;
+    writer->bytesCount = 0;
+    writer->lengthsIndex = 0;
+}
+
+extern BRRlpData
+rlpWriterEndWriting (BRRlpWriter writer) {
+    assert (writer->writing && 0 == writer->listsCount);
+    assert (writer->lengthsIndex == writer->lengthsCount);
+
+    BRRlpData data = { writer->bytesCount, writer->bytes };
+
+    writer->writing = 0;
+    writer->bytes = NULL;
+    writer->bytesOwned = 0;
+    writer->bytesCount = 0;
+    writer->lengthsCount = 0;
+    writer->lengthsIndex = 0;
+
+    return data;
+}
+
+extern BRRlpData
+rlpWriterGetDataSharedDontRelease (BRRlpWriter writer, size_t offset) {
+    assert (writer->writing && offset <= writer->bytesCount);
+    return (BRRlpData) { writer->bytesCount - offset, &writer->bytes[offset] };
+}
+
+static void
+writerAppend (BRRlpWriter writer, const uint8_t *bytes, size_t bytesCount) {
+    if (writer->writing && bytesCount > 0) memcpy (&writer->bytes[writer->bytesCount], bytes, bytesCount);
+    writer->bytesCount += bytesCount;
+}
+
+static void
+writerAppendLength (BRRlpWriter writer, size_t length, uint8_t baseline) {
+    uint8_t bytes9Count, bytes9[9];
+    encodeLengthIntoBytes (length, baseline, bytes9, &bytes9Count);
+    writerAppend (writer, bytes9, bytes9Count);
+}
+
+extern void
+rlpWriterBeginList (BRRlpWriter writer) {
+    size_t index;
+
+    if (writer->writing) {
+        assert (writer->lengthsIndex < writer->lengthsCount);
+        index = writer->lengthsIndex++;
+        writerAppendLength (writer, writer->lengths[index], RLP_PREFIX_LIST);
+    }
+    else {
+        if (writer->lengthsCount == writer->lengthsAllocated) {
+            writer->lengthsAllocated *= 2;
+            writer->lengths = realloc (writer->lengths, writer->lengthsAllocated * sizeof (size_t));
         }
-        itemFillList(coder, result, items, itemsIndex);
+        index = writer->lengthsCount++;
+    }
 
-        if (items != itemsArray) free(items);
+    if (writer->listsCount == writer->listsAllocated) {
+        writer->listsAllocated *= 2;
+        writer->lists = realloc (writer->lists, writer->listsAllocated * sizeof (BRRlpWriterList));
     }
-    return result;
+    writer->lists[writer->listsCount++] = (BRRlpWriterList) { index, writer->bytesCount };
+}
+
+extern void
+rlpWriterEndList (BRRlpWriter writer) {
+    assert (writer->listsCount > 0);
+    BRRlpWriterList list = writer->lists[--writer->listsCount];
+    size_t length = writer->bytesCount - list.offset;
+
+    if (writer->writing)
+        assert (length == writer->lengths[list.index]);
+    else {
+        // The list's payload is sized; add in its length prefix, written in the second pass.
+        uint8_t bytes9Count, bytes9[9];
+        encodeLengthIntoBytes (length, RLP_PREFIX_LIST, bytes9, &bytes9Count);
+
+        writer->lengths[list.index] = length;
+        writer->bytesCount += bytes9Count;
+    }
+}
+
+extern void
+rlpWriterWriteBytes (BRRlpWriter writer, const uint8_t *bytes, size_t bytesCount) {
+    // Encode a single byte directly; otherwise, encode the length and then the bytes themselves
+    if (1 != bytesCount || bytes[0] >= RLP_PREFIX_BYTES)
+        writerAppendLength (writer, bytesCount, RLP_PREFIX_BYTES);
+    writerAppend (writer, bytes, bytesCount);
+}
+
+extern void
+rlpWriterWriteBytesPurgeLeadingZeros (BRRlpWriter writer, const uint8_t *bytes, size_t bytesCount) {
+    size_t offset = 0;
+    for (; offset < bytesCount; offset++)
+        if (0 != bytes[offset]) break;
+    rlpWriterWriteBytes (writer, &bytes[offset], bytesCount - offset);
+}
+
+static void
+writerWriteNumber (BRRlpWriter writer, uint8_t *source, size_t sourceCount) {
+    uint8_t bytes [sourceCount]; // big_endian representation of the bytes in 'source'
+    size_t bytesIndex;           // Index of the first non-zero byte
+    size_t bytesCount;           // The number of bytes to encode
+
+    convertToBigEndianAndNormalize (bytes, source, sourceCount, &bytesIndex, &bytesCount);
+    rlpWriterWriteBytes (writer, &bytes[bytesIndex], bytesCount);
+}
+
+extern void
+rlpWriterWriteUInt64 (BRRlpWriter writer, uint64_t value, int zeroAsEmptyString) {
+    if (1 == zeroAsEmptyString && 0 == value)
+        rlpWriterWriteBytes (writer, NULL, 0);
+    else
+        writerWriteNumber (writer, (uint8_t *) &value, sizeof (value));
+}
+
+extern void
+rlpWriterWriteUInt256 (BRRlpWriter writer, UInt256 value, int zeroAsEmptyString) {
+    if (1 == zeroAsEmptyString && 0 == uint256Compare (value, UINT256_ZERO))
+        rlpWriterWriteBytes (writer, NULL, 0);
+    else
+        writerWriteNumber (writer, (uint8_t *) &value, sizeof (value));
+}
+
+extern void
+rlpWriterWriteString (BRRlpWriter writer, const char *string) {
+    if (NULL == string) string = "";
+    rlpWriterWriteBytes (writer, (const uint8_t *) string, strlen (string));
+}
+
+extern void
+rlpWriterWriteHexString (BRRlpWriter writer, const char *string) {
+    if (NULL == string || string[0] == '\0') {
+        rlpWriterWriteString (writer, "");
+        return;
+    }
+
+    // Strip off "0x" if it exists
+    if (0 == strncmp (string, "0x", 2))
+        string = &string[2];
+
+    size_t stringLen = strlen(string);
+    assert (0 == stringLen % 2);
+
+    // In the first pass we only need the size, unless the size is a single byte.
+    if (!writer->writing && stringLen > 2) {
+        size_t bytesCount = stringLen / 2;
+        writerAppendLength (writer, bytesCount, RLP_PREFIX_BYTES);
+        writer->bytesCount += bytesCount;
+    }
+    else if (stringLen < (16 * 1024)) {
+        size_t bytesCount = stringLen / 2;
+        uint8_t bytes[bytesCount + 1];
+        hexDecode(bytes, bytesCount, string, stringLen);
+        rlpWriterWriteBytes (writer, bytes, bytesCount);
+    }
+    else {
+        size_t bytesCount = 0;
+        uint8_t *bytes = hexDecodeCreate(&bytesCount, string, stringLen);
+        rlpWriterWriteBytes (writer, bytes, bytesCount);
+        free (bytes);
+    }
+}
+
+extern void
+rlpWriterWriteData (BRRlpWriter writer, BRRlpData data) {
+    writerAppend (writer, data.bytes, data.bytesCount);
+}
+
+extern void
+rlpWriterWriteItem (BRRlpWriter writer, BRRlpCoder coder, BRRlpItem item) {
+    assert (itemIsValid (coder, item));
+    writerAppend (writer, item->bytes, item->bytesCount);
 }
 
 //
@@ -191,6 +191,206 @@ rlpEncodeListItems (BRRlpCoder coder, BRRlpItem *items, size_t itemsCount);
 extern const BRRlpItem *
 rlpDecodeList (BRRlpCoder coder, BRRlpItem item, size_t *itemsCount);
     
+//
+// RLP View
+//
+
+/**
+ * A view of a single RLP encoding - the length prefix and the payload - in someone else's
+ * buffer.  A view does not own its bytes; it is valid only as long as the buffer is.  A view
+ * is decoded lazily: nothing is allocated and a list's sub-items are located on demand by
+ * walking the list's payload.
+ *
+ * Use rlpViewIsValid() once on a view of untrusted data; thereafter sub-item views and the
+ * rlpView*() accessors will stay within the view's bytes.
+ */
+typedef struct {
+    size_t bytesCount;
+    uint8_t *bytes;
+} BRRlpView;
+
+#define RLP_VIEW_EMPTY      ((BRRlpView) { 0, NULL })
+
+/**
+ * Return a view of `data` which holds an RLP encoding.  The view shares `data`.
+ */
+extern BRRlpView
+rlpDataGetView (BRRlpData data);
+
+/**
+ * Return a view of `item`.  The view shares the `item` memory and is invalid once `item` is
+ * released.
+ */
+extern BRRlpView
+rlpItemGetView (BRRlpCoder coder, BRRlpItem item);
+
+/**
+ * Create an `item` from `view`.  You own the item and must call rlpItemRelease().  Use this to
+ * hand a sub-item view to an item-based decoder.
+ */
+extern BRRlpItem
+rlpViewCreateItem (BRRlpCoder coder, BRRlpView view);
+
+/**
+ * Check, in one pass, that `view` is exactly one well-formed RLP encoding with every length,
+ * at every level, within the view's bytes.
+ */
+extern int
+rlpViewIsValid (BRRlpView view);
+
+extern int
+rlpViewIsEmpty (BRRlpView view);
+
+extern int
+rlpViewIsList (BRRlpView view);
+
+/**
+ * Return the number of sub-items in the list `view`; zero if `view` is not a list.
+ */
+extern size_t
+rlpViewGetItemsCount (BRRlpView view);
+
+/**
+ * Return a view of the sub-item at `index` in the list `view`.
+ */
+extern BRRlpView
+rlpViewGetItem (BRRlpView view, size_t index);
+
+/**
+ * Fill `items` with views of up to `itemsCount` sub-items of the list `view`.  Returns the
+ * total number of sub-items, which may exceed `itemsCount`.
+ */
+extern size_t
+rlpViewGetItems (BRRlpView view, BRRlpView *items, size_t itemsCount);
+
+/**
+ * Iterate over the sub-items of the list `view`, as:
+ *   for (BRRlpView item = rlpViewGetFirstItem (view);
+ *        !rlpViewIsEmpty (item);
+ *        item = rlpViewGetNextItem (view, item)) { ... }
+ */
+extern BRRlpView
+rlpViewGetFirstItem (BRRlpView view);
+
+extern BRRlpView
+rlpViewGetNextItem (BRRlpView view, BRRlpView item);
+
+/**
+ * Return the complete RLP encoding of `view`.  You DO NOT own this data.
+ */
+extern BRRlpData
+rlpViewGetDataSharedDontRelease (BRRlpView view);
+
+/**
+ * Return the payload of `view` w/o the RLP encoding of length.  You DO NOT own this data.
+ */
+extern BRRlpData
+rlpViewDecodeBytesSharedDontRelease (BRRlpView view);
+
+extern uint64_t
+rlpViewDecodeUInt64 (BRRlpView view);
+
+extern UInt256
+rlpViewDecodeUInt256 (BRRlpView view);
+
+//
+// RLP Writer
+//
+
+/**
+ * A writer produces a complete RLP encoding directly into one buffer, without creating RLP
+ * items and thus without copying each item's bytes into its enclosing list.  An encoding is
+ * written in two passes over the same write calls: the first pass only sizes the encoding and
+ * records each list's length; the second pass, after rlpWriterBeginWriting(), writes the
+ * bytes using the recorded lengths for the list prefixes.
+ *
+ *    BRRlpWriter writer = rlpWriterCreate ();
+ *    fooRlpWrite (foo, writer);
+ *    rlpWriterBeginWriting (writer, NULL);
+ *    fooRlpWrite (foo, writer);
+ *    BRRlpData data = rlpWriterEndWriting (writer);    // You own `data`
+ *    rlpWriterRelease (writer);
+ *
+ * Both passes must make exactly the same write calls.
+ */
+typedef struct BRRlpWriterRecord *BRRlpWriter;
+
+extern BRRlpWriter
+rlpWriterCreate (void);
+
+extern void
+rlpWriterRelease (BRRlpWriter writer);
+
+/**
+ * Return true if in the second, writing, pass.
+ */
+extern int
+rlpWriterIsWriting (BRRlpWriter writer);
+
+/**
+ * Return the number of bytes sized, or written, so far.  After the first pass this is the size
+ * of the complete encoding.
+ */
+extern size_t
+rlpWriterGetBytesCount (BRRlpWriter writer);
+
+/**
+ * Begin the second pass, writing into `bytes` which must hold rlpWriterGetBytesCount() bytes.
+ * If `bytes` is NULL, then the writer allocates the bytes.
+ */
+extern void
+rlpWriterBeginWriting (BRRlpWriter writer, uint8_t *bytes);
+
+/**
+ * End the second pass and return the encoding.  If the writer allocated the bytes then you own
+ * them and must call rlpDataRelease().  The writer is then ready for another encoding.
+ */
+extern BRRlpData
+rlpWriterEndWriting (BRRlpWriter writer);
+
+/**
+ * Return the bytes written from `offset` (a prior rlpWriterGetBytesCount()) to now.  Only
+ * valid in the second pass.  You DO NOT own this data.
+ */
+extern BRRlpData
+rlpWriterGetDataSharedDontRelease (BRRlpWriter writer, size_t offset);
+
+extern void
+rlpWriterBeginList (BRRlpWriter writer);
+
+extern void
+rlpWriterEndList (BRRlpWriter writer);
+
+extern void
+rlpWriterWriteUInt64 (BRRlpWriter writer, uint64_t value, int zeroAsEmptyString);
+
+extern void
+rlpWriterWriteUInt256 (BRRlpWriter writer, UInt256 value, int zeroAsEmptyString);
+
+extern void
+rlpWriterWriteBytes (BRRlpWriter writer, const uint8_t *bytes, size_t bytesCount);
+
+extern void
+rlpWriterWriteBytesPurgeLeadingZeros (BRRlpWriter writer, const uint8_t *bytes, size_t bytesCount);
+
+extern void
+rlpWriterWriteString (BRRlpWriter writer, const char *string);
+
+extern void
+rlpWriterWriteHexString (BRRlpWriter writer, const char *string);
+
+/**
+ * Write `data`, which is already an RLP encoding, as is.
+ */
+extern void
+rlpWriterWriteData (BRRlpWriter writer, BRRlpData data);
+
+/**
+ * Write the encoding of `item`.  Use this for parts of an encoding only available as items.
+ */
+extern void
+rlpWriterWriteItem (BRRlpWriter writer, BRRlpCoder coder, BRRlpItem item);
+
 //
 // Show
 //
@@ -175,8 +175,187 @@ void runRlpDecodeTest () {
     rlpCoderRelease(coder);
 }
 
+void runRlpDecodeNestedTest () {
+    printf ("         Decode Nested\n");
+    BRRlpCoder coder = rlpCoderCreate();
+    size_t c;
+
+    // [ [0, "dog"], [1, "dog"], ... ] with more items than fit in any item
+    BRRlpItem pairs[300];
+    for (size_t index = 0; index < 300; index++)
+        pairs[index] = rlpEncodeList2 (coder,
+                                       rlpEncodeUInt64 (coder, index, 0),
+                                       rlpEncodeString (coder, RLP_S1));
+    BRRlpItem listItem = rlpEncodeListItems (coder, pairs, 300);
+    BRRlpData listData = rlpItemGetData (coder, listItem);
+    rlpItemRelease (coder, listItem);
+
+    BRRlpItem item = rlpDataGetItem (coder, listData);
+    const BRRlpItem *items = rlpDecodeList (coder, item, &c);
+    assert (300 == c);
+
+    for (size_t index = 0; index < c; index++) {
+        size_t pairCount;
+        const BRRlpItem *pair = rlpDecodeList (coder, items[index], &pairCount);
+        assert (2 == pairCount);
+        assert (index == rlpDecodeUInt64 (coder, pair[0], 0));
+
+        BRRlpData dog = rlpDecodeBytesSharedDontRelease (coder, pair[1]);
+        assert (equalBytes (dog.bytes, dog.bytesCount, (uint8_t *) RLP_S1, strlen (RLP_S1)));
+    }
+
+    // A decoded item, as a sub-item of an encoded list, is released with that list.
+    BRRlpItem wrapItem = rlpEncodeList2 (coder, item, rlpEncodeString (coder, RLP_S1));
+    BRRlpData wrapData = rlpItemGetData (coder, wrapItem);
+    assert (wrapData.bytesCount > listData.bytesCount);
+    assert (0 == memcmp (&wrapData.bytes[wrapData.bytesCount - listData.bytesCount - 4],
+                         listData.bytes, listData.bytesCount));
+    rlpItemRelease (coder, wrapItem);
+
+    rlpDataRelease (wrapData);
+    rlpDataRelease (listData);
+    rlpCoderRelease(coder);
+}
+
+void runRlpViewTest () {
+    printf ("         View\n");
+    BRRlpCoder coder = rlpCoderCreate();
+
+    // [ "cat", "dog" ]
+    uint8_t l1b[] = RLP_L1_RES;
+    BRRlpView l1v = rlpDataGetView ((BRRlpData) { sizeof (l1b), l1b });
+    assert (rlpViewIsValid (l1v));
+    assert (rlpViewIsList (l1v));
+    assert (2 == rlpViewGetItemsCount (l1v));
+
+    BRRlpView l1vs[2];
+    assert (2 == rlpViewGetItems (l1v, l1vs, 2));
+    BRRlpData dog = rlpViewDecodeBytesSharedDontRelease (l1vs[1]);
+    assert (equalBytes (dog.bytes, dog.bytesCount, (uint8_t *) RLP_S1, strlen (RLP_S1)));
+    assert (dog.bytes == &l1b[6]);    // shared, not copied
+    assert (rlpViewIsEmpty (rlpViewGetItem (l1v, 2)));
+
+    // Truncated lengths, at any level, are invalid.
+    assert (!rlpViewIsValid (rlpDataGetView ((BRRlpData) { sizeof (l1b) - 1, l1b })));
+    l1b[1] = 0x88;
+    assert (!rlpViewIsValid (rlpDataGetView ((BRRlpData) { sizeof (l1b), l1b })));
+
+    uint8_t s3b[] = RLP_S3_RES;
+    BRRlpView s3v = rlpDataGetView ((BRRlpData) { sizeof (s3b), s3b });
+    assert (rlpViewIsValid (s3v) && !rlpViewIsList (s3v));
+    assert (56 == rlpViewDecodeBytesSharedDontRelease (s3v).bytesCount);
+
+    uint8_t v3b[] = RLP_V3_RES;
+    assert (1024 == rlpViewDecodeUInt64 (rlpDataGetView ((BRRlpData) { sizeof (v3b), v3b })));
+
+    // A number too large for its target, as from a misbehaving peer, is truncated.
+    uint8_t v9b[] = { 0x89, 0xff, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+    assert (0x0102030405060708 == rlpViewDecodeUInt64 (rlpDataGetView ((BRRlpData) { sizeof (v9b), v9b })));
+
+    // Views agree with items
+    BRRlpItem item = rlpEncodeList2 (coder,
+                                     rlpEncodeUInt256 (coder, uint256Create (1024), 0),
+                                     rlpEncodeList (coder, 0));
+    BRRlpView view = rlpItemGetView (coder, item);
+    assert (rlpViewIsValid (view));
+    assert (0 == rlpViewGetItemsCount (rlpViewGetItem (view, 1)));
+    assert (rlpViewIsList (rlpViewGetItem (view, 1)));
+
+    UInt256 value = rlpViewDecodeUInt256 (rlpViewGetItem (view, 0));
+    assert (UInt256Eq (value, uint256Create (1024)));
+
+    BRRlpItem viewItem = rlpViewCreateItem (coder, rlpViewGetItem (view, 0));
+    assert (1024 == rlpDecodeUInt64 (coder, viewItem, 0));
+    rlpItemRelease (coder, viewItem);
+    rlpItemRelease (coder, item);
+
+    rlpCoderRelease(coder);
+}
+
+static void
+writeNested (BRRlpWriter writer, size_t count) {
+    // [ [0, "dog", 0x1234], [1, "dog", 0x1234], ..., [] ]
+    rlpWriterBeginList (writer);
+    for (size_t index = 0; index < count; index++) {
+        rlpWriterBeginList (writer);
+        rlpWriterWriteUInt64 (writer, index, 0);
+        rlpWriterWriteString (writer, RLP_S1);
+        rlpWriterWriteHexString (writer, "0x1234");
+        rlpWriterEndList (writer);
+    }
+    rlpWriterBeginList (writer);
+    rlpWriterEndList (writer);
+    rlpWriterEndList (writer);
+}
+
+static void
+writeMixed (BRRlpWriter writer, BRRlpCoder coder, BRRlpItem item) {
+    // [ "", 0, 1024, "Lorem ipsum ..." ]
+    rlpWriterBeginList (writer);
+    rlpWriterWriteUInt64 (writer, 0, 1);
+    rlpWriterWriteUInt64 (writer, 0, 0);
+    rlpWriterWriteUInt256 (writer, uint256Create (1024), 0);
+    rlpWriterWriteItem (writer, coder, item);
+    rlpWriterEndList (writer);
+}
+
+void runRlpWriterTest () {
+    printf ("         Writer\n");
+    BRRlpCoder coder = rlpCoderCreate();
+    BRRlpWriter writer = rlpWriterCreate();
+
+    // The writer agrees with items, across short and long list lengths.
+    size_t counts[] = { 0, 1, 5, 300 };
+    for (size_t c = 0; c < sizeof (counts) / sizeof (size_t); c++) {
+        size_t count = counts[c];
+
+        BRRlpItem items[count + 1];
+        for (size_t index = 0; index < count; index++)
+            items[index] = rlpEncodeList (coder, 3,
+                                          rlpEncodeUInt64 (coder, index, 0),
+                                          rlpEncodeString (coder, RLP_S1),
+                                          rlpEncodeHexString (coder, "0x1234"));
+        items[count] = rlpEncodeListItems (coder, NULL, 0);
+        BRRlpItem item = rlpEncodeListItems (coder, items, count + 1);
+        BRRlpData itemData = rlpItemGetData (coder, item);
+        rlpItemRelease (coder, item);
+
+        writeNested (writer, count);
+        assert (itemData.bytesCount == rlpWriterGetBytesCount (writer));
+        rlpWriterBeginWriting (writer, NULL);
+        writeNested (writer, count);
+        BRRlpData writerData = rlpWriterEndWriting (writer);
+
+        assert (equalBytes (itemData.bytes, itemData.bytesCount, writerData.bytes, writerData.bytesCount));
+        rlpDataRelease (writerData);
+        rlpDataRelease (itemData);
+    }
+
+    // Numbers and items, written into our own buffer.
+    BRRlpItem item = rlpEncodeString (coder, RLP_S3);
+    writeMixed (writer, coder, item);
+    assert (65 == rlpWriterGetBytesCount (writer));
+
+    uint8_t bytes[65];
+    rlpWriterBeginWriting (writer, bytes);
+    writeMixed (writer, coder, item);
+    BRRlpData data = rlpWriterEndWriting (writer);
+    assert (data.bytes == bytes && 65 == data.bytesCount);
+
+    uint8_t prefix[] = { 0xf8, 63, 0x80, 0x00, 0x82, 0x04, 0x00, 0xb8, 56 };
+    assert (0 == memcmp (bytes, prefix, sizeof (prefix)));
+    assert (0 == memcmp (&bytes[sizeof (prefix)], RLP_S3, 56));
+
+    rlpItemRelease (coder, item);
+    rlpWriterRelease (writer);
+    rlpCoderRelease(coder);
+}
+
 void runRlpTests (void) {
     printf ("==== RLP\n");
     runRlpEncodeTest ();
     runRlpDecodeTest ();
+    runRlpDecodeNestedTest ();
+    runRlpViewTest ();
+    runRlpWriterTest ();
 }
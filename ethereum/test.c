@@ -513,6 +513,8 @@ runPerfTestsCoder (int repeat, int many) {
     BREthereumTransaction transaction = transactionRlpDecode(item, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, coder);
 
     BRRlpItem items [100];
+    BRRlpWriter writer = rlpWriterCreate();
+    clock_t itemTime = 0, writerTime = 0;
 
     while (repeat-- > 0) {
         if (many) coder = rlpCoderCreate();
@@ -524,9 +526,40 @@ runPerfTestsCoder (int repeat, int many) {
 
         for (int i = 0; i < 100; i++)
             rlpItemRelease(coder, items[i]);
+
+        // Encode a list of 100 transactions, as in LES SendTx, with items and with a writer.
+        clock_t start = clock();
+        for (int i = 0; i < 100; i++)
+            items[i] = transactionRlpEncode(transaction, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, coder);
+        BRRlpItem listItem = rlpEncodeListItems (coder, items, 100);
+        BRRlpData itemData = rlpItemGetData (coder, listItem);
+        rlpItemRelease (coder, listItem);
+        itemTime += clock() - start;
+
+        start = clock();
+        for (int pass = 0; pass < 2; pass++) {
+            if (1 == pass) rlpWriterBeginWriting (writer, NULL);
+            rlpWriterBeginList (writer);
+            for (int i = 0; i < 100; i++)
+                transactionRlpWrite (transaction, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, writer);
+            rlpWriterEndList (writer);
+        }
+        BRRlpData writerData = rlpWriterEndWriting (writer);
+        writerTime += clock() - start;
+
+        assert (itemData.bytesCount == writerData.bytesCount &&
+                0 == memcmp (itemData.bytes, writerData.bytes, itemData.bytesCount));
+        rlpDataRelease (itemData);
+        rlpDataRelease (writerData);
+
         if (many) rlpCoderRelease(coder);
     }
 
+    printf ("    Encode 100 Transactions: Item: %.3f ms, Writer: %.3f ms\n",
+            1000.0 * itemTime / CLOCKS_PER_SEC,
+            1000.0 * writerTime / CLOCKS_PER_SEC);
+
+    rlpWriterRelease (writer);
     rlpItemRelease(coderSaved, item);
     rlpCoderRelease(coderSaved);
 }
@@ -340,4 +340,11 @@ extern "C" {
     genManagerSaveTransfer (BRGenericManager gwm,
                             BRGenericTransfer transfer);
 
+    /**
+     * Save all of `transfers` in a single DB transaction.
+     */
+    extern void
+    genManagerSaveTransfers (BRGenericManager gwm,
+                             OwnershipKept BRArrayOf(BRGenericTransfer) transfers);
+
 #endif /* BRGeneric_h */
@@ -513,6 +513,13 @@ genManagerSaveTransfer (BRGenericManager gwm,
     fileServiceSave (gwm->fileService, fileServiceTypeTransactions, transfer);
 }
 
+extern void
+genManagerSaveTransfers (BRGenericManager gwm,
+                         OwnershipKept BRArrayOf(BRGenericTransfer) transfers) {
+    fileServiceSaveMany (gwm->fileService, fileServiceTypeTransactions,
+                         (const void **) transfers, array_count (transfers));
+}
+
 /// MARK: Periodic Dispatcher
 
 static void
@@ -84,10 +84,17 @@ extern "C" {
          * Use acomplete block chain sync, even starting at block zero (but usually from a block
          * derived from the accounts `earliestStartTime` (or the BIP-39 introduction block).
          */
-        CRYPTO_SYNC_MODE_P2P_ONLY
+        CRYPTO_SYNC_MODE_P2P_ONLY,
+
+        /**
+         * Use a complete block chain sync, as P2P_ONLY, but match the wallet against BIP-157/158
+         * compact block filters served by peers rather than loading a bloom filter into them; only
+         * blocks whose filters match are downloaded.  Peers must advertise compact filter support.
+         */
+        CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS
     } BRCryptoSyncMode;
 
-#define NUMBER_OF_SYNC_MODES    (1 + CRYPTO_SYNC_MODE_P2P_ONLY)
+#define NUMBER_OF_SYNC_MODES    (1 + CRYPTO_SYNC_MODE_P2P_BLOCK_FILTERS)
 
     extern const char *
     cryptoSyncModeString (BRCryptoSyncMode m);
@@ -27,11 +27,14 @@
 #include "BRBase58.h"
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 #define BIP32_SEED_KEY "Bitcoin seed"
 #define BIP32_XPRV     "\x04\x88\xAD\xE4"
 #define BIP32_XPUB     "\x04\x88\xB2\x1E"
 
+#define BIP32_MAX_THREADS 64
+
 // BIP32 is a scheme for deriving chains of addresses from a seed value
 // https://github.com/bitcoin/bips/blob/master/bip-0032.mediawiki
 
@@ -154,6 +157,74 @@ size_t BRBIP32PubKey(uint8_t *pubKey, size_t pubKeyLen, BRMasterPubKey mpk, uint
     return (! pubKey || sizeof(BRECPoint) <= pubKeyLen) ? sizeof(BRECPoint) : 0;
 }
 
+// returns the extended public key for the chain node N(m/0H/chain), which can be kept and passed to
+// BRBIP32PubKeyRange() to derive keys in the chain without repeating the chain node derivation
+BRMasterPubKey BRBIP32ChainPubKey(BRMasterPubKey mpk, uint32_t chain)
+{
+    BRMasterPubKey cpk = mpk;
+    UInt160 hash160;
+    
+    assert(memcmp(&mpk, &BR_MASTER_PUBKEY_NONE, sizeof(mpk)) != 0);
+    BRHash160(&hash160, mpk.pubKey, sizeof(mpk.pubKey));
+    cpk.fingerPrint = hash160.u32[0];
+    _CKDpub((BRECPoint *)cpk.pubKey, &cpk.chainCode, chain); // path N(m/0H/chain)
+    return cpk;
+}
+
+typedef struct {
+    BRECPoint *pubKeys;
+    const BRMasterPubKey *cpk;
+    uint32_t start;
+    size_t count, offset, stride;
+} BRBIP32PubKeyWorker;
+
+// derives pubKeys offset, offset + stride, offset + stride*2, ... from the chain node
+static void *_BRBIP32PubKeyWorkerRoutine(void *info)
+{
+    BRBIP32PubKeyWorker *worker = info;
+    UInt256 chainCode;
+    
+    for (size_t i = worker->offset; i < worker->count; i += worker->stride) {
+        chainCode = worker->cpk->chainCode;
+        worker->pubKeys[i] = *(const BRECPoint *)worker->cpk->pubKey;
+        _CKDpub(&worker->pubKeys[i], &chainCode, worker->start + (uint32_t)i); // index'th key in chain
+    }
+    
+    var_clean(&chainCode);
+    return NULL;
+}
+
+// writes the public keys for paths N(m/0H/chain/start) through N(m/0H/chain/start + count - 1) to pubKeys, where cpk
+// is the chain node from BRBIP32ChainPubKey(), deriving keys on up to threadCount threads (including the calling thread)
+void BRBIP32PubKeyRange(BRECPoint pubKeys[], size_t count, BRMasterPubKey cpk, uint32_t start, size_t threadCount)
+{
+    size_t i;
+    
+    assert(pubKeys != NULL || count == 0);
+    assert(memcmp(&cpk, &BR_MASTER_PUBKEY_NONE, sizeof(cpk)) != 0);
+    if (! pubKeys || count == 0) return;
+    if (threadCount > count) threadCount = count;
+    if (threadCount > BIP32_MAX_THREADS) threadCount = BIP32_MAX_THREADS;
+    if (threadCount < 1) threadCount = 1;
+    
+    BRBIP32PubKeyWorker workers[threadCount];
+    pthread_t threads[threadCount];
+    int started[threadCount];
+    
+    for (i = 0; i < threadCount; i++) {
+        workers[i] = (BRBIP32PubKeyWorker) { pubKeys, &cpk, start, count, i, threadCount };
+        started[i] = (i > 0 && pthread_create(&threads[i], NULL, _BRBIP32PubKeyWorkerRoutine, &workers[i]) == 0);
+    }
+    
+    for (i = 0; i < threadCount; i++) {
+        if (i == 0 || ! started[i]) _BRBIP32PubKeyWorkerRoutine(&workers[i]); // calling thread does any unstarted work
+    }
+    
+    for (i = 1; i < threadCount; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+}
+
 // sets the private key for path m/0H/chain/index to key
 void BRBIP32PrivKey(BRKey *key, const void *seed, size_t seedLen, uint32_t chain, uint32_t index)
 {
@@ -191,6 +262,77 @@ void BRBIP32PrivKeyList(BRKey keys[], size_t keysCount, const void *seed, size_t
     }
 }
 
+typedef struct {
+    BRKey *keys;
+    const uint32_t *indexes;
+    const UInt256 *secret, *chainCode;
+    size_t count, offset, stride;
+} BRBIP32KeyWorker;
+
+// derives keys offset, offset + stride, offset + stride*2, ... from the chain's extended private key
+static void *_BRBIP32KeyWorkerRoutine(void *info)
+{
+    BRBIP32KeyWorker *worker = info;
+    UInt256 s, c;
+    
+    for (size_t i = worker->offset; i < worker->count; i += worker->stride) {
+        s = *worker->secret;
+        c = *worker->chainCode;
+        _CKDpriv(&s, &c, worker->indexes[i]); // index'th key in chain
+        BRKeySetSecret(&worker->keys[i], &s, 1);
+        BRKeyPubKey(&worker->keys[i], NULL, 0);
+    }
+    
+    var_clean(&s, &c);
+    return NULL;
+}
+
+// sets the private key for path m/0H/chain/index to each element in keys, deriving keys on up to threadCount threads
+// (including the calling thread), and also computes each key's public key
+void BRBIP32PrivKeyListParallel(BRKey keys[], size_t keysCount, const void *seed, size_t seedLen, uint32_t chain,
+                                const uint32_t indexes[], size_t threadCount)
+{
+    UInt512 I;
+    UInt256 secret, chainCode;
+    size_t i;
+    
+    assert(keys != NULL || keysCount == 0);
+    assert(seed != NULL || seedLen == 0);
+    assert(indexes != NULL || keysCount == 0);
+    
+    if (keys && keysCount > 0 && (seed || seedLen == 0) && indexes) {
+        BRHMAC(&I, BRSHA512, sizeof(UInt512), BIP32_SEED_KEY, strlen(BIP32_SEED_KEY), seed, seedLen);
+        secret = *(UInt256 *)&I;
+        chainCode = *(UInt256 *)&I.u8[sizeof(UInt256)];
+        var_clean(&I);
+
+        _CKDpriv(&secret, &chainCode, 0 | BIP32_HARD); // path m/0H
+        _CKDpriv(&secret, &chainCode, chain); // path m/0H/chain
+        if (threadCount > keysCount) threadCount = keysCount;
+        if (threadCount > BIP32_MAX_THREADS) threadCount = BIP32_MAX_THREADS;
+        if (threadCount < 1) threadCount = 1;
+        
+        BRBIP32KeyWorker workers[threadCount];
+        pthread_t threads[threadCount];
+        int started[threadCount];
+        
+        for (i = 0; i < threadCount; i++) {
+            workers[i] = (BRBIP32KeyWorker) { keys, indexes, &secret, &chainCode, keysCount, i, threadCount };
+            started[i] = (i > 0 && pthread_create(&threads[i], NULL, _BRBIP32KeyWorkerRoutine, &workers[i]) == 0);
+        }
+        
+        for (i = 0; i < threadCount; i++) {
+            if (i == 0 || ! started[i]) _BRBIP32KeyWorkerRoutine(&workers[i]); // calling thread does any unstarted work
+        }
+        
+        for (i = 1; i < threadCount; i++) {
+            if (started[i]) pthread_join(threads[i], NULL);
+        }
+        
+        var_clean(&secret, &chainCode);
+    }
+}
+
 // sets the private key for the specified path to key
 // depth is the number of arguments used to specify the path
 void BRBIP32PrivKeyPath(BRKey *key, const void *seed, size_t seedLen, int depth, ...)
@@ -82,12 +82,25 @@ BRMasterPubKey BRBIP32MasterPubKey(const void *seed, size_t seedLen);
 // returns number of bytes written, or pubKeyLen needed if pubKey is NULL
 size_t BRBIP32PubKey(uint8_t *pubKey, size_t pubKeyLen, BRMasterPubKey mpk, uint32_t chain, uint32_t index);
 
+// returns the extended public key for the chain node N(m/0H/chain), which can be kept and passed to
+// BRBIP32PubKeyRange() to derive keys in the chain without repeating the chain node derivation
+BRMasterPubKey BRBIP32ChainPubKey(BRMasterPubKey mpk, uint32_t chain);
+
+// writes the public keys for paths N(m/0H/chain/start) through N(m/0H/chain/start + count - 1) to pubKeys, where cpk
+// is the chain node from BRBIP32ChainPubKey(), deriving keys on up to threadCount threads (including the calling thread)
+void BRBIP32PubKeyRange(BRECPoint pubKeys[], size_t count, BRMasterPubKey cpk, uint32_t start, size_t threadCount);
+
 // sets the private key for path m/0H/chain/index to key
 void BRBIP32PrivKey(BRKey *key, const void *seed, size_t seedLen, uint32_t chain, uint32_t index);
 
 // sets the private key for path m/0H/chain/index to each element in keys
 void BRBIP32PrivKeyList(BRKey keys[], size_t keysCount, const void *seed, size_t seedLen, uint32_t chain,
                         const uint32_t indexes[]);
+
+// sets the private key for path m/0H/chain/index to each element in keys, deriving keys on up to threadCount threads
+// (including the calling thread), and also computes each key's public key
+void BRBIP32PrivKeyListParallel(BRKey keys[], size_t keysCount, const void *seed, size_t seedLen, uint32_t chain,
+                                const uint32_t indexes[], size_t threadCount);
     
 // sets the private key for the specified path to key
 // depth is the number of arguments used to specify the path
@@ -23,9 +23,11 @@
 //  THE SOFTWARE.
 
 #include "BRCrypto.h"
+#include "BRInt.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 // endian swapping
 #if __BIG_ENDIAN__ || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
@@ -110,84 +112,266 @@ void BRSHA1(void *md20, const void *data, size_t dataLen)
 #define s2(x) (ror32((x), 7) ^ ror32((x), 18) ^ ((x) >> 3))
 #define s3(x) (ror32((x), 17) ^ ror32((x), 19) ^ ((x) >> 10))
 
-static void _BRSHA256Compress(uint32_t *r, const uint32_t *x)
+static const uint32_t _sha256K[] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t _sha256IV[] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// loads a big endian 32bit word from a possibly unaligned buffer
+#define _sha256Load(p) ((uint32_t)(p)[0] << 24 | (uint32_t)(p)[1] << 16 | (uint32_t)(p)[2] << 8 | (uint32_t)(p)[3])
+
+// portable sha-256 compression of blockCount consecutive 64 byte blocks
+static void _BRSHA256Compress(uint32_t *r, const uint8_t *blocks, size_t blockCount)
 {
-    static const uint32_t k[] = {
-        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-    };
-    
     int i;
-    uint32_t a = r[0], b = r[1], c = r[2], d = r[3], e = r[4], f = r[5], g = r[6], h = r[7], t1, t2, w[64];
-    
-    for (i = 0; i < 16; i++) w[i] = be32(x[i]);
-    for (; i < 64; i++) w[i] = s3(w[i - 2]) + w[i - 7] + s2(w[i - 15]) + w[i - 16];
+    uint32_t a, b, c, d, e, f, g, h, t1, t2, w[64];
     
-    for (i = 0; i < 64; i++) {
-        t1 = h + s1(e) + ch(e, f, g) + k[i] + w[i];
-        t2 = s0(a) + maj(a, b, c);
-        h = g, g = f, f = e, e = d + t1, d = c, c = b, b = a, a = t1 + t2;
+    for (; blockCount > 0; blockCount--, blocks += 64) {
+        a = r[0], b = r[1], c = r[2], d = r[3], e = r[4], f = r[5], g = r[6], h = r[7];
+        for (i = 0; i < 16; i++) w[i] = _sha256Load(&blocks[i*4]);
+        for (; i < 64; i++) w[i] = s3(w[i - 2]) + w[i - 7] + s2(w[i - 15]) + w[i - 16];
+        
+        for (i = 0; i < 64; i++) {
+            t1 = h + s1(e) + ch(e, f, g) + _sha256K[i] + w[i];
+            t2 = s0(a) + maj(a, b, c);
+            h = g, g = f, f = e, e = d + t1, d = c, c = b, b = a, a = t1 + t2;
+        }
+        
+        r[0] += a, r[1] += b, r[2] += c, r[3] += d, r[4] += e, r[5] += f, r[6] += g, r[7] += h;
     }
     
-    r[0] += a, r[1] += b, r[2] += c, r[3] += d, r[4] += e, r[5] += f, r[6] += g, r[7] += h;
     var_clean(&a, &b, &c, &d, &e, &f, &g, &h, &t1, &t2);
     mem_clean(w, sizeof(w));
 }
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SHA256_X86 1
+#include <immintrin.h>
+#include <cpuid.h>
+
+// four rounds using the intel sha extensions, m0 holds the message words for rounds i*4 to i*4 + 3, and the message
+// schedule for the following rounds is computed into m1 and m3 along the way
+#define shani4(i, m0, m1, m2, m3) do {\
+    msg = _mm_add_epi32((m0), _mm_loadu_si128((const __m128i *)&_sha256K[(i)*4]));\
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);\
+    if ((i) >= 3 && (i) <= 14) (m1) = _mm_sha256msg2_epu32(_mm_add_epi32((m1), _mm_alignr_epi8((m0), (m3), 4)), (m0));\
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));\
+    if ((i) >= 1 && (i) <= 12) (m3) = _mm_sha256msg1_epu32((m3), (m0));\
+} while (0)
+
+// sha-256 compression using the intel sha extensions (SHA-NI)
+__attribute__((target("sha,sse4.1")))
+static void _BRSHA256CompressSHANI(uint32_t *r, const uint8_t *blocks, size_t blockCount)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, save0, save1, msg, m0, m1, m2, m3, t;
+    
+    t = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&r[0]), 0xb1); // cdab
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&r[4]), 0x1b); // efgh
+    state0 = _mm_alignr_epi8(t, state1, 8); // abef
+    state1 = _mm_blend_epi16(state1, t, 0xf0); // cdgh
+    
+    for (; blockCount > 0; blockCount--, blocks += 64) {
+        save0 = state0, save1 = state1;
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&blocks[0]), mask);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&blocks[16]), mask);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&blocks[32]), mask);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&blocks[48]), mask);
+        shani4(0, m0, m1, m2, m3); shani4(1, m1, m2, m3, m0); shani4(2, m2, m3, m0, m1); shani4(3, m3, m0, m1, m2);
+        shani4(4, m0, m1, m2, m3); shani4(5, m1, m2, m3, m0); shani4(6, m2, m3, m0, m1); shani4(7, m3, m0, m1, m2);
+        shani4(8, m0, m1, m2, m3); shani4(9, m1, m2, m3, m0); shani4(10, m2, m3, m0, m1); shani4(11, m3, m0, m1, m2);
+        shani4(12, m0, m1, m2, m3); shani4(13, m1, m2, m3, m0); shani4(14, m2, m3, m0, m1); shani4(15, m3, m0, m1, m2);
+        state0 = _mm_add_epi32(state0, save0);
+        state1 = _mm_add_epi32(state1, save1);
+    }
+    
+    t = _mm_shuffle_epi32(state0, 0x1b); // feba
+    state1 = _mm_shuffle_epi32(state1, 0xb1); // dchg
+    _mm_storeu_si128((__m128i *)&r[0], _mm_blend_epi16(t, state1, 0xf0)); // dcba
+    _mm_storeu_si128((__m128i *)&r[4], _mm_alignr_epi8(state1, t, 8)); // hgfe
+}
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+#define SHA256_ARMV8 1
+#include <arm_neon.h>
+
+// sha-256 compression using the armv8 cryptography extensions, which every target built with them is guaranteed to have
+static void _BRSHA256CompressARMv8(uint32_t *r, const uint8_t *blocks, size_t blockCount)
+{
+    uint32x4_t state0 = vld1q_u32(&r[0]), state1 = vld1q_u32(&r[4]), save0, save1, m[4], t0, t1;
+    int i;
+    
+    for (; blockCount > 0; blockCount--, blocks += 64) {
+        save0 = state0, save1 = state1;
+        for (i = 0; i < 4; i++) m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&blocks[i*16])));
+        
+        for (i = 0; i < 16; i++) {
+            t0 = vaddq_u32(m[i % 4], vld1q_u32(&_sha256K[i*4]));
+            
+            if (i < 12) {
+                m[i % 4] = vsha256su1q_u32(vsha256su0q_u32(m[i % 4], m[(i + 1) % 4]), m[(i + 2) % 4],
+                                           m[(i + 3) % 4]);
+            }
+            
+            t1 = state0;
+            state0 = vsha256hq_u32(state0, state1, t0);
+            state1 = vsha256h2q_u32(state1, t1, t0);
+        }
+        
+        state0 = vaddq_u32(state0, save0);
+        state1 = vaddq_u32(state1, save1);
+    }
+    
+    vst1q_u32(&r[0], state0);
+    vst1q_u32(&r[4], state1);
+}
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SHA256_LANES 1
+
+typedef uint32_t _BRUInt32x4 __attribute__((vector_size(16)));
+typedef uint32_t _BRUInt32x8 __attribute__((vector_size(32)));
+
+// defines a function that computes the sha-256 of n messages of dataLen bytes spaced stride bytes apart at once, one
+// per vector lane, writing n consecutive digests to mds, the sha-256 round functions above work unchanged on vectors
+#define SHA256_LANES_FUNC(name, vec, n, attr)\
+attr static void name(uint8_t *mds, const uint8_t *data, size_t dataLen, size_t stride)\
+{\
+    size_t i, j, l, blocks = dataLen/64, tail = dataLen % 64, padBlocks = (tail < 56) ? 1 : 2;\
+    uint8_t pad[n][128];\
+    const uint8_t *p[n];\
+    vec r[8], a, b, c, d, e, f, g, h, t1, t2, w[64];\
+    \
+    for (i = 0; i < 8; i++) for (l = 0; l < n; l++) r[i][l] = _sha256IV[i];\
+    \
+    for (l = 0; l < n; l++) {\
+        memcpy(pad[l], &data[l*stride + blocks*64], tail);\
+        memset(&pad[l][tail], 0, sizeof(pad[l]) - tail);\
+        pad[l][tail] = 0x80;\
+        for (i = 0; i < 8; i++) pad[l][padBlocks*64 - 1 - i] = (uint8_t)(((uint64_t)dataLen << 3) >> (i*8));\
+    }\
+    \
+    for (j = 0; j < blocks + padBlocks; j++) {\
+        for (l = 0; l < n; l++) p[l] = (j < blocks) ? &data[l*stride + j*64] : &pad[l][(j - blocks)*64];\
+        for (i = 0; i < 16; i++) for (l = 0; l < n; l++) w[i][l] = _sha256Load(&p[l][i*4]);\
+        for (; i < 64; i++) w[i] = s3(w[i - 2]) + w[i - 7] + s2(w[i - 15]) + w[i - 16];\
+        a = r[0], b = r[1], c = r[2], d = r[3], e = r[4], f = r[5], g = r[6], h = r[7];\
+        \
+        for (i = 0; i < 64; i++) {\
+            t1 = h + s1(e) + ch(e, f, g) + _sha256K[i] + w[i];\
+            t2 = s0(a) + maj(a, b, c);\
+            h = g, g = f, f = e, e = d + t1, d = c, c = b, b = a, a = t1 + t2;\
+        }\
+        \
+        r[0] += a, r[1] += b, r[2] += c, r[3] += d, r[4] += e, r[5] += f, r[6] += g, r[7] += h;\
+    }\
+    \
+    for (l = 0; l < n; l++) for (i = 0; i < 8; i++) UInt32SetBE(&mds[l*32 + i*4], r[i][l]);\
+    mem_clean(pad, sizeof(pad));\
+    mem_clean(w, sizeof(w));\
+}
+
+#ifndef SHA256_ARMV8
+// four lanes of sse2 on x86-64, or neon on arm64 without the sha extensions, which beat any number of lanes
+SHA256_LANES_FUNC(_BRSHA256Lanes4, _BRUInt32x4, 4, )
+#endif
+
+#ifdef SHA256_X86
+// eight lanes of avx2
+SHA256_LANES_FUNC(_BRSHA256Lanes8, _BRUInt32x8, 8, __attribute__((target("avx2"))))
+#endif
+#endif
+
+// sha-256 compression of blockCount consecutive 64 byte blocks, and how many messages the batch api hashes at once,
+// selected by _BRSHA256Init() for the cpu we're running on
+static void (*_BRSHA256CompressBlocks)(uint32_t *r, const uint8_t *blocks, size_t blockCount) = _BRSHA256Compress;
+static void (*_BRSHA256LanesN)(uint8_t *mds, const uint8_t *data, size_t dataLen, size_t stride) = NULL;
+static size_t _sha256Lanes = 1;
+static pthread_once_t _sha256Once = PTHREAD_ONCE_INIT;
+
+static void _BRSHA256Init(void)
+{
+#ifdef SHA256_X86
+    unsigned int eax, ebx = 0, ecx = 0, edx, max = __get_cpuid_max(0, NULL), xcr0 = 0;
+    int sse41 = 0, avx = 0;
+    
+    if (max >= 1) {
+        __cpuid(1, eax, ebx, ecx, edx);
+        sse41 = ((ecx & (1 << 9)) && (ecx & (1 << 19))); // ssse3 and sse4.1
+        
+        if ((ecx & (1 << 27)) && (ecx & (1 << 28))) { // osxsave and avx, check the os saves the ymm registers
+            __asm__ ("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+            avx = ((xcr0 & 0x06) == 0x06);
+        }
+    }
+    
+    if (max >= 7) __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    else ebx = 0;
+    
+    // a single sha-ni stream beats eight avx2 lanes, so multi-buffer hashing is only used on cpus without it
+    if (sse41 && (ebx & (1 << 29))) _BRSHA256CompressBlocks = _BRSHA256CompressSHANI;
+    else if (avx && (ebx & (1 << 5))) _BRSHA256LanesN = _BRSHA256Lanes8, _sha256Lanes = 8;
+    else _BRSHA256LanesN = _BRSHA256Lanes4, _sha256Lanes = 4;
+#elif defined(SHA256_ARMV8)
+    _BRSHA256CompressBlocks = _BRSHA256CompressARMv8;
+#elif defined(SHA256_LANES)
+    _BRSHA256LanesN = _BRSHA256Lanes4, _sha256Lanes = 4;
+#endif
+}
+
+// sha-256 compression of data in to buf, including the final padding and length
+static void _BRSHA256Hash(uint32_t *buf, const void *data, size_t dataLen)
+{
+    size_t i = dataLen & ~(size_t)63;
+    uint8_t x[128];
+    
+    pthread_once(&_sha256Once, _BRSHA256Init);
+    if (i > 0) _BRSHA256CompressBlocks(buf, data, i/64); // process data in 64 byte blocks
+    if (dataLen > i) memcpy(x, (const uint8_t *)data + i, dataLen - i);
+    memset(&x[dataLen - i], 0, sizeof(x) - (dataLen - i)); // clear remainder of x
+    x[dataLen - i] = 0x80; // append padding
+    i = (dataLen - i < 56) ? 64 : 128; // length goes to next block if there's no room
+    UInt32SetBE(&x[i - 8], (uint32_t)(dataLen >> 29)), UInt32SetBE(&x[i - 4], (uint32_t)(dataLen << 3)); // length in bits
+    _BRSHA256CompressBlocks(buf, x, i/64); // finalize
+    mem_clean(x, sizeof(x));
+}
+
 void BRSHA224(void *md28, const void *data, size_t dataLen) {
     size_t i;
-    uint32_t x[16], buf[] = { 0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511,
-                              0x64f98fa7, 0xbefa4fa4 }; // initial buffer values
+    uint32_t buf[] = { 0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511,
+                       0x64f98fa7, 0xbefa4fa4 }; // initial buffer values
 
     assert(md28 != NULL);
     assert(data != NULL || dataLen == 0);
 
-    for (i = 0; i < dataLen; i += 64) { // process data in 64 byte blocks
-        memcpy(x, (const uint8_t *)data + i, (i + 64 < dataLen) ? 64 : dataLen - i);
-        if (i + 64 > dataLen) break;
-        _BRSHA256Compress(buf, x);
-    }
-
-    memset((uint8_t *)x + (dataLen - i), 0, 64 - (dataLen - i)); // clear remainder of x
-    ((uint8_t *)x)[dataLen - i] = 0x80; // append padding
-    if (dataLen - i >= 56) _BRSHA256Compress(buf, x), memset(x, 0, 64); // length goes to next block
-    x[14] = be32((uint32_t)(dataLen >> 29)), x[15] = be32((uint32_t)(dataLen << 3)); // append length in bits
-    _BRSHA256Compress(buf, x); // finalize
+    _BRSHA256Hash(buf, data, dataLen);
     for (i = 0; i < 7; i++) buf[i] = be32(buf[i]); // endian swap
     memcpy(md28, buf, 28); // write to md
-    mem_clean(x, sizeof(x));
     mem_clean(buf, sizeof(buf));
 }
 
 void BRSHA256(void *md32, const void *data, size_t dataLen)
 {
     size_t i;
-    uint32_t x[16], buf[] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c,
-                              0x1f83d9ab, 0x5be0cd19 }; // initial buffer values
+    uint32_t buf[8];
     
     assert(md32 != NULL);
     assert(data != NULL || dataLen == 0);
 
-    for (i = 0; i < dataLen; i += 64) { // process data in 64 byte blocks
-        memcpy(x, (const uint8_t *)data + i, (i + 64 < dataLen) ? 64 : dataLen - i);
-        if (i + 64 > dataLen) break;
-        _BRSHA256Compress(buf, x);
-    }
-    
-    memset((uint8_t *)x + (dataLen - i), 0, 64 - (dataLen - i)); // clear remainder of x
-    ((uint8_t *)x)[dataLen - i] = 0x80; // append padding
-    if (dataLen - i >= 56) _BRSHA256Compress(buf, x), memset(x, 0, 64); // length goes to next block
-    x[14] = be32((uint32_t)(dataLen >> 29)), x[15] = be32((uint32_t)(dataLen << 3)); // append length in bits
-    _BRSHA256Compress(buf, x); // finalize
+    memcpy(buf, _sha256IV, sizeof(buf)); // initial buffer values
+    _BRSHA256Hash(buf, data, dataLen);
     for (i = 0; i < 8; i++) buf[i] = be32(buf[i]); // endian swap
     memcpy(md32, buf, 32); // write to md
-    mem_clean(x, sizeof(x));
     mem_clean(buf, sizeof(buf));
 }
 
@@ -202,6 +386,47 @@ void BRSHA256_2(void *md32, const void *data, size_t dataLen)
     BRSHA256(md32, t, sizeof(t));
 }
 
+// sha-256 of count messages of dataLen bytes each, spaced stride bytes apart starting at data, written as count
+// consecutive 32 byte digests to mds32, which may be the same buffer as data if stride is at least 32
+// messages are hashed several at a time in parallel vector lanes on cpus without sha instructions
+void BRSHA256Batch(void *mds32, const void *data, size_t dataLen, size_t stride, size_t count)
+{
+    uint8_t *mds = mds32;
+    const uint8_t *d = data;
+    
+    assert(mds32 != NULL || count == 0);
+    assert(data != NULL || count == 0 || dataLen == 0);
+    pthread_once(&_sha256Once, _BRSHA256Init);
+    
+    for (; _BRSHA256LanesN && count >= _sha256Lanes; count -= _sha256Lanes) {
+        _BRSHA256LanesN(mds, d, dataLen, stride);
+        mds += 32*_sha256Lanes;
+        d += stride*_sha256Lanes;
+    }
+    
+    for (; count > 0; count--, mds += 32, d += stride) BRSHA256(mds, d, dataLen);
+}
+
+// double-sha-256 of count messages of dataLen bytes each, spaced stride bytes apart starting at data, written as count
+// consecutive 32 byte digests to mds32, which may be the same buffer as data if stride is at least 32
+void BRSHA256_2Batch(void *mds32, const void *data, size_t dataLen, size_t stride, size_t count)
+{
+    uint8_t t[64*32], *mds = mds32;
+    const uint8_t *d = data;
+    size_t n;
+    
+    assert(mds32 != NULL || count == 0);
+    assert(data != NULL || count == 0 || dataLen == 0);
+    
+    for (; count > 0; count -= n, mds += 32*n, d += stride*n) {
+        n = (count < sizeof(t)/32) ? count : sizeof(t)/32;
+        BRSHA256Batch(t, d, dataLen, stride, n);
+        BRSHA256Batch(mds, t, 32, 32, n);
+    }
+    
+    mem_clean(t, sizeof(t));
+}
+
 // bitwise right rotation
 #define ror64(a, b) (((a) >> (b)) | ((a) << (64 - (b))))
 
@@ -498,6 +723,31 @@ void BRKeccak256(void *md32, const void *data, size_t dataLen)
     mem_clean(buf, sizeof(buf));
 }
 
+// keccak-512: https://keccak.team/files/Keccak-submission-3.pdf
+void BRKeccak512(void *md64, const void *data, size_t dataLen)
+{
+    size_t i;
+    uint64_t x[9], buf[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    
+    assert(md64 != NULL);
+    assert(data != NULL || dataLen == 0);
+    
+    for (i = 0; i <= dataLen; i += 72) { // process data in 72 byte blocks
+        memcpy(x, (const uint8_t *)data + i, (i + 72 < dataLen) ? 72 : dataLen - i);
+        if (i + 72 > dataLen) break;
+        _BRSHA3Compress(buf, x, 72);
+    }
+    
+    memset((uint8_t *)x + (dataLen - i), 0, 72 - (dataLen - i)); // clear remainder of x
+    ((uint8_t *)x)[dataLen - i] |= 0x01; // append padding
+    ((uint8_t *)x)[71] |= 0x80;
+    _BRSHA3Compress(buf, x, 72); // finalize
+    for (i = 0; i < 8; i++) buf[i] = le64(buf[i]); // endian swap
+    memcpy(md64, buf, 64); // write to md
+    mem_clean(x, sizeof(x));
+    mem_clean(buf, sizeof(buf));
+}
+
 // basic md5 functions
 #define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
 #define G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
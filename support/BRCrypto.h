@@ -44,6 +44,15 @@ void BRSHA224(void *md28, const void *data, size_t dataLen);
 // double-sha-256 = sha-256(sha-256(x))
 void BRSHA256_2(void *md32, const void *data, size_t dataLen);
 
+// sha-256 of count messages of dataLen bytes each, spaced stride bytes apart starting at data, written as count
+// consecutive 32 byte digests to mds32, which may be the same buffer as data if stride is at least 32
+// messages are hashed several at a time in parallel vector lanes on cpus without sha instructions
+void BRSHA256Batch(void *mds32, const void *data, size_t dataLen, size_t stride, size_t count);
+
+// double-sha-256 of count messages of dataLen bytes each, spaced stride bytes apart starting at data, written as count
+// consecutive 32 byte digests to mds32, which may be the same buffer as data if stride is at least 32
+void BRSHA256_2Batch(void *mds32, const void *data, size_t dataLen, size_t stride, size_t count);
+
 void BRSHA384(void *md48, const void *data, size_t dataLen);
 
 void BRSHA512(void *md64, const void *data, size_t dataLen);
@@ -60,6 +69,9 @@ void BRSHA3_256(void *md32, const void *data, size_t dataLen);
 // keccak-256: https://keccak.team/files/Keccak-submission-3.pdf
 void BRKeccak256(void *md32, const void *data, size_t dataLen);
 
+// keccak-512: https://keccak.team/files/Keccak-submission-3.pdf
+void BRKeccak512(void *md64, const void *data, size_t dataLen);
+
 // md5 - for non-cryptographic use only
 void BRMD5(void *md16, const void *data, size_t dataLen);
 
@@ -31,6 +31,7 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <pthread.h>
+#include <sys/time.h>
 #include "../vendor/sqlite3/sqlite3.h"
 typedef int sqlite3_status_code;
 
@@ -44,12 +45,24 @@ typedef int sqlite3_status_code;
   Type      CHAR(64)    NOT NULL,       \n\
   Hash      CHAR(64)    NOT NULL,       \n\
   Data      TEXT        NOT NULL,       \n\
+  Key       INTEGER,                    \n\
   PRIMARY KEY (Type, Hash));"
 
+// `Key` is an optional, type-specific secondary key (e.g. a block height) used to filter loads.
+// It was added after `Entity`; older DBs are altered to include it.
+#define FILE_SERVICE_SDB_QUERY_KEY_COLUMN     \
+"SELECT Key FROM Entity LIMIT 0;"
+
+#define FILE_SERVICE_SDB_ADD_KEY_COLUMN     \
+"ALTER TABLE Entity ADD COLUMN Key INTEGER;"
+
+#define FILE_SERVICE_SDB_ENTITY_KEY_INDEX     \
+"CREATE INDEX IF NOT EXISTS EntityTypeKey ON Entity (Type, Key);"
+
 typedef char FileServiceSQL[1024];
 
 #define FILE_SERVICE_SDB_INSERT_ENTITY    \
-"INSERT OR REPLACE INTO Entity (Type, Hash, Data) VALUES (?, ?, ?);"
+"INSERT OR REPLACE INTO Entity (Type, Hash, Data, Key) VALUES (?, ?, ?, ?);"
 
 #define FILE_SERVICE_SDB_QUERY_ENTITY     \
 "SELECT Data FROM Entity WHERE Type = ? AND Hash = ?;"
@@ -57,8 +70,12 @@ typedef char FileServiceSQL[1024];
 #define FILE_SERVICE_SDB_QUERY_ALL_ENTITY     \
 "SELECT Hash, Data FROM Entity WHERE Type = ?;"
 
+// Rows without a `Key` are never filtered out.
+#define FILE_SERVICE_SDB_QUERY_ALL_FROM_KEY_ENTITY     \
+"SELECT Hash, Data FROM Entity WHERE Type = ? AND (Key IS NULL OR Key >= ?);"
+
 #define FILE_SERVICE_SDB_UPDATE_ENTITY     \
-"UPDATE Entity SET Data = ? WHERE Type = ? AND Hash = ?;"
+"UPDATE Entity SET Data = ?, Key = ? WHERE Type = ? AND Hash = ?;"
 
 #define FILE_SERVICE_SDB_DELETE_ENTITY     \
 "DELETE FROM Entity WHERE Type = ? AND Hash = ?;"
@@ -72,14 +89,14 @@ typedef char FileServiceSQL[1024];
 #if defined(DEBUG)
 static int needSQLiteCompileOptions = 1;
 #endif
-// HEX Encode/Decode - Cribbed from ethereum/util/BRUtilHex.c
+// HEX Decode - Cribbed from ethereum/util/BRUtilHex.c
+//
+// Entities are stored as a BLOB in the `Data` column.  Originally they were stored as hex-encoded
+// TEXT; such rows are still readable and are rewritten as a BLOB when loaded.
 
 // Convert a char into uint8_t (decode)
 #define decodeChar(c)           ((uint8_t) _hexu(c))
 
-// Convert a uint8_t into a char (encode)
-#define encodeChar(u)           ((char)    _hexc(u))
-
 static void
 hexDecode (uint8_t *target, size_t targetLen, const char *source, size_t sourceLen) {
     //
@@ -91,23 +108,21 @@ hexDecode (uint8_t *target, size_t targetLen, const char *source, size_t sourceL
     }
 }
 
-static void
-hexEncode (char *target, size_t targetLen, const uint8_t *source, size_t sourceLen) {
-    assert (targetLen == 2 * sourceLen  + 1);
-
-    for (int i = 0; i < sourceLen; i++) {
-        target[2*i + 0] = encodeChar (source[i] >> 4);
-        target[2*i + 1] = encodeChar (source[i]);
-    }
-    target[2*sourceLen] = '\0';
-}
-
 /** Forward Declarations */
 static int
 fileServiceFailedSDB (BRFileService fs,
                       int releaseLock,
                       sqlite3_status_code code);
 
+static int
+_fileServiceRemove (BRFileService fs,
+                    const char *type,
+                    UInt256 identifier,
+                    int needLock);
+
+static void
+_fileServiceWriteBehindStop (BRFileService fs);
+
 /// Return 0 on success, -1 otherwise
 static int directoryMake (const char *path) {
     struct stat dirStat;
@@ -142,6 +157,10 @@ typedef struct {
     char *type;
     BRFileServiceVersion currentVersion;
     BRArrayOf(BRFileServiceEntityHandler) handlers;
+
+    // Optional; independent of version
+    BRFileServiceContext keyContext;
+    BRFileServiceKey key;
 } BRFileServiceEntityType;
 
 static void
@@ -188,6 +207,28 @@ struct BRFileServiceRecord {
     sqlite3_stmt *sdbDeleteAllStmt;
     uint8_t  sdbClosed;
 
+    // The nesting depth of batches; a SQLite transaction is open iff non-zero.
+    size_t sdbBatchDepth;
+
+    // The nesting depth of batches that hold `lock`, begun w/o write-behind.  Guarded by `lock`
+    // and thus only ever non-zero for the thread holding `lock`.
+    size_t sdbLockedBatchDepth;
+
+    // Write-behind: queued writes, coalesced by (type, identifier), for the `writer` thread.
+    uint8_t writeBehind;
+    pthread_t writer;
+    pthread_mutex_t queueLock;
+    pthread_cond_t queueCond;           // signals `writer`
+    pthread_cond_t queueDrainedCond;    // signals those waiting on `writer`
+    BRSetOf(BRFileServicePendingWrite*) queue;
+    size_t queueBytesCount;             // bytes queued or being written
+    size_t queueBytesLimit;
+    size_t queueWaiters;
+    size_t queueFlushers;               // those of `queueWaiters` in fileServiceFlush()
+    size_t queueBatchDepth;             // open batches, begun with write-behind
+    uint8_t queueWriting;
+    uint8_t queueStopping;
+
     char *currency;
     char *network;
 
@@ -248,21 +289,39 @@ fileServiceCreate (const char *basePath,
     // Create the file service itself
     BRFileService fs = calloc (1, sizeof (struct BRFileServiceRecord));
 
+    // Recursive, because a batch holds `lock` from fileServiceBeginBatch() until its commit while
+    // the batch's own saves, removes, etc take `lock` again.
     {
         pthread_mutexattr_t attr;
         pthread_mutexattr_init(&attr);
-        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
 
         pthread_mutex_init(&fs->lock, &attr);
         pthread_mutexattr_destroy(&attr);
     }
 
+    // Write-behind state, including `writeBehind` itself, is guarded by `queueLock`.
+    {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_NORMAL);
+
+        pthread_mutex_init(&fs->queueLock, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
+
+    pthread_cond_init (&fs->queueCond, NULL);
+    pthread_cond_init (&fs->queueDrainedCond, NULL);
+
     // Set the error handler - early
     fileServiceSetErrorHandler (fs, context, handler);
 
     fs->sdb = NULL;
     fs->sdbPath = NULL;
     fs->sdbClosed = 0;
+    fs->sdbBatchDepth = 0;
+    fs->sdbLockedBatchDepth = 0;
+    fs->writeBehind = 0;
 
     // Save currency and network
     fs->currency = strdup (currency);
@@ -294,6 +353,26 @@ fileServiceCreate (const char *basePath,
         });
     sqlite3_finalize(sdbCreateTableStmt);
 
+    // Add the 'Entity' `Key` column, if missed.
+    sqlite3_stmt *sdbQueryKeyColumnStmt;
+    if (SQLITE_OK != sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_QUERY_KEY_COLUMN, -1, &sdbQueryKeyColumnStmt, NULL)) {
+        status = sqlite3_exec (fs->sdb, FILE_SERVICE_SDB_ADD_KEY_COLUMN, NULL, NULL, NULL);
+        if (SQLITE_OK != status)
+            return fileServiceCreateReturnError (fs, 1, (BRFileServiceError) {
+                FILE_SERVICE_SDB,
+                { .sdb = { status }}
+            });
+    }
+    else sqlite3_finalize (sdbQueryKeyColumnStmt);
+
+    // Create the SQLite 'Entity' (Type, Key) Index
+    status = sqlite3_exec (fs->sdb, FILE_SERVICE_SDB_ENTITY_KEY_INDEX, NULL, NULL, NULL);
+    if (SQLITE_OK != status)
+        return fileServiceCreateReturnError (fs, 1, (BRFileServiceError) {
+            FILE_SERVICE_SDB,
+            { .sdb = { status }}
+        });
+
     // Create the SQLITE 'Insert into Entity' Statement
     status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_INSERT_ENTITY, -1, &fs->sdbInsertStmt, NULL);
     if (SQLITE_OK != status)
@@ -370,6 +449,12 @@ static void
 _fileServiceCloseInternal (BRFileService fs) {
     if (fs->sdbClosed) return;
 
+    // Don't lose the writes of an unfinished batch; closing would otherwise roll them back.
+    if (fs->sdbBatchDepth > 0) {
+        sqlite3_exec (fs->sdb, "COMMIT", NULL, NULL, NULL);
+        fs->sdbBatchDepth = 0;
+    }
+
     fs->sdbClosed = 1;
     _fileServiceFinalizeStmt (fs, &fs->sdbInsertStmt);
     _fileServiceFinalizeStmt (fs, &fs->sdbSelectStmt);
@@ -385,6 +470,8 @@ _fileServiceCloseInternal (BRFileService fs) {
 
 extern void
 fileServiceClose (BRFileService fs) {
+    _fileServiceWriteBehindStop (fs);
+
     pthread_mutex_lock (&fs->lock);
     _fileServiceCloseInternal(fs);
     pthread_mutex_unlock (&fs->lock);
@@ -394,6 +481,8 @@ fileServiceClose (BRFileService fs) {
 // careful with fields that might not yet exist.
 extern void
 fileServiceRelease (BRFileService fs) {
+    _fileServiceWriteBehindStop (fs);
+
     pthread_mutex_lock (&fs->lock);
 
     _fileServiceCloseInternal(fs);
@@ -412,6 +501,10 @@ fileServiceRelease (BRFileService fs) {
     pthread_mutex_unlock (&fs->lock);
     pthread_mutex_destroy(&fs->lock);
 
+    pthread_cond_destroy (&fs->queueDrainedCond);
+    pthread_cond_destroy (&fs->queueCond);
+    pthread_mutex_destroy (&fs->queueLock);
+
     free (fs);
 }
 
@@ -440,6 +533,8 @@ fileServiceAddType (const BRFileService fs,
     BRFileServiceEntityType entityType = {
         strdup (type),
         version,
+        NULL,
+        NULL,
         NULL
     };
     array_new (entityType.handlers, FILE_SERVICE_INITIAL_HANDLER_COUNT);
@@ -532,35 +627,160 @@ fileServiceFailedEntity(BRFileService fs,
                                       });
 }
 
-/// MARK: - Save
+/// MARK: - Batch
 
+// `writeBehind` is guarded by `queueLock`; it changes as write-behind is enabled and stopped.
 static int
-_fileServiceSave (BRFileService fs,
-                  const char *type,  /* block, peers, transactions, logs, ... */
-                  const void *entity,
-                  int needLock) {     /* BRMerkleBlock*, BRTransaction, BREthereumTransaction, ... */
+_fileServiceIsWriteBehind (BRFileService fs) {
+    pthread_mutex_lock (&fs->queueLock);
+    int writeBehind = fs->writeBehind;
+    pthread_mutex_unlock (&fs->queueLock);
+    return writeBehind;
+}
 
-    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
-    if (NULL == entityType) { fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type"); return 0; };
+// With write-behind, open a batch in the queue and return true (1); otherwise return false (0).
+static int
+_fileServiceQueueBatchBegin (BRFileService fs) {
+    pthread_mutex_lock (&fs->queueLock);
+    int writeBehind = fs->writeBehind;
+    if (writeBehind) {
+        fs->queueBatchDepth += 1;
+
+        // Saves within a batch aren't held back by the queue limit; see _fileServiceEnqueue()
+        pthread_cond_broadcast (&fs->queueDrainedCond);
+    }
+    pthread_mutex_unlock (&fs->queueLock);
+    return writeBehind;
+}
 
-    BRFileServiceEntityHandler *handler = fileServiceEntityTypeLookupHandler(entityType, entityType->currentVersion);
-    if (NULL == handler) { fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type handler"); return 0; };
+// Close a batch opened by _fileServiceQueueBatchBegin(); the last one lets the writer proceed.
+static void
+_fileServiceQueueBatchCommit (BRFileService fs) {
+    pthread_mutex_lock (&fs->queueLock);
+    assert (fs->queueBatchDepth > 0);
+    fs->queueBatchDepth -= 1;
+    if (0 == fs->queueBatchDepth)
+        pthread_cond_signal (&fs->queueCond);
+    pthread_mutex_unlock (&fs->queueLock);
+}
 
-    // Get then hex-encode the identifer
-    UInt256 identifier = handler->identifier (handler->context, fs, entity);
-    const char *hash = u256hex(identifier);
+static sqlite3_status_code
+_fileServiceBatchBegin (BRFileService fs) {
+    // Only the outermost batch opens a DB transaction; nested batches join it.
+    if (0 == fs->sdbBatchDepth) {
+        sqlite3_status_code status = sqlite3_exec (fs->sdb, "BEGIN", NULL, NULL, NULL);
+        if (SQLITE_OK != status) return status;
+    }
+    fs->sdbBatchDepth += 1;
+    return SQLITE_OK;
+}
+
+static sqlite3_status_code
+_fileServiceBatchCommit (BRFileService fs) {
+    assert (fs->sdbBatchDepth > 0);
+
+    // Only the outermost batch commits the DB transaction.
+    if (1 == fs->sdbBatchDepth) {
+        sqlite3_status_code status = sqlite3_exec (fs->sdb, "COMMIT", NULL, NULL, NULL);
+        if (SQLITE_OK != status) return status;
+    }
+    fs->sdbBatchDepth -= 1;
+    return SQLITE_OK;
+}
+
+static void
+_fileServiceBatchRollback (BRFileService fs) {
+    // A rollback abandons the entire DB transaction, including any enclosing batches.
+    if (0 == fs->sdbBatchDepth) return;
+    sqlite3_exec (fs->sdb, "ROLLBACK", NULL, NULL, NULL);
+    fs->sdbBatchDepth = 0;
+}
+
+//
+// The DB transaction of a batch is shared by the entire connection; thus, to keep other threads'
+// writes out of it (and out of its rollback), the batch holds `lock` from the begin until the
+// matching commit.  Other threads wait.
+//
+// With write-behind, saves are queued and the writer thread does the batching; a batch then only
+// holds the writer back, so that everything queued within the batch is written together.
+//
+// Write-behind can be enabled or stopped while a batch is open, so the begin records, in
+// `sdbLockedBatchDepth`, whether it took `lock` and the commit follows that record.
+//
+extern int
+fileServiceBeginBatch (BRFileService fs) {
+    // A batch nested within one that holds `lock` also holds it, regardless of write-behind.  If
+    // the trylock succeeds with `sdbLockedBatchDepth` non-zero, then we are the holder.
+    int locked = (0 == pthread_mutex_trylock (&fs->lock));
+
+    if (!locked || 0 == fs->sdbLockedBatchDepth) {
+        if (locked) pthread_mutex_unlock (&fs->lock);
+        if (_fileServiceQueueBatchBegin (fs)) return 1;
+        pthread_mutex_lock (&fs->lock);
+    }
+
+    if (fs->sdbClosed)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
 
+    sqlite3_status_code status = _fileServiceBatchBegin (fs);
+    if (SQLITE_OK != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    // Hold `lock` until fileServiceCommitBatch()
+    fs->sdbLockedBatchDepth += 1;
+    return 1;
+}
+
+extern int
+fileServiceCommitBatch (BRFileService fs) {
+    // If the batch holds `lock`, then this succeeds at once; otherwise it waits out any batch
+    // that does and finds `sdbLockedBatchDepth` zero.
+    pthread_mutex_lock (&fs->lock);
+
+    if (0 == fs->sdbLockedBatchDepth) {
+        pthread_mutex_unlock (&fs->lock);
+        _fileServiceQueueBatchCommit (fs);
+        return 1;
+    }
+
+    fs->sdbLockedBatchDepth -= 1;
+    pthread_mutex_unlock (&fs->lock);
+
+    // `lock` is held from fileServiceBeginBatch(); every return releases that hold.
+    if (fs->sdbClosed)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+
+    // The batch might have been abandoned by a failure within it.
+    if (0 == fs->sdbBatchDepth)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "missed batch");
+
+    sqlite3_status_code status = _fileServiceBatchCommit (fs);
+    if (SQLITE_OK != status) {
+        _fileServiceBatchRollback (fs);
+        return fileServiceFailedSDB (fs, 1, status);
+    }
+
+    pthread_mutex_unlock (&fs->lock);
+    return 1;
+}
+
+/// MARK: - Save
+
+// Serialize `entity` with the current header format, which is:
+//   {HeaderFormatVersion, Current(Type)Version, EntityBytesCount, EntityBytes}
+static uint8_t *
+_fileServiceEncode (BRFileService fs,
+                    BRFileServiceEntityType *entityType,
+                    BRFileServiceEntityHandler *handler,
+                    const void *entity,
+                    size_t *bytesCount) {
     // Get the entity bytes
     uint32_t entityBytesCount;
     uint8_t *entityBytes = handler->writer (handler->context, fs, entity, &entityBytesCount);
 
     // Always, always write the header for the currentHeaderFormatVersion
-
-    // Extend the entity bytes with the current header format, which is:
-    //   {HeaderFormatVersion, Current(Type)Version, EntityBytesCount, EntityBytes}
     size_t  offset = 0;
-    size_t  bytesCount = 1 + 1 + sizeof(uint32_t) + entityBytesCount;
-    uint8_t *bytes = malloc (bytesCount);
+    uint8_t *bytes = malloc (1 + 1 + sizeof(uint32_t) + entityBytesCount);
 
     bytes[offset] = (uint8_t) currentHeaderFormatVersion;
     offset += 1;
@@ -572,13 +792,35 @@ _fileServiceSave (BRFileService fs,
     offset += sizeof (uint32_t);
 
     memcpy (&bytes[offset], entityBytes, entityBytesCount);
+    offset += entityBytesCount;
     free (entityBytes);
 
-    // Nex encode bytes
-    size_t dataCount = 2 * bytesCount + 1;
-    char *data = malloc (dataCount);
-    hexEncode (data, dataCount, bytes, bytesCount);
-    free (bytes);
+    *bytesCount = offset;
+    return bytes;
+}
+
+// Fill in `key` for `entity`; return false (0) if `entityType` has no key.
+static int
+_fileServiceEntityKey (BRFileService fs,
+                       BRFileServiceEntityType *entityType,
+                       const void *entity,
+                       uint64_t *key) {
+    if (NULL == entityType->key) return 0;
+    *key = entityType->key (entityType->keyContext, fs, entity);
+    return 1;
+}
+
+// Write encoded `bytes` with `key`, if not NULL.  Takes ownership of `bytes`.
+static int
+_fileServiceWrite (BRFileService fs,
+                   const char *type,
+                   UInt256 identifier,
+                   uint8_t *bytes,
+                   size_t bytesCount,
+                   const uint64_t *key,
+                   int needLock) {
+    // Hex-encode the identifer
+    const char *hash = u256hex(identifier);
 
     // Fill out the SQL statement
     sqlite3_status_code status;
@@ -587,32 +829,40 @@ _fileServiceSave (BRFileService fs,
         pthread_mutex_lock (&fs->lock);
 
     if (fs->sdbClosed)
-        return fileServiceFailedImpl (fs, needLock, NULL, NULL, "closed");
+        return fileServiceFailedImpl (fs, needLock, bytes, NULL, "closed");
 
     sqlite3_reset (fs->sdbInsertStmt);
     sqlite3_clear_bindings(fs->sdbInsertStmt);
 
     status = sqlite3_bind_text (fs->sdbInsertStmt, 1, type, -1, SQLITE_STATIC);
     if (SQLITE_OK != status) {
-        free (data);
+        free (bytes);
         return fileServiceFailedSDB (fs, needLock, status);
     }
 
     status = sqlite3_bind_text (fs->sdbInsertStmt, 2, hash, -1, SQLITE_STATIC);
     if (SQLITE_OK != status) {
-        free (data);
+        free (bytes);
         return fileServiceFailedSDB (fs, needLock, status);
     }
 
-    status = sqlite3_bind_text (fs->sdbInsertStmt, 3, data, -1, SQLITE_STATIC);
+    status = sqlite3_bind_blob (fs->sdbInsertStmt, 3, bytes, (int) bytesCount, SQLITE_STATIC);
     if (SQLITE_OK != status) {
-        free (data);
+        free (bytes);
+        return fileServiceFailedSDB (fs, needLock, status);
+    }
+
+    status = (NULL == key
+              ? sqlite3_bind_null  (fs->sdbInsertStmt, 4)
+              : sqlite3_bind_int64 (fs->sdbInsertStmt, 4, (sqlite3_int64) *key));
+    if (SQLITE_OK != status) {
+        free (bytes);
         return fileServiceFailedSDB (fs, needLock, status);
     }
 
     status = sqlite3_step (fs->sdbInsertStmt);
     if (SQLITE_DONE != status) {
-        free (data);
+        free (bytes);
         return fileServiceFailedSDB (fs, needLock, status);
     }
 
@@ -622,19 +872,488 @@ _fileServiceSave (BRFileService fs,
     if (needLock)
         pthread_mutex_unlock (&fs->lock);
 
-    free (data);
+    free (bytes);
     return 1;
 }
 
+static int
+_fileServiceSave (BRFileService fs,
+                  const char *type,  /* block, peers, transactions, logs, ... */
+                  const void *entity,
+                  int needLock) {     /* BRMerkleBlock*, BRTransaction, BREthereumTransaction, ... */
+
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType) { fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type"); return 0; };
+
+    BRFileServiceEntityHandler *handler = fileServiceEntityTypeLookupHandler(entityType, entityType->currentVersion);
+    if (NULL == handler) { fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type handler"); return 0; };
+
+    UInt256 identifier = handler->identifier (handler->context, fs, entity);
+
+    size_t   bytesCount;
+    uint8_t *bytes = _fileServiceEncode (fs, entityType, handler, entity, &bytesCount);
+
+    uint64_t key;
+    int hasKey = _fileServiceEntityKey (fs, entityType, entity, &key);
+
+    return _fileServiceWrite (fs, type, identifier, bytes, bytesCount, (hasKey ? &key : NULL), needLock);
+}
+
+/// MARK: - Write Behind
+
+#define FILE_SERVICE_WRITER_STACK_SIZE      (512 * 1024)
+#define FILE_SERVICE_WRITER_DELAY_MS        (250)
+
+///
+/// A pending write, coalesced by (type, identifier).  A NULL `bytes` is a pending remove.  The
+/// `type` is the entity type's own string and thus is compared by address.
+///
+typedef struct {
+    const char *type;
+    UInt256 identifier;
+    uint8_t *bytes;
+    size_t bytesCount;
+    uint8_t hasKey;
+    uint64_t key;
+} BRFileServicePendingWrite;
+
+static size_t
+_fileServicePendingWriteHash (const void *write) {
+    return ((const BRFileServicePendingWrite *) write)->identifier.u32[0];
+}
+
+static int
+_fileServicePendingWriteEq (const void *write1, const void *write2) {
+    const BRFileServicePendingWrite *w1 = write1, *w2 = write2;
+    return w1->type == w2->type && UInt256Eq (w1->identifier, w2->identifier);
+}
+
+static void
+_fileServicePendingWriteFree (void *write) {
+    if (NULL != ((BRFileServicePendingWrite *) write)->bytes)
+        free (((BRFileServicePendingWrite *) write)->bytes);
+    free (write);
+}
+
+typedef void* (*ThreadRoutine) (void*);
+
+static void *
+_fileServiceWriterThread (BRFileService fs) {
+#if defined (__ANDROID__)
+    pthread_setname_np (pthread_self(), "Core File Service Writer");
+#elif defined (__APPLE__)
+    pthread_setname_np ("Core File Service Writer");
+#endif
+
+    BRArrayOf(BRFileServicePendingWrite *) writes;
+    array_new (writes, 100);
+
+    pthread_mutex_lock (&fs->queueLock);
+    while (1) {
+        while (!fs->queueStopping && 0 == BRSetCount (fs->queue))
+            pthread_cond_wait (&fs->queueCond, &fs->queueLock);
+
+        if (0 == BRSetCount (fs->queue)) break; // stopping, with nothing left to write
+
+        // Linger a bit so that repeated saves coalesce, unless someone is waiting on us.
+        struct timeval  now;
+        struct timespec deadline;
+        gettimeofday (&now, NULL);
+        deadline.tv_sec  = now.tv_sec + (now.tv_usec + 1000 * FILE_SERVICE_WRITER_DELAY_MS) / 1000000;
+        deadline.tv_nsec = 1000 * ((now.tv_usec + 1000 * FILE_SERVICE_WRITER_DELAY_MS) % 1000000);
+
+        while (!fs->queueStopping && 0 == fs->queueWaiters &&
+               ETIMEDOUT != pthread_cond_timedwait (&fs->queueCond, &fs->queueLock, &deadline))
+            ;
+
+        // Don't split an open batch across DB transactions; a flush, however, can't wait on it.
+        while (!fs->queueStopping && 0 == fs->queueFlushers && fs->queueBatchDepth > 0)
+            pthread_cond_wait (&fs->queueCond, &fs->queueLock);
+
+        // Take everything queued; subsequent saves queue anew.
+        array_set_count (writes, BRSetCount (fs->queue));
+        BRSetAll (fs->queue, (void **) writes, array_count (writes));
+        BRSetClear (fs->queue);
+        fs->queueWriting = 1;
+        pthread_mutex_unlock (&fs->queueLock);
+
+        // Write everything in one DB transaction.
+        size_t writtenBytesCount = 0;
+
+        pthread_mutex_lock (&fs->lock);
+        if (!fs->sdbClosed) {
+            int inBatch = (SQLITE_OK == _fileServiceBatchBegin (fs));
+
+            for (size_t index = 0; index < array_count (writes); index++) {
+                BRFileServicePendingWrite *write = writes[index];
+                writtenBytesCount += write->bytesCount;
+
+                // Errors are reported through the handler; carry on with the other writes.
+                if (NULL != write->bytes)
+                    _fileServiceWrite  (fs, write->type, write->identifier, write->bytes, write->bytesCount,
+                                        (write->hasKey ? &write->key : NULL), 0);
+                else
+                    _fileServiceRemove (fs, write->type, write->identifier, 0);
+                write->bytes = NULL;   // owned by _fileServiceWrite
+            }
+
+            if (inBatch && SQLITE_OK != _fileServiceBatchCommit (fs))
+                _fileServiceBatchRollback (fs);
+        }
+        pthread_mutex_unlock (&fs->lock);
+
+        for (size_t index = 0; index < array_count (writes); index++)
+            _fileServicePendingWriteFree (writes[index]);
+
+        pthread_mutex_lock (&fs->queueLock);
+        fs->queueWriting = 0;
+        fs->queueBytesCount -= writtenBytesCount;
+        pthread_cond_broadcast (&fs->queueDrainedCond);
+    }
+    pthread_mutex_unlock (&fs->queueLock);
+
+    array_free (writes);
+    return NULL;
+}
+
+extern int
+fileServiceEnableWriteBehind (BRFileService fs,
+                              size_t queueBytesLimit) {
+    if (_fileServiceIsWriteBehind (fs)) return 1;
+
+    fs->queue = BRSetNew (_fileServicePendingWriteHash, _fileServicePendingWriteEq, 100);
+    fs->queueBytesCount = 0;
+    fs->queueBytesLimit = queueBytesLimit;
+    fs->queueWaiters  = 0;
+    fs->queueFlushers = 0;
+    fs->queueWriting  = 0;
+    fs->queueStopping = 0;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    pthread_attr_setstacksize(&attr, FILE_SERVICE_WRITER_STACK_SIZE);
+
+    int success = (0 == pthread_create (&fs->writer, &attr, (ThreadRoutine) _fileServiceWriterThread, fs));
+    pthread_attr_destroy(&attr);
+
+    if (!success) {
+        BRSetFree (fs->queue);
+        fs->queue = NULL;
+        return fileServiceFailedImpl (fs, 0, NULL, NULL, "writer thread");
+    }
+
+    pthread_mutex_lock (&fs->queueLock);
+    fs->writeBehind = 1;
+    pthread_mutex_unlock (&fs->queueLock);
+    return 1;
+}
+
+// Queue a write of `bytes` (or a remove, if NULL), replacing any pending write for the same
+// entity.  Blocks while the queue is over its limit.  Takes ownership of `bytes`.
+static void
+_fileServiceEnqueue (BRFileService fs,
+                     BRFileServiceEntityType *entityType,
+                     UInt256 identifier,
+                     uint8_t *bytes,
+                     size_t bytesCount,
+                     const uint64_t *key) {
+    BRFileServicePendingWrite pending = { entityType->type, identifier, NULL, 0, NULL != key, (NULL != key ? *key : 0) };
+
+    pthread_mutex_lock (&fs->queueLock);
+
+    // Backpressure: wait for the writer to drain the queue.  An empty queue always accepts, as
+    // does the queue with a batch open - the writer waits on the batch.
+    fs->queueWaiters += 1;
+    while (fs->queueBytesCount > 0 &&
+           fs->queueBytesCount + bytesCount > fs->queueBytesLimit &&
+           0 == fs->queueBatchDepth &&
+           !fs->queueStopping) {
+        pthread_cond_signal (&fs->queueCond);
+        pthread_cond_wait (&fs->queueDrainedCond, &fs->queueLock);
+    }
+    fs->queueWaiters -= 1;
+
+    BRFileServicePendingWrite *write = BRSetGet (fs->queue, &pending);
+    if (NULL == write) {
+        write = malloc (sizeof (BRFileServicePendingWrite));
+        *write = pending;
+        BRSetAdd (fs->queue, write);
+    }
+    else {
+        fs->queueBytesCount -= write->bytesCount;
+        if (NULL != write->bytes) free (write->bytes);
+    }
+
+    write->bytes      = bytes;
+    write->bytesCount = bytesCount;
+    write->hasKey     = pending.hasKey;
+    write->key        = pending.key;
+    fs->queueBytesCount += bytesCount;
+
+    pthread_cond_signal (&fs->queueCond);
+    pthread_mutex_unlock (&fs->queueLock);
+}
+
+extern void
+fileServiceFlush (BRFileService fs) {
+    if (!_fileServiceIsWriteBehind (fs)) return;
+
+    pthread_mutex_lock (&fs->queueLock);
+    fs->queueWaiters += 1;
+    fs->queueFlushers += 1;
+    while (0 != BRSetCount (fs->queue) || fs->queueWriting) {
+        pthread_cond_signal (&fs->queueCond);
+        pthread_cond_wait (&fs->queueDrainedCond, &fs->queueLock);
+    }
+    fs->queueFlushers -= 1;
+    fs->queueWaiters -= 1;
+    pthread_mutex_unlock (&fs->queueLock);
+}
+
+// Write everything queued then stop the writer thread.  Must be called w/o `fs->lock`.
+static void
+_fileServiceWriteBehindStop (BRFileService fs) {
+    if (!_fileServiceIsWriteBehind (fs)) return;
+
+    pthread_mutex_lock (&fs->queueLock);
+    fs->queueStopping = 1;
+    pthread_cond_signal (&fs->queueCond);
+    pthread_mutex_unlock (&fs->queueLock);
+
+    pthread_join (fs->writer, NULL);
+
+    // Nothing can be queued now; saves are written directly.
+    pthread_mutex_lock (&fs->queueLock);
+    fs->writeBehind = 0;
+    pthread_mutex_unlock (&fs->queueLock);
+
+    BRSetFreeAll (fs->queue, _fileServicePendingWriteFree);
+    fs->queue = NULL;
+}
+
 extern int
 fileServiceSave (BRFileService fs,
                  const char *type,  /* block, peers, transactions, logs, ... */
                  const void *entity) {     /* BRMerkleBlock*, BRTransaction, BREthereumTransaction, ... */
-    return _fileServiceSave (fs, type, entity, 1);
+    if (!_fileServiceIsWriteBehind (fs))
+        return _fileServiceSave (fs, type, entity, 1);
+
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType) return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
+
+    BRFileServiceEntityHandler *handler = fileServiceEntityTypeLookupHandler(entityType, entityType->currentVersion);
+    if (NULL == handler) return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type handler");
+
+    UInt256 identifier = handler->identifier (handler->context, fs, entity);
+
+    size_t   bytesCount;
+    uint8_t *bytes = _fileServiceEncode (fs, entityType, handler, entity, &bytesCount);
+
+    uint64_t key;
+    int hasKey = _fileServiceEntityKey (fs, entityType, entity, &key);
+
+    _fileServiceEnqueue (fs, entityType, identifier, bytes, bytesCount, (hasKey ? &key : NULL));
+    return 1;
+}
+
+extern int
+fileServiceSaveMany (BRFileService fs,
+                     const char *type,
+                     const void **entities,
+                     size_t entitiesCount) {
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType)
+        return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
+
+    if (0 == entitiesCount) return 1;
+
+    // With write-behind, queue the saves in a batch; the writer writes them together.
+    if (_fileServiceQueueBatchBegin (fs)) {
+        int success = 1;
+        for (size_t index = 0; index < entitiesCount; index++)
+            success &= fileServiceSave (fs, type, entities[index]);
+        _fileServiceQueueBatchCommit (fs);
+        return success;
+    }
+
+    sqlite3_status_code status;
+
+    pthread_mutex_lock (&fs->lock);
+    if (fs->sdbClosed)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+
+    status = _fileServiceBatchBegin (fs);
+    if (SQLITE_OK != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    for (size_t index = 0; index < entitiesCount; index++)
+        if (0 == _fileServiceSave (fs, type, entities[index], 0)) {
+            _fileServiceBatchRollback (fs);
+            pthread_mutex_unlock (&fs->lock);
+            return 0;
+        }
+
+    status = _fileServiceBatchCommit (fs);
+    if (SQLITE_OK != status) {
+        _fileServiceBatchRollback (fs);
+        return fileServiceFailedSDB (fs, 1, status);
+    }
+
+    pthread_mutex_unlock (&fs->lock);
+
+    return 1;
 }
 
 /// MARK: - Load
 
+///
+/// Decodes rows' `Data`, either a BLOB or, for legacy rows, hex-encoded TEXT, into entities.
+///
+typedef struct {
+    // Scratch for hex-decoding legacy rows; BLOB rows are read in place.
+    uint8_t *buffer;
+    size_t   bufferCount;
+
+    // For the last row decoded
+    const uint8_t *bytes;
+    size_t bytesCount;
+    int isLegacy;
+    int isCurrent;          // the current header format and entity version
+    const char *failure;
+    int failureIsEntity;
+} BRFileServiceDecoder;
+
+static void
+_fileServiceDecoderRelease (BRFileServiceDecoder *decoder) {
+    if (NULL != decoder->buffer) free (decoder->buffer);
+    decoder->buffer = NULL;
+    decoder->bufferCount = 0;
+}
+
+// Decode `column` of `stmt`'s current row.  On failure, return NULL having filled in `failure`.
+// Requires `fs->lock`.
+static void *
+_fileServiceDecode (BRFileService fs,
+                    BRFileServiceEntityType *entityType,
+                    sqlite3_stmt *stmt,
+                    int column,
+                    BRFileServiceDecoder *decoder) {
+    decoder->failure = NULL;
+    decoder->failureIsEntity = 0;
+    decoder->isLegacy = (SQLITE_TEXT == sqlite3_column_type (stmt, column));
+
+    if (decoder->isLegacy) {
+        const char *data = (const char *) sqlite3_column_text (stmt, column);
+        if (NULL == data) { decoder->failure = "missed query `data`"; return NULL; }
+
+        // Ensure `buffer` is large enough for hex-decoded `data`
+        size_t dataCount = strlen (data);
+        assert (0 == dataCount % 2);  // Surely 'even'
+        if ((dataCount/2) > decoder->bufferCount) {
+            if (NULL != decoder->buffer) free (decoder->buffer);
+            decoder->bufferCount = dataCount/2;
+            decoder->buffer = malloc (decoder->bufferCount);
+        }
+
+        // Actually decode `data` into `buffer`
+        hexDecode (decoder->buffer, dataCount/2, data, dataCount);
+
+        decoder->bytes      = decoder->buffer;
+        decoder->bytesCount = dataCount/2;
+    }
+    else {
+        decoder->bytes      = sqlite3_column_blob  (stmt, column);
+        decoder->bytesCount = sqlite3_column_bytes (stmt, column);
+        if (NULL == decoder->bytes) { decoder->failure = "missed query `data`"; return NULL; }
+    }
+
+    const uint8_t *bytes = decoder->bytes;
+
+    size_t offset = 0;
+    BRFileServiceVersion version;
+    uint32_t  entityBytesCount;
+    const uint8_t  *entityBytes;
+
+    BRFileServiceHeaderFormatVersion headerVersion = bytes[offset];
+    offset += 1;
+
+    switch (headerVersion) {
+        case HEADER_FORMAT_1:
+            version = bytes[offset];
+            offset += 1;
+
+            entityBytesCount = UInt32GetBE (&bytes[offset]);
+            offset += sizeof (uint32_t);
+
+            break;
+    }
+
+    // Assert entityBytesCount remain in bytes
+    if (offset + entityBytesCount > decoder->bytesCount) {
+        assert (0); // In DEBUG builds.
+        decoder->failure = "missed bytes count";
+        return NULL;
+    }
+
+    entityBytes = &bytes[offset];
+
+    switch (headerVersion) {
+        case HEADER_FORMAT_1:
+            // compute then compare checksum
+            break;
+    }
+
+    decoder->isCurrent = (version == entityType->currentVersion &&
+                          headerVersion == currentHeaderFormatVersion);
+
+    // Look up the entity handler
+    BRFileServiceEntityHandler *handler = fileServiceEntityTypeLookupHandler(entityType, version);
+    if (NULL == handler) { decoder->failure = "missed type handler"; return NULL; }
+
+    // Read the entity from buffer.
+    void *entity = handler->reader (handler->context, fs, (uint8_t *) entityBytes, entityBytesCount);
+    if (NULL == entity) { decoder->failure = "reader"; decoder->failureIsEntity = 1; return NULL; }
+
+    return entity;
+}
+
+static int
+_fileServiceDecodeFailed (BRFileService fs,
+                          int releaseLock,
+                          const char *type,
+                          BRFileServiceDecoder *decoder) {
+    return (decoder->failureIsEntity
+            ? fileServiceFailedEntity (fs, releaseLock, NULL, NULL, type, decoder->failure)
+            : fileServiceFailedImpl   (fs, releaseLock, NULL, NULL, decoder->failure));
+}
+
+// Rewrite a row's hex-encoded `Data` as a BLOB.  Requires `fs->lock`.
+static int
+_fileServiceMigrateData (BRFileService fs,
+                         const char *type,
+                         const char *hash,
+                         const uint8_t *bytes,
+                         size_t bytesCount,
+                         const uint64_t *key) {
+    sqlite3_reset (fs->sdbUpdateStmt);
+    sqlite3_clear_bindings (fs->sdbUpdateStmt);
+
+    if (SQLITE_OK != sqlite3_bind_blob (fs->sdbUpdateStmt, 1, bytes, (int) bytesCount, SQLITE_STATIC) ||
+        SQLITE_OK != (NULL == key
+                      ? sqlite3_bind_null  (fs->sdbUpdateStmt, 2)
+                      : sqlite3_bind_int64 (fs->sdbUpdateStmt, 2, (sqlite3_int64) *key)) ||
+        SQLITE_OK != sqlite3_bind_text (fs->sdbUpdateStmt, 3, type, -1, SQLITE_STATIC) ||
+        SQLITE_OK != sqlite3_bind_text (fs->sdbUpdateStmt, 4, hash, -1, SQLITE_TRANSIENT) ||
+        SQLITE_DONE != sqlite3_step (fs->sdbUpdateStmt)) {
+        sqlite3_reset (fs->sdbUpdateStmt);
+        return 0;
+    }
+
+    sqlite3_reset (fs->sdbUpdateStmt);
+    return 1;
+}
+
 extern int
 fileServiceLoad (BRFileService fs,
                  BRSet *results,
@@ -646,6 +1365,9 @@ fileServiceLoad (BRFileService fs,
     BRFileServiceEntityHandler *entityHandlerCurrent = fileServiceEntityTypeLookupHandler(entityType, entityType->currentVersion);
     if (NULL == entityHandlerCurrent) return fileServiceFailedImpl (fs,  0, NULL, NULL, "missed type handler");
 
+    // Load what has been saved, including what is queued.
+    fileServiceFlush (fs);
+
     sqlite3_status_code status;
 
     pthread_mutex_lock (&fs->lock);
@@ -659,147 +1381,335 @@ fileServiceLoad (BRFileService fs,
     if (SQLITE_OK != status)
         return fileServiceFailedSDB (fs, 1, status);
 
-    uint8_t  dataBytesBuffer[8196];
-    uint8_t *dataBytes = dataBytesBuffer;
-    size_t   dataBytesCount = 8196;
+    BRFileServiceDecoder decoder = { NULL, 0 };
 
-    // Zero out the dataByte memory to avoid subsequent Clang Static Analysis errors releted
-    // to dereferencing uninitialized memory.  We accept this minimal, extraneous function call.
-    memset(dataBytes, 0, dataBytesCount);
+    // Rows rewritten while loading (new versions, legacy hex) are written in a single batch.
+    int inBatch = 0;
 
     while (SQLITE_ROW == sqlite3_step(fs->sdbSelectAllStmt)) {
         const char *hash = (const char *) sqlite3_column_text (fs->sdbSelectAllStmt, 0);
-        const char *data = (const char *) sqlite3_column_text (fs->sdbSelectAllStmt, 1);
-
-        if (NULL == hash || NULL == data)
-            return fileServiceFailedImpl (fs, 1, (dataBytes == dataBytesBuffer ? NULL : dataBytes), NULL,
-                                          "missed query `hash` or `data`");
+        if (NULL == hash) { decoder.failure = "missed query `hash`"; break; }
 
         assert (64 == strlen (hash));
-        
-        // Ensure `dataBytes` is large enough for hex-decoded `data`
-        size_t dataCount = strlen (data);
-        assert (0 == dataCount % 2);  // Surely 'even'
-        if ((dataCount/2) > dataBytesCount) {
-            if (dataBytes != dataBytesBuffer) free (dataBytes);
-            dataBytesCount = dataCount/2;
-            dataBytes = malloc (dataBytesCount);
-        }
 
-        // Actually decode `data` into `dataBytes`
-        hexDecode (dataBytes, dataCount/2, data, dataCount);
+        void *entity = _fileServiceDecode (fs, entityType, fs->sdbSelectAllStmt, 1, &decoder);
+        if (NULL == entity) break;
 
-        size_t offset = 0;
-        BRFileServiceVersion version;
-        uint32_t  entityBytesCount;
-        uint8_t  *entityBytes;
+        // Update restuls with the newly restored entity
+        BRSetAdd (results, entity);
 
-        BRFileServiceHeaderFormatVersion headerVersion = dataBytes[offset];
-        offset += 1;
+        int needUpdate = (updateVersion && !decoder.isCurrent);
 
-        switch (headerVersion) {
-            case HEADER_FORMAT_1:
-                version = dataBytes[offset];
-                offset += 1;
+        if ((needUpdate || decoder.isLegacy) && !inBatch)
+            inBatch = (SQLITE_OK == _fileServiceBatchBegin (fs));
 
-                entityBytesCount = UInt32GetBE (&dataBytes[offset]);
-                offset += sizeof (uint32_t);
+        // If the read version is not the current version, update
+        if (needUpdate)
+            // This could signal an error.  Perhaps we should test the return result and
+            // if `0` skip out here?  We won't - we couldn't save the entity in the new format
+            // but we'll continue and will try next time we load it.
+            _fileServiceSave (fs, type, entity, 0);
 
-                break;
+        // Otherwise, if the row is hex-encoded, store the very same bytes as a BLOB.  Again,
+        // on failure we'll try next time.
+        else if (decoder.isLegacy) {
+            uint64_t key;
+            int hasKey = _fileServiceEntityKey (fs, entityType, entity, &key);
+            _fileServiceMigrateData (fs, type, hash, decoder.bytes, decoder.bytesCount, (hasKey ? &key : NULL));
         }
+    }
 
-        // Assert entityBytesCount remain in dataBytes
-        if (offset + entityBytesCount > dataBytesCount) {
-            assert (0); // In DEBUG builds.
-            return fileServiceFailedImpl (fs, 1, (dataBytes == dataBytesBuffer ? NULL : dataBytes), NULL,
-                                          "missed bytes count");
-        }
+    // Ensure the 'implicit DB transaction' is committed.
+    sqlite3_reset (fs->sdbSelectAllStmt);
 
-        entityBytes = &dataBytes[offset];
+    if (inBatch && SQLITE_OK != _fileServiceBatchCommit (fs))
+        _fileServiceBatchRollback (fs);
 
-        switch (headerVersion) {
-            case HEADER_FORMAT_1:
-                // compute then compare checksum
-                break;
-        }
+    _fileServiceDecoderRelease (&decoder);
 
-        // Look up the entity handler
-        BRFileServiceEntityHandler *handler = fileServiceEntityTypeLookupHandler(entityType, version);
-        if (NULL == handler)
-            return fileServiceFailedImpl (fs, 1, (dataBytes == dataBytesBuffer ? NULL : dataBytes), NULL,
-                                          "missed type handler");
+    if (NULL != decoder.failure)
+        return _fileServiceDecodeFailed (fs, 1, type, &decoder);
 
-        // Read the entity from buffer and add to results.
-        void *entity = handler->reader (handler->context, fs, entityBytes, entityBytesCount);
-        if (NULL == entity)
-            return fileServiceFailedEntity (fs, 1, (dataBytes == dataBytesBuffer ? NULL : dataBytes), NULL,
-                                            type, "reader");
+    pthread_mutex_unlock (&fs->lock);
 
-        // Update restuls with the newly restored entity
-        BRSetAdd (results, entity);
+    return 1;
+}
 
-        // If the read version is not the current version, update
-        if (updateVersion &&
-            (version != entityType->currentVersion ||
-             headerVersion != currentHeaderFormatVersion))
-            // This could signal an error.  Perhaps we should test the return result and
-            // if `0` skip out here?  We won't - we couldn't save the entity in the new format
-            // but we'll continue and will try next time we load it.
-            _fileServiceSave (fs, type, entity, 0);
+extern void *
+fileServiceLoadEntity (BRFileService fs,
+                       const char *type,
+                       UInt256 identifier) {
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType) { fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type"); return NULL; }
+
+    fileServiceFlush (fs);
+
+    // Hex-Encode identifier
+    const char *hash = u256hex(identifier);
+
+    sqlite3_status_code status;
+
+    pthread_mutex_lock (&fs->lock);
+    if (fs->sdbClosed) { fileServiceFailedImpl (fs, 1, NULL, NULL, "closed"); return NULL; }
+
+    sqlite3_reset (fs->sdbSelectStmt);
+    sqlite3_clear_bindings (fs->sdbSelectStmt);
+
+    if (SQLITE_OK != (status = sqlite3_bind_text (fs->sdbSelectStmt, 1, type, -1, SQLITE_STATIC)) ||
+        SQLITE_OK != (status = sqlite3_bind_text (fs->sdbSelectStmt, 2, hash, -1, SQLITE_STATIC))) {
+        fileServiceFailedSDB (fs, 1, status);
+        return NULL;
     }
 
-    // Ensure the 'implicit DB transaction' is committed.
-    sqlite3_reset (fs->sdbSelectAllStmt);
+    BRFileServiceDecoder decoder = { NULL, 0 };
+    void *entity = NULL;
+
+    status = sqlite3_step (fs->sdbSelectStmt);
+    if (SQLITE_ROW == status)
+        entity = _fileServiceDecode (fs, entityType, fs->sdbSelectStmt, 0, &decoder);
+
+    sqlite3_reset (fs->sdbSelectStmt);
+    _fileServiceDecoderRelease (&decoder);
+
+    if (SQLITE_ROW != status && SQLITE_DONE != status) { fileServiceFailedSDB (fs, 1, status); return NULL; }
+    if (NULL != decoder.failure) { _fileServiceDecodeFailed (fs, 1, type, &decoder); return NULL; }
 
     pthread_mutex_unlock (&fs->lock);
+    return entity;
+}
 
-    if (dataBytes != dataBytesBuffer) free (dataBytes);
+/// MARK: - Cursor
 
-    return 1;
+struct BRFileServiceCursorRecord {
+    BRFileService fs;
+    const char *type;
+    sqlite3_stmt *stmt;
+    BRFileServiceDecoder decoder;
+    int failed;
+    int done;
+
+    // Entities read in an old format, to be rewritten when the cursor is released.  Writing them
+    // as they are read could have `stmt` revisit them.
+    BRArrayOf(BRFileServicePendingWrite) rewrites;
+};
+
+static BRFileServiceCursor
+_fileServiceCursorCreate (BRFileService fs,
+                          const char *type,
+                          const uint64_t *minimumKey) {
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType) { fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type"); return NULL; }
+
+    // Include what is queued.
+    fileServiceFlush (fs);
+
+    BRFileServiceCursor cursor = calloc (1, sizeof (struct BRFileServiceCursorRecord));
+    cursor->fs   = fs;
+    cursor->type = entityType->type;
+    array_new (cursor->rewrites, 10);
+
+    sqlite3_status_code status;
+
+    pthread_mutex_lock (&fs->lock);
+    if (fs->sdbClosed) {
+        array_free (cursor->rewrites);
+        free (cursor);
+        fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+        return NULL;
+    }
+
+    // Each cursor has its own statement so that cursors and other operations may interleave.
+    status = sqlite3_prepare_v2 (fs->sdb,
+                                 (NULL == minimumKey
+                                  ? FILE_SERVICE_SDB_QUERY_ALL_ENTITY
+                                  : FILE_SERVICE_SDB_QUERY_ALL_FROM_KEY_ENTITY),
+                                 -1, &cursor->stmt, NULL);
+
+    if (SQLITE_OK == status)
+        status = sqlite3_bind_text (cursor->stmt, 1, cursor->type, -1, SQLITE_STATIC);
+
+    if (SQLITE_OK == status && NULL != minimumKey)
+        status = sqlite3_bind_int64 (cursor->stmt, 2, (sqlite3_int64) *minimumKey);
+
+    if (SQLITE_OK != status) {
+        if (NULL != cursor->stmt) sqlite3_finalize (cursor->stmt);
+        array_free (cursor->rewrites);
+        free (cursor);
+        fileServiceFailedSDB (fs, 1, status);
+        return NULL;
+    }
+
+    pthread_mutex_unlock (&fs->lock);
+    return cursor;
 }
 
-/// MARK: - Remove, Clear
+extern BRFileServiceCursor
+fileServiceCursorCreate (BRFileService fs,
+                         const char *type) {
+    return _fileServiceCursorCreate (fs, type, NULL);
+}
+
+extern BRFileServiceCursor
+fileServiceCursorCreateFromKey (BRFileService fs,
+                                const char *type,
+                                uint64_t minimumKey) {
+    return _fileServiceCursorCreate (fs, type, &minimumKey);
+}
+
+extern void *
+fileServiceCursorNext (BRFileServiceCursor cursor) {
+    BRFileService fs = cursor->fs;
+    if (cursor->done) return NULL;
+
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, cursor->type);
+    assert (NULL != entityType);
+
+    pthread_mutex_lock (&fs->lock);
+    if (fs->sdbClosed) {
+        cursor->done = cursor->failed = 1;
+        fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+        return NULL;
+    }
+
+    void *entity = NULL;
+    sqlite3_status_code status = sqlite3_step (cursor->stmt);
+
+    switch (status) {
+        case SQLITE_ROW:
+            entity = _fileServiceDecode (fs, entityType, cursor->stmt, 1, &cursor->decoder);
+            if (NULL == entity) {
+                cursor->done = cursor->failed = 1;
+                _fileServiceDecodeFailed (fs, 1, cursor->type, &cursor->decoder);
+                return NULL;
+            }
+
+            // As with `fileServiceLoad()` update old versions and legacy hex rows.
+            if (cursor->decoder.isLegacy || !cursor->decoder.isCurrent) {
+                const char *hash = (const char *) sqlite3_column_text (cursor->stmt, 0);
+                if (NULL == hash) break;
+
+                BRFileServicePendingWrite rewrite = { cursor->type, uint256 (hash), NULL, 0, 0, 0 };
+                rewrite.hasKey = _fileServiceEntityKey (fs, entityType, entity, &rewrite.key);
+
+                if (cursor->decoder.isCurrent) {
+                    rewrite.bytesCount = cursor->decoder.bytesCount;
+                    rewrite.bytes      = malloc (rewrite.bytesCount);
+                    memcpy (rewrite.bytes, cursor->decoder.bytes, rewrite.bytesCount);
+                }
+                else {
+                    BRFileServiceEntityHandler *handler = fileServiceEntityTypeLookupHandler (entityType, entityType->currentVersion);
+                    if (NULL == handler) break;
+                    rewrite.bytes = _fileServiceEncode (fs, entityType, handler, entity, &rewrite.bytesCount);
+                }
+
+                array_add (cursor->rewrites, rewrite);
+            }
+            break;
+
+        case SQLITE_DONE:
+            cursor->done = 1;
+            break;
+
+        default:
+            cursor->done = cursor->failed = 1;
+            fileServiceFailedSDB (fs, 1, status);
+            return NULL;
+    }
+
+    pthread_mutex_unlock (&fs->lock);
+    return entity;
+}
 
 extern int
-fileServiceRemove (BRFileService fs,
-                   const char *type,
-                   UInt256 identifier) {
-    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
-    if (NULL == entityType)
-        return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
+fileServiceCursorRelease (BRFileServiceCursor cursor) {
+    BRFileService fs = cursor->fs;
+    int success = !cursor->failed;
+
+    pthread_mutex_lock (&fs->lock);
+    sqlite3_finalize (cursor->stmt);
+
+    size_t rewritesCount = array_count (cursor->rewrites);
+    if (rewritesCount > 0 && !fs->sdbClosed) {
+        int inBatch = (SQLITE_OK == _fileServiceBatchBegin (fs));
+
+        // As in `fileServiceLoad()`, on failure we'll try next time.
+        for (size_t index = 0; index < rewritesCount; index++) {
+            BRFileServicePendingWrite *rewrite = &cursor->rewrites[index];
+            _fileServiceWrite (fs, rewrite->type, rewrite->identifier, rewrite->bytes, rewrite->bytesCount,
+                               (rewrite->hasKey ? &rewrite->key : NULL), 0);
+            rewrite->bytes = NULL;   // owned by _fileServiceWrite
+        }
 
+        if (inBatch && SQLITE_OK != _fileServiceBatchCommit (fs))
+            _fileServiceBatchRollback (fs);
+    }
+    pthread_mutex_unlock (&fs->lock);
+
+    for (size_t index = 0; index < rewritesCount; index++)
+        if (NULL != cursor->rewrites[index].bytes) free (cursor->rewrites[index].bytes);
+    array_free (cursor->rewrites);
+
+    _fileServiceDecoderRelease (&cursor->decoder);
+    free (cursor);
+
+    return success;
+}
+
+/// MARK: - Remove, Clear
+
+static int
+_fileServiceRemove (BRFileService fs,
+                    const char *type,
+                    UInt256 identifier,
+                    int needLock) {
     // Hex-Encode identifier
     const char *hash = u256hex(identifier);
 
     sqlite3_status_code status;
 
-    pthread_mutex_lock (&fs->lock);
+    if (needLock) pthread_mutex_lock (&fs->lock);
     if (fs->sdbClosed)
-        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+        return fileServiceFailedImpl (fs, needLock, NULL, NULL, "closed");
 
     sqlite3_reset (fs->sdbDeleteStmt);
     sqlite3_clear_bindings (fs->sdbDeleteStmt);
 
     status = sqlite3_bind_text (fs->sdbDeleteStmt, 1, type, -1, SQLITE_STATIC);
     if (SQLITE_OK != status)
-        return fileServiceFailedSDB (fs, 1, status);
+        return fileServiceFailedSDB (fs, needLock, status);
 
     status = sqlite3_bind_text (fs->sdbDeleteStmt, 2, hash, -1, SQLITE_STATIC);
     if (SQLITE_OK != status)
-        return fileServiceFailedSDB (fs, 1, status);
+        return fileServiceFailedSDB (fs, needLock, status);
 
     status = sqlite3_step (fs->sdbDeleteStmt);
     if (SQLITE_DONE != status)
-        return fileServiceFailedSDB (fs, 1, status);
+        return fileServiceFailedSDB (fs, needLock, status);
 
     // Ensure the 'implicit DB transaction' is committed.
     sqlite3_reset (fs->sdbDeleteStmt);
 
-    pthread_mutex_unlock (&fs->lock);
+    if (needLock) pthread_mutex_unlock (&fs->lock);
 
     return 1;
 }
 
+extern int
+fileServiceRemove (BRFileService fs,
+                   const char *type,
+                   UInt256 identifier) {
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType)
+        return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
+
+    if (_fileServiceIsWriteBehind (fs)) {
+        _fileServiceEnqueue (fs, entityType, identifier, NULL, 0, NULL);
+        return 1;
+    }
+
+    return _fileServiceRemove (fs, type, identifier, 1);
+}
+
 static int
 fileServiceClearForType (BRFileService fs,
                          BRFileServiceEntityType *entityType,
@@ -810,18 +1720,18 @@ fileServiceClearForType (BRFileService fs,
 
     if (needLock) pthread_mutex_lock (&fs->lock);
     if (fs->sdbClosed)
-        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+        return fileServiceFailedImpl (fs, needLock, NULL, NULL, "closed");
 
     sqlite3_reset (fs->sdbDeleteAllTypeStmt);
     sqlite3_clear_bindings (fs->sdbDeleteAllTypeStmt);
 
     status = sqlite3_bind_text (fs->sdbDeleteAllTypeStmt, 1, type, -1, SQLITE_STATIC);
     if (SQLITE_OK != status)
-        return fileServiceFailedSDB (fs, 1, status);
+        return fileServiceFailedSDB (fs, needLock, status);
 
     status = sqlite3_step (fs->sdbDeleteAllTypeStmt);
     if (SQLITE_DONE != status)
-        return fileServiceFailedSDB (fs, 1, status);
+        return fileServiceFailedSDB (fs, needLock, status);
 
     // Ensure the 'implicit DB transaction' is committed.
     sqlite3_reset (fs->sdbDeleteAllTypeStmt);
@@ -838,11 +1748,14 @@ fileServiceClear (BRFileService fs,
     if (NULL == entityType)
         return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
 
+    fileServiceFlush (fs);
     return fileServiceClearForType(fs, entityType, 1);
 }
 
 extern int
 fileServiceClearAll (BRFileService fs) {
+    fileServiceFlush (fs);
+
     int success = 1;
     size_t typeCount = array_count(fs->entityTypes);
     for (size_t index = 0; index < typeCount; index++)
@@ -852,6 +1765,7 @@ fileServiceClearAll (BRFileService fs) {
 
 static int
 fileServiceReplaceFailed (BRFileService fs, int needUnlock) {
+    _fileServiceBatchRollback (fs);
     if (needUnlock) pthread_mutex_unlock (&fs->lock);
     return 0;
 }
@@ -865,13 +1779,16 @@ fileServiceReplace (BRFileService fs,
     if (NULL == entityType)
         return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
 
+    // Any queued writes would otherwise land after the clear.
+    fileServiceFlush (fs);
+
     sqlite3_status_code status;
 
     pthread_mutex_lock (&fs->lock);
     if (fs->sdbClosed)
         return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
 
-    status = sqlite3_exec (fs->sdb, "BEGIN", NULL, NULL, NULL);
+    status = _fileServiceBatchBegin (fs);
     if (SQLITE_OK != status)
         return fileServiceFailedSDB (fs, 1, status);
 
@@ -882,9 +1799,11 @@ fileServiceReplace (BRFileService fs,
         if (0 == _fileServiceSave (fs, type, entities[index], 0))
             return fileServiceReplaceFailed (fs, 1);
 
-    status = sqlite3_exec (fs->sdb, "COMMIT", NULL, NULL, NULL);
-    if (SQLITE_OK != status)
+    status = _fileServiceBatchCommit (fs);
+    if (SQLITE_OK != status) {
+        _fileServiceBatchRollback (fs);
         return fileServiceFailedSDB (fs, 1, status);
+    }
 
     pthread_mutex_unlock (&fs->lock);
 
@@ -976,6 +1895,20 @@ fileServiceDefineCurrentVersion (BRFileService fs,
     return 1;
 }
 
+extern int
+fileServiceDefineKey (BRFileService fs,
+                      const char *type,
+                      BRFileServiceContext context,
+                      BRFileServiceKey key) {
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType) return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
+
+    entityType->keyContext = context;
+    entityType->key        = key;
+
+    return 1;
+}
+
 extern BRFileService
 fileServiceCreateFromTypeSpecfications (const char *basePath,
                                         const char *currency,
@@ -110,6 +110,27 @@ fileServiceSetErrorHandler (BRFileService fs,
                             BRFileServiceContext context,
                             BRFileServiceErrorHandler handler);
 
+/**
+ * Enable write-behind.  Saves and removes are then queued, with repeated writes of the same
+ * entity coalesced, and written in batches by a dedicated thread; errors are reported through the
+ * error handler.  Loads, clears and replaces first flush the queue.  A save blocks while more
+ * than `queueBytesLimit` bytes are queued.  Close and release flush, then stop the thread.
+ *
+ * This should be called once types are defined but before `fs` is shared between threads.
+ *
+ * @return true (1) if success, false (0) otherwise;
+ */
+extern int
+fileServiceEnableWriteBehind (BRFileService fs,
+                              size_t queueBytesLimit);
+
+/**
+ * Block until everything saved, or removed, thus far is written.  Does nothing without
+ * write-behind.
+ */
+extern void
+fileServiceFlush (BRFileService fs);
+
 /**
  * Load all entities of `type` adding each to `results`.  If there is an error then the
  * fileServices' error handler is invoked and 0 is returned
@@ -128,11 +149,90 @@ fileServiceLoad (BRFileService fs,
                  const char *type,   /* blocks, peers, transactions, logs, ... */
                  int updateVersion);
 
+/**
+ * Load the entity of `type` with `identifier`.  Returns NULL if there is no such entity or if
+ * there is an error, in which case the fileServices' error handler is invoked.  You own the entity.
+ */
+extern void *
+fileServiceLoadEntity (BRFileService fs,
+                       const char *type,
+                       UInt256 identifier);
+
+/**
+ * A cursor over the entities of a type.  Unlike `fileServiceLoad()` entities are read one at
+ * a time, as requested, and without accumulating them into a BRSet.  Entities stored in an old
+ * format are updated, as if by `fileServiceLoad (..., 1)`, when the cursor is released.  All
+ * cursors must be released before `fs` is closed.
+ */
+typedef struct BRFileServiceCursorRecord *BRFileServiceCursor;
+
+extern BRFileServiceCursor
+fileServiceCursorCreate (BRFileService fs,
+                         const char *type);
+
+/**
+ * Create a cursor over the entities of `type` that skips those with a key less than
+ * `minimumKey`.  See `fileServiceDefineKey()`.
+ */
+extern BRFileServiceCursor
+fileServiceCursorCreateFromKey (BRFileService fs,
+                                const char *type,
+                                uint64_t minimumKey);
+
+/**
+ * Return the next entity, which you own, or NULL if there are no more entities or there is an
+ * error, in which case the fileServices' error handler is invoked.
+ */
+extern void *
+fileServiceCursorNext (BRFileServiceCursor cursor);
+
+/**
+ * Release `cursor`.
+ *
+ * @return true (1) if `cursor` did not fail, false (0) otherwise;
+ */
+extern int
+fileServiceCursorRelease (BRFileServiceCursor cursor);
+
 extern int  // 1 -> success, 0 -> failure
 fileServiceSave (BRFileService fs,
                  const char *type,  /* block, peers, transactions, logs, ... */
                  const void *entity);     /* BRMerkleBlock*, BRTransaction, BREthereumTransaction, ... */
 
+/**
+ * Save all `entities` of `type` in a single DB transaction.  If there is an error then nothing is
+ * saved, the fileService's error handler is invoked and 0 is returned.
+ *
+ * @return true (1) if success, false (0) otherwise;
+ */
+extern int
+fileServiceSaveMany (BRFileService fs,
+                     const char *type,
+                     const void **entities,
+                     size_t entitiesCount);
+
+/**
+ * Begin a batch.  Until the matching `fileServiceCommitBatch()`, all saves, removes, etc are
+ * written in one DB transaction - whereas otherwise each is its own DB transaction.  Batches
+ * nest; only the outermost commit writes to the file system.  A failed `fileServiceSaveMany()`
+ * or `fileServiceReplace()` within a batch abandons the batch, whereupon the commit fails.
+ *
+ * A batch belongs to the thread that begins it; other threads using `fs` wait until the
+ * matching commit.  Every begin must be matched by a commit on the same thread.
+ *
+ * With write-behind, a batch doesn't hold up other threads; rather, the saves and removes queued
+ * while any batch is open are written in the same DB transaction, as the writer waits for the
+ * batches to commit.  The queue limit doesn't apply within a batch.  A flush (or a load, clear or
+ * replace) within a batch writes out what is queued thus far.
+ *
+ * @return true (1) if success, false (0) otherwise;
+ */
+extern int
+fileServiceBeginBatch (BRFileService fs);
+
+extern int
+fileServiceCommitBatch (BRFileService fs);
+
 extern int
 fileServiceRemove (BRFileService fs,
                    const char *type,
@@ -184,6 +284,15 @@ typedef uint8_t*
                         const void* entity,
                         uint32_t *bytesCount);
 
+/**
+ * A function type to produce a secondary key, such as a block height, from an entity.  The key
+ * must not exceed INT64_MAX.
+ */
+typedef uint64_t
+(*BRFileServiceKey) (BRFileServiceContext context,
+                     BRFileService fs,
+                     const void* entity);
+
 /// TODO: There is a limitation on `type`.
 
 /**
@@ -214,6 +323,17 @@ fileServiceDefineCurrentVersion (BRFileService fs,
                                  const char *type,
                                  BRFileServiceVersion version);
 
+/**
+ * Define a secondary key for `type`, saved along with each entity, so that loads can skip
+ * entities by key.  See `fileServiceCursorCreateFromKey()`.  Entities saved before the key was
+ * defined have no key and are never skipped.
+ */
+extern int
+fileServiceDefineKey (BRFileService fs,
+                      const char *type,
+                      BRFileServiceContext context,
+                      BRFileServiceKey key);
+
 // Version limit can increase with maximum number of version, historically.
 #define FILE_SERVICE_TYPE_SPECIFICATION_NUMBER_OF_VERSION_LIMIT   (5)
 
@@ -24,28 +24,40 @@
 
 #include "BRSet.h"
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <assert.h>
 
 // linear probed hashtable for good cache performance, maximum load factor is 2/3
+// table sizes are powers of two, and bucket indexes come from the high bits of the item hash times a 64bit odd constant
+// (fibonacci hashing) so that weak hash functions still spread out over the table without a division on every probe
+// each bucket keeps its item's hash next to the item, so probes only call eq() on items with the same hash, a probe
+// touches one cache line rather than one in each of two arrays, and rehashing never calls hash(); removal shifts the
+// rest of the probe run back to fill the gap instead of leaving tombstones
 
-static const size_t tableSizes[] = { // starting with 1, multiply by 3/2, round up, then find next largest prime
-    1, 3, 7, 13, 23, 37, 59, 97, 149, 227, 347, 523, 787, 1187, 1783, 2677, 4019, 6037, 9059, 13591,
-    20389, 30593, 45887, 68863, 103307, 154981, 232487, 348739, 523129, 784697, 1177067, 1765609,
-    2648419, 3972643, 5958971, 8938469, 13407707, 20111563, 30167359, 45251077, 67876637, 101814991,
-    152722489, 229083739, 343625629, 515438447, 773157683, 1159736527, 1739604799, 2609407319, 3914111041
-};
+#define SET_MIN_SIZE 4
+#define SET_HASH_MULT 0x9e3779b97f4a7c15ULL // 2^64 divided by the golden ratio, rounded to odd
 
-#define TABLE_SIZES_LEN (sizeof(tableSizes)/sizeof(*tableSizes))
+typedef struct {
+    void *item;
+    size_t hash; // hash of item
+} BRSetBucket;
 
 struct BRSetStruct {
-    void **table; // hashtable
-    size_t size; // number of buckets in table
+    BRSetBucket *table; // hashtable
+    size_t size; // number of buckets in table, a power of two
+    unsigned shift; // 64 - log2(size)
     size_t itemCount; // number of items in set
     size_t (*hash)(const void *); // hash function
     int (*eq)(const void *, const void *); // equality function
 };
 
+// home bucket for an item hash
+inline static size_t _BRSetIndex(const BRSet *set, size_t hash)
+{
+    return (size_t)(((uint64_t)hash*SET_HASH_MULT) >> set->shift);
+}
+
 static void _BRSetInit(BRSet *set, size_t (*hash)(const void *), int (*eq)(const void *, const void *), size_t capacity)
 {
     assert(set != NULL);
@@ -53,16 +65,14 @@ static void _BRSetInit(BRSet *set, size_t (*hash)(const void *), int (*eq)(const
     assert(eq != NULL);
     assert(capacity >= 0);
 
-    size_t i = 0;
-    
-    while (i < TABLE_SIZES_LEN && tableSizes[i] < capacity) i++;
-
-    if (i + 1 < TABLE_SIZES_LEN) { // use next larger table size to keep load factor below 2/3 at capacity
-        set->table = calloc(tableSizes[i + 1], sizeof(void *));
-        assert(set->table != NULL);
-        set->size = tableSizes[i + 1];
-    }
+    size_t size = SET_MIN_SIZE;
+    unsigned shift = 64 - 2;
     
+    while (size/3*2 <= capacity && size < SIZE_MAX/2) size *= 2, shift--; // keep load factor below 2/3 at capacity
+    set->table = calloc(size, sizeof(*set->table));
+    assert(set->table != NULL);
+    set->size = size;
+    set->shift = shift;
     set->itemCount = 0;
     set->hash = hash;
     set->eq = eq;
@@ -86,13 +96,36 @@ BRSet *BRSetNew(size_t (*hash)(const void *), int (*eq)(const void *, const void
 static void _BRSetGrow(BRSet *set, size_t capacity)
 {
     BRSet newSet;
+    size_t i, j, mask;
     
     _BRSetInit(&newSet, set->hash, set->eq, capacity);
-    BRSetUnion(&newSet, set);
+    mask = newSet.size - 1;
+    
+    for (i = 0; i < set->size; i++) { // items are known to be distinct, so just move each to its first empty bucket
+        if (! set->table[i].item) continue;
+        j = _BRSetIndex(&newSet, set->table[i].hash);
+        while (newSet.table[j].item) j = (j + 1) & mask;
+        newSet.table[j] = set->table[i];
+    }
+    
     free(set->table);
     set->table = newSet.table;
     set->size = newSet.size;
-    set->itemCount = newSet.itemCount;
+    set->shift = newSet.shift;
+}
+
+// returns the bucket holding the item equivalent to given item, or the empty bucket that ends its probe run
+inline static size_t _BRSetFind(const BRSet *set, const void *item, size_t hash)
+{
+    size_t mask = set->size - 1, i = _BRSetIndex(set, hash);
+    void *t = set->table[i].item;
+    
+    while (t && t != item && (set->table[i].hash != hash || ! set->eq(t, item))) { // probe for item or empty bucket
+        i = (i + 1) & mask;
+        t = set->table[i].item;
+    }
+    
+    return i;
 }
 
 // adds given item to set or replaces an equivalent existing item and returns item replaced if any
@@ -101,18 +134,13 @@ void *BRSetAdd(BRSet *set, void *item)
     assert(set != NULL);
     assert(item != NULL);
     
-    size_t size = set->size;
-    size_t i = set->hash(item) % size;
-    void *t = set->table[i];
-
-    while (t && t != item && ! set->eq(t, item)) { // probe for empty bucket
-        i = (i + 1) % size;
-        t = set->table[i];
-    }
+    size_t hash = set->hash(item), i = _BRSetFind(set, item, hash);
+    void *t = set->table[i].item;
 
     if (! t) set->itemCount++;
-    set->table[i] = item;
-    if (set->itemCount > ((size + 2)/3)*2) _BRSetGrow(set, size); // limit load factor to 2/3
+    set->table[i].item = item;
+    set->table[i].hash = hash;
+    if (set->itemCount > set->size/3*2) _BRSetGrow(set, set->itemCount); // limit load factor to 2/3
     return t;
 }
 
@@ -122,28 +150,22 @@ void *BRSetRemove(BRSet *set, const void *item)
     assert(set != NULL);
     assert(item != NULL);
     
-    size_t size = set->size;
-    size_t i = set->hash(item) % size;
-    void *r = set->table[i], *t;
-
-    while (r != item && r && ! set->eq(r, item)) { // probe for item
-        i = (i + 1) % size;
-        r = set->table[i];
-    }
+    size_t mask = set->size - 1, i = _BRSetFind(set, item, set->hash(item)), j, k;
+    void *r = set->table[i].item;
     
     if (r) {
         set->itemCount--;
-        set->table[i] = NULL;
-        i = (i + 1) % size;
-        t = set->table[i];
         
-        while (t) { // hashtable cleanup
-            set->itemCount--;
-            set->table[i] = NULL;
-            BRSetAdd(set, t);
-            i = (i + 1) % size;
-            t = set->table[i];
+        // shift back any following items in the probe run whose home bucket is at or before the gap
+        for (j = (i + 1) & mask; set->table[j].item; j = (j + 1) & mask) {
+            k = _BRSetIndex(set, set->table[j].hash);
+            if (((j - k) & mask) < ((j - i) & mask)) continue; // item is already as close to home as it can be
+            set->table[i] = set->table[j];
+            i = j;
         }
+        
+        set->table[i].item = NULL;
+        set->table[i].hash = 0;
     }
     
     return r;
@@ -182,7 +204,7 @@ int BRSetIntersects(const BRSet *set, const BRSet *otherSet)
     void *t;
     
     while (i < size) {
-        t = otherSet->table[i++];
+        t = otherSet->table[i++].item;
         if (t && BRSetGet(set, t) != NULL) return 1;
     }
     
@@ -195,16 +217,7 @@ void *BRSetGet(const BRSet *set, const void *item)
     assert(set != NULL);
     assert(item != NULL);
     
-    size_t size = set->size;
-    size_t i = set->hash(item) % size;
-    void *t = set->table[i];
-
-    while (t != item && t && ! set->eq(t, item)) { // probe for item
-        i = (i + 1) % size;
-        t = set->table[i];
-    }
-    
-    return t;
+    return set->table[_BRSetFind(set, item, set->hash(item))].item;
 }
 
 // interates over set and returns the next item after previous, or NULL if no more items are available
@@ -214,21 +227,10 @@ void *BRSetIterate(const BRSet *set, const void *previous)
     assert(set != NULL);
     
     size_t i = 0, size = set->size;
-    void *t, *r = NULL;
-    
-    if (previous != NULL) {
-        i = set->hash(previous) % size;
-        t = set->table[i];
-        
-        while (t != previous && t && ! set->eq(t, previous)) { // probe for item
-            i = (i + 1) % size;
-            t = set->table[i];
-        }
-    
-        i++;
-    }
+    void *r = NULL;
     
-    while (! r && i < size) r = set->table[i++];
+    if (previous != NULL) i = _BRSetFind(set, previous, set->hash(previous)) + 1;
+    while (! r && i < size) r = set->table[i++].item;
     return r;
 }
 
@@ -243,7 +245,7 @@ size_t BRSetAll(const BRSet *set, void *allItems[], size_t count)
     void *t;
     
     while (i < size && j < count) {
-        t = set->table[i++];
+        t = set->table[i++].item;
         if (t) allItems[j++] = t;
     }
     
@@ -260,7 +262,7 @@ void BRSetApply(const BRSet *set, void *info, void (*apply)(void *info, void *it
     void *t;
     
     while (i < size) {
-        t = set->table[i++];
+        t = set->table[i++].item;
         if (t) apply(info, t);
     }
 }
@@ -275,7 +277,7 @@ void BRSetUnion(BRSet *set, const BRSet *otherSet)
     void *t;
     
     while (i < size) {
-        t = otherSet->table[i++];
+        t = otherSet->table[i++].item;
         if (t) BRSetAdd(set, t);
     }
 }
@@ -290,7 +292,7 @@ void BRSetMinus(BRSet *set, const BRSet *otherSet)
     void *t;
     
     while (i < size) {
-        t = otherSet->table[i++];
+        t = otherSet->table[i++].item;
         if (t) BRSetRemove(set, t);
     }
 }
@@ -305,7 +307,7 @@ void BRSetIntersect(BRSet *set, const BRSet *otherSet)
     void *t;
     
     while (i < size) {
-        t = set->table[i];
+        t = set->table[i].item;
 
         if (t && ! BRSetContains(otherSet, t)) {
             BRSetRemove(set, t);
@@ -332,7 +334,7 @@ void BRSetFreeAll (BRSet *set, void (*itemFree) (void *item)) {
     void *t;
 
     while (i < size) {
-        t = set->table[i++];
+        t = set->table[i++].item;
         if (t) itemFree(t);
     }
 
@@ -7,6 +7,7 @@
 //
 
 #include <stdio.h>
+#include <string.h>
 #include <pthread.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -107,6 +108,441 @@ static int runSupFileServiceTests (void) {
     return fileServiceTestDone(path, 1);
 }
 
+/// MARK: - File Service Entity Tests
+
+#define SUP_ENTITY_TYPE             "entity"
+#define SUP_ENTITY_DATA_COUNT       (40)
+#define SUP_ENTITY_BYTES_COUNT      (sizeof (UInt256) + sizeof (uint64_t) + SUP_ENTITY_DATA_COUNT)
+
+typedef struct {
+    UInt256 hash;
+    uint64_t height;
+    uint8_t data[SUP_ENTITY_DATA_COUNT];   // includes zeros, as the file service must store BLOBs
+} SupEntity;
+
+static SupEntity *
+supEntityCreate (uint64_t height) {
+    SupEntity *entity = calloc (1, sizeof (SupEntity));
+    entity->hash.u64[0] = height + 1;
+    entity->hash.u64[3] = 0xdeadbeef;
+    entity->height = height;
+    for (size_t index = 1; index < SUP_ENTITY_DATA_COUNT; index++)
+        entity->data[index] = (uint8_t) ((index * (height + 7)) & 0xff);
+    return entity;
+}
+
+static int
+supEntityIsEqual (const SupEntity *e1, const SupEntity *e2) {
+    return (NULL != e1 && NULL != e2 &&
+            UInt256Eq (e1->hash, e2->hash) &&
+            e1->height == e2->height &&
+            0 == memcmp (e1->data, e2->data, SUP_ENTITY_DATA_COUNT));
+}
+
+static size_t
+supEntityHashValue (const void *entity) {
+    return (size_t) ((const SupEntity *) entity)->hash.u64[0];
+}
+
+static int
+supEntityHashEqual (const void *e1, const void *e2) {
+    return UInt256Eq (((const SupEntity *) e1)->hash, ((const SupEntity *) e2)->hash);
+}
+
+static UInt256
+supEntityIdentifier (BRFileServiceContext context,
+                     BRFileService fs,
+                     const void *entity) {
+    return ((const SupEntity *) entity)->hash;
+}
+
+static uint8_t *
+supEntityWriter (BRFileServiceContext context,
+                 BRFileService fs,
+                 const void *entity,
+                 uint32_t *bytesCount) {
+    const SupEntity *e = entity;
+    uint8_t *bytes = malloc (SUP_ENTITY_BYTES_COUNT);
+
+    memcpy (&bytes[0], e->hash.u8, sizeof (UInt256));
+    UInt64SetBE (&bytes[sizeof (UInt256)], e->height);
+    memcpy (&bytes[sizeof (UInt256) + sizeof (uint64_t)], e->data, SUP_ENTITY_DATA_COUNT);
+
+    *bytesCount = SUP_ENTITY_BYTES_COUNT;
+    return bytes;
+}
+
+static void *
+supEntityReader (BRFileServiceContext context,
+                 BRFileService fs,
+                 uint8_t *bytes,
+                 uint32_t bytesCount) {
+    if (SUP_ENTITY_BYTES_COUNT != bytesCount) return NULL;
+
+    SupEntity *e = calloc (1, sizeof (SupEntity));
+    memcpy (e->hash.u8, &bytes[0], sizeof (UInt256));
+    e->height = UInt64GetBE (&bytes[sizeof (UInt256)]);
+    memcpy (e->data, &bytes[sizeof (UInt256) + sizeof (uint64_t)], SUP_ENTITY_DATA_COUNT);
+    return e;
+}
+
+static uint64_t
+supEntityKey (BRFileServiceContext context,
+              BRFileService fs,
+              const void *entity) {
+    return ((const SupEntity *) entity)->height;
+}
+
+static size_t supFileServiceErrorCount = 0;
+
+static void
+supFileServiceErrorHandler (BRFileServiceContext context,
+                            BRFileService fs,
+                            BRFileServiceError error) {
+    supFileServiceErrorCount += 1;
+}
+
+static int
+supFileServicePathCreate (char *path) {
+    struct stat dirStat;
+
+    if (0 == stat  (path, &dirStat)) _rmdir (path);
+    return 0 == mkdir (path, 0700);
+}
+
+static BRFileService
+supFileServiceCreate (char *path) {
+    BRFileService fs = fileServiceCreate (path, "btc", "mainnet", NULL, supFileServiceErrorHandler);
+    if (NULL == fs) return NULL;
+
+    if (1 != fileServiceDefineType (fs, SUP_ENTITY_TYPE, 0, NULL,
+                                    supEntityIdentifier,
+                                    supEntityReader,
+                                    supEntityWriter) ||
+        1 != fileServiceDefineCurrentVersion (fs, SUP_ENTITY_TYPE, 0) ||
+        1 != fileServiceDefineKey (fs, SUP_ENTITY_TYPE, NULL, supEntityKey)) {
+        fileServiceRelease (fs);
+        return NULL;
+    }
+
+    return fs;
+}
+
+// Return true if `entity` is in `fs`, unchanged.
+static int
+supFileServiceHasEntity (BRFileService fs, const SupEntity *entity) {
+    SupEntity *loaded = fileServiceLoadEntity (fs, SUP_ENTITY_TYPE, entity->hash);
+    int found = supEntityIsEqual (loaded, entity);
+    if (NULL != loaded) free (loaded);
+    return found;
+}
+
+// Return the number of entities in `fs` or SIZE_MAX on a failure.
+static size_t
+supFileServiceCount (BRFileService fs) {
+    BRSet *entities = BRSetNew (supEntityHashValue, supEntityHashEqual, 100);
+    int success = fileServiceLoad (fs, entities, SUP_ENTITY_TYPE, 1);
+    size_t count = BRSetCount (entities);
+    BRSetFreeAll (entities, free);
+    return success ? count : SIZE_MAX;
+}
+
+#define SUP_ENTITY_COUNT        (10)
+
+static int
+runSupFileServiceEntityTests (void) {
+    printf ("==== SUP:FileService:Entity\n");
+
+    char *path = "entities";
+    if (!supFileServicePathCreate (path)) return 0;
+
+    SupEntity *entities[SUP_ENTITY_COUNT];
+    for (size_t index = 0; index < SUP_ENTITY_COUNT; index++)
+        entities[index] = supEntityCreate (index);
+
+    supFileServiceErrorCount = 0;
+    int success = 0;
+
+    BRFileService fs = supFileServiceCreate (path);
+    if (NULL == fs) goto done;
+
+    for (size_t index = 0; index < SUP_ENTITY_COUNT; index++)
+        if (1 != fileServiceSave (fs, SUP_ENTITY_TYPE, entities[index])) goto done;
+    fileServiceRelease (fs);
+
+    // Reopen; every BLOB must read back byte-for-byte, embedded zeros included.
+    fs = supFileServiceCreate (path);
+    if (NULL == fs) goto done;
+
+    BRSet *loaded = BRSetNew (supEntityHashValue, supEntityHashEqual, 100);
+    if (1 != fileServiceLoad (fs, loaded, SUP_ENTITY_TYPE, 1) ||
+        SUP_ENTITY_COUNT != BRSetCount (loaded)) {
+        BRSetFreeAll (loaded, free);
+        goto done;
+    }
+    for (size_t index = 0; index < SUP_ENTITY_COUNT; index++)
+        if (!supEntityIsEqual (BRSetGet (loaded, entities[index]), entities[index])) {
+            BRSetFreeAll (loaded, free);
+            goto done;
+        }
+    BRSetFreeAll (loaded, free);
+
+    // Load one at a time; a missing identifier is not an error.
+    for (size_t index = 0; index < SUP_ENTITY_COUNT; index++)
+        if (!supFileServiceHasEntity (fs, entities[index])) goto done;
+
+    SupEntity *missing = supEntityCreate (SUP_ENTITY_COUNT);
+    void *entity = fileServiceLoadEntity (fs, SUP_ENTITY_TYPE, missing->hash);
+    free (missing);
+    if (NULL != entity) { free (entity); goto done; }
+
+    // A cursor over everything
+    size_t count = 0;
+    BRFileServiceCursor cursor = fileServiceCursorCreate (fs, SUP_ENTITY_TYPE);
+    if (NULL == cursor) goto done;
+    while (NULL != (entity = fileServiceCursorNext (cursor))) {
+        SupEntity *e = entity;
+        if (e->height >= SUP_ENTITY_COUNT || !supEntityIsEqual (e, entities[e->height])) count = SIZE_MAX;
+        else if (SIZE_MAX != count) count += 1;
+        free (entity);
+    }
+    if (1 != fileServiceCursorRelease (cursor) || SUP_ENTITY_COUNT != count) goto done;
+
+    // A cursor from a key skips entities with a smaller key.
+    count = 0;
+    cursor = fileServiceCursorCreateFromKey (fs, SUP_ENTITY_TYPE, SUP_ENTITY_COUNT / 2);
+    if (NULL == cursor) goto done;
+    while (NULL != (entity = fileServiceCursorNext (cursor))) {
+        SupEntity *e = entity;
+        if (e->height < SUP_ENTITY_COUNT / 2 || e->height >= SUP_ENTITY_COUNT) count = SIZE_MAX;
+        else if (SIZE_MAX != count) count += 1;
+        free (entity);
+    }
+    if (1 != fileServiceCursorRelease (cursor) || SUP_ENTITY_COUNT - SUP_ENTITY_COUNT / 2 != count) goto done;
+
+    // Remove
+    if (1 != fileServiceRemove (fs, SUP_ENTITY_TYPE, entities[0]->hash) ||
+        supFileServiceHasEntity (fs, entities[0]) ||
+        SUP_ENTITY_COUNT - 1 != supFileServiceCount (fs)) goto done;
+
+    success = (0 == supFileServiceErrorCount);
+
+done:
+    if (NULL != fs) fileServiceRelease (fs);
+    for (size_t index = 0; index < SUP_ENTITY_COUNT; index++)
+        free (entities[index]);
+    return fileServiceTestDone (path, success);
+}
+
+/// MARK: - File Service Batch Tests
+
+typedef struct {
+    BRFileService fs;
+    SupEntity *entity;
+    int saved;
+} SupFileServiceSaver;
+
+static void *
+supFileServiceSaverThread (void *arg) {
+    SupFileServiceSaver *saver = arg;
+
+    // Another connection might briefly hold the DB; retry on a failure.
+    for (size_t tries = 0; tries < 100 && !saver->saved; tries++) {
+        saver->saved = fileServiceSave (saver->fs, SUP_ENTITY_TYPE, saver->entity);
+        if (!saver->saved) usleep (10000);
+    }
+    return NULL;
+}
+
+//
+// Make the commit of a batch in `fs` fail.  A reader of the DB, with its own connection, holds
+// a shared lock while its cursor is mid-way through; whereupon SQLite can't commit.  The returned
+// cursor is the reader.  Requires more than one entity in the DB.
+//
+static BRFileServiceCursor
+supFileServiceBlockCommit (BRFileService reader) {
+    BRFileServiceCursor cursor = fileServiceCursorCreate (reader, SUP_ENTITY_TYPE);
+    if (NULL == cursor) return NULL;
+
+    void *entity = fileServiceCursorNext (cursor);
+    if (NULL == entity) { fileServiceCursorRelease (cursor); return NULL; }
+
+    free (entity);
+    return cursor;
+}
+
+static int
+runSupFileServiceBatchTests (void) {
+    printf ("==== SUP:FileService:Batch\n");
+
+    char *path = "batches";
+    if (!supFileServicePathCreate (path)) return 0;
+
+    SupEntity *entities[SUP_ENTITY_COUNT];
+    for (size_t index = 0; index < SUP_ENTITY_COUNT; index++)
+        entities[index] = supEntityCreate (index);
+
+    supFileServiceErrorCount = 0;
+    int success = 0;
+
+    BRFileService fs     = supFileServiceCreate (path);
+    BRFileService reader = supFileServiceCreate (path);
+    if (NULL == fs || NULL == reader) goto done;
+
+    //
+    // Commit: nothing is written until the outermost commit.
+    //
+    if (1 != fileServiceBeginBatch (fs) ||
+        1 != fileServiceSave (fs, SUP_ENTITY_TYPE, entities[0]) ||
+        1 != fileServiceBeginBatch (fs) ||
+        1 != fileServiceSaveMany (fs, SUP_ENTITY_TYPE, (const void **) &entities[1], 2) ||
+        1 != fileServiceCommitBatch (fs)) goto done;
+
+    // Within the batch, `fs` sees its own writes, other connections do not.
+    if (!supFileServiceHasEntity (fs, entities[2]) ||
+        supFileServiceHasEntity (reader, entities[0]) ||
+        0 != supFileServiceCount (reader)) goto done;
+
+    if (1 != fileServiceCommitBatch (fs) ||
+        3 != supFileServiceCount (reader)) goto done;
+
+    //
+    // Rollback: a failed commit writes nothing of the batch...
+    //
+    BRFileServiceCursor cursor = supFileServiceBlockCommit (reader);
+    if (NULL == cursor) goto done;
+
+    if (1 != fileServiceBeginBatch (fs) ||
+        1 != fileServiceSave (fs, SUP_ENTITY_TYPE, entities[3]) ||
+        1 != fileServiceRemove (fs, SUP_ENTITY_TYPE, entities[0]->hash)) {
+        fileServiceCursorRelease (cursor);
+        goto done;
+    }
+
+    // ... but, a save by another thread, made during the batch, is not part of the batch.
+    SupFileServiceSaver saver = { fs, entities[4], 0 };
+    pthread_t thread;
+    if (0 != pthread_create (&thread, NULL, supFileServiceSaverThread, &saver)) {
+        fileServiceCommitBatch (fs);
+        fileServiceCursorRelease (cursor);
+        goto done;
+    }
+    usleep (100000);
+
+    int committed = fileServiceCommitBatch (fs);
+    fileServiceCursorRelease (cursor);
+    pthread_join (thread, NULL);
+
+    if (committed || !saver.saved) goto done;
+
+    if (!supFileServiceHasEntity (fs, entities[0]) ||
+        supFileServiceHasEntity (fs, entities[3]) ||
+        !supFileServiceHasEntity (fs, entities[4]) ||
+        !supFileServiceHasEntity (reader, entities[4]) ||
+        4 != supFileServiceCount (fs)) goto done;
+
+    // After a rollback, batches work as ever.
+    supFileServiceErrorCount = 0;
+    if (1 != fileServiceBeginBatch (fs) ||
+        1 != fileServiceSave (fs, SUP_ENTITY_TYPE, entities[5]) ||
+        1 != fileServiceCommitBatch (fs) ||
+        !supFileServiceHasEntity (reader, entities[5])) goto done;
+
+    success = (0 == supFileServiceErrorCount);
+
+done:
+    if (NULL != reader) fileServiceRelease (reader);
+    if (NULL != fs)     fileServiceRelease (fs);
+    for (size_t index = 0; index < SUP_ENTITY_COUNT; index++)
+        free (entities[index]);
+    return fileServiceTestDone (path, success);
+}
+
+/// MARK: - File Service Write-Behind Tests
+
+static int
+runSupFileServiceWriteBehindTests (void) {
+    printf ("==== SUP:FileService:WriteBehind\n");
+
+    char *path = "writes";
+    if (!supFileServicePathCreate (path)) return 0;
+
+    SupEntity *entities[SUP_ENTITY_COUNT];
+    for (size_t index = 0; index < SUP_ENTITY_COUNT; index++)
+        entities[index] = supEntityCreate (index);
+
+    supFileServiceErrorCount = 0;
+    int success = 0;
+
+    BRFileService fs     = supFileServiceCreate (path);
+    BRFileService reader = supFileServiceCreate (path);
+    if (NULL == fs || NULL == reader) goto done;
+
+    // A batch begun before write-behind is enabled still commits directly.
+    if (1 != fileServiceBeginBatch (fs) ||
+        1 != fileServiceSave (fs, SUP_ENTITY_TYPE, entities[0]) ||
+        1 != fileServiceEnableWriteBehind (fs, 2 * SUP_ENTITY_BYTES_COUNT) ||
+        1 != fileServiceCommitBatch (fs) ||
+        !supFileServiceHasEntity (reader, entities[0])) goto done;
+
+    // Saves are queued; the writer waits on an open batch, which isn't held to the queue limit...
+    if (1 != fileServiceBeginBatch (fs)) goto done;
+    for (size_t index = 1; index < 4; index++)
+        if (1 != fileServiceSave (fs, SUP_ENTITY_TYPE, entities[index])) goto done;
+    usleep (500000);
+    if (1 != supFileServiceCount (reader)) {
+        fileServiceCommitBatch (fs);
+        goto done;
+    }
+    if (1 != fileServiceCommitBatch (fs)) goto done;
+
+    // ... and a flush writes everything queued.
+    fileServiceFlush (fs);
+    if (4 != supFileServiceCount (reader)) goto done;
+
+    // A queued remove overrides a queued save.
+    if (1 != fileServiceSave   (fs, SUP_ENTITY_TYPE, entities[4]) ||
+        1 != fileServiceRemove (fs, SUP_ENTITY_TYPE, entities[4]->hash)) goto done;
+    fileServiceFlush (fs);
+    if (supFileServiceHasEntity (reader, entities[4])) goto done;
+
+    //
+    // Rollback: `fileServiceReplace()` writes directly; fail its commit.
+    //
+    BRFileServiceCursor cursor = supFileServiceBlockCommit (reader);
+    if (NULL == cursor) goto done;
+
+    int replaced = fileServiceReplace (fs, SUP_ENTITY_TYPE, (const void **) &entities[5], 1);
+    fileServiceCursorRelease (cursor);
+
+    if (replaced || 4 != supFileServiceCount (reader)) goto done;
+
+    // After the rollback saves are still queued - the writer lingers before writing - and flushed.
+    supFileServiceErrorCount = 0;
+    if (1 != fileServiceSave (fs, SUP_ENTITY_TYPE, entities[6]) ||
+        supFileServiceHasEntity (reader, entities[6])) goto done;
+
+    fileServiceFlush (fs);
+    if (!supFileServiceHasEntity (reader, entities[6])) goto done;
+
+    // Release writes what is queued.
+    if (1 != fileServiceSave (fs, SUP_ENTITY_TYPE, entities[7])) goto done;
+    fileServiceRelease (fs);
+    fs = NULL;
+
+    if (!supFileServiceHasEntity (reader, entities[7]) ||
+        6 != supFileServiceCount (reader)) goto done;
+
+    success = (0 == supFileServiceErrorCount);
+
+done:
+    if (NULL != reader) fileServiceRelease (reader);
+    if (NULL != fs)     fileServiceRelease (fs);
+    for (size_t index = 0; index < SUP_ENTITY_COUNT; index++)
+        free (entities[index]);
+    return fileServiceTestDone (path, success);
+}
+
 /// MARK: - Assert Tests
 
 #include <pthread.h>
@@ -408,6 +844,9 @@ int BRRunSupTests (void) {
     int success = 1;
 
     success &= runSupFileServiceTests();
+    success &= runSupFileServiceEntityTests();
+    success &= runSupFileServiceBatchTests();
+    success &= runSupFileServiceWriteBehindTests();
     success &= runSupAssertTests();
 
     return success;